@@ -0,0 +1,44 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Preview header for XR_MNDX_multires_projection extension.
+ * @ingroup external_openxr
+ */
+#ifndef XR_MNDX_MULTIRES_PROJECTION_H
+#define XR_MNDX_MULTIRES_PROJECTION_H 1
+
+#include <openxr/openxr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XR_MNDX_multires_projection 1
+#define XR_MNDX_multires_projection_SPEC_VERSION 1
+#define XR_MNDX_MULTIRES_PROJECTION_EXTENSION_NAME "XR_MNDX_multires_projection"
+
+// Provisional value, not yet registered with Khronos.
+#define XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW_MULTIRES_MNDX ((XrStructureType)1000588000U)
+
+/*!
+ * Chained to a XrCompositionLayerProjectionView to tell the runtime that the
+ * view is packed at multiple resolutions: the fullResolutionRect of the view,
+ * in normalized coordinates with the origin at the top left, is stored at
+ * full resolution and the periphery on each side of it is stored scaled down
+ * by peripheryScale along that axis. The subImage of the view covers the
+ * whole packed image.
+ */
+typedef struct XrCompositionLayerProjectionViewMultiresMNDX
+{
+	XrStructureType type;
+	const void *XR_MAY_ALIAS next;
+	XrRect2Df fullResolutionRect;
+	XrVector2f peripheryScale;
+} XrCompositionLayerProjectionViewMultiresMNDX;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
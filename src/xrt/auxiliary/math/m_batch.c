@@ -0,0 +1,429 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Batch versions of pose math functions, working on
+ *         structure-of-arrays buffers.
+ * @ingroup aux_math_batch
+ */
+
+#include "math/m_batch.h"
+
+#include "util/u_simd.h"
+
+#include <float.h>
+#include <string.h>
+
+
+//! The most float arrays any of the functions reads or writes.
+#define MAX_ARRAYS (14)
+
+
+/*
+ *
+ * Lane helpers, same operations in the same order as Eigen does them so the
+ * results match the single value functions.
+ *
+ */
+
+struct vq
+{
+	u_vf x, y, z, w;
+};
+
+struct vv
+{
+	u_vf x, y, z;
+};
+
+static inline struct vq
+vq_load(const float *const *p, uint32_t i)
+{
+	return (struct vq){u_vf_load(&p[0][i]), u_vf_load(&p[1][i]), u_vf_load(&p[2][i]), u_vf_load(&p[3][i])};
+}
+
+static inline void
+vq_store(float *const *p, uint32_t i, struct vq q)
+{
+	u_vf_store(&p[0][i], q.x);
+	u_vf_store(&p[1][i], q.y);
+	u_vf_store(&p[2][i], q.z);
+	u_vf_store(&p[3][i], q.w);
+}
+
+static inline struct vq
+vq_set(const struct xrt_quat *q)
+{
+	return (struct vq){u_vf_set(q->x), u_vf_set(q->y), u_vf_set(q->z), u_vf_set(q->w)};
+}
+
+static inline struct vv
+vv_load(const float *const *p, uint32_t i)
+{
+	return (struct vv){u_vf_load(&p[0][i]), u_vf_load(&p[1][i]), u_vf_load(&p[2][i])};
+}
+
+static inline void
+vv_store(float *const *p, uint32_t i, struct vv v)
+{
+	u_vf_store(&p[0][i], v.x);
+	u_vf_store(&p[1][i], v.y);
+	u_vf_store(&p[2][i], v.z);
+}
+
+static inline struct vv
+vv_set(const struct xrt_vec3 *v)
+{
+	return (struct vv){u_vf_set(v->x), u_vf_set(v->y), u_vf_set(v->z)};
+}
+
+static inline struct vv
+vv_add(struct vv a, struct vv b)
+{
+	return (struct vv){u_vf_add(a.x, b.x), u_vf_add(a.y, b.y), u_vf_add(a.z, b.z)};
+}
+
+static inline struct vv
+vv_cross(struct vv a, struct vv b)
+{
+	return (struct vv){
+	    u_vf_sub(u_vf_mul(a.y, b.z), u_vf_mul(a.z, b.y)),
+	    u_vf_sub(u_vf_mul(a.z, b.x), u_vf_mul(a.x, b.z)),
+	    u_vf_sub(u_vf_mul(a.x, b.y), u_vf_mul(a.y, b.x)),
+	};
+}
+
+//! Hamilton product, `a * b`.
+static inline struct vq
+vq_mul(struct vq a, struct vq b)
+{
+	struct vq r;
+	r.w = u_vf_sub(u_vf_sub(u_vf_sub(u_vf_mul(a.w, b.w), u_vf_mul(a.x, b.x)), u_vf_mul(a.y, b.y)),
+	               u_vf_mul(a.z, b.z));
+	r.x = u_vf_sub(u_vf_add(u_vf_add(u_vf_mul(a.w, b.x), u_vf_mul(a.x, b.w)), u_vf_mul(a.y, b.z)),
+	               u_vf_mul(a.z, b.y));
+	r.y = u_vf_sub(u_vf_add(u_vf_add(u_vf_mul(a.w, b.y), u_vf_mul(a.y, b.w)), u_vf_mul(a.z, b.x)),
+	               u_vf_mul(a.x, b.z));
+	r.z = u_vf_sub(u_vf_add(u_vf_add(u_vf_mul(a.w, b.z), u_vf_mul(a.z, b.w)), u_vf_mul(a.x, b.y)),
+	               u_vf_mul(a.y, b.x));
+	return r;
+}
+
+//! `q * v * q^-1` for a unit quaternion, `v + 2w(u x v) + u x 2(u x v)`.
+static inline struct vv
+vq_rotate(struct vq q, struct vv v)
+{
+	struct vv u = {q.x, q.y, q.z};
+	struct vv uv = vv_cross(u, v);
+	uv = vv_add(uv, uv);
+
+	struct vv wuv = {u_vf_mul(q.w, uv.x), u_vf_mul(q.w, uv.y), u_vf_mul(q.w, uv.z)};
+
+	return vv_add(vv_add(v, wuv), vv_cross(u, uv));
+}
+
+
+/*
+ *
+ * Driver, runs a lanes function over all of the values and pads the last
+ * group when there are fewer values left than lanes.
+ *
+ */
+
+typedef void (*lanes_func_t)(const void *ctx, const float *const *in, float *const *out, uint32_t i);
+
+static inline void
+run(lanes_func_t func,
+    const void *ctx,
+    const float *const *in,
+    uint32_t in_count,
+    float *const *out,
+    uint32_t out_count,
+    uint32_t count)
+{
+	uint32_t i = 0;
+	for (; i + U_SIMD_LANES <= count; i += U_SIMD_LANES) {
+		func(ctx, in, out, i);
+	}
+
+	if (i == count) {
+		return;
+	}
+
+	uint32_t left = count - i;
+	float in_tail[MAX_ARRAYS][U_SIMD_LANES];
+	float out_tail[MAX_ARRAYS][U_SIMD_LANES];
+	const float *in_ptrs[MAX_ARRAYS];
+	float *out_ptrs[MAX_ARRAYS];
+
+	// Zero padding is valid input for all of the functions.
+	memset(in_tail, 0, sizeof(in_tail));
+	for (uint32_t k = 0; k < in_count; k++) {
+		memcpy(in_tail[k], &in[k][i], left * sizeof(float));
+		in_ptrs[k] = in_tail[k];
+	}
+	for (uint32_t k = 0; k < out_count; k++) {
+		out_ptrs[k] = out_tail[k];
+	}
+
+	func(ctx, in_ptrs, out_ptrs, 0);
+
+	for (uint32_t k = 0; k < out_count; k++) {
+		memcpy(&out[k][i], out_tail[k], left * sizeof(float));
+	}
+}
+
+
+/*
+ *
+ * Lanes functions.
+ *
+ */
+
+static void
+quat_rotate_lanes(const void *ctx, const float *const *in, float *const *out, uint32_t i)
+{
+	(void)ctx;
+
+	vq_store(out, i, vq_mul(vq_load(in, i), vq_load(in + 4, i)));
+}
+
+static void
+quat_rotate_vec3_lanes(const void *ctx, const float *const *in, float *const *out, uint32_t i)
+{
+	(void)ctx;
+
+	vv_store(out, i, vq_rotate(vq_load(in, i), vv_load(in + 4, i)));
+}
+
+static void
+quat_normalize_lanes(const void *ctx, const float *const *in, float *const *out, uint32_t i)
+{
+	(void)ctx;
+
+	struct vq q = vq_load(in, i);
+	u_vf n2 = u_vf_add(u_vf_add(u_vf_add(u_vf_mul(q.x, q.x), u_vf_mul(q.y, q.y)), u_vf_mul(q.z, q.z)),
+	                   u_vf_mul(q.w, q.w));
+
+	// Keeps zero length quaternions at zero instead of dividing by zero.
+	u_vf n = u_vf_sqrt(u_vf_max(n2, u_vf_set(FLT_MIN)));
+
+	q.x = u_vf_div(q.x, n);
+	q.y = u_vf_div(q.y, n);
+	q.z = u_vf_div(q.z, n);
+	q.w = u_vf_div(q.w, n);
+
+	vq_store(out, i, q);
+}
+
+static void
+pose_transform_lanes(const void *ctx, const float *const *in, float *const *out, uint32_t i)
+{
+	(void)ctx;
+
+	struct vq t_q = vq_load(in, i);
+	struct vv t_p = vv_load(in + 4, i);
+	struct vq q = vq_load(in + 7, i);
+	struct vv p = vv_load(in + 11, i);
+
+	vq_store(out, i, vq_mul(t_q, q));
+	vv_store(out + 4, i, vv_add(vq_rotate(t_q, p), t_p));
+}
+
+struct single_ctx
+{
+	struct vq q;
+	struct vv p;
+	struct vv lin;
+	struct vv ang;
+};
+
+static void
+pose_transform_single_lanes(const void *ctx, const float *const *in, float *const *out, uint32_t i)
+{
+	const struct single_ctx *c = (const struct single_ctx *)ctx;
+
+	struct vq q = vq_load(in, i);
+	struct vv p = vv_load(in + 4, i);
+
+	vq_store(out, i, vq_mul(c->q, q));
+	vv_store(out + 4, i, vv_add(vq_rotate(c->q, p), c->p));
+}
+
+static void
+relation_apply_single_lanes(const void *ctx, const float *const *in, float *const *out, uint32_t i)
+{
+	const struct single_ctx *c = (const struct single_ctx *)ctx;
+
+	struct vq q = vq_load(in, i);
+	struct vv p = vv_load(in + 4, i);
+	struct vv lin = vv_load(in + 7, i);
+	struct vv ang = vv_load(in + 10, i);
+
+	// Pose.
+	struct vv rotated_p = vq_rotate(c->q, p);
+	vq_store(out, i, vq_mul(c->q, q));
+	vv_store(out + 4, i, vv_add(rotated_p, c->p));
+
+	// Linear velocity, including the lever arm effect of the base angular velocity.
+	struct vv out_lin = vv_add(vv_add(vq_rotate(c->q, lin), c->lin), vv_cross(c->ang, rotated_p));
+	vv_store(out + 7, i, out_lin);
+
+	// Angular velocity.
+	vv_store(out + 10, i, vv_add(vq_rotate(c->q, ang), c->ang));
+}
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static inline void
+quat_in(const float **arrays, const struct m_quat_soa *q)
+{
+	arrays[0] = q->x;
+	arrays[1] = q->y;
+	arrays[2] = q->z;
+	arrays[3] = q->w;
+}
+
+static inline void
+quat_out(float **arrays, const struct m_quat_soa *q)
+{
+	arrays[0] = q->x;
+	arrays[1] = q->y;
+	arrays[2] = q->z;
+	arrays[3] = q->w;
+}
+
+static inline void
+vec3_in(const float **arrays, const struct m_vec3_soa *v)
+{
+	arrays[0] = v->x;
+	arrays[1] = v->y;
+	arrays[2] = v->z;
+}
+
+static inline void
+vec3_out(float **arrays, const struct m_vec3_soa *v)
+{
+	arrays[0] = v->x;
+	arrays[1] = v->y;
+	arrays[2] = v->z;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+void
+m_batch_quat_rotate(const struct m_quat_soa *left,
+                    const struct m_quat_soa *right,
+                    const struct m_quat_soa *result,
+                    uint32_t count)
+{
+	const float *in[8];
+	float *out[4];
+	quat_in(in, left);
+	quat_in(in + 4, right);
+	quat_out(out, result);
+
+	run(quat_rotate_lanes, NULL, in, 8, out, 4, count);
+}
+
+void
+m_batch_quat_rotate_vec3(const struct m_quat_soa *left,
+                         const struct m_vec3_soa *right,
+                         const struct m_vec3_soa *result,
+                         uint32_t count)
+{
+	const float *in[7];
+	float *out[3];
+	quat_in(in, left);
+	vec3_in(in + 4, right);
+	vec3_out(out, result);
+
+	run(quat_rotate_vec3_lanes, NULL, in, 7, out, 3, count);
+}
+
+void
+m_batch_quat_normalize(const struct m_quat_soa *inout, uint32_t count)
+{
+	const float *in[4];
+	float *out[4];
+	quat_in(in, inout);
+	quat_out(out, inout);
+
+	run(quat_normalize_lanes, NULL, in, 4, out, 4, count);
+}
+
+void
+m_batch_pose_transform(const struct m_pose_soa *transform,
+                       const struct m_pose_soa *pose,
+                       const struct m_pose_soa *out_pose,
+                       uint32_t count)
+{
+	const float *in[14];
+	float *out[7];
+	quat_in(in, &transform->orientation);
+	vec3_in(in + 4, &transform->position);
+	quat_in(in + 7, &pose->orientation);
+	vec3_in(in + 11, &pose->position);
+	quat_out(out, &out_pose->orientation);
+	vec3_out(out + 4, &out_pose->position);
+
+	run(pose_transform_lanes, NULL, in, 14, out, 7, count);
+}
+
+void
+m_batch_pose_transform_single(const struct xrt_pose *transform,
+                              const struct m_pose_soa *pose,
+                              const struct m_pose_soa *out_pose,
+                              uint32_t count)
+{
+	// Only the pose is used.
+	struct single_ctx c;
+	c.q = vq_set(&transform->orientation);
+	c.p = vv_set(&transform->position);
+
+	const float *in[7];
+	float *out[7];
+	quat_in(in, &pose->orientation);
+	vec3_in(in + 4, &pose->position);
+	quat_out(out, &out_pose->orientation);
+	vec3_out(out + 4, &out_pose->position);
+
+	run(pose_transform_single_lanes, &c, in, 7, out, 7, count);
+}
+
+void
+m_batch_relation_apply_single(const struct xrt_space_relation *base,
+                              const struct m_relation_soa *relation,
+                              const struct m_relation_soa *out_relation,
+                              uint32_t count)
+{
+	struct single_ctx c = {
+	    vq_set(&base->pose.orientation),
+	    vv_set(&base->pose.position),
+	    vv_set(&base->linear_velocity),
+	    vv_set(&base->angular_velocity),
+	};
+
+	const float *in[13];
+	float *out[13];
+	quat_in(in, &relation->pose.orientation);
+	vec3_in(in + 4, &relation->pose.position);
+	vec3_in(in + 7, &relation->linear_velocity);
+	vec3_in(in + 10, &relation->angular_velocity);
+	quat_out(out, &out_relation->pose.orientation);
+	vec3_out(out + 4, &out_relation->pose.position);
+	vec3_out(out + 7, &out_relation->linear_velocity);
+	vec3_out(out + 10, &out_relation->angular_velocity);
+
+	run(relation_apply_single_lanes, &c, in, 13, out, 13, count);
+}
@@ -0,0 +1,141 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Batch versions of pose math functions, working on
+ *         structure-of-arrays buffers.
+ * @ingroup aux_math
+ */
+
+#pragma once
+
+#include "xrt/xrt_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * @defgroup aux_math_batch Batch math
+ * @ingroup aux_math
+ *
+ * Versions of some of the @ref aux_math functions that work on many values
+ * at once, laid out as a structure of arrays so that each component can be
+ * loaded straight into a SIMD register. The results match the single value
+ * functions up to floating point rounding.
+ *
+ * The output arrays may be the same as the input arrays but must not
+ * otherwise overlap them.
+ *
+ * @{
+ */
+
+/*!
+ * Array of vectors, one array per component.
+ */
+struct m_vec3_soa
+{
+	float *x;
+	float *y;
+	float *z;
+};
+
+/*!
+ * Array of quaternions, one array per component.
+ */
+struct m_quat_soa
+{
+	float *x;
+	float *y;
+	float *z;
+	float *w;
+};
+
+/*!
+ * Array of poses, one array per component.
+ */
+struct m_pose_soa
+{
+	struct m_quat_soa orientation;
+	struct m_vec3_soa position;
+};
+
+/*!
+ * Array of the pose and velocities of @ref xrt_space_relation, the flags are
+ * left to the caller.
+ */
+struct m_relation_soa
+{
+	struct m_pose_soa pose;
+	struct m_vec3_soa linear_velocity;
+	struct m_vec3_soa angular_velocity;
+};
+
+/*!
+ * Batch version of @ref math_quat_rotate, `result[i] = left[i] * right[i]`.
+ */
+void
+m_batch_quat_rotate(const struct m_quat_soa *left,
+                    const struct m_quat_soa *right,
+                    const struct m_quat_soa *result,
+                    uint32_t count);
+
+/*!
+ * Batch version of @ref math_quat_rotate_vec3, rotates @p count vectors each
+ * by their own quaternion.
+ */
+void
+m_batch_quat_rotate_vec3(const struct m_quat_soa *left,
+                         const struct m_vec3_soa *right,
+                         const struct m_vec3_soa *result,
+                         uint32_t count);
+
+/*!
+ * Batch version of @ref math_quat_normalize, zero length quaternions are
+ * left as is.
+ */
+void
+m_batch_quat_normalize(const struct m_quat_soa *inout, uint32_t count);
+
+/*!
+ * Batch version of @ref math_pose_transform, transforms each pose by its own
+ * transform.
+ */
+void
+m_batch_pose_transform(const struct m_pose_soa *transform,
+                       const struct m_pose_soa *pose,
+                       const struct m_pose_soa *out_pose,
+                       uint32_t count);
+
+/*!
+ * Transforms @p count poses by the same @p transform, the batch version of
+ * calling @ref math_pose_transform in a loop.
+ */
+void
+m_batch_pose_transform_single(const struct xrt_pose *transform,
+                              const struct m_pose_soa *pose,
+                              const struct m_pose_soa *out_pose,
+                              uint32_t count);
+
+/*!
+ * Puts each of @p count relations in the space of @p base, the math done when
+ * resolving a @ref xrt_relation_chain with all of the flags valid. Callers
+ * that deal with missing flags are expected to make the components valid and
+ * zero @p base angular velocity when no angular velocity is passed on, see
+ * @ref m_relation_chain_resolve_batch.
+ */
+void
+m_batch_relation_apply_single(const struct xrt_space_relation *base,
+                              const struct m_relation_soa *relation,
+                              const struct m_relation_soa *out_relation,
+                              uint32_t count);
+
+/*!
+ * @}
+ */
+
+
+#ifdef __cplusplus
+}
+#endif
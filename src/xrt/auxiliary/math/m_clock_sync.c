@@ -0,0 +1,320 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Filtered mapping from a device hardware clock to the monotonic clock.
+ * @ingroup aux_math
+ */
+
+#include "math/m_mathinclude.h"
+#include "math/m_api.h"
+#include "math/m_clock_sync.h"
+
+#include "util/u_misc.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+
+/*!
+ * Residuals below this are never treated as outliers, keeps the rejection
+ * from eating into good data when the reduced samples are very clean.
+ */
+#define MIN_OUTLIER_NS (50.0 * 1000.0)
+
+//! Scale from median absolute deviation to a three sigma threshold.
+#define MAD_TO_THREE_SIGMA (3.0 * 1.4826)
+
+//! Observations this far off the current mapping are not used.
+#define RESET_THRESHOLD_NS (100 * U_TIME_1MS_IN_NS)
+
+/*!
+ * Observations that stay far off the mapping for this many in a row and for
+ * this long mean the device clock was reset, long enough to ride out a burst
+ * of late packets after a USB stall.
+ */
+#define RESET_MIN_COUNT 8
+#define RESET_MIN_DURATION_NS (500 * U_TIME_1MS_IN_NS)
+
+//! Real clocks are within a few hundred ppm, anything more is a bad fit.
+#define MAX_SKEW (1e-3)
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+struct fit
+{
+	double a;
+	double b;
+	double mean_x;
+	double sxx;
+	uint32_t n;
+};
+
+static bool
+fit_line(const double *xs, const double *ys, const bool *use, uint32_t count, struct fit *out)
+{
+	double sx = 0, sy = 0;
+	uint32_t n = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		if (!use[i]) {
+			continue;
+		}
+		sx += xs[i];
+		sy += ys[i];
+		n++;
+	}
+
+	if (n < 2) {
+		return false;
+	}
+
+	double mx = sx / n;
+	double my = sy / n;
+	double sxx = 0, sxy = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		if (!use[i]) {
+			continue;
+		}
+		double dx = xs[i] - mx;
+		sxx += dx * dx;
+		sxy += dx * (ys[i] - my);
+	}
+
+	if (sxx <= 0.0) {
+		return false;
+	}
+
+	double b = CLAMP(sxy / sxx, -MAX_SKEW, MAX_SKEW);
+
+	out->b = b;
+	out->a = my - b * mx;
+	out->mean_x = mx;
+	out->sxx = sxx;
+	out->n = n;
+
+	return true;
+}
+
+static int
+cmp_double(const void *a, const void *b)
+{
+	double da = *(const double *)a;
+	double db = *(const double *)b;
+	return (da > db) - (da < db);
+}
+
+static void
+reset(struct m_clock_sync *cs)
+{
+	time_duration_ns bucket_ns = cs->bucket_ns;
+	uint32_t min_samples = cs->min_samples;
+	uint64_t observations = cs->observations;
+	uint32_t resets = cs->resets;
+
+	U_ZERO(cs);
+
+	cs->bucket_ns = bucket_ns;
+	cs->min_samples = min_samples;
+	cs->observations = observations;
+	cs->resets = resets;
+}
+
+static void
+use_offset_only(struct m_clock_sync *cs, timepoint_ns hw, time_duration_ns offset)
+{
+	if (cs->count == 0 && !cs->bucket_valid) {
+		cs->ref_offset = offset;
+	} else if (offset < cs->ref_offset) {
+		cs->ref_offset = offset;
+	}
+
+	cs->ref_hw = hw;
+	cs->ref_offset_frac = 0.0;
+	cs->skew = 0.0;
+}
+
+static void
+refit(struct m_clock_sync *cs)
+{
+	double xs[M_CLOCK_SYNC_MAX_SAMPLES];
+	double ys[M_CLOCK_SYNC_MAX_SAMPLES];
+	double abs_res[M_CLOCK_SYNC_MAX_SAMPLES];
+	bool use[M_CLOCK_SYNC_MAX_SAMPLES];
+
+	uint32_t n = cs->count;
+	if (n < 2) {
+		return;
+	}
+
+	uint32_t newest = (cs->head + M_CLOCK_SYNC_MAX_SAMPLES - 1) % M_CLOCK_SYNC_MAX_SAMPLES;
+	struct m_clock_sync_sample ref = cs->samples[newest];
+
+	// Work relative to the newest sample so the doubles keep their precision.
+	for (uint32_t i = 0; i < n; i++) {
+		const struct m_clock_sync_sample *s = &cs->samples[i];
+		xs[i] = (double)(s->hw - ref.hw);
+		ys[i] = (double)(s->offset - ref.offset);
+		use[i] = true;
+	}
+
+	struct fit f;
+	if (!fit_line(xs, ys, use, n, &f)) {
+		return;
+	}
+
+	// Reject samples far outside the median absolute residual.
+	for (uint32_t i = 0; i < n; i++) {
+		abs_res[i] = fabs(ys[i] - (f.a + f.b * xs[i]));
+	}
+	double sorted[M_CLOCK_SYNC_MAX_SAMPLES];
+	memcpy(sorted, abs_res, sizeof(double) * n);
+	qsort(sorted, n, sizeof(double), cmp_double);
+
+	double threshold = fmax(sorted[n / 2] * MAD_TO_THREE_SIGMA, MIN_OUTLIER_NS);
+	uint32_t outliers = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		use[i] = abs_res[i] <= threshold;
+		outliers += use[i] ? 0 : 1;
+	}
+
+	struct fit inlier_fit;
+	if (outliers > 0 && fit_line(xs, ys, use, n, &inlier_fit)) {
+		f = inlier_fit;
+	} else {
+		outliers = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			use[i] = true;
+		}
+	}
+
+	double sum_sq = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		if (!use[i]) {
+			continue;
+		}
+		double r = ys[i] - (f.a + f.b * xs[i]);
+		sum_sq += r * r;
+	}
+
+	double a_whole = floor(f.a);
+
+	cs->ref_hw = ref.hw;
+	cs->ref_offset = ref.offset + (time_duration_ns)a_whole;
+	cs->ref_offset_frac = f.a - a_whole;
+	cs->skew = f.b;
+	cs->sigma_ns = f.n > 2 ? sqrt(sum_sq / (f.n - 2)) : 0.0;
+	cs->mean_x_ns = f.mean_x;
+	cs->sxx = f.sxx;
+	cs->inliers = f.n;
+	cs->outliers = outliers;
+	cs->ready = true;
+}
+
+static void
+push_bucket(struct m_clock_sync *cs)
+{
+	cs->samples[cs->head] = cs->bucket;
+	cs->head = (cs->head + 1) % M_CLOCK_SYNC_MAX_SAMPLES;
+	if (cs->count < M_CLOCK_SYNC_MAX_SAMPLES) {
+		cs->count++;
+	}
+	cs->bucket_valid = false;
+
+	if (cs->count >= cs->min_samples) {
+		refit(cs);
+	}
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+void
+m_clock_sync_init(struct m_clock_sync *cs, time_duration_ns bucket_ns)
+{
+	U_ZERO(cs);
+
+	cs->bucket_ns = bucket_ns > 0 ? bucket_ns : M_CLOCK_SYNC_DEFAULT_BUCKET_NS;
+	cs->min_samples = M_CLOCK_SYNC_DEFAULT_MIN_SAMPLES;
+}
+
+timepoint_ns
+m_clock_sync_update(struct m_clock_sync *cs, timepoint_ns hw, timepoint_ns mono)
+{
+	time_duration_ns offset = mono - hw;
+
+	if (cs->observations > 0) {
+		bool went_back = hw < cs->last_hw;
+		bool far_off = cs->ready && llabs(mono - m_clock_sync_hw2mono(cs, hw)) > RESET_THRESHOLD_NS;
+
+		if (!far_off) {
+			cs->far_off_count = 0;
+		} else if (cs->far_off_count++ == 0) {
+			cs->far_off_start_hw = hw;
+		}
+
+		bool jumped =
+		    cs->far_off_count >= RESET_MIN_COUNT && hw - cs->far_off_start_hw >= RESET_MIN_DURATION_NS;
+
+		if (went_back || jumped) {
+			reset(cs);
+			cs->resets++;
+		} else if (far_off) {
+			// Leave it out of the buckets, like any other outlier.
+			cs->observations++;
+			cs->last_hw = hw;
+			return m_clock_sync_hw2mono(cs, hw);
+		}
+	}
+
+	cs->observations++;
+	cs->last_hw = hw;
+
+	if (!cs->ready) {
+		use_offset_only(cs, hw, offset);
+	}
+
+	if (cs->bucket_valid && hw - cs->bucket_start_hw >= cs->bucket_ns) {
+		push_bucket(cs);
+	}
+
+	if (!cs->bucket_valid) {
+		cs->bucket.hw = hw;
+		cs->bucket.offset = offset;
+		cs->bucket_start_hw = hw;
+		cs->bucket_valid = true;
+	} else if (offset < cs->bucket.offset) {
+		cs->bucket.hw = hw;
+		cs->bucket.offset = offset;
+	}
+
+	return m_clock_sync_hw2mono(cs, hw);
+}
+
+timepoint_ns
+m_clock_sync_hw2mono(const struct m_clock_sync *cs, timepoint_ns hw)
+{
+	double dx = (double)(hw - cs->ref_hw);
+	double frac = cs->ref_offset_frac + cs->skew * dx;
+
+	return hw + cs->ref_offset + (time_duration_ns)llround(frac);
+}
+
+double
+m_clock_sync_get_error(const struct m_clock_sync *cs, timepoint_ns hw)
+{
+	if (!cs->ready || cs->inliers == 0) {
+		return -1.0;
+	}
+
+	double dx = (double)(hw - cs->ref_hw) - cs->mean_x_ns;
+	return cs->sigma_ns * sqrt(1.0 / cs->inliers + dx * dx / cs->sxx);
+}
@@ -0,0 +1,166 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Filtered mapping from a device hardware clock to the monotonic clock.
+ * @ingroup aux_math
+ */
+
+#pragma once
+
+#include "xrt/xrt_compiler.h"
+#include "util/u_time.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//! Number of reduced samples kept in the regression window.
+#define M_CLOCK_SYNC_MAX_SAMPLES 128
+
+//! Default length of the interval reduced to its least delayed observation.
+#define M_CLOCK_SYNC_DEFAULT_BUCKET_NS (20 * U_TIME_1MS_IN_NS)
+
+//! Default number of reduced samples needed before the mapping is ready.
+#define M_CLOCK_SYNC_DEFAULT_MIN_SAMPLES 16
+
+/*!
+ * One reduced observation, the hardware timestamp and the offset to the
+ * other clock at that time.
+ *
+ * @ingroup aux_math
+ */
+struct m_clock_sync_sample
+{
+	timepoint_ns hw;
+	time_duration_ns offset;
+};
+
+/*!
+ * Estimates the mapping from a hardware clock to the monotonic clock (or any
+ * other host clock) as an offset plus a skew.
+ *
+ * Observations are pairs of a device timestamp and the host time it was
+ * received at. The host time is always late by a variable transport delay, so
+ * each @ref bucket_ns interval is reduced to its least delayed observation.
+ * A linear regression is then run over the last @ref M_CLOCK_SYNC_MAX_SAMPLES
+ * reduced samples, samples with a residual far outside the median absolute
+ * residual are rejected and the fit is redone on the inliers.
+ *
+ * Not thread safe, callers that update and read from different threads need
+ * to hold their own lock.
+ *
+ * @ingroup aux_math
+ */
+struct m_clock_sync
+{
+	//! Length of the interval reduced to its least delayed observation.
+	time_duration_ns bucket_ns;
+
+	//! Number of reduced samples needed before the mapping is ready.
+	uint32_t min_samples;
+
+	//! Ring buffer of reduced samples.
+	struct m_clock_sync_sample samples[M_CLOCK_SYNC_MAX_SAMPLES];
+	uint32_t head;
+	uint32_t count;
+
+	//! Least delayed observation of the bucket being filled.
+	struct m_clock_sync_sample bucket;
+	timepoint_ns bucket_start_hw;
+	bool bucket_valid;
+
+	//! Last hardware timestamp seen, used to detect clock resets.
+	timepoint_ns last_hw;
+
+	//! Run of observations far off the mapping and where it started.
+	uint32_t far_off_count;
+	timepoint_ns far_off_start_hw;
+
+	//! Hardware timestamp the estimate is anchored at.
+	timepoint_ns ref_hw;
+
+	//! Offset at @ref ref_hw, integer part and sub-nanosecond fraction.
+	time_duration_ns ref_offset;
+	double ref_offset_frac;
+
+	//! Estimated clock skew, host nanoseconds gained per hardware nanosecond.
+	double skew;
+
+	//! Standard deviation of the inlier residuals.
+	double sigma_ns;
+
+	//! Mean and spread of the inlier hardware timestamps relative to @ref ref_hw.
+	double mean_x_ns;
+	double sxx;
+	uint32_t inliers;
+
+	//! Has enough data been seen for the full regression to be used.
+	bool ready;
+
+	//! Statistics, @ref outliers is for the last fit only.
+	uint64_t observations;
+	uint32_t outliers;
+	uint32_t resets;
+};
+
+/*!
+ * Initialise or reset the filter.
+ *
+ * @param cs The clock sync state.
+ * @param bucket_ns Interval reduced to one sample, 0 for the default. A few
+ *                  times the expected update interval works well.
+ *
+ * @public @memberof m_clock_sync
+ */
+void
+m_clock_sync_init(struct m_clock_sync *cs, time_duration_ns bucket_ns);
+
+/*!
+ * Add a new observation and return @p hw mapped to the host clock.
+ *
+ * @param cs The clock sync state.
+ * @param hw Timestamp in the hardware clock of the event.
+ * @param mono Timestamp in the host clock the event was observed at.
+ * @return @p hw in the host clock.
+ *
+ * @public @memberof m_clock_sync
+ */
+timepoint_ns
+m_clock_sync_update(struct m_clock_sync *cs, timepoint_ns hw, timepoint_ns mono);
+
+/*!
+ * Map a hardware timestamp to the host clock using the current estimate.
+ * Before any observation has been made this returns @p hw unchanged.
+ *
+ * @public @memberof m_clock_sync
+ */
+timepoint_ns
+m_clock_sync_hw2mono(const struct m_clock_sync *cs, timepoint_ns hw);
+
+/*!
+ * Standard error of the fitted mapping at @p hw in nanoseconds, returns a
+ * negative value if the mapping is not ready yet. The constant part of the
+ * transport delay can not be observed and is not included.
+ *
+ * @public @memberof m_clock_sync
+ */
+double
+m_clock_sync_get_error(const struct m_clock_sync *cs, timepoint_ns hw);
+
+/*!
+ * Has the filter seen enough data for the mapping to be trusted.
+ *
+ * @public @memberof m_clock_sync
+ */
+static inline bool
+m_clock_sync_is_ready(const struct m_clock_sync *cs)
+{
+	return cs->ready;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,379 @@
+// Copyright 2020, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  A fifo that also lets you dynamically filter.
+ * @author Jakob Bornecrantz <jakob@collabora.com>
+ * @ingroup aux_math
+ */
+
+#include "math/m_filter_fifo.h"
+
+#include <assert.h>
+#include <atomic>
+#include <vector>
+
+
+/*
+ * This code is in C++ and not C because MSVC doesn't implement C atomics yet,
+ * they let one thread push while others read without a lock. Readers check
+ * that the producer didn't get around to the slots they read, like a seqlock.
+ */
+
+namespace {
+
+/*!
+ * Extra slots past the ones that are read, the producer can push this many
+ * samples while a read is in progress before the read has to be redone.
+ */
+constexpr uint64_t kGuardSlots = 64;
+
+//! Running sum of vec3 samples, in double precision.
+struct SumVec3
+{
+	double x = 0;
+	double y = 0;
+	double z = 0;
+};
+
+inline SumVec3
+sum_add(const SumVec3 &sum, const xrt_vec3 &v)
+{
+	return {sum.x + v.x, sum.y + v.y, sum.z + v.z};
+}
+
+inline SumVec3
+sum_window(const SumVec3 &newest, const SumVec3 &oldest, const xrt_vec3 &oldest_sample)
+{
+	return {newest.x - oldest.x + oldest_sample.x, //
+	        newest.y - oldest.y + oldest_sample.y, //
+	        newest.z - oldest.z + oldest_sample.z};
+}
+
+inline xrt_vec3
+sum_average(const SumVec3 &sum, size_t count)
+{
+	return {(float)(sum.x / count), (float)(sum.y / count), (float)(sum.z / count)};
+}
+
+inline double
+sum_add(double sum, double v)
+{
+	return sum + v;
+}
+
+inline double
+sum_window(double newest, double oldest, double oldest_sample)
+{
+	return newest - oldest + oldest_sample;
+}
+
+inline double
+sum_average(double sum, size_t count)
+{
+	return sum / count;
+}
+
+/*!
+ * Ring of samples with their timestamps and the running sum of all samples
+ * up to and including each, so the sum over any window is one subtraction.
+ * The timestamps are monotonic so the window is found with a binary search.
+ *
+ * Sequence numbers count every sample ever pushed, starting with the
+ * @ref num zero samples at timepoint zero it is created with. Index zero, as
+ * in the C API, is the newest sample.
+ */
+template <typename T, typename Sum> struct FilterFifo
+{
+	struct Slot
+	{
+		T sample;
+		uint64_t timestamp_ns;
+		Sum through;
+	};
+
+	//! Number of samples visible to readers.
+	size_t num;
+
+	std::vector<Slot> slots;
+
+	//! Sequence number of the next sample, written by the producer.
+	std::atomic<uint64_t> next_seq;
+
+	//! Only touched by the producer.
+	Sum total{};
+
+	//! Slot of the next sample, saves the producer a division per push.
+	size_t write_index = 0;
+
+
+	explicit FilterFifo(size_t num_) : num(num_), slots(num_ + kGuardSlots), next_seq(num_ + kGuardSlots) {}
+
+	const Slot &
+	at(uint64_t newest_seq, size_t index) const
+	{
+		return slots[(newest_seq - index) % slots.size()];
+	}
+
+	bool
+	push(const T &sample, uint64_t timestamp_ns)
+	{
+		uint64_t seq = next_seq.load(std::memory_order_relaxed);
+		assert(write_index == seq % slots.size());
+
+		// The binary searches need the samples in time order, drop late ones.
+		size_t newest_index = write_index == 0 ? slots.size() - 1 : write_index - 1;
+		if (timestamp_ns < slots[newest_index].timestamp_ns) {
+			return false;
+		}
+
+		Slot &slot = slots[write_index];
+
+		total = sum_add(total, sample);
+		slot.sample = sample;
+		slot.timestamp_ns = timestamp_ns;
+		slot.through = total;
+
+		write_index = write_index + 1 == slots.size() ? 0 : write_index + 1;
+		next_seq.store(seq + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/*!
+	 * Runs @p fn against a snapshot of the newest sequence number, again if
+	 * the producer could have overwritten anything read in the meantime.
+	 */
+	template <typename F>
+	void
+	read(F &&fn) const
+	{
+		while (true) {
+			uint64_t seq = next_seq.load(std::memory_order_acquire);
+			fn(seq - 1);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (next_seq.load(std::memory_order_relaxed) - seq < kGuardSlots) {
+				return;
+			}
+		}
+	}
+
+	//! First index with a timestamp not newer than @p timestamp_ns, num if none.
+	size_t
+	first_not_after(uint64_t newest_seq, uint64_t timestamp_ns) const
+	{
+		size_t lo = 0;
+		size_t hi = num;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (at(newest_seq, mid).timestamp_ns > timestamp_ns) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	//! First index with a timestamp older than @p timestamp_ns, num if none.
+	size_t
+	first_before(uint64_t newest_seq, uint64_t timestamp_ns) const
+	{
+		size_t lo = 0;
+		size_t hi = num;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (at(newest_seq, mid).timestamp_ns >= timestamp_ns) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	bool
+	get(size_t index, T *out_sample, uint64_t *out_timestamp_ns) const
+	{
+		if (index >= num) {
+			return false;
+		}
+
+		read([&](uint64_t newest_seq) {
+			const Slot &slot = at(newest_seq, index);
+			*out_sample = slot.sample;
+			*out_timestamp_ns = slot.timestamp_ns;
+		});
+
+		return true;
+	}
+
+	bool
+	get_first_after(uint64_t timestamp_ns, size_t *out_index) const
+	{
+		size_t index = 0;
+		read([&](uint64_t newest_seq) { index = first_not_after(newest_seq, timestamp_ns); });
+
+		// Either every sample is newer, or the newest isn't.
+		if (index == 0) {
+			return false;
+		}
+
+		*out_index = index - 1;
+		return true;
+	}
+
+	size_t
+	filter(uint64_t start_ns, uint64_t stop_ns, T *out_average) const
+	{
+		// Error, skip averaging.
+		if (start_ns > stop_ns) {
+			*out_average = T{};
+			return 0;
+		}
+
+		size_t count = 0;
+		Sum sum{};
+		read([&](uint64_t newest_seq) {
+			size_t newest = first_not_after(newest_seq, stop_ns);
+			size_t end = first_before(newest_seq, start_ns);
+
+			count = end > newest ? end - newest : 0;
+			if (count == 0) {
+				return;
+			}
+
+			const Slot &first = at(newest_seq, newest);
+			const Slot &last = at(newest_seq, end - 1);
+			sum = sum_window(first.through, last.through, last.sample);
+		});
+
+		// Avoid division by zero.
+		*out_average = count > 0 ? sum_average(sum, count) : T{};
+
+		return count;
+	}
+};
+
+} // namespace
+
+
+/*
+ *
+ * Filter fifo vec3_f32.
+ *
+ */
+
+struct m_ff_vec3_f32 : FilterFifo<xrt_vec3, SumVec3>
+{
+	using FilterFifo::FilterFifo;
+};
+
+extern "C" void
+m_ff_vec3_f32_alloc(struct m_ff_vec3_f32 **ff_out, size_t num)
+{
+	*ff_out = new m_ff_vec3_f32(num);
+}
+
+extern "C" void
+m_ff_vec3_f32_free(struct m_ff_vec3_f32 **ff_ptr)
+{
+	struct m_ff_vec3_f32 *ff = *ff_ptr;
+	if (ff == NULL) {
+		return;
+	}
+
+	delete ff;
+	*ff_ptr = NULL;
+}
+
+extern "C" size_t
+m_ff_vec3_f32_get_num(struct m_ff_vec3_f32 *ff)
+{
+	return ff->num;
+}
+
+extern "C" bool
+m_ff_vec3_f32_push(struct m_ff_vec3_f32 *ff, const struct xrt_vec3 *sample, uint64_t timestamp_ns)
+{
+	return ff->push(*sample, timestamp_ns);
+}
+
+extern "C" bool
+m_ff_vec3_f32_get(struct m_ff_vec3_f32 *ff, size_t num, struct xrt_vec3 *out_sample, uint64_t *out_timestamp_ns)
+{
+	return ff->get(num, out_sample, out_timestamp_ns);
+}
+
+extern "C" bool
+m_ff_vec3_f32_get_first_after(struct m_ff_vec3_f32 *ff, uint64_t timestamp_ns, size_t *out_num)
+{
+	return ff->get_first_after(timestamp_ns, out_num);
+}
+
+extern "C" size_t
+m_ff_vec3_f32_filter(struct m_ff_vec3_f32 *ff, uint64_t start_ns, uint64_t stop_ns, struct xrt_vec3 *out_average)
+{
+	return ff->filter(start_ns, stop_ns, out_average);
+}
+
+
+/*
+ *
+ * Filter fifo f64.
+ *
+ */
+
+struct m_ff_f64 : FilterFifo<double, double>
+{
+	using FilterFifo::FilterFifo;
+};
+
+extern "C" void
+m_ff_f64_alloc(struct m_ff_f64 **ff_out, size_t num)
+{
+	*ff_out = new m_ff_f64(num);
+}
+
+extern "C" void
+m_ff_f64_free(struct m_ff_f64 **ff_ptr)
+{
+	struct m_ff_f64 *ff = *ff_ptr;
+	if (ff == NULL) {
+		return;
+	}
+
+	delete ff;
+	*ff_ptr = NULL;
+}
+
+extern "C" size_t
+m_ff_f64_get_num(struct m_ff_f64 *ff)
+{
+	return ff->num;
+}
+
+extern "C" bool
+m_ff_f64_push(struct m_ff_f64 *ff, const double *sample, uint64_t timestamp_ns)
+{
+	return ff->push(*sample, timestamp_ns);
+}
+
+extern "C" bool
+m_ff_f64_get(struct m_ff_f64 *ff, size_t num, double *out_sample, uint64_t *out_timestamp_ns)
+{
+	return ff->get(num, out_sample, out_timestamp_ns);
+}
+
+extern "C" bool
+m_ff_f64_get_first_after(struct m_ff_f64 *ff, uint64_t timestamp_ns, size_t *out_num)
+{
+	return ff->get_first_after(timestamp_ns, out_num);
+}
+
+extern "C" size_t
+m_ff_f64_filter(struct m_ff_f64 *ff, uint64_t start_ns, uint64_t stop_ns, double *out_average)
+{
+	return ff->filter(start_ns, stop_ns, out_average);
+}
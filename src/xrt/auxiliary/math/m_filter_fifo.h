@@ -16,6 +16,14 @@ extern "C" {
 #endif
 
 
+/*
+ * The fifos keep a running sum and find samples by timestamp with a binary
+ * search, so filtering is O(log n) no matter how wide the window is.
+ *
+ * One thread may push samples while other threads get or filter them without
+ * any locking, more than one thread pushing needs a lock.
+ */
+
 struct m_ff_f64;
 struct m_ff_vec3_f32;
 
@@ -39,10 +47,12 @@ size_t
 m_ff_vec3_f32_get_num(struct m_ff_vec3_f32 *ff);
 
 /*!
- * Pushes a sample at the given timepoint, pushing samples out of order yields
- * unspecified behaviour, so samples must be pushed in time order.
+ * Pushes a sample at the given timepoint, a sample older than the newest one
+ * already pushed is dropped.
+ *
+ * @return false if the sample was dropped.
  */
-void
+bool
 m_ff_vec3_f32_push(struct m_ff_vec3_f32 *ff, const struct xrt_vec3 *sample, uint64_t timestamp_ns);
 
 /*!
@@ -52,6 +62,13 @@ m_ff_vec3_f32_push(struct m_ff_vec3_f32 *ff, const struct xrt_vec3 *sample, uint
 bool
 m_ff_vec3_f32_get(struct m_ff_vec3_f32 *ff, size_t num, struct xrt_vec3 *out_sample, uint64_t *out_timestamp_ns);
 
+/*!
+ * Finds the oldest sample newer than @p timestamp_ns, @p out_num is its index
+ * as used by @ref m_ff_vec3_f32_get. Returns false if there is none.
+ */
+bool
+m_ff_vec3_f32_get_first_after(struct m_ff_vec3_f32 *ff, uint64_t timestamp_ns, size_t *out_num);
+
 /*!
  * Averages all samples in the fifo between the two timepoints, returns number
  * of samples sampled, if no samples was found between the timpoints returns 0
@@ -87,10 +104,12 @@ size_t
 m_ff_f64_get_num(struct m_ff_f64 *ff);
 
 /*!
- * Pushes a sample at the given timepoint, pushing samples out of order yields
- * unspecified behaviour, so samples must be pushed in time order.
+ * Pushes a sample at the given timepoint, a sample older than the newest one
+ * already pushed is dropped.
+ *
+ * @return false if the sample was dropped.
  */
-void
+bool
 m_ff_f64_push(struct m_ff_f64 *ff, const double *sample, uint64_t timestamp_ns);
 
 /*!
@@ -99,6 +118,13 @@ m_ff_f64_push(struct m_ff_f64 *ff, const double *sample, uint64_t timestamp_ns);
 bool
 m_ff_f64_get(struct m_ff_f64 *ff, size_t num, double *out_sample, uint64_t *out_timestamp_ns);
 
+/*!
+ * Finds the oldest sample newer than @p timestamp_ns, @p out_num is its index
+ * as used by @ref m_ff_f64_get. Returns false if there is none.
+ */
+bool
+m_ff_f64_get_first_after(struct m_ff_f64 *ff, uint64_t timestamp_ns, size_t *out_num);
+
 /*!
  * Averages all samples in the fifo between the two timepoints, returns number
  * of samples sampled, if no samples was found between the timpoints returns 0
@@ -154,10 +180,10 @@ public:
 	 *
 	 * Wrapper for @ref m_ff_vec3_f32_push.
 	 */
-	inline void
+	inline bool
 	push(const xrt_vec3 &sample, uint64_t timestamp_ns)
 	{
-		m_ff_vec3_f32_push(mFifoPtr, &sample, timestamp_ns);
+		return m_ff_vec3_f32_push(mFifoPtr, &sample, timestamp_ns);
 	}
 
 	/*!
@@ -171,6 +197,17 @@ public:
 		return m_ff_vec3_f32_get(mFifoPtr, num, out_sample, out_timestamp_ns);
 	}
 
+	/*!
+	 * @copydoc m_ff_vec3_f32_get_first_after
+	 *
+	 * Wrapper for @ref m_ff_vec3_f32_get_first_after.
+	 */
+	inline bool
+	get_first_after(uint64_t timestamp_ns, size_t *out_num)
+	{
+		return m_ff_vec3_f32_get_first_after(mFifoPtr, timestamp_ns, out_num);
+	}
+
 	/*!
 	 * @copydoc m_ff_vec3_f32_filter
 	 *
@@ -0,0 +1,445 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  History of hand joint sets, for getting the joints of a tracked
+ *         hand at any time near the newest sample.
+ * @ingroup aux_math
+ */
+
+#include "math/m_hand_joint_history.h"
+#include "math/m_batch.h"
+
+#include "os/os_threading.h"
+
+#include "util/u_misc.h"
+#include "util/u_simd.h"
+
+#include <assert.h>
+#include <string.h>
+
+
+/*!
+ * The joints and the hand pose, which is interpolated the same way.
+ */
+#define JOINT_COUNT (XRT_HAND_JOINT_COUNT + 1)
+#define HAND_POSE_INDEX (XRT_HAND_JOINT_COUNT)
+
+//! Joints padded to whole SIMD registers, the padding is kept at zero.
+#define PADDED_JOINT_COUNT (32)
+
+static_assert(PADDED_JOINT_COUNT >= JOINT_COUNT, "Padding too small");
+static_assert(PADDED_JOINT_COUNT % U_SIMD_LANES == 0, "Padding not a whole number of registers");
+
+enum field
+{
+	F_POSITION_X,
+	F_POSITION_Y,
+	F_POSITION_Z,
+	F_ORIENTATION_X,
+	F_ORIENTATION_Y,
+	F_ORIENTATION_Z,
+	F_ORIENTATION_W,
+	F_LINEAR_VELOCITY_X,
+	F_LINEAR_VELOCITY_Y,
+	F_LINEAR_VELOCITY_Z,
+	F_ANGULAR_VELOCITY_X,
+	F_ANGULAR_VELOCITY_Y,
+	F_ANGULAR_VELOCITY_Z,
+	F_RADIUS,
+	FIELD_COUNT,
+};
+
+struct entry
+{
+	//! Every float of every joint, one array per field.
+	float fields[FIELD_COUNT][PADDED_JOINT_COUNT];
+
+	enum xrt_space_relation_flags flags[JOINT_COUNT];
+
+	uint64_t timestamp_ns;
+	bool is_active;
+};
+
+struct m_hand_joint_history
+{
+	struct os_mutex mutex;
+
+	uint64_t max_prediction_ns;
+
+	//! Index of the oldest entry.
+	uint32_t start;
+	uint32_t size;
+	uint32_t capacity;
+
+	struct entry entries[];
+};
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static inline void
+lock(const struct m_hand_joint_history *hjh)
+{
+	os_mutex_lock((struct os_mutex *)&hjh->mutex);
+}
+
+static inline void
+unlock(const struct m_hand_joint_history *hjh)
+{
+	os_mutex_unlock((struct os_mutex *)&hjh->mutex);
+}
+
+//! The @p i th oldest entry.
+static inline const struct entry *
+entry_at(const struct m_hand_joint_history *hjh, uint32_t i)
+{
+	uint32_t index = hjh->start + i;
+	if (index >= hjh->capacity) {
+		index -= hjh->capacity;
+	}
+	return &hjh->entries[index];
+}
+
+static inline const struct xrt_space_relation *
+relation_of(const struct xrt_hand_joint_set *set, uint32_t joint)
+{
+	if (joint == HAND_POSE_INDEX) {
+		return &set->hand_pose;
+	}
+	return &set->values.hand_joint_set_default[joint].relation;
+}
+
+static inline struct xrt_space_relation *
+relation_of_out(struct xrt_hand_joint_set *set, uint32_t joint)
+{
+	if (joint == HAND_POSE_INDEX) {
+		return &set->hand_pose;
+	}
+	return &set->values.hand_joint_set_default[joint].relation;
+}
+
+/*!
+ * Fills @p e from @p set, orientations are flipped to the same hemisphere as
+ * in @p prev so that interpolating between the two never goes the long way.
+ */
+static void
+pack(struct entry *e, const struct xrt_hand_joint_set *set, uint64_t timestamp_ns, const struct entry *prev)
+{
+	float(*f)[PADDED_JOINT_COUNT] = e->fields;
+
+	for (uint32_t j = 0; j < JOINT_COUNT; j++) {
+		const struct xrt_space_relation *rel = relation_of(set, j);
+		struct xrt_quat q = rel->pose.orientation;
+
+		if (prev != NULL) {
+			const float(*p)[PADDED_JOINT_COUNT] = prev->fields;
+			float dot = q.x * p[F_ORIENTATION_X][j] + q.y * p[F_ORIENTATION_Y][j] +
+			            q.z * p[F_ORIENTATION_Z][j] + q.w * p[F_ORIENTATION_W][j];
+			if (dot < 0.0f) {
+				q = (struct xrt_quat){-q.x, -q.y, -q.z, -q.w};
+			}
+		}
+
+		f[F_POSITION_X][j] = rel->pose.position.x;
+		f[F_POSITION_Y][j] = rel->pose.position.y;
+		f[F_POSITION_Z][j] = rel->pose.position.z;
+		f[F_ORIENTATION_X][j] = q.x;
+		f[F_ORIENTATION_Y][j] = q.y;
+		f[F_ORIENTATION_Z][j] = q.z;
+		f[F_ORIENTATION_W][j] = q.w;
+		f[F_LINEAR_VELOCITY_X][j] = rel->linear_velocity.x;
+		f[F_LINEAR_VELOCITY_Y][j] = rel->linear_velocity.y;
+		f[F_LINEAR_VELOCITY_Z][j] = rel->linear_velocity.z;
+		f[F_ANGULAR_VELOCITY_X][j] = rel->angular_velocity.x;
+		f[F_ANGULAR_VELOCITY_Y][j] = rel->angular_velocity.y;
+		f[F_ANGULAR_VELOCITY_Z][j] = rel->angular_velocity.z;
+		f[F_RADIUS][j] = j == HAND_POSE_INDEX ? 0.0f : set->values.hand_joint_set_default[j].radius;
+
+		e->flags[j] = rel->relation_flags;
+	}
+
+	e->timestamp_ns = timestamp_ns;
+	e->is_active = set->is_active;
+}
+
+static void
+unpack(const struct entry *e, struct xrt_hand_joint_set *out_set)
+{
+	const float(*f)[PADDED_JOINT_COUNT] = e->fields;
+
+	for (uint32_t j = 0; j < JOINT_COUNT; j++) {
+		struct xrt_space_relation *rel = relation_of_out(out_set, j);
+
+		rel->relation_flags = e->flags[j];
+		rel->pose.position.x = f[F_POSITION_X][j];
+		rel->pose.position.y = f[F_POSITION_Y][j];
+		rel->pose.position.z = f[F_POSITION_Z][j];
+		rel->pose.orientation.x = f[F_ORIENTATION_X][j];
+		rel->pose.orientation.y = f[F_ORIENTATION_Y][j];
+		rel->pose.orientation.z = f[F_ORIENTATION_Z][j];
+		rel->pose.orientation.w = f[F_ORIENTATION_W][j];
+		rel->linear_velocity.x = f[F_LINEAR_VELOCITY_X][j];
+		rel->linear_velocity.y = f[F_LINEAR_VELOCITY_Y][j];
+		rel->linear_velocity.z = f[F_LINEAR_VELOCITY_Z][j];
+		rel->angular_velocity.x = f[F_ANGULAR_VELOCITY_X][j];
+		rel->angular_velocity.y = f[F_ANGULAR_VELOCITY_Y][j];
+		rel->angular_velocity.z = f[F_ANGULAR_VELOCITY_Z][j];
+
+		if (j != HAND_POSE_INDEX) {
+			out_set->values.hand_joint_set_default[j].radius = f[F_RADIUS][j];
+		}
+	}
+
+	out_set->is_active = e->is_active;
+}
+
+/*!
+ * `a + (b - a) * t` for every field of every joint, @p t past one
+ * extrapolates. Only the flags valid in both entries are kept.
+ */
+static void
+blend(const struct entry *a, const struct entry *b, float t, struct xrt_hand_joint_set *out_set)
+{
+	struct entry out;
+
+	const float *pa = &a->fields[0][0];
+	const float *pb = &b->fields[0][0];
+	float *po = &out.fields[0][0];
+
+	u_vf vt = u_vf_set(t);
+	for (uint32_t i = 0; i < FIELD_COUNT * PADDED_JOINT_COUNT; i += U_SIMD_LANES) {
+		u_vf va = u_vf_load(pa + i);
+		u_vf vb = u_vf_load(pb + i);
+		u_vf_store(po + i, u_vf_add(va, u_vf_mul(u_vf_sub(vb, va), vt)));
+	}
+
+	struct m_quat_soa orientations = {
+	    .x = out.fields[F_ORIENTATION_X],
+	    .y = out.fields[F_ORIENTATION_Y],
+	    .z = out.fields[F_ORIENTATION_Z],
+	    .w = out.fields[F_ORIENTATION_W],
+	};
+	m_batch_quat_normalize(&orientations, PADDED_JOINT_COUNT);
+
+	for (uint32_t j = 0; j < JOINT_COUNT; j++) {
+		out.flags[j] = a->flags[j] & b->flags[j];
+	}
+	out.is_active = true;
+
+	unpack(&out, out_set);
+}
+
+//! Number of entries with a timestamp before @p timestamp_ns.
+static uint32_t
+lower_bound(const struct m_hand_joint_history *hjh, uint64_t timestamp_ns)
+{
+	uint32_t lo = 0;
+	uint32_t hi = hjh->size;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (entry_at(hjh, mid)->timestamp_ns < timestamp_ns) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static enum m_relation_history_result
+get_locked(const struct m_hand_joint_history *hjh, uint64_t at_timestamp_ns, struct xrt_hand_joint_set *out_set)
+{
+	if (hjh->size == 0 || at_timestamp_ns == 0) {
+		U_ZERO(out_set);
+		return M_RELATION_HISTORY_RESULT_INVALID;
+	}
+
+	uint32_t it = lower_bound(hjh, at_timestamp_ns);
+
+	if (it == hjh->size) {
+		// The desired timestamp is after what our buffer contains.
+		const struct entry *newest = entry_at(hjh, hjh->size - 1);
+		const struct entry *prev = hjh->size > 1 ? entry_at(hjh, hjh->size - 2) : NULL;
+
+		if (prev == NULL || !prev->is_active || !newest->is_active) {
+			unpack(newest, out_set);
+			return M_RELATION_HISTORY_RESULT_PREDICTED;
+		}
+
+		uint64_t ahead_ns = at_timestamp_ns - newest->timestamp_ns;
+		if (ahead_ns > hjh->max_prediction_ns) {
+			ahead_ns = hjh->max_prediction_ns;
+		}
+
+		uint64_t gap_ns = newest->timestamp_ns - prev->timestamp_ns;
+		float t = 1.0f + (float)((double)ahead_ns / (double)gap_ns);
+		blend(prev, newest, t, out_set);
+
+		return M_RELATION_HISTORY_RESULT_PREDICTED;
+	}
+
+	const struct entry *after = entry_at(hjh, it);
+
+	if (after->timestamp_ns == at_timestamp_ns) {
+		unpack(after, out_set);
+		return M_RELATION_HISTORY_RESULT_EXACT;
+	}
+
+	if (it == 0) {
+		// The desired timestamp is before what our buffer contains.
+		unpack(after, out_set);
+		return M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED;
+	}
+
+	const struct entry *before = entry_at(hjh, it - 1);
+	uint64_t gap_ns = after->timestamp_ns - before->timestamp_ns;
+	uint64_t since_ns = at_timestamp_ns - before->timestamp_ns;
+
+	if (!before->is_active || !after->is_active) {
+		// Don't blend with a hand that isn't there, take the nearest.
+		unpack(since_ns * 2 < gap_ns ? before : after, out_set);
+	} else {
+		blend(before, after, (float)((double)since_ns / (double)gap_ns), out_set);
+	}
+
+	return M_RELATION_HISTORY_RESULT_INTERPOLATED;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+void
+m_hand_joint_history_create(struct m_hand_joint_history **out_hjh)
+{
+	m_hand_joint_history_create_with_capacity(out_hjh, M_HAND_JOINT_HISTORY_DEFAULT_CAPACITY);
+}
+
+void
+m_hand_joint_history_create_with_capacity(struct m_hand_joint_history **out_hjh, uint32_t capacity)
+{
+	assert(capacity > 0);
+
+	size_t size = sizeof(struct m_hand_joint_history) + sizeof(struct entry) * capacity;
+	struct m_hand_joint_history *hjh = U_CALLOC_WITH_CAST(struct m_hand_joint_history, size);
+
+	hjh->capacity = capacity;
+	hjh->max_prediction_ns = M_HAND_JOINT_HISTORY_DEFAULT_MAX_PREDICTION_NS;
+
+	// In reality never fails.
+	os_mutex_init(&hjh->mutex);
+
+	*out_hjh = hjh;
+}
+
+void
+m_hand_joint_history_set_max_prediction(struct m_hand_joint_history *hjh, uint64_t max_prediction_ns)
+{
+	lock(hjh);
+	hjh->max_prediction_ns = max_prediction_ns;
+	unlock(hjh);
+}
+
+bool
+m_hand_joint_history_push(struct m_hand_joint_history *hjh,
+                          const struct xrt_hand_joint_set *joint_set,
+                          uint64_t timestamp_ns)
+{
+	lock(hjh);
+
+	const struct entry *newest = hjh->size > 0 ? entry_at(hjh, hjh->size - 1) : NULL;
+
+	// Everything explodes if the timestamps aren't monotonically increasing.
+	if (newest != NULL && timestamp_ns <= newest->timestamp_ns) {
+		unlock(hjh);
+		return false;
+	}
+
+	uint32_t index;
+	if (hjh->size < hjh->capacity) {
+		index = (hjh->start + hjh->size) % hjh->capacity;
+		hjh->size++;
+	} else {
+		index = hjh->start;
+		hjh->start = (hjh->start + 1) % hjh->capacity;
+	}
+
+	pack(&hjh->entries[index], joint_set, timestamp_ns, newest);
+
+	unlock(hjh);
+
+	return true;
+}
+
+enum m_relation_history_result
+m_hand_joint_history_get(const struct m_hand_joint_history *hjh,
+                         uint64_t at_timestamp_ns,
+                         struct xrt_hand_joint_set *out_joint_set)
+{
+	lock(hjh);
+	enum m_relation_history_result ret = get_locked(hjh, at_timestamp_ns, out_joint_set);
+	unlock(hjh);
+
+	return ret;
+}
+
+bool
+m_hand_joint_history_get_latest(const struct m_hand_joint_history *hjh,
+                                uint64_t *out_time_ns,
+                                struct xrt_hand_joint_set *out_joint_set)
+{
+	lock(hjh);
+
+	if (hjh->size == 0) {
+		unlock(hjh);
+		return false;
+	}
+
+	const struct entry *newest = entry_at(hjh, hjh->size - 1);
+	*out_time_ns = newest->timestamp_ns;
+	unpack(newest, out_joint_set);
+
+	unlock(hjh);
+
+	return true;
+}
+
+uint32_t
+m_hand_joint_history_get_size(const struct m_hand_joint_history *hjh)
+{
+	lock(hjh);
+	uint32_t size = hjh->size;
+	unlock(hjh);
+
+	return size;
+}
+
+void
+m_hand_joint_history_clear(struct m_hand_joint_history *hjh)
+{
+	lock(hjh);
+	hjh->start = 0;
+	hjh->size = 0;
+	unlock(hjh);
+}
+
+void
+m_hand_joint_history_destroy(struct m_hand_joint_history **hjh_ptr)
+{
+	struct m_hand_joint_history *hjh = *hjh_ptr;
+	if (hjh == NULL) {
+		return;
+	}
+
+	os_mutex_destroy(&hjh->mutex);
+	free(hjh);
+	*hjh_ptr = NULL;
+}
@@ -0,0 +1,142 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  History of hand joint sets, for getting the joints of a tracked
+ *         hand at any time near the newest sample.
+ * @ingroup aux_math
+ */
+
+#pragma once
+
+#include "xrt/xrt_defines.h"
+
+#include "math/m_relation_history.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * Ring buffer of @ref xrt_hand_joint_set, the hand joint version of
+ * @ref m_relation_history. All joints of an entry are stored as a structure of
+ * arrays, so an interpolated or extrapolated set is computed for all of them
+ * at once.
+ *
+ * Between two entries joint positions, velocities and radii are linearly
+ * interpolated and orientations normalized linearly interpolated, the entries
+ * are close enough in time for that to be indistinguishable from a slerp.
+ * Past the newest entry the joints carry on moving the way they did between
+ * the two newest entries, up to a maximum prediction time.
+ *
+ * Like @ref m_relation_history this is a thread safe interface.
+ *
+ * @ingroup aux_math
+ */
+struct m_hand_joint_history;
+
+//! Number of entries in a history made with @ref m_hand_joint_history_create.
+#define M_HAND_JOINT_HISTORY_DEFAULT_CAPACITY (16)
+
+//! How far past the newest entry joints are extrapolated by default, 50ms.
+#define M_HAND_JOINT_HISTORY_DEFAULT_MAX_PREDICTION_NS (50 * 1000 * 1000)
+
+/*!
+ * Creates a history with @ref M_HAND_JOINT_HISTORY_DEFAULT_CAPACITY entries.
+ *
+ * @public @memberof m_hand_joint_history
+ */
+void
+m_hand_joint_history_create(struct m_hand_joint_history **out_hjh);
+
+/*!
+ * Creates a history holding at most @p capacity entries.
+ *
+ * @public @memberof m_hand_joint_history
+ */
+void
+m_hand_joint_history_create_with_capacity(struct m_hand_joint_history **out_hjh, uint32_t capacity);
+
+/*!
+ * Sets how far past the newest entry the joints are extrapolated, asking for
+ * a later time gives the joints at this limit.
+ *
+ * @public @memberof m_hand_joint_history
+ */
+void
+m_hand_joint_history_set_max_prediction(struct m_hand_joint_history *hjh, uint64_t max_prediction_ns);
+
+/*!
+ * Pushes a new joint set to the history, inactive sets are recorded too so
+ * that the hand is not made up while it isn't tracked.
+ *
+ * If the history is full, it will also pop a set out of the other side of the buffer.
+ *
+ * @return false if the timestamp is not newer than the most recent timestamp already recorded
+ *
+ * @public @memberof m_hand_joint_history
+ */
+bool
+m_hand_joint_history_push(struct m_hand_joint_history *hjh,
+                          const struct xrt_hand_joint_set *joint_set,
+                          uint64_t timestamp_ns);
+
+/*!
+ * Interpolates or extrapolates the joint set to the desired timestamp.
+ *
+ * Before the oldest entry the oldest set is returned, as is the nearest one
+ * when interpolating between an active and an inactive set. An inactive set
+ * with no valid joints is returned if the history is empty.
+ *
+ * @public @memberof m_hand_joint_history
+ */
+enum m_relation_history_result
+m_hand_joint_history_get(const struct m_hand_joint_history *hjh,
+                         uint64_t at_timestamp_ns,
+                         struct xrt_hand_joint_set *out_joint_set);
+
+/*!
+ * Get the latest joint set in the buffer, if any.
+ *
+ * @param hjh self
+ * @param[out] out_time_ns Populated with the latest timestamp, if any
+ * @param[out] out_joint_set Populated with the latest joint set, if any
+ *
+ * @return false if the history is empty.
+ *
+ * @public @memberof m_hand_joint_history
+ */
+bool
+m_hand_joint_history_get_latest(const struct m_hand_joint_history *hjh,
+                                uint64_t *out_time_ns,
+                                struct xrt_hand_joint_set *out_joint_set);
+
+/*!
+ * Returns the number of items in the history.
+ *
+ * @public @memberof m_hand_joint_history
+ */
+uint32_t
+m_hand_joint_history_get_size(const struct m_hand_joint_history *hjh);
+
+/*!
+ * Clears the history from all of the items.
+ *
+ * @public @memberof m_hand_joint_history
+ */
+void
+m_hand_joint_history_clear(struct m_hand_joint_history *hjh);
+
+/*!
+ * Destroys a history.
+ *
+ * @public @memberof m_hand_joint_history
+ */
+void
+m_hand_joint_history_destroy(struct m_hand_joint_history **hjh_ptr);
+
+
+#ifdef __cplusplus
+}
+#endif
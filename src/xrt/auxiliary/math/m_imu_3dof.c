@@ -10,6 +10,7 @@
  */
 
 #include "util/u_misc.h"
+#include "util/u_simd.h"
 #include "util/u_var.h"
 
 #include "math/m_api.h"
@@ -25,6 +26,74 @@
 #define DUR_300MS_IN_NS (300 * 1000 * 1000)
 #define DUR_20MS_IN_NS (20 * 1000 * 1000)
 
+/*!
+ * Past this half angle the sin and cos series below lose precision and fall
+ * back to sinf and cosf, at 1 kHz it takes 1000 rad/s to get there so that
+ * only happens after gaps in the samples.
+ */
+#define SERIES_MAX_HALF_ANGLE (0.5f)
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+//! Hamilton product, `a * b`.
+static inline struct xrt_quat
+quat_mul(const struct xrt_quat *a, const struct xrt_quat *b)
+{
+	return (struct xrt_quat){
+	    .x = a->w * b->x + a->x * b->w + a->y * b->z - a->z * b->y,
+	    .y = a->w * b->y + a->y * b->w + a->z * b->x - a->x * b->z,
+	    .z = a->w * b->z + a->z * b->w + a->x * b->y - a->y * b->x,
+	    .w = a->w * b->w - a->x * b->x - a->y * b->y - a->z * b->z,
+	};
+}
+
+static inline struct xrt_vec3
+vec3_cross(struct xrt_vec3 a, struct xrt_vec3 b)
+{
+	return (struct xrt_vec3){
+	    a.y * b.z - a.z * b.y,
+	    a.z * b.x - a.x * b.z,
+	    a.x * b.y - a.y * b.x,
+	};
+}
+
+//! `q * v * q^-1` for a unit quaternion, `v + 2w(u x v) + u x 2(u x v)`.
+static inline struct xrt_vec3
+quat_rotate_vec3(const struct xrt_quat *q, const struct xrt_vec3 *v)
+{
+	struct xrt_vec3 u = {q->x, q->y, q->z};
+	struct xrt_vec3 uv = vec3_cross(u, *v);
+	uv = m_vec3_add(uv, uv);
+
+	return m_vec3_add(m_vec3_add(*v, m_vec3_mul_scalar(uv, q->w)), vec3_cross(u, uv));
+}
+
+/*!
+ * Same as @ref math_quat_from_angle_vector for a unit @p axis, with sin and
+ * cos as series for the small angles turned between samples.
+ */
+static inline struct xrt_quat
+quat_from_small_angle(float angle_rads, const struct xrt_vec3 *axis)
+{
+	float h = angle_rads * 0.5f;
+	if (fabsf(h) > SERIES_MAX_HALF_ANGLE) {
+		struct xrt_quat q;
+		math_quat_from_angle_vector(angle_rads, axis, &q);
+		return q;
+	}
+
+	float h2 = h * h;
+	float s = h * (1.0f - h2 / 6.0f * (1.0f - h2 / 20.0f * (1.0f - h2 / 42.0f)));
+	float c = 1.0f - h2 / 2.0f * (1.0f - h2 / 12.0f * (1.0f - h2 / 30.0f * (1.0f - h2 / 56.0f)));
+
+	return (struct xrt_quat){axis->x * s, axis->y * s, axis->z * s, c};
+}
+
 
 void
 m_imu_3dof_init(struct m_imu_3dof *f, int flags)
@@ -103,7 +172,7 @@ m_imu_3dof_add_vars(struct m_imu_3dof *f, void *root, const char *prefix)
 static void
 gravity_correction(struct m_imu_3dof *f,
                    uint64_t timestamp_ns,
-                   const struct xrt_vec3 *accel,
+                   float accel_length,
                    const struct xrt_vec3 *gyro,
                    double dt,
                    float gyro_length)
@@ -128,7 +197,6 @@ gravity_correction(struct m_imu_3dof *f,
 	 * reset the counter and start over.
 	 */
 
-	float accel_length = m_vec3_len(*accel);
 	bool is_accel = fabsf(accel_length - 9.82f) >= gravity_tolerance;
 	bool is_rotating = gyro_length >= gyro_tolerance;
 	if (is_accel || is_rotating) {
@@ -198,11 +266,8 @@ gravity_correction(struct m_imu_3dof *f,
 		f->grav.error_angle += correction_radians;
 
 		// Perform the correction.
-		struct xrt_quat corr_quat;
-		struct xrt_quat old_orient;
-		math_quat_from_angle_vector(correction_radians, &f->grav.error_axis, &corr_quat);
-		old_orient = f->rot;
-		math_quat_rotate(&corr_quat, &old_orient, &f->rot);
+		struct xrt_quat corr_quat = quat_from_small_angle(correction_radians, &f->grav.error_axis);
+		f->rot = quat_mul(&corr_quat, &f->rot);
 	}
 }
 
@@ -287,7 +352,7 @@ m_imu_3dof_update(struct m_imu_3dof *f,
 	}
 
 	// Gravity correction.
-	gravity_correction(f, timestamp_ns, accel, &gyro_biased, dt, gyro_biased_length);
+	gravity_correction(f, timestamp_ns, accel_length, &gyro_biased, dt, gyro_biased_length);
 
 	// Gyro bias calculations.
 	gyro_biasing(f, timestamp_ns);
@@ -298,3 +363,197 @@ m_imu_3dof_update(struct m_imu_3dof *f,
 	 */
 	math_quat_normalize(&f->rot);
 }
+
+
+/*
+ *
+ * Batch update.
+ *
+ */
+
+//! Samples handled per pass, a multiple of any @ref U_SIMD_LANES.
+#define BATCH_CHUNK (32)
+
+/*!
+ * Everything about the samples in a chunk that does not depend on the
+ * orientation, as a structure of arrays padded to a multiple of the lanes.
+ */
+struct batch_chunk
+{
+	float dt[BATCH_CHUNK];
+
+	// The biased gyro and delta orientation of each sample.
+	float bx[BATCH_CHUNK], by[BATCH_CHUNK], bz[BATCH_CHUNK];
+	float accel_length[BATCH_CHUNK];
+	float gyro_biased_length[BATCH_CHUNK];
+	float half_angle[BATCH_CHUNK];
+	float qx[BATCH_CHUNK], qy[BATCH_CHUNK], qz[BATCH_CHUNK], qw[BATCH_CHUNK];
+};
+
+//! `1 - h2 * k * rest`, one step of a series in Horner form.
+static inline u_vf
+series_step(u_vf h2, float k, u_vf rest)
+{
+	return u_vf_sub(u_vf_set(1.0f), u_vf_mul(u_vf_mul(h2, u_vf_set(k)), rest));
+}
+
+static inline u_vf
+length(u_vf x, u_vf y, u_vf z)
+{
+	return u_vf_sqrt(u_vf_add(u_vf_add(u_vf_mul(x, x), u_vf_mul(y, y)), u_vf_mul(z, z)));
+}
+
+static void
+batch_chunk_compute(struct batch_chunk *c,
+                    const struct m_imu_3dof_sample *samples,
+                    uint32_t count,
+                    const struct xrt_vec3 *bias)
+{
+	const size_t stride = sizeof(*samples);
+
+	u_vf bias_x = u_vf_set(bias->x);
+	u_vf bias_y = u_vf_set(bias->y);
+	u_vf bias_z = u_vf_set(bias->z);
+	u_vf one = u_vf_set(1.0f);
+	u_vf half = u_vf_set(0.5f);
+
+	for (uint32_t i = 0; i < count; i += U_SIMD_LANES) {
+		const struct m_imu_3dof_sample *s = &samples[i];
+		uint32_t n = count - i;
+
+		u_vf ax = u_vf_gather(&s->accel.x, stride, n);
+		u_vf ay = u_vf_gather(&s->accel.y, stride, n);
+		u_vf az = u_vf_gather(&s->accel.z, stride, n);
+		u_vf bx = u_vf_sub(u_vf_gather(&s->gyro.x, stride, n), bias_x);
+		u_vf by = u_vf_sub(u_vf_gather(&s->gyro.y, stride, n), bias_y);
+		u_vf bz = u_vf_sub(u_vf_gather(&s->gyro.z, stride, n), bias_z);
+
+		u_vf biased_length = length(bx, by, bz);
+		u_vf_store(&c->accel_length[i], length(ax, ay, az));
+		u_vf_store(&c->gyro_biased_length[i], biased_length);
+
+		// Half of the angle turned during the sample.
+		u_vf half_dt = u_vf_mul(u_vf_gather(&c->dt[i], sizeof(float), n), half);
+		u_vf h = u_vf_mul(biased_length, half_dt);
+		u_vf h2 = u_vf_mul(h, h);
+
+		// sin(h) / h and cos(h), the first terms are plenty for small angles.
+		u_vf sinc = series_step(h2, 1.0f / 42.0f, one);
+		sinc = series_step(h2, 1.0f / 20.0f, sinc);
+		sinc = series_step(h2, 1.0f / 6.0f, sinc);
+
+		u_vf cosine = series_step(h2, 1.0f / 56.0f, one);
+		cosine = series_step(h2, 1.0f / 30.0f, cosine);
+		cosine = series_step(h2, 1.0f / 12.0f, cosine);
+		cosine = series_step(h2, 1.0f / 2.0f, cosine);
+
+		// The axis times sin(h) is the biased gyro times sin(h) / length.
+		u_vf sin_over_length = u_vf_mul(half_dt, sinc);
+
+		u_vf_store(&c->bx[i], bx);
+		u_vf_store(&c->by[i], by);
+		u_vf_store(&c->bz[i], bz);
+		u_vf_store(&c->half_angle[i], h);
+		u_vf_store(&c->qx[i], u_vf_mul(bx, sin_over_length));
+		u_vf_store(&c->qy[i], u_vf_mul(by, sin_over_length));
+		u_vf_store(&c->qz[i], u_vf_mul(bz, sin_over_length));
+		u_vf_store(&c->qw[i], cosine);
+	}
+}
+
+void
+m_imu_3dof_update_batch(struct m_imu_3dof *f,
+                        const struct m_imu_3dof_sample *samples,
+                        uint32_t count,
+                        struct xrt_quat *out_rots)
+{
+	if (count == 0) {
+		return;
+	}
+
+	// The first sample only sets the timepoint.
+	if (f->state == M_IMU_3DOF_STATE_START) {
+		m_imu_3dof_update(f, samples[0].timestamp_ns, &samples[0].accel, &samples[0].gyro);
+		if (out_rots != NULL) {
+			*out_rots++ = f->rot;
+		}
+		samples++;
+		if (--count == 0) {
+			return;
+		}
+	}
+
+	struct batch_chunk c;
+	uint64_t last_ns = f->last.timestamp_ns;
+	uint32_t chunk_count = 0;
+
+	for (uint32_t start = 0; start < count; start += BATCH_CHUNK) {
+		chunk_count = count - start < BATCH_CHUNK ? count - start : BATCH_CHUNK;
+
+		for (uint32_t i = 0; i < chunk_count; i++) {
+			uint64_t timestamp_ns = samples[start + i].timestamp_ns;
+
+			// This code assumes all timestamps makes some forward progress.
+			assert(timestamp_ns >= last_ns);
+
+			c.dt[i] = (float)((double)(timestamp_ns - last_ns) * (1.0 / DUR_1S_IN_NS));
+			last_ns = timestamp_ns;
+		}
+
+		batch_chunk_compute(&c, &samples[start], chunk_count, &f->gyro_bias.value);
+
+		// What is left depends on the orientation after the previous sample.
+		for (uint32_t i = 0; i < chunk_count; i++) {
+			const struct m_imu_3dof_sample *s = &samples[start + i];
+
+			struct xrt_vec3 world_accel = quat_rotate_vec3(&f->rot, &s->accel);
+			m_ff_vec3_f32_push(f->word_accel_ff, &world_accel, s->timestamp_ns);
+			m_ff_vec3_f32_push(f->gyro_ff, &s->gyro, s->timestamp_ns);
+
+			struct xrt_vec3 gyro_biased = {c.bx[i], c.by[i], c.bz[i]};
+			float gyro_biased_length = c.gyro_biased_length[i];
+
+			if (gyro_biased_length > 0.0001f) {
+				struct xrt_quat delta_orient = {c.qx[i], c.qy[i], c.qz[i], c.qw[i]};
+				if (c.half_angle[i] > SERIES_MAX_HALF_ANGLE) {
+					float inv_length = 1.0f / gyro_biased_length;
+					struct xrt_vec3 rot_axis = m_vec3_mul_scalar(gyro_biased, inv_length);
+					math_quat_from_angle_vector(2.0f * c.half_angle[i], &rot_axis, &delta_orient);
+				}
+
+				f->rot = quat_mul(&f->rot, &delta_orient);
+			}
+
+			gravity_correction(f, s->timestamp_ns, c.accel_length[i], &gyro_biased, c.dt[i],
+			                   gyro_biased_length);
+
+			/*
+			 * The orientation only drifts from unit length by rounding,
+			 * one Newton step of 1 / sqrt is enough to bring it back.
+			 */
+			struct xrt_quat *q = &f->rot;
+			float scale = (3.0f - (q->x * q->x + q->y * q->y + q->z * q->z + q->w * q->w)) * 0.5f;
+			q->x *= scale;
+			q->y *= scale;
+			q->z *= scale;
+			q->w *= scale;
+
+			if (out_rots != NULL) {
+				out_rots[start + i] = f->rot;
+			}
+		}
+	}
+
+	// The debug values show the last sample.
+	uint32_t last = chunk_count - 1;
+	f->last.timestamp_ns = last_ns;
+	f->last.gyro = samples[count - 1].gyro;
+	f->last.accel = samples[count - 1].accel;
+	f->last.delta_ms = c.dt[last] * 1000.0;
+	f->last.accel_length = c.accel_length[last];
+	f->last.gyro_length = m_vec3_len(f->last.gyro);
+	f->last.gyro_biased_length = c.gyro_biased_length[last];
+
+	// Gyro bias calculations, with the bias used for the whole batch.
+	gyro_biasing(f, last_ns);
+}
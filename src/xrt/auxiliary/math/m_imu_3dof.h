@@ -25,6 +25,16 @@ extern "C" {
 
 struct m_ff_vec3_f32;
 
+/*!
+ * One accelerometer and gyroscope sample, for @ref m_imu_3dof_update_batch.
+ */
+struct m_imu_3dof_sample
+{
+	uint64_t timestamp_ns;
+	struct xrt_vec3 accel; //!< Acceleration
+	struct xrt_vec3 gyro;  //!< Angular velocity
+};
+
 enum m_imu_3dof_state
 {
 	M_IMU_3DOF_STATE_START = 0,
@@ -90,6 +100,26 @@ m_imu_3dof_update(struct m_imu_3dof *f,
                   const struct xrt_vec3 *accel,
                   const struct xrt_vec3 *gyro);
 
+/*!
+ * Integrates @p count samples in one go, for drivers that get several samples
+ * per report. Gives the same orientations as calling @ref m_imu_3dof_update
+ * on each sample, up to floating point rounding: the per sample math that
+ * does not depend on the orientation is done for all samples at once with
+ * SIMD, and the orientation is renormalized with a cheaper step.
+ *
+ * A manually fired gyro bias is applied at the end of the batch.
+ *
+ * @param f         Fusion to update.
+ * @param samples   Samples in timestamp order.
+ * @param count     Number of samples.
+ * @param out_rots  Optional, the orientation after each sample.
+ */
+void
+m_imu_3dof_update_batch(struct m_imu_3dof *f,
+                        const struct m_imu_3dof_sample *samples,
+                        uint32_t count,
+                        struct xrt_quat *out_rots);
+
 
 #ifdef __cplusplus
 }
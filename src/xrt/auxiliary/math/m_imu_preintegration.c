@@ -0,0 +1,225 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Incremental IMU preintegration on top of a base pose.
+ * @ingroup aux_math
+ */
+
+#include "math/m_api.h"
+#include "math/m_vec3.h"
+#include "math/m_imu_preintegration.h"
+
+#include "util/u_misc.h"
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static inline struct m_imu_preint_sample *
+sample_at(struct m_imu_preint *pi, uint32_t i)
+{
+	return &pi->samples[(pi->head + i) % M_IMU_PREINT_MAX_SAMPLES];
+}
+
+static inline const struct m_imu_preint_sample *
+sample_at_const(const struct m_imu_preint *pi, uint32_t i)
+{
+	return &pi->samples[(pi->head + i) % M_IMU_PREINT_MAX_SAMPLES];
+}
+
+static void
+delta_identity(struct m_imu_preint_delta *delta)
+{
+	U_ZERO(delta);
+	delta->rot.w = 1.0f;
+}
+
+/*!
+ * Integrate one sample over @p dt seconds on top of @p prev.
+ */
+static void
+delta_step(const struct m_imu_preint_delta *prev,
+           const struct xrt_vec3 *gyro,
+           const struct xrt_vec3 *accel,
+           double dt_s,
+           struct m_imu_preint_delta *out)
+{
+	float dt = (float)dt_s;
+
+	// Integrate gyroscope.
+	struct xrt_quat rot_delta;
+	struct xrt_vec3 scaled_half_g = m_vec3_mul_scalar(*gyro, dt * 0.5f);
+	math_quat_exp(&scaled_half_g, &rot_delta);
+	math_quat_rotate(&prev->rot, &rot_delta, &out->rot);
+
+	// Integrate accelerometer, with the already updated orientation.
+	struct xrt_vec3 accel_base;
+	math_quat_rotate_vec3(&out->rot, accel, &accel_base);
+	out->vel = m_vec3_add(prev->vel, m_vec3_mul_scalar(accel_base, dt));
+	out->pos = m_vec3_add(prev->pos, m_vec3_add(m_vec3_mul_scalar(out->vel, dt),
+	                                            m_vec3_mul_scalar(accel_base, dt * dt * 0.5f)));
+
+	out->gyro = *gyro;
+	out->time_s = prev->time_s + dt_s;
+	out->accel_pos_s2 = prev->accel_pos_s2 + out->time_s * dt_s + dt_s * dt_s * 0.5;
+	out->sample_count = prev->sample_count + 1;
+}
+
+static void
+integrate_from(struct m_imu_preint *pi, uint32_t first)
+{
+	struct m_imu_preint_delta identity;
+	delta_identity(&identity);
+
+	for (uint32_t i = first; i < pi->count; i++) {
+		struct m_imu_preint_sample *s = sample_at(pi, i);
+		const struct m_imu_preint_delta *prev = i == 0 ? &identity : &sample_at(pi, i - 1)->delta;
+		timepoint_ns prev_ns = i == 0 ? pi->base_ns : sample_at(pi, i - 1)->timestamp_ns;
+
+		delta_step(prev, &s->gyro, &s->accel, time_ns_to_s(s->timestamp_ns - prev_ns), &s->delta);
+	}
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+void
+m_imu_preint_init(struct m_imu_preint *pi)
+{
+	pi->head = 0;
+	pi->count = 0;
+	pi->base_ns = 0;
+	pi->has_base = false;
+}
+
+void
+m_imu_preint_push(struct m_imu_preint *pi,
+                  timepoint_ns timestamp_ns,
+                  const struct xrt_vec3 *gyro,
+                  const struct xrt_vec3 *accel)
+{
+	if (pi->count > 0 && timestamp_ns <= sample_at(pi, pi->count - 1)->timestamp_ns) {
+		return;
+	}
+
+	// Samples older than the base are never integrated.
+	if (pi->has_base && timestamp_ns < pi->base_ns) {
+		return;
+	}
+
+	// Drop the oldest sample when full, the others keep their deltas.
+	if (pi->count == M_IMU_PREINT_MAX_SAMPLES) {
+		pi->head = (pi->head + 1) % M_IMU_PREINT_MAX_SAMPLES;
+		pi->count--;
+	}
+
+	struct m_imu_preint_sample *s = sample_at(pi, pi->count++);
+	s->timestamp_ns = timestamp_ns;
+	s->gyro = *gyro;
+	s->accel = *accel;
+
+	if (pi->has_base) {
+		integrate_from(pi, pi->count - 1);
+	}
+}
+
+void
+m_imu_preint_set_base(struct m_imu_preint *pi, timepoint_ns base_ns)
+{
+	if (pi->has_base && pi->base_ns == base_ns) {
+		return;
+	}
+
+	while (pi->count > 0 && sample_at(pi, 0)->timestamp_ns < base_ns) {
+		pi->head = (pi->head + 1) % M_IMU_PREINT_MAX_SAMPLES;
+		pi->count--;
+	}
+
+	pi->base_ns = base_ns;
+	pi->has_base = true;
+
+	integrate_from(pi, 0);
+}
+
+bool
+m_imu_preint_get(const struct m_imu_preint *pi,
+                 timepoint_ns when_ns,
+                 struct m_imu_preint_delta *out_delta,
+                 timepoint_ns *out_timestamp_ns)
+{
+	if (!pi->has_base || pi->count == 0) {
+		delta_identity(out_delta);
+		*out_timestamp_ns = pi->base_ns;
+		return false;
+	}
+
+	// Number of samples not newer than when_ns.
+	uint32_t lo = 0;
+	uint32_t hi = pi->count;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (sample_at_const(pi, mid)->timestamp_ns <= when_ns) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo == pi->count) {
+		const struct m_imu_preint_sample *last = sample_at_const(pi, pi->count - 1);
+		*out_delta = last->delta;
+		*out_timestamp_ns = last->timestamp_ns;
+		return true;
+	}
+
+	// The next sample straddles when_ns, integrate it partially.
+	struct m_imu_preint_delta identity;
+	delta_identity(&identity);
+
+	const struct m_imu_preint_sample *next = sample_at_const(pi, lo);
+	const struct m_imu_preint_delta *prev = lo == 0 ? &identity : &sample_at_const(pi, lo - 1)->delta;
+	timepoint_ns prev_ns = lo == 0 ? pi->base_ns : sample_at_const(pi, lo - 1)->timestamp_ns;
+
+	delta_step(prev, &next->gyro, &next->accel, time_ns_to_s(when_ns - prev_ns), out_delta);
+	*out_timestamp_ns = when_ns;
+
+	return true;
+}
+
+void
+m_imu_preint_apply(const struct m_imu_preint_delta *delta,
+                   const struct xrt_space_relation *base,
+                   const struct xrt_vec3 *gravity,
+                   struct xrt_space_relation *out_relation)
+{
+	const struct xrt_quat *base_rot = &base->pose.orientation;
+	float t = (float)delta->time_s;
+	float g = (float)delta->accel_pos_s2;
+
+	struct xrt_space_relation rel = *base;
+
+	math_quat_rotate(base_rot, &delta->rot, &rel.pose.orientation);
+
+	struct xrt_vec3 vel;
+	math_quat_rotate_vec3(base_rot, &delta->vel, &vel);
+	rel.linear_velocity = m_vec3_add(base->linear_velocity, m_vec3_add(vel, m_vec3_mul_scalar(*gravity, t)));
+
+	struct xrt_vec3 pos;
+	math_quat_rotate_vec3(base_rot, &delta->pos, &pos);
+	pos = m_vec3_add(pos, m_vec3_mul_scalar(base->linear_velocity, t));
+	rel.pose.position = m_vec3_add(base->pose.position, m_vec3_add(pos, m_vec3_mul_scalar(*gravity, g)));
+
+	if (delta->sample_count > 0) {
+		math_quat_rotate_derivative(&rel.pose.orientation, &delta->gyro, &rel.angular_velocity);
+	}
+
+	*out_relation = rel;
+}
@@ -0,0 +1,158 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Incremental IMU preintegration on top of a base pose.
+ * @ingroup aux_math
+ */
+
+#pragma once
+
+#include "xrt/xrt_compiler.h"
+#include "xrt/xrt_defines.h"
+#include "util/u_time.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//! Number of IMU samples kept, older samples are dropped when full.
+#define M_IMU_PREINT_MAX_SAMPLES 1024
+
+/*!
+ * Motion integrated from IMU samples since the base pose, expressed in the
+ * frame of the base pose and without gravity or the base velocity so it does
+ * not change when the base pose does.
+ *
+ * @ingroup aux_math
+ */
+struct m_imu_preint_delta
+{
+	//! Rotation from the base orientation.
+	struct xrt_quat rot;
+
+	//! Change of velocity from the accelerometer.
+	struct xrt_vec3 vel;
+
+	//! Change of position from the accelerometer.
+	struct xrt_vec3 pos;
+
+	//! Last gyroscope sample, in the body frame.
+	struct xrt_vec3 gyro;
+
+	//! Seconds integrated.
+	double time_s;
+
+	//! How much a constant acceleration (gravity) contributes to the position.
+	double accel_pos_s2;
+
+	//! Number of IMU samples integrated, zero means @ref gyro is not valid.
+	uint32_t sample_count;
+};
+
+/*!
+ * One IMU sample and the delta integrated from the base up to and including it.
+ *
+ * @ingroup aux_math
+ */
+struct m_imu_preint_sample
+{
+	timepoint_ns timestamp_ns;
+	struct xrt_vec3 gyro;
+	struct xrt_vec3 accel;
+	struct m_imu_preint_delta delta;
+};
+
+/*!
+ * Keeps the IMU samples newer than a base timestamp, usually the one of the
+ * last pose from a SLAM system, integrated as they arrive. Looking up the
+ * motion since the base is then a binary search plus at most one partial
+ * step instead of integrating all the samples again.
+ *
+ * The integration is the same as stepping a pose through each sample: the
+ * orientation is rotated by the gyroscope first, then the rotated accelerometer
+ * sample updates the velocity and the position with the updated velocity.
+ *
+ * Not thread safe, callers that push and query from different threads need
+ * to hold their own lock.
+ *
+ * @ingroup aux_math
+ */
+struct m_imu_preint
+{
+	//! Ring buffer of samples, ordered by timestamp.
+	struct m_imu_preint_sample samples[M_IMU_PREINT_MAX_SAMPLES];
+	uint32_t head;
+	uint32_t count;
+
+	//! Timestamp the deltas are relative to.
+	timepoint_ns base_ns;
+	bool has_base;
+};
+
+/*!
+ * Initialise or reset, drops all samples and the base.
+ *
+ * @public @memberof m_imu_preint
+ */
+void
+m_imu_preint_init(struct m_imu_preint *pi);
+
+/*!
+ * Add a sample and integrate it, samples that are not newer than the last
+ * one are ignored.
+ *
+ * @public @memberof m_imu_preint
+ */
+void
+m_imu_preint_push(struct m_imu_preint *pi,
+                  timepoint_ns timestamp_ns,
+                  const struct xrt_vec3 *gyro,
+                  const struct xrt_vec3 *accel);
+
+/*!
+ * Move the base to @p base_ns, drops the samples older than it and integrates
+ * the newer ones again. Does nothing if the base is not changed.
+ *
+ * @public @memberof m_imu_preint
+ */
+void
+m_imu_preint_set_base(struct m_imu_preint *pi, timepoint_ns base_ns);
+
+/*!
+ * Get the motion integrated from the base up to @p when_ns, or up to the last
+ * sample if @p when_ns is newer than it. A sample that straddles @p when_ns is
+ * integrated up to @p when_ns.
+ *
+ * @param pi The preintegration state.
+ * @param when_ns Time to integrate up to.
+ * @param[out] out_delta The integrated motion.
+ * @param[out] out_timestamp_ns Time the motion is integrated up to.
+ * @return False if there are no samples newer than the base, @p out_delta is
+ *         then the identity at the base.
+ *
+ * @public @memberof m_imu_preint
+ */
+bool
+m_imu_preint_get(const struct m_imu_preint *pi,
+                 timepoint_ns when_ns,
+                 struct m_imu_preint_delta *out_delta,
+                 timepoint_ns *out_timestamp_ns);
+
+/*!
+ * Apply @p delta to the relation @p base, adding the constant acceleration
+ * @p gravity, in the space of the relation, over the integrated time.
+ *
+ * @ingroup aux_math
+ */
+void
+m_imu_preint_apply(const struct m_imu_preint_delta *delta,
+                   const struct xrt_space_relation *base,
+                   const struct xrt_vec3 *gravity,
+                   struct xrt_space_relation *out_relation);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,7 +2,7 @@
 // SPDX-License-Identifier: BSL-1.0
 /*!
  * @file
- * @brief  Simple function to predict a new pose from a given pose.
+ * @brief  Functions to predict a new pose from a given pose or recent poses.
  * @author Jakob Bornecrantz <jakob@collabora.com>
  * @ingroup aux_math
  */
@@ -10,8 +10,14 @@
 #include "m_api.h"
 #include "m_vec3.h"
 #include "m_predict.h"
+#include "util/u_time.h"
 #include "util/u_trace_marker.h"
 
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
 
 static void
 do_orientation(const struct xrt_space_relation *rel,
@@ -113,3 +119,402 @@ m_predict_relation(const struct xrt_space_relation *rel, double delta_s, struct
 
 	out_rel->relation_flags = flags;
 }
+
+
+/*
+ *
+ * Motion models.
+ *
+ */
+
+static struct xrt_vec3
+vec3_from_time_scaled(struct xrt_vec3 v, struct xrt_vec3 slope, float t)
+{
+	return m_vec3_add(v, m_vec3_mul_scalar(slope, t));
+}
+
+/*!
+ * Least squares slope of @p values over @p t, also returns the fitted value at
+ * time zero in @p out_value.
+ */
+static bool
+fit_line(const double *t,
+         const struct xrt_vec3 *values,
+         uint32_t count,
+         struct xrt_vec3 *out_value,
+         struct xrt_vec3 *out_slope)
+{
+	if (count < 2) {
+		return false;
+	}
+
+	double mean_t = 0;
+	double mean_v[3] = {0};
+	for (uint32_t i = 0; i < count; i++) {
+		mean_t += t[i];
+		mean_v[0] += values[i].x;
+		mean_v[1] += values[i].y;
+		mean_v[2] += values[i].z;
+	}
+	mean_t /= count;
+	for (int k = 0; k < 3; k++) {
+		mean_v[k] /= count;
+	}
+
+	double stt = 0;
+	double stv[3] = {0};
+	for (uint32_t i = 0; i < count; i++) {
+		double dt = t[i] - mean_t;
+		stt += dt * dt;
+		stv[0] += dt * (values[i].x - mean_v[0]);
+		stv[1] += dt * (values[i].y - mean_v[1]);
+		stv[2] += dt * (values[i].z - mean_v[2]);
+	}
+
+	if (stt < 1e-12) {
+		return false;
+	}
+
+	double slope[3] = {stv[0] / stt, stv[1] / stt, stv[2] / stt};
+	out_slope->x = (float)slope[0];
+	out_slope->y = (float)slope[1];
+	out_slope->z = (float)slope[2];
+	out_value->x = (float)(mean_v[0] - slope[0] * mean_t);
+	out_value->y = (float)(mean_v[1] - slope[1] * mean_t);
+	out_value->z = (float)(mean_v[2] - slope[2] * mean_t);
+
+	return true;
+}
+
+/*!
+ * Least squares fit of p(t) = a + b * t + c * t^2 to @p values, only the
+ * first and second order coefficients are returned.
+ */
+static bool
+fit_quadratic(const double *t,
+              const struct xrt_vec3 *values,
+              uint32_t count,
+              struct xrt_vec3 *out_b,
+              struct xrt_vec3 *out_c)
+{
+	if (count < 3) {
+		return false;
+	}
+
+	// Fit over u = t / span, which keeps the normal equations well conditioned.
+	double span = t[count - 1] - t[0];
+	if (span < 1e-6) {
+		return false;
+	}
+
+	double s[5] = {0};
+	double r[3][3] = {{0}};
+	for (uint32_t i = 0; i < count; i++) {
+		double u = t[i] / span;
+		double p[3] = {values[i].x, values[i].y, values[i].z};
+		double un = 1;
+		for (int n = 0; n < 5; n++) {
+			s[n] += un;
+			if (n < 3) {
+				for (int k = 0; k < 3; k++) {
+					r[n][k] += un * p[k];
+				}
+			}
+			un *= u;
+		}
+	}
+
+	// Solve the 3x3 normal equations with Cramer's rule.
+	double m[3][3] = {
+	    {s[0], s[1], s[2]},
+	    {s[1], s[2], s[3]},
+	    {s[2], s[3], s[4]},
+	};
+	double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+	             m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+	             m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	if (fabs(det) < 1e-12) {
+		return false;
+	}
+
+	double b[3];
+	double c[3];
+	for (int k = 0; k < 3; k++) {
+		double r0 = r[0][k];
+		double r1 = r[1][k];
+		double r2 = r[2][k];
+
+		double det_b = m[0][0] * (r1 * m[2][2] - m[1][2] * r2) -
+		               r0 * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+		               m[0][2] * (m[1][0] * r2 - r1 * m[2][0]);
+		double det_c = m[0][0] * (m[1][1] * r2 - r1 * m[2][1]) -
+		               m[0][1] * (m[1][0] * r2 - r1 * m[2][0]) +
+		               r0 * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+
+		b[k] = det_b / det / span;
+		c[k] = det_c / det / (span * span);
+	}
+
+	*out_b = (struct xrt_vec3){(float)b[0], (float)b[1], (float)b[2]};
+	*out_c = (struct xrt_vec3){(float)c[0], (float)c[1], (float)c[2]};
+
+	return true;
+}
+
+/*!
+ * Predicts with the velocities of @p rel replaced by the mean velocities over
+ * the prediction, then sets the velocities at the end of it.
+ */
+static void
+predict_with_mean_velocities(const struct xrt_space_relation *rel,
+                             struct xrt_vec3 mean_linear_velocity,
+                             struct xrt_vec3 mean_angular_velocity,
+                             struct xrt_vec3 end_linear_velocity,
+                             struct xrt_vec3 end_angular_velocity,
+                             double delta_s,
+                             struct xrt_space_relation *out_rel)
+{
+	struct xrt_space_relation tmp = *rel;
+	tmp.linear_velocity = mean_linear_velocity;
+	tmp.angular_velocity = mean_angular_velocity;
+
+	m_predict_relation(&tmp, delta_s, out_rel);
+
+	if ((rel->relation_flags & XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT) != 0) {
+		out_rel->linear_velocity = end_linear_velocity;
+	}
+	if ((rel->relation_flags & XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT) != 0) {
+		out_rel->angular_velocity = end_angular_velocity;
+	}
+}
+
+static void
+predict_damped(const struct m_predict_params *params,
+               const struct xrt_space_relation *rel,
+               double delta_s,
+               struct xrt_space_relation *out_rel)
+{
+	double tau = params->damping_time_s;
+	if (tau <= 0 || delta_s <= 0) {
+		m_predict_relation(rel, delta_s, out_rel);
+		return;
+	}
+
+	// v(t) = v * e^(-t / tau), integrated over the prediction and divided by its length.
+	double decay = exp(-delta_s / tau);
+	float mean_scale = (float)(tau * (1.0 - decay) / delta_s);
+	float end_scale = (float)decay;
+
+	struct xrt_vec3 mean_linear = m_vec3_mul_scalar(rel->linear_velocity, mean_scale);
+	struct xrt_vec3 mean_angular = m_vec3_mul_scalar(rel->angular_velocity, mean_scale);
+	struct xrt_vec3 end_linear = m_vec3_mul_scalar(rel->linear_velocity, end_scale);
+	struct xrt_vec3 end_angular = m_vec3_mul_scalar(rel->angular_velocity, end_scale);
+
+	predict_with_mean_velocities(rel, mean_linear, mean_angular, end_linear, end_angular, delta_s, out_rel);
+}
+
+static void
+predict_constant_acceleration(const double *t,
+                              const struct xrt_space_relation *samples,
+                              uint32_t count,
+                              double delta_s,
+                              struct xrt_space_relation *out_rel)
+{
+	const struct xrt_space_relation *rel = &samples[count - 1];
+
+	struct xrt_vec3 linear[M_PREDICT_MAX_SAMPLES];
+	struct xrt_vec3 angular[M_PREDICT_MAX_SAMPLES];
+	for (uint32_t i = 0; i < count; i++) {
+		linear[i] = samples[i].linear_velocity;
+		angular[i] = samples[i].angular_velocity;
+	}
+
+	struct xrt_vec3 unused;
+	struct xrt_vec3 linear_acc = {0};
+	struct xrt_vec3 angular_acc = {0};
+	if (!fit_line(t, linear, count, &unused, &linear_acc) || !fit_line(t, angular, count, &unused, &angular_acc)) {
+		m_predict_relation(rel, delta_s, out_rel);
+		return;
+	}
+
+	float dt = (float)delta_s;
+	struct xrt_vec3 mean_linear = vec3_from_time_scaled(rel->linear_velocity, linear_acc, dt * 0.5f);
+	struct xrt_vec3 mean_angular = vec3_from_time_scaled(rel->angular_velocity, angular_acc, dt * 0.5f);
+	struct xrt_vec3 end_linear = vec3_from_time_scaled(rel->linear_velocity, linear_acc, dt);
+	struct xrt_vec3 end_angular = vec3_from_time_scaled(rel->angular_velocity, angular_acc, dt);
+
+	predict_with_mean_velocities(rel, mean_linear, mean_angular, end_linear, end_angular, delta_s, out_rel);
+}
+
+static void
+predict_polynomial(const double *t,
+                   const struct xrt_space_relation *samples,
+                   uint32_t count,
+                   double delta_s,
+                   struct xrt_space_relation *out_rel)
+{
+	const struct xrt_space_relation *rel = &samples[count - 1];
+
+	struct xrt_vec3 positions[M_PREDICT_MAX_SAMPLES];
+	struct xrt_vec3 angular[M_PREDICT_MAX_SAMPLES];
+	for (uint32_t i = 0; i < count; i++) {
+		positions[i] = samples[i].pose.position;
+		angular[i] = samples[i].angular_velocity;
+	}
+
+	struct xrt_vec3 b;
+	struct xrt_vec3 c;
+	struct xrt_vec3 angular_now;
+	struct xrt_vec3 angular_acc;
+	if (!fit_quadratic(t, positions, count, &b, &c) || !fit_line(t, angular, count, &angular_now, &angular_acc)) {
+		m_predict_relation(rel, delta_s, out_rel);
+		return;
+	}
+
+	// Moves along the fitted curve, starting from the newest position.
+	float dt = (float)delta_s;
+	struct xrt_vec3 mean_linear = vec3_from_time_scaled(b, c, dt);
+	struct xrt_vec3 mean_angular = vec3_from_time_scaled(angular_now, angular_acc, dt * 0.5f);
+	struct xrt_vec3 end_linear = vec3_from_time_scaled(b, c, 2.0f * dt);
+	struct xrt_vec3 end_angular = vec3_from_time_scaled(angular_now, angular_acc, dt);
+
+	predict_with_mean_velocities(rel, mean_linear, mean_angular, end_linear, end_angular, delta_s, out_rel);
+
+	// The fit gives a velocity even when the samples have none.
+	if ((rel->relation_flags & XRT_SPACE_RELATION_POSITION_VALID_BIT) != 0) {
+		out_rel->pose.position = m_vec3_add(rel->pose.position, m_vec3_mul_scalar(mean_linear, dt));
+	}
+}
+
+
+/*
+ *
+ * 'Exported' model functions.
+ *
+ */
+
+void
+m_predict_params_default(struct m_predict_params *params)
+{
+	params->model = M_PREDICT_MODEL_CONSTANT_VELOCITY;
+	params->damping_time_s = 0.08f;
+	params->sample_count = 16;
+	params->sample_window_s = 0.05f;
+}
+
+bool
+m_predict_params_from_string(const char *str, struct m_predict_params *params)
+{
+	if (str == NULL) {
+		return false;
+	}
+
+	static const struct
+	{
+		const char *name;
+		enum m_predict_model model;
+	} names[] = {
+	    {"velocity", M_PREDICT_MODEL_CONSTANT_VELOCITY},
+	    {"acceleration", M_PREDICT_MODEL_CONSTANT_ACCELERATION},
+	    {"damped", M_PREDICT_MODEL_DAMPED},
+	    {"polynomial", M_PREDICT_MODEL_POLYNOMIAL},
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(names); i++) {
+		size_t len = strlen(names[i].name);
+		if (strncmp(str, names[i].name, len) != 0) {
+			continue;
+		}
+
+		const char *rest = str + len;
+		if (*rest == '\0') {
+			params->model = names[i].model;
+			return true;
+		}
+		if (*rest != ':') {
+			continue;
+		}
+
+		char *end = NULL;
+		double value = strtod(rest + 1, &end);
+		if (end == rest + 1 || *end != '\0' || value <= 0) {
+			return false;
+		}
+
+		params->model = names[i].model;
+		if (params->model == M_PREDICT_MODEL_DAMPED) {
+			params->damping_time_s = (float)(value / 1000.0);
+		} else {
+			params->sample_count = (uint32_t)value;
+		}
+		return true;
+	}
+
+	return false;
+}
+
+const char *
+m_predict_model_to_string(enum m_predict_model model)
+{
+	switch (model) {
+	case M_PREDICT_MODEL_CONSTANT_VELOCITY: return "velocity";
+	case M_PREDICT_MODEL_CONSTANT_ACCELERATION: return "acceleration";
+	case M_PREDICT_MODEL_DAMPED: return "damped";
+	case M_PREDICT_MODEL_POLYNOMIAL: return "polynomial";
+	default: return "unknown";
+	}
+}
+
+void
+m_predict_relation_from_samples(const struct m_predict_params *params,
+                                const struct xrt_space_relation *samples,
+                                const uint64_t *timestamps_ns,
+                                uint32_t sample_count,
+                                double delta_s,
+                                struct xrt_space_relation *out_rel)
+{
+	XRT_TRACE_MARKER();
+
+	assert(sample_count > 0);
+	const struct xrt_space_relation *newest = &samples[sample_count - 1];
+
+	switch (params->model) {
+	case M_PREDICT_MODEL_DAMPED: predict_damped(params, newest, delta_s, out_rel); return;
+	case M_PREDICT_MODEL_CONSTANT_ACCELERATION:
+	case M_PREDICT_MODEL_POLYNOMIAL: break;
+	case M_PREDICT_MODEL_CONSTANT_VELOCITY:
+	default: m_predict_relation(newest, delta_s, out_rel); return;
+	}
+
+	// Pick the newest samples within the window, times in seconds relative to the newest.
+	uint32_t max_count = params->sample_count;
+	if (max_count > M_PREDICT_MAX_SAMPLES) {
+		max_count = M_PREDICT_MAX_SAMPLES;
+	}
+	if (max_count > sample_count) {
+		max_count = sample_count;
+	}
+	if (max_count < 2) {
+		m_predict_relation(newest, delta_s, out_rel);
+		return;
+	}
+
+	uint64_t newest_ns = timestamps_ns[sample_count - 1];
+	uint32_t first = sample_count - max_count;
+	while (first < sample_count - 1 &&
+	       time_ns_to_s((time_duration_ns)(newest_ns - timestamps_ns[first])) > params->sample_window_s) {
+		first++;
+	}
+
+	uint32_t count = sample_count - first;
+	double t[M_PREDICT_MAX_SAMPLES];
+	for (uint32_t i = 0; i < count; i++) {
+		t[i] = -time_ns_to_s((time_duration_ns)(newest_ns - timestamps_ns[first + i]));
+	}
+
+	if (params->model == M_PREDICT_MODEL_CONSTANT_ACCELERATION) {
+		predict_constant_acceleration(t, &samples[first], count, delta_s, out_rel);
+	} else {
+		predict_polynomial(t, &samples[first], count, delta_s, out_rel);
+	}
+}
@@ -2,7 +2,7 @@
 // SPDX-License-Identifier: BSL-1.0
 /*!
  * @file
- * @brief  Simple function to predict a new pose from a given pose.
+ * @brief  Functions to predict a new pose from a given pose or recent poses.
  * @author Jakob Bornecrantz <jakob@collabora.com>
  * @ingroup aux_math
  */
@@ -30,6 +30,100 @@ void
 m_predict_relation(const struct xrt_space_relation *rel, double delta_s, struct xrt_space_relation *out_rel);
 
 
+/*!
+ * Most samples @ref m_predict_relation_from_samples looks at.
+ *
+ * @ingroup aux_math
+ */
+#define M_PREDICT_MAX_SAMPLES (32)
+
+/*!
+ * Motion model used to predict a relation past the newest sample.
+ *
+ * @ingroup aux_math
+ */
+enum m_predict_model
+{
+	//! Constant velocities, same as @ref m_predict_relation.
+	M_PREDICT_MODEL_CONSTANT_VELOCITY = 0,
+
+	//! Accelerations fitted to the velocities of the recent samples.
+	M_PREDICT_MODEL_CONSTANT_ACCELERATION,
+
+	//! Velocities decaying over the prediction, less overshoot when stopping.
+	M_PREDICT_MODEL_DAMPED,
+
+	/*!
+	 * Quadratic least squares fit to the recent positions and a linear fit
+	 * to the recent angular velocities, smooths noisy velocities.
+	 */
+	M_PREDICT_MODEL_POLYNOMIAL,
+};
+
+/*!
+ * Parameters of the motion models.
+ *
+ * @ingroup aux_math
+ */
+struct m_predict_params
+{
+	enum m_predict_model model;
+
+	//! Time constant the velocities decay with in the damped model, in seconds.
+	float damping_time_s;
+
+	//! Most recent samples used by the fitted models, clamped to @ref M_PREDICT_MAX_SAMPLES.
+	uint32_t sample_count;
+
+	//! Samples older than this relative to the newest one are not fitted to, in seconds.
+	float sample_window_s;
+};
+
+/*!
+ * Fills out @p params with the defaults, the constant velocity model.
+ *
+ * @ingroup aux_math
+ */
+void
+m_predict_params_default(struct m_predict_params *params);
+
+/*!
+ * Parses a model name, "velocity", "acceleration", "damped" or "polynomial",
+ * optionally followed by a number: the damping time in milliseconds for the
+ * damped model and the sample count for the others, "damped:60" for example.
+ * The other parameters are left as they are.
+ *
+ * @return false if @p str is NULL or not a known model.
+ * @ingroup aux_math
+ */
+bool
+m_predict_params_from_string(const char *str, struct m_predict_params *params);
+
+/*!
+ * Name of the model, as accepted by @ref m_predict_params_from_string.
+ *
+ * @ingroup aux_math
+ */
+const char *
+m_predict_model_to_string(enum m_predict_model model);
+
+/*!
+ * Predicts a new relation @p delta_s past the newest of @p samples using the
+ * model in @p params. The samples are ordered oldest first and
+ * @p timestamps_ns holds the time of each. Falls back to constant velocity
+ * when there is not enough to fit to.
+ *
+ * @ingroup aux_math
+ */
+void
+m_predict_relation_from_samples(const struct m_predict_params *params,
+                                const struct xrt_space_relation *samples,
+                                const uint64_t *timestamps_ns,
+                                uint32_t sample_count,
+                                double delta_s,
+                                struct xrt_space_relation *out_rel);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,9 +20,10 @@
 #include "util/u_trace_marker.h"
 #include "xrt/xrt_defines.h"
 #include "os/os_threading.h"
-#include "util/u_template_historybuf.hpp"
 
 #include <memory>
+#include <vector>
+#include <cmath>
 #include <algorithm>
 #include <cstring>
 #include <stdio.h>
@@ -31,47 +32,406 @@
 #include <assert.h>
 #include <mutex>
 
-using namespace xrt::auxiliary::util;
 namespace os = xrt::auxiliary::os;
 
-struct relation_history_entry
+
+/*
+ *
+ * Storage.
+ *
+ */
+
+//! Entries per position keyframe in the compact encoding.
+static constexpr uint32_t kCompactGroupSize = 16;
+
+//! Scale from meters to the units of compact positions, 0.1 mm.
+static constexpr float kCompactPositionScale = 10000.0f;
+
+//! Coarsest position step, as a power of two of the finest one.
+static constexpr uint8_t kCompactMaxPositionShift = 24;
+
+//! Scale from m/s to the units of compact linear velocities, 1 mm/s.
+static constexpr float kCompactLinearVelocityScale = 1000.0f;
+
+//! Scale from rad/s to the units of compact angular velocities.
+static constexpr float kCompactAngularVelocityScale = 500.0f;
+
+/*!
+ * Scale from quaternion components to compact orientations, only the three
+ * smallest components are stored and those are within +-1/sqrt(2).
+ */
+static constexpr float kCompactOrientationScale = 32767.0f * 1.41421356f;
+
+//! The flags only use the low bits, the top two hold the dropped quaternion component.
+static constexpr uint8_t kCompactFlagsMask = 0x3f;
+static constexpr int kCompactLargestShift = 6;
+
+/*!
+ * A relation in the compact encoding, position is an offset from the keyframe
+ * of the group the slot is in.
+ */
+struct compact_relation
 {
-	struct xrt_space_relation relation;
-	uint64_t timestamp;
+	int16_t orientation[3];
+	int16_t position[3];
+	int16_t linear_velocity[3];
+	int16_t angular_velocity[3];
+	uint8_t flags;
+	//! Position is in steps of 0.1 mm shifted left by this, see @ref rekey_group.
+	uint8_t position_shift;
 };
 
-static constexpr size_t BufLen = 4096;
-
+/*!
+ * The timestamps and relations are kept in separate arrays indexed by the same
+ * ring slots, so the binary search of a lookup only touches timestamps.
+ *
+ * Only one set of arrays is allocated, depending on the encoding.
+ */
 struct m_relation_history
 {
-	HistoryBuffer<struct relation_history_entry, BufLen> impl;
+	uint32_t capacity = 0;
+
+	//! Slot of the oldest entry.
+	uint32_t head = 0;
+
+	//! Number of entries.
+	uint32_t count = 0;
+
+	bool compact = false;
+
+	// Full encoding.
+	std::vector<uint64_t> timestamps;
+	std::vector<xrt_space_relation> relations;
+
+	// Compact encoding.
+	uint64_t time_base = 0;
+	std::vector<uint32_t> time_offsets;
+	std::vector<compact_relation> compact_relations;
+	std::vector<xrt_vec3> keyframes;
+
+	//! Model used past the newest entry.
+	struct m_predict_params predict;
+
 	mutable os::Mutex mutex;
 };
 
+static inline uint32_t
+slot_of(const struct m_relation_history *rh, uint32_t index)
+{
+	uint32_t slot = rh->head + index;
+	return slot >= rh->capacity ? slot - rh->capacity : slot;
+}
+
+static inline void
+pop_front(struct m_relation_history *rh)
+{
+	rh->head = slot_of(rh, 1);
+	rh->count--;
+}
+
+static inline int16_t
+quantize(float value, float scale)
+{
+	// fmax/fmin also take care of NaN.
+	float q = std::fmin(std::fmax(std::round(value * scale), -32767.0f), 32767.0f);
+	return (int16_t)q;
+}
+
+static inline void
+quantize_vec3(const struct xrt_vec3 &v, float scale, int16_t out[3])
+{
+	out[0] = quantize(v.x, scale);
+	out[1] = quantize(v.y, scale);
+	out[2] = quantize(v.z, scale);
+}
+
+static inline struct xrt_vec3
+dequantize_vec3(const int16_t in[3], float scale)
+{
+	return {in[0] / scale, in[1] / scale, in[2] / scale};
+}
+
+static inline float
+position_scale(uint8_t shift)
+{
+	return std::ldexp(kCompactPositionScale, -shift);
+}
+
+static inline bool
+fits_quantized(const struct xrt_vec3 &v, float scale)
+{
+	float largest = std::fmax(std::fabs(v.x), std::fmax(std::fabs(v.y), std::fabs(v.z)));
+
+	// NaN isn't a reason to make the step coarser, it is clamped like any other value.
+	return !(largest * scale > 32767.0f);
+}
+
+static uint64_t
+timestamp_at(const struct m_relation_history *rh, uint32_t index)
+{
+	uint32_t slot = slot_of(rh, index);
+	if (rh->compact) {
+		return rh->time_base + rh->time_offsets[slot];
+	}
+	return rh->timestamps[slot];
+}
+
+static void
+relation_at(const struct m_relation_history *rh, uint32_t index, struct xrt_space_relation *out_relation)
+{
+	uint32_t slot = slot_of(rh, index);
+	if (!rh->compact) {
+		*out_relation = rh->relations[slot];
+		return;
+	}
+
+	const compact_relation &c = rh->compact_relations[slot];
+	const xrt_vec3 &keyframe = rh->keyframes[slot / kCompactGroupSize];
+
+	// Put the largest component back in.
+	float q[4];
+	int largest = c.flags >> kCompactLargestShift;
+	float sum = 0.0f;
+	for (int i = 0, k = 0; i < 4; i++) {
+		if (i == largest) {
+			continue;
+		}
+		q[i] = c.orientation[k++] / kCompactOrientationScale;
+		sum += q[i] * q[i];
+	}
+	q[largest] = std::sqrt(std::fmax(1.0f - sum, 0.0f));
+
+	out_relation->pose.orientation = {q[0], q[1], q[2], q[3]};
+	out_relation->pose.position = keyframe + dequantize_vec3(c.position, position_scale(c.position_shift));
+	out_relation->linear_velocity = dequantize_vec3(c.linear_velocity, kCompactLinearVelocityScale);
+	out_relation->angular_velocity = dequantize_vec3(c.angular_velocity, kCompactAngularVelocityScale);
+	out_relation->relation_flags = (enum xrt_space_relation_flags)(c.flags & kCompactFlagsMask);
+}
+
+/*!
+ * Binary search over the two contiguous runs of the ring, returns the index of
+ * the first entry not older than @p key.
+ */
+template <typename T>
+static uint32_t
+ring_lower_bound(const struct m_relation_history *rh, const T *keys, T key)
+{
+	uint32_t first_run = std::min(rh->count, rh->capacity - rh->head);
+	const T *first = keys + rh->head;
+	const T *last = first + first_run;
+
+	if (first_run > 0 && !(last[-1] < key)) {
+		return (uint32_t)(std::lower_bound(first, last, key) - first);
+	}
+
+	uint32_t second_run = rh->count - first_run;
+	return first_run + (uint32_t)(std::lower_bound(keys, keys + second_run, key) - keys);
+}
+
+static uint32_t
+lower_bound(const struct m_relation_history *rh, uint64_t timestamp)
+{
+	if (!rh->compact) {
+		return ring_lower_bound(rh, rh->timestamps.data(), timestamp);
+	}
+	if (timestamp <= rh->time_base) {
+		return 0;
+	}
+	if (timestamp - rh->time_base > UINT32_MAX) {
+		return rh->count;
+	}
+	return ring_lower_bound(rh, rh->time_offsets.data(), (uint32_t)(timestamp - rh->time_base));
+}
+
+/*!
+ * Starts a new keyframe at @p position for the group @p slot is in, the
+ * entries already written to the group are encoded again against it. Those
+ * that are too far away for their position step get a coarser one.
+ */
+static void
+rekey_group(struct m_relation_history *rh, uint32_t slot, const struct xrt_vec3 &position)
+{
+	uint32_t group = slot / kCompactGroupSize;
+	uint32_t first = slot - std::min(rh->count, slot - group * kCompactGroupSize);
+
+	for (uint32_t s = first; s < slot; s++) {
+		compact_relation &c = rh->compact_relations[s];
+		xrt_vec3 offset =
+		    rh->keyframes[group] + dequantize_vec3(c.position, position_scale(c.position_shift)) - position;
+
+		while (c.position_shift < kCompactMaxPositionShift &&
+		       !fits_quantized(offset, position_scale(c.position_shift))) {
+			c.position_shift++;
+		}
+		quantize_vec3(offset, position_scale(c.position_shift), c.position);
+	}
+
+	rh->keyframes[group] = position;
+}
+
+static void
+push_compact(struct m_relation_history *rh, const struct xrt_space_relation *in_relation, uint64_t timestamp)
+{
+	if (rh->count == 0) {
+		rh->time_base = timestamp;
+	}
+
+	// Entries that can't be reached with a 32-bit offset from the new one are dropped.
+	if (timestamp - rh->time_base > UINT32_MAX) {
+		while (rh->count > 0 && timestamp - timestamp_at(rh, 0) > UINT32_MAX) {
+			pop_front(rh);
+		}
+
+		uint64_t new_base = rh->count > 0 ? timestamp_at(rh, 0) : timestamp;
+		uint32_t shift = (uint32_t)(new_base - rh->time_base);
+		for (uint32_t i = 0; i < rh->count; i++) {
+			rh->time_offsets[slot_of(rh, i)] -= shift;
+		}
+		rh->time_base = new_base;
+	}
+
+	if (rh->count == rh->capacity) {
+		pop_front(rh);
+	}
+
+	uint32_t slot = slot_of(rh, rh->count);
+	uint32_t group = slot / kCompactGroupSize;
+
+	if (slot % kCompactGroupSize == 0) {
+		// A new keyframe, older entries left in this group would decode against it.
+		uint32_t group_end = std::min(slot + kCompactGroupSize, rh->capacity);
+		while (rh->count > 0 && rh->head > slot && rh->head < group_end) {
+			pop_front(rh);
+		}
+		rh->keyframes[group] = in_relation->pose.position;
+	}
+
+	// Rather than clamping a jump, start a new keyframe at it.
+	const xrt_vec3 &position = in_relation->pose.position;
+	if (!fits_quantized(position - rh->keyframes[group], kCompactPositionScale)) {
+		rekey_group(rh, slot, position);
+	}
+
+	compact_relation &c = rh->compact_relations[slot];
+
+	// Drop the largest component of the orientation, flipped to be positive.
+	const xrt_quat &in_q = in_relation->pose.orientation;
+	const float q[4] = {in_q.x, in_q.y, in_q.z, in_q.w};
+	int largest = 0;
+	for (int i = 1; i < 4; i++) {
+		if (std::fabs(q[i]) > std::fabs(q[largest])) {
+			largest = i;
+		}
+	}
+	float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+	for (int i = 0, k = 0; i < 4; i++) {
+		if (i != largest) {
+			c.orientation[k++] = quantize(sign * q[i], kCompactOrientationScale);
+		}
+	}
+
+	quantize_vec3(position - rh->keyframes[group], kCompactPositionScale, c.position);
+	quantize_vec3(in_relation->linear_velocity, kCompactLinearVelocityScale, c.linear_velocity);
+	quantize_vec3(in_relation->angular_velocity, kCompactAngularVelocityScale, c.angular_velocity);
+	c.flags = (uint8_t)((in_relation->relation_flags & kCompactFlagsMask) | (largest << kCompactLargestShift));
+	c.position_shift = 0;
+
+	rh->time_offsets[slot] = (uint32_t)(timestamp - rh->time_base);
+	rh->count++;
+}
+
+static void
+push_full(struct m_relation_history *rh, const struct xrt_space_relation *in_relation, uint64_t timestamp)
+{
+	if (rh->count == rh->capacity) {
+		pop_front(rh);
+	}
+
+	uint32_t slot = slot_of(rh, rh->count);
+	rh->relations[slot] = *in_relation;
+	rh->timestamps[slot] = timestamp;
+	rh->count++;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
 
 void
 m_relation_history_create(struct m_relation_history **rh_ptr)
+{
+	m_relation_history_create_with_capacity(rh_ptr, M_RELATION_HISTORY_DEFAULT_CAPACITY,
+	                                        M_RELATION_HISTORY_ENCODING_FULL);
+}
+
+void
+m_relation_history_create_with_capacity(struct m_relation_history **rh_ptr,
+                                        uint32_t capacity,
+                                        enum m_relation_history_encoding encoding)
 {
 	auto ret = std::make_unique<m_relation_history>();
+	m_predict_params_default(&ret->predict);
+
+	ret->capacity = std::max(capacity, 1u);
+	ret->compact = encoding == M_RELATION_HISTORY_ENCODING_COMPACT;
+
+	if (ret->compact) {
+		ret->time_offsets.resize(ret->capacity);
+		ret->compact_relations.resize(ret->capacity);
+		ret->keyframes.resize((ret->capacity + kCompactGroupSize - 1) / kCompactGroupSize);
+	} else {
+		ret->timestamps.resize(ret->capacity);
+		ret->relations.resize(ret->capacity);
+	}
+
 	*rh_ptr = ret.release();
 }
 
+void
+m_relation_history_set_predict_params(struct m_relation_history *rh, const struct m_predict_params *params)
+{
+	std::unique_lock<os::Mutex> lock(rh->mutex);
+	rh->predict = *params;
+}
+
+bool
+m_relation_history_set_predict_model_from_string(struct m_relation_history *rh, const char *str)
+{
+	if (str == NULL) {
+		return false;
+	}
+
+	struct m_predict_params params;
+	m_predict_params_default(&params);
+	if (!m_predict_params_from_string(str, &params)) {
+		U_LOG_W("Unknown prediction model '%s', keeping the current one", str);
+		return false;
+	}
+
+	m_relation_history_set_predict_params(rh, &params);
+	return true;
+}
+
 bool
 m_relation_history_push(struct m_relation_history *rh, struct xrt_space_relation const *in_relation, uint64_t timestamp)
 {
 	XRT_TRACE_MARKER();
-	struct relation_history_entry rhe;
-	rhe.relation = *in_relation;
-	rhe.timestamp = timestamp;
 	bool ret = false;
 	std::unique_lock<os::Mutex> lock(rh->mutex);
 	try {
 		// if we aren't empty, we can compare against the latest timestamp.
-		if (rh->impl.empty() || rhe.timestamp > rh->impl.back().timestamp) {
+		if (rh->count == 0 || timestamp > timestamp_at(rh, rh->count - 1)) {
 			// Everything explodes if the timestamps in relation_history aren't monotonically increasing. If
 			// we get a timestamp that's before the most recent timestamp in the buffer, don't put it
 			// in the history.
-			rh->impl.push_back(rhe);
+			if (rh->compact) {
+				push_compact(rh, in_relation, timestamp);
+			} else {
+				push_full(rh, in_relation, timestamp);
+			}
 			ret = true;
 		}
 	} catch (std::exception const &e) {
@@ -88,58 +448,77 @@ m_relation_history_get(const struct m_relation_history *rh,
 	XRT_TRACE_MARKER();
 	std::unique_lock<os::Mutex> lock(rh->mutex);
 	try {
-		if (rh->impl.empty() || at_timestamp_ns == 0) {
+		if (rh->count == 0 || at_timestamp_ns == 0) {
 			// Do nothing. You push nothing to the buffer you get nothing from the buffer.
 			*out_relation = {};
 			return M_RELATION_HISTORY_RESULT_INVALID;
 		}
-		const auto b = rh->impl.begin();
-		const auto e = rh->impl.end();
+		// Find the first element *not less than* our value.
+		const uint32_t it = lower_bound(rh, at_timestamp_ns);
 
-		// Find the first element *not less than* our value. the lambda we pass is the comparison
-		// function, to compare against timestamps.
-		const auto it =
-		    std::lower_bound(b, e, at_timestamp_ns, [](const relation_history_entry &rhe, uint64_t timestamp) {
-			    return rhe.timestamp < timestamp;
-		    });
-
-		if (it == e) {
+		if (it == rh->count) {
 			// lower bound is at the end:
 			// The desired timestamp is after what our buffer contains.
 			// (pose-prediction)
 			// Output flags match the most recent buffer entry.
-			int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - rh->impl.back().timestamp;
+			int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - timestamp_at(rh, it - 1);
 			double delta_s = time_ns_to_s(diff_prediction_ns);
 
 			U_LOG_T("Extrapolating %f s past the back of the buffer!", delta_s);
 
-			m_predict_relation(&rh->impl.back().relation, delta_s, out_relation);
+			if (rh->predict.model == M_PREDICT_MODEL_CONSTANT_VELOCITY) {
+				xrt_space_relation back;
+				relation_at(rh, it - 1, &back);
+				m_predict_relation(&back, delta_s, out_relation);
+			} else {
+				// The models may look at the recent entries.
+				xrt_space_relation samples[M_PREDICT_MAX_SAMPLES];
+				uint64_t timestamps[M_PREDICT_MAX_SAMPLES];
+				uint32_t count = std::min(rh->predict.sample_count, (uint32_t)M_PREDICT_MAX_SAMPLES);
+				count = std::max(std::min(count, rh->count), 1u);
+				for (uint32_t i = 0; i < count; i++) {
+					relation_at(rh, rh->count - count + i, &samples[i]);
+					timestamps[i] = timestamp_at(rh, rh->count - count + i);
+				}
+				m_predict_relation_from_samples(&rh->predict, samples, timestamps, count, delta_s,
+				                                out_relation);
+			}
 			return M_RELATION_HISTORY_RESULT_PREDICTED;
 		}
-		if (at_timestamp_ns == it->timestamp) {
+		const uint64_t it_timestamp = timestamp_at(rh, it);
+		if (at_timestamp_ns == it_timestamp) {
 			// exact match:
 			// Flags copied directly along with everything else.
 			U_LOG_T("Exact match in the buffer!");
-			*out_relation = it->relation;
+			relation_at(rh, it, out_relation);
 			return M_RELATION_HISTORY_RESULT_EXACT;
 		}
-		if (it == b) {
+		if (it == 0) {
 			// lower bound is at the beginning (and it's not an exact match):
 			// The desired timestamp is before what our buffer contains.
 			// (an edge case where somebody asks for a really old pose and we do our best)
 			// Output flags are the same as the input flags for the history entry we use
-			int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - rh->impl.front().timestamp;
+			int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - it_timestamp;
 			double delta_s = time_ns_to_s(diff_prediction_ns);
 			U_LOG_T("Extrapolating %f s before the front of the buffer!", delta_s);
-			m_predict_relation(&rh->impl.front().relation, delta_s, out_relation);
+			xrt_space_relation front;
+			relation_at(rh, it, &front);
+			m_predict_relation(&front, delta_s, out_relation);
 			return M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED;
 		}
 		U_LOG_T("Interpolating within buffer!");
 
-		// We precede *it and follow *(it - 1) (which we know exists because we already handled
-		// the it = begin() case)
-		const auto &predecessor = *(it - 1);
-		const auto &successor = *it;
+		// We precede it and follow it - 1 (which we know exists because we already handled
+		// the it = 0 case)
+		struct
+		{
+			xrt_space_relation relation;
+			uint64_t timestamp;
+		} predecessor, successor;
+		relation_at(rh, it - 1, &predecessor.relation);
+		predecessor.timestamp = timestamp_at(rh, it - 1);
+		relation_at(rh, it, &successor.relation);
+		successor.timestamp = it_timestamp;
 
 		// Do the thing.
 		int64_t diff_before = static_cast<int64_t>(at_timestamp_ns) - predecessor.timestamp;
@@ -233,11 +612,11 @@ m_relation_history_get_latest(const struct m_relation_history *rh,
                               struct xrt_space_relation *out_relation)
 {
 	std::unique_lock<os::Mutex> lock(rh->mutex);
-	if (rh->impl.empty()) {
+	if (rh->count == 0) {
 		return false;
 	}
-	*out_relation = rh->impl.back().relation;
-	*out_time_ns = rh->impl.back().timestamp;
+	relation_at(rh, rh->count - 1, out_relation);
+	*out_time_ns = timestamp_at(rh, rh->count - 1);
 	return true;
 }
 
@@ -245,14 +624,34 @@ uint32_t
 m_relation_history_get_size(const struct m_relation_history *rh)
 {
 	std::unique_lock<os::Mutex> lock(rh->mutex);
-	return (uint32_t)rh->impl.size();
+	return rh->count;
+}
+
+size_t
+m_relation_history_get_memory_size(const struct m_relation_history *rh)
+{
+	// Only one encoding is allocated, the other vectors are empty.
+	return sizeof(*rh) +                                                   //
+	       rh->timestamps.capacity() * sizeof(uint64_t) +                  //
+	       rh->relations.capacity() * sizeof(xrt_space_relation) +         //
+	       rh->time_offsets.capacity() * sizeof(uint32_t) +                //
+	       rh->compact_relations.capacity() * sizeof(compact_relation) +   //
+	       rh->keyframes.capacity() * sizeof(xrt_vec3);
 }
 
 void
 m_relation_history_clear(struct m_relation_history *rh)
 {
 	std::unique_lock<os::Mutex> lock(rh->mutex);
-	rh->impl.clear();
+	rh->head = 0;
+	rh->count = 0;
+}
+
+void
+m_relation_history_truncate(struct m_relation_history *rh, uint64_t timestamp)
+{
+	std::unique_lock<os::Mutex> lock(rh->mutex);
+	rh->count = lower_bound(rh, timestamp);
 }
 
 void
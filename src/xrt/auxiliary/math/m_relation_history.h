@@ -13,6 +13,8 @@
 
 #include "xrt/xrt_defines.h"
 
+#include "math/m_predict.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -42,14 +44,71 @@ enum m_relation_history_result
 	M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED, //!< The desired timestamp was older than the oldest entry
 };
 
+/**
+ * @brief How the entries of a @ref m_relation_history are stored.
+ *
+ * @relates m_relation_history
+ */
+enum m_relation_history_encoding
+{
+	//! Full precision relations.
+	M_RELATION_HISTORY_ENCODING_FULL = 0,
+
+	/*!
+	 * Orientations as the three smallest quaternion components, quantized
+	 * velocities, positions as 0.1 mm offsets from a keyframe every 16
+	 * entries and timestamps as 32-bit offsets. Entries are less than half
+	 * the size, but entries more than ~4.29 seconds older than the newest one
+	 * are dropped. A jump of more than ~3.2 meters starts a new keyframe, the
+	 * entries before it in the same 16 may lose some position precision.
+	 */
+	M_RELATION_HISTORY_ENCODING_COMPACT,
+};
+
+//! Number of entries in a history made with @ref m_relation_history_create.
+#define M_RELATION_HISTORY_DEFAULT_CAPACITY (4096)
+
 /*!
- * Creates an opaque relation_history object.
+ * Creates an opaque relation_history object, with full precision and
+ * @ref M_RELATION_HISTORY_DEFAULT_CAPACITY entries.
  *
  * @public @memberof m_relation_history
  */
 void
 m_relation_history_create(struct m_relation_history **rh);
 
+/*!
+ * Creates an opaque relation_history object holding at most @p capacity
+ * entries, stored with the given encoding.
+ *
+ * @public @memberof m_relation_history
+ */
+void
+m_relation_history_create_with_capacity(struct m_relation_history **rh,
+                                        uint32_t capacity,
+                                        enum m_relation_history_encoding encoding);
+
+/*!
+ * Sets the motion model used when a relation past the newest entry is asked
+ * for, the default is constant velocity.
+ *
+ * @public @memberof m_relation_history
+ */
+void
+m_relation_history_set_predict_params(struct m_relation_history *rh, const struct m_predict_params *params);
+
+/*!
+ * Sets the model used past the newest entry from a name as accepted by
+ * @ref m_predict_params_from_string, usually a driver's debug option. A NULL
+ * @p str keeps the current model, an unknown one is warned about.
+ *
+ * @return false if @p str is NULL or not a known model.
+ *
+ * @public @memberof m_relation_history
+ */
+bool
+m_relation_history_set_predict_model_from_string(struct m_relation_history *rh, const char *str);
+
 /*!
  * Pushes a new pose to the history.
  *
@@ -117,6 +176,14 @@ m_relation_history_get_latest(const struct m_relation_history *rh,
 uint32_t
 m_relation_history_get_size(const struct m_relation_history *rh);
 
+/*!
+ * Returns the number of bytes used by the history, for memory budgeting.
+ *
+ * @public @memberof m_relation_history
+ */
+size_t
+m_relation_history_get_memory_size(const struct m_relation_history *rh);
+
 /*!
  * Clears the history from all of the items.
  *
@@ -125,6 +192,15 @@ m_relation_history_get_size(const struct m_relation_history *rh);
 void
 m_relation_history_clear(struct m_relation_history *rh);
 
+/*!
+ * Removes the items at or newer than @p timestamp, so relations for that time
+ * and on can be pushed again.
+ *
+ * @public @memberof m_relation_history
+ */
+void
+m_relation_history_truncate(struct m_relation_history *rh, uint64_t timestamp);
+
 /*!
  * Destroys an opaque relation_history object.
  *
@@ -162,6 +238,9 @@ private:
 public:
 	// clang-format off
 	RelationHistory() noexcept { m_relation_history_create(&mPtr); }
+	RelationHistory(uint32_t capacity, m_relation_history_encoding encoding) noexcept {
+		m_relation_history_create_with_capacity(&mPtr, capacity, encoding);
+	}
 	~RelationHistory() { m_relation_history_destroy(&mPtr); }
 	// clang-format on
 
@@ -210,6 +289,24 @@ public:
 		return m_relation_history_get_size(mPtr);
 	}
 
+	/*!
+	 * @copydoc m_relation_history_get_memory_size
+	 */
+	size_t
+	memory_size() const noexcept
+	{
+		return m_relation_history_get_memory_size(mPtr);
+	}
+
+	/*!
+	 * @copydoc m_relation_history_set_predict_params
+	 */
+	void
+	set_predict_params(const m_predict_params &params) noexcept
+	{
+		m_relation_history_set_predict_params(mPtr, &params);
+	}
+
 	/*!
 	 * @copydoc m_relation_history_clear
 	 */
@@ -218,6 +315,15 @@ public:
 	{
 		return m_relation_history_clear(mPtr);
 	}
+
+	/*!
+	 * @copydoc m_relation_history_truncate
+	 */
+	void
+	truncate(uint64_t ts) noexcept
+	{
+		return m_relation_history_truncate(mPtr, ts);
+	}
 };
 
 } // namespace xrt::auxiliary::math
@@ -10,12 +10,14 @@
 #include "util/u_misc.h"
 
 #include "math/m_api.h"
+#include "math/m_batch.h"
 #include "math/m_vec2.h"
 #include "math/m_vec3.h"
 #include "math/m_space.h"
 
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 
 
 /*
@@ -256,6 +258,180 @@ apply_relation(const struct xrt_space_relation *a,
 	*out_relation = tmp;
 }
 
+/*!
+ * Same as pushing @p relation and the steps of @p xrc to a chain and
+ * resolving it, without the copy and the chain capacity limit.
+ */
+static void
+resolve_one(const struct xrt_relation_chain *xrc,
+            const struct xrt_space_relation *relation,
+            struct xrt_space_relation *out_relation)
+{
+	const int pose_flags = XRT_SPACE_RELATION_POSITION_VALID_BIT | XRT_SPACE_RELATION_ORIENTATION_VALID_BIT;
+
+	if ((relation->relation_flags & pose_flags) == 0) {
+		*out_relation = XRT_SPACE_RELATION_ZERO;
+		return;
+	}
+
+	struct xrt_space_relation r = *relation;
+	for (uint32_t i = 0; i < xrc->step_count; i++) {
+		apply_relation(&r, &xrc->steps[i], &r);
+	}
+
+	math_quat_normalize(&r.pose.orientation);
+
+	*out_relation = r;
+}
+
+/*!
+ * Number of relations @ref m_relation_chain_resolve_batch works on at once,
+ * enough for all the joints of a hand.
+ */
+#define BATCH_SIZE (32)
+
+/*!
+ * Structure-of-arrays storage for @ref BATCH_SIZE relations.
+ */
+struct relation_batch
+{
+	float orientation[4][BATCH_SIZE];
+	float position[3][BATCH_SIZE];
+	float linear_velocity[3][BATCH_SIZE];
+	float angular_velocity[3][BATCH_SIZE];
+
+	struct m_relation_soa soa;
+};
+
+static void
+relation_batch_init(struct relation_batch *b)
+{
+	b->soa.pose.orientation = {b->orientation[0], b->orientation[1], b->orientation[2], b->orientation[3]};
+	b->soa.pose.position = {b->position[0], b->position[1], b->position[2]};
+	b->soa.linear_velocity = {b->linear_velocity[0], b->linear_velocity[1], b->linear_velocity[2]};
+	b->soa.angular_velocity = {b->angular_velocity[0], b->angular_velocity[1], b->angular_velocity[2]};
+}
+
+static void
+relation_batch_load(struct relation_batch *b, const struct xrt_space_relation *relations, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		const struct xrt_space_relation *r = &relations[i];
+		b->orientation[0][i] = r->pose.orientation.x;
+		b->orientation[1][i] = r->pose.orientation.y;
+		b->orientation[2][i] = r->pose.orientation.z;
+		b->orientation[3][i] = r->pose.orientation.w;
+		b->position[0][i] = r->pose.position.x;
+		b->position[1][i] = r->pose.position.y;
+		b->position[2][i] = r->pose.position.z;
+		b->linear_velocity[0][i] = r->linear_velocity.x;
+		b->linear_velocity[1][i] = r->linear_velocity.y;
+		b->linear_velocity[2][i] = r->linear_velocity.z;
+		b->angular_velocity[0][i] = r->angular_velocity.x;
+		b->angular_velocity[1][i] = r->angular_velocity.y;
+		b->angular_velocity[2][i] = r->angular_velocity.z;
+	}
+}
+
+static void
+relation_batch_store(const struct relation_batch *b,
+                     enum xrt_space_relation_flags relation_flags,
+                     struct xrt_space_relation *out_relations,
+                     uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		struct xrt_space_relation *r = &out_relations[i];
+		r->relation_flags = relation_flags;
+		r->pose.orientation.x = b->orientation[0][i];
+		r->pose.orientation.y = b->orientation[1][i];
+		r->pose.orientation.z = b->orientation[2][i];
+		r->pose.orientation.w = b->orientation[3][i];
+		r->pose.position.x = b->position[0][i];
+		r->pose.position.y = b->position[1][i];
+		r->pose.position.z = b->position[2][i];
+		r->linear_velocity.x = b->linear_velocity[0][i];
+		r->linear_velocity.y = b->linear_velocity[1][i];
+		r->linear_velocity.z = b->linear_velocity[2][i];
+		r->angular_velocity.x = b->angular_velocity[0][i];
+		r->angular_velocity.y = b->angular_velocity[1][i];
+		r->angular_velocity.z = b->angular_velocity[2][i];
+	}
+}
+
+static void
+fill(float *values, float value, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		values[i] = value;
+	}
+}
+
+/*!
+ * Batch version of @ref resolve_one for relations that all have the same
+ * flags, the flags make the same decisions as @ref apply_relation does.
+ */
+static void
+resolve_uniform(const struct xrt_relation_chain *xrc,
+                const struct xrt_space_relation *relations,
+                struct xrt_space_relation *out_relations,
+                uint32_t count)
+{
+	struct relation_batch b;
+	relation_batch_init(&b);
+	relation_batch_load(&b, relations, count);
+
+	flags f = get_flags(&relations[0]);
+	int relation_flags = relations[0].relation_flags & XRT_SPACE_RELATION_BITMASK_ALL;
+
+	for (uint32_t s = 0; s < xrc->step_count; s++) {
+		const struct xrt_space_relation *step = &xrc->steps[s];
+		flags sf = get_flags(step);
+
+		// Same as make_valid_pose on the body.
+		if (!f.has_orientation) {
+			fill(b.orientation[0], 0.0f, count);
+			fill(b.orientation[1], 0.0f, count);
+			fill(b.orientation[2], 0.0f, count);
+			fill(b.orientation[3], 1.0f, count);
+		}
+		if (!f.has_position) {
+			fill(b.position[0], 0.0f, count);
+			fill(b.position[1], 0.0f, count);
+			fill(b.position[2], 0.0f, count);
+		}
+
+		bool has_linear_velocity = f.has_linear_velocity && sf.has_linear_velocity;
+		bool has_angular_velocity = f.has_angular_velocity && sf.has_angular_velocity;
+
+		// The base angular velocity also gives the lever arm effect, only add it if passed on.
+		struct xrt_space_relation base = *step;
+		make_valid_pose(sf, &step->pose, &base.pose);
+		if (!has_angular_velocity) {
+			base.angular_velocity = XRT_VEC3_ZERO;
+		}
+
+		m_batch_relation_apply_single(&base, &b.soa, &b.soa, count);
+
+		if (!has_linear_velocity) {
+			memset(b.linear_velocity, 0, sizeof(b.linear_velocity));
+		}
+		if (!has_angular_velocity) {
+			memset(b.angular_velocity, 0, sizeof(b.angular_velocity));
+		}
+
+		relation_flags &= step->relation_flags;
+		f.has_orientation = f.has_orientation && sf.has_orientation;
+		f.has_position = f.has_position && sf.has_position;
+		f.has_linear_velocity = has_linear_velocity;
+		f.has_angular_velocity = has_angular_velocity;
+	}
+
+	// Ensure no errors have crept in.
+	m_batch_quat_normalize(&b.soa.pose.orientation, count);
+
+	relation_batch_store(&b, (enum xrt_space_relation_flags)relation_flags, out_relations, count);
+}
+
 
 /*
  *
@@ -324,3 +500,39 @@ m_space_relation_interpolate(struct xrt_space_relation *a,
 		out_relation->angular_velocity = m_vec3_lerp(a->angular_velocity, b->angular_velocity, t);
 	}
 }
+
+extern "C" void
+m_relation_chain_resolve_batch(const struct xrt_relation_chain *xrc,
+                               const struct xrt_space_relation *relations,
+                               struct xrt_space_relation *out_relations,
+                               uint32_t count)
+{
+	if (has_step_with_no_pose(xrc)) {
+		for (uint32_t i = 0; i < count; i++) {
+			out_relations[i] = XRT_SPACE_RELATION_ZERO;
+		}
+		return;
+	}
+
+	const int pose_flags = XRT_SPACE_RELATION_POSITION_VALID_BIT | XRT_SPACE_RELATION_ORIENTATION_VALID_BIT;
+
+	for (uint32_t start = 0; start < count; start += BATCH_SIZE) {
+		uint32_t batch_count = MIN(count - start, (uint32_t)BATCH_SIZE);
+		const struct xrt_space_relation *in = &relations[start];
+		struct xrt_space_relation *out = &out_relations[start];
+
+		bool uniform = (in[0].relation_flags & pose_flags) != 0;
+		for (uint32_t i = 1; i < batch_count && uniform; i++) {
+			uniform = in[i].relation_flags == in[0].relation_flags;
+		}
+
+		if (uniform) {
+			resolve_uniform(xrc, in, out, batch_count);
+			continue;
+		}
+
+		for (uint32_t i = 0; i < batch_count; i++) {
+			resolve_one(xrc, &in[i], &out[i]);
+		}
+	}
+}
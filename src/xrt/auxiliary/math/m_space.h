@@ -220,6 +220,23 @@ m_relation_chain_push_inverted_pose_if_not_identity(struct xrt_relation_chain *x
 void
 m_relation_chain_resolve(const struct xrt_relation_chain *xrc, struct xrt_space_relation *out_relation);
 
+/*!
+ * Resolve @p count chains at once, each made of one of the relations in
+ * @p relations followed by the steps of @p xrc. Gives the same result as
+ * pushing the relation and then the steps to an empty chain and calling
+ * @ref m_relation_chain_resolve, but uses the @ref aux_math_batch functions
+ * for relations that share the same flags, like the joints of a hand.
+ *
+ * @p out_relations may be the same array as @p relations.
+ *
+ * @public @memberof xrt_relation_chain
+ */
+void
+m_relation_chain_resolve_batch(const struct xrt_relation_chain *xrc,
+                               const struct xrt_space_relation *relations,
+                               struct xrt_space_relation *out_relations,
+                               uint32_t count);
+
 /*!
  * @}
  */
@@ -0,0 +1,112 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Run-length blob detector for thresholded LED and ball images.
+ * @ingroup aux_tracking
+ */
+
+#pragma once
+
+#ifndef __cplusplus
+#error "This header is C++-only."
+#endif
+
+#include "tracking/t_tracking.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cmath>
+#include <cassert>
+#include <vector>
+
+
+namespace xrt::auxiliary::tracking {
+
+/*!
+ * Finds bright blobs in a grey image via @ref t_rle_encode_l8_row,
+ * @ref t_rle_find_blobs and @ref t_rle_merge_blobs, a single threshold
+ * replacement for cv::SimpleBlobDetector that keeps its buffers between frames.
+ */
+struct RleBlobDetector
+{
+public:
+	//! Pixels brighter than this are part of a blob.
+	uint8_t threshold = 32;
+
+	//! Blobs with fewer or more pixels than these are dropped.
+	uint32_t min_area = 1;
+	uint32_t max_area = UINT32_MAX;
+
+	/*!
+	 * Blobs covering less than this fraction of their bounding box are
+	 * dropped, a cheap stand-in for a convexity filter, zero disables it.
+	 */
+	float min_fill = 0.0f;
+
+	/*!
+	 * Blobs with centroids closer than this many pixels are merged, like
+	 * minDistBetweenBlobs of cv::SimpleBlobDetector, zero disables it.
+	 */
+	float min_dist = 5.0f;
+
+
+	RleBlobDetector() = default;
+	RleBlobDetector(const RleBlobDetector &) = delete;
+	RleBlobDetector &
+	operator=(const RleBlobDetector &) = delete;
+
+	~RleBlobDetector()
+	{
+		t_rle_blob_finder_destroy(&finder);
+	}
+
+	void
+	detect(const cv::Mat &grey, std::vector<cv::KeyPoint> &out_keypoints)
+	{
+		assert(grey.type() == CV_8UC1);
+
+		out_keypoints.clear();
+
+		// Worst case is every other pixel lit.
+		size_t max_spans = (size_t)grey.rows * (grey.cols / 2 + 1);
+		if (spans.size() < max_spans) {
+			spans.resize(max_spans);
+		}
+
+		uint32_t count = 0;
+		for (int y = 0; y < grey.rows; y++) {
+			count += t_rle_encode_l8_row(grey.ptr<uint8_t>(y), grey.cols, threshold, (uint16_t)y,
+			                             spans.data() + count, (uint32_t)(spans.size() - count));
+		}
+
+		if (blobs.size() < count) {
+			blobs.resize(count);
+		}
+
+		uint32_t blob_count = t_rle_find_blobs(&finder, spans.data(), count, min_area, max_area, blobs.data(),
+		                                       (uint32_t)blobs.size());
+
+		blob_count = t_rle_merge_blobs(blobs.data(), blob_count, min_dist);
+
+		for (uint32_t i = 0; i < blob_count; i++) {
+			const t_rle_blob &b = blobs[i];
+
+			float box = (float)(b.max_x - b.min_x + 1) * (float)(b.max_y - b.min_y + 1);
+			if ((float)b.area < min_fill * box) {
+				continue;
+			}
+
+			float diameter = 2.0f * std::sqrt((float)b.area / (float)M_PI);
+			out_keypoints.emplace_back(cv::Point2f(b.x, b.y), diameter);
+		}
+	}
+
+
+	// All public, embedded in trackers that have to be standard layout.
+	std::vector<t_rle_span> spans;
+	std::vector<t_rle_blob> blobs;
+	t_rle_blob_finder finder = {};
+};
+
+} // namespace xrt::auxiliary::tracking
@@ -15,12 +15,15 @@
 #include "util/u_frame.h"
 #include "util/u_format.h"
 #include "util/u_logging.h"
+#include "util/u_worker.h"
 
 #include "tracking/t_tracking.h"
 #include "tracking/t_calibration_opencv.hpp"
 
 #include <opencv2/opencv.hpp>
 #include <sys/stat.h>
+#include <algorithm>
+#include <thread>
 #include <utility>
 
 #if CV_MAJOR_VERSION >= 4
@@ -35,6 +38,9 @@ DEBUG_GET_ONCE_BOOL_OPTION(hsv_filter, "T_DEBUG_HSV_FILTER", false)
 DEBUG_GET_ONCE_BOOL_OPTION(hsv_picker, "T_DEBUG_HSV_PICKER", false)
 DEBUG_GET_ONCE_BOOL_OPTION(hsv_viewer, "T_DEBUG_HSV_VIEWER", false)
 
+//! Cells per side of the grid used to measure how much of the image the board has covered.
+#define COVERAGE_GRID_SIZE (8)
+
 namespace xrt::auxiliary::tracking {
 /*
  *
@@ -83,6 +89,25 @@ struct ViewState
 	bool maps_valid = false;
 	cv::Mat map1 = {};
 	cv::Mat map2 = {};
+
+	//! Estimate refined as samples are collected, seeds the final calibration.
+	struct
+	{
+		bool valid = false;
+		cv::Mat intrinsics = {};
+		cv::Mat distortion = {};
+		double rp_error = 0.0;
+	} estimate;
+};
+
+/*!
+ * The board as found in a frame, one entry per view.
+ */
+struct Detection
+{
+	MeasurementF32 f32[2] = {};
+	MeasurementF64 f64[2] = {};
+	bool found[2] = {};
 };
 
 /*!
@@ -92,6 +117,11 @@ class Calibration
 {
 public:
 	struct xrt_frame_sink base = {};
+	struct xrt_frame_node node = {};
+
+	//! Board detection and refinement is spread over these.
+	struct u_worker_thread_pool *pool = nullptr;
+	struct u_worker_group *group = nullptr;
 
 	struct
 	{
@@ -133,6 +163,18 @@ public:
 		uint32_t num_images = 20;
 	} load;
 
+	struct
+	{
+		bool enabled = false;
+		uint32_t min_samples = 6;
+		float min_coverage = 0.7f;
+		float max_error_change = 0.02f;
+
+		//! Reprojection error of the previous refinement.
+		double last_rp_error = 0.0;
+		bool converged = false;
+	} incremental;
+
 	//! Should we use subpixel enhancing for checkerboard.
 	bool subpixel_enable = true;
 	//! What subpixel range for checkerboard enhancement.
@@ -293,7 +335,7 @@ do_view_coverage(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv
 }
 
 static bool
-do_view_chess(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv::Mat &rgb)
+detect_chess(class Calibration &c, cv::Mat &gray, MeasurementF32 &current_f32, MeasurementF64 &current_f64)
 {
 	/*
 	 * Fisheye requires measurement and model to be double, other functions
@@ -306,10 +348,10 @@ do_view_chess(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv::M
 	flags += cv::CALIB_CB_ADAPTIVE_THRESH;
 	flags += cv::CALIB_CB_NORMALIZE_IMAGE;
 
-	bool found = cv::findChessboardCorners(gray,             // Image
-	                                       c.board.dims,     // patternSize
-	                                       view.current_f32, // corners
-	                                       flags);           // flags
+	bool found = cv::findChessboardCorners(gray,         // Image
+	                                       c.board.dims, // patternSize
+	                                       current_f32,  // corners
+	                                       flags);       // flags
 
 	// Improve the corner positions.
 	if (found && c.subpixel_enable) {
@@ -321,23 +363,21 @@ do_view_chess(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv::M
 		cv::Size size(c.subpixel_size, c.subpixel_size);
 		cv::Size zero(-1, -1);
 
-		cv::cornerSubPix(gray, view.current_f32, size, zero, term_criteria);
+		cv::cornerSubPix(gray, current_f32, size, zero, term_criteria);
 	}
 
 	// Do the conversion here.
-	view.current_f64.clear(); // Doesn't effect capacity.
-	for (const cv::Point2f &p : view.current_f32) {
-		view.current_f64.emplace_back(double(p.x), double(p.y));
+	current_f64.clear(); // Doesn't effect capacity.
+	for (const cv::Point2f &p : current_f32) {
+		current_f64.emplace_back(double(p.x), double(p.y));
 	}
 
-	do_view_coverage(c, view, gray, rgb, found);
-
 	return found;
 }
 
 #ifdef SB_CHEESBOARD_CORNERS_SUPPORTED
 static bool
-do_view_sb_checkers(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv::Mat &rgb)
+detect_sb_checkers(class Calibration &c, cv::Mat &gray, MeasurementF32 &current_f32, MeasurementF64 &current_f64)
 {
 	/*
 	 * Fisheye requires measurement and model to be double, other functions
@@ -357,25 +397,23 @@ do_view_sb_checkers(class Calibration &c, struct ViewState &view, cv::Mat &gray,
 	}
 #endif
 
-	bool found = cv::findChessboardCornersSB(gray,             // Image
-	                                         c.board.dims,     // patternSize
-	                                         view.current_f32, // corners
-	                                         flags);           // flags
+	bool found = cv::findChessboardCornersSB(gray,         // Image
+	                                         c.board.dims, // patternSize
+	                                         current_f32,  // corners
+	                                         flags);       // flags
 
 	// Do the conversion here.
-	view.current_f64.clear(); // Doesn't effect capacity.
-	for (const cv::Point2f &p : view.current_f32) {
-		view.current_f64.emplace_back(double(p.x), double(p.y));
+	current_f64.clear(); // Doesn't effect capacity.
+	for (const cv::Point2f &p : current_f32) {
+		current_f64.emplace_back(double(p.x), double(p.y));
 	}
 
-	do_view_coverage(c, view, gray, rgb, found);
-
 	return found;
 }
 #endif
 
 static bool
-do_view_circles(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv::Mat &rgb)
+detect_circles(class Calibration &c, cv::Mat &gray, MeasurementF32 &current_f32, MeasurementF64 &current_f64)
 {
 	/*
 	 * Fisheye requires measurement and model to be double, other functions
@@ -388,52 +426,85 @@ do_view_circles(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv:
 		flags |= cv::CALIB_CB_ASYMMETRIC_GRID;
 	}
 
-	bool found = cv::findCirclesGrid(gray,             // Image
-	                                 c.board.dims,     // patternSize
-	                                 view.current_f64, // corners
-	                                 flags);           // flags
+	bool found = cv::findCirclesGrid(gray,         // Image
+	                                 c.board.dims, // patternSize
+	                                 current_f64,  // corners
+	                                 flags);       // flags
 
 	// Convert here so that displaying also works.
-	view.current_f32.clear(); // Doesn't effect capacity.
-	for (const cv::Point2d &p : view.current_f64) {
-		view.current_f32.emplace_back(float(p.x), float(p.y));
+	current_f32.clear(); // Doesn't effect capacity.
+	for (const cv::Point2d &p : current_f64) {
+		current_f32.emplace_back(float(p.x), float(p.y));
 	}
 
-	do_view_coverage(c, view, gray, rgb, found);
-
 	return found;
 }
 
 static bool
-do_view(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv::Mat &rgb)
+detect_board(class Calibration &c, cv::Mat &gray, MeasurementF32 &current_f32, MeasurementF64 &current_f64)
 {
-	bool found = false;
-
 	switch (c.board.pattern) {
 	case T_BOARD_CHECKERS: //
-		found = do_view_chess(c, view, gray, rgb);
-		break;
+		return detect_chess(c, gray, current_f32, current_f64);
 #ifdef SB_CHEESBOARD_CORNERS_SUPPORTED
 	case T_BOARD_SB_CHECKERS: //
-		found = do_view_sb_checkers(c, view, gray, rgb);
-		break;
+		return detect_sb_checkers(c, gray, current_f32, current_f64);
 #endif
 	case T_BOARD_CIRCLES: //
-		found = do_view_circles(c, view, gray, rgb);
-		break;
+		return detect_circles(c, gray, current_f32, current_f64);
 	case T_BOARD_ASYMMETRIC_CIRCLES: //
-		found = do_view_circles(c, view, gray, rgb);
-		break;
+		return detect_circles(c, gray, current_f32, current_f64);
 	default: assert(false);
 	}
 
+	return false;
+}
+
+/*!
+ * Draws the board and coverage of a view the board has already been looked
+ * for in.
+ */
+static void
+draw_view(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv::Mat &rgb, bool found)
+{
+	do_view_coverage(c, view, gray, rgb, found);
+
 	if (c.mirror_rgb_image) {
 		cv::flip(rgb, rgb, +1);
 	}
+}
+
+static bool
+do_view(class Calibration &c, struct ViewState &view, cv::Mat &gray, cv::Mat &rgb)
+{
+	bool found = detect_board(c, gray, view.current_f32, view.current_f64);
+
+	draw_view(c, view, gray, rgb, found);
 
 	return found;
 }
 
+/*!
+ * Looks for the board in one view, so both views of a stereo frame can be
+ * searched at the same time.
+ */
+struct ViewTask
+{
+	class Calibration *c;
+	struct ViewState *view;
+	cv::Mat gray;
+	cv::Mat rgb;
+	bool found;
+};
+
+static void
+run_view_task(void *ptr)
+{
+	struct ViewTask &t = *(struct ViewTask *)ptr;
+
+	t.found = do_view(*t.c, *t.view, t.gray, t.rgb);
+}
+
 static void
 remap_view(class Calibration &c, struct ViewState &view, cv::Mat &rgb)
 {
@@ -559,6 +630,183 @@ moved_state_check(struct ViewState &view)
 	return moved;
 }
 
+/*
+ *
+ * Incremental refinement.
+ *
+ */
+
+/*!
+ * Fraction of the image covered by the boards collected so far, measured on a
+ * coarse grid so that a few large boards don't count as full coverage.
+ */
+static float
+view_coverage(const struct ViewState &view, cv::Size image_size)
+{
+	int covered = 0;
+	for (int y = 0; y < COVERAGE_GRID_SIZE; y++) {
+		for (int x = 0; x < COVERAGE_GRID_SIZE; x++) {
+			cv::Point center((2 * x + 1) * image_size.width / (2 * COVERAGE_GRID_SIZE),
+			                 (2 * y + 1) * image_size.height / (2 * COVERAGE_GRID_SIZE));
+
+			for (const cv::Rect &brect : view.measured_bounds) {
+				if (brect.contains(center)) {
+					covered++;
+					break;
+				}
+			}
+		}
+	}
+
+	return (float)covered / (float)(COVERAGE_GRID_SIZE * COVERAGE_GRID_SIZE);
+}
+
+struct RefineTask
+{
+	class Calibration *c;
+	struct ViewState *view;
+	cv::Size image_size;
+	bool stereo;
+};
+
+/*!
+ * Refines the estimate of one view with the samples collected so far, starting
+ * from the previous estimate. Uses the same model as the final calibration so
+ * it can be seeded from it.
+ */
+static void
+run_refine_task(void *ptr)
+{
+	struct RefineTask &t = *(struct RefineTask *)ptr;
+	class Calibration &c = *t.c;
+	struct ViewState &view = *t.view;
+
+	int crit_flag = 0;
+	crit_flag |= cv::TermCriteria::EPS;
+	crit_flag |= cv::TermCriteria::COUNT;
+	cv::TermCriteria term_criteria = {crit_flag, 20, 1e-6};
+
+	cv::Mat intrinsics_mat = view.estimate.intrinsics.clone();
+	cv::Mat distortion_mat = view.estimate.distortion.clone();
+	double rp_error = 0.0;
+
+	try {
+		if (c.use_fisheye) {
+			int flags = 0;
+			flags |= cv::fisheye::CALIB_FIX_SKEW;
+			flags |= cv::fisheye::CALIB_RECOMPUTE_EXTRINSIC;
+			if (view.estimate.valid) {
+				flags |= cv::fisheye::CALIB_USE_INTRINSIC_GUESS;
+			}
+
+			rp_error = cv::fisheye::calibrate(c.state.board_models_f64, // objectPoints
+			                                  view.measured_f64,        // imagePoints
+			                                  t.image_size,             // image_size
+			                                  intrinsics_mat,           // K (cameraMatrix 3x3)
+			                                  distortion_mat,           // D (distCoeffs 4x1)
+			                                  cv::noArray(),            // rvecs
+			                                  cv::noArray(),            // tvecs
+			                                  flags,                    // flags
+			                                  term_criteria);           // criteria
+		} else {
+			int flags = 0;
+			if (!t.stereo) {
+				// Same model as process_view_samples.
+				flags |= cv::CALIB_THIN_PRISM_MODEL;
+				flags |= cv::CALIB_RATIONAL_MODEL;
+				flags |= cv::CALIB_TILTED_MODEL;
+			}
+			if (view.estimate.valid) {
+				flags |= cv::CALIB_USE_INTRINSIC_GUESS;
+			}
+
+			rp_error = cv::calibrateCamera( //
+			    c.state.board_models_f32,   // objectPoints
+			    view.measured_f32,          // imagePoints
+			    t.image_size,               // imageSize
+			    intrinsics_mat,             // cameraMatrix
+			    distortion_mat,             // distCoeffs
+			    cv::noArray(),              // rvecs
+			    cv::noArray(),              // tvecs
+			    flags,                      // flags
+			    term_criteria);             // criteria
+		}
+	} catch (const cv::Exception &e) {
+		// Degenerate sets of samples are common early on, try again with more.
+		U_LOG_D("Refinement failed: %s", e.what());
+		view.estimate.valid = false;
+		return;
+	}
+
+	view.estimate.intrinsics = intrinsics_mat;
+	view.estimate.distortion = distortion_mat;
+	view.estimate.rp_error = rp_error;
+	view.estimate.valid = true;
+}
+
+/*!
+ * Refines the estimate of all views in parallel, and checks if coverage and
+ * reprojection error have converged.
+ */
+static void
+refine_estimates(class Calibration &c, int cols, int rows, bool stereo)
+{
+	cv::Size image_size = {cols, rows};
+	uint32_t view_count = stereo ? 2 : 1;
+
+	struct RefineTask tasks[2] = {
+	    {&c, &c.state.view[0], image_size, stereo},
+	    {&c, &c.state.view[1], image_size, stereo},
+	};
+
+	for (uint32_t i = 0; i < view_count; i++) {
+		u_worker_group_push(c.group, run_refine_task, &tasks[i]);
+	}
+	u_worker_group_wait_all(c.group);
+
+	bool valid = true;
+	double rp_error = 0.0;
+	float coverage = 1.0f;
+	for (uint32_t i = 0; i < view_count; i++) {
+		valid = valid && c.state.view[i].estimate.valid;
+		rp_error = std::max(rp_error, c.state.view[i].estimate.rp_error);
+		coverage = std::min(coverage, view_coverage(c.state.view[i], image_size));
+	}
+
+	double last = c.incremental.last_rp_error;
+	double change = last > 0.0 ? std::abs(rp_error - last) / last : 1.0;
+	c.incremental.last_rp_error = valid ? rp_error : 0.0;
+
+	c.incremental.converged =
+	    valid && coverage >= c.incremental.min_coverage && change <= c.incremental.max_error_change;
+
+	U_LOG_I("Refined with %u samples: rp_error %f (%.1f%% change) coverage %.0f%%%s",
+	        (uint32_t)c.state.board_models_f32.size(), rp_error, change * 100.0, coverage * 100.0f,
+	        c.incremental.converged ? ", converged" : "");
+
+	if (c.status != NULL) {
+		c.status->rp_error = (float)rp_error;
+		c.status->coverage = coverage;
+		c.status->converged = c.incremental.converged;
+	}
+}
+
+/*!
+ * Called after the capture logic, refines the estimate if a sample was
+ * collected and returns true if we have enough to do the final calibration.
+ */
+static bool
+update_collected(class Calibration &c, size_t num_before, int cols, int rows, bool stereo)
+{
+	size_t num = c.state.board_models_f32.size();
+
+	if (c.incremental.enabled && num > num_before && num >= c.incremental.min_samples) {
+		refine_estimates(c, cols, rows, stereo);
+	}
+
+	return num >= c.num_collect_total || c.incremental.converged;
+}
+
 /*
  *
  * Stereo calibration
@@ -567,6 +815,23 @@ moved_state_check(struct ViewState &view)
 
 #define P(...) snprintf(c.text, sizeof(c.text), __VA_ARGS__)
 
+/*!
+ * Copies the incremental estimate of a view into the calibration data,
+ * without reallocating the wrapped storage.
+ */
+static bool
+seed_from_estimate(const struct ViewState &view, CameraCalibrationWrapper &wrap)
+{
+	if (!view.estimate.valid || view.estimate.distortion.total() != wrap.distortion_mat.total()) {
+		return false;
+	}
+
+	view.estimate.intrinsics.copyTo(wrap.intrinsics_mat);
+	view.estimate.distortion.reshape(1, wrap.distortion_mat.rows).copyTo(wrap.distortion_mat);
+
+	return true;
+}
+
 XRT_NO_INLINE static void
 process_stereo_samples(class Calibration &c, int cols, int rows)
 {
@@ -580,12 +845,18 @@ process_stereo_samples(class Calibration &c, int cols, int rows)
 	wrapped.view[0].image_size_pixels.h = image_size.height;
 	wrapped.view[1].image_size_pixels = wrapped.view[0].image_size_pixels;
 
+	// Start from the incremental estimates, saves calibrating each view from scratch.
+	bool seeded = seed_from_estimate(c.state.view[0], wrapped.view[0]) && //
+	              seed_from_estimate(c.state.view[1], wrapped.view[1]);
 
 	float rp_error = 0.0f;
 	if (c.use_fisheye) {
 		int flags = 0;
 		flags |= cv::fisheye::CALIB_FIX_SKEW;
 		flags |= cv::fisheye::CALIB_RECOMPUTE_EXTRINSIC;
+		if (seeded) {
+			flags |= cv::fisheye::CALIB_USE_INTRINSIC_GUESS;
+		}
 
 		// fisheye version
 		rp_error = cv::fisheye::stereoCalibrate(c.state.board_models_f64,       // objectPoints
@@ -602,6 +873,9 @@ process_stereo_samples(class Calibration &c, int cols, int rows)
 	} else {
 		// non-fisheye version
 		int flags = 0;
+		if (seeded) {
+			flags |= cv::CALIB_USE_INTRINSIC_GUESS;
+		}
 
 		// Insists on 32-bit floats for object points and image points
 		rp_error = cv::stereoCalibrate(c.state.board_models_f32,       // objectPoints
@@ -671,6 +945,12 @@ process_view_samples(class Calibration &c, struct ViewState &view, int cols, int
 	cv::Mat new_intrinsics_mat = {};
 	cv::Mat distortion_mat = {};
 
+	// Start from the incremental estimate, if we have one.
+	if (view.estimate.valid) {
+		intrinsics_mat = view.estimate.intrinsics.clone();
+		distortion_mat = view.estimate.distortion.clone();
+	}
+
 	if (c.dump_measurements) {
 		U_LOG_RAW("...measured = (ArrayOfMeasurements){");
 		for (MeasurementF32 &m : view.measured_f32) {
@@ -695,6 +975,9 @@ process_view_samples(class Calibration &c, struct ViewState &view, int cols, int
 #if 0
 		flags |= cv::fisheye::CALIB_FIX_PRINCIPAL_POINT;
 #endif
+		if (view.estimate.valid) {
+			flags |= cv::fisheye::CALIB_USE_INTRINSIC_GUESS;
+		}
 
 		rp_error = cv::fisheye::calibrate(c.state.board_models_f64, // objectPoints
 		                                  view.measured_f64,        // imagePoints
@@ -725,6 +1008,9 @@ process_view_samples(class Calibration &c, struct ViewState &view, int cols, int
 		flags |= cv::CALIB_THIN_PRISM_MODEL;
 		flags |= cv::CALIB_RATIONAL_MODEL;
 		flags |= cv::CALIB_TILTED_MODEL;
+		if (view.estimate.valid) {
+			flags |= cv::CALIB_USE_INTRINSIC_GUESS;
+		}
 
 		rp_error = cv::calibrateCamera( //
 		    c.state.board_models_f32,   // objectPoints
@@ -949,21 +1235,46 @@ do_capture_logic_stereo(class Calibration &c,
 	}
 }
 
+/*!
+ * Use a board found ahead of time instead of looking for it.
+ */
+static bool
+use_detection(class Calibration &c,
+              const struct Detection &detected,
+              int index,
+              struct ViewState &view,
+              cv::Mat &gray,
+              cv::Mat &rgb)
+{
+	view.current_f32 = detected.f32[index];
+	view.current_f64 = detected.f64[index];
+
+	draw_view(c, view, gray, rgb, detected.found[index]);
+
+	return detected.found[index];
+}
+
 /*!
  * Make a mono frame.
  */
 static void
-make_calibration_frame_mono(class Calibration &c)
+make_calibration_frame_mono(class Calibration &c, const struct Detection *detected)
 {
 	auto &rgb = c.gui.rgb;
 	auto &gray = c.gray;
 
-	bool found = do_view(c, c.state.view[0], gray, rgb);
+	bool found = false;
+	if (detected != NULL) {
+		found = use_detection(c, *detected, 0, c.state.view[0], gray, rgb);
+	} else {
+		found = do_view(c, c.state.view[0], gray, rgb);
+	}
 
 	// Advance the state of the calibration.
+	size_t num_before = c.state.board_models_f32.size();
 	do_capture_logic_mono(c, c.state.view[0], found, gray, rgb);
 
-	if (c.state.board_models_f32.size() >= c.num_collect_total) {
+	if (update_collected(c, num_before, rgb.cols, rgb.rows, false)) {
 		process_view_samples(c, c.state.view[0], rgb.cols, rgb.rows);
 	}
 
@@ -976,7 +1287,7 @@ make_calibration_frame_mono(class Calibration &c)
  * Make a stereo frame side by side.
  */
 static void
-make_calibration_frame_sbs(class Calibration &c)
+make_calibration_frame_sbs(class Calibration &c, const struct Detection *detected)
 {
 	auto &rgb = c.gui.rgb;
 	auto &gray = c.gray;
@@ -990,13 +1301,30 @@ make_calibration_frame_sbs(class Calibration &c)
 	cv::Mat l_rgb(rows, cols, CV_8UC3, c.gui.frame->data, c.gui.frame->stride);
 	cv::Mat r_rgb(rows, cols, CV_8UC3, c.gui.frame->data + 3 * cols, c.gui.frame->stride);
 
-	bool found_left = do_view(c, c.state.view[0], l_gray, l_rgb);
-	bool found_right = do_view(c, c.state.view[1], r_gray, r_rgb);
+	bool found_left = false;
+	bool found_right = false;
+	if (detected != NULL) {
+		found_left = use_detection(c, *detected, 0, c.state.view[0], l_gray, l_rgb);
+		found_right = use_detection(c, *detected, 1, c.state.view[1], r_gray, r_rgb);
+	} else {
+		// Look for the board in both views at the same time.
+		struct ViewTask tasks[2] = {
+		    {&c, &c.state.view[0], l_gray, l_rgb, false},
+		    {&c, &c.state.view[1], r_gray, r_rgb, false},
+		};
+		u_worker_group_push(c.group, run_view_task, &tasks[0]);
+		u_worker_group_push(c.group, run_view_task, &tasks[1]);
+		u_worker_group_wait_all(c.group);
 
+		found_left = tasks[0].found;
+		found_right = tasks[1].found;
+	}
+
+	size_t num_before = c.state.board_models_f32.size();
 	do_capture_logic_stereo(c, gray, rgb, found_left, c.state.view[0], l_gray, l_rgb, found_right, c.state.view[1],
 	                        r_gray, r_rgb);
 
-	if (c.state.board_models_f32.size() >= c.num_collect_total) {
+	if (update_collected(c, num_before, cols, rows, true)) {
 		process_stereo_samples(c, cols, rows);
 	}
 
@@ -1006,11 +1334,11 @@ make_calibration_frame_sbs(class Calibration &c)
 }
 
 static void
-make_calibration_frame(class Calibration &c, struct xrt_frame *xf)
+make_calibration_frame(class Calibration &c, struct xrt_frame *xf, const struct Detection *detected)
 {
 	switch (xf->stereo_format) {
-	case XRT_STEREO_FORMAT_SBS: make_calibration_frame_sbs(c); break;
-	case XRT_STEREO_FORMAT_NONE: make_calibration_frame_mono(c); break;
+	case XRT_STEREO_FORMAT_SBS: make_calibration_frame_sbs(c, detected); break;
+	case XRT_STEREO_FORMAT_NONE: make_calibration_frame_mono(c, detected); break;
 	default:
 		P("ERROR: Unknown stereo format! '%i'", xf->stereo_format);
 		make_gui_str(c);
@@ -1137,11 +1465,64 @@ process_frame_rgb(class Calibration &c, struct xrt_frame *xf)
 	rgb_data.copyTo(c.gui.rgb);
 }
 
-XRT_NO_INLINE static void
-process_load_image(class Calibration &c, struct xrt_frame *xf)
+/*!
+ * Loads one of the saved images and looks for the board in it, many of these
+ * run in parallel before the images are fed through the capture logic.
+ */
+struct LoadTask
+{
+	class Calibration *c;
+	uint32_t index;
+	uint32_t width;
+	uint32_t height;
+
+	cv::Mat gray;
+	struct Detection detected;
+	bool loaded;
+};
+
+static void
+run_load_task(void *ptr)
 {
+	struct LoadTask &t = *(struct LoadTask *)ptr;
+	class Calibration &c = *t.c;
 	char buf[512];
 
+	snprintf(buf, 512, "gray_%ux%u_%03i.png", t.width, t.height, t.index);
+	t.gray = cv::imread(buf, cv::IMREAD_GRAYSCALE);
+
+	if (t.gray.rows == 0 || t.gray.cols == 0) {
+		U_LOG_E("Could not find image '%s'!", buf);
+		return;
+	}
+
+	if (t.gray.rows != (int)t.height || t.gray.cols != (int)t.width) {
+		U_LOG_E(
+		    "Image size does not match frame size! Image: "
+		    "(%ix%i) Frame: (%ux%u)",
+		    t.gray.cols, t.gray.rows, t.width, t.height);
+		return;
+	}
+
+	if (c.stereo_sbs) {
+		int cols = t.gray.cols / 2;
+		int rows = t.gray.rows;
+
+		cv::Mat l_gray(rows, cols, CV_8UC1, t.gray.data, t.gray.step);
+		cv::Mat r_gray(rows, cols, CV_8UC1, t.gray.data + cols, t.gray.step);
+
+		t.detected.found[0] = detect_board(c, l_gray, t.detected.f32[0], t.detected.f64[0]);
+		t.detected.found[1] = detect_board(c, r_gray, t.detected.f32[1], t.detected.f64[1]);
+	} else {
+		t.detected.found[0] = detect_board(c, t.gray, t.detected.f32[0], t.detected.f64[0]);
+	}
+
+	t.loaded = true;
+}
+
+XRT_NO_INLINE static void
+process_load_image(class Calibration &c, struct xrt_frame *xf)
+{
 	// We need to change the settings for frames to make it work.
 	uint32_t num_collect_restart = 1;
 	uint32_t num_cooldown_frames = 0;
@@ -1151,29 +1532,28 @@ process_load_image(class Calibration &c, struct xrt_frame *xf)
 	std::swap(c.num_cooldown_frames, num_cooldown_frames);
 	std::swap(c.num_wait_for, num_wait_for);
 
+	// Load all of the images and look for the board in them up front.
+	std::vector<LoadTask> tasks(c.load.num_images);
 	for (uint32_t i = 0; i < c.load.num_images; i++) {
+		tasks[i] = {&c, i, xf->width, xf->height, {}, {}, false};
+	}
+	for (LoadTask &t : tasks) {
+		u_worker_group_push(c.group, run_load_task, &t);
+	}
+	u_worker_group_wait_all(c.group);
+
+	for (LoadTask &t : tasks) {
 		// Early out if the user requested less images.
 		if (c.state.calibrated) {
 			break;
 		}
 
-		snprintf(buf, 512, "gray_%ux%u_%03i.png", xf->width, xf->height, i);
-		c.gray = cv::imread(buf, cv::IMREAD_GRAYSCALE);
-
-		if (c.gray.rows == 0 || c.gray.cols == 0) {
-			U_LOG_E("Could not find image '%s'!", buf);
-			continue;
-		}
-
-		if (c.gray.rows != (int)xf->height || c.gray.cols != (int)xf->width) {
-			U_LOG_E(
-			    "Image size does not match frame size! Image: "
-			    "(%ix%i) Frame: (%ux%u)",
-			    c.gray.cols, c.gray.rows, xf->width, xf->height);
+		if (!t.loaded) {
 			continue;
 		}
 
 		// Create a new RGB image and then copy the gray data to it.
+		c.gray = t.gray;
 		refresh_gui_frame(c, c.gray.rows, c.gray.cols);
 		cv::cvtColor(c.gray, c.gui.rgb, cv::COLOR_GRAY2RGB);
 
@@ -1182,7 +1562,7 @@ process_load_image(class Calibration &c, struct xrt_frame *xf)
 		}
 
 		// Call the normal frame processing now.
-		make_calibration_frame(c, xf);
+		make_calibration_frame(c, xf, &t.detected);
 	}
 
 	// Restore settings.
@@ -1238,7 +1618,23 @@ t_calibration_frame(struct xrt_frame_sink *xsink, struct xrt_frame *xf)
 		              cv::Scalar(0, 0, 0), -1, 0);
 	}
 
-	make_calibration_frame(c, xf);
+	make_calibration_frame(c, xf, NULL);
+}
+
+extern "C" void
+t_calibration_node_break_apart(struct xrt_frame_node *node)
+{}
+
+extern "C" void
+t_calibration_node_destroy(struct xrt_frame_node *node)
+{
+	auto *c_ptr = container_of(node, Calibration, node);
+
+	u_worker_group_reference(&c_ptr->group, NULL);
+	u_worker_thread_pool_reference(&c_ptr->pool, NULL);
+	xrt_frame_reference(&c_ptr->gui.frame, NULL);
+
+	delete c_ptr;
 }
 
 
@@ -1273,8 +1669,17 @@ t_calibration_stereo_create(struct xrt_frame_context *xfctx,
 	// Basic setup.
 	c.gui.sink = gui;
 	c.base.push_frame = t_calibration_frame;
+	c.node.break_apart = t_calibration_node_break_apart;
+	c.node.destroy = t_calibration_node_destroy;
 	*out_sink = &c.base;
 
+	xrt_frame_context_add(xfctx, &c.node);
+
+	// The waiting thread helps out, so one less worker.
+	uint32_t thread_count = std::clamp(std::thread::hardware_concurrency(), 2u, 16u);
+	c.pool = u_worker_thread_pool_create(thread_count - 1, thread_count, "Calibration");
+	c.group = u_worker_group_create(c.pool);
+
 	// Copy the parameters.
 	c.use_fisheye = params->use_fisheye;
 	c.stereo_sbs = params->stereo_sbs;
@@ -1320,6 +1725,10 @@ t_calibration_stereo_create(struct xrt_frame_context *xfctx,
 	c.num_collect_restart = params->num_collect_restart;
 	c.load.enabled = params->load.enabled;
 	c.load.num_images = params->load.num_images;
+	c.incremental.enabled = params->incremental.enabled;
+	c.incremental.min_samples = params->incremental.min_samples;
+	c.incremental.min_coverage = params->incremental.min_coverage;
+	c.incremental.max_error_change = params->incremental.max_error_change;
 	c.mirror_rgb_image = params->mirror_rgb_image;
 	c.save_images = params->save_images;
 	c.status = status;
@@ -1372,56 +1781,49 @@ t_calibration_stereo_create(struct xrt_frame_context *xfctx,
 	return ret;
 }
 
-//! Helper for NormalizedCoordsCache constructors
-static inline std::vector<cv::Vec2f>
-generateInputCoordsAndReserveOutputCoords(const cv::Size &size, std::vector<cv::Vec2f> &outputCoords)
-{
-	std::vector<cv::Vec2f> inputCoords;
-
-	const auto n = size.width * size.height;
-	assert(n != 0);
-	inputCoords.reserve(n);
-	for (int row = 0; row < size.height; ++row) {
-		for (int col = 0; col < size.width; ++col) {
-			inputCoords.emplace_back(col, row);
-		}
-	}
-	outputCoords.reserve(inputCoords.size());
-	return inputCoords;
-}
-
-//! Helper for NormalizedCoordsCache constructors
+/*!
+ * Helper for NormalizedCoordsCache constructors, fills in the cache in bands of
+ * rows in parallel. Undistorting the points of each band in one call still
+ * makes use of cached internal/intermediate computations.
+ */
+template <typename UndistortFunc>
 static inline void
-populateCacheMats(const cv::Size &size,
-                  const std::vector<cv::Vec2f> &inputCoords,
-                  const std::vector<cv::Vec2f> &outputCoords,
-                  cv::Mat_<float> &cacheX,
-                  cv::Mat_<float> &cacheY)
+populateCacheMats(const cv::Size &size, cv::Mat_<float> &cacheX, cv::Mat_<float> &cacheY, UndistortFunc &&undistort)
 {
 	assert(size.height != 0);
 	assert(size.width != 0);
 	cacheX.create(size);
 	cacheY.create(size);
-	const auto n = size.width * size.height;
-	// Populate the cache matrices
-	for (int i = 0; i < n; ++i) {
-		auto input = cv::Point{int(inputCoords[i][0]), int(inputCoords[i][1])};
-		cacheX(input) = outputCoords[i][0];
-		cacheY(input) = outputCoords[i][1];
-	}
+
+	cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range &rows) {
+		std::vector<cv::Vec2f> inputCoords;
+		std::vector<cv::Vec2f> outputCoords;
+		inputCoords.reserve(size_t(rows.size()) * size.width);
+		for (int row = rows.start; row < rows.end; ++row) {
+			for (int col = 0; col < size.width; ++col) {
+				inputCoords.emplace_back(col, row);
+			}
+		}
+
+		undistort(inputCoords, outputCoords);
+
+		size_t i = 0;
+		for (int row = rows.start; row < rows.end; ++row) {
+			for (int col = 0; col < size.width; ++col, ++i) {
+				cacheX(row, col) = outputCoords[i][0];
+				cacheY(row, col) = outputCoords[i][1];
+			}
+		}
+	});
 }
 
 NormalizedCoordsCache::NormalizedCoordsCache(cv::Size size, // NOLINT // small, pass by value
                                              const cv::Matx33d &intrinsics,
                                              const cv::Matx<double, 5, 1> &distortion)
 {
-	std::vector<cv::Vec2f> outputCoords;
-	std::vector<cv::Vec2f> inputCoords = generateInputCoordsAndReserveOutputCoords(size, outputCoords);
-	// Undistort/reproject those coordinates in one call, to make use of
-	// cached internal/intermediate computations.
-	cv::undistortPoints(inputCoords, outputCoords, intrinsics, distortion);
-
-	populateCacheMats(size, inputCoords, outputCoords, cacheX_, cacheY_);
+	populateCacheMats(size, cacheX_, cacheY_, [&](const auto &inputCoords, auto &outputCoords) {
+		cv::undistortPoints(inputCoords, outputCoords, intrinsics, distortion);
+	});
 }
 NormalizedCoordsCache::NormalizedCoordsCache(cv::Size size, // NOLINT // small, pass by value
                                              const cv::Matx33d &intrinsics,
@@ -1429,13 +1831,10 @@ NormalizedCoordsCache::NormalizedCoordsCache(cv::Size size, // NOLINT // small,
                                              const cv::Matx33d &rectification,
                                              const cv::Matx33d &new_camera_matrix)
 {
-	std::vector<cv::Vec2f> outputCoords;
-	std::vector<cv::Vec2f> inputCoords = generateInputCoordsAndReserveOutputCoords(size, outputCoords);
-	// Undistort/reproject those coordinates in one call, to make use of
-	// cached internal/intermediate computations.
-	cv::undistortPoints(inputCoords, outputCoords, intrinsics, distortion, rectification, new_camera_matrix);
-
-	populateCacheMats(size, inputCoords, outputCoords, cacheX_, cacheY_);
+	populateCacheMats(size, cacheX_, cacheY_, [&](const auto &inputCoords, auto &outputCoords) {
+		cv::undistortPoints(inputCoords, outputCoords, intrinsics, distortion, rectification,
+		                    new_camera_matrix);
+	});
 }
 
 NormalizedCoordsCache::NormalizedCoordsCache(cv::Size size, // NOLINT // small, pass by value
@@ -1444,25 +1843,18 @@ NormalizedCoordsCache::NormalizedCoordsCache(cv::Size size, // NOLINT // small,
                                              const cv::Matx33d &rectification,
                                              const cv::Matx<double, 3, 4> &new_projection_matrix)
 {
-	std::vector<cv::Vec2f> outputCoords;
-	std::vector<cv::Vec2f> inputCoords = generateInputCoordsAndReserveOutputCoords(size, outputCoords);
-	// Undistort/reproject those coordinates in one call, to make use of
-	// cached internal/intermediate computations.
-	cv::undistortPoints(inputCoords, outputCoords, intrinsics, distortion, rectification, new_projection_matrix);
-
-	populateCacheMats(size, inputCoords, outputCoords, cacheX_, cacheY_);
+	populateCacheMats(size, cacheX_, cacheY_, [&](const auto &inputCoords, auto &outputCoords) {
+		cv::undistortPoints(inputCoords, outputCoords, intrinsics, distortion, rectification,
+		                    new_projection_matrix);
+	});
 }
 NormalizedCoordsCache::NormalizedCoordsCache(cv::Size size, // NOLINT // small, pass by value
                                              const cv::Mat &intrinsics,
                                              const cv::Mat &distortion)
 {
-	std::vector<cv::Vec2f> outputCoords;
-	std::vector<cv::Vec2f> inputCoords = generateInputCoordsAndReserveOutputCoords(size, outputCoords);
-	// Undistort/reproject those coordinates in one call, to make use of
-	// cached internal/intermediate computations.
-	cv::undistortPoints(inputCoords, outputCoords, intrinsics, distortion);
-
-	populateCacheMats(size, inputCoords, outputCoords, cacheX_, cacheY_);
+	populateCacheMats(size, cacheX_, cacheY_, [&](const auto &inputCoords, auto &outputCoords) {
+		cv::undistortPoints(inputCoords, outputCoords, intrinsics, distortion);
+	});
 }
 
 cv::Vec2f
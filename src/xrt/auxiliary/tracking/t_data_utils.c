@@ -171,6 +171,14 @@ t_calibration_gui_params_parse_from_json(const struct cJSON *params, struct t_ca
 	u_json_get_bool(u_json_get(u_json_get(c, "load"), "enabled"), &p->load.enabled);
 	u_json_get_int(u_json_get(u_json_get(c, "load"), "num_images"), &p->load.num_images);
 
+	{
+		const struct cJSON *inc = u_json_get(c, "incremental");
+		u_json_get_bool(u_json_get(inc, "enabled"), &p->incremental.enabled);
+		u_json_get_int(u_json_get(inc, "min_samples"), &p->incremental.min_samples);
+		u_json_get_float(u_json_get(inc, "min_coverage"), &p->incremental.min_coverage);
+		u_json_get_float(u_json_get(inc, "max_error_change"), &p->incremental.max_error_change);
+	}
+
 
 	const struct cJSON *pattern_j = u_json_get(c, "pattern");
 	char *pattern_s = cJSON_GetStringValue(pattern_j);
@@ -238,6 +246,12 @@ t_calibration_gui_params_to_json(struct cJSON **out_json, struct t_calibration_p
 	cJSON_AddBoolToObject(load, "enabled", p->load.enabled);
 	cJSON_AddNumberToObject(load, "num_images", p->load.num_images);
 
+	struct cJSON *inc = cJSON_AddObjectToObject(scene, "incremental");
+	cJSON_AddBoolToObject(inc, "enabled", p->incremental.enabled);
+	cJSON_AddNumberToObject(inc, "min_samples", p->incremental.min_samples);
+	cJSON_AddNumberToObject(inc, "min_coverage", p->incremental.min_coverage);
+	cJSON_AddNumberToObject(inc, "max_error_change", p->incremental.max_error_change);
+
 	switch (p->pattern) {
 	case T_BOARD_CHECKERS: cJSON_AddStringToObject(scene, "pattern", "checkers"); break;
 	case T_BOARD_SB_CHECKERS: cJSON_AddStringToObject(scene, "pattern", "sb_checkers"); break;
@@ -324,6 +338,12 @@ t_calibration_gui_params_default(struct t_calibration_params *p)
 	p->num_collect_total = 20;
 	p->num_collect_restart = 1;
 
+	// Incremental refinement.
+	p->incremental.enabled = false;
+	p->incremental.min_samples = 6;
+	p->incremental.min_coverage = 0.7f;
+	p->incremental.max_error_change = 0.02f;
+
 	// Misc.
 	p->mirror_rgb_image = false;
 	p->save_images = true;
@@ -205,8 +205,13 @@ StereoRectificationMaps::StereoRectificationMaps(t_stereo_camera_calibration *da
 	default: assert(false);
 	}
 
-	view[0].rectify = calibration_get_undistort_map(data->view[0], view[0].rotation_mat, view[0].projection_mat);
-	view[1].rectify = calibration_get_undistort_map(data->view[1], view[1].rotation_mat, view[1].projection_mat);
+	// Both maps at the same time, the fisheye version is single threaded.
+	cv::parallel_for_(cv::Range(0, 2), [&](const cv::Range &range) {
+		for (int i = range.start; i < range.end; i++) {
+			view[i].rectify =
+			    calibration_get_undistort_map(data->view[i], view[i].rotation_mat, view[i].projection_mat);
+		}
+	});
 }
 } // namespace xrt::auxiliary::tracking
 
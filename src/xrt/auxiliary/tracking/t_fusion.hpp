@@ -173,6 +173,54 @@ private:
 	types::Vector<3> angVel_;
 	MeasurementSquareMatrix covariance_;
 };
+/*!
+ * For accelerometers when not accelerating: the direction of the measured
+ * acceleration in body space is the world up direction, +Y, rotated into body
+ * space. Only gives a correction for the orientation around the horizontal
+ * axes.
+ */
+class GravityDirectionMeasurement : public flexkalman::MeasurementBase<GravityDirectionMeasurement>
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+	using State = flexkalman::pose_externalized_rotation::State;
+	static constexpr size_t Dimension = 3;
+	using MeasurementVector = types::Vector<Dimension>;
+	using MeasurementSquareMatrix = types::SquareMatrix<Dimension>;
+
+	GravityDirectionMeasurement(types::Vector<3> const &accel, types::Vector<3> const &variance)
+	    : direction_(accel.normalized()), covariance_(variance.asDiagonal())
+	{}
+
+	MeasurementSquareMatrix const &
+	getCovariance(State const & /*s*/)
+	{
+		return covariance_;
+	}
+
+	types::Vector<3>
+	predictMeasurement(State const &s) const
+	{
+		return s.getCombinedQuaternion().conjugate() * types::Vector<3>::UnitY();
+	}
+
+	MeasurementVector
+	getResidual(MeasurementVector const &predictedMeasurement, State const & /*s*/) const
+	{
+		return direction_ - predictedMeasurement;
+	}
+
+	MeasurementVector
+	getResidual(State const &s) const
+	{
+		return getResidual(predictMeasurement(s), s);
+	}
+
+private:
+	types::Vector<3> direction_;
+	MeasurementSquareMatrix covariance_;
+};
+
 /*!
  * For PS Move-like things, where there's a directly-computed absolute position
  * that is not at the tracked body's origin.
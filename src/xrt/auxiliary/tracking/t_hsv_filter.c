@@ -144,107 +144,69 @@ struct t_hsv_filter
 	struct u_sink_debug usds[NUM_CHANNELS];
 
 	struct t_hsv_filter_optimized_table table;
+
+	//! Packed mask rows, one row of @ref mask_words per channel.
+	uint64_t *mask;
+	size_t mask_words;
 };
 
-static void
-process_sample(struct t_hsv_filter *f,
-               uint8_t y,
-               uint8_t cb,
-               uint8_t cr,
-               uint8_t *dst0,
-               uint8_t *dst1,
-               uint8_t *dst2,
-               uint8_t *dst3)
+//! Does anybody want the output of this channel.
+static bool
+channel_active(struct t_hsv_filter *f, size_t i)
 {
-	uint8_t bits = t_hsv_filter_sample(&f->table, y, cb, cr);
-	uint8_t v0 = (bits & (1 << 0)) ? 0xff : 0x00;
-	uint8_t v1 = (bits & (1 << 1)) ? 0xff : 0x00;
-	uint8_t v2 = (bits & (1 << 2)) ? 0xff : 0x00;
-	uint8_t v3 = (bits & (1 << 3)) ? 0xff : 0x00;
-
-	*dst0 = v0;
-	*dst1 = v1;
-	*dst2 = v2;
-	*dst3 = v3;
+	return f->sinks[i] != NULL || u_sink_debug_is_active(&f->usds[i]);
 }
 
-XRT_NO_INLINE static void
-hsv_process_frame_yuv(struct t_hsv_filter *f, struct xrt_frame *xf)
+static bool
+ensure_mask_allocated(struct t_hsv_filter *f, uint32_t width)
 {
-	SINK_TRACE_MARKER();
-
-	struct xrt_frame *f0 = f->frames[0];
-	struct xrt_frame *f1 = f->frames[1];
-	struct xrt_frame *f2 = f->frames[2];
-	struct xrt_frame *f3 = f->frames[3];
+	size_t words = T_HSV_MASK_WORDS(width);
+	if (words <= f->mask_words) {
+		return true;
+	}
 
-	for (uint32_t y = 0; y < xf->height; y++) {
-		uint8_t *src = (uint8_t *)xf->data + y * xf->stride;
-		uint8_t *dst0 = f0->data + y * f0->stride;
-		uint8_t *dst1 = f1->data + y * f1->stride;
-		uint8_t *dst2 = f2->data + y * f2->stride;
-		uint8_t *dst3 = f3->data + y * f3->stride;
-
-		for (uint32_t x = 0; x < xf->width; x += 1) {
-			uint8_t y = src[0];
-			uint8_t cb = src[1];
-			uint8_t cr = src[2];
-			src += 3;
-
-			process_sample(f, y, cb, cr, dst0, dst1, dst2, dst3);
-			dst0 += 1;
-			dst1 += 1;
-			dst2 += 1;
-			dst3 += 1;
-		}
+	uint64_t *mask = U_TYPED_ARRAY_CALLOC(uint64_t, words * NUM_CHANNELS);
+	if (mask == NULL) {
+		return false;
 	}
+
+	free(f->mask);
+	f->mask = mask;
+	f->mask_words = words;
+
+	return true;
 }
 
+/*!
+ * Classifies each row into packed bit masks and only expands the channels
+ * that have a consumer into full frames.
+ */
 XRT_NO_INLINE static void
-hsv_process_frame_yuyv(struct t_hsv_filter *f, struct xrt_frame *xf)
+hsv_process_frame(struct t_hsv_filter *f, struct xrt_frame *xf)
 {
 	SINK_TRACE_MARKER();
 
-	struct xrt_frame *f0 = f->frames[0];
-	struct xrt_frame *f1 = f->frames[1];
-	struct xrt_frame *f2 = f->frames[2];
-	struct xrt_frame *f3 = f->frames[3];
+	uint64_t *masks[NUM_CHANNELS] = {0};
+	for (size_t i = 0; i < NUM_CHANNELS; i++) {
+		if (f->frames[i] != NULL) {
+			masks[i] = f->mask + i * f->mask_words;
+		}
+	}
 
 	for (uint32_t y = 0; y < xf->height; y++) {
-		uint8_t *src = (uint8_t *)xf->data + y * xf->stride;
-		uint8_t *dst0 = f0->data + y * f0->stride;
-		uint8_t *dst1 = f1->data + y * f1->stride;
-		uint8_t *dst2 = f2->data + y * f2->stride;
-		uint8_t *dst3 = f3->data + y * f3->stride;
-
-		for (uint32_t x = 0; x < xf->width; x += 2) {
-			uint8_t y1 = src[0];
-			uint8_t cb = src[1];
-			uint8_t y2 = src[2];
-			uint8_t cr = src[3];
-			src += 4;
-
-			uint8_t bits0 = t_hsv_filter_sample(&f->table, y1, cb, cr);
-			uint8_t bits1 = t_hsv_filter_sample(&f->table, y2, cb, cr);
-
-			uint8_t v0 = (bits0 & (1 << 0)) ? 0xff : 0x00;
-			uint8_t v1 = (bits0 & (1 << 1)) ? 0xff : 0x00;
-			uint8_t v2 = (bits0 & (1 << 2)) ? 0xff : 0x00;
-			uint8_t v3 = (bits0 & (1 << 3)) ? 0xff : 0x00;
-			uint8_t v4 = (bits1 & (1 << 0)) ? 0xff : 0x00;
-			uint8_t v5 = (bits1 & (1 << 1)) ? 0xff : 0x00;
-			uint8_t v6 = (bits1 & (1 << 2)) ? 0xff : 0x00;
-			uint8_t v7 = (bits1 & (1 << 3)) ? 0xff : 0x00;
-
-			*(uint16_t *)dst0 = v0 | v4 << 8;
-			*(uint16_t *)dst1 = v1 | v5 << 8;
-			*(uint16_t *)dst2 = v2 | v6 << 8;
-			*(uint16_t *)dst3 = v3 | v7 << 8;
-
-			dst0 += 2;
-			dst1 += 2;
-			dst2 += 2;
-			dst3 += 2;
+		const uint8_t *src = (uint8_t *)xf->data + y * xf->stride;
+
+		if (xf->format == XRT_FORMAT_YUYV422) {
+			t_hsv_classify_row_yuyv(&f->table, src, xf->width, masks);
+		} else {
+			t_hsv_classify_row_yuv888(&f->table, src, xf->width, masks);
+		}
+
+		for (size_t i = 0; i < NUM_CHANNELS; i++) {
+			if (masks[i] != NULL) {
+				struct xrt_frame *dst = f->frames[i];
+				t_hsv_mask_expand_row(masks[i], xf->width, dst->data + y * dst->stride);
+			}
 		}
 	}
 }
@@ -256,7 +218,9 @@ ensure_buf_allocated(struct t_hsv_filter *f, struct xrt_frame *xf)
 	uint32_t h = xf->height;
 
 	for (size_t i = 0; i < NUM_CHANNELS; i++) {
-		u_frame_create_one_off(XRT_FORMAT_L8, w, h, &f->frames[i]);
+		if (channel_active(f, i)) {
+			u_frame_create_one_off(XRT_FORMAT_L8, w, h, &f->frames[i]);
+		}
 	}
 }
 
@@ -290,17 +254,22 @@ hsv_frame(struct xrt_frame_sink *xsink, struct xrt_frame *xf)
 
 	switch (xf->format) {
 	case XRT_FORMAT_YUV888:
-		ensure_buf_allocated(f, xf);
-		hsv_process_frame_yuv(f, xf);
-		break;
-	case XRT_FORMAT_YUYV422:
-		ensure_buf_allocated(f, xf);
-		hsv_process_frame_yuyv(f, xf);
-		break;
+	case XRT_FORMAT_YUYV422: break;
 	default: U_LOG_E("Bad format '%s'", u_format_str(xf->format)); return;
 	}
 
+	if (!ensure_mask_allocated(f, xf->width)) {
+		U_LOG_E("Failed to allocate mask rows");
+		return;
+	}
+
+	ensure_buf_allocated(f, xf);
+	hsv_process_frame(f, xf);
+
 	for (size_t i = 0; i < NUM_CHANNELS; i++) {
+		if (f->frames[i] == NULL) {
+			continue;
+		}
 		push_buf(f, xf, f->sinks[i], &f->usds[i], f->frames[i]);
 		xrt_frame_reference(&f->frames[i], NULL);
 	}
@@ -321,6 +290,7 @@ hsv_destroy(struct xrt_frame_node *node)
 		u_sink_debug_destroy(&f->usds[i]);
 	}
 
+	free(f->mask);
 	free(f);
 }
 
@@ -0,0 +1,600 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Kalman filter fusing IMU samples with delayed optical measurements.
+ * @ingroup aux_tracking
+ */
+
+#include "tracking/t_fusion.hpp"
+#include "tracking/t_pose_fusion.hpp"
+
+#include "math/m_api.h"
+#include "math/m_eigen_interop.hpp"
+#include "math/m_relation_history.h"
+
+#include "util/u_logging.h"
+#include "util/u_misc.h"
+
+#include "flexkalman/AbsoluteOrientationMeasurement.h"
+#include "flexkalman/AngularVelocityMeasurement.h"
+#include "flexkalman/FlexibleKalmanFilter.h"
+#include "flexkalman/FlexibleUnscentedCorrect.h"
+#include "flexkalman/PoseSeparatelyDampedConstantVelocity.h"
+#include "flexkalman/PoseState.h"
+
+#include <Eigen/StdDeque>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <memory>
+
+
+namespace xrt::auxiliary::tracking {
+
+using namespace xrt::auxiliary::math;
+
+//! Anonymous namespace to hide implementation names
+namespace {
+
+	using State = flexkalman::pose_externalized_rotation::State;
+	using ProcessModel = flexkalman::PoseSeparatelyDampedConstantVelocityProcessModel<State>;
+
+	//! 7200 deg/sec, anything faster means the filter has diverged.
+	constexpr double kMaxRadPerSec = 20 * double(EIGEN_PI) * 2;
+
+	//! Upper bound on the number of kept events, on top of the time limit.
+	constexpr size_t kMaxEvents = 2048;
+
+	//! The filter is kept after every this many events, replays start from there.
+	constexpr size_t kCheckpointInterval = 16;
+
+	struct TrackingInfo
+	{
+		bool valid{false};
+		bool tracked{false};
+	};
+
+	//! Everything about the filter that is rolled back when replaying.
+	struct Snapshot
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		State state;
+		timepoint_ns time_ns{0};
+		bool started{false};
+		TrackingInfo orientation;
+		TrackingInfo position;
+	};
+
+	enum class EventType
+	{
+		IMU,
+		POSITION,
+		ORIENTATION,
+	};
+
+	struct Event
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		EventType type;
+		timepoint_ns timestamp_ns;
+
+		//! Accelerometer or measured position.
+		Eigen::Vector3d a;
+		//! Gyroscope or lever arm.
+		Eigen::Vector3d b;
+		Eigen::Vector3d variance;
+		Eigen::Quaterniond orientation;
+		double residual_limit;
+
+		//! Was this event used the last time it was run through the filter.
+		bool accepted;
+
+		//! The filter after this event, only kept on every few events.
+		std::unique_ptr<Snapshot> checkpoint;
+	};
+
+	class PoseFusionImpl : public PoseFusion
+	{
+	public:
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		explicit PoseFusionImpl(const PoseFusionParams &params);
+		~PoseFusionImpl() override;
+
+		void
+		process_imu(timepoint_ns timestamp_ns,
+		            const struct xrt_vec3 *accel_m_s2,
+		            const struct xrt_vec3 *gyro_rad_secs,
+		            const struct xrt_vec3 *gravity_variance_optional) override;
+
+		bool
+		process_position(timepoint_ns timestamp_ns,
+		                 const struct xrt_vec3 *position,
+		                 const struct xrt_vec3 *variance,
+		                 const struct xrt_vec3 *lever_arm_optional,
+		                 float residual_limit) override;
+
+		bool
+		process_orientation(timepoint_ns timestamp_ns,
+		                    const struct xrt_quat *orientation,
+		                    const struct xrt_vec3 *variance) override;
+
+		void
+		clear_position_tracked_flag() override;
+
+		void
+		get_relation(timepoint_ns when_ns, struct xrt_space_relation *out_relation) override;
+
+		void
+		get_covariance(timepoint_ns when_ns, struct PoseCovariance *out_covariance) override;
+
+		struct m_relation_history *
+		get_relation_history() override;
+
+	private:
+		bool
+		insert(Event &&event);
+
+		const Snapshot &
+		newest() const;
+
+		void
+		predict_to(Snapshot &s, timepoint_ns timestamp_ns);
+
+		bool
+		apply(Snapshot &s, const Event &e);
+
+		bool
+		apply_imu(Snapshot &s, const Event &e);
+
+		bool
+		apply_position(Snapshot &s, const Event &e);
+
+		bool
+		apply_orientation(Snapshot &s, const Event &e);
+
+		void
+		make_relation(const Snapshot &s, const State &state, struct xrt_space_relation *out_relation) const;
+
+		void
+		publish(const Snapshot &s);
+
+		PoseFusionParams params;
+		ProcessModel process_model;
+
+		//! Filter before the oldest kept event.
+		Snapshot base;
+
+		//! Filter after the newest kept event.
+		Snapshot current;
+
+		//! Kept events, sorted by timestamp.
+		std::deque<Event, Eigen::aligned_allocator<Event>> events;
+
+		//! Position lost since the last position measurement.
+		bool position_lost{false};
+
+		struct m_relation_history *history{nullptr};
+	};
+
+
+	/*
+	 *
+	 * Helpers.
+	 *
+	 */
+
+	/*!
+	 * Reset the position and linear velocity part of the state, leaving the
+	 * orientation that the IMU has converged alone.
+	 */
+	void
+	reset_position(Snapshot &s)
+	{
+		constexpr int indices[] = {0, 1, 2, 6, 7, 8};
+		const State fresh;
+
+		s.state.position() = Eigen::Vector3d::Zero();
+		s.state.velocity() = Eigen::Vector3d::Zero();
+		for (int i : indices) {
+			s.state.errorCovariance().row(i).setZero();
+			s.state.errorCovariance().col(i).setZero();
+			s.state.errorCovariance()(i, i) = fresh.errorCovariance()(i, i);
+		}
+		s.position = TrackingInfo{};
+	}
+
+
+	/*
+	 *
+	 * Member functions.
+	 *
+	 */
+
+	PoseFusionImpl::PoseFusionImpl(const PoseFusionParams &params_)
+	    : params(params_), process_model(params_.position_damping,
+	                                     params_.orientation_damping,
+	                                     params_.position_noise,
+	                                     params_.orientation_noise)
+	{
+		m_relation_history_create(&history);
+	}
+
+	PoseFusionImpl::~PoseFusionImpl()
+	{
+		m_relation_history_destroy(&history);
+	}
+
+	const Snapshot &
+	PoseFusionImpl::newest() const
+	{
+		return current;
+	}
+
+	void
+	PoseFusionImpl::predict_to(Snapshot &s, timepoint_ns timestamp_ns)
+	{
+		if (s.time_ns != 0 && timestamp_ns > s.time_ns) {
+			flexkalman::predict(s.state, process_model, time_ns_to_s(timestamp_ns - s.time_ns));
+		}
+		s.time_ns = std::max(s.time_ns, timestamp_ns);
+	}
+
+	bool
+	PoseFusionImpl::apply_imu(Snapshot &s, const Event &e)
+	{
+		const Eigen::Vector3d &accel = e.a;
+		const Eigen::Vector3d &gyro = e.b;
+		bool near_gravity = std::abs(accel.norm() - MATH_GRAVITY_M_S2) < params.gravity_tolerance;
+
+		if (!s.started) {
+			// We're moving, don't start it now.
+			if (!near_gravity) {
+				return false;
+			}
+
+			// Initially, totally trust gravity.
+			Eigen::Quaterniond yaw(Eigen::AngleAxisd(params.initial_yaw_rad, Eigen::Vector3d::UnitY()));
+			Eigen::Quaterniond tilt = Eigen::Quaterniond::FromTwoVectors(accel, Eigen::Vector3d::UnitY());
+			s.state.setQuaternion(yaw * tilt);
+			s.time_ns = e.timestamp_ns;
+			s.started = true;
+			s.orientation.valid = true;
+			return true;
+		}
+
+		predict_to(s, e.timestamp_ns);
+
+		// The state keeps the angular velocity in world space.
+		Eigen::Vector3d world_gyro = s.state.getCombinedQuaternion() * gyro;
+		auto gyro_meas =
+		    flexkalman::AngularVelocityMeasurement{world_gyro, Eigen::Vector3d::Constant(params.gyro_variance)};
+		bool ok = flexkalman::correctUnscented(s.state, gyro_meas);
+
+		// Only trust the accelerometer for orientation when it's mostly gravity.
+		if (ok && near_gravity) {
+			auto gravity_meas = GravityDirectionMeasurement{accel, e.variance};
+			ok = flexkalman::correctUnscented(s.state, gravity_meas);
+		}
+
+		if (!ok) {
+			U_LOG_E("Got non-finite something when filtering IMU - resetting filter!");
+			s = Snapshot{};
+			return false;
+		}
+
+		if (s.state.angularVelocity().squaredNorm() > kMaxRadPerSec * kMaxRadPerSec) {
+			U_LOG_E("Got excessive angular velocity when filtering IMU - resetting filter!");
+			s = Snapshot{};
+			return false;
+		}
+
+		s.orientation.tracked = true;
+
+		return true;
+	}
+
+	bool
+	PoseFusionImpl::apply_position(Snapshot &s, const Event &e)
+	{
+		predict_to(s, e.timestamp_ns);
+
+		auto meas = AbsolutePositionLeverArmMeasurement{e.a, e.b, e.variance};
+
+		// Residual arbitrarily "too large", only once we have a position to compare against.
+		double resid = meas.getResidual(s.state).norm();
+		if (s.position.valid && resid > e.residual_limit) {
+			U_LOG_W("measurement residual is %f, resetting filter position", resid);
+			reset_position(s);
+			return false;
+		}
+
+		if (!flexkalman::correctUnscented(s.state, meas)) {
+			U_LOG_W("Got non-finite something when filtering tracker - resetting filter position!");
+			reset_position(s);
+			return false;
+		}
+
+		s.position.valid = true;
+		s.position.tracked = true;
+
+		return true;
+	}
+
+	bool
+	PoseFusionImpl::apply_orientation(Snapshot &s, const Event &e)
+	{
+		if (!s.started) {
+			s.state.setQuaternion(e.orientation);
+			s.time_ns = e.timestamp_ns;
+			s.started = true;
+			s.orientation.valid = true;
+			return true;
+		}
+
+		predict_to(s, e.timestamp_ns);
+
+		auto meas = flexkalman::AbsoluteOrientationMeasurement{e.orientation, e.variance};
+		if (!flexkalman::correctUnscented(s.state, meas)) {
+			U_LOG_W("Got non-finite something when filtering orientation - ignoring it!");
+			return false;
+		}
+
+		s.orientation.valid = true;
+		s.orientation.tracked = true;
+
+		return true;
+	}
+
+	bool
+	PoseFusionImpl::apply(Snapshot &s, const Event &e)
+	{
+		switch (e.type) {
+		case EventType::IMU: return apply_imu(s, e);
+		case EventType::POSITION: return apply_position(s, e);
+		case EventType::ORIENTATION: return apply_orientation(s, e);
+		}
+
+		return false;
+	}
+
+	void
+	PoseFusionImpl::make_relation(const Snapshot &s,
+	                              const State &state,
+	                              struct xrt_space_relation *out_relation) const
+	{
+		// Clear to sane values
+		U_ZERO(out_relation);
+		out_relation->pose.orientation.w = 1;
+
+		if (!s.orientation.valid && !s.position.valid) {
+			return;
+		}
+
+		map_vec3(out_relation->pose.position) = state.position().cast<float>();
+		map_quat(out_relation->pose.orientation) = state.getQuaternion().cast<float>();
+		map_vec3(out_relation->linear_velocity) = state.velocity().cast<float>();
+		map_vec3(out_relation->angular_velocity) = state.angularVelocity().cast<float>();
+
+		uint64_t flags = 0;
+		if (s.position.valid) {
+			flags |= XRT_SPACE_RELATION_POSITION_VALID_BIT;
+			flags |= XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT;
+			if (s.position.tracked && !position_lost) {
+				flags |= XRT_SPACE_RELATION_POSITION_TRACKED_BIT;
+			}
+		}
+		if (s.orientation.valid) {
+			flags |= XRT_SPACE_RELATION_ORIENTATION_VALID_BIT;
+			flags |= XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT;
+			if (s.orientation.tracked) {
+				flags |= XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT;
+			}
+		}
+		out_relation->relation_flags = (enum xrt_space_relation_flags)flags;
+	}
+
+	/*!
+	 * Push the filtered relation of @p s into the history, replacing the one
+	 * of an earlier event at the same time.
+	 */
+	void
+	PoseFusionImpl::publish(const Snapshot &s)
+	{
+		struct xrt_space_relation rel;
+		make_relation(s, s.state, &rel);
+		if (rel.relation_flags != 0) {
+			m_relation_history_truncate(history, s.time_ns);
+			m_relation_history_push(history, &rel, s.time_ns);
+		}
+	}
+
+	/*!
+	 * Slot @p event in at its timestamp, run it and everything after it
+	 * through the filter and drop the events that are too old to be
+	 * replayed into. The replay starts from the closest checkpoint before
+	 * it, only the relations from the new event on are pushed again.
+	 */
+	bool
+	PoseFusionImpl::insert(Event &&event)
+	{
+		if (event.timestamp_ns < base.time_ns) {
+			U_LOG_D("Dropping measurement %.1f ms older than the oldest state",
+			        time_ns_to_ms_f(base.time_ns - event.timestamp_ns));
+			return false;
+		}
+
+		auto it = std::upper_bound(events.begin(), events.end(), event.timestamp_ns,
+		                           [](timepoint_ns ts, const Event &e) { return ts < e.timestamp_ns; });
+		size_t index = it - events.begin();
+		events.insert(it, std::move(event));
+
+		size_t start = index;
+		while (start > 0 && !events[start - 1].checkpoint) {
+			start--;
+		}
+
+		Snapshot s;
+		size_t since_checkpoint = 0;
+		if (index + 1 == events.size()) {
+			// Appended, carry on from the newest state.
+			s = current;
+			since_checkpoint = index - start;
+			start = index;
+		} else {
+			s = start == 0 ? base : *events[start - 1].checkpoint;
+		}
+
+		for (size_t i = start; i < events.size(); i++) {
+			Event &e = events[i];
+			e.accepted = apply(s, e);
+
+			if (++since_checkpoint >= kCheckpointInterval) {
+				e.checkpoint = std::make_unique<Snapshot>(s);
+				since_checkpoint = 0;
+			} else {
+				e.checkpoint.reset();
+			}
+
+			if (i == index) {
+				// Nothing before this event is newer, replace the rest.
+				m_relation_history_truncate(history, e.timestamp_ns);
+			}
+			if (i >= index) {
+				publish(s);
+			}
+		}
+		current = s;
+		bool accepted = events[index].accepted;
+
+		// Only the state after a checkpoint can become the base.
+		timepoint_ns newest_ns = events.back().timestamp_ns;
+		size_t drop = 0;
+		while (drop + 1 < events.size() && (events.size() - drop > kMaxEvents ||
+		                                    events[drop].timestamp_ns + params.history_ns < newest_ns)) {
+			drop++;
+		}
+		while (drop > 0 && !events[drop - 1].checkpoint) {
+			drop--;
+		}
+		if (drop > 0) {
+			base = *events[drop - 1].checkpoint;
+			events.erase(events.begin(), events.begin() + drop);
+		}
+
+		return accepted;
+	}
+
+	void
+	PoseFusionImpl::process_imu(timepoint_ns timestamp_ns,
+	                            const struct xrt_vec3 *accel_m_s2,
+	                            const struct xrt_vec3 *gyro_rad_secs,
+	                            const struct xrt_vec3 *gravity_variance_optional)
+	{
+		Event e{};
+		e.type = EventType::IMU;
+		e.timestamp_ns = timestamp_ns;
+		e.a = map_vec3(*accel_m_s2).cast<double>();
+		e.b = map_vec3(*gyro_rad_secs).cast<double>();
+		e.variance = Eigen::Vector3d::Constant(params.gravity_variance);
+		if (gravity_variance_optional != nullptr) {
+			e.variance = map_vec3(*gravity_variance_optional).cast<double>();
+		}
+
+		insert(std::move(e));
+	}
+
+	bool
+	PoseFusionImpl::process_position(timepoint_ns timestamp_ns,
+	                                 const struct xrt_vec3 *position,
+	                                 const struct xrt_vec3 *variance,
+	                                 const struct xrt_vec3 *lever_arm_optional,
+	                                 float residual_limit)
+	{
+		Event e{};
+		e.type = EventType::POSITION;
+		e.timestamp_ns = timestamp_ns != 0 ? timestamp_ns : newest().time_ns;
+		e.a = map_vec3(*position).cast<double>();
+		e.b = Eigen::Vector3d::Zero();
+		if (lever_arm_optional != nullptr) {
+			e.b = map_vec3(*lever_arm_optional).cast<double>();
+		}
+		e.variance = map_vec3(*variance).cast<double>();
+		e.residual_limit = residual_limit;
+
+		bool accepted = insert(std::move(e));
+		if (accepted) {
+			position_lost = false;
+		}
+
+		return accepted;
+	}
+
+	bool
+	PoseFusionImpl::process_orientation(timepoint_ns timestamp_ns,
+	                                    const struct xrt_quat *orientation,
+	                                    const struct xrt_vec3 *variance)
+	{
+		Event e{};
+		e.type = EventType::ORIENTATION;
+		e.timestamp_ns = timestamp_ns != 0 ? timestamp_ns : newest().time_ns;
+		e.orientation = map_quat(*orientation).cast<double>();
+		e.variance = map_vec3(*variance).cast<double>();
+
+		return insert(std::move(e));
+	}
+
+	void
+	PoseFusionImpl::clear_position_tracked_flag()
+	{
+		position_lost = true;
+	}
+
+	void
+	PoseFusionImpl::get_relation(timepoint_ns when_ns, struct xrt_space_relation *out_relation)
+	{
+		const Snapshot &s = newest();
+
+		if (s.time_ns == 0 || when_ns >= s.time_ns) {
+			double dt = s.time_ns == 0 ? 0.0 : time_ns_to_s(when_ns - s.time_ns);
+			State predicted = flexkalman::getPrediction(s.state, process_model, dt);
+			make_relation(s, predicted, out_relation);
+			return;
+		}
+
+		m_relation_history_get(history, when_ns, out_relation);
+	}
+
+	void
+	PoseFusionImpl::get_covariance(timepoint_ns when_ns, struct PoseCovariance *out_covariance)
+	{
+		const Snapshot &s = newest();
+
+		double dt = (s.time_ns == 0 || when_ns <= s.time_ns) ? 0.0 : time_ns_to_s(when_ns - s.time_ns);
+		State predicted = flexkalman::getPrediction(s.state, process_model, dt, true);
+
+		// Position and incremental orientation are the first six elements of the state.
+		Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor>>(&out_covariance->values[0][0]) =
+		    predicted.errorCovariance().topLeftCorner<6, 6>();
+	}
+
+	struct m_relation_history *
+	PoseFusionImpl::get_relation_history()
+	{
+		return history;
+	}
+
+} // namespace
+
+
+std::unique_ptr<PoseFusion>
+PoseFusion::create(const PoseFusionParams &params)
+{
+	return std::make_unique<PoseFusionImpl>(params);
+}
+
+} // namespace xrt::auxiliary::tracking
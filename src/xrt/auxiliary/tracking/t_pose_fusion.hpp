@@ -0,0 +1,152 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Kalman filter fusing IMU samples with delayed optical measurements.
+ * @ingroup aux_tracking
+ */
+
+#pragma once
+
+#ifndef __cplusplus
+#error "This header is C++-only."
+#endif
+
+#include "xrt/xrt_defines.h"
+
+#include "util/u_time.h"
+
+#include <memory>
+
+
+struct m_relation_history;
+
+namespace xrt::auxiliary::tracking {
+
+/*!
+ * Tuning of @ref PoseFusion, the defaults are the values the PS Move tracker
+ * used with its filter before.
+ */
+struct PoseFusionParams
+{
+	//! Variance of the gyroscope, in (rad/s)^2.
+	double gyro_variance{1.e-3};
+
+	//! Variance of the normalized direction of the accelerometer.
+	double gravity_variance{1.e-2};
+
+	//! Accelerometer samples further than this from gravity are not used for orientation, in m/s^2.
+	double gravity_tolerance{1.0};
+
+	//! Yaw added to the orientation estimated from gravity at startup.
+	double initial_yaw_rad{0.0};
+
+	//! Damping of the velocities in the process model, see flexkalman.
+	double position_damping{0.3};
+	double orientation_damping{0.01};
+
+	//! Noise autocorrelation of the process model, see flexkalman.
+	double position_noise{0.01};
+	double orientation_noise{0.1};
+
+	//! How old a measurement can be and still be folded into the filter.
+	time_duration_ns history_ns{200 * U_TIME_1MS_IN_NS};
+};
+
+/*!
+ * Covariance of a pose estimate from @ref PoseFusion, position followed by
+ * orientation as a rotation vector in world space, row major.
+ */
+struct PoseCovariance
+{
+	double values[6][6];
+};
+
+/*!
+ * An error-state Kalman filter of a 6DoF pose, driven by IMU samples at their
+ * full rate and corrected by optical measurements that may arrive late and out
+ * of order. The state after every sample and measurement is kept for
+ * @ref PoseFusionParams::history_ns, a late measurement is slotted in at its
+ * timestamp and everything after it is run through the filter again.
+ *
+ * Uses a Y-up world, the accelerometer reading gravity as +Y at rest.
+ *
+ * The filtered relations are kept in a @ref m_relation_history, so poses in
+ * the past are interpolated and poses in the future predicted from the newest
+ * state. Not thread safe, callers are expected to lock around it.
+ */
+class PoseFusion
+{
+public:
+	static std::unique_ptr<PoseFusion>
+	create(const PoseFusionParams &params = PoseFusionParams{});
+
+	virtual ~PoseFusion() = default;
+
+	/*!
+	 * Feed an IMU sample, samples must come in order.
+	 *
+	 * @param gravity_variance_optional Overrides @ref PoseFusionParams::gravity_variance.
+	 */
+	virtual void
+	process_imu(timepoint_ns timestamp_ns,
+	            const struct xrt_vec3 *accel_m_s2,
+	            const struct xrt_vec3 *gyro_rad_secs,
+	            const struct xrt_vec3 *gravity_variance_optional) = 0;
+
+	/*!
+	 * Feed an absolute position measurement of a point @p lever_arm_optional
+	 * away from the origin of the tracked body, which is the origin itself if
+	 * not given. A @p timestamp_ns of 0 means the time of the newest state.
+	 *
+	 * If the measurement is further than @p residual_limit from the estimate
+	 * the position part of the filter is reset.
+	 *
+	 * @return false if the measurement was too old, not finite or rejected.
+	 */
+	virtual bool
+	process_position(timepoint_ns timestamp_ns,
+	                 const struct xrt_vec3 *position,
+	                 const struct xrt_vec3 *variance,
+	                 const struct xrt_vec3 *lever_arm_optional,
+	                 float residual_limit) = 0;
+
+	/*!
+	 * Feed an absolute orientation measurement, a @p timestamp_ns of 0 means
+	 * the time of the newest state.
+	 *
+	 * @return false if the measurement was too old or not finite.
+	 */
+	virtual bool
+	process_orientation(timepoint_ns timestamp_ns,
+	                    const struct xrt_quat *orientation,
+	                    const struct xrt_vec3 *variance) = 0;
+
+	/*!
+	 * Position tracking was lost, the position is still estimated but no
+	 * longer flagged as tracked until the next position measurement.
+	 */
+	virtual void
+	clear_position_tracked_flag() = 0;
+
+	/*!
+	 * Get the pose at @p when_ns, interpolated from the history or predicted
+	 * from the newest state.
+	 */
+	virtual void
+	get_relation(timepoint_ns when_ns, struct xrt_space_relation *out_relation) = 0;
+
+	/*!
+	 * Get the covariance of the newest state predicted to @p when_ns.
+	 */
+	virtual void
+	get_covariance(timepoint_ns when_ns, struct PoseCovariance *out_covariance) = 0;
+
+	/*!
+	 * The history the filtered relations are pushed into, owned by this object.
+	 */
+	virtual struct m_relation_history *
+	get_relation_history() = 0;
+};
+
+} // namespace xrt::auxiliary::tracking
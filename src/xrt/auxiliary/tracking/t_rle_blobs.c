@@ -0,0 +1,485 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Packed HSV masks, run-length encoding and blob extraction.
+ * @ingroup aux_tracking
+ *
+ * The loops here are written to be auto-vectorised: the table index and bit
+ * packing work on fixed blocks of 64 pixels with no branches in the inner
+ * loops, only the table lookup itself is a scalar gather.
+ */
+
+#include "math/m_api.h"
+
+#include "util/u_misc.h"
+
+#include "tracking/t_tracking.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+#define BLOCK 64
+
+static inline uint32_t
+ctz64(uint64_t v)
+{
+	assert(v != 0);
+#if defined(__GNUC__) || defined(__clang__)
+	return (uint32_t)__builtin_ctzll(v);
+#else
+	uint32_t n = 0;
+	while ((v & 1) == 0) {
+		v >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+static inline uint32_t
+table_index(uint32_t y, uint32_t u, uint32_t v)
+{
+	return ((y / T_HSV_STEP) * T_HSV_SIZE + (u / T_HSV_STEP)) * T_HSV_SIZE + (v / T_HSV_STEP);
+}
+
+//! Bit @p shift of eight bytes as the eight low bits, byte k becomes bit k.
+static inline uint64_t
+gather8(const uint8_t *bytes, uint32_t shift)
+{
+	uint64_t group = 0;
+	for (uint32_t k = 0; k < 8; k++) {
+		group |= (uint64_t)bytes[k] << (k * 8);
+	}
+
+	// The multiply sums every byte's low bit into the top byte without carries.
+	uint64_t lsb = (group >> shift) & UINT64_C(0x0101010101010101);
+	return (lsb * UINT64_C(0x0102040810204080)) >> 56;
+}
+
+//! Which of eight bytes are above @p threshold, byte k becomes bit k.
+static inline uint64_t
+above8(const uint8_t *bytes, uint8_t threshold)
+{
+	const uint64_t low7 = UINT64_C(0x7f7f7f7f7f7f7f7f);
+	const uint64_t high = UINT64_C(0x8080808080808080);
+
+	uint64_t x = 0;
+	for (uint32_t k = 0; k < 8; k++) {
+		x |= (uint64_t)bytes[k] << (k * 8);
+	}
+
+	// x > threshold is x + (255 - threshold) carrying out of the byte.
+	uint64_t y = (uint64_t)(255 - threshold) * UINT64_C(0x0101010101010101);
+	uint64_t low = (x & low7) + (y & low7);
+	uint64_t carry = ((x & y) | ((x | y) & low)) & high;
+
+	return ((carry >> 7) * UINT64_C(0x0102040810204080)) >> 56;
+}
+
+static inline void
+pack_block(uint8_t bits[BLOCK], uint32_t count, uint64_t *masks[4], uint32_t word)
+{
+	uint64_t m[4] = {0, 0, 0, 0};
+
+	for (uint32_t i = count; i < BLOCK; i++) {
+		bits[i] = 0;
+	}
+
+	for (uint32_t i = 0; i < count; i += 8) {
+		for (uint32_t c = 0; c < 4; c++) {
+			m[c] |= gather8(&bits[i], c) << i;
+		}
+	}
+
+	for (uint32_t c = 0; c < 4; c++) {
+		if (masks[c] != NULL) {
+			masks[c][word] = m[c];
+		}
+	}
+}
+
+
+/*
+ *
+ * Classification.
+ *
+ */
+
+void
+t_hsv_classify_row_yuv888(const struct t_hsv_filter_optimized_table *t,
+                          const uint8_t *src,
+                          uint32_t width,
+                          uint64_t *masks[4])
+{
+	const uint8_t *table = &t->v[0][0][0];
+	uint8_t bits[BLOCK];
+
+	for (uint32_t base = 0, word = 0; base < width; base += BLOCK, word++) {
+		uint32_t count = MIN(BLOCK, width - base);
+		const uint8_t *s = src + base * 3;
+
+		for (uint32_t i = 0; i < count; i++) {
+			bits[i] = table[table_index(s[i * 3 + 0], s[i * 3 + 1], s[i * 3 + 2])];
+		}
+
+		pack_block(bits, count, masks, word);
+	}
+}
+
+void
+t_hsv_classify_row_yuyv(const struct t_hsv_filter_optimized_table *t,
+                        const uint8_t *src,
+                        uint32_t width,
+                        uint64_t *masks[4])
+{
+	assert(width % 2 == 0);
+
+	const uint8_t *table = &t->v[0][0][0];
+	uint8_t bits[BLOCK];
+
+	for (uint32_t base = 0, word = 0; base < width; base += BLOCK, word++) {
+		uint32_t count = MIN(BLOCK, width - base);
+		const uint8_t *s = src + base * 2;
+
+		// Each group of four bytes is Y0 Cb Y1 Cr, two pixels sharing chroma.
+		for (uint32_t i = 0; i < count; i += 2) {
+			const uint8_t *pair = s + i * 2;
+			uint32_t chroma = table_index(0, pair[1], pair[3]);
+			bits[i + 0] = table[table_index(pair[0], 0, 0) + chroma];
+			bits[i + 1] = table[table_index(pair[2], 0, 0) + chroma];
+		}
+
+		pack_block(bits, count, masks, word);
+	}
+}
+
+void
+t_hsv_mask_expand_row(const uint64_t *mask, uint32_t width, uint8_t *dst)
+{
+	for (uint32_t base = 0, word = 0; base < width; base += BLOCK, word++) {
+		uint32_t count = MIN(BLOCK, width - base);
+		uint64_t m = mask[word];
+
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			// Each bit to its own byte, then any non-zero byte to 0xff.
+			uint64_t spread = ((m >> i) & 0xff) * UINT64_C(0x0101010101010101);
+			spread &= UINT64_C(0x8040201008040201);
+			uint64_t set = ((spread + UINT64_C(0x7f7f7f7f7f7f7f7f)) >> 7) & UINT64_C(0x0101010101010101);
+			uint64_t bytes = set * 0xff;
+			for (uint32_t k = 0; k < 8; k++) {
+				dst[base + i + k] = (uint8_t)(bytes >> (k * 8));
+			}
+		}
+		for (; i < count; i++) {
+			dst[base + i] = (uint8_t)(0 - ((m >> i) & 1));
+		}
+	}
+}
+
+
+/*
+ *
+ * Run-length encoding.
+ *
+ */
+
+/*!
+ * Run-length encode a packed mask row, returns the number of spans written.
+ * Spans beyond @p max_spans are dropped.
+ */
+static uint32_t
+encode_mask_row(const uint64_t *mask, uint32_t width, uint16_t y, struct t_rle_span *spans, uint32_t max_spans)
+{
+	uint32_t words = T_HSV_MASK_WORDS(width);
+	uint32_t count = 0;
+	bool in_run = false;
+	uint32_t start = 0;
+
+	for (uint32_t w = 0; w < words; w++) {
+		uint64_t m = mask[w];
+
+		// Bits past the width are ignored.
+		uint32_t valid = MIN(BLOCK, width - w * BLOCK);
+		if (valid < BLOCK) {
+			m &= (UINT64_C(1) << valid) - 1;
+		}
+
+		// Look for transitions instead of walking every bit.
+		uint32_t bit = 0;
+		while (bit < BLOCK) {
+			uint64_t rest = in_run ? ~m >> bit : m >> bit;
+			if (rest == 0) {
+				break;
+			}
+
+			bit += ctz64(rest);
+			if (bit >= BLOCK) {
+				break;
+			}
+
+			if (!in_run) {
+				start = w * BLOCK + bit;
+				in_run = true;
+			} else {
+				if (count < max_spans) {
+					spans[count++] = (struct t_rle_span){y, (uint16_t)start, (uint16_t)(w * BLOCK + bit)};
+				}
+				in_run = false;
+			}
+		}
+	}
+
+	if (in_run && count < max_spans) {
+		spans[count++] = (struct t_rle_span){y, (uint16_t)start, (uint16_t)width};
+	}
+
+	return count;
+}
+
+uint32_t
+t_rle_encode_l8_row(
+    const uint8_t *row, uint32_t width, uint8_t threshold, uint16_t y, struct t_rle_span *spans, uint32_t max_spans)
+{
+	uint64_t mask[T_HSV_MASK_WORDS(4096)];
+	uint32_t count = 0;
+
+	// Encode in chunks that fit the stack buffer, joining runs across chunks.
+	for (uint32_t base = 0; base < width; base += 4096) {
+		uint32_t chunk = MIN(4096, width - base);
+
+		for (uint32_t b = 0, word = 0; b < chunk; b += BLOCK, word++) {
+			uint32_t n = MIN(BLOCK, chunk - b);
+			uint64_t m = 0;
+			uint32_t i = 0;
+			for (; i + 8 <= n; i += 8) {
+				m |= above8(&row[base + b + i], threshold) << i;
+			}
+			for (; i < n; i++) {
+				m |= (uint64_t)(row[base + b + i] > threshold) << i;
+			}
+			mask[word] = m;
+		}
+
+		uint32_t first = count;
+		count += encode_mask_row(mask, chunk, y, spans + count, max_spans - count);
+
+		for (uint32_t i = first; i < count; i++) {
+			spans[i].x_start += base;
+			spans[i].x_end += base;
+		}
+
+		if (first > 0 && count > first && spans[first - 1].x_end == spans[first].x_start) {
+			spans[first - 1].x_end = spans[first].x_end;
+			memmove(&spans[first], &spans[first + 1], sizeof(spans[0]) * (count - first - 1));
+			count--;
+		}
+	}
+
+	return count;
+}
+
+
+/*
+ *
+ * Blob extraction.
+ *
+ */
+
+static uint32_t
+find_root(uint32_t *parent, uint32_t i)
+{
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+static void
+join(uint32_t *parent, uint32_t a, uint32_t b)
+{
+	a = find_root(parent, a);
+	b = find_root(parent, b);
+
+	// Keep the earliest span as the root so blobs come out in scan order.
+	if (a < b) {
+		parent[b] = a;
+	} else if (b < a) {
+		parent[a] = b;
+	}
+}
+
+static bool
+ensure_capacity(struct t_rle_blob_finder *f, uint32_t count)
+{
+	if (count <= f->capacity) {
+		return true;
+	}
+
+	uint32_t *parent = U_TYPED_ARRAY_CALLOC(uint32_t, count);
+	struct t_rle_blob *acc = U_TYPED_ARRAY_CALLOC(struct t_rle_blob, count);
+	uint64_t *sum_x2 = U_TYPED_ARRAY_CALLOC(uint64_t, count);
+	uint64_t *sum_y = U_TYPED_ARRAY_CALLOC(uint64_t, count);
+	if (parent == NULL || acc == NULL || sum_x2 == NULL || sum_y == NULL) {
+		free(parent);
+		free(acc);
+		free(sum_x2);
+		free(sum_y);
+		return false;
+	}
+
+	t_rle_blob_finder_destroy(f);
+
+	f->parent = parent;
+	f->acc = acc;
+	f->sum_x2 = sum_x2;
+	f->sum_y = sum_y;
+	f->capacity = count;
+
+	return true;
+}
+
+uint32_t
+t_rle_find_blobs(struct t_rle_blob_finder *f,
+                 const struct t_rle_span *spans,
+                 uint32_t span_count,
+                 uint32_t min_area,
+                 uint32_t max_area,
+                 struct t_rle_blob *blobs,
+                 uint32_t max_blobs)
+{
+	if (span_count == 0 || !ensure_capacity(f, span_count)) {
+		return 0;
+	}
+
+	uint32_t *parent = f->parent;
+	for (uint32_t i = 0; i < span_count; i++) {
+		parent[i] = i;
+	}
+
+	// Join spans that touch, including diagonally, with spans of the row above.
+	uint32_t prev_begin = 0, prev_end = 0;
+	uint32_t cur_begin = 0;
+	while (cur_begin < span_count) {
+		uint16_t y = spans[cur_begin].y;
+		uint32_t cur_end = cur_begin;
+		while (cur_end < span_count && spans[cur_end].y == y) {
+			cur_end++;
+		}
+
+		if (prev_end > prev_begin && spans[prev_begin].y + 1 == y) {
+			uint32_t i = prev_begin;
+			uint32_t j = cur_begin;
+			while (i < prev_end && j < cur_end) {
+				const struct t_rle_span *a = &spans[i];
+				const struct t_rle_span *b = &spans[j];
+				if (a->x_start <= b->x_end && b->x_start <= a->x_end) {
+					join(parent, i, j);
+				}
+				if (a->x_end < b->x_end) {
+					i++;
+				} else {
+					j++;
+				}
+			}
+		}
+
+		prev_begin = cur_begin;
+		prev_end = cur_end;
+		cur_begin = cur_end;
+	}
+
+	// Accumulate area, moments and bounds on the roots.
+	for (uint32_t i = 0; i < span_count; i++) {
+		const struct t_rle_span *s = &spans[i];
+		uint32_t r = find_root(parent, i);
+		uint32_t len = s->x_end - s->x_start;
+
+		struct t_rle_blob *b = &f->acc[r];
+		if (r == i) {
+			b->area = 0;
+			b->min_x = s->x_start;
+			b->max_x = s->x_end - 1;
+			b->min_y = s->y;
+			b->max_y = s->y;
+			f->sum_x2[r] = 0;
+			f->sum_y[r] = 0;
+		}
+
+		b->area += len;
+		b->min_x = MIN(b->min_x, s->x_start);
+		b->max_x = MAX(b->max_x, s->x_end - 1);
+		b->max_y = MAX(b->max_y, s->y);
+		// Sum of x over the span times two, keeps it in integers.
+		f->sum_x2[r] += (uint64_t)(s->x_start + s->x_end - 1) * len;
+		f->sum_y[r] += (uint64_t)s->y * len;
+	}
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < span_count && count < max_blobs; i++) {
+		if (parent[i] != i) {
+			continue;
+		}
+
+		struct t_rle_blob b = f->acc[i];
+		if (b.area < min_area || b.area > max_area) {
+			continue;
+		}
+
+		b.x = (float)((double)f->sum_x2[i] / (2.0 * b.area));
+		b.y = (float)((double)f->sum_y[i] / b.area);
+		blobs[count++] = b;
+	}
+
+	return count;
+}
+
+uint32_t
+t_rle_merge_blobs(struct t_rle_blob *blobs, uint32_t count, float min_dist)
+{
+	float min_dist_sq = min_dist * min_dist;
+
+	for (uint32_t i = 0; i < count; i++) {
+		struct t_rle_blob *a = &blobs[i];
+
+		// Compact the blobs after this one, folding close ones into it.
+		uint32_t kept = i + 1;
+		for (uint32_t j = i + 1; j < count; j++) {
+			const struct t_rle_blob *b = &blobs[j];
+			float dx = b->x - a->x;
+			float dy = b->y - a->y;
+
+			if (dx * dx + dy * dy >= min_dist_sq) {
+				blobs[kept++] = *b;
+				continue;
+			}
+
+			uint32_t area = a->area + b->area;
+			a->x = (a->x * a->area + b->x * b->area) / area;
+			a->y = (a->y * a->area + b->y * b->area) / area;
+			a->area = area;
+			a->min_x = MIN(a->min_x, b->min_x);
+			a->min_y = MIN(a->min_y, b->min_y);
+			a->max_x = MAX(a->max_x, b->max_x);
+			a->max_y = MAX(a->max_y, b->max_y);
+		}
+
+		count = kept;
+	}
+
+	return count;
+}
+
+void
+t_rle_blob_finder_destroy(struct t_rle_blob_finder *f)
+{
+	free(f->parent);
+	free(f->acc);
+	free(f->sum_x2);
+	free(f->sum_y);
+	U_ZERO(f);
+}
@@ -15,6 +15,7 @@
 #include "tracking/t_calibration_opencv.hpp"
 #include "tracking/t_tracker_psmv_fusion.hpp"
 #include "tracking/t_helper_debug_sink.hpp"
+#include "tracking/t_blob_detector.hpp"
 
 #include "util/u_var.h"
 #include "util/u_misc.h"
@@ -114,7 +115,7 @@ public:
 	cv::Vec3d r_cam_translation;
 	cv::Matx33d r_cam_rotation;
 
-	cv::Ptr<cv::SimpleBlobDetector> sbd;
+	RleBlobDetector blob_detector;
 
 	std::shared_ptr<PSMVFusionInterface> filter;
 
@@ -148,24 +149,12 @@ do_view(TrackerPSMV &t, View &view, cv::Mat &grey, cv::Mat &rgb)
 		          cv::Scalar(0, 0, 0));         // borderValue
 	}
 
-	{
-		XRT_TRACE_IDENT(threshold);
-
-		cv::threshold(view.frame_undist_rectified, // src
-		              view.frame_undist_rectified, // dst
-		              32.0,                        // thresh
-		              255.0,                       // maxval
-		              0);                          // type
-	}
-
 	{
 		XRT_TRACE_IDENT(detect);
 
-		// Do blob detection with our masks.
+		// Threshold and find blobs in one pass over the image.
 		//! @todo Re-enable masks.
-		t.sbd->detect(view.frame_undist_rectified, // image
-		              view.keypoints,              // keypoints
-		              cv::noArray());              // mask
+		t.blob_detector.detect(view.frame_undist_rectified, view.keypoints);
 	}
 
 
@@ -324,16 +313,20 @@ process(TrackerPSMV &t, struct xrt_frame *xf)
 		cv::Point3f world_point = nearest_world.best;
 		// update internal state
 		memcpy(&t.tracked_object_position, &world_point.x, sizeof(t.tracked_object_position));
-	} else {
-		t.filter->clear_position_tracked_flag();
 	}
 
+	// The filter takes the measurement at the time the frame was captured.
+	timepoint_ns frame_ns = xf->timestamp;
+
 	// We are done with the debug frame.
 	t.debug.submit();
 
 	// We are done with the frame.
 	xrt_frame_reference(&xf, NULL);
 
+	// The filter is also fed from the IMU callback.
+	os_thread_helper_lock(&t.oth);
+
 	if (nearest_world.got_one) {
 #if 0
 		//! @todo something less arbitrary for the lever arm?
@@ -349,12 +342,14 @@ process(TrackerPSMV &t, struct xrt_frame *xf)
 		// some research.
 		xrt_vec3 variance{1.e-4f, 1.e-4f, 4.e-4f};
 #endif
-		t.filter->process_3d_vision_data(0, &t.tracked_object_position, NULL, NULL,
+		t.filter->process_3d_vision_data(frame_ns, &t.tracked_object_position, NULL, NULL,
 		                                 //! @todo tune cutoff for residual arbitrarily "too large"
 		                                 15);
 	} else {
 		t.filter->clear_position_tracked_flag();
 	}
+
+	os_thread_helper_unlock(&t.oth);
 }
 
 /*!
@@ -618,24 +613,13 @@ t_psmv_create(struct xrt_frame_context *xfctx,
 	t.r_cam_translation = wrapped.camera_translation_mat;
 	t.calibrated = true;
 
-	// clang-format off
-	cv::SimpleBlobDetector::Params blob_params;
-	blob_params.filterByArea = false;
-	blob_params.filterByConvexity = true;
-	blob_params.minConvexity = 0.8;
-	blob_params.filterByInertia = false;
-	blob_params.filterByColor = true;
-	blob_params.blobColor = 255; // 0 or 255 - color comes from binarized image?
-	blob_params.minArea = 1;
-	blob_params.maxArea = 1000;
-	blob_params.maxThreshold = 51; // using a wide threshold span slows things down bigtime
-	blob_params.minThreshold = 50;
-	blob_params.thresholdStep = 1;
-	blob_params.minDistBetweenBlobs = 5;
-	blob_params.minRepeatability = 1; // need this to avoid error?
-	// clang-format on
-
-	t.sbd = cv::SimpleBlobDetector::create(blob_params);
+	// Ball is round, reject odd shapes like the old convexity filter did.
+	t.blob_detector.threshold = 32;
+	t.blob_detector.min_area = 1;
+	t.blob_detector.max_area = UINT32_MAX;
+	t.blob_detector.min_fill = 0.5f;
+	t.blob_detector.min_dist = 5.0f;
+
 	xrt_frame_context_add(xfctx, &t.node);
 
 	// Everything is safe, now setup the variable tracking.
@@ -13,6 +13,8 @@
 #include "tracking/t_tracking.h"
 #include "tracking/t_calibration_opencv.hpp"
 #include "tracking/t_helper_debug_sink.hpp"
+#include "tracking/t_blob_detector.hpp"
+#include "tracking/t_pose_fusion.hpp"
 
 #include "util/u_misc.h"
 #include "util/u_debug.h"
@@ -93,9 +95,11 @@ DEBUG_GET_ONCE_LOG_OPTION(psvr_log, "PSVR_TRACKING_LOG", U_LOGGING_WARN)
 #define PSVR_BLOB_PROCESS_NOISE 0.1f     // R
 #define PSVR_BLOB_MEASUREMENT_NOISE 1.0f // Q
 
-#define PSVR_POSE_PROCESS_NOISE 0.5f // R
-//! Our measurements are quite noisy so we need to smooth heavily
-#define PSVR_POSE_MEASUREMENT_NOISE 100.0f
+//! Our measurements are quite noisy so we need to smooth heavily, in m^2
+#define PSVR_POSE_MEASUREMENT_VARIANCE 1.e-3f
+
+//! Solved positions this far from the filtered one reset the filter, in m
+#define PSVR_POSE_RESIDUAL_LIMIT 0.5f
 
 #define PSVR_OUTLIER_THRESH 0.17f
 #define PSVR_MERGE_THRESH 0.06f
@@ -260,8 +264,9 @@ public:
 	cv::KalmanFilter track_filters[PSVR_NUM_LEDS];
 
 
-	cv::KalmanFilter pose_filter; // we filter the final pose position of
-	                              // the HMD to smooth motion
+	// we filter the final pose position of the HMD, together with the
+	// imu, to smooth motion
+	std::unique_ptr<PoseFusion> pose_fusion;
 
 	View view[2];
 	bool calibrated;
@@ -272,7 +277,7 @@ public:
 	cv::Vec3d r_cam_translation;
 	cv::Matx33d r_cam_rotation;
 
-	cv::Ptr<cv::SimpleBlobDetector> sbd;
+	RleBlobDetector blob_detector;
 	std::vector<cv::KeyPoint> l_blobs, r_blobs;
 	std::vector<match_model_t> matches;
 
@@ -380,34 +385,6 @@ filter_update(std::vector<match_data_t> *pose, cv::KalmanFilter *filters, float
 	}
 }
 
-static void
-pose_filter_predict(Eigen::Vector4f *pose, cv::KalmanFilter *filter, float dt)
-{
-	// set our dt components in the transition matrix
-	filter->transitionMatrix.at<float>(0, 3) = dt;
-	filter->transitionMatrix.at<float>(1, 4) = dt;
-	filter->transitionMatrix.at<float>(2, 5) = dt;
-
-	cv::Mat prediction = filter->predict();
-	(*pose)[0] = prediction.at<float>(0, 0);
-	(*pose)[1] = prediction.at<float>(1, 0);
-	(*pose)[2] = prediction.at<float>(2, 0);
-}
-
-static void
-pose_filter_update(Eigen::Vector4f *position, cv::KalmanFilter *filter, float dt)
-{
-	filter->transitionMatrix.at<float>(0, 3) = dt;
-	filter->transitionMatrix.at<float>(1, 4) = dt;
-	filter->transitionMatrix.at<float>(2, 5) = dt;
-
-	cv::Mat measurement = cv::Mat(3, 1, CV_32F);
-	measurement.at<float>(0, 0) = position->x();
-	measurement.at<float>(1, 0) = position->y();
-	measurement.at<float>(2, 0) = position->z();
-	filter->correct(measurement);
-}
-
 static bool
 match_possible(match_model_t *match)
 {
@@ -1243,9 +1220,9 @@ do_view(TrackerPSVR &t, View &view, cv::Mat &grey, cv::Mat &rgb)
 	              32.0,                        // thresh
 	              255.0,                       // maxval
 	              0);
-	t.sbd->detect(view.frame_undist_rectified, // image
-	              view.keypoints,              // keypoints
-	              cv::noArray());              // mask
+
+	// The binarized image is kept, blob_intersections samples it later.
+	t.blob_detector.detect(view.frame_undist_rectified, view.keypoints);
 
 	// Debug is wanted, draw the keypoints.
 	if (rgb.cols > 0) {
@@ -1791,21 +1768,24 @@ process(TrackerPSVR &t, struct xrt_frame *xf)
 
 
 	Eigen::Vector4f position = model_center_transform.col(3);
-	pose_filter_update(&position, &t.pose_filter, dt);
-
-
+	struct xrt_vec3 measured = {position.x(), position.y(), position.z()};
+	struct xrt_vec3 variance = {PSVR_POSE_MEASUREMENT_VARIANCE, PSVR_POSE_MEASUREMENT_VARIANCE,
+	                            PSVR_POSE_MEASUREMENT_VARIANCE};
 
 	// NOTE: we will apply our rotation when we get imu
 	// data - applying our calculated optical
 	// correction at this time. We can update our
-	// position now.
-	Eigen::Vector4f filtered_pose;
-	pose_filter_predict(&filtered_pose, &t.pose_filter, dt / 1000.0f);
+	// position now, at the time the frame was captured,
+	// the filter is also fed from the imu callback.
+	os_thread_helper_lock(&t.oth);
 
+	t.pose_fusion->process_position(xf->timestamp, &measured, &variance, NULL, PSVR_POSE_RESIDUAL_LIMIT);
 
-	t.optical.pos.x = filtered_pose.x();
-	t.optical.pos.y = filtered_pose.y();
-	t.optical.pos.z = filtered_pose.z();
+	struct xrt_space_relation filtered;
+	t.pose_fusion->get_relation(xf->timestamp, &filtered);
+	t.optical.pos = filtered.pose.position;
+
+	os_thread_helper_unlock(&t.oth);
 
 	t.last_frame = xf->source_sequence;
 
@@ -1863,13 +1843,19 @@ get_pose(TrackerPSVR &t, timepoint_ns when_ns, struct xrt_space_relation *out_re
 		return;
 	}
 
-	out_relation->pose.position = t.optical.pos;
+	// The position filter predicts to when_ns.
+	struct xrt_space_relation filtered;
+	t.pose_fusion->get_relation(when_ns, &filtered);
+
+	out_relation->pose.position = filtered.pose.position;
 	out_relation->pose.orientation = t.optical.rot;
+	out_relation->linear_velocity = filtered.linear_velocity;
 
 	//! @todo assuming that orientation is actually
 	//! currently tracked.
 	out_relation->relation_flags = (enum xrt_space_relation_flags)(XRT_SPACE_RELATION_POSITION_VALID_BIT |
 	                                                               XRT_SPACE_RELATION_POSITION_TRACKED_BIT |
+	                                                               XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT |
 	                                                               XRT_SPACE_RELATION_ORIENTATION_VALID_BIT);
 
 	if (t.done_correction) {
@@ -1894,6 +1880,9 @@ imu_data(TrackerPSVR &t, timepoint_ns timestamp_ns, struct xrt_tracking_sample *
 		m_imu_3dof_update(&t.fusion.imu_3dof, timestamp_ns, &sample->accel_m_s2, &sample->gyro_rad_secs);
 	}
 
+	// Keeps the position filter running at the imu rate.
+	t.pose_fusion->process_imu(timestamp_ns, &sample->accel_m_s2, &sample->gyro_rad_secs, NULL);
+
 	// apply our optical correction to imu rotation
 	// data
 
@@ -2060,7 +2049,7 @@ t_psvr_create(struct xrt_frame_context *xfctx,
 		init_filter(t.track_filters[i], PSVR_BLOB_PROCESS_NOISE, PSVR_BLOB_MEASUREMENT_NOISE, 1.0f);
 	}
 
-	init_filter(t.pose_filter, PSVR_POSE_PROCESS_NOISE, PSVR_POSE_MEASUREMENT_NOISE, 1.0f);
+	t.pose_fusion = PoseFusion::create();
 
 	StereoRectificationMaps rectify(data);
 	t.view[0].populate_from_calib(data->view[0], rectify.view[0].rectify);
@@ -2073,23 +2062,10 @@ t_psvr_create(struct xrt_frame_context *xfctx,
 
 
 
-	// clang-format off
-	cv::SimpleBlobDetector::Params blob_params;
-	blob_params.filterByArea = false;
-	blob_params.filterByConvexity = false;
-	blob_params.filterByInertia = false;
-	blob_params.filterByColor = true;
-	blob_params.blobColor = 255; // 0 or 255 - color comes from binarized image?
-	blob_params.minArea = 1;
-	blob_params.maxArea = 1000;
-	blob_params.maxThreshold = 51; // using a wide threshold span slows things down bigtime
-	blob_params.minThreshold = 50;
-	blob_params.thresholdStep = 1;
-	blob_params.minDistBetweenBlobs = 5;
-	blob_params.minRepeatability = 1; // need this to avoid error?
-	// clang-format on
-
-	t.sbd = cv::SimpleBlobDetector::create(blob_params);
+	t.blob_detector.threshold = 32;
+	t.blob_detector.min_area = 1;
+	t.blob_detector.max_area = UINT32_MAX;
+	t.blob_detector.min_dist = 5.0f;
 
 	t.target_optical_rotation_correction = Eigen::Quaternionf(1.0f, 0.0f, 0.0f, 0.0f);
 	t.optical_rotation_correction = Eigen::Quaternionf(1.0f, 0.0f, 0.0f, 0.0f);
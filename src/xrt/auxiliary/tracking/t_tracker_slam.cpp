@@ -21,6 +21,7 @@
 #include "math/m_api.h"
 #include "math/m_filter_fifo.h"
 #include "math/m_filter_one_euro.h"
+#include "math/m_imu_preintegration.h"
 #include "math/m_predict.h"
 #include "math/m_relation_history.h"
 #include "math/m_space.h"
@@ -290,9 +291,10 @@ struct TrackerSlam
 	RelationHistory slam_rels{};    //!< A history of relations produced purely from external SLAM tracker data
 	int dbg_pred_every = 1;         //!< Skip X SLAM poses so that you get tracked mostly by the prediction algo
 	int dbg_pred_counter = 0;       //!< SLAM pose counter for prediction debugging
-	struct os_mutex lock_ff;        //!< Lock for gyro_ff and accel_ff.
-	struct m_ff_vec3_f32 *gyro_ff;  //!< Last gyroscope samples
-	struct m_ff_vec3_f32 *accel_ff; //!< Last accelerometer samples
+	struct m_ff_vec3_f32 *gyro_ff;  //!< Last gyroscope samples, pushed only by the IMU thread
+	struct m_ff_vec3_f32 *accel_ff; //!< Last accelerometer samples, pushed only by the IMU thread
+	struct os_mutex lock_preint;    //!< Lock for imu_preint.
+	struct m_imu_preint imu_preint; //!< IMU samples integrated since the last SLAM pose
 	vector<u_sink_debug> ui_sink;   //!< Sink to display frames in UI of each camera
 
 	//! Used to correct accelerometer measurements when integrating into the prediction.
@@ -305,6 +307,9 @@ struct TrackerSlam
 	//! Filters are used to smooth out the resulting trajectory
 	struct
 	{
+		//! Every get_tracked_pose caller runs the filters, from any thread and at any timestamp.
+		struct os_mutex lock;
+
 		// Moving average filter
 		bool use_moving_average_filter = false;
 		//! Time window in ms take the average on.
@@ -815,80 +820,21 @@ predict_pose_from_imu(TrackerSlam &t,
                       timepoint_ns base_rel_ts,
                       struct xrt_space_relation *out_relation)
 {
-	os_mutex_lock(&t.lock_ff);
-
-	// Find oldest imu index i that is newer than latest SLAM pose (or -1)
-	int i = 0;
-	uint64_t imu_ts = UINT64_MAX;
-	xrt_vec3 _;
-	while (m_ff_vec3_f32_get(t.gyro_ff, i, &_, &imu_ts)) {
-		if ((int64_t)imu_ts < base_rel_ts) {
-			i--; // Back to the oldest newer-than-SLAM IMU index (or -1)
-			break;
-		}
-		i++;
-	}
-
-	if (i == -1) {
-		SLAM_WARN("No IMU samples received after latest SLAM pose (and frame)");
-	}
-
-	xrt_space_relation integ_rel = base_rel;
+	// The samples since base_rel_ts are already integrated, only look up up to when_ns
+	m_imu_preint_delta delta{};
 	timepoint_ns integ_rel_ts = base_rel_ts;
-	xrt_quat &o = integ_rel.pose.orientation;
-	xrt_vec3 &p = integ_rel.pose.position;
-	xrt_vec3 &w = integ_rel.angular_velocity;
-	xrt_vec3 &v = integ_rel.linear_velocity;
-	bool clamped = false; // If when_ns is older than the latest IMU ts
-
-	while (i >= 0) { // Decreasing i increases timestamp
-		// Get samples
-		xrt_vec3 g{};
-		xrt_vec3 a{};
-		uint64_t g_ts{};
-		uint64_t a_ts{};
-		bool got = true;
-		got &= m_ff_vec3_f32_get(t.gyro_ff, i, &g, &g_ts);
-		got &= m_ff_vec3_f32_get(t.accel_ff, i, &a, &a_ts);
-		timepoint_ns ts = g_ts;
-
-
-		// Checks
-		if (ts > when_ns) {
-			clamped = true;
-			//! @todo Instead of using same a and g values, do an interpolated sample like this:
-			// a = prev_a + ((when_ns - prev_ts) / (ts - prev_ts)) * (a - prev_a);
-			// g = prev_g + ((when_ns - prev_ts) / (ts - prev_ts)) * (g - prev_g);
-			ts = when_ns; // clamp ts to when_ns
-		}
-		SLAM_DASSERT(got && g_ts == a_ts, "Failure getting synced gyro and accel samples");
-		SLAM_DASSERT(ts >= base_rel_ts, "Accessing imu sample that is older than latest SLAM pose");
 
-		// Update time
-		float dt = (float)time_ns_to_s(ts - integ_rel_ts);
-		integ_rel_ts = ts;
+	os_mutex_lock(&t.lock_preint);
+	m_imu_preint_set_base(&t.imu_preint, base_rel_ts);
+	bool got = m_imu_preint_get(&t.imu_preint, when_ns, &delta, &integ_rel_ts);
+	os_mutex_unlock(&t.lock_preint);
 
-		// Integrate gyroscope
-		xrt_quat angvel_delta{};
-		xrt_vec3 scaled_half_g = g * dt * 0.5f;
-		math_quat_exp(&scaled_half_g, &angvel_delta); // Same as using math_quat_from_angle_vector(g/dt)
-		math_quat_rotate(&o, &angvel_delta, &o);      // Orientation
-		math_quat_rotate_derivative(&o, &g, &w);      // Angular velocity
-
-		// Integrate accelerometer
-		xrt_vec3 world_accel{};
-		math_quat_rotate_vec3(&o, &a, &world_accel);
-		world_accel += t.gravity_correction;
-		v += world_accel * dt;                        // Linear velocity
-		p += v * dt + world_accel * (dt * dt * 0.5f); // Position
-
-		if (clamped) {
-			break;
-		}
-		i--;
+	if (!got) {
+		SLAM_WARN("No IMU samples received after latest SLAM pose (and frame)");
 	}
 
-	os_mutex_unlock(&t.lock_ff);
+	xrt_space_relation integ_rel{};
+	m_imu_preint_apply(&delta, &base_rel, &t.gravity_correction, &integ_rel);
 
 	// Do the prediction based on the updated relation
 	double last_imu_to_now_dt = time_ns_to_s(when_ns - integ_rel_ts);
@@ -937,8 +883,6 @@ predict_pose(TrackerSlam &t, timepoint_ns when_ns, struct xrt_space_relation *ou
 		return;
 	}
 
-	os_mutex_lock(&t.lock_ff);
-
 	// Update angular velocity with gyro data
 	if (t.pred_type >= SLAM_PRED_SP_SO_IA_SL) {
 		xrt_vec3 avg_gyro{};
@@ -957,8 +901,6 @@ predict_pose(TrackerSlam &t, timepoint_ns when_ns, struct xrt_space_relation *ou
 		rel.linear_velocity += world_accel * slam_to_imu_dt;
 	}
 
-	os_mutex_unlock(&t.lock_ff);
-
 	// Do the prediction based on the updated relation
 	double slam_to_now_dt = time_ns_to_s(when_ns - rel_ts);
 	xrt_space_relation predicted_relation{};
@@ -973,6 +915,8 @@ filter_pose(TrackerSlam &t, timepoint_ns when_ns, struct xrt_space_relation *out
 {
 	XRT_TRACE_MARKER();
 
+	os_mutex_lock(&t.filter.lock);
+
 	if (t.filter.use_moving_average_filter) {
 		if (out_relation->relation_flags & XRT_SPACE_RELATION_POSITION_VALID_BIT) {
 			xrt_vec3 pos = out_relation->pose.position;
@@ -1020,6 +964,8 @@ filter_pose(TrackerSlam &t, timepoint_ns when_ns, struct xrt_space_relation *out
 			m_filter_euro_quat_run(&t.filter.rot_oe, when_ns, &p.orientation, &p.orientation);
 		}
 	}
+
+	os_mutex_unlock(&t.filter.lock);
 }
 
 static void
@@ -1032,9 +978,11 @@ setup_ui(TrackerSlam &t)
 	for (size_t i = 0; i < t.ui_sink.size(); i++) {
 		u_sink_debug_init(&t.ui_sink[i]);
 	}
-	os_mutex_init(&t.lock_ff);
+	os_mutex_init(&t.lock_preint);
 	m_ff_vec3_f32_alloc(&t.gyro_ff, 1000);
 	m_ff_vec3_f32_alloc(&t.accel_ff, 1000);
+	m_imu_preint_init(&t.imu_preint);
+	os_mutex_init(&t.filter.lock);
 	m_ff_vec3_f32_alloc(&t.filter.pos_ff, 1000);
 	m_ff_vec3_f32_alloc(&t.filter.rot_ff, 1000);
 
@@ -1328,10 +1276,12 @@ t_slam_receive_imu(struct xrt_imu_sink *sink, struct xrt_imu_sample *s)
 
 	struct xrt_vec3 gyro = {(float)w.x, (float)w.y, (float)w.z};
 	struct xrt_vec3 accel = {(float)a.x, (float)a.y, (float)a.z};
-	os_mutex_lock(&t.lock_ff);
 	m_ff_vec3_f32_push(t.gyro_ff, &gyro, ts);
 	m_ff_vec3_f32_push(t.accel_ff, &accel, ts);
-	os_mutex_unlock(&t.lock_ff);
+
+	os_mutex_lock(&t.lock_preint);
+	m_imu_preint_push(&t.imu_preint, ts, &gyro, &accel);
+	os_mutex_unlock(&t.lock_preint);
 }
 
 //! Push the frame to the external SLAM system
@@ -1474,7 +1424,8 @@ t_slam_node_destroy(struct xrt_frame_node *node)
 	}
 	m_ff_vec3_f32_free(&t.gyro_ff);
 	m_ff_vec3_f32_free(&t.accel_ff);
-	os_mutex_destroy(&t.lock_ff);
+	os_mutex_destroy(&t.lock_preint);
+	os_mutex_destroy(&t.filter.lock);
 	m_ff_vec3_f32_free(&t.filter.pos_ff);
 	m_ff_vec3_f32_free(&t.filter.rot_ff);
 
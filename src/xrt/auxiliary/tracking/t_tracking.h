@@ -534,6 +534,118 @@ t_hsv_filter_sample(struct t_hsv_filter_optimized_table *t, uint32_t y, uint32_t
 	return t->v[y / T_HSV_STEP][u / T_HSV_STEP][v / T_HSV_STEP];
 }
 
+/*!
+ * Number of 64 bit words needed for a packed mask row of @p WIDTH pixels.
+ */
+#define T_HSV_MASK_WORDS(WIDTH) (((WIDTH) + 63) / 64)
+
+/*!
+ * Classify a row of YUV888 pixels, writing one packed bit mask row per
+ * channel of the filter, bit n of word w is pixel w * 64 + n. Any of the
+ * @p masks may be NULL to skip that channel.
+ */
+void
+t_hsv_classify_row_yuv888(const struct t_hsv_filter_optimized_table *t,
+                          const uint8_t *src,
+                          uint32_t width,
+                          uint64_t *masks[4]);
+
+/*!
+ * Same as @ref t_hsv_classify_row_yuv888 but for YUYV422, @p width must be even.
+ */
+void
+t_hsv_classify_row_yuyv(const struct t_hsv_filter_optimized_table *t,
+                        const uint8_t *src,
+                        uint32_t width,
+                        uint64_t *masks[4]);
+
+/*!
+ * Expand a packed mask row to one byte per pixel, 0xff for set bits.
+ */
+void
+t_hsv_mask_expand_row(const uint64_t *mask, uint32_t width, uint8_t *dst);
+
+/*!
+ * A run of set pixels in one row, @p x_end is exclusive.
+ */
+struct t_rle_span
+{
+	uint16_t y;
+	uint16_t x_start;
+	uint16_t x_end;
+};
+
+/*!
+ * Run-length encode a L8 row, pixels above @p threshold are set, returns the
+ * number of spans written. Spans beyond @p max_spans are dropped.
+ */
+uint32_t
+t_rle_encode_l8_row(
+    const uint8_t *row, uint32_t width, uint8_t threshold, uint16_t y, struct t_rle_span *spans, uint32_t max_spans);
+
+/*!
+ * A 8-connected group of spans.
+ */
+struct t_rle_blob
+{
+	//! Centroid in pixel coordinates, pixel centers are at integers.
+	float x;
+	float y;
+
+	uint32_t area;
+
+	//! Inclusive bounding box.
+	uint16_t min_x;
+	uint16_t min_y;
+	uint16_t max_x;
+	uint16_t max_y;
+};
+
+/*!
+ * Reusable scratch memory for @ref t_rle_find_blobs, zero initialise and
+ * free with @ref t_rle_blob_finder_destroy.
+ */
+struct t_rle_blob_finder
+{
+	uint32_t *parent;
+	struct t_rle_blob *acc;
+	uint64_t *sum_x2;
+	uint64_t *sum_y;
+	uint32_t capacity;
+};
+
+/*!
+ * Group spans into 8-connected blobs. The spans must be ordered by row and
+ * then by @p x_start, which is the order the encode functions produce when
+ * called row by row. Blobs with an area outside [@p min_area, @p max_area]
+ * are skipped, they are written in the order of their first span.
+ *
+ * @return Number of blobs written, at most @p max_blobs.
+ */
+uint32_t
+t_rle_find_blobs(struct t_rle_blob_finder *finder,
+                 const struct t_rle_span *spans,
+                 uint32_t span_count,
+                 uint32_t min_area,
+                 uint32_t max_area,
+                 struct t_rle_blob *blobs,
+                 uint32_t max_blobs);
+
+/*!
+ * Merge blobs whose centroids are closer than @p min_dist pixels, like the
+ * minDistBetweenBlobs parameter of cv::SimpleBlobDetector. Blobs are merged
+ * greedily in order into the first one, getting the area weighted centroid,
+ * the summed area and the union of the bounding boxes. The order of the
+ * remaining blobs is kept.
+ *
+ * @return Number of blobs left at the start of @p blobs.
+ */
+uint32_t
+t_rle_merge_blobs(struct t_rle_blob *blobs, uint32_t count, float min_dist);
+
+void
+t_rle_blob_finder_destroy(struct t_rle_blob_finder *finder);
+
 /*!
  * Construct an HSV filter sink.
  * @public @memberof t_hsv_filter
@@ -716,6 +828,12 @@ struct t_calibration_status
 	int cooldown;
 	//! Number of non-moving frames before capture.
 	int waits_remaining;
+	//! Reprojection error of the latest estimate, in pixels.
+	float rp_error;
+	//! Smallest fraction of the image covered by the board in any view.
+	float coverage;
+	//! Has the incremental estimate converged.
+	bool converged;
 	//! Stereo calibration data that was produced.
 	struct t_stereo_camera_calibration *stereo_data;
 };
@@ -774,6 +892,22 @@ struct t_calibration_params
 	int num_collect_total;
 	int num_collect_restart;
 
+	/*!
+	 * Refine the calibration as samples are collected, and finish early
+	 * once the board has covered enough of the image and the reprojection
+	 * error has stopped changing.
+	 */
+	struct
+	{
+		bool enabled;
+		//! Samples needed before the first refinement.
+		int min_samples;
+		//! Fraction of the image the board needs to have covered.
+		float min_coverage;
+		//! Relative change in reprojection error that counts as converged.
+		float max_error_change;
+	} incremental;
+
 	/*!
 	 * Should we mirror the RGB image?
 	 *
@@ -13,6 +13,7 @@
 
 #include "util/u_debug.h"
 #include "util/u_builders.h"
+#include "util/u_device_recorder.h"
 #include "util/u_system_helpers.h"
 #include "util/u_space_overseer.h"
 
@@ -20,6 +21,7 @@
 DEBUG_GET_ONCE_FLOAT_OPTION(tracking_origin_offset_x, "XRT_TRACKING_ORIGIN_OFFSET_X", 0.0f)
 DEBUG_GET_ONCE_FLOAT_OPTION(tracking_origin_offset_y, "XRT_TRACKING_ORIGIN_OFFSET_Y", 0.0f)
 DEBUG_GET_ONCE_FLOAT_OPTION(tracking_origin_offset_z, "XRT_TRACKING_ORIGIN_OFFSET_Z", 0.0f)
+DEBUG_GET_ONCE_OPTION(device_record_file, "XRT_DEVICE_RECORD_FILE", NULL)
 
 
 /*
@@ -37,6 +39,59 @@ apply_offset(struct xrt_vec3 *position, struct xrt_vec3 *offset)
 }
 
 
+static void
+replace_role(struct xrt_device **role,
+             int32_t *out_index,
+             struct xrt_device *old_xdev,
+             struct xrt_device *new_xdev,
+             int32_t index)
+{
+	if (*role != old_xdev) {
+		return;
+	}
+
+	*role = new_xdev;
+	*out_index = index;
+}
+
+/*!
+ * Wraps all of the devices in recorders if asked to, must be done before
+ * anything else holds on to the device pointers.
+ */
+static void
+maybe_record_devices(struct xrt_system_devices *xsysd, struct u_builder_roles_helper *ubrh)
+{
+	const char *path = debug_get_option_device_record_file();
+	if (path == NULL) {
+		return;
+	}
+
+	struct u_device_recorder *udr = u_device_recorder_open(path);
+	if (udr == NULL) {
+		return;
+	}
+
+	struct u_device_recorder_roles roles = {-1, -1, -1, -1, -1};
+
+	for (uint32_t i = 0; i < xsysd->xdev_count; i++) {
+		struct xrt_device *old_xdev = xsysd->xdevs[i];
+		struct xrt_device *new_xdev = u_device_recorder_wrap(udr, old_xdev);
+		int32_t index = (int32_t)i;
+
+		xsysd->xdevs[i] = new_xdev;
+
+		replace_role(&ubrh->head, &roles.head, old_xdev, new_xdev, index);
+		replace_role(&ubrh->left, &roles.left, old_xdev, new_xdev, index);
+		replace_role(&ubrh->right, &roles.right, old_xdev, new_xdev, index);
+		replace_role(&ubrh->hand_tracking.left, &roles.hand_tracking_left, old_xdev, new_xdev, index);
+		replace_role(&ubrh->hand_tracking.right, &roles.hand_tracking_right, old_xdev, new_xdev, index);
+	}
+
+	u_device_recorder_write_roles(udr, &roles);
+	u_device_recorder_unref(&udr);
+}
+
+
 /*
  *
  * 'Exported' function.
@@ -221,6 +276,8 @@ u_builder_roles_helper_open_system(struct xrt_builder *xb,
 		return xret;
 	}
 
+	maybe_record_devices(xsysd, &ubrh);
+
 	/*
 	 * Assign to role(s).
 	 */
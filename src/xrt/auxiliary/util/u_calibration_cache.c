@@ -0,0 +1,260 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  On disk cache for calibration blobs read from devices.
+ * @ingroup aux_util
+ */
+
+#include "xrt/xrt_config_os.h"
+
+#include "util/u_misc.h"
+#include "util/u_file.h"
+#include "util/u_debug.h"
+#include "util/u_logging.h"
+#include "util/u_calibration_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef XRT_OS_LINUX
+#include <unistd.h>
+#include <linux/limits.h>
+#endif
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(calibration_cache, "XRT_CALIBRATION_CACHE", true)
+
+#define CACHE_SUBPATH "calibration"
+#define CACHE_MAGIC "XRTCAL01"
+
+#define FNV_OFFSET_BASIS (0xcbf29ce484222325ULL)
+#define FNV_PRIME (0x100000001b3ULL)
+
+/*!
+ * Anything bigger than this is not a calibration blob, guards against
+ * allocating garbage sizes from a broken file.
+ */
+#define CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+struct cache_header
+{
+	char magic[8];
+
+	//! Hash of the full key, the file name is sanitized so could collide.
+	uint64_t key_hash;
+
+	//! Hash of the data that follows the header.
+	uint64_t data_hash;
+
+	uint64_t size;
+};
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static uint64_t
+fnv1a(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+#ifdef XRT_OS_LINUX
+
+static uint64_t
+key_hash(const char *driver, const char *serial, const char *version)
+{
+	// Include the terminators so "ab" + "c" differs from "a" + "bc".
+	uint64_t hash = FNV_OFFSET_BASIS;
+	hash = fnv1a(hash, driver, strlen(driver) + 1);
+	hash = fnv1a(hash, serial, strlen(serial) + 1);
+	hash = fnv1a(hash, version, strlen(version) + 1);
+	return hash;
+}
+
+static void
+sanitize(const char *str, char *out, size_t out_size)
+{
+	size_t i = 0;
+	for (; str[i] != '\0' && i + 1 < out_size; i++) {
+		char c = str[i];
+		bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.';
+		out[i] = ok ? c : '_';
+	}
+	out[i] = '\0';
+}
+
+static void
+make_filename(const char *driver, const char *serial, const char *version, char *out, size_t out_size)
+{
+	char parts[3][64];
+	sanitize(driver, parts[0], sizeof(parts[0]));
+	sanitize(serial, parts[1], sizeof(parts[1]));
+	sanitize(version, parts[2], sizeof(parts[2]));
+
+	snprintf(out, out_size, "%s-%s-%s.bin", parts[0], parts[1], parts[2]);
+}
+
+static bool
+make_path(const char *filename, char *out, size_t out_size)
+{
+	char dir[PATH_MAX];
+	ssize_t ret = u_file_get_cache_dir(dir, sizeof(dir));
+	if (ret <= 0 || ret >= (ssize_t)sizeof(dir)) {
+		return false;
+	}
+
+	int i = snprintf(out, out_size, "%s/%s/%s", dir, CACHE_SUBPATH, filename);
+	return i > 0 && i < (int)out_size;
+}
+
+static bool
+is_enabled(const char *serial)
+{
+	return serial != NULL && serial[0] != '\0' && debug_get_bool_option_calibration_cache();
+}
+
+#endif
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+uint64_t
+u_calibration_cache_hash(const void *data, size_t size)
+{
+	return fnv1a(FNV_OFFSET_BASIS, data, size);
+}
+
+#ifdef XRT_OS_LINUX
+
+bool
+u_calibration_cache_load(
+    const char *driver, const char *serial, const char *version, uint8_t **out_data, size_t *out_size)
+{
+	if (!is_enabled(serial)) {
+		return false;
+	}
+
+	char filename[256];
+	make_filename(driver, serial, version, filename, sizeof(filename));
+
+	FILE *file = u_file_open_file_in_cache_dir_subpath(CACHE_SUBPATH, filename, "rb");
+	if (file == NULL) {
+		U_LOG_D("No cached calibration '%s'", filename);
+		return false;
+	}
+
+	struct cache_header header;
+	uint8_t *data = NULL;
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||              //
+	    memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 || //
+	    header.key_hash != key_hash(driver, serial, version) ||        //
+	    header.size > CACHE_MAX_SIZE) {
+		goto err;
+	}
+
+	data = U_TYPED_ARRAY_CALLOC(uint8_t, header.size + 1);
+	if (data == NULL || fread(data, 1, header.size, file) != header.size) {
+		goto err;
+	}
+
+	if (u_calibration_cache_hash(data, header.size) != header.data_hash) {
+		goto err;
+	}
+
+	fclose(file);
+
+	U_LOG_D("Loaded cached calibration '%s'", filename);
+
+	*out_data = data;
+	*out_size = (size_t)header.size;
+
+	return true;
+
+err:
+	U_LOG_W("Ignoring broken cached calibration '%s'", filename);
+	free(data);
+	fclose(file);
+
+	return false;
+}
+
+bool
+u_calibration_cache_store(
+    const char *driver, const char *serial, const char *version, const uint8_t *data, size_t size)
+{
+	if (!is_enabled(serial) || size > CACHE_MAX_SIZE) {
+		return false;
+	}
+
+	char filename[256];
+	make_filename(driver, serial, version, filename, sizeof(filename));
+
+	// Write to a temporary file first so a crash never leaves half an entry.
+	char tmp_filename[sizeof(filename) + 8];
+	snprintf(tmp_filename, sizeof(tmp_filename), "%s.%d", filename, (int)getpid());
+
+	char path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+	if (!make_path(filename, path, sizeof(path)) || !make_path(tmp_filename, tmp_path, sizeof(tmp_path))) {
+		return false;
+	}
+
+	FILE *file = u_file_open_file_in_cache_dir_subpath(CACHE_SUBPATH, tmp_filename, "wb");
+	if (file == NULL) {
+		U_LOG_W("Could not open '%s' for writing", tmp_path);
+		return false;
+	}
+
+	struct cache_header header = {0};
+	memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+	header.key_hash = key_hash(driver, serial, version);
+	header.data_hash = u_calibration_cache_hash(data, size);
+	header.size = size;
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data, 1, size, file) == size;
+	ok = (fclose(file) == 0) && ok;
+
+	if (!ok || rename(tmp_path, path) != 0) {
+		U_LOG_W("Failed to write cached calibration '%s'", path);
+		remove(tmp_path);
+		return false;
+	}
+
+	U_LOG_D("Stored calibration '%s'", path);
+
+	return true;
+}
+
+#else
+
+bool
+u_calibration_cache_load(
+    const char *driver, const char *serial, const char *version, uint8_t **out_data, size_t *out_size)
+{
+	return false;
+}
+
+bool
+u_calibration_cache_store(
+    const char *driver, const char *serial, const char *version, const uint8_t *data, size_t size)
+{
+	return false;
+}
+
+#endif
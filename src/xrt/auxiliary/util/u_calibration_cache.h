@@ -0,0 +1,69 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  On disk cache for calibration blobs read from devices.
+ * @ingroup aux_util
+ */
+
+#pragma once
+
+#include "xrt/xrt_compiler.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * The 64-bit FNV-1a hash the cache checksums its entries with. Drivers whose
+ * device has no version to read can hash what describes the blob instead.
+ *
+ * @ingroup aux_util
+ */
+uint64_t
+u_calibration_cache_hash(const void *data, size_t size);
+
+/*!
+ * Load a calibration blob cached by @ref u_calibration_cache_store.
+ *
+ * Entries are keyed by driver, device serial and a version string that
+ * changes whenever the blob on the device may have changed, like the
+ * firmware version. Entries that don't match the key or fail their checksum
+ * are ignored. The returned data is followed by a zero byte that is not part
+ * of @p out_size, so text blobs can be used as strings directly.
+ *
+ * Always misses if the serial is empty, or if disabled with the
+ * `XRT_CALIBRATION_CACHE` option.
+ *
+ * @param      driver   Short name of the driver, part of the file name.
+ * @param      serial   Serial number of the device.
+ * @param      version  Firmware or data version of the device.
+ * @param[out] out_data Loaded data, to be freed with `free`.
+ * @param[out] out_size Size of the loaded data.
+ *
+ * @return true on a cache hit.
+ *
+ * @ingroup aux_util
+ */
+bool
+u_calibration_cache_load(
+    const char *driver, const char *serial, const char *version, uint8_t **out_data, size_t *out_size);
+
+/*!
+ * Store a calibration blob so that later starts can skip reading it from
+ * the device, see @ref u_calibration_cache_load.
+ *
+ * @return true if the entry was written.
+ *
+ * @ingroup aux_util
+ */
+bool
+u_calibration_cache_store(
+    const char *driver, const char *serial, const char *version, const uint8_t *data, size_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,486 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Wrapper device that records everything a device returns to a file.
+ * @ingroup aux_util
+ */
+
+#include "os/os_time.h"
+#include "os/os_threading.h"
+
+#include "math/m_api.h"
+
+#include "util/u_misc.h"
+#include "util/u_logging.h"
+#include "util/u_device_recorder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+
+/*
+ *
+ * Structs and defines.
+ *
+ */
+
+struct u_device_recorder
+{
+	struct xrt_reference ref;
+
+	//! Serialises writes from the different devices and threads.
+	struct os_mutex mutex;
+
+	FILE *file;
+
+	//! A short write leaves a partial record, nothing after it is written.
+	bool write_failed;
+
+	uint16_t device_count;
+};
+
+struct recorder_device
+{
+	struct xrt_device base;
+
+	struct xrt_device *target;
+
+	struct u_device_recorder *udr;
+
+	//! Index written into the record headers.
+	uint16_t index;
+
+	//! Copy of the inputs last written, only changes are recorded.
+	struct xrt_input *last_inputs;
+
+	//! Scratch space for the changed inputs.
+	struct u_device_recorder_input *changed;
+};
+
+
+/*
+ *
+ * Helper functions.
+ *
+ */
+
+static inline struct recorder_device *
+recorder_device(struct xrt_device *xdev)
+{
+	return (struct recorder_device *)xdev;
+}
+
+static void
+write_record(struct u_device_recorder *udr,
+             enum u_device_recorder_record_type type,
+             uint16_t device,
+             const void *data,
+             size_t size,
+             const void *extra,
+             size_t extra_size)
+{
+	struct u_device_recorder_record_header header = {
+	    .type = (uint16_t)type,
+	    .device = device,
+	    .size = (uint32_t)(size + extra_size),
+	    .timestamp_ns = (int64_t)os_monotonic_get_ns(),
+	};
+
+	os_mutex_lock(&udr->mutex);
+	if (!udr->write_failed) {
+		bool ok = fwrite(&header, sizeof(header), 1, udr->file) == 1 && //
+		          fwrite(data, size, 1, udr->file) == 1 &&              //
+		          (extra_size == 0 || fwrite(extra, extra_size, 1, udr->file) == 1);
+		if (!ok) {
+			U_LOG_E("Short write to the device recording, stopping the recording");
+			udr->write_failed = true;
+		}
+	}
+	os_mutex_unlock(&udr->mutex);
+}
+
+static void
+write_device(struct u_device_recorder *udr, uint16_t index, struct xrt_device *xdev)
+{
+	struct u_device_recorder_device dev = {
+	    .name = (uint32_t)xdev->name,
+	    .device_type = (uint32_t)xdev->device_type,
+	    .input_count = (uint32_t)xdev->input_count,
+	    .output_count = (uint32_t)xdev->output_count,
+	    .binding_profile_count = (uint32_t)xdev->binding_profile_count,
+	};
+	memcpy(dev.str, xdev->str, sizeof(dev.str));
+	memcpy(dev.serial, xdev->serial, sizeof(dev.serial));
+
+	dev.flags |= xdev->orientation_tracking_supported ? U_DEVICE_RECORDER_DEVICE_ORIENTATION_TRACKING : 0;
+	dev.flags |= xdev->position_tracking_supported ? U_DEVICE_RECORDER_DEVICE_POSITION_TRACKING : 0;
+	dev.flags |= xdev->hand_tracking_supported ? U_DEVICE_RECORDER_DEVICE_HAND_TRACKING : 0;
+	dev.flags |= xdev->eye_gaze_supported ? U_DEVICE_RECORDER_DEVICE_EYE_GAZE : 0;
+	dev.flags |= xdev->force_feedback_supported ? U_DEVICE_RECORDER_DEVICE_FORCE_FEEDBACK : 0;
+	dev.flags |= xdev->hmd != NULL ? U_DEVICE_RECORDER_DEVICE_HMD : 0;
+
+	size_t size = (xdev->input_count + xdev->output_count) * sizeof(uint32_t);
+	for (size_t i = 0; i < xdev->binding_profile_count; i++) {
+		const struct xrt_binding_profile *bp = &xdev->binding_profiles[i];
+		size += sizeof(struct u_device_recorder_binding_profile);
+		size += (bp->input_count + bp->output_count) * 2 * sizeof(uint32_t);
+	}
+	if (xdev->hmd != NULL) {
+		size += sizeof(struct u_device_recorder_hmd);
+	}
+
+	uint8_t *extra = U_TYPED_ARRAY_CALLOC(uint8_t, size);
+	uint8_t *ptr = extra;
+
+#define PUT_U32(VALUE)                                                                                                 \
+	do {                                                                                                           \
+		uint32_t v = (uint32_t)(VALUE);                                                                        \
+		memcpy(ptr, &v, sizeof(v));                                                                            \
+		ptr += sizeof(v);                                                                                      \
+	} while (false)
+
+	for (size_t i = 0; i < xdev->input_count; i++) {
+		PUT_U32(xdev->inputs[i].name);
+	}
+	for (size_t i = 0; i < xdev->output_count; i++) {
+		PUT_U32(xdev->outputs[i].name);
+	}
+	for (size_t i = 0; i < xdev->binding_profile_count; i++) {
+		const struct xrt_binding_profile *bp = &xdev->binding_profiles[i];
+		struct u_device_recorder_binding_profile rbp = {
+		    .name = (uint32_t)bp->name,
+		    .input_count = (uint32_t)bp->input_count,
+		    .output_count = (uint32_t)bp->output_count,
+		};
+		memcpy(ptr, &rbp, sizeof(rbp));
+		ptr += sizeof(rbp);
+
+		for (size_t k = 0; k < bp->input_count; k++) {
+			PUT_U32(bp->inputs[k].from);
+			PUT_U32(bp->inputs[k].device);
+		}
+		for (size_t k = 0; k < bp->output_count; k++) {
+			PUT_U32(bp->outputs[k].from);
+			PUT_U32(bp->outputs[k].device);
+		}
+	}
+
+#undef PUT_U32
+
+	if (xdev->hmd != NULL) {
+		const struct xrt_hmd_parts *hmd = xdev->hmd;
+		struct u_device_recorder_hmd rhmd = {
+		    .w_pixels = hmd->screens[0].w_pixels,
+		    .h_pixels = hmd->screens[0].h_pixels,
+		    .nominal_frame_interval_ns = hmd->screens[0].nominal_frame_interval_ns,
+		    .view_count = (uint32_t)hmd->view_count,
+		    .blend_mode_count = (uint32_t)hmd->blend_mode_count,
+		};
+		for (size_t i = 0; i < hmd->blend_mode_count; i++) {
+			rhmd.blend_modes[i] = (uint32_t)hmd->blend_modes[i];
+		}
+		memcpy(rhmd.views, hmd->views, sizeof(rhmd.views));
+		memcpy(rhmd.distortion_fov, hmd->distortion.fov, sizeof(rhmd.distortion_fov));
+		memcpy(ptr, &rhmd, sizeof(rhmd));
+		ptr += sizeof(rhmd);
+	}
+
+	assert((size_t)(ptr - extra) == size);
+
+	write_record(udr, U_DEVICE_RECORDER_RECORD_DEVICE, index, &dev, sizeof(dev), extra, size);
+
+	free(extra);
+}
+
+static void
+write_changed_inputs(struct recorder_device *d)
+{
+	struct xrt_input *inputs = d->target->inputs;
+	uint32_t count = 0;
+
+	for (size_t i = 0; i < d->target->input_count; i++) {
+		struct xrt_input *last = &d->last_inputs[i];
+		if (last->active == inputs[i].active && last->timestamp == inputs[i].timestamp &&
+		    memcmp(&last->value, &inputs[i].value, sizeof(last->value)) == 0) {
+			continue;
+		}
+		*last = inputs[i];
+
+		struct u_device_recorder_input *ri = &d->changed[count++];
+		ri->index = (uint32_t)i;
+		ri->active = inputs[i].active;
+		ri->timestamp = inputs[i].timestamp;
+		ri->value = inputs[i].value;
+	}
+
+	if (count == 0) {
+		return;
+	}
+
+	struct u_device_recorder_inputs header = {.count = count};
+	write_record(d->udr, U_DEVICE_RECORDER_RECORD_INPUTS, d->index, &header, sizeof(header), d->changed,
+	             count * sizeof(*d->changed));
+}
+
+
+/*
+ *
+ * Member functions.
+ *
+ */
+
+static void
+recorder_update_inputs(struct xrt_device *xdev)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	xrt_device_update_inputs(d->target);
+
+	write_changed_inputs(d);
+}
+
+static void
+recorder_get_tracked_pose(struct xrt_device *xdev,
+                          enum xrt_input_name name,
+                          uint64_t at_timestamp_ns,
+                          struct xrt_space_relation *out_relation)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	xrt_device_get_tracked_pose(d->target, name, at_timestamp_ns, out_relation);
+
+	struct u_device_recorder_tracked_pose rec = {
+	    .name = (uint32_t)name,
+	    .at_timestamp_ns = at_timestamp_ns,
+	    .relation = *out_relation,
+	};
+	write_record(d->udr, U_DEVICE_RECORDER_RECORD_TRACKED_POSE, d->index, &rec, sizeof(rec), NULL, 0);
+}
+
+static void
+recorder_get_hand_tracking(struct xrt_device *xdev,
+                           enum xrt_input_name name,
+                           uint64_t desired_timestamp_ns,
+                           struct xrt_hand_joint_set *out_value,
+                           uint64_t *out_timestamp_ns)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	xrt_device_get_hand_tracking(d->target, name, desired_timestamp_ns, out_value, out_timestamp_ns);
+
+	struct u_device_recorder_hand_tracking rec = {
+	    .name = (uint32_t)name,
+	    .at_timestamp_ns = desired_timestamp_ns,
+	    .out_timestamp_ns = *out_timestamp_ns,
+	    .value = *out_value,
+	};
+	write_record(d->udr, U_DEVICE_RECORDER_RECORD_HAND_TRACKING, d->index, &rec, sizeof(rec), NULL, 0);
+}
+
+static xrt_result_t
+recorder_get_face_tracking(struct xrt_device *xdev,
+                           enum xrt_input_name facial_expression_type,
+                           struct xrt_facial_expression_set *out_value)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	return xrt_device_get_face_tracking(d->target, facial_expression_type, out_value);
+}
+
+static void
+recorder_set_output(struct xrt_device *xdev, enum xrt_output_name name, const union xrt_output_value *value)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	xrt_device_set_output(d->target, name, value);
+}
+
+static void
+recorder_get_view_poses(struct xrt_device *xdev,
+                        const struct xrt_vec3 *default_eye_relation,
+                        uint64_t at_timestamp_ns,
+                        uint32_t view_count,
+                        struct xrt_space_relation *out_head_relation,
+                        struct xrt_fov *out_fovs,
+                        struct xrt_pose *out_poses)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	xrt_device_get_view_poses(d->target, default_eye_relation, at_timestamp_ns, view_count, out_head_relation,
+	                          out_fovs, out_poses);
+
+	struct u_device_recorder_view_poses rec = {
+	    .at_timestamp_ns = at_timestamp_ns,
+	    .default_eye_relation = *default_eye_relation,
+	    .view_count = MIN(view_count, XRT_MAX_VIEWS),
+	    .head_relation = *out_head_relation,
+	};
+	for (uint32_t i = 0; i < rec.view_count; i++) {
+		rec.fovs[i] = out_fovs[i];
+		rec.poses[i] = out_poses[i];
+	}
+	write_record(d->udr, U_DEVICE_RECORDER_RECORD_VIEW_POSES, d->index, &rec, sizeof(rec), NULL, 0);
+}
+
+static bool
+recorder_compute_distortion(
+    struct xrt_device *xdev, uint32_t view, float u, float v, struct xrt_uv_triplet *out_result)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	return xrt_device_compute_distortion(d->target, view, u, v, out_result);
+}
+
+static xrt_result_t
+recorder_get_visibility_mask(struct xrt_device *xdev,
+                             enum xrt_visibility_mask_type type,
+                             uint32_t view_index,
+                             struct xrt_visibility_mask **out_mask)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	return xrt_device_get_visibility_mask(d->target, type, view_index, out_mask);
+}
+
+static xrt_result_t
+recorder_ref_space_usage(struct xrt_device *xdev,
+                         enum xrt_reference_space_type type,
+                         enum xrt_input_name name,
+                         bool used)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	return xrt_device_ref_space_usage(d->target, type, name, used);
+}
+
+static bool
+recorder_is_form_factor_available(struct xrt_device *xdev, enum xrt_form_factor form_factor)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	return xrt_device_is_form_factor_available(d->target, form_factor);
+}
+
+static void
+recorder_destroy(struct xrt_device *xdev)
+{
+	struct recorder_device *d = recorder_device(xdev);
+
+	xrt_device_destroy(&d->target);
+	u_device_recorder_unref(&d->udr);
+
+	free(d->last_inputs);
+	free(d->changed);
+	free(d);
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+struct u_device_recorder *
+u_device_recorder_open(const char *path)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		U_LOG_E("Could not open '%s' for recording devices", path);
+		return NULL;
+	}
+
+	struct u_device_recorder_file_header header = {
+	    .version = U_DEVICE_RECORDER_VERSION,
+	    .start_ns = (int64_t)os_monotonic_get_ns(),
+	};
+	memcpy(header.magic, U_DEVICE_RECORDER_MAGIC, sizeof(header.magic));
+	if (fwrite(&header, sizeof(header), 1, file) != 1) {
+		U_LOG_E("Could not write the header of '%s'", path);
+		fclose(file);
+		return NULL;
+	}
+
+	struct u_device_recorder *udr = U_TYPED_CALLOC(struct u_device_recorder);
+	if (os_mutex_init(&udr->mutex) != 0) {
+		fclose(file);
+		free(udr);
+		return NULL;
+	}
+	udr->file = file;
+	xrt_reference_inc(&udr->ref);
+
+	U_LOG_I("Recording devices to '%s'", path);
+
+	return udr;
+}
+
+struct xrt_device *
+u_device_recorder_wrap(struct u_device_recorder *udr, struct xrt_device *target)
+{
+	struct recorder_device *d = U_TYPED_CALLOC(struct recorder_device);
+
+	// Mimic the target, including its inputs and hmd parts.
+	d->base = *target;
+	d->target = target;
+	d->index = udr->device_count++;
+	d->last_inputs = U_TYPED_ARRAY_CALLOC(struct xrt_input, target->input_count + 1);
+	d->changed = U_TYPED_ARRAY_CALLOC(struct u_device_recorder_input, target->input_count + 1);
+
+	xrt_reference_inc(&udr->ref);
+	d->udr = udr;
+
+	/*
+	 * The target functions expect their own device, so every function
+	 * it implements needs to be forwarded.
+	 */
+#define FORWARD(FUNC)                                                                                                  \
+	d->base.FUNC = target->FUNC != NULL ? recorder_##FUNC : NULL
+
+	FORWARD(update_inputs);
+	FORWARD(get_tracked_pose);
+	FORWARD(get_hand_tracking);
+	FORWARD(get_face_tracking);
+	FORWARD(set_output);
+	FORWARD(get_view_poses);
+	FORWARD(compute_distortion);
+	FORWARD(get_visibility_mask);
+	FORWARD(ref_space_usage);
+	FORWARD(is_form_factor_available);
+
+#undef FORWARD
+
+	d->base.destroy = recorder_destroy;
+
+	write_device(udr, d->index, target);
+
+	return &d->base;
+}
+
+void
+u_device_recorder_write_roles(struct u_device_recorder *udr, const struct u_device_recorder_roles *roles)
+{
+	write_record(udr, U_DEVICE_RECORDER_RECORD_ROLES, 0, roles, sizeof(*roles), NULL, 0);
+}
+
+void
+u_device_recorder_unref(struct u_device_recorder **udr_ptr)
+{
+	struct u_device_recorder *udr = *udr_ptr;
+	if (udr == NULL) {
+		return;
+	}
+	*udr_ptr = NULL;
+
+	if (!xrt_reference_dec_and_is_zero(&udr->ref)) {
+		return;
+	}
+
+	if (fclose(udr->file) != 0) {
+		U_LOG_E("Failed to flush the device recording");
+	}
+	os_mutex_destroy(&udr->mutex);
+	free(udr);
+}
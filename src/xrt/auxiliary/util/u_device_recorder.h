@@ -0,0 +1,216 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Wrapper device that records everything a device returns to a file.
+ * @ingroup aux_util
+ *
+ * The file starts with a @ref u_device_recorder_file_header followed by
+ * records, each a @ref u_device_recorder_record_header and its payload. All
+ * payloads are written with the native layout and endianness, the version is
+ * bumped on any change to them.
+ */
+
+#pragma once
+
+#include "xrt/xrt_device.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define U_DEVICE_RECORDER_MAGIC "XRTDEVRC"
+#define U_DEVICE_RECORDER_VERSION (1u)
+
+/*!
+ * What a record holds, see the payload structs below.
+ *
+ * @ingroup aux_util
+ */
+enum u_device_recorder_record_type
+{
+	//! @ref u_device_recorder_device followed by variable data.
+	U_DEVICE_RECORDER_RECORD_DEVICE = 1,
+	//! @ref u_device_recorder_roles.
+	U_DEVICE_RECORDER_RECORD_ROLES = 2,
+	//! @ref u_device_recorder_tracked_pose.
+	U_DEVICE_RECORDER_RECORD_TRACKED_POSE = 3,
+	//! @ref u_device_recorder_inputs followed by changed inputs.
+	U_DEVICE_RECORDER_RECORD_INPUTS = 4,
+	//! @ref u_device_recorder_hand_tracking.
+	U_DEVICE_RECORDER_RECORD_HAND_TRACKING = 5,
+	//! @ref u_device_recorder_view_poses.
+	U_DEVICE_RECORDER_RECORD_VIEW_POSES = 6,
+};
+
+struct u_device_recorder_file_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t _pad;
+
+	//! Monotonic time when the recording was started.
+	int64_t start_ns;
+};
+
+struct u_device_recorder_record_header
+{
+	uint16_t type;
+
+	//! Index of the device in the order they were wrapped.
+	uint16_t device;
+
+	//! Size of the payload following this header.
+	uint32_t size;
+
+	//! Monotonic time when the call was made.
+	int64_t timestamp_ns;
+};
+
+enum u_device_recorder_device_flags
+{
+	U_DEVICE_RECORDER_DEVICE_ORIENTATION_TRACKING = 1u << 0u,
+	U_DEVICE_RECORDER_DEVICE_POSITION_TRACKING = 1u << 1u,
+	U_DEVICE_RECORDER_DEVICE_HAND_TRACKING = 1u << 2u,
+	U_DEVICE_RECORDER_DEVICE_EYE_GAZE = 1u << 3u,
+	U_DEVICE_RECORDER_DEVICE_FORCE_FEEDBACK = 1u << 4u,
+	U_DEVICE_RECORDER_DEVICE_HMD = 1u << 5u,
+};
+
+/*!
+ * Describes a device, followed by @p input_count input names, @p output_count
+ * output names (both uint32_t), @p binding_profile_count
+ * @ref u_device_recorder_binding_profile each followed by its pairs, and last
+ * a @ref u_device_recorder_hmd if the device is a HMD.
+ */
+struct u_device_recorder_device
+{
+	uint32_t name;
+	uint32_t device_type;
+	char str[XRT_DEVICE_NAME_LEN];
+	char serial[XRT_DEVICE_NAME_LEN];
+	uint32_t flags;
+	uint32_t input_count;
+	uint32_t output_count;
+	uint32_t binding_profile_count;
+};
+
+struct u_device_recorder_binding_profile
+{
+	uint32_t name;
+	uint32_t input_count;
+	uint32_t output_count;
+	uint32_t _pad;
+};
+
+struct u_device_recorder_hmd
+{
+	int32_t w_pixels;
+	int32_t h_pixels;
+	uint64_t nominal_frame_interval_ns;
+	uint32_t view_count;
+	uint32_t blend_mode_count;
+	uint32_t blend_modes[XRT_MAX_DEVICE_BLEND_MODES];
+	struct xrt_view views[XRT_MAX_VIEWS];
+	struct xrt_fov distortion_fov[XRT_MAX_VIEWS];
+};
+
+//! Device indices of the roles, -1 if not assigned.
+struct u_device_recorder_roles
+{
+	int32_t head;
+	int32_t left;
+	int32_t right;
+	int32_t hand_tracking_left;
+	int32_t hand_tracking_right;
+};
+
+struct u_device_recorder_tracked_pose
+{
+	uint32_t name;
+	uint32_t _pad;
+	uint64_t at_timestamp_ns;
+	struct xrt_space_relation relation;
+};
+
+//! Followed by @p count @ref u_device_recorder_input, only inputs that changed.
+struct u_device_recorder_inputs
+{
+	uint32_t count;
+	uint32_t _pad;
+};
+
+struct u_device_recorder_input
+{
+	uint32_t index;
+	uint32_t active;
+	int64_t timestamp;
+	union xrt_input_value value;
+};
+
+struct u_device_recorder_hand_tracking
+{
+	uint32_t name;
+	uint32_t _pad;
+	uint64_t at_timestamp_ns;
+	uint64_t out_timestamp_ns;
+	struct xrt_hand_joint_set value;
+};
+
+struct u_device_recorder_view_poses
+{
+	uint64_t at_timestamp_ns;
+	struct xrt_vec3 default_eye_relation;
+	uint32_t view_count;
+	struct xrt_space_relation head_relation;
+	struct xrt_fov fovs[XRT_MAX_VIEWS];
+	struct xrt_pose poses[XRT_MAX_VIEWS];
+};
+
+/*!
+ * Shared file all wrapped devices write to, reference counted by the devices.
+ *
+ * @ingroup aux_util
+ */
+struct u_device_recorder;
+
+/*!
+ * Open @p path for writing and write the file header, returns NULL on failure.
+ *
+ * @public @memberof u_device_recorder
+ */
+struct u_device_recorder *
+u_device_recorder_open(const char *path);
+
+/*!
+ * Wrap @p target in a device that mimics it and records the results of
+ * get_tracked_pose, update_inputs, get_hand_tracking and get_view_poses.
+ * Takes ownership of @p target, writes a description of it to the file.
+ *
+ * @public @memberof u_device_recorder
+ */
+struct xrt_device *
+u_device_recorder_wrap(struct u_device_recorder *udr, struct xrt_device *target);
+
+/*!
+ * Write which of the wrapped devices has which role, indices are in wrap order.
+ *
+ * @public @memberof u_device_recorder
+ */
+void
+u_device_recorder_write_roles(struct u_device_recorder *udr, const struct u_device_recorder_roles *roles);
+
+/*!
+ * Drop the callers reference, the file is closed once all wrapped devices
+ * have also been destroyed.
+ *
+ * @public @memberof u_device_recorder
+ */
+void
+u_device_recorder_unref(struct u_device_recorder **udr_ptr);
+
+
+#ifdef __cplusplus
+}
+#endif
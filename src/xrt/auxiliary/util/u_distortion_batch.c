@@ -0,0 +1,417 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Batch evaluation of distortion models using SIMD.
+ * @ingroup aux_distortion
+ */
+
+#include "util/u_distortion_mesh.h"
+#include "util/u_simd.h"
+
+#include <math.h>
+#include <string.h>
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+/*!
+ * Results of one group of lanes, in r/g/b x/y order.
+ */
+struct lanes_result
+{
+	u_vf v[6];
+};
+
+/*!
+ * Input of the last group when there are fewer samples left than lanes,
+ * the unused lanes are zero which is valid input for all of the models.
+ */
+struct lanes_tail
+{
+	float u[U_SIMD_LANES];
+	float v[U_SIMD_LANES];
+};
+
+static inline void
+store_lanes(struct u_uv_triplet_batch *out, uint32_t i, const struct lanes_result *res)
+{
+	u_vf_store(&out->r_x[i], res->v[0]);
+	u_vf_store(&out->r_y[i], res->v[1]);
+	u_vf_store(&out->g_x[i], res->v[2]);
+	u_vf_store(&out->g_y[i], res->v[3]);
+	u_vf_store(&out->b_x[i], res->v[4]);
+	u_vf_store(&out->b_y[i], res->v[5]);
+}
+
+static inline void
+load_tail(struct lanes_tail *t, const float *u, const float *v, uint32_t i, uint32_t count)
+{
+	memset(t, 0, sizeof(*t));
+	memcpy(t->u, &u[i], (count - i) * sizeof(float));
+	memcpy(t->v, &v[i], (count - i) * sizeof(float));
+}
+
+static inline void
+store_tail(struct u_uv_triplet_batch *out, uint32_t i, uint32_t count, const struct lanes_result *res)
+{
+	float *dst[6] = {out->r_x, out->r_y, out->g_x, out->g_y, out->b_x, out->b_y};
+
+	for (int k = 0; k < 6; k++) {
+		float tmp[U_SIMD_LANES];
+		u_vf_store(tmp, res->v[k]);
+		memcpy(&dst[k][i], tmp, (count - i) * sizeof(float));
+	}
+}
+
+
+/*
+ *
+ * Vive, Vive Pro & Index distortion.
+ *
+ */
+
+struct vive_consts
+{
+	u_vf aspect_x_over_y;
+	u_vf factor_x;
+	u_vf factor_y;
+	u_vf center_x[3];
+	u_vf center_y[3];
+	u_vf k1[3];
+	u_vf k2[3];
+	u_vf k3[3];
+	u_vf k4[3];
+};
+
+//! Same operations in the same order as @ref u_compute_distortion_vive.
+static inline void
+vive_lanes(const struct vive_consts *c, u_vf u, u_vf v, struct lanes_result *res)
+{
+	const u_vf one = u_vf_set(1.0f);
+	const u_vf two = u_vf_set(2.0f);
+	const u_vf half = u_vf_set(0.5f);
+
+	for (int i = 0; i < 3; i++) {
+		u_vf x = u_vf_sub(u_vf_mul(two, u), one);
+		u_vf y = u_vf_sub(u_vf_mul(two, v), one);
+
+		y = u_vf_div(y, c->aspect_x_over_y);
+		x = u_vf_sub(x, c->center_x[i]);
+		y = u_vf_sub(y, c->center_y[i]);
+
+		u_vf r2 = u_vf_add(u_vf_mul(x, x), u_vf_mul(y, y));
+		// 1.0 + r^2 * (k1 + r^2 * (k2 + r^2 * k3))
+		u_vf bottom = u_vf_mul(r2, c->k3[i]);
+		bottom = u_vf_mul(r2, u_vf_add(c->k2[i], bottom));
+		bottom = u_vf_mul(r2, u_vf_add(c->k1[i], bottom));
+		bottom = u_vf_add(one, bottom);
+		u_vf d = u_vf_add(u_vf_div(one, bottom), c->k4[i]);
+
+		res->v[i * 2 + 0] = u_vf_add(half, u_vf_mul(u_vf_add(u_vf_mul(x, d), c->center_x[i]), c->factor_x));
+		res->v[i * 2 + 1] = u_vf_add(half, u_vf_mul(u_vf_add(u_vf_mul(y, d), c->center_y[i]), c->factor_y));
+	}
+}
+
+bool
+u_compute_distortion_vive_batch(const struct u_vive_values *values,
+                                const float *u,
+                                const float *v,
+                                uint32_t count,
+                                struct u_uv_triplet_batch *out)
+{
+	const float common_factor_value = 0.5f / (1.0f + values->grow_for_undistort);
+
+	struct vive_consts c;
+	c.aspect_x_over_y = u_vf_set(values->aspect_x_over_y);
+	c.factor_x = u_vf_set(common_factor_value);
+	c.factor_y = u_vf_set(common_factor_value * values->aspect_x_over_y);
+	for (int i = 0; i < 3; i++) {
+		c.center_x[i] = u_vf_set(values->center[i].x);
+		c.center_y[i] = u_vf_set(values->center[i].y);
+		c.k1[i] = u_vf_set(values->coefficients[i][0]);
+		c.k2[i] = u_vf_set(values->coefficients[i][1]);
+		c.k3[i] = u_vf_set(values->coefficients[i][2]);
+		c.k4[i] = u_vf_set(values->coefficients[i][3]);
+	}
+
+	struct lanes_result res;
+	uint32_t i = 0;
+	for (; i + U_SIMD_LANES <= count; i += U_SIMD_LANES) {
+		vive_lanes(&c, u_vf_load(&u[i]), u_vf_load(&v[i]), &res);
+		store_lanes(out, i, &res);
+	}
+
+	if (i < count) {
+		struct lanes_tail t;
+		load_tail(&t, u, v, i, count);
+		vive_lanes(&c, u_vf_load(t.u), u_vf_load(t.v), &res);
+		store_tail(out, i, count, &res);
+	}
+
+	return true;
+}
+
+
+/*
+ *
+ * Panotools distortion.
+ *
+ */
+
+struct panotools_consts
+{
+	u_vf viewport_x;
+	u_vf viewport_y;
+	u_vf center_x;
+	u_vf center_y;
+	u_vf scale;
+	u_vf distortion_k[5];
+	u_vf aberration_k[3];
+};
+
+//! Same operations in the same order as @ref u_compute_distortion_panotools.
+static inline void
+panotools_lanes(const struct panotools_consts *c, u_vf u, u_vf v, struct lanes_result *res)
+{
+	u_vf x = u_vf_div(u_vf_sub(u_vf_mul(u, c->viewport_x), c->center_x), c->scale);
+	u_vf y = u_vf_div(u_vf_sub(u_vf_mul(v, c->viewport_y), c->center_y), c->scale);
+
+	u_vf r = u_vf_sqrt(u_vf_add(u_vf_mul(x, x), u_vf_mul(y, y)));
+
+	u_vf mag = c->distortion_k[0];                                                       // r^1
+	mag = u_vf_add(mag, u_vf_mul(c->distortion_k[1], r));                                  // r^2
+	mag = u_vf_add(mag, u_vf_mul(u_vf_mul(c->distortion_k[2], r), r));                       // r^3
+	mag = u_vf_add(mag, u_vf_mul(u_vf_mul(u_vf_mul(c->distortion_k[3], r), r), r));            // r^4
+	mag = u_vf_add(mag, u_vf_mul(u_vf_mul(u_vf_mul(u_vf_mul(c->distortion_k[4], r), r), r), r)); // r^5
+
+	u_vf dist_x = u_vf_mul(u_vf_mul(x, mag), c->scale);
+	u_vf dist_y = u_vf_mul(u_vf_mul(y, mag), c->scale);
+
+	for (int i = 0; i < 3; i++) {
+		u_vf scaled_x = u_vf_add(u_vf_mul(dist_x, c->aberration_k[i]), c->center_x);
+		u_vf scaled_y = u_vf_add(u_vf_mul(dist_y, c->aberration_k[i]), c->center_y);
+		res->v[i * 2 + 0] = u_vf_div(scaled_x, c->viewport_x);
+		res->v[i * 2 + 1] = u_vf_div(scaled_y, c->viewport_y);
+	}
+}
+
+bool
+u_compute_distortion_panotools_batch(const struct u_panotools_values *values,
+                                     const float *u,
+                                     const float *v,
+                                     uint32_t count,
+                                     struct u_uv_triplet_batch *out)
+{
+	struct panotools_consts c;
+	c.viewport_x = u_vf_set(values->viewport_size.x);
+	c.viewport_y = u_vf_set(values->viewport_size.y);
+	c.center_x = u_vf_set(values->lens_center.x);
+	c.center_y = u_vf_set(values->lens_center.y);
+	c.scale = u_vf_set(values->scale);
+	for (int i = 0; i < 5; i++) {
+		c.distortion_k[i] = u_vf_set(values->distortion_k[i]);
+	}
+	for (int i = 0; i < 3; i++) {
+		c.aberration_k[i] = u_vf_set(values->aberration_k[i]);
+	}
+
+	struct lanes_result res;
+	uint32_t i = 0;
+	for (; i + U_SIMD_LANES <= count; i += U_SIMD_LANES) {
+		panotools_lanes(&c, u_vf_load(&u[i]), u_vf_load(&v[i]), &res);
+		store_lanes(out, i, &res);
+	}
+
+	if (i < count) {
+		struct lanes_tail t;
+		load_tail(&t, u, v, i, count);
+		panotools_lanes(&c, u_vf_load(t.u), u_vf_load(t.v), &res);
+		store_tail(out, i, count, &res);
+	}
+
+	return true;
+}
+
+
+/*
+ *
+ * Cardboard distortion.
+ *
+ */
+
+struct cardboard_consts
+{
+	u_vf screen_size_x;
+	u_vf screen_size_y;
+	u_vf screen_offset_x;
+	u_vf screen_offset_y;
+	u_vf texture_size_x;
+	u_vf texture_size_y;
+	u_vf texture_offset_x;
+	u_vf texture_offset_y;
+	u_vf distortion_k[5];
+};
+
+//! Same operations in the same order as @ref u_compute_distortion_cardboard.
+static inline void
+cardboard_lanes(const struct cardboard_consts *c, u_vf u, u_vf v, struct lanes_result *res)
+{
+	u_vf x = u_vf_sub(u_vf_mul(u, c->screen_size_x), c->screen_offset_x);
+	u_vf y = u_vf_sub(u_vf_mul(v, c->screen_size_y), c->screen_offset_y);
+
+	u_vf sqrd = u_vf_add(u_vf_mul(x, x), u_vf_mul(y, y));
+	u_vf r = u_vf_set(1.0f);
+	u_vf fact = u_vf_set(1.0f);
+	for (int i = 0; i < 5; i++) {
+		r = u_vf_mul(r, sqrd);
+		fact = u_vf_add(fact, u_vf_mul(c->distortion_k[i], r));
+	}
+
+	x = u_vf_div(u_vf_add(u_vf_mul(x, fact), c->texture_offset_x), c->texture_size_x);
+	y = u_vf_div(u_vf_add(u_vf_mul(y, fact), c->texture_offset_y), c->texture_size_y);
+
+	for (int i = 0; i < 3; i++) {
+		res->v[i * 2 + 0] = x;
+		res->v[i * 2 + 1] = y;
+	}
+}
+
+bool
+u_compute_distortion_cardboard_batch(const struct u_cardboard_distortion_values *values,
+                                     const float *u,
+                                     const float *v,
+                                     uint32_t count,
+                                     struct u_uv_triplet_batch *out)
+{
+	struct cardboard_consts c;
+	c.screen_size_x = u_vf_set(values->screen.size.x);
+	c.screen_size_y = u_vf_set(values->screen.size.y);
+	c.screen_offset_x = u_vf_set(values->screen.offset.x);
+	c.screen_offset_y = u_vf_set(values->screen.offset.y);
+	c.texture_size_x = u_vf_set(values->texture.size.x);
+	c.texture_size_y = u_vf_set(values->texture.size.y);
+	c.texture_offset_x = u_vf_set(values->texture.offset.x);
+	c.texture_offset_y = u_vf_set(values->texture.offset.y);
+	for (int i = 0; i < 5; i++) {
+		c.distortion_k[i] = u_vf_set(values->distortion_k[i]);
+	}
+
+	struct lanes_result res;
+	uint32_t i = 0;
+	for (; i + U_SIMD_LANES <= count; i += U_SIMD_LANES) {
+		cardboard_lanes(&c, u_vf_load(&u[i]), u_vf_load(&v[i]), &res);
+		store_lanes(out, i, &res);
+	}
+
+	if (i < count) {
+		struct lanes_tail t;
+		load_tail(&t, u, v, i, count);
+		cardboard_lanes(&c, u_vf_load(t.u), u_vf_load(t.v), &res);
+		store_tail(out, i, count, &res);
+	}
+
+	return true;
+}
+
+
+/*
+ *
+ * North Star "2D Polynomial" distortion.
+ *
+ */
+
+struct ns_p2d_consts
+{
+	u_vf x_coefficients[16];
+	u_vf y_coefficients[16];
+	u_vf left_ray_bound;
+	u_vf right_ray_bound;
+	u_vf up_ray_bound;
+	u_vf down_ray_bound;
+};
+
+//! Same as u_ns_polyval2d.
+static inline u_vf
+ns_polyval2d_lanes(u_vf X, u_vf Y, const u_vf C[16])
+{
+	u_vf X2 = u_vf_mul(X, X);
+	u_vf X3 = u_vf_mul(X2, X);
+	u_vf Y2 = u_vf_mul(Y, Y);
+	u_vf Y3 = u_vf_mul(Y2, Y);
+
+	u_vf a = u_vf_add(u_vf_add(u_vf_add(C[0], u_vf_mul(C[1], Y)), u_vf_mul(C[2], Y2)), u_vf_mul(C[3], Y3));
+	u_vf b = u_vf_add(u_vf_add(u_vf_add(u_vf_mul(C[4], X), u_vf_mul(u_vf_mul(C[5], X), Y)),
+	                           u_vf_mul(u_vf_mul(C[6], X), Y2)),
+	                  u_vf_mul(u_vf_mul(C[7], X), Y3));
+	u_vf c = u_vf_add(u_vf_add(u_vf_add(u_vf_mul(C[8], X2), u_vf_mul(u_vf_mul(C[9], X2), Y)),
+	                           u_vf_mul(u_vf_mul(C[10], X2), Y2)),
+	                  u_vf_mul(u_vf_mul(C[11], X2), Y3));
+	u_vf d = u_vf_add(u_vf_add(u_vf_add(u_vf_mul(C[12], X3), u_vf_mul(u_vf_mul(C[13], X3), Y)),
+	                           u_vf_mul(u_vf_mul(C[14], X3), Y2)),
+	                  u_vf_mul(u_vf_mul(C[15], X3), Y3));
+
+	return u_vf_add(u_vf_add(u_vf_add(a, b), c), d);
+}
+
+//! Same operations as @ref u_compute_distortion_ns_p2d, but the ray mapping is done in float.
+static inline void
+ns_p2d_lanes(const struct ns_p2d_consts *c, u_vf u, u_vf v, struct lanes_result *res)
+{
+	v = u_vf_sub(u_vf_set(1.0f), v);
+
+	u_vf x_ray = ns_polyval2d_lanes(u, v, c->x_coefficients);
+	u_vf y_ray = ns_polyval2d_lanes(u, v, c->y_coefficients);
+
+	u_vf u_eye = u_vf_div(u_vf_sub(x_ray, c->left_ray_bound), u_vf_sub(c->right_ray_bound, c->left_ray_bound));
+	u_vf v_eye = u_vf_div(u_vf_sub(y_ray, c->down_ray_bound), u_vf_sub(c->up_ray_bound, c->down_ray_bound));
+
+	for (int i = 0; i < 3; i++) {
+		res->v[i * 2 + 0] = u_eye;
+		res->v[i * 2 + 1] = v_eye;
+	}
+}
+
+bool
+u_compute_distortion_ns_p2d_batch(const struct u_ns_p2d_values *values,
+                                  int view,
+                                  const float *u,
+                                  const float *v,
+                                  uint32_t count,
+                                  struct u_uv_triplet_batch *out)
+{
+	// Same (swapped) selection as the single sample version.
+	const float *x_coefficients = view ? values->x_coefficients_left : values->x_coefficients_right;
+	const float *y_coefficients = view ? values->y_coefficients_left : values->y_coefficients_right;
+	struct xrt_fov fov = values->fov[view];
+
+	struct ns_p2d_consts c;
+	for (int i = 0; i < 16; i++) {
+		c.x_coefficients[i] = u_vf_set(x_coefficients[i]);
+		c.y_coefficients[i] = u_vf_set(y_coefficients[i]);
+	}
+	c.left_ray_bound = u_vf_set(tanf(fov.angle_left));
+	c.right_ray_bound = u_vf_set(tanf(fov.angle_right));
+	c.up_ray_bound = u_vf_set(tanf(fov.angle_up));
+	c.down_ray_bound = u_vf_set(tanf(fov.angle_down));
+
+	struct lanes_result res;
+	uint32_t i = 0;
+	for (; i + U_SIMD_LANES <= count; i += U_SIMD_LANES) {
+		ns_p2d_lanes(&c, u_vf_load(&u[i]), u_vf_load(&v[i]), &res);
+		store_lanes(out, i, &res);
+	}
+
+	if (i < count) {
+		struct lanes_tail t;
+		load_tail(&t, u, v, i, count);
+		ns_p2d_lanes(&c, u_vf_load(t.u), u_vf_load(t.v), &res);
+		store_tail(out, i, count, &res);
+	}
+
+	return true;
+}
@@ -0,0 +1,340 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  On disk cache for distortion meshes and images, and parallel
+ *         evaluation of distortion functions when the cache is cold.
+ * @ingroup aux_distortion
+ */
+
+#include "xrt/xrt_config_os.h"
+
+#include "math/m_api.h"
+
+#include "util/u_misc.h"
+#include "util/u_file.h"
+#include "util/u_debug.h"
+#include "util/u_worker.h"
+#include "util/u_logging.h"
+#include "util/u_distortion_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#ifdef XRT_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/limits.h>
+#endif
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(distortion_cache, "XRT_DISTORTION_CACHE", true)
+DEBUG_GET_ONCE_NUM_OPTION(distortion_threads, "XRT_DISTORTION_THREADS", 4)
+
+#define CACHE_SUBPATH "distortion"
+#define CACHE_MAGIC "XRTDST01"
+
+//! Number of points per axis sampled for the key.
+#define KEY_SAMPLES (9)
+
+//! Below this starting threads costs more than it saves.
+#define MIN_PARALLEL_ROWS (16)
+
+//! Split the rows into more tasks than threads so uneven rows balance out.
+#define TASKS_PER_THREAD (4)
+
+/*!
+ * Header in front of the data, 32 bytes so the data stays 16 byte aligned in
+ * the mapping.
+ */
+struct cache_header
+{
+	char magic[8];
+	uint64_t key;
+	uint64_t size;
+	uint64_t reserved;
+};
+
+struct row_task
+{
+	u_distortion_row_func_t func;
+	void *ptr;
+	uint32_t first;
+	uint32_t count;
+	bool ok;
+};
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static void
+append(uint8_t **buf, size_t *size, const void *data, size_t data_size)
+{
+	U_ARRAY_REALLOC_OR_FREE(*buf, uint8_t, (*size + data_size));
+	memcpy(*buf + *size, data, data_size);
+	*size += data_size;
+}
+
+static void
+run_row_task(void *ptr)
+{
+	struct row_task *t = (struct row_task *)ptr;
+
+	t->ok = true;
+	for (uint32_t row = t->first; row < t->first + t->count; row++) {
+		t->ok = t->func(t->ptr, row) && t->ok;
+	}
+}
+
+#ifdef XRT_OS_LINUX
+
+static void
+make_filename(const char *kind, uint64_t key, char *out, size_t out_size)
+{
+	snprintf(out, out_size, "%s-%016" PRIx64 ".bin", kind, key);
+}
+
+static bool
+make_path(const char *filename, char *out, size_t out_size)
+{
+	char dir[PATH_MAX];
+	ssize_t ret = u_file_get_cache_dir(dir, sizeof(dir));
+	if (ret <= 0 || ret >= (ssize_t)sizeof(dir)) {
+		return false;
+	}
+
+	int i = snprintf(out, out_size, "%s/%s/%s", dir, CACHE_SUBPATH, filename);
+	return i > 0 && i < (int)out_size;
+}
+
+#endif
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+uint64_t
+u_distortion_cache_key(struct xrt_device *xdev, const char *kind, const void *params, size_t params_size)
+{
+	uint8_t *buf = NULL;
+	size_t size = 0;
+
+	uint32_t view_count = xdev->hmd->view_count;
+
+	append(&buf, &size, kind, strlen(kind) + 1);
+	append(&buf, &size, &params_size, sizeof(params_size));
+	append(&buf, &size, params, params_size);
+	append(&buf, &size, &view_count, sizeof(view_count));
+
+	for (uint32_t view = 0; view < view_count; view++) {
+		append(&buf, &size, &xdev->hmd->distortion.fov[view], sizeof(struct xrt_fov));
+
+		for (uint32_t y = 0; y < KEY_SAMPLES; y++) {
+			for (uint32_t x = 0; x < KEY_SAMPLES; x++) {
+				float u = (float)x / (float)(KEY_SAMPLES - 1);
+				float v = (float)y / (float)(KEY_SAMPLES - 1);
+
+				struct xrt_uv_triplet result = {0};
+				if (xdev->compute_distortion != NULL) {
+					xrt_device_compute_distortion(xdev, view, u, v, &result);
+				}
+
+				append(&buf, &size, &result, sizeof(result));
+			}
+		}
+	}
+
+	uint64_t key = (uint64_t)math_hash_string((const char *)buf, size);
+	free(buf);
+
+	return key;
+}
+
+bool
+u_distortion_run_rows(uint32_t row_count, u_distortion_row_func_t func, void *ptr)
+{
+	int64_t thread_count = debug_get_num_option_distortion_threads();
+	if (thread_count <= 1 || row_count < MIN_PARALLEL_ROWS) {
+		struct row_task t = {func, ptr, 0, row_count, false};
+		run_row_task(&t);
+		return t.ok;
+	}
+
+	uint32_t task_count = (uint32_t)thread_count * TASKS_PER_THREAD;
+	if (task_count > row_count) {
+		task_count = row_count;
+	}
+
+	struct u_worker_thread_pool *pool = u_worker_thread_pool_create( //
+	    (uint32_t)thread_count - 1,                                  // starting_worker_count
+	    (uint32_t)thread_count,                                      // thread_count
+	    "Distortion");                                               // prefix
+	struct u_worker_group *group = u_worker_group_create(pool);
+
+	struct row_task *tasks = U_TYPED_ARRAY_CALLOC(struct row_task, task_count);
+	uint32_t first = 0;
+	for (uint32_t i = 0; i < task_count; i++) {
+		// Spread the remainder over the first tasks.
+		uint32_t count = row_count / task_count + (i < row_count % task_count ? 1 : 0);
+
+		tasks[i] = (struct row_task){func, ptr, first, count, false};
+		u_worker_group_push(group, run_row_task, &tasks[i]);
+		first += count;
+	}
+
+	u_worker_group_wait_all(group);
+
+	bool ok = true;
+	for (uint32_t i = 0; i < task_count; i++) {
+		ok = ok && tasks[i].ok;
+	}
+
+	free(tasks);
+	u_worker_group_reference(&group, NULL);
+	u_worker_thread_pool_reference(&pool, NULL);
+
+	return ok;
+}
+
+#ifdef XRT_OS_LINUX
+
+bool
+u_distortion_cache_map(const char *kind, uint64_t key, size_t expected_size, struct u_distortion_cache_blob *out_blob)
+{
+	if (!debug_get_bool_option_distortion_cache()) {
+		return false;
+	}
+
+	char filename[128];
+	char path[PATH_MAX];
+	make_filename(kind, key, filename, sizeof(filename));
+	if (!make_path(filename, path, sizeof(path))) {
+		return false;
+	}
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		U_LOG_D("No cached distortion '%s'", filename);
+		return false;
+	}
+
+	struct stat st;
+	size_t mapping_size = sizeof(struct cache_header) + expected_size;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size != mapping_size) {
+		U_LOG_W("Ignoring cached distortion '%s' with wrong size", filename);
+		close(fd);
+		return false;
+	}
+
+	void *mapping = mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+
+	const struct cache_header *header = (const struct cache_header *)mapping;
+	if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 || //
+	    header->key != key ||                                              //
+	    header->size != expected_size) {
+		U_LOG_W("Ignoring broken cached distortion '%s'", filename);
+		munmap(mapping, mapping_size);
+		return false;
+	}
+
+	U_LOG_D("Mapped cached distortion '%s'", filename);
+
+	out_blob->data = (const uint8_t *)mapping + sizeof(struct cache_header);
+	out_blob->size = expected_size;
+	out_blob->mapping = mapping;
+	out_blob->mapping_size = mapping_size;
+
+	return true;
+}
+
+void
+u_distortion_cache_unmap(struct u_distortion_cache_blob *blob)
+{
+	if (blob->mapping != NULL) {
+		munmap(blob->mapping, blob->mapping_size);
+	}
+
+	U_ZERO(blob);
+}
+
+bool
+u_distortion_cache_store(const char *kind, uint64_t key, const void *data, size_t size)
+{
+	if (!debug_get_bool_option_distortion_cache()) {
+		return false;
+	}
+
+	char filename[128];
+	make_filename(kind, key, filename, sizeof(filename));
+
+	// Write to a temporary file first so a mapping never sees half an entry.
+	char tmp_filename[sizeof(filename) + 16];
+	snprintf(tmp_filename, sizeof(tmp_filename), "%s.%d", filename, (int)getpid());
+
+	char path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+	if (!make_path(filename, path, sizeof(path)) || !make_path(tmp_filename, tmp_path, sizeof(tmp_path))) {
+		return false;
+	}
+
+	FILE *file = u_file_open_file_in_cache_dir_subpath(CACHE_SUBPATH, tmp_filename, "wb");
+	if (file == NULL) {
+		U_LOG_W("Could not open '%s' for writing", tmp_path);
+		return false;
+	}
+
+	struct cache_header header = {0};
+	memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+	header.key = key;
+	header.size = size;
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data, 1, size, file) == size;
+	ok = (fclose(file) == 0) && ok;
+
+	if (!ok || rename(tmp_path, path) != 0) {
+		U_LOG_W("Failed to write cached distortion '%s'", path);
+		remove(tmp_path);
+		return false;
+	}
+
+	U_LOG_D("Stored distortion '%s'", path);
+
+	return true;
+}
+
+#else
+
+bool
+u_distortion_cache_map(const char *kind, uint64_t key, size_t expected_size, struct u_distortion_cache_blob *out_blob)
+{
+	return false;
+}
+
+void
+u_distortion_cache_unmap(struct u_distortion_cache_blob *blob)
+{
+	U_ZERO(blob);
+}
+
+bool
+u_distortion_cache_store(const char *kind, uint64_t key, const void *data, size_t size)
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,101 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  On disk cache for distortion meshes and images, and parallel
+ *         evaluation of distortion functions when the cache is cold.
+ * @ingroup aux_distortion
+ */
+
+#pragma once
+
+#include "xrt/xrt_compiler.h"
+#include "xrt/xrt_device.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * A cache entry mapped into memory, see @ref u_distortion_cache_map.
+ *
+ * @ingroup aux_distortion
+ */
+struct u_distortion_cache_blob
+{
+	//! The cached data, read only.
+	const void *data;
+
+	//! Size of @ref data in bytes.
+	size_t size;
+
+	void *mapping;
+	size_t mapping_size;
+};
+
+/*!
+ * Called for each row by @ref u_distortion_run_rows, returns false on error.
+ *
+ * @ingroup aux_distortion
+ */
+typedef bool (*u_distortion_row_func_t)(void *ptr, uint32_t row);
+
+/*!
+ * Make the key for a cache entry of @p xdev.
+ *
+ * The distortion parameters live inside of the drivers, so the key hashes
+ * the output of `xdev->compute_distortion` on a sparse grid over every view
+ * together with the view fovs, @p kind and @p params. The @p params are what
+ * else the cached data depends on, like the output resolution.
+ *
+ * @ingroup aux_distortion
+ */
+uint64_t
+u_distortion_cache_key(struct xrt_device *xdev, const char *kind, const void *params, size_t params_size);
+
+/*!
+ * Map a cached entry, only succeeds if it exists and is exactly
+ * @p expected_size bytes big. Release with @ref u_distortion_cache_unmap.
+ *
+ * Always misses if disabled with the `XRT_DISTORTION_CACHE` option.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_distortion_cache_map(const char *kind, uint64_t key, size_t expected_size, struct u_distortion_cache_blob *out_blob);
+
+/*!
+ * Unmap a blob returned from @ref u_distortion_cache_map.
+ *
+ * @ingroup aux_distortion
+ */
+void
+u_distortion_cache_unmap(struct u_distortion_cache_blob *blob);
+
+/*!
+ * Store an entry for later @ref u_distortion_cache_map calls.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_distortion_cache_store(const char *kind, uint64_t key, const void *data, size_t size);
+
+/*!
+ * Calls @p func for all rows in @p row_count, spread over worker threads.
+ * The function must be safe to call from multiple threads at once for
+ * different rows. The `XRT_DISTORTION_THREADS` option sets the number of
+ * threads, zero or one runs everything on the calling thread.
+ *
+ * @return false if any call to @p func returned false.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_distortion_run_rows(uint32_t row_count, u_distortion_row_func_t func, void *ptr);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,7 @@
 #include "util/u_frame.h"
 #include "util/u_debug.h"
 #include "util/u_format.h"
+#include "util/u_distortion_cache.h"
 #include "util/u_distortion_mesh.h"
 
 #include "math/m_vec2.h"
@@ -19,12 +20,19 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 
 DEBUG_GET_ONCE_NUM_OPTION(mesh_size, "XRT_MESH_SIZE", 64)
 
 
+//! Position and r/g/b uvs.
+#define STRIDE_IN_FLOATS (2 + 3 * 2)
+
+//! How many samples of a row are given to a batch function at once.
+#define BATCH_SIZE (64)
+
 typedef bool (*func_calc)(struct xrt_device *xdev, uint32_t view, float u, float v, struct xrt_uv_triplet *result);
 
 static int
@@ -33,11 +41,117 @@ index_for(int row, int col, uint32_t stride, uint32_t offset)
 	return row * stride + col + offset;
 }
 
-static void
-run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target, uint32_t num)
+/*!
+ * Shared with the row workers when computing the vertices.
+ */
+struct mesh_rows
+{
+	struct xrt_device *xdev;
+	func_calc calc;
+	u_distortion_batch_func_t batch;
+	float *verts;
+	uint32_t num;
+};
+
+static uint32_t
+vertex_float_count(uint32_t view_count, uint32_t num)
 {
-	assert(calc != NULL);
+	uint32_t vert_cols = num + 1;
+	uint32_t vert_rows = num + 1;
+
+	return vert_rows * vert_cols * view_count * STRIDE_IN_FLOATS;
+}
+
+/*!
+ * Fills in the vertices of one row using the batch function.
+ */
+static bool
+fill_vertex_row_batch(struct mesh_rows *mr, uint32_t view, float v, float *verts)
+{
+	uint32_t cells_cols = mr->num;
+	uint32_t vert_cols = cells_cols + 1;
+
+	float us[BATCH_SIZE];
+	float vs[BATCH_SIZE];
+	float out[6][BATCH_SIZE];
+	struct u_uv_triplet_batch batch = {out[0], out[1], out[2], out[3], out[4], out[5]};
+
+	for (uint32_t first = 0; first < vert_cols; first += BATCH_SIZE) {
+		uint32_t count = MIN(BATCH_SIZE, vert_cols - first);
+
+		for (uint32_t c = 0; c < count; c++) {
+			// This goes from 0 to 1.0 inclusive.
+			us[c] = (float)(first + c) / (float)cells_cols;
+			vs[c] = v;
+		}
+
+		if (!mr->batch(mr->xdev, view, us, vs, count, &batch)) {
+			return false;
+		}
+
+		for (uint32_t c = 0; c < count; c++) {
+			float *vert = &verts[(first + c) * STRIDE_IN_FLOATS];
+
+			// Make the position in the range of [-1, 1]
+			vert[0] = us[c] * 2.0f - 1.0f;
+			vert[1] = v * 2.0f - 1.0f;
+
+			// Same layout as struct xrt_uv_triplet.
+			for (uint32_t k = 0; k < 6; k++) {
+				vert[2 + k] = out[k][c];
+			}
+		}
+	}
 
+	return true;
+}
+
+/*!
+ * Fills in one row of vertices, the rows of all views are numbered
+ * consecutively so each view is split over the workers too.
+ */
+static bool
+fill_vertex_row(void *ptr, uint32_t row)
+{
+	struct mesh_rows *mr = (struct mesh_rows *)ptr;
+
+	uint32_t cells_cols = mr->num;
+	uint32_t cells_rows = mr->num;
+	uint32_t vert_cols = cells_cols + 1;
+	uint32_t vert_rows = cells_rows + 1;
+
+	uint32_t view = row / vert_rows;
+	uint32_t r = row % vert_rows;
+
+	// This goes from 0 to 1.0 inclusive.
+	float v = (float)r / (float)cells_rows;
+
+	uint32_t i = row * vert_cols * STRIDE_IN_FLOATS;
+	if (mr->batch != NULL) {
+		return fill_vertex_row_batch(mr, view, v, &mr->verts[i]);
+	}
+
+	for (uint32_t c = 0; c < vert_cols; c++) {
+		// This goes from 0 to 1.0 inclusive.
+		float u = (float)c / (float)cells_cols;
+
+		// Make the position in the range of [-1, 1]
+		mr->verts[i + 0] = u * 2.0f - 1.0f;
+		mr->verts[i + 1] = v * 2.0f - 1.0f;
+
+		if (!mr->calc(mr->xdev, view, u, v, (struct xrt_uv_triplet *)&mr->verts[i + 2])) {
+			return false;
+		}
+
+		i += STRIDE_IN_FLOATS;
+	}
+
+	return true;
+}
+
+static void
+fill_in_mesh(struct xrt_hmd_parts *target, float *verts, uint32_t num)
+{
 	uint32_t view_count = target->view_count;
 
 	uint32_t vertex_offsets[XRT_MAX_VIEWS] = {0};
@@ -52,37 +166,10 @@ run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target,
 	uint32_t vertex_count = vertex_count_per_view * view_count;
 
 	uint32_t uv_channels_count = 3;
-	uint32_t stride_in_floats = 2 + uv_channels_count * 2;
-	uint32_t float_count = vertex_count * stride_in_floats;
-
-	float *verts = U_TYPED_ARRAY_CALLOC(float, float_count);
+	uint32_t stride_in_floats = STRIDE_IN_FLOATS;
 
-	// Setup the vertices for all views.
-	uint32_t i = 0;
 	for (uint32_t view = 0; view < view_count; view++) {
-		vertex_offsets[view] = i / stride_in_floats;
-
-		for (uint32_t r = 0; r < vert_rows; r++) {
-			// This goes from 0 to 1.0 inclusive.
-			float v = (float)r / (float)cells_rows;
-
-			for (uint32_t c = 0; c < vert_cols; c++) {
-				// This goes from 0 to 1.0 inclusive.
-				float u = (float)c / (float)cells_cols;
-
-				// Make the position in the range of [-1, 1]
-				verts[i + 0] = u * 2.0f - 1.0f;
-				verts[i + 1] = v * 2.0f - 1.0f;
-
-				if (!calc(xdev, view, u, v, (struct xrt_uv_triplet *)&verts[i + 2])) {
-					// bail on error, without updating
-					// distortion.preferred
-					return;
-				}
-
-				i += stride_in_floats;
-			}
-		}
+		vertex_offsets[view] = vertex_count_per_view * view;
 	}
 
 	uint32_t index_count_per_view = cells_rows * (vert_cols * 2 + 2);
@@ -90,7 +177,7 @@ run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target,
 	int *indices = U_TYPED_ARRAY_CALLOC(int, index_count_total);
 
 	// Set up indices for all views.
-	i = 0;
+	uint32_t i = 0;
 	for (uint32_t view = 0; view < view_count; view++) {
 		index_offsets[view] = i;
 
@@ -124,6 +211,47 @@ run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target,
 	}
 }
 
+/*!
+ * Evaluates @p batch, or @p calc if NULL, at every vertex, returns NULL on
+ * error.
+ */
+static float *
+compute_vertices(
+    struct xrt_device *xdev, func_calc calc, u_distortion_batch_func_t batch, uint32_t view_count, uint32_t num)
+{
+	assert(calc != NULL || batch != NULL);
+
+	float *verts = U_TYPED_ARRAY_CALLOC(float, vertex_float_count(view_count, num));
+
+	struct mesh_rows mr = {
+	    .xdev = xdev,
+	    .calc = calc,
+	    .batch = batch,
+	    .verts = verts,
+	    .num = num,
+	};
+
+	if (!u_distortion_run_rows((num + 1) * view_count, fill_vertex_row, &mr)) {
+		free(verts);
+		return NULL;
+	}
+
+	return verts;
+}
+
+static void
+run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target, uint32_t num)
+{
+	float *verts = compute_vertices(xdev, calc, NULL, target->view_count, num);
+	if (verts == NULL) {
+		// bail on error, without updating
+		// distortion.preferred
+		return;
+	}
+
+	fill_in_mesh(target, verts, num);
+}
+
 bool
 u_compute_distortion_vive(struct u_vive_values *values, float u, float v, struct xrt_uv_triplet *result)
 {
@@ -470,6 +598,37 @@ u_distortion_mesh_set_none(struct xrt_device *xdev)
  *
  */
 
+static void
+fill_in_cached(struct xrt_device *xdev, func_calc calc, u_distortion_batch_func_t batch)
+{
+	struct xrt_hmd_parts *target = xdev->hmd;
+
+	uint32_t num = (uint32_t)debug_get_num_option_mesh_size();
+	size_t size = vertex_float_count(target->view_count, num) * sizeof(float);
+
+	// Only the vertices are expensive, the indices are always regenerated.
+	uint64_t key = u_distortion_cache_key(xdev, "mesh", &num, sizeof(num));
+
+	struct u_distortion_cache_blob blob;
+	if (u_distortion_cache_map("mesh", key, size, &blob)) {
+		float *verts = U_TYPED_ARRAY_CALLOC(float, vertex_float_count(target->view_count, num));
+		memcpy(verts, blob.data, size);
+		u_distortion_cache_unmap(&blob);
+
+		fill_in_mesh(target, verts, num);
+		return;
+	}
+
+	float *verts = compute_vertices(xdev, calc, batch, target->view_count, num);
+	if (verts == NULL) {
+		return;
+	}
+
+	u_distortion_cache_store("mesh", key, verts, size);
+
+	fill_in_mesh(target, verts, num);
+}
+
 void
 u_distortion_mesh_fill_in_compute(struct xrt_device *xdev)
 {
@@ -479,9 +638,14 @@ u_distortion_mesh_fill_in_compute(struct xrt_device *xdev)
 		return;
 	}
 
-	struct xrt_hmd_parts *target = xdev->hmd;
+	fill_in_cached(xdev, calc, NULL);
+}
 
-	uint32_t num = (uint32_t)debug_get_num_option_mesh_size();
+void
+u_distortion_mesh_fill_in_batch(struct xrt_device *xdev, u_distortion_batch_func_t func)
+{
+	// Needed for the cache key.
+	assert(xdev->compute_distortion != NULL);
 
-	run_func(xdev, calc, target, num);
+	fill_in_cached(xdev, NULL, func);
 }
@@ -181,6 +181,92 @@ bool
 u_distortion_mesh_none(struct xrt_device *xdev, uint32_t view, float u, float v, struct xrt_uv_triplet *result);
 
 
+/*
+ *
+ * Batch evaluation, same results as the single sample functions above but
+ * takes arrays of coordinates and evaluates several at once with SIMD.
+ *
+ */
+
+/*!
+ * Structure of arrays version of @ref xrt_uv_triplet, each pointer points to
+ * at least as many floats as the number of samples evaluated.
+ *
+ * @ingroup aux_distortion
+ */
+struct u_uv_triplet_batch
+{
+	float *r_x;
+	float *r_y;
+	float *g_x;
+	float *g_y;
+	float *b_x;
+	float *b_y;
+};
+
+/*!
+ * Evaluates @p count samples of @p view, the batch version of
+ * @ref xrt_device::compute_distortion.
+ *
+ * @ingroup aux_distortion
+ */
+typedef bool (*u_distortion_batch_func_t)(struct xrt_device *xdev,
+                                          uint32_t view,
+                                          const float *u,
+                                          const float *v,
+                                          uint32_t count,
+                                          struct u_uv_triplet_batch *out);
+
+/*!
+ * Batch version of @ref u_compute_distortion_vive.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_compute_distortion_vive_batch(const struct u_vive_values *values,
+                                const float *u,
+                                const float *v,
+                                uint32_t count,
+                                struct u_uv_triplet_batch *out);
+
+/*!
+ * Batch version of @ref u_compute_distortion_panotools.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_compute_distortion_panotools_batch(const struct u_panotools_values *values,
+                                     const float *u,
+                                     const float *v,
+                                     uint32_t count,
+                                     struct u_uv_triplet_batch *out);
+
+/*!
+ * Batch version of @ref u_compute_distortion_cardboard.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_compute_distortion_cardboard_batch(const struct u_cardboard_distortion_values *values,
+                                     const float *u,
+                                     const float *v,
+                                     uint32_t count,
+                                     struct u_uv_triplet_batch *out);
+
+/*!
+ * Batch version of @ref u_compute_distortion_ns_p2d.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_compute_distortion_ns_p2d_batch(const struct u_ns_p2d_values *values,
+                                  int view,
+                                  const float *u,
+                                  const float *v,
+                                  uint32_t count,
+                                  struct u_uv_triplet_batch *out);
+
+
 /*
  *
  * Mesh generation functions.
@@ -198,6 +284,17 @@ u_distortion_mesh_none(struct xrt_device *xdev, uint32_t view, float u, float v,
 void
 u_distortion_mesh_fill_in_compute(struct xrt_device *xdev);
 
+/*!
+ * Same as @ref u_distortion_mesh_fill_in_compute but evaluates a whole row
+ * of the mesh at a time with @p func, `xdev->compute_distortion()` must
+ * still be set and give the same results.
+ *
+ * @relatesalso xrt_device
+ * @ingroup aux_distortion
+ */
+void
+u_distortion_mesh_fill_in_batch(struct xrt_device *xdev, u_distortion_batch_func_t func);
+
 /*!
  * Given a @ref xrt_device generates a no distortion mesh, populates
  * `xdev->hmd_parts.distortion.mesh` & `xdev->hmd_parts.distortion.models`.
@@ -141,5 +141,9 @@ u_frame_create_roi(struct xrt_frame *original, struct xrt_rect roi, struct xrt_f
 	xf->source_sequence = original->source_sequence;
 	xf->source_id = original->source_id;
 
+	// The ROI is a view into the same buffer, so it can share the handle.
+	xf->native = original->native;
+	xf->native.offset += offset;
+
 	xrt_frame_reference(out_frame, xf);
 }
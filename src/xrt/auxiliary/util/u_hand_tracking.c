@@ -99,3 +99,20 @@ u_hand_joints_apply_joint_width(struct xrt_hand_joint_set *set)
 	set->values.hand_joint_set_default[XRT_HAND_JOINT_WRIST].radius =
 	    .040f * .5f; // Measured my wrist thickness with calipers
 }
+
+void
+u_hand_joints_resolve_chain(struct xrt_hand_joint_set *set, const struct xrt_relation_chain *xrc)
+{
+	struct xrt_hand_joint_value *joints = set->values.hand_joint_set_default;
+	struct xrt_space_relation relations[XRT_HAND_JOINT_COUNT];
+
+	for (int i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+		relations[i] = joints[i].relation;
+	}
+
+	m_relation_chain_resolve_batch(xrc, relations, relations, XRT_HAND_JOINT_COUNT);
+
+	for (int i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+		joints[i].relation = relations[i];
+	}
+}
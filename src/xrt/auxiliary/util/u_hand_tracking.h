@@ -110,6 +110,15 @@ struct u_hand_tracking
 void
 u_hand_joints_apply_joint_width(struct xrt_hand_joint_set *set);
 
+/*!
+ * Puts all joints of @p set through the relation chain @p xrc, each joint
+ * relation becomes the result of resolving a chain made of that relation
+ * followed by the steps of @p xrc. Done with the batch math functions.
+ * @ingroup aux_util
+ */
+void
+u_hand_joints_resolve_chain(struct xrt_hand_joint_set *set, const struct xrt_relation_chain *xrc);
+
 /*!
  * @ingroup aux_util
  */
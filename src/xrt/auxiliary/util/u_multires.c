@@ -0,0 +1,166 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Helpers for multi-resolution (lens matched) projection views.
+ * @ingroup aux_util
+ */
+
+#include "math/m_api.h"
+
+#include "util/u_multires.h"
+
+#include <math.h>
+
+
+/*!
+ * One axis of a layout.
+ */
+struct axis
+{
+	//! Start and end of the full resolution region.
+	float a0, a1;
+
+	//! Periphery scale.
+	float s;
+
+	//! Packed size relative to the full resolution size.
+	float size;
+};
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static struct axis
+get_axis(const struct xrt_multires_layout *layout, bool y)
+{
+	if (u_multires_is_uniform(layout)) {
+		return (struct axis){0.0f, 1.0f, 1.0f, 1.0f};
+	}
+
+	struct axis a;
+	a.a0 = y ? layout->center.y : layout->center.x;
+	a.a1 = a.a0 + (y ? layout->center.h : layout->center.w);
+	a.s = y ? layout->periphery_scale.y : layout->periphery_scale.x;
+	a.size = a.s * a.a0 + (a.a1 - a.a0) + a.s * (1.0f - a.a1);
+
+	return a;
+}
+
+static float
+axis_to_packed(const struct axis *a, float x)
+{
+	float packed = a->s * fminf(x, a->a0) + (CLAMP(x, a->a0, a->a1) - a->a0) + a->s * fmaxf(x - a->a1, 0.0f);
+
+	return packed / a->size;
+}
+
+static float
+axis_to_view(const struct axis *a, float p)
+{
+	// Packed image positions of the full resolution region.
+	float p0 = a->s * a->a0;
+	float p1 = p0 + (a->a1 - a->a0);
+
+	float t = p * a->size;
+	if (t < p0) {
+		return t / a->s;
+	}
+	if (t > p1) {
+		return a->a1 + (t - p1) / a->s;
+	}
+
+	return a->a0 + (t - p0);
+}
+
+static bool
+validate_axis(float start, float extent, float scale)
+{
+	// Written so that NaNs fail.
+	if (!(start >= 0.0f && extent > 0.0f && start + extent <= 1.0f)) {
+		return false;
+	}
+
+	return scale > 0.0f && scale <= 1.0f;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+bool
+u_multires_is_uniform(const struct xrt_multires_layout *layout)
+{
+	const struct xrt_vec2 *s = &layout->periphery_scale;
+
+	return (s->x == 0.0f && s->y == 0.0f) || (s->x == 1.0f && s->y == 1.0f);
+}
+
+bool
+u_multires_validate(const struct xrt_multires_layout *layout)
+{
+	if (u_multires_is_uniform(layout)) {
+		return true;
+	}
+
+	const struct xrt_normalized_rect *c = &layout->center;
+	const struct xrt_vec2 *s = &layout->periphery_scale;
+
+	return validate_axis(c->x, c->w, s->x) && validate_axis(c->y, c->h, s->y);
+}
+
+void
+u_multires_packed_extent(const struct xrt_multires_layout *layout,
+                         uint32_t full_width,
+                         uint32_t full_height,
+                         uint32_t *out_width,
+                         uint32_t *out_height)
+{
+	struct axis x = get_axis(layout, false);
+	struct axis y = get_axis(layout, true);
+
+	*out_width = (uint32_t)ceilf(x.size * (float)full_width);
+	*out_height = (uint32_t)ceilf(y.size * (float)full_height);
+}
+
+struct xrt_vec2
+u_multires_view_to_packed(const struct xrt_multires_layout *layout, struct xrt_vec2 view_uv)
+{
+	struct axis x = get_axis(layout, false);
+	struct axis y = get_axis(layout, true);
+
+	return (struct xrt_vec2){axis_to_packed(&x, view_uv.x), axis_to_packed(&y, view_uv.y)};
+}
+
+struct xrt_vec2
+u_multires_packed_to_view(const struct xrt_multires_layout *layout, struct xrt_vec2 packed_uv)
+{
+	struct axis x = get_axis(layout, false);
+	struct axis y = get_axis(layout, true);
+
+	return (struct xrt_vec2){axis_to_view(&x, packed_uv.x), axis_to_view(&y, packed_uv.y)};
+}
+
+void
+u_multires_get_shader_params(const struct xrt_multires_layout *layout, struct u_multires_shader_params *out_params)
+{
+	struct axis x = get_axis(layout, false);
+	struct axis y = get_axis(layout, true);
+
+	out_params->bounds[0] = x.a0;
+	out_params->bounds[1] = x.a1;
+	out_params->bounds[2] = y.a0;
+	out_params->bounds[3] = y.a1;
+
+	out_params->scale[0] = x.s;
+	out_params->scale[1] = y.s;
+	out_params->scale[2] = 1.0f / x.size;
+	out_params->scale[3] = 1.0f / y.size;
+}
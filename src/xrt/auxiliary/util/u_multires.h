@@ -0,0 +1,110 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Helpers for multi-resolution (lens matched) projection views.
+ * @ingroup aux_util
+ */
+
+#pragma once
+
+#include "xrt/xrt_compiler.h"
+#include "xrt/xrt_compositor.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * @defgroup u_multires Multi-resolution projection views
+ *
+ * A multi-resolution view is a projection view where only the center region,
+ * where the lens is sharpest, is stored at full resolution. The periphery on
+ * each side is stored scaled down by a constant factor per axis, which makes
+ * the mapping from the view to the packed image piecewise linear on each
+ * axis with three pieces.
+ *
+ * With the center going from `a0` to `a1` and the periphery scale `s` the
+ * packed size of an axis is `T = s * a0 + (a1 - a0) + s * (1 - a1)` and a view
+ * coordinate `x` maps to:
+ *
+ * ```
+ * (s * min(x, a0) + clamp(x, a0, a1) - a0 + s * max(x - a1, 0)) / T
+ * ```
+ *
+ * The sub image of the view covers the packed image, coordinates are
+ * normalized to the view and the sub image with x right and y down.
+ *
+ * @ingroup aux_util
+ * @{
+ */
+
+/*!
+ * Parameters for the compositor shaders, laid out as two std140 vec4s.
+ */
+struct u_multires_shader_params
+{
+	//! Full resolution region per axis: x0, x1, y0, y1.
+	float bounds[4];
+
+	//! Periphery scale and inverse packed size per axis: sx, sy, 1 / tx, 1 / ty.
+	float scale[4];
+};
+
+/*!
+ * Is the layout the default, uniform resolution, one.
+ */
+bool
+u_multires_is_uniform(const struct xrt_multires_layout *layout);
+
+/*!
+ * Is the layout either uniform or a valid multi-resolution layout: the
+ * center is a non-empty rect inside of the view and the periphery scale is
+ * in the range (0, 1] on both axes.
+ */
+bool
+u_multires_validate(const struct xrt_multires_layout *layout);
+
+/*!
+ * Packed image size needed to store a view of @p full_width by
+ * @p full_height pixels at full resolution in the center, rounded up.
+ */
+void
+u_multires_packed_extent(const struct xrt_multires_layout *layout,
+                         uint32_t full_width,
+                         uint32_t full_height,
+                         uint32_t *out_width,
+                         uint32_t *out_height);
+
+/*!
+ * Map normalized view coordinates to normalized packed image coordinates, the
+ * same calculation as the compositor shaders do.
+ */
+struct xrt_vec2
+u_multires_view_to_packed(const struct xrt_multires_layout *layout, struct xrt_vec2 view_uv);
+
+/*!
+ * Map normalized packed image coordinates to normalized view coordinates, the
+ * inverse of @ref u_multires_view_to_packed. Used by applications to render
+ * each region with the right projection.
+ */
+struct xrt_vec2
+u_multires_packed_to_view(const struct xrt_multires_layout *layout, struct xrt_vec2 packed_uv);
+
+/*!
+ * Get the parameters for the compositor shaders, uniform layouts give the
+ * identity mapping.
+ */
+void
+u_multires_get_shader_params(const struct xrt_multires_layout *layout, struct u_multires_shader_params *out_params);
+
+/*!
+ * @}
+ */
+
+
+#ifdef __cplusplus
+}
+#endif
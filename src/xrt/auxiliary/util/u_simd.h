@@ -0,0 +1,327 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Small set of float vector helpers for batch code.
+ *
+ * The width is picked at compile time from what the target supports: AVX
+ * when built for it, otherwise SSE2 on x86 and NEON on AArch64. Without any
+ * of those the same code runs one float at a time. There is no runtime CPU
+ * dispatch, so only include this from translation units that are meant to
+ * be built for the target's baseline.
+ *
+ * @ingroup aux_util
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*!
+ * Address of lane @p i for @ref u_vf_gather, lanes past @p count repeat the
+ * last float.
+ */
+static inline const float *
+u_simd_lane_ptr(const void *base, size_t stride, uint32_t count, uint32_t i)
+{
+	return (const float *)((const char *)base + (i < count ? i : count - 1) * stride);
+}
+
+/*!
+ * @def U_SIMD_LANES
+ * Number of floats in a @ref u_vf.
+ *
+ * @typedef u_vf
+ * A vector of @ref U_SIMD_LANES floats.
+ */
+
+#if defined(__AVX__)
+
+#include <immintrin.h>
+
+#define U_SIMD_LANES (8)
+
+typedef __m256 u_vf;
+
+static inline u_vf
+u_vf_load(const float *p)
+{
+	return _mm256_loadu_ps(p);
+}
+
+static inline void
+u_vf_store(float *p, u_vf a)
+{
+	_mm256_storeu_ps(p, a);
+}
+
+/*!
+ * Loads up to @ref U_SIMD_LANES floats that are @p stride bytes apart, like
+ * a member out of an array of structs, lanes past @p count repeat the last
+ * one. Reads the floats in place, writing them out one by one to load them
+ * as a vector stalls on store forwarding.
+ */
+static inline u_vf
+u_vf_gather(const void *base, size_t stride, uint32_t count)
+{
+#define L(i) *u_simd_lane_ptr(base, stride, count, i)
+	return _mm256_set_ps(L(7), L(6), L(5), L(4), L(3), L(2), L(1), L(0));
+#undef L
+}
+
+static inline u_vf
+u_vf_set(float f)
+{
+	return _mm256_set1_ps(f);
+}
+
+static inline u_vf
+u_vf_add(u_vf a, u_vf b)
+{
+	return _mm256_add_ps(a, b);
+}
+
+static inline u_vf
+u_vf_sub(u_vf a, u_vf b)
+{
+	return _mm256_sub_ps(a, b);
+}
+
+static inline u_vf
+u_vf_mul(u_vf a, u_vf b)
+{
+	return _mm256_mul_ps(a, b);
+}
+
+static inline u_vf
+u_vf_div(u_vf a, u_vf b)
+{
+	return _mm256_div_ps(a, b);
+}
+
+static inline u_vf
+u_vf_sqrt(u_vf a)
+{
+	return _mm256_sqrt_ps(a);
+}
+
+static inline u_vf
+u_vf_max(u_vf a, u_vf b)
+{
+	return _mm256_max_ps(a, b);
+}
+
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <emmintrin.h>
+
+#define U_SIMD_LANES (4)
+
+typedef __m128 u_vf;
+
+static inline u_vf
+u_vf_load(const float *p)
+{
+	return _mm_loadu_ps(p);
+}
+
+static inline void
+u_vf_store(float *p, u_vf a)
+{
+	_mm_storeu_ps(p, a);
+}
+
+static inline u_vf
+u_vf_gather(const void *base, size_t stride, uint32_t count)
+{
+#define L(i) *u_simd_lane_ptr(base, stride, count, i)
+	return _mm_set_ps(L(3), L(2), L(1), L(0));
+#undef L
+}
+
+static inline u_vf
+u_vf_set(float f)
+{
+	return _mm_set1_ps(f);
+}
+
+static inline u_vf
+u_vf_add(u_vf a, u_vf b)
+{
+	return _mm_add_ps(a, b);
+}
+
+static inline u_vf
+u_vf_sub(u_vf a, u_vf b)
+{
+	return _mm_sub_ps(a, b);
+}
+
+static inline u_vf
+u_vf_mul(u_vf a, u_vf b)
+{
+	return _mm_mul_ps(a, b);
+}
+
+static inline u_vf
+u_vf_div(u_vf a, u_vf b)
+{
+	return _mm_div_ps(a, b);
+}
+
+static inline u_vf
+u_vf_sqrt(u_vf a)
+{
+	return _mm_sqrt_ps(a);
+}
+
+static inline u_vf
+u_vf_max(u_vf a, u_vf b)
+{
+	return _mm_max_ps(a, b);
+}
+
+#elif defined(__aarch64__) || defined(_M_ARM64)
+
+#include <arm_neon.h>
+
+#define U_SIMD_LANES (4)
+
+typedef float32x4_t u_vf;
+
+static inline u_vf
+u_vf_load(const float *p)
+{
+	return vld1q_f32(p);
+}
+
+static inline void
+u_vf_store(float *p, u_vf a)
+{
+	vst1q_f32(p, a);
+}
+
+static inline u_vf
+u_vf_gather(const void *base, size_t stride, uint32_t count)
+{
+	u_vf v = vld1q_dup_f32(u_simd_lane_ptr(base, stride, count, 0));
+	v = vld1q_lane_f32(u_simd_lane_ptr(base, stride, count, 1), v, 1);
+	v = vld1q_lane_f32(u_simd_lane_ptr(base, stride, count, 2), v, 2);
+	v = vld1q_lane_f32(u_simd_lane_ptr(base, stride, count, 3), v, 3);
+	return v;
+}
+
+static inline u_vf
+u_vf_set(float f)
+{
+	return vdupq_n_f32(f);
+}
+
+static inline u_vf
+u_vf_add(u_vf a, u_vf b)
+{
+	return vaddq_f32(a, b);
+}
+
+static inline u_vf
+u_vf_sub(u_vf a, u_vf b)
+{
+	return vsubq_f32(a, b);
+}
+
+static inline u_vf
+u_vf_mul(u_vf a, u_vf b)
+{
+	return vmulq_f32(a, b);
+}
+
+static inline u_vf
+u_vf_div(u_vf a, u_vf b)
+{
+	return vdivq_f32(a, b);
+}
+
+static inline u_vf
+u_vf_sqrt(u_vf a)
+{
+	return vsqrtq_f32(a);
+}
+
+static inline u_vf
+u_vf_max(u_vf a, u_vf b)
+{
+	return vmaxq_f32(a, b);
+}
+
+#else
+
+#define U_SIMD_LANES (1)
+
+typedef float u_vf;
+
+static inline u_vf
+u_vf_load(const float *p)
+{
+	return *p;
+}
+
+static inline void
+u_vf_store(float *p, u_vf a)
+{
+	*p = a;
+}
+
+static inline u_vf
+u_vf_gather(const void *base, size_t stride, uint32_t count)
+{
+	(void)stride;
+	(void)count;
+	return *(const float *)base;
+}
+
+static inline u_vf
+u_vf_set(float f)
+{
+	return f;
+}
+
+static inline u_vf
+u_vf_add(u_vf a, u_vf b)
+{
+	return a + b;
+}
+
+static inline u_vf
+u_vf_sub(u_vf a, u_vf b)
+{
+	return a - b;
+}
+
+static inline u_vf
+u_vf_mul(u_vf a, u_vf b)
+{
+	return a * b;
+}
+
+static inline u_vf
+u_vf_div(u_vf a, u_vf b)
+{
+	return a / b;
+}
+
+static inline u_vf
+u_vf_sqrt(u_vf a)
+{
+	return sqrtf(a);
+}
+
+static inline u_vf
+u_vf_max(u_vf a, u_vf b)
+{
+	return fmaxf(a, b);
+}
+
+#endif
@@ -111,6 +111,48 @@ u_sink_queue_create(struct xrt_frame_context *xfctx,
                     struct xrt_frame_sink *downstream,
                     struct xrt_frame_sink **out_xfs);
 
+/*!
+ * Statistics gathered by a queue sink, written by the queue without locking,
+ * only meant for displaying.
+ *
+ * @see u_sink_queue_create_with_params
+ */
+struct u_sink_queue_stats
+{
+	//! Frames handed to the consumer.
+	uint64_t delivered;
+	//! Frames dropped because the queue was full.
+	uint64_t dropped;
+	//! Time from the frame being queued to the consumer returning, last and worst.
+	int64_t latency_ns;
+	int64_t max_latency_ns;
+};
+
+/*!
+ * @see u_sink_queue_create_with_params
+ */
+struct u_sink_queue_params
+{
+	//! Max amount of frames queued, 0 means unbounded.
+	uint64_t max_size;
+	//! When full drop the oldest queued frame instead of the new one.
+	bool drop_oldest;
+	//! Optional, must outlive the queue.
+	struct u_sink_queue_stats *stats;
+};
+
+/*!
+ * Same as @ref u_sink_queue_create but with a drop policy and statistics.
+ *
+ * @public @memberof xrt_frame_sink
+ * @see xrt_frame_context
+ */
+bool
+u_sink_queue_create_with_params(struct xrt_frame_context *xfctx,
+                                const struct u_sink_queue_params *params,
+                                struct xrt_frame_sink *downstream,
+                                struct xrt_frame_sink **out_xfs);
+
 
 /*!
  * @public @memberof xrt_frame_sink
@@ -142,6 +184,58 @@ u_sink_split_create(struct xrt_frame_context *xfctx,
                     struct xrt_frame_sink *right,
                     struct xrt_frame_sink **out_xfs);
 
+/*!
+ * How a consumer of a fan-out sink receives frames.
+ *
+ * @see u_sink_fanout_create
+ */
+enum u_sink_fanout_policy
+{
+	//! Called on the producer thread, before any queued consumer gets the frame.
+	U_SINK_FANOUT_SYNC,
+	//! Queued on its own thread, new frames are dropped when the queue is full.
+	U_SINK_FANOUT_DROP_NEWEST,
+	//! Queued on its own thread, the oldest queued frame is dropped when full.
+	U_SINK_FANOUT_DROP_OLDEST,
+};
+
+/*!
+ * @see u_sink_fanout_create
+ */
+struct u_sink_fanout_consumer
+{
+	struct xrt_frame_sink *sink;
+	//! Used for the debug UI, may be NULL.
+	const char *name;
+	//! Higher priority consumers get the frame first within a policy group.
+	int32_t priority;
+	enum u_sink_fanout_policy policy;
+	//! Queue length for queued consumers, 0 means one frame.
+	uint32_t max_queue;
+};
+
+//! Max number of consumers of a fan-out sink.
+#define U_SINK_FANOUT_MAX_CONSUMERS 8
+
+/*!
+ * Takes a frame and pushes it to multiple consumers, each with its own
+ * priority and drop policy. All synchronous consumers are called in priority
+ * order on the producer thread first, then the frame is handed to the queued
+ * consumers. Per consumer latency is reported in the debug UI under
+ * @p name.
+ *
+ * NULL consumer sinks are skipped.
+ *
+ * @public @memberof xrt_frame_sink
+ * @see xrt_frame_context
+ */
+bool
+u_sink_fanout_create(struct xrt_frame_context *xfctx,
+                     const char *name,
+                     const struct u_sink_fanout_consumer *consumers,
+                     uint32_t consumer_count,
+                     struct xrt_frame_sink **out_xfs);
+
 /*!
  * Splits Stereo SBS frames into two independent frames
  */
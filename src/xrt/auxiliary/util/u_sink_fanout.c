@@ -0,0 +1,195 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  An @ref xrt_frame_sink fan-out with per consumer queues.
+ * @ingroup aux_util
+ */
+
+#include "os/os_time.h"
+
+#include "util/u_var.h"
+#include "util/u_misc.h"
+#include "util/u_sink.h"
+#include "util/u_logging.h"
+#include "util/u_trace_marker.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+struct u_sink_fanout_entry
+{
+	//! The consumer for synchronous entries, the queue in front of it otherwise.
+	struct xrt_frame_sink *sink;
+
+	enum u_sink_fanout_policy policy;
+	int32_t priority;
+
+	//! Written by the queue for queued entries, by the push for synchronous ones.
+	struct u_sink_queue_stats stats;
+};
+
+/*!
+ * An @ref xrt_frame_sink fan-out, synchronous consumers first then queued
+ * ones, each group in priority order.
+ *
+ * @implements xrt_frame_sink
+ * @implements xrt_frame_node
+ */
+struct u_sink_fanout
+{
+	struct xrt_frame_sink base;
+	struct xrt_frame_node node;
+
+	struct u_sink_fanout_entry entries[U_SINK_FANOUT_MAX_CONSUMERS];
+	uint32_t entry_count;
+};
+
+static int
+consumer_order(const void *a, const void *b)
+{
+	const struct u_sink_fanout_consumer *ca = (const struct u_sink_fanout_consumer *)a;
+	const struct u_sink_fanout_consumer *cb = (const struct u_sink_fanout_consumer *)b;
+
+	bool a_sync = ca->policy == U_SINK_FANOUT_SYNC;
+	bool b_sync = cb->policy == U_SINK_FANOUT_SYNC;
+	if (a_sync != b_sync) {
+		return a_sync ? -1 : 1;
+	}
+
+	return (cb->priority > ca->priority) - (cb->priority < ca->priority);
+}
+
+static void
+fanout_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
+{
+	SINK_TRACE_MARKER();
+
+	struct u_sink_fanout *f = (struct u_sink_fanout *)xfs;
+
+	for (uint32_t i = 0; i < f->entry_count; i++) {
+		struct u_sink_fanout_entry *e = &f->entries[i];
+
+		if (e->policy != U_SINK_FANOUT_SYNC) {
+			// Only takes a reference and wakes the queue thread.
+			xrt_sink_push_frame(e->sink, xf);
+			continue;
+		}
+
+		int64_t start_ns = (int64_t)os_monotonic_get_ns();
+		xrt_sink_push_frame(e->sink, xf);
+		int64_t latency_ns = (int64_t)os_monotonic_get_ns() - start_ns;
+
+		e->stats.delivered++;
+		e->stats.latency_ns = latency_ns;
+		if (latency_ns > e->stats.max_latency_ns) {
+			e->stats.max_latency_ns = latency_ns;
+		}
+	}
+}
+
+static void
+fanout_break_apart(struct xrt_frame_node *node)
+{
+	// Noop, the queues are nodes of their own.
+}
+
+static void
+fanout_destroy(struct xrt_frame_node *node)
+{
+	struct u_sink_fanout *f = container_of(node, struct u_sink_fanout, node);
+
+	u_var_remove_root(f);
+	free(f);
+}
+
+static void
+fanout_add_vars(struct u_sink_fanout *f, const char *name, const char *const *names)
+{
+	u_var_add_root(f, name, true);
+
+	for (uint32_t i = 0; i < f->entry_count; i++) {
+		struct u_sink_fanout_entry *e = &f->entries[i];
+		char label[64];
+
+		(void)snprintf(label, sizeof(label), "%s (%s)", names[i] != NULL ? names[i] : "consumer",
+		               e->policy == U_SINK_FANOUT_SYNC ? "sync" : "queued");
+		u_var_add_ro_text(f, "", label);
+		u_var_add_ro_u64(f, &e->stats.delivered, "Delivered");
+		u_var_add_ro_u64(f, &e->stats.dropped, "Dropped");
+		u_var_add_ro_i64(f, &e->stats.latency_ns, "Latency (ns)");
+		u_var_add_ro_i64(f, &e->stats.max_latency_ns, "Max latency (ns)");
+	}
+}
+
+
+/*
+ *
+ * Exported functions.
+ *
+ */
+
+bool
+u_sink_fanout_create(struct xrt_frame_context *xfctx,
+                     const char *name,
+                     const struct u_sink_fanout_consumer *consumers,
+                     uint32_t consumer_count,
+                     struct xrt_frame_sink **out_xfs)
+{
+	if (consumer_count > U_SINK_FANOUT_MAX_CONSUMERS) {
+		U_LOG_E("Too many consumers %u, max is %u", consumer_count, U_SINK_FANOUT_MAX_CONSUMERS);
+		return false;
+	}
+
+	struct u_sink_fanout *f = U_TYPED_CALLOC(struct u_sink_fanout);
+	const char *names[U_SINK_FANOUT_MAX_CONSUMERS] = {0};
+
+	f->base.push_frame = fanout_frame;
+	f->node.break_apart = fanout_break_apart;
+	f->node.destroy = fanout_destroy;
+
+	struct u_sink_fanout_consumer sorted[U_SINK_FANOUT_MAX_CONSUMERS];
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < consumer_count; i++) {
+		if (consumers[i].sink != NULL) {
+			sorted[count++] = consumers[i];
+		}
+	}
+	qsort(sorted, count, sizeof(sorted[0]), consumer_order);
+
+	// All nodes are broken apart before any is destroyed, so the queue threads are gone by then.
+	xrt_frame_context_add(xfctx, &f->node);
+
+	for (uint32_t i = 0; i < count; i++) {
+		struct u_sink_fanout_entry *e = &f->entries[i];
+
+		e->sink = sorted[i].sink;
+		e->policy = sorted[i].policy;
+		e->priority = sorted[i].priority;
+		names[i] = sorted[i].name;
+
+		if (e->policy == U_SINK_FANOUT_SYNC) {
+			continue;
+		}
+
+		struct u_sink_queue_params params = {
+		    .max_size = sorted[i].max_queue > 0 ? sorted[i].max_queue : 1,
+		    .drop_oldest = e->policy == U_SINK_FANOUT_DROP_OLDEST,
+		    .stats = &e->stats,
+		};
+
+		if (!u_sink_queue_create_with_params(xfctx, &params, sorted[i].sink, &e->sink)) {
+			U_LOG_E("Failed to create queue for consumer %u", i);
+			return false;
+		}
+	}
+
+	f->entry_count = count;
+
+	fanout_add_vars(f, name, names);
+
+	*out_xfs = &f->base;
+
+	return true;
+}
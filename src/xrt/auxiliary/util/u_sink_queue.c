@@ -7,6 +7,8 @@
  * @ingroup aux_util
  */
 
+#include "os/os_time.h"
+
 #include "util/u_misc.h"
 #include "util/u_sink.h"
 #include "util/u_trace_marker.h"
@@ -17,6 +19,8 @@
 struct u_sink_queue_elem
 {
 	struct xrt_frame *frame;
+	//! When the frame was queued, for latency statistics.
+	int64_t queued_ns;
 	struct u_sink_queue_elem *next;
 };
 
@@ -50,6 +54,12 @@ struct u_sink_queue
 	//! Max amount of frames before dropping new ones. 0 means unbounded.
 	uint64_t max_size;
 
+	//! Drop the oldest frame instead of the new one when full.
+	bool drop_oldest;
+
+	//! Optional statistics, owned by the creator.
+	struct u_sink_queue_stats *stats;
+
 	pthread_t thread;
 	pthread_mutex_t mutex;
 
@@ -78,10 +88,13 @@ queue_is_full(struct u_sink_queue *q)
 //! Pops the oldest frame, reference counting unchanged.
 //! Call with q->mutex locked.
 static struct xrt_frame *
-queue_pop(struct u_sink_queue *q)
+queue_pop(struct u_sink_queue *q, int64_t *out_queued_ns)
 {
 	assert(!queue_is_empty(q));
 	struct xrt_frame *frame = q->front->frame;
+	if (out_queued_ns != NULL) {
+		*out_queued_ns = q->front->queued_ns;
+	}
 	struct u_sink_queue_elem *old_front = q->front;
 	q->front = q->front->next;
 	free(old_front);
@@ -99,10 +112,18 @@ static bool
 queue_try_refpush(struct u_sink_queue *q, struct xrt_frame *xf)
 {
 	if (queue_is_full(q)) {
-		return false;
+		if (q->stats != NULL) {
+			q->stats->dropped++;
+		}
+		if (!q->drop_oldest || queue_is_empty(q)) {
+			return false;
+		}
+		struct xrt_frame *old = queue_pop(q, NULL);
+		xrt_frame_reference(&old, NULL);
 	}
 	struct u_sink_queue_elem *elem = U_TYPED_CALLOC(struct u_sink_queue_elem);
 	xrt_frame_reference(&elem->frame, xf);
+	elem->queued_ns = q->stats != NULL ? (int64_t)os_monotonic_get_ns() : 0;
 	elem->next = NULL;
 	if (q->back == NULL) { // First frame
 		q->front = elem;
@@ -121,7 +142,7 @@ queue_refclear(struct u_sink_queue *q)
 {
 	while (!queue_is_empty(q)) {
 		assert((q->size > 1) ^ (q->front == q->back));
-		struct xrt_frame *xf = queue_pop(q);
+		struct xrt_frame *xf = queue_pop(q, NULL);
 		xrt_frame_reference(&xf, NULL);
 	}
 }
@@ -133,6 +154,7 @@ queue_mainloop(void *ptr)
 
 	struct u_sink_queue *q = (struct u_sink_queue *)ptr;
 	struct xrt_frame *frame = NULL;
+	int64_t queued_ns = 0;
 
 	pthread_mutex_lock(&q->mutex);
 
@@ -161,7 +183,7 @@ queue_mainloop(void *ptr)
 		 * replaced. But we no longer need to hold onto the frame on the
 		 * queue so we dequeue it.
 		 */
-		frame = queue_pop(q);
+		frame = queue_pop(q, &queued_ns);
 
 		/*
 		 * Unlock the mutex when we do the work, so a new frame can be
@@ -172,6 +194,15 @@ queue_mainloop(void *ptr)
 		// Send to the consumer that does the work.
 		q->consumer->push_frame(q->consumer, frame);
 
+		if (q->stats != NULL) {
+			int64_t latency_ns = (int64_t)os_monotonic_get_ns() - queued_ns;
+			q->stats->delivered++;
+			q->stats->latency_ns = latency_ns;
+			if (latency_ns > q->stats->max_latency_ns) {
+				q->stats->max_latency_ns = latency_ns;
+			}
+		}
+
 		/*
 		 * Drop our reference we don't need it anymore, or it's held by
 		 * the consumer.
@@ -255,6 +286,21 @@ u_sink_queue_create(struct xrt_frame_context *xfctx,
                     uint64_t max_size,
                     struct xrt_frame_sink *downstream,
                     struct xrt_frame_sink **out_xfs)
+{
+	struct u_sink_queue_params params = {
+	    .max_size = max_size,
+	    .drop_oldest = false,
+	    .stats = NULL,
+	};
+
+	return u_sink_queue_create_with_params(xfctx, &params, downstream, out_xfs);
+}
+
+bool
+u_sink_queue_create_with_params(struct xrt_frame_context *xfctx,
+                                const struct u_sink_queue_params *params,
+                                struct xrt_frame_sink *downstream,
+                                struct xrt_frame_sink **out_xfs)
 {
 	struct u_sink_queue *q = U_TYPED_CALLOC(struct u_sink_queue);
 	int ret = 0;
@@ -266,7 +312,9 @@ u_sink_queue_create(struct xrt_frame_context *xfctx,
 	q->running = true;
 
 	q->size = 0;
-	q->max_size = max_size;
+	q->max_size = params->max_size;
+	q->drop_oldest = params->drop_oldest;
+	q->stats = params->stats;
 
 	ret = pthread_mutex_init(&q->mutex, NULL);
 	if (ret != 0) {
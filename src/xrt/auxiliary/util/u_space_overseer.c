@@ -32,6 +32,18 @@
  *
  */
 
+/*!
+ * Max number of steps in a @ref u_space_chain, static spaces in a row are
+ * collapsed so at most every other step is an offset.
+ */
+#define U_SPACE_CHAIN_MAX_STEPS (XRT_RELATION_CHAIN_CAPACITY * 2)
+
+/*!
+ * Max number of compiled chains kept, the cache is cleared when full so
+ * chains of destroyed spaces do not pile up.
+ */
+#define U_SPACE_CHAIN_CACHE_SIZE (256)
+
 /*!
  * Keeps track of what kind of space it is.
  */
@@ -61,6 +73,12 @@ struct u_space
 	 */
 	enum u_space_type type;
 
+	/*!
+	 * Never reused id of the space, used as the key for compiled chains so
+	 * that a new space can not hit the chain of a destroyed one.
+	 */
+	uint32_t id;
+
 	union {
 		struct
 		{
@@ -75,6 +93,54 @@ struct u_space
 	};
 };
 
+/*!
+ * Kind of step in a @ref u_space_chain.
+ */
+enum u_space_chain_step_type
+{
+	//! Constant offset, made from one or more static spaces in a row.
+	U_SPACE_CHAIN_STEP_OFFSET,
+
+	//! The tracked pose of a device.
+	U_SPACE_CHAIN_STEP_POSE,
+
+	//! The inverse of the tracked pose of a device.
+	U_SPACE_CHAIN_STEP_INVERSE_POSE,
+};
+
+/*!
+ * A single step in a @ref u_space_chain.
+ */
+struct u_space_chain_step
+{
+	enum u_space_chain_step_type type;
+
+	union {
+		struct
+		{
+			struct xrt_device *xdev;
+			enum xrt_input_name xname;
+		} pose;
+
+		struct xrt_pose offset;
+	};
+};
+
+/*!
+ * The steps needed to relate a space to a base space, worked out from the
+ * graph ahead of time. Static spaces in a row are collapsed into one offset
+ * and static spaces shared by both spaces are left out, so only the device
+ * poses and the offsets between them need to be applied when locating.
+ */
+struct u_space_chain
+{
+	//! Value of @ref u_space_overseer::generation this was compiled at.
+	uint64_t generation;
+
+	uint32_t step_count;
+	struct u_space_chain_step steps[U_SPACE_CHAIN_MAX_STEPS];
+};
+
 /*!
  * Default implementation of the xrt_space_overseer object.
  */
@@ -109,6 +175,21 @@ struct u_space_overseer
 	 * spaces and that they share the same parent.
 	 */
 	bool can_do_local_spaces_recenter;
+
+	/*!
+	 * Bumped when any offset in the graph changes, protected by the lock.
+	 * Compiled chains from older generations are compiled again.
+	 */
+	uint64_t generation;
+
+	//! Protects the compiled chain cache, taken with the lock held.
+	pthread_mutex_t chain_cache_lock;
+
+	//! Map from target and base space id pairs to @ref u_space_chain.
+	struct u_hashmap_int *chain_cache;
+
+	//! Number of entries in @ref chain_cache.
+	uint32_t chain_cache_count;
 };
 
 
@@ -213,10 +294,13 @@ find_xdev_space_read_locked(struct u_space_overseer *uso, struct xrt_device *xde
  * Updates the offset of a NULL or OFFSET space.
  */
 static void
-update_offset_write_locked(struct u_space *us, const struct xrt_pose *new_offset)
+update_offset_write_locked(struct u_space_overseer *uso, struct u_space *us, const struct xrt_pose *new_offset)
 {
 	assert(us->type == U_SPACE_TYPE_NULL || us->type == U_SPACE_TYPE_OFFSET);
 
+	// All compiled chains going through this space are now out of date.
+	uso->generation++;
+
 	if (m_pose_is_identity(new_offset)) { // Small optimisation.
 		us->type = U_SPACE_TYPE_NULL;
 		U_ZERO(&us->offset.pose);
@@ -281,94 +365,215 @@ notify_ref_space_usage_device(struct u_space_overseer *uso, enum xrt_reference_s
  */
 
 /*!
- * For each space, push the relation of that space and then traverse by calling
- * @p push_then_traverse again with the parent space. That means traverse goes
- * from a leaf space to a the root space, relations are pushed in the same
- * order.
+ * Adds a constant offset to the end of the chain, folding it into the last
+ * step if that is also an offset.
  */
 static void
-push_then_traverse(struct xrt_relation_chain *xrc, struct u_space *space, uint64_t at_timestamp_ns)
+chain_add_offset(struct u_space_chain *chain, const struct xrt_pose *offset)
+{
+	if (chain->step_count > 0) {
+		struct u_space_chain_step *last = &chain->steps[chain->step_count - 1];
+		if (last->type == U_SPACE_CHAIN_STEP_OFFSET) {
+			math_pose_transform(offset, &last->offset, &last->offset);
+			return;
+		}
+	}
+
+	if (chain->step_count >= ARRAY_SIZE(chain->steps)) {
+		return;
+	}
+
+	struct u_space_chain_step *step = &chain->steps[chain->step_count++];
+	step->type = U_SPACE_CHAIN_STEP_OFFSET;
+	step->offset = *offset;
+}
+
+static void
+chain_add_pose(struct u_space_chain *chain, const struct u_space *space, bool inverse)
+{
+	assert(space->pose.xdev != NULL);
+	assert(space->pose.xname != 0);
+
+	if (chain->step_count >= ARRAY_SIZE(chain->steps)) {
+		return;
+	}
+
+	struct u_space_chain_step *step = &chain->steps[chain->step_count++];
+	step->type = inverse ? U_SPACE_CHAIN_STEP_INVERSE_POSE : U_SPACE_CHAIN_STEP_POSE;
+	step->pose.xdev = space->pose.xdev;
+	step->pose.xname = space->pose.xname;
+}
+
+/*!
+ * Adds the relation of @p space to its parent, or the inverse of it.
+ */
+static void
+chain_add_space(struct u_space_chain *chain, const struct u_space *space, bool inverse)
 {
 	switch (space->type) {
 	case U_SPACE_TYPE_NULL: break; // No-op
-	case U_SPACE_TYPE_POSE: {
-		assert(space->pose.xdev != NULL);
-		assert(space->pose.xname != 0);
+	case U_SPACE_TYPE_POSE: chain_add_pose(chain, space, inverse); break;
+	case U_SPACE_TYPE_OFFSET:
+		if (inverse) {
+			struct xrt_pose invert;
+			math_pose_invert(&space->offset.pose, &invert);
+			chain_add_offset(chain, &invert);
+		} else {
+			chain_add_offset(chain, &space->offset.pose);
+		}
+		break;
+	case U_SPACE_TYPE_ROOT: assert(false); // Should not get here.
+	}
+}
 
-		struct xrt_space_relation xsr;
-		xrt_device_get_tracked_pose(space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
-		m_relation_chain_push_relation(xrc, &xsr);
-	} break;
-	case U_SPACE_TYPE_OFFSET: m_relation_chain_push_pose_if_not_identity(xrc, &space->offset.pose); break;
-	case U_SPACE_TYPE_ROOT: return; // Stops the traversing.
+/*!
+ * Collects the spaces from @p space up to but not including the root space,
+ * returns the number of spaces.
+ */
+static uint32_t
+get_path_to_root_read_locked(struct u_space *space, struct u_space **path, uint32_t max_count)
+{
+	uint32_t count = 0;
+
+	for (struct u_space *s = space; s->type != U_SPACE_TYPE_ROOT; s = s->next) {
+		assert(s->next != NULL);
+
+		if (count >= max_count) {
+			U_LOG_E("Space graph deeper than %u spaces!", max_count);
+			break;
+		}
+
+		path[count++] = s;
 	}
 
-	// Please tail-call optimise this miss compiler.
-	assert(space->next != NULL);
-	push_then_traverse(xrc, space->next, at_timestamp_ns);
+	return count;
 }
 
 /*!
- * For each space, traverse by calling @p traverse_then_push_inverse again with
- * the parent space then push the inverse of the relation of that. That means
- * traverse goes from a leaf space to a the root space, relations are pushed in
- * the reversed order.
+ * Works out the steps from @p target to @p base: the relations of the spaces
+ * from the target up to the root, followed by the inverse relations of the
+ * spaces from the root down to the base.
  */
 static void
-traverse_then_push_inverse(struct xrt_relation_chain *xrc, struct u_space *space, uint64_t at_timestamp_ns)
+compile_chain_read_locked(struct u_space_overseer *uso,
+                          struct u_space *base,
+                          struct u_space *target,
+                          struct u_space_chain *chain)
 {
-	// Done traversing.
-	switch (space->type) {
-	case U_SPACE_TYPE_NULL: break;
-	case U_SPACE_TYPE_POSE: break;
-	case U_SPACE_TYPE_OFFSET: break;
-	case U_SPACE_TYPE_ROOT: return; // Stops the traversing.
+	struct u_space *target_path[U_SPACE_CHAIN_MAX_STEPS];
+	struct u_space *base_path[U_SPACE_CHAIN_MAX_STEPS];
+	uint32_t target_count = get_path_to_root_read_locked(target, target_path, ARRAY_SIZE(target_path));
+	uint32_t base_count = get_path_to_root_read_locked(base, base_path, ARRAY_SIZE(base_path));
+
+	/*
+	 * Static spaces that both paths go through cancel each other out, stop
+	 * at the first device space as the flags of its pose still apply.
+	 */
+	while (target_count > 0 && base_count > 0 &&                      //
+	       target_path[target_count - 1] == base_path[base_count - 1] && //
+	       target_path[target_count - 1]->type != U_SPACE_TYPE_POSE) {
+		target_count--;
+		base_count--;
 	}
 
-	// Can't tail-call optimise this one :(
-	assert(space->next != NULL);
-	traverse_then_push_inverse(xrc, space->next, at_timestamp_ns);
+	chain->generation = uso->generation;
+	chain->step_count = 0;
 
-	switch (space->type) {
-	case U_SPACE_TYPE_NULL: break; // No-op
-	case U_SPACE_TYPE_POSE: {
-		assert(space->pose.xdev != NULL);
-		assert(space->pose.xname != 0);
+	for (uint32_t i = 0; i < target_count; i++) {
+		chain_add_space(chain, target_path[i], false);
+	}
 
-		struct xrt_space_relation xsr;
-		xrt_device_get_tracked_pose(space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
-		m_relation_chain_push_inverted_relation(xrc, &xsr);
-	} break;
-	case U_SPACE_TYPE_OFFSET: m_relation_chain_push_inverted_pose_if_not_identity(xrc, &space->offset.pose); break;
-	case U_SPACE_TYPE_ROOT: assert(false); // Should not get here.
+	for (uint32_t i = base_count; i > 0; i--) {
+		chain_add_space(chain, base_path[i - 1], true);
 	}
 }
 
 static void
-build_relation_chain_read_locked(struct u_space_overseer *uso,
-                                 struct xrt_relation_chain *xrc,
-                                 struct u_space *base,
-                                 struct u_space *target,
-                                 uint64_t at_timestamp_ns)
+chain_cache_free_item(void *item, void *priv)
 {
-	assert(xrc != NULL);
-	assert(base != NULL);
-	assert(target != NULL);
+	free(item);
+}
+
+/*!
+ * Returns a copy of the compiled chain from @p target to @p base, compiling
+ * it if it's not in the cache or the graph has changed since.
+ */
+static void
+get_chain_read_locked(struct u_space_overseer *uso,
+                      struct u_space *base,
+                      struct u_space *target,
+                      struct u_space_chain *out_chain)
+{
+	uint64_t key = ((uint64_t)target->id << 32) | base->id;
+	void *ptr = NULL;
+
+	pthread_mutex_lock(&uso->chain_cache_lock);
 
-	push_then_traverse(xrc, target, at_timestamp_ns);
-	traverse_then_push_inverse(xrc, base, at_timestamp_ns);
+	u_hashmap_int_find(uso->chain_cache, key, &ptr);
+	struct u_space_chain *chain = (struct u_space_chain *)ptr;
+
+	if (chain == NULL) {
+		if (uso->chain_cache_count >= U_SPACE_CHAIN_CACHE_SIZE) {
+			u_hashmap_int_clear_and_call_for_each(uso->chain_cache, chain_cache_free_item, uso);
+			uso->chain_cache_count = 0;
+		}
+
+		chain = U_TYPED_CALLOC(struct u_space_chain);
+		compile_chain_read_locked(uso, base, target, chain);
+		u_hashmap_int_insert(uso->chain_cache, key, chain);
+		uso->chain_cache_count++;
+	} else if (chain->generation != uso->generation) {
+		compile_chain_read_locked(uso, base, target, chain);
+	}
+
+	*out_chain = *chain;
+
+	pthread_mutex_unlock(&uso->chain_cache_lock);
 }
 
+/*!
+ * Pushes the steps of @p chain, with the optional @p offset in front and the
+ * inverse of the optional @p base_offset at the end. Offsets next to each
+ * other are multiplied together, so only the device poses and the offsets
+ * between them become steps.
+ */
 static void
-build_relation_chain(struct u_space_overseer *uso,
-                     struct xrt_relation_chain *xrc,
-                     struct u_space *base,
-                     struct u_space *target,
-                     uint64_t at_timestamp_ns)
+push_chain(struct xrt_relation_chain *xrc,
+           const struct u_space_chain *chain,
+           const struct xrt_pose *offset,
+           const struct xrt_pose *base_offset,
+           uint64_t at_timestamp_ns)
 {
-	pthread_rwlock_rdlock(&uso->lock);
-	build_relation_chain_read_locked(uso, xrc, base, target, at_timestamp_ns);
-	pthread_rwlock_unlock(&uso->lock);
+	struct xrt_pose pending = offset != NULL ? *offset : (struct xrt_pose)XRT_POSE_IDENTITY;
+
+	for (uint32_t i = 0; i < chain->step_count; i++) {
+		const struct u_space_chain_step *step = &chain->steps[i];
+
+		if (step->type == U_SPACE_CHAIN_STEP_OFFSET) {
+			math_pose_transform(&step->offset, &pending, &pending);
+			continue;
+		}
+
+		m_relation_chain_push_pose_if_not_identity(xrc, &pending);
+		pending = (struct xrt_pose)XRT_POSE_IDENTITY;
+
+		struct xrt_space_relation xsr;
+		xrt_device_get_tracked_pose(step->pose.xdev, step->pose.xname, at_timestamp_ns, &xsr);
+
+		if (step->type == U_SPACE_CHAIN_STEP_INVERSE_POSE) {
+			m_relation_chain_push_inverted_relation(xrc, &xsr);
+		} else {
+			m_relation_chain_push_relation(xrc, &xsr);
+		}
+	}
+
+	if (base_offset != NULL) {
+		struct xrt_pose invert;
+		math_pose_invert(base_offset, &invert);
+		math_pose_transform(&invert, &pending, &pending);
+	}
+
+	m_relation_chain_push_pose_if_not_identity(xrc, &pending);
 }
 
 static inline void
@@ -410,6 +615,9 @@ space_destroy(struct xrt_space *xs)
 	free(us);
 }
 
+//! Source of @ref u_space::id.
+static xrt_atomic_s32_t space_id_counter;
+
 /*!
  * Creates a space, returns with a reference of one. The lock doesn't need to be
  * held as this function is not modifying any of the currently existing spaces
@@ -424,6 +632,7 @@ create_space(enum u_space_type type, struct u_space *parent)
 	us->base.reference.count = 1;
 	us->base.destroy = space_destroy;
 	us->type = type;
+	us->id = (uint32_t)xrt_atomic_s32_inc_return(&space_id_counter);
 
 	u_space_reference(&us->next, parent);
 
@@ -517,16 +726,19 @@ locate_space(struct xrt_space_overseer *xso,
 	struct u_space *uspace = u_space(space);
 
 	struct xrt_relation_chain xrc = {0};
-
-	m_relation_chain_push_pose_if_not_identity(&xrc, offset);
+	struct u_space_chain chain;
+	chain.step_count = 0;
 
 	// crude optimization: If locating a space in itself, we don't actually need to locate the space itself.
 	// only the offsets need to be applied.
 	if (uspace != ubase_space) {
-		build_relation_chain(uso, &xrc, ubase_space, uspace, at_timestamp_ns);
+		pthread_rwlock_rdlock(&uso->lock);
+		get_chain_read_locked(uso, ubase_space, uspace, &chain);
+		pthread_rwlock_unlock(&uso->lock);
 	}
 
-	m_relation_chain_push_inverted_pose_if_not_identity(&xrc, base_offset);
+	// The offsets are folded into the static steps of the chain.
+	push_chain(&xrc, &chain, offset, base_offset, at_timestamp_ns);
 
 	// For base_space =~= space (approx equals).
 	special_resolve(&xrc, out_relation);
@@ -547,18 +759,19 @@ locate_device(struct xrt_space_overseer *xso,
 	struct u_space *ubase_space = u_space(base_space);
 
 	struct xrt_relation_chain xrc = {0};
+	struct u_space_chain chain;
 
 	// Only need the read lock.
 	pthread_rwlock_rdlock(&uso->lock);
 
 	struct u_space *uspace = find_xdev_space_read_locked(uso, xdev);
-	build_relation_chain_read_locked(uso, &xrc, ubase_space, uspace, at_timestamp_ns);
+	get_chain_read_locked(uso, ubase_space, uspace, &chain);
 
 	// Safe to unlock now.
 	pthread_rwlock_unlock(&uso->lock);
 
 	// Do as much work outside of the lock.
-	m_relation_chain_push_inverted_pose_if_not_identity(&xrc, base_offset);
+	push_chain(&xrc, &chain, NULL, base_offset, at_timestamp_ns);
 	special_resolve(&xrc, out_relation);
 
 	return XRT_SUCCESS;
@@ -654,7 +867,9 @@ recenter_local_spaces(struct xrt_space_overseer *xso)
 	 */
 
 	struct xrt_relation_chain xrc = {0};
-	build_relation_chain_read_locked(uso, &xrc, uparent, uview, new_ns);
+	struct u_space_chain chain;
+	get_chain_read_locked(uso, uparent, uview, &chain);
+	push_chain(&xrc, &chain, NULL, NULL, new_ns);
 
 	struct xrt_space_relation rel;
 	special_resolve(&xrc, &rel);
@@ -691,8 +906,8 @@ recenter_local_spaces(struct xrt_space_overseer *xso)
 	local_floor_offset.position.z = rel.pose.position.z;
 
 	// Update the offsets.
-	update_offset_write_locked(ulocal, &local_offset);
-	update_offset_write_locked(ulocal_floor, &local_floor_offset);
+	update_offset_write_locked(uso, ulocal, &local_offset);
+	update_offset_write_locked(uso, ulocal_floor, &local_floor_offset);
 
 	// Push the events.
 	union xrt_session_event xse = XRT_STRUCT_INIT;
@@ -743,6 +958,10 @@ destroy(struct xrt_space_overseer *xso)
 	u_hashmap_int_clear_and_call_for_each(uso->xdev_map, hashmap_unreference_space_items, uso);
 	u_hashmap_int_destroy(&uso->xdev_map);
 
+	u_hashmap_int_clear_and_call_for_each(uso->chain_cache, chain_cache_free_item, uso);
+	u_hashmap_int_destroy(&uso->chain_cache);
+	pthread_mutex_destroy(&uso->chain_cache_lock);
+
 	pthread_rwlock_destroy(&uso->lock);
 
 	free(uso);
@@ -777,6 +996,12 @@ u_space_overseer_create(struct xrt_session_event_sink *broadcast)
 	ret = u_hashmap_int_create(&uso->xdev_map);
 	assert(ret == 0);
 
+	ret = pthread_mutex_init(&uso->chain_cache_lock, NULL);
+	assert(ret == 0);
+
+	ret = u_hashmap_int_create(&uso->chain_cache);
+	assert(ret == 0);
+
 	create_and_set_root_space(uso);
 
 	return uso;
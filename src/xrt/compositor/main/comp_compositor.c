@@ -60,6 +60,7 @@
 #include "util/u_pretty_print.h"
 #include "util/u_distortion_mesh.h"
 #include "util/u_verify.h"
+#include "util/u_multires.h"
 
 #include "util/comp_vulkan.h"
 #include "main/comp_compositor.h"
@@ -277,6 +278,18 @@ can_do_one_projection_layer_fast_path(struct comp_compositor *c)
 		return false;
 	}
 
+	/*
+	 * The distortion shader samples the views uniformly, the layer
+	 * renderer unpacks multi-resolution views into the scratch images.
+	 */
+	for (uint32_t i = 0; i < layer->data.view_count; i++) {
+		const struct xrt_layer_projection_view_data *vd =
+		    type == XRT_LAYER_PROJECTION ? &layer->data.proj.v[i] : &layer->data.depth.v[i];
+		if (!u_multires_is_uniform(&vd->multires)) {
+			return false;
+		}
+	}
+
 	return true;
 }
 
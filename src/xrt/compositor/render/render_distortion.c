@@ -13,6 +13,9 @@
 #include "math/m_matrix_2x2.h"
 #include "math/m_vec2.h"
 
+#include "util/u_misc.h"
+#include "util/u_distortion_cache.h"
+
 #include "vk/vk_mini_helpers.h"
 
 #include "render/render_interface.h"
@@ -190,19 +193,34 @@ struct tan_angles_transforms
 	struct xrt_vec2 scale;
 };
 
-XRT_CHECK_RESULT static VkResult
-create_and_fill_in_distortion_buffer_for_view(struct vk_bundle *vk,
-                                              struct xrt_device *xdev,
-                                              struct render_buffer *r_buffer,
-                                              struct render_buffer *g_buffer,
-                                              struct render_buffer *b_buffer,
-                                              uint32_t view,
-                                              bool pre_rotate)
+/*!
+ * What the distortion images depend on besides the distortion function,
+ * part of the cache key.
+ */
+struct distortion_image_params
 {
-	VkBufferUsageFlags usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-	VkResult ret;
+	uint32_t dimensions;
+	struct xrt_matrix_2x2 rot[XRT_MAX_VIEWS];
+};
+
+/*!
+ * Shared with the row workers when computing the distortion images.
+ */
+struct distortion_image_rows
+{
+	struct xrt_device *xdev;
+
+	//! All textures, ordered like the images RRGGBB.
+	struct texture *textures;
+
+	uint32_t view_count;
+
+	const struct xrt_matrix_2x2 *rot;
+};
 
+static struct xrt_matrix_2x2
+get_view_rotation(struct xrt_device *xdev, uint32_t view, bool pre_rotate)
+{
 	struct xrt_matrix_2x2 rot = xdev->hmd->views[view].rot;
 
 	const struct xrt_matrix_2x2 rotation_90_cw = {{
@@ -217,6 +235,104 @@ create_and_fill_in_distortion_buffer_for_view(struct vk_bundle *vk,
 		m_mat2x2_multiply(&rot, &rotation_90_cw, &rot);
 	}
 
+	return rot;
+}
+
+/*!
+ * Fills in one row of the r/g/b images, the rows of all views are numbered
+ * consecutively.
+ */
+static bool
+fill_distortion_image_row(void *ptr, uint32_t index)
+{
+	struct distortion_image_rows *dir = (struct distortion_image_rows *)ptr;
+
+	uint32_t view = index / RENDER_DISTORTION_IMAGE_DIMENSIONS;
+	uint32_t row = index % RENDER_DISTORTION_IMAGE_DIMENSIONS;
+
+	struct texture *r = &dir->textures[view];
+	struct texture *g = &dir->textures[dir->view_count + view];
+	struct texture *b = &dir->textures[2 * dir->view_count + view];
+
+	const double dim_minus_one_f64 = RENDER_DISTORTION_IMAGE_DIMENSIONS - 1;
+
+	// This goes from 0 to 1.0 inclusive.
+	float v = (float)(row / dim_minus_one_f64);
+
+	for (int col = 0; col < RENDER_DISTORTION_IMAGE_DIMENSIONS; col++) {
+		// This goes from 0 to 1.0 inclusive.
+		float u = (float)(col / dim_minus_one_f64);
+
+		// These need to go from -0.5 to 0.5 for the rotation
+		struct xrt_vec2 uv = {u - 0.5f, v - 0.5f};
+		m_mat2x2_transform_vec2(&dir->rot[view], &uv, &uv);
+		uv.x += 0.5f;
+		uv.y += 0.5f;
+
+		struct xrt_uv_triplet result;
+		xrt_device_compute_distortion(dir->xdev, view, uv.x, uv.y, &result);
+
+		r->pixels[row][col] = result.r;
+		g->pixels[row][col] = result.g;
+		b->pixels[row][col] = result.b;
+	}
+
+	return true;
+}
+
+/*!
+ * Returns the distortion images for all views, mapped from the on disk cache
+ * if possible, otherwise computed over several threads and stored.
+ */
+static const struct texture *
+get_distortion_textures(struct xrt_device *xdev,
+                        uint32_t view_count,
+                        bool pre_rotate,
+                        struct u_distortion_cache_blob *out_blob,
+                        struct texture **out_computed)
+{
+	struct distortion_image_params params = {.dimensions = RENDER_DISTORTION_IMAGE_DIMENSIONS};
+	for (uint32_t i = 0; i < view_count; i++) {
+		params.rot[i] = get_view_rotation(xdev, i, pre_rotate);
+	}
+
+	size_t size = sizeof(struct texture) * 3 * view_count;
+	uint64_t key = u_distortion_cache_key(xdev, "image", &params, sizeof(params));
+
+	if (u_distortion_cache_map("image", key, size, out_blob)) {
+		return (const struct texture *)out_blob->data;
+	}
+
+	struct texture *textures = U_TYPED_ARRAY_CALLOC(struct texture, 3 * view_count);
+
+	struct distortion_image_rows dir = {
+	    .xdev = xdev,
+	    .textures = textures,
+	    .view_count = view_count,
+	    .rot = params.rot,
+	};
+
+	u_distortion_run_rows(RENDER_DISTORTION_IMAGE_DIMENSIONS * view_count, fill_distortion_image_row, &dir);
+	u_distortion_cache_store("image", key, textures, size);
+
+	*out_computed = textures;
+
+	return textures;
+}
+
+XRT_CHECK_RESULT static VkResult
+create_and_fill_in_distortion_buffer_for_view(struct vk_bundle *vk,
+                                              struct render_buffer *r_buffer,
+                                              struct render_buffer *g_buffer,
+                                              struct render_buffer *b_buffer,
+                                              const struct texture *r_src,
+                                              const struct texture *g_src,
+                                              const struct texture *b_src)
+{
+	VkBufferUsageFlags usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	VkResult ret;
+
 	VkDeviceSize size = sizeof(struct texture);
 
 	ret = render_buffer_init(vk, r_buffer, usage_flags, properties, size);
@@ -236,34 +352,9 @@ create_and_fill_in_distortion_buffer_for_view(struct vk_bundle *vk,
 	ret = render_buffer_map(vk, b_buffer);
 	VK_CHK_WITH_GOTO(ret, "render_buffer_map", err_buffers);
 
-	struct texture *r = r_buffer->mapped;
-	struct texture *g = g_buffer->mapped;
-	struct texture *b = b_buffer->mapped;
-
-	const double dim_minus_one_f64 = RENDER_DISTORTION_IMAGE_DIMENSIONS - 1;
-
-	for (int row = 0; row < RENDER_DISTORTION_IMAGE_DIMENSIONS; row++) {
-		// This goes from 0 to 1.0 inclusive.
-		float v = (float)(row / dim_minus_one_f64);
-
-		for (int col = 0; col < RENDER_DISTORTION_IMAGE_DIMENSIONS; col++) {
-			// This goes from 0 to 1.0 inclusive.
-			float u = (float)(col / dim_minus_one_f64);
-
-			// These need to go from -0.5 to 0.5 for the rotation
-			struct xrt_vec2 uv = {u - 0.5f, v - 0.5f};
-			m_mat2x2_transform_vec2(&rot, &uv, &uv);
-			uv.x += 0.5f;
-			uv.y += 0.5f;
-
-			struct xrt_uv_triplet result;
-			xrt_device_compute_distortion(xdev, view, uv.x, uv.y, &result);
-
-			r->pixels[row][col] = result.r;
-			g->pixels[row][col] = result.g;
-			b->pixels[row][col] = result.b;
-		}
-	}
+	memcpy(r_buffer->mapped, r_src, size);
+	memcpy(g_buffer->mapped, g_src, size);
+	memcpy(b_buffer->mapped, b_src, size);
 
 	render_buffer_unmap(vk, r_buffer);
 	render_buffer_unmap(vk, g_buffer);
@@ -306,12 +397,30 @@ render_distortion_buffer_init(struct render_resources *r,
 	 * view_count=2,RRGGBB
 	 * view_count=3,RRRGGGBBB
 	 */
+	struct u_distortion_cache_blob blob = {0};
+	struct texture *computed = NULL;
+	const struct texture *textures = get_distortion_textures(xdev, r->view_count, pre_rotate, &blob, &computed);
+
 	for (uint32_t i = 0; i < r->view_count; ++i) {
-		ret = create_and_fill_in_distortion_buffer_for_view(vk, xdev, &bufs[i], &bufs[r->view_count + i],
-		                                                    &bufs[2 * r->view_count + i], i, pre_rotate);
-		VK_CHK_WITH_GOTO(ret, "create_and_fill_in_distortion_buffer_for_view", err_resources);
+		uint32_t g = r->view_count + i;
+		uint32_t b = 2 * r->view_count + i;
+
+		ret = create_and_fill_in_distortion_buffer_for_view( //
+		    vk,                                              // vk_bundle
+		    &bufs[i],                                        // r_buffer
+		    &bufs[g],                                        // g_buffer
+		    &bufs[b],                                        // b_buffer
+		    &textures[i],                                    // r_src
+		    &textures[g],                                    // g_src
+		    &textures[b]);                                   // b_src
+		VK_CHK_WITH_GOTO(ret, "create_and_fill_in_distortion_buffer_for_view", err_textures);
 	}
 
+	// Both are safe to call again on the error paths.
+	u_distortion_cache_unmap(&blob);
+	free(computed);
+	computed = NULL;
+
 	/*
 	 * Command submission.
 	 */
@@ -371,7 +480,10 @@ err_cmd:
 err_unlock:
 	vk_cmd_pool_unlock(pool);
 
-err_resources:
+err_textures:
+	u_distortion_cache_unmap(&blob);
+	free(computed);
+
 	for (uint32_t i = 0; i < RENDER_DISTORTION_IMAGES_COUNT; i++) {
 		D(ImageView, image_views[i]);
 		D(Image, images[i]);
@@ -289,7 +289,11 @@ do_ubo_and_src_alloc_and_write(struct render_gfx *rr,
 }
 
 static inline void
-dispatch_no_vbo(struct render_gfx *rr, uint32_t vertex_count, VkPipeline pipeline, VkDescriptorSet descriptor_set)
+dispatch_no_vbo(struct render_gfx *rr,
+                uint32_t vertex_count,
+                uint32_t instance_count,
+                VkPipeline pipeline,
+                VkDescriptorSet descriptor_set)
 {
 	struct vk_bundle *vk = vk_from_rr(rr);
 	struct render_resources *r = rr->r;
@@ -313,12 +317,12 @@ dispatch_no_vbo(struct render_gfx *rr, uint32_t vertex_count, VkPipeline pipelin
 
 	// This pipeline doesn't have any VBO input or indices.
 
-	vk->vkCmdDraw(    //
-	    r->cmd,       // commandBuffer
-	    vertex_count, // vertexCount
-	    1,            // instanceCount
-	    0,            // firstVertex
-	    0);           // firstInstance
+	vk->vkCmdDraw(      //
+	    r->cmd,         // commandBuffer
+	    vertex_count,   // vertexCount
+	    instance_count, // instanceCount
+	    0,              // firstVertex
+	    0);             // firstInstance
 }
 
 
@@ -1346,6 +1350,7 @@ render_gfx_layer_cylinder(struct render_gfx *rr, bool premultiplied_alpha, VkDes
 	dispatch_no_vbo(     //
 	    rr,              // rr
 	    vertex_count,    // vertex_count
+	    1,               // instance_count
 	    pipeline,        // pipeline
 	    descriptor_set); // descriptor_set
 }
@@ -1362,6 +1367,7 @@ render_gfx_layer_equirect2(struct render_gfx *rr, bool premultiplied_alpha, VkDe
 	dispatch_no_vbo(     //
 	    rr,              // rr
 	    4,               // vertex_count
+	    1,               // instance_count
 	    pipeline,        // pipeline
 	    descriptor_set); // descriptor_set
 }
@@ -1374,10 +1380,11 @@ render_gfx_layer_projection(struct render_gfx *rr, bool premultiplied_alpha, VkD
 	        ? rr->rtr->rgrp->layer.proj_premultiplied_alpha    //
 	        : rr->rtr->rgrp->layer.proj_unpremultiplied_alpha; //
 
-	// Hardcoded to 4 vertices.
+	// Hardcoded to 4 vertices, one instance per multi-resolution region.
 	dispatch_no_vbo(     //
 	    rr,              // rr
 	    4,               // vertex_count
+	    9,               // instance_count
 	    pipeline,        // pipeline
 	    descriptor_set); // descriptor_set
 }
@@ -1394,6 +1401,7 @@ render_gfx_layer_quad(struct render_gfx *rr, bool premultiplied_alpha, VkDescrip
 	dispatch_no_vbo(     //
 	    rr,              // rr
 	    4,               // vertex_count
+	    1,               // instance_count
 	    pipeline,        // pipeline
 	    descriptor_set); // descriptor_set
 }
@@ -13,6 +13,8 @@
 #include "xrt/xrt_compiler.h"
 #include "xrt/xrt_defines.h"
 
+#include "util/u_multires.h"
+
 #include "vk/vk_helpers.h"
 #include "vk/vk_cmd_pool.h"
 
@@ -918,6 +920,9 @@ struct render_gfx_layer_projection_data
 	struct xrt_normalized_rect post_transform;
 	struct xrt_normalized_rect to_tanget;
 	struct xrt_matrix_4x4 mvp;
+
+	//! Multi-resolution layout, identity for uniform layers.
+	struct u_multires_shader_params multires;
 };
 
 /*!
@@ -1214,6 +1219,17 @@ struct render_compute_layer_ubo_data
 		struct xrt_vec2 val;
 		float padding[XRT_MAX_VIEWS];
 	} quad_extent[RENDER_MAX_LAYERS];
+
+
+	/*!
+	 * For multi-resolution projection layers, see @ref u_multires_shader_params.
+	 */
+
+	//! Full resolution region per axis: x0, x1, y0, y1.
+	float multires_bounds[RENDER_MAX_LAYERS][4];
+
+	//! Periphery scale and inverse packed size per axis: sx, sy, 1 / tx, 1 / ty.
+	float multires_scale[RENDER_MAX_LAYERS][4];
 };
 
 /*!
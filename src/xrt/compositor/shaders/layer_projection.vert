@@ -10,6 +10,11 @@ layout (binding = 0, std140) uniform Config
 	vec4 post_transform;
 	vec4 to_tanget;
 	mat4 mvp;
+
+	// full resolution region per axis (x0, x1, y0, y1)
+	vec4 multires_bounds;
+	// periphery scale and inverse packed size per axis (sx, sy, 1 / tx, 1 / ty)
+	vec4 multires_scale;
 } ubo;
 
 layout (location = 0) out vec2 out_uv;
@@ -26,10 +31,34 @@ vec2 pos[4] = {
 	vec2(1, 1),
 };
 
+vec2 multires_to_packed(vec2 uv)
+{
+	vec2 lo = ubo.multires_bounds.xz;
+	vec2 hi = ubo.multires_bounds.yw;
+	vec2 scale = ubo.multires_scale.xy;
+	vec2 inv_size = ubo.multires_scale.zw;
+
+	// Full resolution in the center, scaled down periphery on either side.
+	vec2 mapped = scale * min(uv, lo) + (clamp(uv, lo, hi) - lo) + scale * max(uv - hi, 0.0);
+
+	// Identity for uniform layers, bounds are [0, 1] and scale is one.
+	return mapped * inv_size;
+}
+
 void main()
 {
+	// The layer is drawn as a three by three grid of quads, one per instance,
+	// split where the multi-resolution mapping changes so it is linear over
+	// each quad. For uniform layers all but the center quad are empty.
+	float grid_x[4] = {0.0, ubo.multires_bounds.x, ubo.multires_bounds.y, 1.0};
+	float grid_y[4] = {0.0, ubo.multires_bounds.z, ubo.multires_bounds.w, 1.0};
+	int cell_x = gl_InstanceIndex % 3;
+	int cell_y = gl_InstanceIndex / 3;
+
 	// We now get a unmodified UV position.
-	vec2 in_uv = pos[gl_VertexIndex % 4];
+	vec2 corner = pos[gl_VertexIndex % 4];
+	vec2 in_uv = vec2(mix(grid_x[cell_x], grid_x[cell_x + 1], corner.x),
+	                  mix(grid_y[cell_y], grid_y[cell_y + 1], corner.y));
 
 	// Turn the UV into tanget angle space.
 	vec2 pos = fma(in_uv, ubo.to_tanget.zw, ubo.to_tanget.xy);
@@ -41,8 +70,11 @@ void main()
 	// origin of the projection layer into the view of the new position.
 	vec4 position = ubo.mvp * vec4(pos, -1.0f, 1.0f);
 
+	// From view to the packed multi-resolution image.
+	vec2 uv = multires_to_packed(in_uv);
+
 	// To deal with OpenGL flip and sub image view.
-	vec2 uv = fma(in_uv, ubo.post_transform.zw, ubo.post_transform.xy);
+	uv = fma(uv, ubo.post_transform.zw, ubo.post_transform.xy);
 
 	gl_Position = position;
 	out_uv = uv;
@@ -17,6 +17,7 @@
 #include "math/m_mathinclude.h"
 
 #include "util/u_misc.h"
+#include "util/u_multires.h"
 #include "util/u_trace_marker.h"
 
 #include "vk/vk_helpers.h"
@@ -147,6 +148,14 @@ do_cs_projection_layer(const struct xrt_layer_data *data,
 	    false,                                  // invert_flip
 	    &ubo_data->post_transforms[cur_layer]); // out_norm_rect
 
+	// Where the view is packed at reduced resolution, identity if uniform.
+	struct u_multires_shader_params multires;
+	u_multires_get_shader_params(&vd->multires, &multires);
+	for (uint32_t i = 0; i < 4; i++) {
+		ubo_data->multires_bounds[cur_layer][i] = multires.bounds[i];
+		ubo_data->multires_scale[cur_layer][i] = multires.scale[i];
+	}
+
 	// unused if timewarp is off
 	if (do_timewarp) {
 		render_calc_time_warp_matrix(          //
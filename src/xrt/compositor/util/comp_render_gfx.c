@@ -13,6 +13,7 @@
 #include "math/m_mathinclude.h"
 
 #include "util/u_misc.h"
+#include "util/u_multires.h"
 #include "util/u_trace_marker.h"
 
 #include "vk/vk_helpers.h"
@@ -397,6 +398,9 @@ do_projection_layer(struct render_gfx *rr,
 	struct xrt_vec3 scale = {1, 1, 1};
 	calc_mvp_rot_only(state, layer_data, &vd->pose, &scale, &data.mvp);
 
+	// Where the view is packed at reduced resolution, identity if uniform.
+	u_multires_get_shader_params(&vd->multires, &data.multires);
+
 	// Can fail if we have too many layers.
 	VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
 	ret = render_gfx_layer_projection_alloc_and_write( //
@@ -200,6 +200,18 @@ android_device_compute_distortion(
 	return u_compute_distortion_cardboard(&d->cardboard.values[view], u, v, result);
 }
 
+static bool
+android_device_compute_distortion_batch(struct xrt_device *xdev,
+                                        uint32_t view,
+                                        const float *u,
+                                        const float *v,
+                                        uint32_t count,
+                                        struct u_uv_triplet_batch *out)
+{
+	struct android_device *d = android_device(xdev);
+	return u_compute_distortion_cardboard_batch(&d->cardboard.values[view], u, v, count, out);
+}
+
 
 struct android_device *
 android_device_create()
@@ -292,7 +304,7 @@ android_device_create()
 	d->base.position_tracking_supported = false;
 
 	// Distortion information.
-	u_distortion_mesh_fill_in_compute(&d->base);
+	u_distortion_mesh_fill_in_batch(&d->base, android_device_compute_distortion_batch);
 
 	ANDROID_DEBUG(d, "Created device!");
 
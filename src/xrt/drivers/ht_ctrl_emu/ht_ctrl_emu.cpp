@@ -329,7 +329,7 @@ cemu_device_get_tracked_pose(struct xrt_device *xdev,
 		CEMU_ERROR(dev, "unknown input name %d for controller pose", name);
 		return;
 	}
-	static uint64_t hand_timestamp_ns;
+	uint64_t hand_timestamp_ns = 0;
 
 	struct xrt_hand_joint_set joint_set;
 	sys->in_hand->get_hand_tracking(sys->in_hand, dev->ht_input_name, at_timestamp_ns, &joint_set,
@@ -348,8 +348,8 @@ cemu_device_get_tracked_pose(struct xrt_device *xdev,
 		break;
 	}
 	case XRT_INPUT_SIMPLE_AIM_POSE: {
-		// Assume that now we're doing everything in the timestamp from the hand-tracker, so use
-		// hand_timestamp_ns. This will cause the controller to lag behind but otherwise be correct
+		// The hand-tracker gives the joints at hand_timestamp_ns, which it may have moved from the time
+		// asked for, so get the other hand at the same time for the two to line up.
 		do_aim_pose(dev, &joint_set, at_timestamp_ns, hand_timestamp_ns, out_relation);
 		break;
 	}
@@ -446,6 +446,18 @@ ns_mesh_calc(struct xrt_device *xdev, uint32_t view, float u, float v, struct xr
 	}
 }
 
+static bool
+ns_mesh_calc_p2d_batch(struct xrt_device *xdev,
+                       uint32_t view,
+                       const float *u,
+                       const float *v,
+                       uint32_t count,
+                       struct u_uv_triplet_batch *out)
+{
+	struct ns_hmd *ns = ns_hmd(xdev);
+	return u_compute_distortion_ns_p2d_batch(&ns->config.dist_p2d, view, u, v, count, out);
+}
+
 /*
  *
  * Create function.
@@ -531,7 +543,11 @@ ns_hmd_create(const cJSON *config_json)
 	uint64_t end;
 
 	start = os_monotonic_get_ns();
-	u_distortion_mesh_fill_in_compute(&ns->base);
+	if (ns->config.distortion_type == NS_DISTORTION_TYPE_POLYNOMIAL_2D) {
+		u_distortion_mesh_fill_in_batch(&ns->base, ns_mesh_calc_p2d_batch);
+	} else {
+		u_distortion_mesh_fill_in_compute(&ns->base);
+	}
 	end = os_monotonic_get_ns();
 
 	float diff = (end - start);
@@ -109,26 +109,14 @@ r_device_get_tracked_pose(struct xrt_device *xdev,
 	}
 
 	struct r_remote_controller_data *latest = rd->is_left ? &r->latest.left : &r->latest.right;
+	enum r_hub_history history = rd->is_left ? R_HUB_HISTORY_LEFT : R_HUB_HISTORY_RIGHT;
 
-	/*
-	 * It's easier to reason about angular velocity if it's controlled in
-	 * body space, but the angular velocity returned in the relation is in
-	 * the base space.
-	 */
-	math_quat_rotate_derivative(&latest->pose.orientation, &latest->angular_velocity,
-	                            &out_relation->angular_velocity);
-
-	out_relation->pose = latest->pose;
-	out_relation->linear_velocity = latest->linear_velocity;
-
-	if (latest->active) {
-		out_relation->relation_flags = (enum xrt_space_relation_flags)(
-		    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_POSITION_VALID_BIT |
-		    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT | XRT_SPACE_RELATION_POSITION_TRACKED_BIT |
-		    XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT | XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT);
-	} else {
-		out_relation->relation_flags = 0;
+	// Interpolated from the received samples, the latest data if there are none.
+	if (latest->active && r_hub_get_relation(r, history, at_timestamp_ns, out_relation)) {
+		return;
 	}
+
+	r_hub_controller_to_relation(latest, out_relation);
 }
 
 static void
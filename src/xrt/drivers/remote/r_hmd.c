@@ -36,8 +36,12 @@ r_hmd(struct xrt_device *xdev)
 }
 
 static inline void
-copy_head_center_to_relation(struct r_hmd *rh, struct xrt_space_relation *out_relation)
+get_head_center_relation(struct r_hmd *rh, uint64_t at_timestamp_ns, struct xrt_space_relation *out_relation)
 {
+	if (r_hub_get_relation(rh->r, R_HUB_HISTORY_HEAD, at_timestamp_ns, out_relation)) {
+		return;
+	}
+
 	out_relation->pose = rh->r->latest.head.center;
 	out_relation->relation_flags = (enum xrt_space_relation_flags)(
 	    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_POSITION_VALID_BIT |
@@ -65,7 +69,7 @@ r_hmd_get_tracked_pose(struct xrt_device *xdev,
 	struct r_hmd *rh = r_hmd(xdev);
 
 	switch (name) {
-	case XRT_INPUT_GENERIC_HEAD_POSE: copy_head_center_to_relation(rh, out_relation); break;
+	case XRT_INPUT_GENERIC_HEAD_POSE: get_head_center_relation(rh, at_timestamp_ns, out_relation); break;
 	case XRT_INPUT_GENERIC_STAGE_SPACE_POSE:
 		// STAGE is implicitly defined as the space poses are returned in, therefore STAGE origin is (0, 0, 0).
 		*out_relation = (struct xrt_space_relation)XRT_SPACE_RELATION_ZERO;
@@ -116,7 +120,7 @@ r_hmd_get_view_poses(struct xrt_device *xdev,
 		return;
 	}
 
-	copy_head_center_to_relation(rh, out_head_relation);
+	get_head_center_relation(rh, at_timestamp_ns, out_head_relation);
 
 	for (uint32_t i = 0; i < view_count; i++) {
 		out_poses[i] = rh->r->latest.head.views[i].pose;
@@ -9,6 +9,10 @@
 
 #include "r_internal.h"
 
+#include "os/os_time.h"
+
+#include "math/m_api.h"
+
 #include "util/u_var.h"
 #include "util/u_misc.h"
 #include "util/u_debug.h"
@@ -17,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <assert.h>
 
 #if defined(XRT_OS_WINDOWS)
 #include <winsock2.h>
@@ -57,6 +62,7 @@
  */
 
 DEBUG_GET_ONCE_LOG_OPTION(remote_log, "REMOTE_LOG", U_LOGGING_INFO)
+DEBUG_GET_ONCE_BOOL_OPTION(remote_udp, "REMOTE_UDP", false)
 
 #define R_TRACE(R, ...) U_LOG_IFL_T((R)->rc.log_level, __VA_ARGS__)
 #define R_DEBUG(R, ...) U_LOG_IFL_D((R)->rc.log_level, __VA_ARGS__)
@@ -109,6 +115,26 @@ socket_write(r_socket_t id, void *ptr, size_t size, size_t current)
 	return send(id, (const char *)ptr, (int)(size - current), 0);
 }
 
+static inline r_socket_t
+socket_create_udp(void)
+{
+	return socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+}
+
+static inline int
+socket_set_nodelay(r_socket_t id)
+{
+	int flag = 1;
+	return setsockopt(id, IPPROTO_TCP, TCP_NODELAY, (const char *)&flag, sizeof(flag));
+}
+
+static inline ssize_t
+socket_read_from(r_socket_t id, void *ptr, size_t size, struct sockaddr_in *out_addr)
+{
+	int addr_length = (int)sizeof(*out_addr);
+	return recvfrom(id, (char *)ptr, (int)size, 0, (struct sockaddr *)out_addr, &addr_length);
+}
+
 #elif defined(XRT_OS_UNIX)
 
 static inline void
@@ -141,6 +167,26 @@ socket_write(r_socket_t id, void *ptr, size_t size, size_t current)
 	return write(id, ptr, size - current);
 }
 
+static inline r_socket_t
+socket_create_udp(void)
+{
+	return socket(AF_INET, SOCK_DGRAM, 0);
+}
+
+static inline int
+socket_set_nodelay(r_socket_t id)
+{
+	int flag = 1;
+	return setsockopt(id, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+static inline ssize_t
+socket_read_from(r_socket_t id, void *ptr, size_t size, struct sockaddr_in *out_addr)
+{
+	socklen_t addr_length = (socklen_t)sizeof(*out_addr);
+	return recvfrom(id, ptr, size, 0, (struct sockaddr *)out_addr, &addr_length);
+}
+
 #endif // XRT_OS_UNIX
 
 
@@ -197,6 +243,14 @@ setup_accept_fd(struct r_hub *r)
 
 	listen(r->accept_fd, 5);
 
+	// Optional, clients fall back to streaming over the connection.
+	r->udp_fd = socket_create_udp();
+	if (r->udp_fd >= 0 && bind(r->udp_fd, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
+		R_WARN(r, "Failed to bind UDP port %d, only TCP available", r->port);
+		socket_close(r->udp_fd);
+		r->udp_fd = -1;
+	}
+
 	return 0;
 cleanup:
 #if defined(XRT_OS_WINDOWS)
@@ -264,23 +318,62 @@ do_accept(struct r_hub *r)
 		return ret;
 	}
 
+	ret = socket_set_nodelay(conn_fd);
+	if (ret < 0) {
+		R_WARN(r, "Failed to disable Nagle: " R_SOCKET_FMT, ret);
+	}
+
 	r->rc.fd = conn_fd;
+	r->peer_addr = addr.sin_addr.s_addr;
 
 	R_INFO(r, "Connection received! " R_SOCKET_FMT, r->rc.fd);
 
 	return 0;
 }
 
+static r_socket_t
+wait_for_packet(struct r_hub *r)
+{
+	struct r_remote_connection *rc = &r->rc;
+
+	while (os_thread_helper_is_running(&r->oth)) {
+		// Select can modify timeout, reset each loop.
+		struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+		r_socket_t max_fd = rc->fd;
+		fd_set set;
+
+		// Reset each loop.
+		FD_ZERO(&set);
+		FD_SET(rc->fd, &set);
+		if (r->udp_fd >= 0) {
+			FD_SET(r->udp_fd, &set);
+			max_fd = MAX(max_fd, r->udp_fd);
+		}
+
+		int ret = select((int)max_fd + 1, &set, NULL, NULL, &timeout);
+		if (ret < 0) {
+			R_ERROR(r, "select: %i", ret);
+			return -1;
+		} else if (ret == 0) {
+			continue;
+		}
+
+		// The stream first, it also tells us about disconnects.
+		return FD_ISSET(rc->fd, &set) ? rc->fd : r->udp_fd;
+	}
+
+	return -1;
+}
+
 static ssize_t
-read_one(struct r_hub *r, struct r_remote_data *data)
+read_exact(struct r_hub *r, uint8_t *data, size_t size)
 {
 	struct r_remote_connection *rc = &r->rc;
 
-	const size_t size = sizeof(*data);
 	size_t current = 0;
 
 	while (current < size) {
-		void *ptr = (uint8_t *)data + current;
+		void *ptr = data + current;
 
 		if (!wait_for_read_and_to_continue(r, rc->fd)) {
 			return -1;
@@ -305,10 +398,90 @@ read_one(struct r_hub *r, struct r_remote_data *data)
 	return 0;
 }
 
+static ssize_t
+read_stream_packet(struct r_hub *r, uint8_t *buffer)
+{
+	struct r_protocol_header header;
+
+	if (read_exact(r, buffer, R_PROTOCOL_HEADER_SIZE) < 0) {
+		return -1;
+	}
+
+	if (!r_protocol_parse_header(buffer, R_PROTOCOL_HEADER_SIZE, &header)) {
+		R_ERROR(r, "Bad packet header, protocol version %u expected", R_PROTOCOL_VERSION);
+		return -1;
+	}
+
+	if (read_exact(r, buffer + R_PROTOCOL_HEADER_SIZE, header.payload_size) < 0) {
+		return -1;
+	}
+
+	return R_PROTOCOL_HEADER_SIZE + (ssize_t)header.payload_size;
+}
+
+static ssize_t
+read_datagram_packet(struct r_hub *r, uint8_t *buffer)
+{
+	struct sockaddr_in addr = {0};
+
+	ssize_t ret = socket_read_from(r->udp_fd, buffer, R_PROTOCOL_MAX_PACKET_SIZE, &addr);
+	if (ret < 0) {
+		R_WARN(r, "recvfrom: %zi", ret);
+		return 0;
+	}
+
+	if (addr.sin_addr.s_addr != r->peer_addr) {
+		R_TRACE(r, "Dropping datagram from %s", inet_ntoa(addr.sin_addr));
+		return 0;
+	}
+
+	return ret;
+}
+
+static void
+push_relations(struct r_hub *r, const struct r_remote_data *data, timepoint_ns timestamp_ns)
+{
+	struct xrt_space_relation head = XRT_SPACE_RELATION_ZERO;
+	head.pose = data->head.center;
+	head.relation_flags = (enum xrt_space_relation_flags)(
+	    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_POSITION_VALID_BIT |
+	    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT | XRT_SPACE_RELATION_POSITION_TRACKED_BIT);
+	m_relation_history_push(r->history[R_HUB_HISTORY_HEAD], &head, timestamp_ns);
+
+	const struct r_remote_controller_data *controllers[2] = {&data->left, &data->right};
+	const enum r_hub_history histories[2] = {R_HUB_HISTORY_LEFT, R_HUB_HISTORY_RIGHT};
+
+	for (uint32_t i = 0; i < 2; i++) {
+		if (!controllers[i]->active) {
+			continue;
+		}
+
+		struct xrt_space_relation relation;
+		r_hub_controller_to_relation(controllers[i], &relation);
+		m_relation_history_push(r->history[histories[i]], &relation, timestamp_ns);
+	}
+}
+
+static void
+handle_sample(void *ptr, const struct r_remote_data *data, int64_t timestamp_ns)
+{
+	struct r_hub *r = (struct r_hub *)ptr;
+
+	timepoint_ns now_ns = (timepoint_ns)os_monotonic_get_ns();
+	timepoint_ns mapped_ns = m_clock_sync_update(&r->clock, timestamp_ns, now_ns);
+
+	r->latest = *data;
+	push_relations(r, data, mapped_ns);
+
+	r->stats.samples++;
+	r->stats.latency_ns = now_ns - mapped_ns;
+}
+
 static void *
 run_thread(void *ptr)
 {
 	struct r_hub *r = (struct r_hub *)ptr;
+	uint8_t buffer[R_PROTOCOL_MAX_PACKET_SIZE];
 	r_socket_t ret;
 
 	ret = setup_accept_fd(r);
@@ -326,19 +499,48 @@ run_thread(void *ptr)
 			return NULL;
 		}
 
+		// Fresh protocol and clock state for every client.
+		r_protocol_writer_init(&r->rc.writer);
+		r_protocol_reader_init(&r->rc.reader);
+		m_clock_sync_init(&r->clock, 0);
+		for (uint32_t i = 0; i < ARRAY_SIZE(r->history); i++) {
+			m_relation_history_clear(r->history[i]);
+		}
+
 		r_remote_connection_write_one(&r->rc, &r->reset);
 		r_remote_connection_write_one(&r->rc, &r->latest);
 
 		while (true) {
-			struct r_remote_data data;
+			r_socket_t fd = wait_for_packet(r);
+			if (fd < 0) {
+				break;
+			}
 
-			ret = read_one(r, &data);
-			if (ret < 0) {
+			bool is_stream = fd == r->rc.fd;
+			ssize_t size = is_stream ? read_stream_packet(r, buffer) : read_datagram_packet(r, buffer);
+			if (size < 0) {
 				break;
+			} else if (size == 0) {
+				continue;
 			}
 
-			r->latest = data;
+			int count = r_protocol_reader_decode(&r->rc.reader, buffer, (size_t)size, handle_sample, r);
+			if (count < 0) {
+				R_ERROR(r, "Malformed packet of %zi bytes", size);
+				if (is_stream) {
+					// Framing is lost, can't recover.
+					break;
+				}
+				continue;
+			}
+
+			r->stats.packets++;
+			r->stats.bytes += (uint64_t)size;
+			r->stats.lost_packets = r->rc.reader.lost_packets;
 		}
+
+		socket_close(r->rc.fd);
+		r->rc.fd = -1;
 	}
 
 	R_INFO(r, "Leaving thread");
@@ -387,6 +589,15 @@ r_hub_system_devices_destroy(struct xrt_system_devices *xsysd)
 		r->rc.fd = -1;
 	}
 
+	if (r->udp_fd >= 0) {
+		socket_close(r->udp_fd);
+		r->udp_fd = -1;
+	}
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(r->history); i++) {
+		m_relation_history_destroy(&r->history[i]);
+	}
+
 	free(r);
 
 #if defined(XRT_OS_WINDOWS)
@@ -396,6 +607,48 @@ r_hub_system_devices_destroy(struct xrt_system_devices *xsysd)
 }
 
 
+/*
+ *
+ * 'Exported' hub functions.
+ *
+ */
+
+void
+r_hub_controller_to_relation(const struct r_remote_controller_data *c, struct xrt_space_relation *out_relation)
+{
+	/*
+	 * It's easier to reason about angular velocity if it's controlled in
+	 * body space, but the angular velocity returned in the relation is in
+	 * the base space.
+	 */
+	math_quat_rotate_derivative(&c->pose.orientation, &c->angular_velocity, &out_relation->angular_velocity);
+
+	out_relation->pose = c->pose;
+	out_relation->linear_velocity = c->linear_velocity;
+
+	if (c->active) {
+		out_relation->relation_flags = (enum xrt_space_relation_flags)(
+		    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_POSITION_VALID_BIT |
+		    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT | XRT_SPACE_RELATION_POSITION_TRACKED_BIT |
+		    XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT | XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT);
+	} else {
+		out_relation->relation_flags = 0;
+	}
+}
+
+bool
+r_hub_get_relation(struct r_hub *r,
+                   enum r_hub_history history,
+                   uint64_t at_timestamp_ns,
+                   struct xrt_space_relation *out_relation)
+{
+	enum m_relation_history_result result =
+	    m_relation_history_get(r->history[history], at_timestamp_ns, out_relation);
+
+	return result != M_RELATION_HISTORY_RESULT_INVALID;
+}
+
+
 /*
  *
  * 'Exported' create function.
@@ -439,7 +692,14 @@ r_create_devices(uint16_t port,
 	r->port = port;
 	r->view_count = view_count;
 	r->accept_fd = -1;
+	r->udp_fd = -1;
 	r->rc.fd = -1;
+	r->rc.udp_fd = -1;
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(r->history); i++) {
+		m_relation_history_create(&r->history[i]);
+	}
+	m_clock_sync_init(&r->clock, 0);
 
 	snprintf(r->origin.name, sizeof(r->origin.name), "Remote Simulator");
 
@@ -525,6 +785,11 @@ r_create_devices(uint16_t port,
 	// u_var_add_gui_header(r, &r->gui.right, "Right");
 	u_var_add_bool(r, &r->latest.right.active, "right.active");
 	u_var_add_pose(r, &r->latest.right.pose, "right.pose");
+	u_var_add_ro_u64(r, &r->stats.packets, "Packets");
+	u_var_add_ro_u64(r, &r->stats.samples, "Samples");
+	u_var_add_ro_u64(r, &r->stats.bytes, "Bytes");
+	u_var_add_ro_u64(r, &r->stats.lost_packets, "Lost packets");
+	u_var_add_ro_i64(r, &r->stats.latency_ns, "Latency (ns)");
 
 	/*
 	 * Done now.
@@ -553,6 +818,9 @@ r_remote_connection_init(struct r_remote_connection *rc, const char *ip_addr, ui
 
 	// Set log level.
 	rc->log_level = debug_get_log_option_remote_log();
+	rc->udp_fd = -1;
+	r_protocol_writer_init(&rc->writer);
+	r_protocol_reader_init(&rc->reader);
 
 #if defined(XRT_OS_WINDOWS)
 	// Initialize Winsock.
@@ -617,6 +885,23 @@ r_remote_connection_init(struct r_remote_connection *rc, const char *ip_addr, ui
 		goto cleanup;
 	}
 
+	ret = socket_set_nodelay(conn_fd);
+	if (ret < 0) {
+		RC_WARN(rc, "Failed to disable Nagle: %i", ret);
+	}
+
+	if (debug_get_bool_option_remote_udp()) {
+		r_socket_t udp_fd = socket_create_udp();
+		if (udp_fd < 0 || connect(udp_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+			RC_WARN(rc, "Failed to set up UDP, streaming over TCP");
+			if (udp_fd >= 0) {
+				socket_close(udp_fd);
+			}
+		} else {
+			rc->udp_fd = udp_fd;
+		}
+	}
+
 	rc->fd = conn_fd;
 
 	return 0;
@@ -628,18 +913,17 @@ cleanup:
 	return ret;
 }
 
-int
-r_remote_connection_read_one(struct r_remote_connection *rc, struct r_remote_data *data)
+static int
+connection_read_exact(struct r_remote_connection *rc, uint8_t *data, size_t size)
 {
-	const size_t size = sizeof(*data);
 	size_t current = 0;
 
 	while (current < size) {
-		void *ptr = (uint8_t *)data + current;
+		void *ptr = data + current;
 		ssize_t ret = socket_read(rc->fd, ptr, size, current);
 		if (ret < 0) {
 			RC_ERROR(rc, "read: %zi", ret);
-			return ret;
+			return (int)ret;
 		}
 		if (ret > 0) {
 			current += (size_t)ret;
@@ -652,10 +936,9 @@ r_remote_connection_read_one(struct r_remote_connection *rc, struct r_remote_dat
 	return 0;
 }
 
-int
-r_remote_connection_write_one(struct r_remote_connection *rc, const struct r_remote_data *data)
+static int
+connection_write_all(struct r_remote_connection *rc, const uint8_t *data, size_t size)
 {
-	const size_t size = sizeof(*data);
 	size_t current = 0;
 
 	while (current < size) {
@@ -664,7 +947,7 @@ r_remote_connection_write_one(struct r_remote_connection *rc, const struct r_rem
 		ssize_t ret = socket_write(rc->fd, ptr, size, current);
 		if (ret < 0) {
 			RC_ERROR(rc, "write: %zi", ret);
-			return ret;
+			return (int)ret;
 		}
 		if (ret > 0) {
 			current += (size_t)ret;
@@ -676,3 +959,90 @@ r_remote_connection_write_one(struct r_remote_connection *rc, const struct r_rem
 
 	return 0;
 }
+
+int
+r_remote_connection_read_one(struct r_remote_connection *rc, struct r_remote_data *data)
+{
+	uint8_t buffer[R_PROTOCOL_MAX_PACKET_SIZE];
+	struct r_protocol_header header;
+
+	int ret = connection_read_exact(rc, buffer, R_PROTOCOL_HEADER_SIZE);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (!r_protocol_parse_header(buffer, R_PROTOCOL_HEADER_SIZE, &header)) {
+		RC_ERROR(rc, "Bad packet header, protocol version %u expected", R_PROTOCOL_VERSION);
+		return -1;
+	}
+
+	ret = connection_read_exact(rc, buffer + R_PROTOCOL_HEADER_SIZE, header.payload_size);
+	if (ret < 0) {
+		return ret;
+	}
+
+	size_t size = R_PROTOCOL_HEADER_SIZE + header.payload_size;
+	if (r_protocol_reader_decode(&rc->reader, buffer, size, NULL, NULL) <= 0) {
+		RC_ERROR(rc, "Malformed packet");
+		return -1;
+	}
+
+	*data = rc->reader.state;
+
+	return 0;
+}
+
+int
+r_remote_connection_write_one(struct r_remote_connection *rc, const struct r_remote_data *data)
+{
+	int ret = r_remote_connection_write_sample(rc, data, (int64_t)os_monotonic_get_ns());
+	if (ret < 0) {
+		return ret;
+	}
+
+	return r_remote_connection_flush(rc);
+}
+
+int
+r_remote_connection_write_sample(struct r_remote_connection *rc,
+                                 const struct r_remote_data *data,
+                                 int64_t timestamp_ns)
+{
+	if (r_protocol_writer_add(&rc->writer, data, timestamp_ns)) {
+		return 0;
+	}
+
+	// Packet is full, send it and start a new one.
+	int ret = r_remote_connection_flush(rc);
+	if (ret < 0) {
+		return ret;
+	}
+
+	bool added = r_protocol_writer_add(&rc->writer, data, timestamp_ns);
+	assert(added);
+	(void)added;
+
+	return 0;
+}
+
+int
+r_remote_connection_flush(struct r_remote_connection *rc)
+{
+	const uint8_t *data = NULL;
+	size_t size = r_protocol_writer_finish(&rc->writer, &data);
+	if (size == 0) {
+		return 0;
+	}
+
+	if (rc->udp_fd < 0) {
+		return connection_write_all(rc, data, size);
+	}
+
+	ssize_t ret = socket_write(rc->udp_fd, (void *)data, size, 0);
+	if (ret != (ssize_t)size) {
+		RC_ERROR(rc, "send: %zi", ret);
+		return -1;
+	}
+
+	return 0;
+}
@@ -23,6 +23,8 @@
 #include "xrt/xrt_defines.h"
 #include "util/u_logging.h"
 
+#include "r_protocol.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -61,89 +63,6 @@ typedef SOCKET r_socket_t;
 typedef int r_socket_t;
 #endif
 
-/*!
- * Header value to be set in the packet.
- *
- * @ingroup drv_remote
- */
-#define R_HEADER_VALUE (*(uint64_t *)"mndrmt3\0")
-
-/*!
- * Data per controller.
- */
-struct r_remote_controller_data
-{
-	struct xrt_pose pose;
-	struct xrt_vec3 linear_velocity;
-	struct xrt_vec3 angular_velocity;
-
-	float hand_curl[5];
-
-	struct xrt_vec1 trigger_value;
-	struct xrt_vec1 squeeze_value;
-	struct xrt_vec1 squeeze_force;
-	struct xrt_vec2 thumbstick;
-	struct xrt_vec1 trackpad_force;
-	struct xrt_vec2 trackpad;
-
-	bool hand_tracking_active;
-	bool active;
-
-	bool system_click;
-	bool system_touch;
-	bool a_click;
-	bool a_touch;
-	bool b_click;
-	bool b_touch;
-	bool trigger_click;
-	bool trigger_touch;
-	bool thumbstick_click;
-	bool thumbstick_touch;
-	bool trackpad_touch;
-	bool _pad0;
-	bool _pad1;
-	bool _pad2;
-	// active(2) + bools(11) + pad(3) = 16
-};
-
-struct r_head_data
-{
-	struct
-	{
-		//! The field of view values of this view.
-		struct xrt_fov fov;
-
-		//! The pose of this view relative to @ref r_head_data::center.
-		struct xrt_pose pose;
-
-		//! Padded to fov(16) + pose(16 + 12) + 4 = 48
-		uint32_t _pad;
-	} views[2];
-
-	//! The center of the head, in OpenXR terms the view space.
-	struct xrt_pose center;
-
-	//! Is the per view data valid and should be used?
-	bool per_view_data_valid;
-
-	//! pose(16 + 12) bool(1) + pad(3) = 32.
-	bool _pad0, _pad1, _pad2;
-};
-
-/*!
- * Remote data sent from the debugger to the hub.
- *
- * @ingroup drv_remote
- */
-struct r_remote_data
-{
-	uint64_t header;
-
-	struct r_head_data head;
-
-	struct r_remote_controller_data left, right;
-};
-
 /*!
  * Shared connection.
  *
@@ -156,6 +75,15 @@ struct r_remote_connection
 
 	//! Socket.
 	r_socket_t fd;
+
+	//! Connected UDP socket samples are sent on instead of @ref fd, if valid.
+	r_socket_t udp_fd;
+
+	//! Packs outgoing samples.
+	struct r_protocol_writer writer;
+
+	//! Decodes incoming packets, holds the latest received state.
+	struct r_protocol_reader reader;
 };
 
 /*!
@@ -171,19 +99,49 @@ r_create_devices(uint16_t port,
                  struct xrt_space_overseer **out_xso);
 
 /*!
- * Initializes and connects the connection.
+ * Initializes and connects the connection, samples are streamed over UDP to
+ * the same port if the REMOTE_UDP environment variable is set.
  *
  * @ingroup drv_remote
  */
 r_socket_t
 r_remote_connection_init(struct r_remote_connection *rc, const char *addr, uint16_t port);
 
+/*!
+ * Reads one packet from the stream socket and returns the newest sample in it.
+ *
+ * @ingroup drv_remote
+ */
 int
 r_remote_connection_read_one(struct r_remote_connection *rc, struct r_remote_data *data);
 
+/*!
+ * Sends @p data as a single sample packet, timestamped with the current time.
+ *
+ * @ingroup drv_remote
+ */
 int
 r_remote_connection_write_one(struct r_remote_connection *rc, const struct r_remote_data *data);
 
+/*!
+ * Queues a sample, the packet is sent once it is full or on
+ * @ref r_remote_connection_flush.
+ *
+ * @ingroup drv_remote
+ */
+int
+r_remote_connection_write_sample(struct r_remote_connection *rc,
+                                 const struct r_remote_data *data,
+                                 int64_t timestamp_ns);
+
+/*!
+ * Sends any queued samples.
+ *
+ * @ingroup drv_remote
+ */
+int
+r_remote_connection_flush(struct r_remote_connection *rc);
+
 
 #ifdef __cplusplus
 }
@@ -17,6 +17,9 @@
 
 #include "os/os_threading.h"
 
+#include "math/m_clock_sync.h"
+#include "math/m_relation_history.h"
+
 #include "util/u_hand_tracking.h"
 
 
@@ -24,6 +27,18 @@
 extern "C" {
 #endif
 
+/*!
+ * Which history a pose is recorded in.
+ *
+ * @ingroup drv_remote
+ */
+enum r_hub_history
+{
+	R_HUB_HISTORY_HEAD,
+	R_HUB_HISTORY_LEFT,
+	R_HUB_HISTORY_RIGHT,
+};
+
 /*!
  * Central object remote object.
  *
@@ -49,6 +64,27 @@ struct r_hub
 	//! Incoming connection socket.
 	r_socket_t accept_fd;
 
+	//! Datagram socket on the same port, for clients streaming over UDP.
+	r_socket_t udp_fd;
+
+	//! Address of the connected client, datagrams from anybody else are dropped.
+	uint32_t peer_addr;
+
+	//! Maps the sender timestamps of samples to our monotonic clock.
+	struct m_clock_sync clock;
+
+	//! Received poses, indexed by @ref r_hub_history.
+	struct m_relation_history *history[3];
+
+	struct
+	{
+		uint64_t packets;
+		uint64_t samples;
+		uint64_t bytes;
+		uint64_t lost_packets;
+		int64_t latency_ns;
+	} stats;
+
 	uint16_t port;
 	uint32_t view_count;
 
@@ -95,6 +131,27 @@ struct r_device
 };
 
 
+/*!
+ * Build a relation from the controller data, rotating the angular velocity
+ * from body space into the base space.
+ *
+ * @public @memberof r_hub
+ */
+void
+r_hub_controller_to_relation(const struct r_remote_controller_data *c, struct xrt_space_relation *out_relation);
+
+/*!
+ * Interpolate the received poses to @p at_timestamp_ns, returns false if
+ * nothing has been received yet.
+ *
+ * @public @memberof r_hub
+ */
+bool
+r_hub_get_relation(struct r_hub *r,
+                   enum r_hub_history history,
+                   uint64_t at_timestamp_ns,
+                   struct xrt_space_relation *out_relation);
+
 struct xrt_device *
 r_hmd_create(struct r_hub *r);
 
@@ -0,0 +1,599 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Framed wire protocol of the remote driver.
+ * @ingroup drv_remote
+ */
+
+#include "r_protocol.h"
+
+#include "math/m_api.h"
+#include "math/m_mathinclude.h"
+
+#include "util/u_misc.h"
+
+#include <string.h>
+#include <assert.h>
+
+
+//! Positions are sent in micrometers.
+#define POSITION_SCALE (1000000.0f)
+
+//! The three smallest components of a unit quaternion are within this.
+#define QUAT_COMPONENT_MAX (0.70710678f)
+
+#define SAMPLE_HEADER_SIZE (8 + 2)
+#define POSE_SIZE (3 * 4 + 1 + 3 * 2)
+#define VIEWS_SIZE (1 + 2 * 11 * 4)
+#define VELOCITY_SIZE (6 * 4)
+#define ANALOG_COUNT (13)
+#define ANALOG_SIZE (ANALOG_COUNT * 2)
+#define FLAG_COUNT (13)
+#define FLAGS_SIZE (2)
+
+#define MAX_SAMPLE_SIZE                                                                                                \
+	(SAMPLE_HEADER_SIZE + 3 * POSE_SIZE + VIEWS_SIZE + 2 * (VELOCITY_SIZE + ANALOG_SIZE + FLAGS_SIZE))
+
+static_assert(VIEWS_SIZE == R_PROTOCOL_MAX_BLOCK_SIZE, "Largest block changed");
+static_assert(R_PROTOCOL_BLOCK_COUNT < 15, "Keyframe bit is in the block mask");
+
+
+/*
+ *
+ * Little endian helpers.
+ *
+ */
+
+static inline void
+put_u16(uint8_t **p, uint16_t v)
+{
+	(*p)[0] = (uint8_t)(v >> 0);
+	(*p)[1] = (uint8_t)(v >> 8);
+	*p += 2;
+}
+
+static inline void
+put_u32(uint8_t **p, uint32_t v)
+{
+	for (int i = 0; i < 4; i++) {
+		(*p)[i] = (uint8_t)(v >> (i * 8));
+	}
+	*p += 4;
+}
+
+static inline void
+put_u64(uint8_t **p, uint64_t v)
+{
+	put_u32(p, (uint32_t)v);
+	put_u32(p, (uint32_t)(v >> 32));
+}
+
+static inline void
+put_f32(uint8_t **p, float v)
+{
+	uint32_t u;
+	memcpy(&u, &v, sizeof(u));
+	put_u32(p, u);
+}
+
+static inline uint16_t
+get_u16(const uint8_t **p)
+{
+	uint16_t v = (uint16_t)((*p)[0] | (*p)[1] << 8);
+	*p += 2;
+	return v;
+}
+
+static inline uint32_t
+get_u32(const uint8_t **p)
+{
+	uint32_t v = 0;
+	for (int i = 0; i < 4; i++) {
+		v |= (uint32_t)(*p)[i] << (i * 8);
+	}
+	*p += 4;
+	return v;
+}
+
+static inline uint64_t
+get_u64(const uint8_t **p)
+{
+	uint64_t lo = get_u32(p);
+	uint64_t hi = get_u32(p);
+	return lo | hi << 32;
+}
+
+static inline float
+get_f32(const uint8_t **p)
+{
+	uint32_t u = get_u32(p);
+	float v;
+	memcpy(&v, &u, sizeof(v));
+	return v;
+}
+
+
+/*
+ *
+ * Quantization.
+ *
+ */
+
+static inline int16_t
+quantize_unit(float v, float max)
+{
+	return (int16_t)lroundf(CLAMP(v / max, -1.0f, 1.0f) * 32767.0f);
+}
+
+static inline float
+dequantize_unit(int16_t v, float max)
+{
+	return (float)v / 32767.0f * max;
+}
+
+static void
+put_pose(uint8_t **p, const struct xrt_pose *pose)
+{
+	const float *pos = &pose->position.x;
+	for (int i = 0; i < 3; i++) {
+		double v = CLAMP((double)pos[i] * POSITION_SCALE, (double)INT32_MIN, (double)INT32_MAX);
+		put_u32(p, (uint32_t)(int32_t)llround(v));
+	}
+
+	// Smallest three, the largest component is rebuilt from the others.
+	struct xrt_quat q = pose->orientation;
+	math_quat_normalize(&q);
+	float c[4] = {q.x, q.y, q.z, q.w};
+
+	uint8_t largest = 0;
+	for (uint8_t i = 1; i < 4; i++) {
+		if (fabsf(c[i]) > fabsf(c[largest])) {
+			largest = i;
+		}
+	}
+
+	float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+	**p = largest;
+	*p += 1;
+	for (uint8_t i = 0; i < 4; i++) {
+		if (i != largest) {
+			put_u16(p, (uint16_t)quantize_unit(c[i] * sign, QUAT_COMPONENT_MAX));
+		}
+	}
+}
+
+static bool
+get_pose(const uint8_t **p, struct xrt_pose *pose)
+{
+	float *pos = &pose->position.x;
+	for (int i = 0; i < 3; i++) {
+		pos[i] = (float)((int32_t)get_u32(p) / (double)POSITION_SCALE);
+	}
+
+	uint8_t largest = **p;
+	*p += 1;
+	if (largest > 3) {
+		return false;
+	}
+
+	float c[4];
+	float sum = 0.0f;
+	for (uint8_t i = 0; i < 4; i++) {
+		if (i != largest) {
+			c[i] = dequantize_unit((int16_t)get_u16(p), QUAT_COMPONENT_MAX);
+			sum += c[i] * c[i];
+		}
+	}
+	c[largest] = sqrtf(fmaxf(0.0f, 1.0f - sum));
+
+	pose->orientation = (struct xrt_quat){c[0], c[1], c[2], c[3]};
+	math_quat_normalize(&pose->orientation);
+
+	return true;
+}
+
+
+/*
+ *
+ * Blocks.
+ *
+ */
+
+static bool
+block_is_right(enum r_protocol_block block)
+{
+	return block >= R_PROTOCOL_BLOCK_RIGHT_POSE;
+}
+
+static const struct r_remote_controller_data *
+block_controller(const struct r_remote_data *data, enum r_protocol_block block)
+{
+	return block_is_right(block) ? &data->right : &data->left;
+}
+
+static size_t
+block_size(enum r_protocol_block block)
+{
+	switch (block) {
+	case R_PROTOCOL_BLOCK_HEAD_CENTER:
+	case R_PROTOCOL_BLOCK_LEFT_POSE:
+	case R_PROTOCOL_BLOCK_RIGHT_POSE: return POSE_SIZE;
+	case R_PROTOCOL_BLOCK_HEAD_VIEWS: return VIEWS_SIZE;
+	case R_PROTOCOL_BLOCK_LEFT_VELOCITY:
+	case R_PROTOCOL_BLOCK_RIGHT_VELOCITY: return VELOCITY_SIZE;
+	case R_PROTOCOL_BLOCK_LEFT_ANALOG:
+	case R_PROTOCOL_BLOCK_RIGHT_ANALOG: return ANALOG_SIZE;
+	case R_PROTOCOL_BLOCK_LEFT_FLAGS:
+	case R_PROTOCOL_BLOCK_RIGHT_FLAGS: return FLAGS_SIZE;
+	default: return 0;
+	}
+}
+
+static void
+analog_pointers(struct r_remote_controller_data *c, float *out[ANALOG_COUNT])
+{
+	float *v[ANALOG_COUNT] = {
+	    &c->hand_curl[0],
+	    &c->hand_curl[1],
+	    &c->hand_curl[2],
+	    &c->hand_curl[3],
+	    &c->hand_curl[4],
+	    &c->trigger_value.x,
+	    &c->squeeze_value.x,
+	    &c->squeeze_force.x,
+	    &c->thumbstick.x,
+	    &c->thumbstick.y,
+	    &c->trackpad.x,
+	    &c->trackpad.y,
+	    &c->trackpad_force.x,
+	};
+	memcpy(out, v, sizeof(v));
+}
+
+static void
+flag_pointers(struct r_remote_controller_data *c, bool *out[FLAG_COUNT])
+{
+	bool *v[FLAG_COUNT] = {
+	    &c->active,
+	    &c->hand_tracking_active,
+	    &c->system_click,
+	    &c->system_touch,
+	    &c->a_click,
+	    &c->a_touch,
+	    &c->b_click,
+	    &c->b_touch,
+	    &c->trigger_click,
+	    &c->trigger_touch,
+	    &c->thumbstick_click,
+	    &c->thumbstick_touch,
+	    &c->trackpad_touch,
+	};
+	memcpy(out, v, sizeof(v));
+}
+
+static void
+encode_block(const struct r_remote_data *data, enum r_protocol_block block, uint8_t *out)
+{
+	// A copy, the pointer helpers are shared with decoding.
+	struct r_remote_controller_data copy = *block_controller(data, block);
+	struct r_remote_controller_data *c = &copy;
+	uint8_t *p = out;
+
+	switch (block) {
+	case R_PROTOCOL_BLOCK_HEAD_CENTER: put_pose(&p, &data->head.center); break;
+	case R_PROTOCOL_BLOCK_HEAD_VIEWS:
+		*p++ = data->head.per_view_data_valid ? 1 : 0;
+		for (int i = 0; i < 2; i++) {
+			const struct xrt_fov *fov = &data->head.views[i].fov;
+			const struct xrt_pose *pose = &data->head.views[i].pose;
+			put_f32(&p, fov->angle_left);
+			put_f32(&p, fov->angle_right);
+			put_f32(&p, fov->angle_up);
+			put_f32(&p, fov->angle_down);
+			put_f32(&p, pose->orientation.x);
+			put_f32(&p, pose->orientation.y);
+			put_f32(&p, pose->orientation.z);
+			put_f32(&p, pose->orientation.w);
+			put_f32(&p, pose->position.x);
+			put_f32(&p, pose->position.y);
+			put_f32(&p, pose->position.z);
+		}
+		break;
+	case R_PROTOCOL_BLOCK_LEFT_POSE:
+	case R_PROTOCOL_BLOCK_RIGHT_POSE: put_pose(&p, &c->pose); break;
+	case R_PROTOCOL_BLOCK_LEFT_VELOCITY:
+	case R_PROTOCOL_BLOCK_RIGHT_VELOCITY:
+		put_f32(&p, c->linear_velocity.x);
+		put_f32(&p, c->linear_velocity.y);
+		put_f32(&p, c->linear_velocity.z);
+		put_f32(&p, c->angular_velocity.x);
+		put_f32(&p, c->angular_velocity.y);
+		put_f32(&p, c->angular_velocity.z);
+		break;
+	case R_PROTOCOL_BLOCK_LEFT_ANALOG:
+	case R_PROTOCOL_BLOCK_RIGHT_ANALOG: {
+		float *v[ANALOG_COUNT];
+		analog_pointers(c, v);
+		for (int i = 0; i < ANALOG_COUNT; i++) {
+			put_u16(&p, (uint16_t)quantize_unit(*v[i], 1.0f));
+		}
+	} break;
+	case R_PROTOCOL_BLOCK_LEFT_FLAGS:
+	case R_PROTOCOL_BLOCK_RIGHT_FLAGS: {
+		bool *v[FLAG_COUNT];
+		flag_pointers(c, v);
+		uint16_t bits = 0;
+		for (int i = 0; i < FLAG_COUNT; i++) {
+			bits |= (uint16_t)((*v[i] ? 1u : 0u) << i);
+		}
+		put_u16(&p, bits);
+	} break;
+	default: assert(false);
+	}
+
+	assert((size_t)(p - out) == block_size(block));
+}
+
+static bool
+decode_block(struct r_remote_data *data, enum r_protocol_block block, const uint8_t *in)
+{
+	struct r_remote_controller_data *c = block_is_right(block) ? &data->right : &data->left;
+	const uint8_t *p = in;
+
+	switch (block) {
+	case R_PROTOCOL_BLOCK_HEAD_CENTER: return get_pose(&p, &data->head.center);
+	case R_PROTOCOL_BLOCK_HEAD_VIEWS:
+		data->head.per_view_data_valid = *p++ != 0;
+		for (int i = 0; i < 2; i++) {
+			struct xrt_fov *fov = &data->head.views[i].fov;
+			struct xrt_pose *pose = &data->head.views[i].pose;
+			fov->angle_left = get_f32(&p);
+			fov->angle_right = get_f32(&p);
+			fov->angle_up = get_f32(&p);
+			fov->angle_down = get_f32(&p);
+			pose->orientation.x = get_f32(&p);
+			pose->orientation.y = get_f32(&p);
+			pose->orientation.z = get_f32(&p);
+			pose->orientation.w = get_f32(&p);
+			pose->position.x = get_f32(&p);
+			pose->position.y = get_f32(&p);
+			pose->position.z = get_f32(&p);
+		}
+		return true;
+	case R_PROTOCOL_BLOCK_LEFT_POSE:
+	case R_PROTOCOL_BLOCK_RIGHT_POSE: return get_pose(&p, &c->pose);
+	case R_PROTOCOL_BLOCK_LEFT_VELOCITY:
+	case R_PROTOCOL_BLOCK_RIGHT_VELOCITY:
+		c->linear_velocity.x = get_f32(&p);
+		c->linear_velocity.y = get_f32(&p);
+		c->linear_velocity.z = get_f32(&p);
+		c->angular_velocity.x = get_f32(&p);
+		c->angular_velocity.y = get_f32(&p);
+		c->angular_velocity.z = get_f32(&p);
+		return true;
+	case R_PROTOCOL_BLOCK_LEFT_ANALOG:
+	case R_PROTOCOL_BLOCK_RIGHT_ANALOG: {
+		float *v[ANALOG_COUNT];
+		analog_pointers(c, v);
+		for (int i = 0; i < ANALOG_COUNT; i++) {
+			*v[i] = dequantize_unit((int16_t)get_u16(&p), 1.0f);
+		}
+		return true;
+	}
+	case R_PROTOCOL_BLOCK_LEFT_FLAGS:
+	case R_PROTOCOL_BLOCK_RIGHT_FLAGS: {
+		bool *v[FLAG_COUNT];
+		flag_pointers(c, v);
+		uint16_t bits = get_u16(&p);
+		for (int i = 0; i < FLAG_COUNT; i++) {
+			*v[i] = (bits >> i) & 1;
+		}
+		return true;
+	}
+	default: return false;
+	}
+}
+
+
+/*
+ *
+ * 'Exported' writer functions.
+ *
+ */
+
+void
+r_protocol_writer_init(struct r_protocol_writer *w)
+{
+	U_ZERO(w);
+}
+
+void
+r_protocol_writer_force_keyframe(struct r_protocol_writer *w)
+{
+	w->force_keyframe = true;
+}
+
+bool
+r_protocol_writer_add(struct r_protocol_writer *w, const struct r_remote_data *data, int64_t timestamp_ns)
+{
+	if (w->size == 0) {
+		w->size = R_PROTOCOL_HEADER_SIZE;
+	}
+
+	if (w->size + MAX_SAMPLE_SIZE > sizeof(w->buffer)) {
+		return false;
+	}
+
+	bool keyframe = !w->have_last || w->force_keyframe || w->samples_since_keyframe >= R_PROTOCOL_KEYFRAME_INTERVAL;
+
+	uint8_t *p = w->buffer + w->size;
+	put_u64(&p, (uint64_t)timestamp_ns);
+	uint8_t *mask_ptr = p;
+	p += 2;
+
+	uint16_t mask = keyframe ? R_PROTOCOL_KEYFRAME_BIT : 0;
+	for (uint32_t i = 0; i < R_PROTOCOL_BLOCK_COUNT; i++) {
+		uint8_t block[R_PROTOCOL_MAX_BLOCK_SIZE];
+		size_t size = block_size(i);
+
+		encode_block(data, i, block);
+
+		if (!keyframe && memcmp(block, w->last_blocks[i], size) == 0) {
+			continue;
+		}
+
+		memcpy(p, block, size);
+		memcpy(w->last_blocks[i], block, size);
+		p += size;
+		mask |= (uint16_t)(1u << i);
+	}
+
+	put_u16(&mask_ptr, mask);
+
+	w->size = (size_t)(p - w->buffer);
+	w->sample_count++;
+	w->have_last = true;
+	if (keyframe) {
+		w->force_keyframe = false;
+		w->samples_since_keyframe = 0;
+	} else {
+		w->samples_since_keyframe++;
+	}
+
+	return true;
+}
+
+size_t
+r_protocol_writer_finish(struct r_protocol_writer *w, const uint8_t **out_data)
+{
+	if (w->sample_count == 0) {
+		return 0;
+	}
+
+	uint8_t *p = w->buffer;
+	put_u32(&p, R_PROTOCOL_MAGIC);
+	put_u16(&p, R_PROTOCOL_VERSION);
+	put_u16(&p, w->sample_count);
+	put_u32(&p, w->sequence);
+	put_u32(&p, (uint32_t)(w->size - R_PROTOCOL_HEADER_SIZE));
+
+	size_t size = w->size;
+
+	w->sequence++;
+	w->sample_count = 0;
+	w->size = 0;
+
+	*out_data = w->buffer;
+
+	return size;
+}
+
+
+/*
+ *
+ * 'Exported' reader functions.
+ *
+ */
+
+bool
+r_protocol_parse_header(const uint8_t *data, size_t size, struct r_protocol_header *out_header)
+{
+	if (size < R_PROTOCOL_HEADER_SIZE) {
+		return false;
+	}
+
+	const uint8_t *p = data;
+	struct r_protocol_header h;
+	h.magic = get_u32(&p);
+	h.version = get_u16(&p);
+	h.sample_count = get_u16(&p);
+	h.sequence = get_u32(&p);
+	h.payload_size = get_u32(&p);
+
+	if (h.magic != R_PROTOCOL_MAGIC || h.version != R_PROTOCOL_VERSION) {
+		return false;
+	}
+	if (h.payload_size > R_PROTOCOL_MAX_PACKET_SIZE - R_PROTOCOL_HEADER_SIZE) {
+		return false;
+	}
+
+	*out_header = h;
+
+	return true;
+}
+
+void
+r_protocol_reader_init(struct r_protocol_reader *r)
+{
+	U_ZERO(r);
+}
+
+int
+r_protocol_reader_decode(
+    struct r_protocol_reader *r, const uint8_t *data, size_t size, r_protocol_sample_func_t func, void *ptr)
+{
+	struct r_protocol_header h;
+	if (!r_protocol_parse_header(data, size, &h) || size < R_PROTOCOL_HEADER_SIZE + h.payload_size) {
+		return -1;
+	}
+
+	if (r->have_sequence && h.sequence != r->next_sequence) {
+		int32_t diff = (int32_t)(h.sequence - r->next_sequence);
+		if (diff < 0) {
+			// Reordered datagram, everything in it is older than what we have.
+			return 0;
+		}
+
+		// Deltas in later packets build on the lost ones.
+		r->lost_packets += (uint32_t)diff;
+		r->have_keyframe = false;
+	}
+	r->have_sequence = true;
+	r->next_sequence = h.sequence + 1;
+
+	const uint8_t *p = data + R_PROTOCOL_HEADER_SIZE;
+	const uint8_t *end = p + h.payload_size;
+	int decoded = 0;
+
+	for (uint32_t s = 0; s < h.sample_count; s++) {
+		if (end - p < SAMPLE_HEADER_SIZE) {
+			return -1;
+		}
+
+		int64_t timestamp_ns = (int64_t)get_u64(&p);
+		uint16_t mask = get_u16(&p);
+		bool keyframe = (mask & R_PROTOCOL_KEYFRAME_BIT) != 0;
+		bool usable = keyframe || r->have_keyframe;
+
+		for (uint32_t i = 0; i < R_PROTOCOL_BLOCK_COUNT; i++) {
+			if ((mask & (1u << i)) == 0) {
+				continue;
+			}
+
+			size_t bsize = block_size(i);
+			if ((size_t)(end - p) < bsize) {
+				return -1;
+			}
+			if (usable && !decode_block(&r->state, i, p)) {
+				return -1;
+			}
+			p += bsize;
+		}
+
+		if (!usable) {
+			r->skipped_samples++;
+			continue;
+		}
+
+		r->have_keyframe = true;
+		decoded++;
+
+		if (func != NULL) {
+			func(ptr, &r->state, timestamp_ns);
+		}
+	}
+
+	return decoded;
+}
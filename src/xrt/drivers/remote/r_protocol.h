@@ -0,0 +1,262 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Framed wire protocol of the remote driver.
+ * @ingroup drv_remote
+ *
+ * Every packet starts with a @ref R_PROTOCOL_HEADER_SIZE byte header holding
+ * the magic, version, sample count, sequence number and payload size. The
+ * payload is a batch of samples, each a timestamp, a mask of which blocks
+ * follow and the blocks themselves. A block is only sent when its quantized
+ * value changed since the previous sample, or in keyframes which carry all
+ * of them. Everything is little endian.
+ */
+
+#pragma once
+
+#include "xrt/xrt_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * "mndr" as a little endian integer.
+ *
+ * @ingroup drv_remote
+ */
+#define R_PROTOCOL_MAGIC (0x72646e6du)
+
+/*!
+ * Bumped on any change to the wire format.
+ *
+ * @ingroup drv_remote
+ */
+#define R_PROTOCOL_VERSION (4u)
+
+//! Fits in a single UDP datagram on any sane network.
+#define R_PROTOCOL_MAX_PACKET_SIZE (1400)
+
+//! Magic(4) + version(2) + sample count(2) + sequence(4) + payload size(4).
+#define R_PROTOCOL_HEADER_SIZE (16)
+
+//! A keyframe is forced at least this often, lets UDP receivers recover.
+#define R_PROTOCOL_KEYFRAME_INTERVAL (32)
+
+/*!
+ * Data per controller.
+ */
+struct r_remote_controller_data
+{
+	struct xrt_pose pose;
+	struct xrt_vec3 linear_velocity;
+	struct xrt_vec3 angular_velocity;
+
+	float hand_curl[5];
+
+	struct xrt_vec1 trigger_value;
+	struct xrt_vec1 squeeze_value;
+	struct xrt_vec1 squeeze_force;
+	struct xrt_vec2 thumbstick;
+	struct xrt_vec1 trackpad_force;
+	struct xrt_vec2 trackpad;
+
+	bool hand_tracking_active;
+	bool active;
+
+	bool system_click;
+	bool system_touch;
+	bool a_click;
+	bool a_touch;
+	bool b_click;
+	bool b_touch;
+	bool trigger_click;
+	bool trigger_touch;
+	bool thumbstick_click;
+	bool thumbstick_touch;
+	bool trackpad_touch;
+};
+
+struct r_head_data
+{
+	struct
+	{
+		//! The field of view values of this view.
+		struct xrt_fov fov;
+
+		//! The pose of this view relative to @ref r_head_data::center.
+		struct xrt_pose pose;
+	} views[2];
+
+	//! The center of the head, in OpenXR terms the view space.
+	struct xrt_pose center;
+
+	//! Is the per view data valid and should be used?
+	bool per_view_data_valid;
+};
+
+/*!
+ * Remote data sent from the debugger to the hub.
+ *
+ * @ingroup drv_remote
+ */
+struct r_remote_data
+{
+	struct r_head_data head;
+
+	struct r_remote_controller_data left, right;
+};
+
+/*!
+ * Blocks of @ref r_remote_data that are sent independently.
+ *
+ * @ingroup drv_remote
+ */
+enum r_protocol_block
+{
+	R_PROTOCOL_BLOCK_HEAD_CENTER = 0,
+	R_PROTOCOL_BLOCK_HEAD_VIEWS,
+	R_PROTOCOL_BLOCK_LEFT_POSE,
+	R_PROTOCOL_BLOCK_LEFT_VELOCITY,
+	R_PROTOCOL_BLOCK_LEFT_ANALOG,
+	R_PROTOCOL_BLOCK_LEFT_FLAGS,
+	R_PROTOCOL_BLOCK_RIGHT_POSE,
+	R_PROTOCOL_BLOCK_RIGHT_VELOCITY,
+	R_PROTOCOL_BLOCK_RIGHT_ANALOG,
+	R_PROTOCOL_BLOCK_RIGHT_FLAGS,
+
+	R_PROTOCOL_BLOCK_COUNT,
+};
+
+//! Largest encoded block, the head views.
+#define R_PROTOCOL_MAX_BLOCK_SIZE (89)
+
+//! Set in the block mask of samples that carry every block.
+#define R_PROTOCOL_KEYFRAME_BIT (1u << 15)
+
+/*!
+ * Decoded packet header.
+ *
+ * @ingroup drv_remote
+ */
+struct r_protocol_header
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t sample_count;
+	uint32_t sequence;
+	uint32_t payload_size;
+};
+
+/*!
+ * Builds packets out of samples, keeps the last sent blocks around to only
+ * send the ones that changed.
+ *
+ * @ingroup drv_remote
+ */
+struct r_protocol_writer
+{
+	uint8_t last_blocks[R_PROTOCOL_BLOCK_COUNT][R_PROTOCOL_MAX_BLOCK_SIZE];
+	bool have_last;
+	bool force_keyframe;
+	uint32_t samples_since_keyframe;
+
+	//! Sequence number of the next packet.
+	uint32_t sequence;
+
+	uint8_t buffer[R_PROTOCOL_MAX_PACKET_SIZE];
+	size_t size;
+	uint16_t sample_count;
+};
+
+/*!
+ * Decodes packets, holds the state the deltas are applied on.
+ *
+ * @ingroup drv_remote
+ */
+struct r_protocol_reader
+{
+	//! The state after the last decoded sample.
+	struct r_remote_data state;
+
+	//! Deltas are only usable after a keyframe, cleared on lost packets.
+	bool have_keyframe;
+
+	bool have_sequence;
+	uint32_t next_sequence;
+
+	uint64_t lost_packets;
+	uint64_t skipped_samples;
+};
+
+/*!
+ * Called for each decoded sample, @p timestamp_ns is in the senders clock.
+ *
+ * @ingroup drv_remote
+ */
+typedef void (*r_protocol_sample_func_t)(void *ptr, const struct r_remote_data *data, int64_t timestamp_ns);
+
+/*!
+ * @public @memberof r_protocol_writer
+ */
+void
+r_protocol_writer_init(struct r_protocol_writer *w);
+
+/*!
+ * Make the next sample a keyframe.
+ *
+ * @public @memberof r_protocol_writer
+ */
+void
+r_protocol_writer_force_keyframe(struct r_protocol_writer *w);
+
+/*!
+ * Add a sample to the current packet, returns false if it does not fit, in
+ * which case the packet needs to be finished and sent first.
+ *
+ * @public @memberof r_protocol_writer
+ */
+bool
+r_protocol_writer_add(struct r_protocol_writer *w, const struct r_remote_data *data, int64_t timestamp_ns);
+
+/*!
+ * Fill in the header of the current packet and return it, the writer starts
+ * a new packet on the next add. Returns zero if there are no samples.
+ *
+ * @public @memberof r_protocol_writer
+ */
+size_t
+r_protocol_writer_finish(struct r_protocol_writer *w, const uint8_t **out_data);
+
+/*!
+ * Parse and validate a packet header, returns false on a bad magic, version
+ * or size.
+ *
+ * @ingroup drv_remote
+ */
+bool
+r_protocol_parse_header(const uint8_t *data, size_t size, struct r_protocol_header *out_header);
+
+/*!
+ * @public @memberof r_protocol_reader
+ */
+void
+r_protocol_reader_init(struct r_protocol_reader *r);
+
+/*!
+ * Decode a whole packet, header included, calling @p func for every sample
+ * that could be decoded. Returns the number of samples, negative on a
+ * malformed packet.
+ *
+ * @public @memberof r_protocol_reader
+ */
+int
+r_protocol_reader_decode(
+    struct r_protocol_reader *r, const uint8_t *data, size_t size, r_protocol_sample_func_t func, void *ptr);
+
+
+#ifdef __cplusplus
+}
+#endif
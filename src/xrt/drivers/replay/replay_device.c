@@ -0,0 +1,834 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Devices that play back a @ref u_device_recorder file.
+ * @ingroup drv_replay
+ */
+
+#include "xrt/xrt_device.h"
+
+#include "os/os_time.h"
+
+#include "math/m_api.h"
+#include "math/m_space.h"
+
+#include "util/u_misc.h"
+#include "util/u_debug.h"
+#include "util/u_device.h"
+#include "util/u_logging.h"
+#include "util/u_distortion_mesh.h"
+
+#include "replay_interface.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+
+/*
+ *
+ * Structs and defines.
+ *
+ */
+
+DEBUG_GET_ONCE_LOG_OPTION(replay_log, "REPLAY_LOG", U_LOGGING_INFO)
+
+#define REPLAY_DEBUG(...) U_LOG_IFL_D(debug_get_log_option_replay_log(), __VA_ARGS__)
+#define REPLAY_INFO(...) U_LOG_IFL_I(debug_get_log_option_replay_log(), __VA_ARGS__)
+#define REPLAY_ERROR(...) U_LOG_IFL_E(debug_get_log_option_replay_log(), __VA_ARGS__)
+
+struct replay_pose_sample
+{
+	uint64_t at_timestamp_ns;
+	struct xrt_space_relation relation;
+};
+
+struct replay_pose_track
+{
+	enum xrt_input_name name;
+	struct replay_pose_sample *samples;
+	size_t count;
+	size_t capacity;
+};
+
+struct replay_hand_track
+{
+	enum xrt_input_name name;
+	struct u_device_recorder_hand_tracking *samples;
+	size_t count;
+	size_t capacity;
+};
+
+struct replay_input_sample
+{
+	//! When update_inputs was called.
+	int64_t when_ns;
+	struct u_device_recorder_input input;
+};
+
+struct replay_device
+{
+	struct xrt_device base;
+
+	//! The recording covers [rec_start_ns, rec_start_ns + rec_duration_ns).
+	int64_t rec_start_ns;
+	int64_t rec_duration_ns;
+
+	//! Monotonic time that maps to @ref rec_start_ns.
+	int64_t replay_start_ns;
+
+	struct replay_pose_track *pose_tracks;
+	uint32_t pose_track_count;
+
+	struct replay_hand_track *hand_tracks;
+	uint32_t hand_track_count;
+
+	struct replay_input_sample *inputs;
+	size_t input_sample_count;
+	size_t input_sample_capacity;
+
+	//! Next input sample to apply and the loop it belongs to.
+	size_t input_cursor;
+	int64_t input_loop;
+
+	struct u_device_recorder_view_poses *views;
+	size_t view_sample_count;
+	size_t view_sample_capacity;
+};
+
+
+/*
+ *
+ * Helper functions.
+ *
+ */
+
+static inline struct replay_device *
+replay_device(struct xrt_device *xdev)
+{
+	return (struct replay_device *)xdev;
+}
+
+//! Makes room for one more element, returns false on allocation failure.
+static bool
+grow(void **ptr, size_t element_size, size_t count, size_t *capacity)
+{
+	if (count < *capacity) {
+		return true;
+	}
+
+	size_t new_capacity = MAX(*capacity * 2, 64);
+	void *new_ptr = realloc(*ptr, element_size * new_capacity);
+	if (new_ptr == NULL) {
+		return false;
+	}
+
+	*ptr = new_ptr;
+	*capacity = new_capacity;
+
+	return true;
+}
+
+/*!
+ * Map a replay time onto the recording, returns the recording time and which
+ * loop of the recording it is in.
+ */
+static int64_t
+to_recording_time(const struct replay_device *d, int64_t timestamp_ns, int64_t *out_loop)
+{
+	int64_t offset = timestamp_ns - d->replay_start_ns;
+	int64_t loop = offset / d->rec_duration_ns;
+	if (offset < 0 && loop * d->rec_duration_ns != offset) {
+		loop -= 1;
+	}
+
+	*out_loop = loop;
+
+	return d->rec_start_ns + offset - loop * d->rec_duration_ns;
+}
+
+//! What to add to a recording time in @p loop to get the replay time.
+static int64_t
+loop_shift(const struct replay_device *d, int64_t loop)
+{
+	return d->replay_start_ns - d->rec_start_ns + loop * d->rec_duration_ns;
+}
+
+/*!
+ * Index of the first sample whose timestamp, a uint64_t at @p field_offset,
+ * is after @p t. The samples are sorted on it.
+ */
+static size_t
+upper_bound(const void *samples, size_t count, size_t stride, size_t field_offset, int64_t t)
+{
+	const uint8_t *ptr = (const uint8_t *)samples;
+	size_t lo = 0;
+	size_t hi = count;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		uint64_t value;
+		memcpy(&value, ptr + mid * stride + field_offset, sizeof(value));
+
+		if ((int64_t)value <= t) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static struct replay_pose_track *
+find_pose_track(struct replay_device *d, enum xrt_input_name name)
+{
+	for (uint32_t i = 0; i < d->pose_track_count; i++) {
+		if (d->pose_tracks[i].name == name) {
+			return &d->pose_tracks[i];
+		}
+	}
+	return NULL;
+}
+
+static struct replay_hand_track *
+find_hand_track(struct replay_device *d, enum xrt_input_name name)
+{
+	for (uint32_t i = 0; i < d->hand_track_count; i++) {
+		if (d->hand_tracks[i].name == name) {
+			return &d->hand_tracks[i];
+		}
+	}
+	return NULL;
+}
+
+static int
+compare_pose_samples(const void *a, const void *b)
+{
+	uint64_t ta = ((const struct replay_pose_sample *)a)->at_timestamp_ns;
+	uint64_t tb = ((const struct replay_pose_sample *)b)->at_timestamp_ns;
+	return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static int
+compare_hand_samples(const void *a, const void *b)
+{
+	uint64_t ta = ((const struct u_device_recorder_hand_tracking *)a)->at_timestamp_ns;
+	uint64_t tb = ((const struct u_device_recorder_hand_tracking *)b)->at_timestamp_ns;
+	return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static int
+compare_view_samples(const void *a, const void *b)
+{
+	uint64_t ta = ((const struct u_device_recorder_view_poses *)a)->at_timestamp_ns;
+	uint64_t tb = ((const struct u_device_recorder_view_poses *)b)->at_timestamp_ns;
+	return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static bool
+interpolate_pose(struct replay_device *d,
+                 enum xrt_input_name name,
+                 uint64_t at_timestamp_ns,
+                 struct xrt_space_relation *out_relation)
+{
+	struct replay_pose_track *track = find_pose_track(d, name);
+	if (track == NULL || track->count == 0) {
+		return false;
+	}
+
+	int64_t loop;
+	int64_t t = to_recording_time(d, (int64_t)at_timestamp_ns, &loop);
+	size_t i = upper_bound(track->samples, track->count, sizeof(*track->samples),
+	                       offsetof(struct replay_pose_sample, at_timestamp_ns), t);
+
+	if (i == 0) {
+		*out_relation = track->samples[0].relation;
+		return true;
+	}
+	if (i == track->count) {
+		*out_relation = track->samples[i - 1].relation;
+		return true;
+	}
+
+	struct replay_pose_sample *a = &track->samples[i - 1];
+	struct replay_pose_sample *b = &track->samples[i];
+	float f = (float)((double)(t - (int64_t)a->at_timestamp_ns) /
+	                  (double)(b->at_timestamp_ns - a->at_timestamp_ns));
+	enum xrt_space_relation_flags flags = a->relation.relation_flags & b->relation.relation_flags;
+
+	m_space_relation_interpolate(&a->relation, &b->relation, f, flags, out_relation);
+
+	return true;
+}
+
+
+/*
+ *
+ * Member functions.
+ *
+ */
+
+static void
+replay_update_inputs(struct xrt_device *xdev)
+{
+	struct replay_device *d = replay_device(xdev);
+
+	int64_t loop;
+	int64_t now = to_recording_time(d, (int64_t)os_monotonic_get_ns(), &loop);
+
+	// Wrapped around, play the inputs from the start again.
+	if (loop != d->input_loop) {
+		d->input_loop = loop;
+		d->input_cursor = 0;
+	}
+
+	int64_t shift = loop_shift(d, loop);
+
+	while (d->input_cursor < d->input_sample_count && d->inputs[d->input_cursor].when_ns <= now) {
+		const struct u_device_recorder_input *ri = &d->inputs[d->input_cursor++].input;
+		struct xrt_input *input = &d->base.inputs[ri->index];
+
+		input->active = ri->active != 0;
+		input->timestamp = ri->timestamp + shift;
+		input->value = ri->value;
+	}
+}
+
+static void
+replay_get_tracked_pose(struct xrt_device *xdev,
+                        enum xrt_input_name name,
+                        uint64_t at_timestamp_ns,
+                        struct xrt_space_relation *out_relation)
+{
+	struct replay_device *d = replay_device(xdev);
+
+	if (!interpolate_pose(d, name, at_timestamp_ns, out_relation)) {
+		*out_relation = (struct xrt_space_relation)XRT_SPACE_RELATION_ZERO;
+	}
+}
+
+static void
+replay_get_hand_tracking(struct xrt_device *xdev,
+                         enum xrt_input_name name,
+                         uint64_t desired_timestamp_ns,
+                         struct xrt_hand_joint_set *out_value,
+                         uint64_t *out_timestamp_ns)
+{
+	struct replay_device *d = replay_device(xdev);
+	struct replay_hand_track *track = find_hand_track(d, name);
+
+	if (track == NULL || track->count == 0) {
+		U_ZERO(out_value);
+		*out_timestamp_ns = desired_timestamp_ns;
+		return;
+	}
+
+	int64_t loop;
+	int64_t t = to_recording_time(d, (int64_t)desired_timestamp_ns, &loop);
+	size_t i = upper_bound(track->samples, track->count, sizeof(*track->samples),
+	                       offsetof(struct u_device_recorder_hand_tracking, at_timestamp_ns), t);
+	const struct u_device_recorder_hand_tracking *sample = &track->samples[i > 0 ? i - 1 : 0];
+
+	*out_value = sample->value;
+	*out_timestamp_ns = (uint64_t)((int64_t)sample->out_timestamp_ns + loop_shift(d, loop));
+}
+
+static void
+replay_get_view_poses(struct xrt_device *xdev,
+                      const struct xrt_vec3 *default_eye_relation,
+                      uint64_t at_timestamp_ns,
+                      uint32_t view_count,
+                      struct xrt_space_relation *out_head_relation,
+                      struct xrt_fov *out_fovs,
+                      struct xrt_pose *out_poses)
+{
+	struct replay_device *d = replay_device(xdev);
+
+	if (d->view_sample_count == 0) {
+		u_device_get_view_poses(xdev, default_eye_relation, at_timestamp_ns, view_count, out_head_relation,
+		                        out_fovs, out_poses);
+		return;
+	}
+
+	int64_t loop;
+	int64_t t = to_recording_time(d, (int64_t)at_timestamp_ns, &loop);
+	size_t i = upper_bound(d->views, d->view_sample_count, sizeof(*d->views),
+	                       offsetof(struct u_device_recorder_view_poses, at_timestamp_ns), t);
+	const struct u_device_recorder_view_poses *sample = &d->views[i > 0 ? i - 1 : 0];
+
+	for (uint32_t k = 0; k < view_count; k++) {
+		uint32_t src = MIN(k, sample->view_count - 1);
+		out_fovs[k] = sample->fovs[src];
+		out_poses[k] = sample->poses[src];
+	}
+
+	// Smoother than the nearest sample if the head pose was recorded.
+	if (!interpolate_pose(d, XRT_INPUT_GENERIC_HEAD_POSE, at_timestamp_ns, out_head_relation)) {
+		*out_head_relation = sample->head_relation;
+	}
+}
+
+static void
+replay_set_output(struct xrt_device *xdev, enum xrt_output_name name, const union xrt_output_value *value)
+{
+	// Nothing to drive.
+}
+
+static void
+replay_destroy(struct xrt_device *xdev)
+{
+	struct replay_device *d = replay_device(xdev);
+
+	for (uint32_t i = 0; i < d->pose_track_count; i++) {
+		free(d->pose_tracks[i].samples);
+	}
+	free(d->pose_tracks);
+
+	for (uint32_t i = 0; i < d->hand_track_count; i++) {
+		free(d->hand_tracks[i].samples);
+	}
+	free(d->hand_tracks);
+
+	free(d->inputs);
+	free(d->views);
+
+	for (size_t i = 0; i < d->base.binding_profile_count; i++) {
+		free(d->base.binding_profiles[i].inputs);
+		free(d->base.binding_profiles[i].outputs);
+	}
+	free(d->base.binding_profiles);
+
+	u_device_free(&d->base);
+}
+
+
+/*
+ *
+ * Loading.
+ *
+ */
+
+struct reader
+{
+	const uint8_t *data;
+	size_t size;
+	size_t offset;
+};
+
+static bool
+read_bytes(struct reader *r, void *out, size_t size)
+{
+	if (r->size - r->offset < size) {
+		return false;
+	}
+
+	memcpy(out, r->data + r->offset, size);
+	r->offset += size;
+
+	return true;
+}
+
+static bool
+read_u32(struct reader *r, uint32_t *out)
+{
+	return read_bytes(r, out, sizeof(*out));
+}
+
+static struct replay_device *
+create_device(struct reader *r, struct xrt_tracking_origin *origin)
+{
+	struct u_device_recorder_device desc;
+	if (!read_bytes(r, &desc, sizeof(desc))) {
+		return NULL;
+	}
+
+	bool is_hmd = (desc.flags & U_DEVICE_RECORDER_DEVICE_HMD) != 0;
+	enum u_device_alloc_flags flags = is_hmd ? U_DEVICE_ALLOC_HMD : U_DEVICE_ALLOC_NO_FLAGS;
+	struct replay_device *d = U_DEVICE_ALLOCATE(struct replay_device, flags, desc.input_count, desc.output_count);
+
+	d->base.name = (enum xrt_device_name)desc.name;
+	d->base.device_type = (enum xrt_device_type)desc.device_type;
+	memcpy(d->base.str, desc.str, sizeof(d->base.str));
+	memcpy(d->base.serial, desc.serial, sizeof(d->base.serial));
+	d->base.str[XRT_DEVICE_NAME_LEN - 1] = '\0';
+	d->base.serial[XRT_DEVICE_NAME_LEN - 1] = '\0';
+	d->base.tracking_origin = origin;
+	d->base.orientation_tracking_supported = (desc.flags & U_DEVICE_RECORDER_DEVICE_ORIENTATION_TRACKING) != 0;
+	d->base.position_tracking_supported = (desc.flags & U_DEVICE_RECORDER_DEVICE_POSITION_TRACKING) != 0;
+	d->base.hand_tracking_supported = (desc.flags & U_DEVICE_RECORDER_DEVICE_HAND_TRACKING) != 0;
+	d->base.eye_gaze_supported = (desc.flags & U_DEVICE_RECORDER_DEVICE_EYE_GAZE) != 0;
+	d->base.force_feedback_supported = (desc.flags & U_DEVICE_RECORDER_DEVICE_FORCE_FEEDBACK) != 0;
+
+	d->base.update_inputs = replay_update_inputs;
+	d->base.get_tracked_pose = replay_get_tracked_pose;
+	d->base.get_hand_tracking = replay_get_hand_tracking;
+	d->base.set_output = replay_set_output;
+	d->base.get_view_poses = replay_get_view_poses;
+	d->base.destroy = replay_destroy;
+
+	bool ok = true;
+	for (uint32_t i = 0; i < desc.input_count; i++) {
+		uint32_t name = 0;
+		ok = ok && read_u32(r, &name);
+		d->base.inputs[i].name = (enum xrt_input_name)name;
+	}
+	for (uint32_t i = 0; i < desc.output_count; i++) {
+		uint32_t name = 0;
+		ok = ok && read_u32(r, &name);
+		d->base.outputs[i].name = (enum xrt_output_name)name;
+	}
+
+	if (desc.binding_profile_count > 0) {
+		d->base.binding_profiles = U_TYPED_ARRAY_CALLOC(struct xrt_binding_profile, desc.binding_profile_count);
+		d->base.binding_profile_count = desc.binding_profile_count;
+	}
+
+	for (uint32_t i = 0; ok && i < desc.binding_profile_count; i++) {
+		struct xrt_binding_profile *bp = &d->base.binding_profiles[i];
+		struct u_device_recorder_binding_profile rbp;
+		if (!read_bytes(r, &rbp, sizeof(rbp)) || rbp.input_count > r->size || rbp.output_count > r->size) {
+			ok = false;
+			break;
+		}
+
+		bp->name = (enum xrt_device_name)rbp.name;
+		bp->inputs = U_TYPED_ARRAY_CALLOC(struct xrt_binding_input_pair, rbp.input_count);
+		bp->outputs = U_TYPED_ARRAY_CALLOC(struct xrt_binding_output_pair, rbp.output_count);
+		bp->input_count = rbp.input_count;
+		bp->output_count = rbp.output_count;
+
+		for (uint32_t k = 0; k < rbp.input_count; k++) {
+			uint32_t from = 0, device = 0;
+			ok = ok && read_u32(r, &from) && read_u32(r, &device);
+			bp->inputs[k].from = (enum xrt_input_name)from;
+			bp->inputs[k].device = (enum xrt_input_name)device;
+		}
+		for (uint32_t k = 0; k < rbp.output_count; k++) {
+			uint32_t from = 0, device = 0;
+			ok = ok && read_u32(r, &from) && read_u32(r, &device);
+			bp->outputs[k].from = (enum xrt_output_name)from;
+			bp->outputs[k].device = (enum xrt_output_name)device;
+		}
+	}
+
+	if (ok && is_hmd) {
+		struct u_device_recorder_hmd rhmd;
+		ok = read_bytes(r, &rhmd, sizeof(rhmd));
+
+		struct xrt_hmd_parts *hmd = d->base.hmd;
+		hmd->screens[0].w_pixels = rhmd.w_pixels;
+		hmd->screens[0].h_pixels = rhmd.h_pixels;
+		hmd->screens[0].nominal_frame_interval_ns = rhmd.nominal_frame_interval_ns;
+		hmd->view_count = CLAMP(rhmd.view_count, 1, XRT_MAX_VIEWS);
+		hmd->blend_mode_count = MIN(rhmd.blend_mode_count, XRT_MAX_DEVICE_BLEND_MODES);
+		for (size_t i = 0; i < hmd->blend_mode_count; i++) {
+			hmd->blend_modes[i] = (enum xrt_blend_mode)rhmd.blend_modes[i];
+		}
+		memcpy(hmd->views, rhmd.views, sizeof(hmd->views));
+		memcpy(hmd->distortion.fov, rhmd.distortion_fov, sizeof(hmd->distortion.fov));
+
+		// The distortion is already baked into what was recorded.
+		u_distortion_mesh_set_none(&d->base);
+	}
+
+	if (!ok) {
+		replay_destroy(&d->base);
+		return NULL;
+	}
+
+	return d;
+}
+
+static bool
+add_tracked_pose(struct replay_device *d, const struct u_device_recorder_tracked_pose *rec)
+{
+	enum xrt_input_name name = (enum xrt_input_name)rec->name;
+	struct replay_pose_track *track = find_pose_track(d, name);
+
+	if (track == NULL) {
+		U_ARRAY_REALLOC_OR_FREE(d->pose_tracks, struct replay_pose_track, d->pose_track_count + 1);
+		if (d->pose_tracks == NULL) {
+			d->pose_track_count = 0;
+			return false;
+		}
+		track = &d->pose_tracks[d->pose_track_count++];
+		U_ZERO(track);
+		track->name = name;
+	}
+
+	if (!grow((void **)&track->samples, sizeof(*track->samples), track->count, &track->capacity)) {
+		return false;
+	}
+
+	track->samples[track->count].at_timestamp_ns = rec->at_timestamp_ns;
+	track->samples[track->count].relation = rec->relation;
+	track->count++;
+
+	return true;
+}
+
+static bool
+add_hand_tracking(struct replay_device *d, const struct u_device_recorder_hand_tracking *rec)
+{
+	enum xrt_input_name name = (enum xrt_input_name)rec->name;
+	struct replay_hand_track *track = find_hand_track(d, name);
+
+	if (track == NULL) {
+		U_ARRAY_REALLOC_OR_FREE(d->hand_tracks, struct replay_hand_track, d->hand_track_count + 1);
+		if (d->hand_tracks == NULL) {
+			d->hand_track_count = 0;
+			return false;
+		}
+		track = &d->hand_tracks[d->hand_track_count++];
+		U_ZERO(track);
+		track->name = name;
+	}
+
+	if (!grow((void **)&track->samples, sizeof(*track->samples), track->count, &track->capacity)) {
+		return false;
+	}
+
+	track->samples[track->count++] = *rec;
+
+	return true;
+}
+
+static bool
+add_inputs(struct replay_device *d, struct reader *r, int64_t when_ns)
+{
+	struct u_device_recorder_inputs header;
+	if (!read_bytes(r, &header, sizeof(header))) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header.count; i++) {
+		struct u_device_recorder_input input;
+		if (!read_bytes(r, &input, sizeof(input)) || input.index >= d->base.input_count) {
+			return false;
+		}
+
+		if (!grow((void **)&d->inputs, sizeof(*d->inputs), d->input_sample_count, &d->input_sample_capacity)) {
+			return false;
+		}
+
+		d->inputs[d->input_sample_count].when_ns = when_ns;
+		d->inputs[d->input_sample_count].input = input;
+		d->input_sample_count++;
+	}
+
+	return true;
+}
+
+static bool
+add_view_poses(struct replay_device *d, const struct u_device_recorder_view_poses *rec)
+{
+	if (rec->view_count == 0 || rec->view_count > XRT_MAX_VIEWS) {
+		return false;
+	}
+
+	if (!grow((void **)&d->views, sizeof(*d->views), d->view_sample_count, &d->view_sample_capacity)) {
+		return false;
+	}
+
+	d->views[d->view_sample_count++] = *rec;
+
+	return true;
+}
+
+static bool
+read_file(const char *path, uint8_t **out_data, size_t *out_size)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size <= 0) {
+		fclose(file);
+		return false;
+	}
+
+	uint8_t *data = U_TYPED_ARRAY_CALLOC(uint8_t, (size_t)size);
+	size_t read = fread(data, 1, (size_t)size, file);
+	fclose(file);
+
+	if (read != (size_t)size) {
+		free(data);
+		return false;
+	}
+
+	*out_data = data;
+	*out_size = (size_t)size;
+
+	return true;
+}
+
+static xrt_result_t
+parse_records(struct reader *r,
+              struct xrt_tracking_origin *origin,
+              struct replay_device **devices,
+              uint32_t max_device_count,
+              uint32_t *out_device_count,
+              struct u_device_recorder_roles *out_roles,
+              int64_t *out_end_ns)
+{
+	uint32_t device_count = 0;
+	int64_t end_ns = 0;
+
+	while (r->offset < r->size) {
+		struct u_device_recorder_record_header header;
+		if (!read_bytes(r, &header, sizeof(header)) || header.size > r->size - r->offset) {
+			REPLAY_ERROR("Truncated record at offset %zu, ignoring the rest", r->offset);
+			break;
+		}
+
+		struct reader payload = {r->data + r->offset, header.size, 0};
+		r->offset += header.size;
+		end_ns = MAX(end_ns, header.timestamp_ns);
+
+		if (header.type == U_DEVICE_RECORDER_RECORD_DEVICE) {
+			if (header.device != device_count || device_count >= max_device_count) {
+				REPLAY_ERROR("Unexpected device %u", header.device);
+				return XRT_ERROR_DEVICE_CREATION_FAILED;
+			}
+			devices[device_count] = create_device(&payload, origin);
+			if (devices[device_count] == NULL) {
+				REPLAY_ERROR("Malformed device %u", header.device);
+				return XRT_ERROR_DEVICE_CREATION_FAILED;
+			}
+			device_count++;
+			*out_device_count = device_count;
+			continue;
+		}
+
+		if (header.type == U_DEVICE_RECORDER_RECORD_ROLES) {
+			read_bytes(&payload, out_roles, sizeof(*out_roles));
+			continue;
+		}
+
+		if (header.device >= device_count) {
+			REPLAY_ERROR("Record for unknown device %u", header.device);
+			return XRT_ERROR_DEVICE_CREATION_FAILED;
+		}
+
+		struct replay_device *d = devices[header.device];
+		bool ok = true;
+
+		switch (header.type) {
+		case U_DEVICE_RECORDER_RECORD_TRACKED_POSE: {
+			struct u_device_recorder_tracked_pose rec;
+			ok = read_bytes(&payload, &rec, sizeof(rec)) && add_tracked_pose(d, &rec);
+		} break;
+		case U_DEVICE_RECORDER_RECORD_INPUTS: {
+			ok = add_inputs(d, &payload, header.timestamp_ns);
+		} break;
+		case U_DEVICE_RECORDER_RECORD_HAND_TRACKING: {
+			struct u_device_recorder_hand_tracking rec;
+			ok = read_bytes(&payload, &rec, sizeof(rec)) && add_hand_tracking(d, &rec);
+		} break;
+		case U_DEVICE_RECORDER_RECORD_VIEW_POSES: {
+			struct u_device_recorder_view_poses rec;
+			ok = read_bytes(&payload, &rec, sizeof(rec)) && add_view_poses(d, &rec);
+		} break;
+		default: REPLAY_DEBUG("Skipping unknown record type %u", header.type); break;
+		}
+
+		if (!ok) {
+			REPLAY_ERROR("Malformed record of type %u", header.type);
+			return XRT_ERROR_DEVICE_CREATION_FAILED;
+		}
+	}
+
+	*out_end_ns = end_ns;
+
+	return XRT_SUCCESS;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+xrt_result_t
+replay_create_devices(const char *path,
+                      int64_t start_ns,
+                      struct xrt_tracking_origin *origin,
+                      struct xrt_device **out_xdevs,
+                      uint32_t max_xdev_count,
+                      uint32_t *out_xdev_count,
+                      struct u_device_recorder_roles *out_roles)
+{
+	uint8_t *data = NULL;
+	size_t size = 0;
+	if (!read_file(path, &data, &size)) {
+		REPLAY_ERROR("Could not read '%s'", path);
+		return XRT_ERROR_DEVICE_CREATION_FAILED;
+	}
+
+	struct reader r = {data, size, 0};
+	struct u_device_recorder_file_header file_header;
+	if (!read_bytes(&r, &file_header, sizeof(file_header)) ||
+	    memcmp(file_header.magic, U_DEVICE_RECORDER_MAGIC, sizeof(file_header.magic)) != 0 ||
+	    file_header.version != U_DEVICE_RECORDER_VERSION) {
+		REPLAY_ERROR("'%s' is not a version %u device recording", path, U_DEVICE_RECORDER_VERSION);
+		free(data);
+		return XRT_ERROR_DEVICE_CREATION_FAILED;
+	}
+
+	struct replay_device **devices = U_TYPED_ARRAY_CALLOC(struct replay_device *, max_xdev_count);
+	struct u_device_recorder_roles roles = {-1, -1, -1, -1, -1};
+	uint32_t device_count = 0;
+	int64_t end_ns = 0;
+
+	xrt_result_t xret = parse_records(&r, origin, devices, max_xdev_count, &device_count, &roles, &end_ns);
+	free(data);
+
+	if (xret != XRT_SUCCESS) {
+		for (uint32_t i = 0; i < device_count; i++) {
+			replay_destroy(&devices[i]->base);
+		}
+		free(devices);
+		return xret;
+	}
+
+	// Never divide by zero when looping a recording without data.
+	int64_t duration_ns = MAX(end_ns - file_header.start_ns, (int64_t)U_TIME_1MS_IN_NS);
+
+	for (uint32_t i = 0; i < device_count; i++) {
+		struct replay_device *d = devices[i];
+
+		d->rec_start_ns = file_header.start_ns;
+		d->rec_duration_ns = duration_ns;
+		d->replay_start_ns = start_ns;
+		d->input_loop = -1;
+
+		for (uint32_t k = 0; k < d->pose_track_count; k++) {
+			struct replay_pose_track *track = &d->pose_tracks[k];
+			qsort(track->samples, track->count, sizeof(*track->samples), compare_pose_samples);
+		}
+		for (uint32_t k = 0; k < d->hand_track_count; k++) {
+			struct replay_hand_track *track = &d->hand_tracks[k];
+			qsort(track->samples, track->count, sizeof(*track->samples), compare_hand_samples);
+		}
+		qsort(d->views, d->view_sample_count, sizeof(*d->views), compare_view_samples);
+
+		REPLAY_INFO("Replaying '%s' with %u pose tracks, %zu input changes and %zu view samples",
+		            d->base.str, d->pose_track_count, d->input_sample_count, d->view_sample_count);
+
+		out_xdevs[i] = &d->base;
+	}
+
+	*out_xdev_count = device_count;
+	*out_roles = roles;
+	free(devices);
+
+	return XRT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Interface to the replay driver.
+ * @ingroup drv_replay
+ */
+
+#pragma once
+
+#include "xrt/xrt_compiler.h"
+#include "xrt/xrt_results.h"
+#include "util/u_device_recorder.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * @defgroup drv_replay Replay driver
+ * @ingroup drv
+ *
+ * @brief Plays back device streams captured with @ref u_device_recorder.
+ */
+
+/*!
+ * @dir drivers/replay
+ *
+ * @brief @ref drv_replay files.
+ */
+
+/*!
+ * Load the recording at @p path and create one device for each recorded one,
+ * mimicking its name, inputs, outputs, binding profiles and display. The
+ * devices answer queries with the recorded results, the recording is mapped
+ * so that its start lines up with @p start_ns and is looped.
+ *
+ * @param path           File written by @ref u_device_recorder.
+ * @param start_ns       Monotonic time the replay starts at.
+ * @param origin         Tracking origin given to all devices.
+ * @param out_xdevs      Array the created devices are written to.
+ * @param max_xdev_count Size of @p out_xdevs.
+ * @param out_xdev_count Number of devices created.
+ * @param out_roles      Recorded roles, indices into @p out_xdevs.
+ *
+ * @ingroup drv_replay
+ */
+xrt_result_t
+replay_create_devices(const char *path,
+                      int64_t start_ns,
+                      struct xrt_tracking_origin *origin,
+                      struct xrt_device **out_xdevs,
+                      uint32_t max_xdev_count,
+                      uint32_t *out_xdev_count,
+                      struct u_device_recorder_roles *out_roles);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -393,11 +393,6 @@ receive_cam_frame(struct xrt_frame_sink *sink, struct xrt_frame *xf)
 		int y_offset = get_y_offset(cam, 0, &row_data);
 		struct xrt_rect roi = {.offset = {0, y_offset}, .extent = {.w = xf->width, .h = 480}};
 
-		struct xrt_frame *xf_crop = NULL;
-		u_frame_create_roi(xf, roi, &xf_crop);
-		u_sink_debug_push_frame(&cam->debug_sinks[0], xf_crop);
-		xrt_frame_reference(&xf_crop, NULL);
-
 		/* Extract camera frames and push to the tracker */
 		struct xrt_frame *frames[RIFT_S_CAMERA_COUNT] = {0};
 		for (int i = 0; i < RIFT_S_CAMERA_COUNT; i++) {
@@ -414,6 +409,12 @@ receive_cam_frame(struct xrt_frame_sink *sink, struct xrt_frame *xf)
 		for (int i = 0; i < RIFT_S_CAMERA_COUNT; i++) {
 			xrt_frame_reference(&frames[i], NULL);
 		}
+
+		/* Debug sinks last, so a slow consumer there does not delay SLAM */
+		struct xrt_frame *xf_crop = NULL;
+		u_frame_create_roi(xf, roi, &xf_crop);
+		u_sink_debug_push_frame(&cam->debug_sinks[0], xf_crop);
+		xrt_frame_reference(&xf_crop, NULL);
 	} else {
 		struct xrt_rect roi = {.offset = {0, 40}, .extent = {.w = xf->width, .h = 480}};
 		struct xrt_frame *xf_crop = NULL;
@@ -24,7 +24,6 @@
 #include <inttypes.h>
 
 #include "math/m_api.h"
-#include "math/m_clock_offset.h"
 #include "math/m_space.h"
 #include "math/m_vec3.h"
 
@@ -340,6 +339,8 @@ rift_s_tracker_create(struct xrt_tracking_origin *origin,
 		return NULL;
 	}
 
+	m_clock_sync_init(&t->clock, 0);
+
 	// Compute IMU and camera device poses for get_tracked_pose relations
 	math_pose_from_isometry(&hmd_config->imu_calibration.device_from_imu, &t->device_from_imu);
 
@@ -417,15 +418,32 @@ rift_s_tracker_create(struct xrt_tracking_origin *origin,
 	// Setup sinks depending on tracking configuration
 	struct xrt_slam_sinks entry_sinks = {0};
 	if (slam_enabled && hand_enabled) {
-		struct xrt_frame_sink *entry_cam0_sink = NULL;
-		struct xrt_frame_sink *entry_cam1_sink = NULL;
-
-		u_sink_split_create(xfctx, slam_sinks->cams[0], hand_sinks->cams[0], &entry_cam0_sink);
-		u_sink_split_create(xfctx, slam_sinks->cams[1], hand_sinks->cams[1], &entry_cam1_sink);
-
 		entry_sinks = *slam_sinks;
-		entry_sinks.cams[0] = entry_cam0_sink;
-		entry_sinks.cams[1] = entry_cam1_sink;
+
+		// SLAM always gets the frame first, the hand tracker has its own async stage.
+		for (int i = 0; i < 2; i++) {
+			struct u_sink_fanout_consumer consumers[2] = {
+			    {
+			        .sink = slam_sinks->cams[i],
+			        .name = "SLAM",
+			        .priority = 100,
+			        .policy = U_SINK_FANOUT_SYNC,
+			    },
+			    {
+			        .sink = hand_sinks->cams[i],
+			        .name = "Hand tracking",
+			        .priority = 0,
+			        .policy = U_SINK_FANOUT_SYNC,
+			    },
+			};
+			char name[32];
+			(void)snprintf(name, sizeof(name), "Rift S cam%d routing", i);
+			if (!u_sink_fanout_create(xfctx, name, consumers, 2, &entry_sinks.cams[i])) {
+				RIFT_S_WARN("Unable to setup the camera routing");
+				rift_s_tracker_destroy(t);
+				return NULL;
+			}
+		}
 	} else if (slam_enabled) {
 		entry_sinks = *slam_sinks;
 	} else if (hand_enabled) {
@@ -465,18 +483,16 @@ void
 rift_s_tracker_clock_update(struct rift_s_tracker *t, uint64_t device_timestamp_ns, timepoint_ns local_timestamp_ns)
 {
 	os_mutex_lock(&t->mutex);
-	time_duration_ns last_hw2mono = t->hw2mono;
-	const float freq = 250.0;
 
 	t->seen_clock_observations++;
 	if (t->seen_clock_observations < 100)
 		goto done;
 
-	m_clock_offset_a2b(freq, device_timestamp_ns, local_timestamp_ns, &t->hw2mono);
+	m_clock_sync_update(&t->clock, device_timestamp_ns, local_timestamp_ns);
 
-	if (!t->have_hw2mono) {
-		time_duration_ns change_ns = last_hw2mono - t->hw2mono;
-		if (change_ns >= -U_TIME_HALF_MS_IN_NS && change_ns <= U_TIME_HALF_MS_IN_NS) {
+	if (!t->have_hw2mono && m_clock_sync_is_ready(&t->clock)) {
+		double error_ns = m_clock_sync_get_error(&t->clock, device_timestamp_ns);
+		if (error_ns >= 0 && error_ns <= U_TIME_HALF_MS_IN_NS) {
 			RIFT_S_INFO("HMD device to local clock map stabilised");
 			t->have_hw2mono = true;
 		}
@@ -489,7 +505,7 @@ done:
 static void
 clock_hw2mono_get(struct rift_s_tracker *t, uint64_t device_ts, timepoint_ns *out)
 {
-	*out = t->hw2mono + device_ts;
+	*out = m_clock_sync_hw2mono(&t->clock, device_ts);
 }
 
 void
@@ -521,7 +537,8 @@ rift_s_tracker_imu_update(struct rift_s_tracker *t,
 	RIFT_S_TRACE("IMU timestamp %" PRIu64 " (dt %f) hw2mono local ts %" PRIu64 " (dt %f) offset %" PRId64,
 	             device_timestamp_ns,
 	             (double)(device_timestamp_ns - t->fusion.last_imu_timestamp_ns) / 1000000000.0, local_timestamp_ns,
-	             (double)(local_timestamp_ns - t->fusion.last_imu_local_timestamp_ns) / 1000000000.0, t->hw2mono);
+	             (double)(local_timestamp_ns - t->fusion.last_imu_local_timestamp_ns) / 1000000000.0,
+	             local_timestamp_ns - (timepoint_ns)device_timestamp_ns);
 
 	t->fusion.last_angular_velocity = *gyro;
 	t->fusion.last_imu_timestamp_ns = device_timestamp_ns;
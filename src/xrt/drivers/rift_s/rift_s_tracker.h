@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include "math/m_clock_sync.h"
 #include "math/m_imu_3dof.h"
 #include "os/os_threading.h"
 #include "util/u_var.h"
@@ -83,10 +84,10 @@ struct rift_s_tracker
 	struct xrt_pose device_from_imu;
 	struct xrt_pose left_cam_from_imu;
 
-	//!< Estimated offset from HMD device timestamp to local monotonic clock
+	//!< Filtered mapping from HMD device timestamp to local monotonic clock
 	uint64_t seen_clock_observations;
 	bool have_hw2mono;
-	time_duration_ns hw2mono;
+	struct m_clock_sync clock;
 	timepoint_ns last_frame_time;
 
 	//! Adjustment to apply to camera timestamps to bring them into the
@@ -68,6 +68,8 @@
 DEBUG_GET_ONCE_BOOL_OPTION(survive_disable_hand_emulation, "SURVIVE_DISABLE_HAND_EMULATION", false)
 DEBUG_GET_ONCE_BOOL_OPTION(survive_default_ipd, "SURVIVE_DEFAULT_IPD", false)
 DEBUG_GET_ONCE_FLOAT_OPTION(survive_timecode_offset_ms, "SURVIVE_TIMECODE_OFFSET_MS", 0.0)
+DEBUG_GET_ONCE_OPTION(survive_hmd_predict_model, "SURVIVE_HMD_PREDICT_MODEL", NULL)
+DEBUG_GET_ONCE_OPTION(survive_controller_predict_model, "SURVIVE_CONTROLLER_PREDICT_MODEL", NULL)
 
 #define SURVIVE_TRACE(d, ...) U_LOG_XDEV_IFL_T(&d->base, d->sys->log_level, __VA_ARGS__)
 #define SURVIVE_DEBUG(d, ...) U_LOG_XDEV_IFL_D(&d->base, d->sys->log_level, __VA_ARGS__)
@@ -894,6 +896,28 @@ compute_distortion(struct xrt_device *xdev, uint32_t view, float u, float v, str
 	return status;
 }
 
+static bool
+compute_distortion_batch(struct xrt_device *xdev,
+                         uint32_t view,
+                         const float *u,
+                         const float *v,
+                         uint32_t count,
+                         struct u_uv_triplet_batch *out)
+{
+	struct survive_device *d = (struct survive_device *)xdev;
+	bool status = u_compute_distortion_vive_batch(&d->hmd.config.distortion.values[view], u, v, count, out);
+
+	if (d->hmd.config.variant == VIVE_VARIANT_PRO2) {
+		// Flip Y coordinates
+		for (uint32_t i = 0; i < count; i++) {
+			out->r_y[i] = 1.0f - out->r_y[i];
+			out->g_y[i] = 1.0f - out->g_y[i];
+			out->b_y[i] = 1.0f - out->b_y[i];
+		}
+	}
+	return status;
+}
+
 static bool
 _create_hmd_device(struct survive_system *sys, const struct SurviveSimpleObject *sso, char *conf_str)
 {
@@ -923,6 +947,8 @@ _create_hmd_device(struct survive_system *sys, const struct SurviveSimpleObject
 
 	SURVIVE_INFO(survive, "survive HMD present");
 	m_relation_history_create(&survive->relation_hist);
+	m_relation_history_set_predict_model_from_string(survive->relation_hist,
+	                                                 debug_get_option_survive_hmd_predict_model());
 
 
 	size_t idx = 0;
@@ -973,6 +999,7 @@ _create_hmd_device(struct survive_system *sys, const struct SurviveSimpleObject
 	survive->base.hmd->distortion.models = XRT_DISTORTION_MODEL_COMPUTE;
 	survive->base.hmd->distortion.preferred = XRT_DISTORTION_MODEL_COMPUTE;
 	survive->base.compute_distortion = compute_distortion;
+	u_distortion_mesh_fill_in_batch(&survive->base, compute_distortion_batch);
 
 	survive->base.orientation_tracking_supported = true;
 	survive->base.position_tracking_supported = true;
@@ -1071,6 +1098,8 @@ _create_controller_device(struct survive_system *sys,
 	struct survive_device *survive = U_DEVICE_ALLOCATE(struct survive_device, flags, inputs, outputs);
 	survive->ctrl.config = *config;
 	m_relation_history_create(&survive->relation_hist);
+	m_relation_history_set_predict_model_from_string(survive->relation_hist,
+	                                                 debug_get_option_survive_controller_predict_model());
 
 	sys->controllers[idx] = survive;
 	survive->sys = sys;
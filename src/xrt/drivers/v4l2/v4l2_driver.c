@@ -58,6 +58,8 @@
 
 DEBUG_GET_ONCE_LOG_OPTION(v4l2_log, "V4L2_LOG", U_LOGGING_WARN)
 DEBUG_GET_ONCE_NUM_OPTION(v4l2_exposure_absolute, "V4L2_EXPOSURE_ABSOLUTE", 10)
+DEBUG_GET_ONCE_BOOL_OPTION(v4l2_dmabuf, "V4L2_DMABUF", false)
+DEBUG_GET_ONCE_BOOL_OPTION(v4l2_live_stats, "V4L2_LIVE_STATS", false)
 
 /*!
  * Streaming thread entrypoint
@@ -88,12 +90,48 @@ align_up(size_t size, size_t align)
 	return size + (align - (size % align));
 }
 
+static void
+v4l2_stats_print_and_reset_locked(struct v4l2_fs *vid)
+{
+	struct u_pp_sink_stack_only sink;
+	u_pp_delegate_t dg = u_pp_sink_stack_only_init(&sink);
+
+	u_pp(dg, "V4L2 '%s' capture latency:\n", vid->base.name);
+	u_ls_ns_print_header(dg);
+	u_pp(dg, "\n");
+	u_ls_ns_print_and_reset(&vid->stats.push, dg);
+	u_pp(dg, "\n");
+	u_ls_ns_print_and_reset(&vid->stats.release, dg);
+
+	U_LOG_IFL_I(U_LOGGING_INFO, "%s", sink.buffer);
+}
+
+static void
+v4l2_stats_add(struct v4l2_fs *vid, struct u_live_stats_ns *uls, uint64_t capture_ns)
+{
+	if (!vid->stats.enabled || capture_ns == 0) {
+		return;
+	}
+
+	uint64_t now_ns = os_monotonic_get_ns();
+	uint64_t latency_ns = now_ns > capture_ns ? now_ns - capture_ns : 0;
+
+	// Frames are released from consumer threads.
+	pthread_mutex_lock(&vid->stats.mutex);
+	if (u_ls_ns_add(uls, latency_ns)) {
+		v4l2_stats_print_and_reset_locked(vid);
+	}
+	pthread_mutex_unlock(&vid->stats.mutex);
+}
+
 static void
 v4l2_free_frame(struct xrt_frame *xf)
 {
 	struct v4l2_frame *vf = (struct v4l2_frame *)xf;
 	struct v4l2_fs *vid = (struct v4l2_fs *)xf->owner;
 
+	v4l2_stats_add(vid, &vid->stats.release, xf->timestamp);
+
 	vid->used_frames--;
 
 	if (!vid->is_running) {
@@ -286,6 +324,41 @@ v4l2_try_mmap(struct v4l2_fs *vid, struct v4l2_requestbuffers *v_bufrequest)
 	return -1;
 }
 
+/*!
+ * Export a mmap buffer as a DMABUF, only kernel allocated buffers can be
+ * exported, so this requires @p V4L2_MEMORY_MMAP.
+ */
+static int
+v4l2_export_dmabuf(struct v4l2_fs *vid, struct v4l2_frame *vf, uint32_t index)
+{
+	struct v4l2_exportbuffer expbuf = {0};
+	expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	expbuf.index = index;
+	expbuf.plane = 0;
+	expbuf.flags = O_RDONLY | O_CLOEXEC;
+
+	if (ioctl(vid->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+		V4L2_DEBUG(vid, "info: Driver can not export buffer %u as DMABUF.", index);
+		return -1;
+	}
+
+	vf->dmabuf_fd = expbuf.fd;
+
+	return 0;
+}
+
+static void
+v4l2_close_dmabufs(struct v4l2_fs *vid)
+{
+	for (uint32_t i = 0; i < NUM_V4L2_BUFFERS; i++) {
+		if (vid->frames[i].dmabuf_fd >= 0) {
+			close(vid->frames[i].dmabuf_fd);
+		}
+		vid->frames[i].dmabuf_fd = -1;
+	}
+	vid->capture.dmabuf = false;
+}
+
 static int
 v4l2_setup_mmap_buffer(struct v4l2_fs *vid, struct v4l2_frame *vf, struct v4l2_buffer *v_buf)
 {
@@ -634,6 +707,8 @@ v4l2_fs_destroy(struct v4l2_fs *vid)
 		vid->num_descriptors = 0;
 	}
 
+	v4l2_close_dmabufs(vid);
+
 	vid->capture.mmap = false;
 	if (vid->capture.userptr) {
 		vid->capture.userptr = false;
@@ -648,6 +723,8 @@ v4l2_fs_destroy(struct v4l2_fs *vid)
 		vid->fd = -1;
 	}
 
+	pthread_mutex_destroy(&vid->stats.mutex);
+
 	free(vid);
 }
 
@@ -682,6 +759,14 @@ v4l2_fs_create(struct xrt_frame_context *xfctx,
 	vid->node.destroy = v4l2_fs_node_destroy;
 	vid->log_level = debug_get_log_option_v4l2_log();
 	vid->fd = -1;
+	vid->stats.enabled = debug_get_bool_option_v4l2_live_stats();
+	pthread_mutex_init(&vid->stats.mutex, NULL);
+	snprintf(vid->stats.push.name, sizeof(vid->stats.push.name), "push");
+	snprintf(vid->stats.release.name, sizeof(vid->stats.release.name), "release");
+
+	for (uint32_t i = 0; i < NUM_V4L2_BUFFERS; i++) {
+		vid->frames[i].dmabuf_fd = -1;
+	}
 
 	snprintf(vid->base.product, sizeof(vid->base.product), "%s", product);
 	snprintf(vid->base.manufacturer, sizeof(vid->base.manufacturer), "%s", manufacturer);
@@ -690,6 +775,7 @@ v4l2_fs_create(struct xrt_frame_context *xfctx,
 	int fd = open(path, O_RDWR, 0);
 	if (fd < 0) {
 		V4L2_ERROR(vid, "Cannot open '%s'", path);
+		pthread_mutex_destroy(&vid->stats.mutex);
 		free(vid);
 		return NULL;
 	}
@@ -711,6 +797,8 @@ v4l2_fs_create(struct xrt_frame_context *xfctx,
 	u_var_add_root(vid, "V4L2 Frameserver", true);
 	u_var_add_ro_text(vid, vid->base.name, "Card");
 	u_var_add_log_level(vid, &vid->log_level, "Log Level");
+	u_var_add_ro_text(vid, debug_get_bool_option_v4l2_dmabuf() ? "requested" : "off", "DMABUF export");
+	u_var_add_bool(vid, &vid->capture.dmabuf, "DMABUF active");
 	for (size_t i = 0; i < vid->num_states; i++) {
 		u_var_add_i32(vid, &vid->states[i].want[0].value, vid->states[i].name);
 	}
@@ -739,14 +827,20 @@ v4l2_fs_mainloop(void *ptr)
 	struct v4l2_source_descriptor *desc = &vid->descriptors[vid->selected];
 
 	// set up our buffers - prefer userptr (client alloc) vs mmap (kernel
-	// alloc)
+	// alloc), unless DMABUF export was requested which needs mmap buffers.
 	// TODO: using buffer caps may be better than 'fallthrough to mmap'
 	struct v4l2_requestbuffers v_bufrequest;
 	U_ZERO(&v_bufrequest);
 	v_bufrequest.count = NUM_V4L2_BUFFERS;
 	v_bufrequest.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-	if (v4l2_try_userptr(vid, &v_bufrequest) != 0 && v4l2_try_mmap(vid, &v_bufrequest) != 0) {
+	bool got_buffers = false;
+	if (debug_get_bool_option_v4l2_dmabuf()) {
+		got_buffers = v4l2_try_mmap(vid, &v_bufrequest) == 0;
+		vid->capture.dmabuf = got_buffers;
+	}
+
+	if (!got_buffers && v4l2_try_userptr(vid, &v_bufrequest) != 0 && v4l2_try_mmap(vid, &v_bufrequest) != 0) {
 		V4L2_ERROR(vid, "error: Driver does not support mmap or userptr.");
 		return NULL;
 	}
@@ -774,6 +868,11 @@ v4l2_fs_mainloop(void *ptr)
 		if (vid->capture.mmap && v4l2_setup_mmap_buffer(vid, vf, v_buf) != 0) {
 			return NULL;
 		}
+		if (vid->capture.dmabuf && v4l2_export_dmabuf(vid, vf, i) != 0) {
+			// The frames still have their mmap memory, just no handles.
+			V4L2_WARN(vid, "DMABUF export failed, falling back to plain mmap.");
+			v4l2_close_dmabufs(vid);
+		}
 
 		// Silence valgrind.
 		memset(vf->mem, 0, v_buf->length);
@@ -785,6 +884,9 @@ v4l2_fs_mainloop(void *ptr)
 		}
 	}
 
+	V4L2_INFO(vid, "Capturing with %s buffers%s.", vid->capture.userptr ? "userptr" : "mmap",
+	          vid->capture.dmabuf ? " exported as DMABUFs" : "");
+
 	int start_capture = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	if (ioctl(vid->fd, VIDIOC_STREAMON, &start_capture) < 0) {
 		V4L2_ERROR(vid, "error: Could not start capture!");
@@ -836,6 +938,13 @@ v4l2_fs_mainloop(void *ptr)
 		xf->source_id = vid->base.source_id;
 		xf->source_sequence = v_buf.sequence;
 
+		xf->native.valid = vf->dmabuf_fd >= 0;
+		if (xf->native.valid) {
+			xf->native.handle = vf->dmabuf_fd;
+			xf->native.offset = desc->offset;
+			xf->native.size = vf->v_buf.length;
+		}
+
 		if ((v_buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) != 0) {
 			xf->timestamp = os_timeval_to_ns(&v_buf.timestamp);
 			xf->source_timestamp = xf->timestamp;
@@ -843,6 +952,8 @@ v4l2_fs_mainloop(void *ptr)
 
 		vid->sink->push_frame(vid->sink, xf);
 
+		v4l2_stats_add(vid, &vid->stats.push, xf->timestamp);
+
 		// Checks if active.
 		u_sink_debug_push_frame(&vid->usd, xf);
 
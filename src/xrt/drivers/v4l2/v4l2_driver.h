@@ -11,8 +11,10 @@
 
 #include "util/u_logging.h"
 #include "util/u_sink.h"
+#include "util/u_live_stats.h"
 #include "xrt/xrt_frameserver.h"
 #include <linux/videodev2.h>
+#include <pthread.h>
 
 
 /*
@@ -46,6 +48,9 @@ struct v4l2_frame
 
 	void *mem; //!< Data might be at an offset, so we need base memory.
 
+	//! Exported DMABUF file descriptor for this buffer, -1 if not exported.
+	int dmabuf_fd;
+
 	struct v4l2_buffer v_buf;
 };
 
@@ -108,8 +113,23 @@ struct v4l2_fs
 	{
 		bool mmap;
 		bool userptr;
+		//! The mmap buffers are also exported as DMABUFs.
+		bool dmabuf;
 	} capture;
 
+	/*!
+	 * Latency statistics, from the driver capture timestamp to when the
+	 * frame is handed to the sink and to when the last consumer releases
+	 * it, only gathered if V4L2_LIVE_STATS is set.
+	 */
+	struct
+	{
+		bool enabled;
+		pthread_mutex_t mutex;
+		struct u_live_stats_ns push;
+		struct u_live_stats_ns release;
+	} stats;
+
 	struct xrt_frame_sink *sink;
 
 	pthread_t stream_thread;
@@ -168,9 +168,13 @@ vive_controller_device_destroy(struct xrt_device *xdev)
 {
 	struct vive_controller_device *d = vive_controller_device(xdev);
 
-	os_thread_helper_destroy(&d->controller_thread);
+	// After this no callbacks for our device are running.
+	if (d->reader != NULL) {
+		vive_hid_reader_remove(d->reader, d->controller_hid);
+		vive_hid_reader_unref(&d->reader);
+	}
 
-	// Now that the thread is not running we can destroy the lock.
+	// Now that the reader is not calling us we can destroy the lock.
 	os_mutex_destroy(&d->lock);
 
 	os_mutex_destroy(&d->fusion.mutex);
@@ -544,12 +548,60 @@ controller_handle_analog_trigger(struct vive_controller_device *d, struct vive_c
 }
 
 
+/*!
+ * Hand all samples decoded in this wakeup to fusion, taking the fusion lock
+ * only once for the whole batch.
+ */
+static void
+vive_controller_flush_imu(struct vive_controller_device *d)
+{
+	XRT_TRACE_MARKER();
+
+	uint32_t count = d->imu.batch_count;
+	if (count == 0) {
+		return;
+	}
+
+	struct m_imu_3dof_sample samples[VIVE_CONTROLLER_IMU_BATCH_MAX_SAMPLES];
+	struct xrt_quat rots[VIVE_CONTROLLER_IMU_BATCH_MAX_SAMPLES];
+	uint64_t received_ns[VIVE_CONTROLLER_IMU_BATCH_MAX_SAMPLES];
+	uint64_t device_ns[VIVE_CONTROLLER_IMU_BATCH_MAX_SAMPLES];
+	uint64_t history_ns[VIVE_CONTROLLER_IMU_BATCH_MAX_SAMPLES];
+
+	for (uint32_t i = 0; i < count; i++) {
+		samples[i].timestamp_ns = d->imu.batch[i].timestamp_ns;
+		samples[i].accel = d->imu.batch[i].acc;
+		samples[i].gyro = d->imu.batch[i].gyro;
+		received_ns[i] = d->imu.batch[i].received_ns;
+		device_ns[i] = samples[i].timestamp_ns;
+	}
+
+	vive_hid_reader_spread_timestamps(received_ns, device_ns, count, history_ns);
+
+	os_mutex_lock(&d->fusion.mutex);
+	m_imu_3dof_update_batch(&d->fusion.i3dof, samples, count, rots);
+	os_mutex_unlock(&d->fusion.mutex);
+
+	struct xrt_space_relation rel = {0};
+	rel.relation_flags = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT;
+
+	for (uint32_t i = 0; i < count; i++) {
+		rel.pose.orientation = rots[i];
+		m_relation_history_push(d->fusion.relation_hist, &rel, history_ns[i]);
+	}
+
+	// Update the pose we show in the GUI.
+	d->pose = rel.pose;
+
+	d->imu.batch_count = 0;
+}
+
 static void
 vive_controller_handle_imu_sample(struct vive_controller_device *d, struct watchman_imu_sample *sample)
 {
 	XRT_TRACE_MARKER();
 
-	uint64_t now_ns = os_monotonic_get_ns();
+	uint64_t now_ns = d->imu.received_ns;
 
 	/* ouvrt: "Time in 48 MHz ticks, but we are missing the low byte" */
 	uint32_t time_raw = d->last_ticks | (sample->timestamp_hi << 8);
@@ -612,18 +664,15 @@ vive_controller_handle_imu_sample(struct vive_controller_device *d, struct watch
 	d->last.acc = acceleration;
 	d->last.gyro = angular_velocity;
 
-	struct xrt_space_relation rel = {0};
-	rel.relation_flags = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT;
-
-	os_mutex_lock(&d->fusion.mutex);
-	m_imu_3dof_update(&d->fusion.i3dof, d->imu.last_sample_ts_ns, &acceleration, &angular_velocity);
-	rel.pose.orientation = d->fusion.i3dof.rot;
-	os_mutex_unlock(&d->fusion.mutex);
-
-	m_relation_history_push(d->fusion.relation_hist, &rel, now_ns);
+	if (d->imu.batch_count >= VIVE_CONTROLLER_IMU_BATCH_MAX_SAMPLES) {
+		vive_controller_flush_imu(d);
+	}
 
-	// Update the pose we show in the GUI.
-	d->pose = rel.pose;
+	uint32_t index = d->imu.batch_count++;
+	d->imu.batch[index].timestamp_ns = d->imu.last_sample_ts_ns;
+	d->imu.batch[index].received_ns = now_ns;
+	d->imu.batch[index].acc = acceleration;
+	d->imu.batch[index].gyro = angular_velocity;
 }
 
 static void
@@ -925,21 +974,16 @@ vive_controller_decode_message(struct vive_controller_device *d, struct vive_con
 
 #define FEATURE_BUFFER_SIZE 256
 
-static int
-vive_controller_device_update(struct vive_controller_device *d)
+static void
+vive_controller_handle_report(void *ptr, const uint8_t *buffer, int size, uint64_t now_ns)
 {
-	uint8_t buf[FEATURE_BUFFER_SIZE];
+	struct vive_controller_device *d = (struct vive_controller_device *)ptr;
 
-	int ret = os_hid_read(d->controller_hid, buf, sizeof(buf), 1000);
-	if (ret == 0) {
-		// controller off
-		return true;
-	}
+	// The decoders work in place.
+	uint8_t buf[FEATURE_BUFFER_SIZE];
+	memcpy(buf, buffer, MIN((size_t)size, sizeof(buf)));
 
-	if (ret < 0) {
-		VIVE_ERROR(d, "Failed to read device '%i'!", ret);
-		return false;
-	}
+	d->imu.received_ns = now_ns;
 
 	switch (buf[0]) {
 	case VIVE_CONTROLLER_REPORT1_ID:
@@ -957,33 +1001,12 @@ vive_controller_device_update(struct vive_controller_device *d)
 	case VIVE_CONTROLLER_DISCONNECT_REPORT_ID: VIVE_DEBUG(d, "Controller disconnected."); break;
 	default: VIVE_ERROR(d, "Unknown controller message type: %u", buf[0]);
 	}
-
-	return true;
 }
 
-static void *
-vive_controller_run_thread(void *ptr)
+static void
+vive_controller_flush(void *ptr)
 {
-	struct vive_controller_device *d = (struct vive_controller_device *)ptr;
-
-	uint8_t buf[FEATURE_BUFFER_SIZE];
-	while (os_hid_read(d->controller_hid, buf, sizeof(buf), 0) > 0) {
-		// Empty queue first
-	}
-
-	os_thread_helper_lock(&d->controller_thread);
-	while (os_thread_helper_is_running_locked(&d->controller_thread)) {
-		os_thread_helper_unlock(&d->controller_thread);
-
-		if (!vive_controller_device_update(d)) {
-			return NULL;
-		}
-
-		// Just keep swimming.
-		os_thread_helper_lock(&d->controller_thread);
-	}
-
-	return NULL;
+	vive_controller_flush_imu((struct vive_controller_device *)ptr);
 }
 
 void
@@ -1089,7 +1112,6 @@ vive_controller_create(struct os_hid_device *controller_hid, enum watchman_gen w
 
 	// Have to init before destroy is called.
 	os_mutex_init(&d->lock);
-	os_thread_helper_init(&d->controller_thread);
 
 	if (vive_get_imu_range_report(d->controller_hid, &d->config.imu.gyro_range, &d->config.imu.acc_range) != 0) {
 		// reading range report fails for powered off controller
@@ -1208,9 +1230,15 @@ vive_controller_create(struct os_hid_device *controller_hid, enum watchman_gen w
 	}
 
 	if (d->controller_hid) {
-		int ret = os_thread_helper_start(&d->controller_thread, vive_controller_run_thread, d);
+		// One thread reads all of the HID devices, shared with the HMD.
+		d->reader = vive_hid_reader_get_shared();
+		int ret = -1;
+		if (d->reader != NULL) {
+			ret = vive_hid_reader_add(d->reader, d->controller_hid, vive_controller_handle_report,
+			                          vive_controller_flush, d);
+		}
 		if (ret != 0) {
-			VIVE_ERROR(d, "Failed to start mainboard thread!");
+			VIVE_ERROR(d, "Failed to start reading controller device!");
 			vive_controller_device_destroy(&d->base);
 			return NULL;
 		}
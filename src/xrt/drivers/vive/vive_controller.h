@@ -20,6 +20,8 @@
 #include "util/u_hand_tracking.h"
 #include "vive/vive_config.h"
 
+#include "vive_hid_reader.h"
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +32,13 @@ extern "C" {
  * @brief Driver for the HTC Vive and Valve Index controllers.
  */
 
+/*!
+ * Every report carries at most two messages with one IMU sample each.
+ *
+ * @ingroup drv_vive
+ */
+#define VIVE_CONTROLLER_IMU_BATCH_MAX_SAMPLES (VIVE_HID_READER_MAX_REPORTS_PER_WAKEUP * 2)
+
 enum watchman_gen
 {
 	WATCHMAN_GEN1,
@@ -48,13 +57,28 @@ struct vive_controller_device
 	struct xrt_device base;
 
 	struct os_hid_device *controller_hid;
-	struct os_thread_helper controller_thread;
 	struct os_mutex lock;
 
+	//! Services @ref controller_hid, shared with the other Vive devices.
+	struct vive_hid_reader *reader;
+
 	struct
 	{
 		timepoint_ns last_sample_ts_ns;
 		uint32_t last_sample_ticks;
+
+		//! When the report currently being decoded was read.
+		uint64_t received_ns;
+
+		//! Samples decoded in this wakeup, only touched on the reader thread.
+		struct
+		{
+			timepoint_ns timestamp_ns;
+			uint64_t received_ns;
+			struct xrt_vec3 acc;
+			struct xrt_vec3 gyro;
+		} batch[VIVE_CONTROLLER_IMU_BATCH_MAX_SAMPLES];
+		uint32_t batch_count;
 	} imu;
 
 	struct
@@ -15,14 +15,11 @@
 
 #include "util/u_device.h"
 #include "util/u_debug.h"
+#include "util/u_calibration_cache.h"
 #include "util/u_var.h"
 #include "util/u_time.h"
 #include "util/u_trace_marker.h"
 
-#ifdef XRT_OS_LINUX
-#include "util/u_linux.h"
-#endif
-
 #include "math/m_api.h"
 #include "math/m_predict.h"
 
@@ -40,6 +37,8 @@
 // Used to scale the IMU range from config.
 #define VIVE_IMU_RANGE_CONVERSION_VALUE (32768.0)
 
+DEBUG_GET_ONCE_OPTION(vive_predict_model, "VIVE_PREDICT_MODEL", NULL)
+
 
 static bool
 vive_mainboard_power_off(struct vive_device *d);
@@ -56,15 +55,19 @@ vive_device_destroy(struct xrt_device *xdev)
 	XRT_TRACE_MARKER();
 
 	struct vive_device *d = vive_device(xdev);
+
+	// After this no callbacks for our devices are running.
+	if (d->reader != NULL) {
+		vive_hid_reader_remove(d->reader, d->mainboard_dev);
+		vive_hid_reader_remove(d->reader, d->sensors_dev);
+		vive_hid_reader_remove(d->reader, d->watchman_dev);
+		vive_hid_reader_unref(&d->reader);
+	}
+
 	if (d->mainboard_dev)
 		vive_mainboard_power_off(d);
 
-	// Destroy the thread object.
-	os_thread_helper_destroy(&d->sensors_thread);
-	os_thread_helper_destroy(&d->watchman_thread);
-	os_thread_helper_destroy(&d->mainboard_thread);
-
-	// Now that the thread is not running we can destroy the lock.
+	// Now that the reader is not calling us we can destroy the lock.
 
 	m_imu_3dof_close(&d->fusion.i3dof);
 
@@ -280,7 +283,7 @@ vive_mainboard_power_off(struct vive_device *d)
 }
 
 static void
-vive_mainboard_decode_message(struct vive_device *d, struct vive_mainboard_status_report *report)
+vive_mainboard_decode_message(struct vive_device *d, const struct vive_mainboard_status_report *report)
 {
 	uint16_t ipd;
 	uint16_t lens_separation;
@@ -383,12 +386,65 @@ convert_imu_to_openxr(struct vive_device *d, struct xrt_vec3 *gyro, struct xrt_v
 	}
 }
 
+/*!
+ * Hand all samples decoded in this wakeup to fusion, taking the fusion lock
+ * only once for the whole batch.
+ */
 static void
-update_imu(struct vive_device *d, const void *buffer)
+flush_imu(struct vive_device *d)
 {
 	XRT_TRACE_MARKER();
 
-	uint64_t now_ns = os_monotonic_get_ns();
+	uint32_t count = d->imu.batch_count;
+	if (count == 0) {
+		return;
+	}
+
+	struct m_imu_3dof_sample samples[VIVE_IMU_BATCH_MAX_SAMPLES];
+	struct xrt_quat rots[VIVE_IMU_BATCH_MAX_SAMPLES];
+	uint64_t received_ns[VIVE_IMU_BATCH_MAX_SAMPLES];
+	uint64_t device_ns[VIVE_IMU_BATCH_MAX_SAMPLES];
+	uint64_t history_ns[VIVE_IMU_BATCH_MAX_SAMPLES];
+
+	for (uint32_t i = 0; i < count; i++) {
+		samples[i].timestamp_ns = d->imu.batch[i].timestamp_ns;
+		samples[i].accel = d->imu.batch[i].acc;
+		samples[i].gyro = d->imu.batch[i].gyro;
+		received_ns[i] = d->imu.batch[i].received_ns;
+		device_ns[i] = samples[i].timestamp_ns;
+	}
+
+	vive_hid_reader_spread_timestamps(received_ns, device_ns, count, history_ns);
+
+	os_mutex_lock(&d->fusion.mutex);
+	m_imu_3dof_update_batch(&d->fusion.i3dof, samples, count, rots);
+	os_mutex_unlock(&d->fusion.mutex);
+
+	for (uint32_t i = 0; i < count; i++) {
+		struct vive_imu_batch_sample *s = &d->imu.batch[i];
+
+		struct xrt_space_relation rel = {0};
+		rel.relation_flags =
+		    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT;
+		rel.pose.orientation = rots[i];
+
+		m_relation_history_push(d->fusion.relation_hist, &rel, history_ns[i]);
+
+		vive_source_push_imu_packet(d->source, s->age, s->timestamp_ns, s->raw_acc, s->raw_gyro);
+	}
+
+	d->imu.batch_count = 0;
+}
+
+static void
+update_imu(struct vive_device *d, const void *buffer, uint64_t now_ns)
+{
+	XRT_TRACE_MARKER();
+
+	// Make room for the at most three new samples of this report.
+	if (d->imu.batch_count + 3 > VIVE_IMU_BATCH_MAX_SAMPLES) {
+		flush_imu(d);
+	}
 
 	const struct vive_imu_report *report = buffer;
 	const struct vive_imu_sample *sample = report->sample;
@@ -499,51 +555,32 @@ update_imu(struct vive_device *d, const void *buffer)
 
 		d->imu.sequence = seq;
 
-		struct xrt_space_relation rel = {0};
-		rel.relation_flags =
-		    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT;
-
-		os_mutex_lock(&d->fusion.mutex);
-		m_imu_3dof_update(&d->fusion.i3dof, d->imu.last_sample_ts_ns, &acceleration, &angular_velocity);
-		rel.pose.orientation = d->fusion.i3dof.rot;
-		os_mutex_unlock(&d->fusion.mutex);
-
-		m_relation_history_push(d->fusion.relation_hist, &rel, now_ns);
-
 		assert(j > 0);
 		uint32_t age = j <= 0 ? 0 : (uint32_t)(j - 1);
 
-		vive_source_push_imu_packet(d->source, age, d->imu.last_sample_ts_ns, raw_accel, raw_gyro);
+		d->imu.batch[d->imu.batch_count++] = (struct vive_imu_batch_sample){
+		    .timestamp_ns = d->imu.last_sample_ts_ns,
+		    .received_ns = now_ns,
+		    .age = age,
+		    .acc = acceleration,
+		    .gyro = angular_velocity,
+		    .raw_acc = raw_accel,
+		    .raw_gyro = raw_gyro,
+		};
 	}
 }
 
-static void
-drain_imu(struct vive_device *d, const void *buffer)
-{
-	// Noop
-}
-
 
 /*
  *
- * Mainboard thread
+ * Mainboard reports.
  *
  */
 
-static bool
-vive_mainboard_read_one_msg(struct vive_device *d)
+static void
+vive_mainboard_handle_report(void *ptr, const uint8_t *buffer, int ret, uint64_t now_ns)
 {
-	uint8_t buffer[64];
-
-	int ret = os_hid_read(d->mainboard_dev, buffer, sizeof(buffer), 1000);
-	if (ret == 0) {
-		// Time out
-		return true;
-	}
-	if (ret < 0) {
-		VIVE_ERROR(d, "Failed to read device '%i'!", ret);
-		return false;
-	}
+	struct vive_device *d = (struct vive_device *)ptr;
 
 	DRV_TRACE_IDENT(packet);
 
@@ -551,42 +588,18 @@ vive_mainboard_read_one_msg(struct vive_device *d)
 	case VIVE_MAINBOARD_STATUS_REPORT_ID:
 		if (ret != sizeof(struct vive_mainboard_status_report)) {
 			VIVE_ERROR(d, "Mainboard status report has invalid size.");
-			return false;
+			return;
 		}
-		vive_mainboard_decode_message(d, (struct vive_mainboard_status_report *)buffer);
+		vive_mainboard_decode_message(d, (const struct vive_mainboard_status_report *)buffer);
 		break;
 	default: VIVE_ERROR(d, "Unknown mainboard message type %d", buffer[0]); break;
 	}
-
-	return true;
-}
-
-static void *
-vive_mainboard_run_thread(void *ptr)
-{
-	struct vive_device *d = (struct vive_device *)ptr;
-
-	U_TRACE_SET_THREAD_NAME("Vive: Mainboard");
-
-	os_thread_helper_lock(&d->mainboard_thread);
-	while (os_thread_helper_is_running_locked(&d->mainboard_thread)) {
-		os_thread_helper_unlock(&d->mainboard_thread);
-
-		if (!vive_mainboard_read_one_msg(d)) {
-			return NULL;
-		}
-
-		// Just keep swimming.
-		os_thread_helper_lock(&d->mainboard_thread);
-	}
-
-	return NULL;
 }
 
 
 /*
  *
- * Sensor thread.
+ * Sensor reports.
  *
  */
 
@@ -693,41 +706,36 @@ _is_report_size_valid(struct vive_device *d, int size, int report_size, int repo
 	return true;
 }
 
-static bool
-vive_sensors_read_one_msg(struct vive_device *d,
-                          struct os_hid_device *dev,
-                          uint32_t report_id,
-                          int report_size,
-                          void (*process_cb)(struct vive_device *d, const void *buffer))
+static void
+vive_sensors_handle_report(void *ptr, const uint8_t *buffer, int ret, uint64_t now_ns)
 {
-	uint8_t buffer[64];
-
-	int ret = os_hid_read(dev, buffer, sizeof(buffer), 1000);
-	if (ret == 0) {
-		VIVE_ERROR(d, "Device %p timeout.", (void *)dev);
-		// Time out
-		return true;
-	}
-	if (ret < 0) {
-		VIVE_ERROR(d, "Failed to read device %p: %i.", (void *)dev, ret);
-		return false;
-	}
+	struct vive_device *d = (struct vive_device *)ptr;
 
 	DRV_TRACE_IDENT(packet);
 
-	if (buffer[0] == report_id) {
-		if (!_is_report_size_valid(d, ret, report_size, report_id))
-			return false;
+	// Drop old packets queued up while we were starting.
+	if (now_ns < d->imu.ignore_until_ns) {
+		return;
+	}
+
+	if (buffer[0] == VIVE_IMU_REPORT_ID) {
+		if (!_is_report_size_valid(d, ret, 52, VIVE_IMU_REPORT_ID))
+			return;
 
-		process_cb(d, buffer);
+		update_imu(d, buffer, now_ns);
 
 	} else {
 		VIVE_ERROR(d, "Unexpected sensor report type %s (0x%x).", _sensors_get_report_string(buffer[0]),
 		           buffer[0]);
-		VIVE_ERROR(d, "Expected %s (0x%x).", _sensors_get_report_string(report_id), report_id);
+		VIVE_ERROR(d, "Expected %s (0x%x).", _sensors_get_report_string(VIVE_IMU_REPORT_ID),
+		           VIVE_IMU_REPORT_ID);
 	}
+}
 
-	return true;
+static void
+vive_sensors_flush(void *ptr)
+{
+	flush_imu((struct vive_device *)ptr);
 }
 
 static void
@@ -785,20 +793,8 @@ _print_pulse_report_v2(struct vive_device *d, const void *buffer)
 }
 
 static bool
-vive_sensors_read_lighthouse_msg(struct vive_device *d)
+vive_watchman_handle_report_impl(struct vive_device *d, const uint8_t *buffer, int ret)
 {
-	uint8_t buffer[64];
-
-	int ret = os_hid_read(d->watchman_dev, buffer, sizeof(buffer), 1000);
-	if (ret == 0) {
-		// basestations not present/powered off
-		VIVE_TRACE(d, "Watchman device timed out.");
-		return true;
-	}
-	if (ret < 0) {
-		VIVE_ERROR(d, "Failed to read Watchman device: %i.", ret);
-		return false;
-	}
 	if (ret > 64) {
 		VIVE_ERROR(d,
 		           "Buffer too big from Watchman device: %i."
@@ -842,69 +838,10 @@ vive_sensors_read_lighthouse_msg(struct vive_device *d)
 	return true;
 }
 
-static void *
-vive_watchman_run_thread(void *ptr)
+static void
+vive_watchman_handle_report(void *ptr, const uint8_t *buffer, int size, uint64_t now_ns)
 {
-	struct vive_device *d = (struct vive_device *)ptr;
-
-	U_TRACE_SET_THREAD_NAME("Vive: Watchman");
-
-	os_thread_helper_lock(&d->watchman_thread);
-	while (os_thread_helper_is_running_locked(&d->watchman_thread)) {
-		os_thread_helper_unlock(&d->watchman_thread);
-
-		if (d->watchman_dev)
-			if (!vive_sensors_read_lighthouse_msg(d))
-				return NULL;
-
-		// Just keep swimming.
-		os_thread_helper_lock(&d->watchman_thread);
-	}
-
-	return NULL;
-}
-
-static void *
-vive_sensors_run_thread(void *ptr)
-{
-	struct vive_device *d = (struct vive_device *)ptr;
-
-	U_TRACE_SET_THREAD_NAME("Vive: Sensors");
-	os_thread_helper_name(&d->sensors_thread, "Vive: Sensors");
-
-#ifdef XRT_OS_LINUX
-	// Try to raise priority of this thread.
-	u_linux_try_to_set_realtime_priority_on_thread(d->log_level, "Vive: Sensors");
-#endif
-
-	/*
-	 * We want to drain all old packets to avoid old ones,
-	 * read packets with a noop function for 50ms.
-	 */
-
-	uint64_t then_ns = os_monotonic_get_ns();
-	uint64_t future_50ms_ns = then_ns + U_TIME_1MS_IN_NS * (uint64_t)50;
-
-	while (future_50ms_ns > os_monotonic_get_ns() && os_thread_helper_is_running(&d->sensors_thread)) {
-		// Lock not held.
-		if (!vive_sensors_read_one_msg(d, d->sensors_dev, VIVE_IMU_REPORT_ID, 52, drain_imu)) {
-			return NULL;
-		}
-	}
-
-
-	/*
-	 * Now read the packets.
-	 */
-
-	while (os_thread_helper_is_running(&d->sensors_thread)) {
-		// Lock not held.
-		if (!vive_sensors_read_one_msg(d, d->sensors_dev, VIVE_IMU_REPORT_ID, 52, update_imu)) {
-			return NULL;
-		}
-	}
-
-	return NULL;
+	vive_watchman_handle_report_impl((struct vive_device *)ptr, buffer, size);
 }
 
 static void
@@ -976,6 +913,30 @@ compute_distortion(struct xrt_device *xdev, uint32_t view, float u, float v, str
 	return status;
 }
 
+static bool
+compute_distortion_batch(struct xrt_device *xdev,
+                         uint32_t view,
+                         const float *u,
+                         const float *v,
+                         uint32_t count,
+                         struct u_uv_triplet_batch *out)
+{
+	XRT_TRACE_MARKER();
+
+	struct vive_device *d = vive_device(xdev);
+	bool status = u_compute_distortion_vive_batch(&d->config.distortion.values[view], u, v, count, out);
+
+	if (d->config.variant == VIVE_VARIANT_PRO2) {
+		// Flip Y coordinates
+		for (uint32_t i = 0; i < count; i++) {
+			out->r_y[i] = 1.0f - out->r_y[i];
+			out->g_y[i] = 1.0f - out->g_y[i];
+			out->b_y[i] = 1.0f - out->b_y[i];
+		}
+	}
+	return status;
+}
+
 void
 vive_set_trackers_status(struct vive_device *d, struct vive_tracking_status status)
 {
@@ -1052,11 +1013,40 @@ precompute_sensor_transforms(struct vive_device *d)
 	d->P_imu_me = P_imuxr_me;
 }
 
+/*!
+ * Reading and inflating the config over HID feature reports is one of the
+ * slower parts of starting up, so it is cached keyed on the serial and
+ * firmware version.
+ */
+static char *
+read_config_cached(struct vive_device *d, const char *serial)
+{
+	char version[64];
+	snprintf(version, sizeof(version), "fw%u-hw%u-%u.%u.%u", d->config.firmware.firmware_version,
+	         d->config.firmware.hardware_revision, d->config.firmware.hardware_version_major,
+	         d->config.firmware.hardware_version_minor, d->config.firmware.hardware_version_micro);
+
+	uint8_t *data = NULL;
+	size_t size = 0;
+	if (u_calibration_cache_load("vive", serial, version, &data, &size)) {
+		VIVE_INFO(d, "Using cached config for %s", serial);
+		return (char *)data;
+	}
+
+	char *config = vive_read_config(d->sensors_dev);
+	if (config != NULL) {
+		u_calibration_cache_store("vive", serial, version, (const uint8_t *)config, strlen(config));
+	}
+
+	return config;
+}
+
 struct vive_device *
 vive_device_create(struct os_hid_device *mainboard_dev,
                    struct os_hid_device *sensors_dev,
                    struct os_hid_device *watchman_dev,
                    enum VIVE_VARIANT variant,
+                   const char *serial,
                    struct vive_tracking_status tstatus,
                    struct vive_source *vs)
 {
@@ -1068,6 +1058,9 @@ vive_device_create(struct os_hid_device *mainboard_dev,
 
 	m_relation_history_create(&d->fusion.relation_hist);
 
+	m_relation_history_set_predict_model_from_string(d->fusion.relation_hist,
+	                                                 debug_get_option_vive_predict_model());
+
 	size_t idx = 0;
 	d->base.hmd->blend_modes[idx++] = XRT_BLEND_MODE_OPAQUE;
 	d->base.hmd->blend_mode_count = idx;
@@ -1097,9 +1090,11 @@ vive_device_create(struct os_hid_device *mainboard_dev,
 		vive_mainboard_power_on(d);
 		vive_mainboard_get_device_info(d);
 	}
-	vive_read_firmware(d->sensors_dev, &d->config.firmware.firmware_version, &d->config.firmware.hardware_revision,
-	                   &d->config.firmware.hardware_version_micro, &d->config.firmware.hardware_version_minor,
-	                   &d->config.firmware.hardware_version_major);
+	int fw_ret = vive_read_firmware(d->sensors_dev, &d->config.firmware.firmware_version,
+	                                &d->config.firmware.hardware_revision,
+	                                &d->config.firmware.hardware_version_micro,
+	                                &d->config.firmware.hardware_version_minor,
+	                                &d->config.firmware.hardware_version_major);
 
 	VIVE_INFO(d, "Firmware version %u", d->config.firmware.firmware_version);
 	VIVE_INFO(d, "Hardware revision: %d rev %d.%d.%d", d->config.firmware.hardware_revision,
@@ -1110,7 +1105,8 @@ vive_device_create(struct os_hid_device *mainboard_dev,
 	VIVE_INFO(d, "Vive gyroscope range     %f", d->config.imu.gyro_range);
 	VIVE_INFO(d, "Vive accelerometer range %f", d->config.imu.acc_range);
 
-	char *config = vive_read_config(d->sensors_dev);
+	// Without the firmware version we can't tell if a cached config is stale.
+	char *config = read_config_cached(d, fw_ret == 0 ? serial : NULL);
 
 	// Set logging level for the config we are about to fill out.
 	d->config.log_level = d->log_level;
@@ -1128,6 +1124,9 @@ vive_device_create(struct os_hid_device *mainboard_dev,
 	d->base.hmd->distortion.fov[0] = d->config.distortion.fov[0];
 	d->base.hmd->distortion.fov[1] = d->config.distortion.fov[1];
 
+	// Needs the distortion values and FoV from the config.
+	u_distortion_mesh_fill_in_batch(&d->base, compute_distortion_batch);
+
 	// Per-view size.
 	uint32_t w_pixels = d->config.display.eye_target_width_in_pixels;
 	uint32_t h_pixels = d->config.display.eye_target_height_in_pixels;
@@ -1156,10 +1155,13 @@ vive_device_create(struct os_hid_device *mainboard_dev,
 	// Sensor setup.
 	precompute_sensor_transforms(d);
 
-	// Init threads.
-	os_thread_helper_init(&d->mainboard_thread);
-	os_thread_helper_init(&d->sensors_thread);
-	os_thread_helper_init(&d->watchman_thread);
+	// One thread reads all of the HID devices, shared with the controllers.
+	d->reader = vive_hid_reader_get_shared();
+	if (d->reader == NULL) {
+		VIVE_ERROR(d, "Failed to get HID reader!");
+		vive_device_destroy((struct xrt_device *)d);
+		return NULL;
+	}
 
 	d->source = vs;
 	d->pose = (struct xrt_pose)XRT_POSE_IDENTITY;
@@ -1178,9 +1180,9 @@ vive_device_create(struct os_hid_device *mainboard_dev,
 	}
 
 	if (d->mainboard_dev) {
-		ret = os_thread_helper_start(&d->mainboard_thread, vive_mainboard_run_thread, d);
+		ret = vive_hid_reader_add(d->reader, d->mainboard_dev, vive_mainboard_handle_report, NULL, d);
 		if (ret != 0) {
-			VIVE_ERROR(d, "Failed to start mainboard thread!");
+			VIVE_ERROR(d, "Failed to start reading mainboard device!");
 			vive_device_destroy((struct xrt_device *)d);
 			return NULL;
 		}
@@ -1206,18 +1208,26 @@ vive_device_create(struct os_hid_device *mainboard_dev,
 		return false;
 	}
 
-	ret = os_thread_helper_start(&d->sensors_thread, vive_sensors_run_thread, d);
+	/*
+	 * We want to drain all old packets to avoid old ones,
+	 * drop the packets for the first 50ms.
+	 */
+	d->imu.ignore_until_ns = os_monotonic_get_ns() + U_TIME_1MS_IN_NS * (uint64_t)50;
+
+	ret = vive_hid_reader_add(d->reader, d->sensors_dev, vive_sensors_handle_report, vive_sensors_flush, d);
 	if (ret != 0) {
-		VIVE_ERROR(d, "Failed to start sensors thread!");
+		VIVE_ERROR(d, "Failed to start reading sensors device!");
 		vive_device_destroy((struct xrt_device *)d);
 		return NULL;
 	}
 
-	ret = os_thread_helper_start(&d->watchman_thread, vive_watchman_run_thread, d);
-	if (ret != 0) {
-		VIVE_ERROR(d, "Failed to start watchman thread!");
-		vive_device_destroy((struct xrt_device *)d);
-		return NULL;
+	if (d->watchman_dev != NULL) {
+		ret = vive_hid_reader_add(d->reader, d->watchman_dev, vive_watchman_handle_report, NULL, d);
+		if (ret != 0) {
+			VIVE_ERROR(d, "Failed to start reading watchman device!");
+			vive_device_destroy((struct xrt_device *)d);
+			return NULL;
+		}
 	}
 
 	vive_device_setup_ui(d);
@@ -21,12 +21,32 @@
 #include "vive/vive_config.h"
 
 #include "vive_lighthouse.h"
+#include "vive_hid_reader.h"
 #include "xrt/xrt_tracking.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*!
+ * Each IMU report carries up to three new samples.
+ */
+#define VIVE_IMU_BATCH_MAX_SAMPLES (VIVE_HID_READER_MAX_REPORTS_PER_WAKEUP * 3)
+
+/*!
+ * A decoded IMU sample waiting to be handed to fusion.
+ */
+struct vive_imu_batch_sample
+{
+	timepoint_ns timestamp_ns;
+	uint64_t received_ns;
+	uint32_t age;
+	struct xrt_vec3 acc;
+	struct xrt_vec3 gyro;
+	struct xrt_vec3 raw_acc;
+	struct xrt_vec3 raw_gyro;
+};
+
 /*!
  * @implements xrt_device
  */
@@ -39,15 +59,21 @@ struct vive_device
 
 	struct lighthouse_watchman watchman;
 
-	struct os_thread_helper sensors_thread;
-	struct os_thread_helper watchman_thread;
-	struct os_thread_helper mainboard_thread;
+	//! Services the mainboard, sensors and watchman devices.
+	struct vive_hid_reader *reader;
 
 	struct
 	{
 		timepoint_ns last_sample_ts_ns;
 		uint32_t last_sample_ticks;
 		uint8_t sequence;
+
+		//! Reports received before this are stale and dropped.
+		uint64_t ignore_until_ns;
+
+		//! Samples decoded in this wakeup, only touched on the reader thread.
+		struct vive_imu_batch_sample batch[VIVE_IMU_BATCH_MAX_SAMPLES];
+		uint32_t batch_count;
 	} imu;
 
 	struct
@@ -152,11 +178,18 @@ struct vive_tracking_status
 void
 vive_set_trackers_status(struct vive_device *d, struct vive_tracking_status status);
 
+/*!
+ * Create a Vive HMD device.
+ *
+ * @param serial USB serial of the device hosting the sensors, used to cache
+ *               the configuration read from it, may be NULL.
+ */
 struct vive_device *
 vive_device_create(struct os_hid_device *mainboard_dev,
                    struct os_hid_device *sensors_dev,
                    struct os_hid_device *watchman_dev,
                    enum VIVE_VARIANT variant,
+                   const char *serial,
                    struct vive_tracking_status tstatus,
                    struct vive_source *vs);
 
@@ -0,0 +1,395 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Single threaded epoll reader for Vive HID devices.
+ * @ingroup drv_vive
+ */
+
+#include "xrt/xrt_defines.h"
+
+#include "os/os_hid.h"
+#include "os/os_time.h"
+#include "os/os_threading.h"
+
+#include "util/u_misc.h"
+#include "util/u_linux.h"
+#include "util/u_trace_marker.h"
+
+#include "vive.h"
+#include "vive_hid_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+
+/*!
+ * How long epoll waits before checking if the thread should stop.
+ */
+#define WAIT_TIMEOUT_MS (100)
+
+/*!
+ * Biggest report any of the Vive devices send, the controllers use up to
+ * 256 byte feature sized reports.
+ */
+#define REPORT_BUFFER_SIZE (256)
+
+
+struct vive_hid_reader_source
+{
+	struct os_hid_device *hid;
+
+	//! Handed to epoll, lets the thread detect sources removed while it was waiting.
+	uint64_t id;
+
+	vive_hid_reader_report_func_t report_func;
+	vive_hid_reader_flush_func_t flush_func;
+	void *ptr;
+};
+
+struct vive_hid_reader
+{
+	struct xrt_reference ref;
+
+	struct os_thread_helper oth;
+
+	int epoll_fd;
+
+	//! Protects the sources and stats, held while calling the callbacks.
+	struct os_mutex mutex;
+
+	struct vive_hid_reader_source sources[VIVE_HID_READER_MAX_SOURCES];
+	uint32_t source_count;
+	uint64_t next_id;
+
+	struct vive_hid_reader_stats stats;
+
+	enum u_logging_level log_level;
+};
+
+static pthread_mutex_t shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct vive_hid_reader *shared_reader = NULL;
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static struct vive_hid_reader_source *
+find_by_id(struct vive_hid_reader *r, uint64_t id)
+{
+	for (uint32_t i = 0; i < r->source_count; i++) {
+		if (r->sources[i].id == id) {
+			return &r->sources[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int
+find_index_by_hid(struct vive_hid_reader *r, struct os_hid_device *hid)
+{
+	for (uint32_t i = 0; i < r->source_count; i++) {
+		if (r->sources[i].hid == hid) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+//! Must be called with the mutex held.
+static void
+remove_index_locked(struct vive_hid_reader *r, uint32_t index)
+{
+	epoll_ctl(r->epoll_fd, EPOLL_CTL_DEL, os_hid_get_fd(r->sources[index].hid), NULL);
+
+	r->sources[index] = r->sources[r->source_count - 1];
+	U_ZERO(&r->sources[r->source_count - 1]);
+	r->source_count--;
+}
+
+/*!
+ * Hand all queued reports of one source to its callback.
+ *
+ * @return false if the device failed and should no longer be serviced.
+ */
+static bool
+drain_source_locked(struct vive_hid_reader *r, struct vive_hid_reader_source *src, uint64_t now_ns)
+{
+	uint8_t buffer[REPORT_BUFFER_SIZE];
+	uint32_t count = 0;
+	bool ok = true;
+
+	while (count < VIVE_HID_READER_MAX_REPORTS_PER_WAKEUP) {
+		// The fd is non-blocking, so this returns 0 once the queue is empty.
+		int ret = os_hid_read(src->hid, buffer, sizeof(buffer), -1);
+		if (ret == 0) {
+			break;
+		}
+		if (ret < 0) {
+			U_LOG_IFL_E(r->log_level, "Failed to read hid device %p: %i.", (void *)src->hid, ret);
+			ok = false;
+			break;
+		}
+
+		src->report_func(src->ptr, buffer, ret, now_ns);
+		count++;
+	}
+
+	r->stats.reports += count;
+
+	if (count > 0 && src->flush_func != NULL) {
+		src->flush_func(src->ptr);
+		r->stats.flushes++;
+	}
+
+	return ok;
+}
+
+static void *
+run_thread(void *ptr)
+{
+	struct vive_hid_reader *r = (struct vive_hid_reader *)ptr;
+	struct epoll_event events[VIVE_HID_READER_MAX_SOURCES];
+
+	U_TRACE_SET_THREAD_NAME("Vive: HID reader");
+	os_thread_helper_name(&r->oth, "Vive: HID reader");
+
+	// Try to raise priority of this thread, it carries the IMU samples.
+	u_linux_try_to_set_realtime_priority_on_thread(r->log_level, "Vive: HID reader");
+
+	while (os_thread_helper_is_running(&r->oth)) {
+		int n = epoll_wait(r->epoll_fd, events, ARRAY_SIZE(events), WAIT_TIMEOUT_MS);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			U_LOG_IFL_E(r->log_level, "epoll_wait failed: %s", strerror(errno));
+			break;
+		}
+		if (n == 0) {
+			continue;
+		}
+
+		uint64_t now_ns = os_monotonic_get_ns();
+
+		os_mutex_lock(&r->mutex);
+		r->stats.wakeups++;
+
+		for (int i = 0; i < n; i++) {
+			// Removed while we were waiting.
+			struct vive_hid_reader_source *src = find_by_id(r, events[i].data.u64);
+			if (src == NULL) {
+				continue;
+			}
+
+			bool ok = drain_source_locked(r, src, now_ns);
+
+			if (!ok || (events[i].events & (EPOLLERR | EPOLLHUP)) != 0) {
+				U_LOG_IFL_E(r->log_level, "Hid device %p disconnected.", (void *)src->hid);
+				remove_index_locked(r, (uint32_t)(src - r->sources));
+			}
+		}
+
+		os_mutex_unlock(&r->mutex);
+	}
+
+	return NULL;
+}
+
+static void
+destroy(struct vive_hid_reader *r)
+{
+	// Stops the thread first.
+	os_thread_helper_destroy(&r->oth);
+
+	if (r->epoll_fd >= 0) {
+		close(r->epoll_fd);
+		r->epoll_fd = -1;
+	}
+
+	os_mutex_destroy(&r->mutex);
+
+	free(r);
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+struct vive_hid_reader *
+vive_hid_reader_create(void)
+{
+	struct vive_hid_reader *r = U_TYPED_CALLOC(struct vive_hid_reader);
+	r->ref.count = 1;
+	r->log_level = debug_get_log_option_vive_log();
+	r->next_id = 1;
+
+	// Have to init before destroy is called.
+	os_mutex_init(&r->mutex);
+	os_thread_helper_init(&r->oth);
+
+	r->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (r->epoll_fd < 0) {
+		U_LOG_IFL_E(r->log_level, "epoll_create1 failed: %s", strerror(errno));
+		destroy(r);
+		return NULL;
+	}
+
+	int ret = os_thread_helper_start(&r->oth, run_thread, r);
+	if (ret != 0) {
+		U_LOG_IFL_E(r->log_level, "Failed to start HID reader thread!");
+		destroy(r);
+		return NULL;
+	}
+
+	return r;
+}
+
+struct vive_hid_reader *
+vive_hid_reader_get_shared(void)
+{
+	pthread_mutex_lock(&shared_mutex);
+
+	struct vive_hid_reader *r = shared_reader;
+	if (r != NULL) {
+		xrt_reference_inc(&r->ref);
+	} else {
+		r = vive_hid_reader_create();
+		shared_reader = r;
+	}
+
+	pthread_mutex_unlock(&shared_mutex);
+
+	return r;
+}
+
+void
+vive_hid_reader_unref(struct vive_hid_reader **reader_ptr)
+{
+	struct vive_hid_reader *r = *reader_ptr;
+	if (r == NULL) {
+		return;
+	}
+	*reader_ptr = NULL;
+
+	// Held so that get_shared can't hand out the reader while it's going away.
+	pthread_mutex_lock(&shared_mutex);
+
+	bool last = xrt_reference_dec_and_is_zero(&r->ref);
+	if (last && shared_reader == r) {
+		shared_reader = NULL;
+	}
+
+	pthread_mutex_unlock(&shared_mutex);
+
+	if (last) {
+		destroy(r);
+	}
+}
+
+int
+vive_hid_reader_add(struct vive_hid_reader *r,
+                    struct os_hid_device *hid,
+                    vive_hid_reader_report_func_t report_func,
+                    vive_hid_reader_flush_func_t flush_func,
+                    void *ptr)
+{
+	int fd = os_hid_get_fd(hid);
+	if (fd < 0) {
+		U_LOG_IFL_E(r->log_level, "Hid device %p has no file descriptor.", (void *)hid);
+		return -1;
+	}
+
+	int flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		U_LOG_IFL_E(r->log_level, "Failed to make hid device %p non-blocking: %s", (void *)hid,
+		            strerror(errno));
+		return -1;
+	}
+
+	// Throw away anything queued up since the device was opened.
+	uint8_t buffer[REPORT_BUFFER_SIZE];
+	while (os_hid_read(hid, buffer, sizeof(buffer), -1) > 0) {
+		// Empty queue first
+	}
+
+	os_mutex_lock(&r->mutex);
+
+	if (r->source_count >= ARRAY_SIZE(r->sources) || find_index_by_hid(r, hid) >= 0) {
+		os_mutex_unlock(&r->mutex);
+		U_LOG_IFL_E(r->log_level, "Can't add hid device %p, full or already added.", (void *)hid);
+		return -1;
+	}
+
+	struct vive_hid_reader_source *src = &r->sources[r->source_count];
+	src->hid = hid;
+	src->id = r->next_id++;
+	src->report_func = report_func;
+	src->flush_func = flush_func;
+	src->ptr = ptr;
+
+	struct epoll_event ev = {.events = EPOLLIN, .data.u64 = src->id};
+	if (epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		U_LOG_IFL_E(r->log_level, "epoll_ctl failed: %s", strerror(errno));
+		U_ZERO(src);
+		os_mutex_unlock(&r->mutex);
+		return -1;
+	}
+
+	r->source_count++;
+
+	os_mutex_unlock(&r->mutex);
+
+	return 0;
+}
+
+void
+vive_hid_reader_remove(struct vive_hid_reader *r, struct os_hid_device *hid)
+{
+	os_mutex_lock(&r->mutex);
+
+	int index = find_index_by_hid(r, hid);
+	if (index >= 0) {
+		remove_index_locked(r, (uint32_t)index);
+	}
+
+	os_mutex_unlock(&r->mutex);
+}
+
+void
+vive_hid_reader_get_stats(struct vive_hid_reader *r, struct vive_hid_reader_stats *out_stats)
+{
+	os_mutex_lock(&r->mutex);
+	*out_stats = r->stats;
+	os_mutex_unlock(&r->mutex);
+}
+
+void
+vive_hid_reader_spread_timestamps(const uint64_t *received_ns,
+                                  const uint64_t *device_ns,
+                                  uint32_t count,
+                                  uint64_t *out_ns)
+{
+	uint64_t newest_device_ns = 0;
+
+	for (uint32_t i = count; i-- > 0;) {
+		if (i == count - 1 || received_ns[i] != received_ns[i + 1]) {
+			newest_device_ns = device_ns[i];
+		}
+
+		uint64_t age_ns = newest_device_ns > device_ns[i] ? newest_device_ns - device_ns[i] : 0;
+		out_ns[i] = received_ns[i] > age_ns ? received_ns[i] - age_ns : 0;
+	}
+}
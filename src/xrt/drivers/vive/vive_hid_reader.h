@@ -0,0 +1,159 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Single threaded epoll reader for Vive HID devices.
+ * @ingroup drv_vive
+ */
+
+#pragma once
+
+#include "xrt/xrt_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct os_hid_device;
+
+/*!
+ * Maximum number of hid devices one reader can service.
+ *
+ * @ingroup drv_vive
+ */
+#define VIVE_HID_READER_MAX_SOURCES (16)
+
+/*!
+ * Maximum number of reports read from one device per wakeup, bounds how long
+ * one busy device can hold up the others.
+ *
+ * @ingroup drv_vive
+ */
+#define VIVE_HID_READER_MAX_REPORTS_PER_WAKEUP (64)
+
+/*!
+ * Called for every report read from a device, on the reader thread.
+ *
+ * @param ptr    Pointer given when adding the device.
+ * @param buffer Report data, starting with the report id.
+ * @param size   Size of the report in bytes.
+ * @param now_ns Monotonic time of the wakeup that read this report.
+ *
+ * @ingroup drv_vive
+ */
+typedef void (*vive_hid_reader_report_func_t)(void *ptr, const uint8_t *buffer, int size, uint64_t now_ns);
+
+/*!
+ * Called once after all queued reports of a device have been handed out in a
+ * wakeup, lets the device hand its decoded samples on in one batch.
+ *
+ * @ingroup drv_vive
+ */
+typedef void (*vive_hid_reader_flush_func_t)(void *ptr);
+
+/*!
+ * Counters for how much work the reader has done.
+ *
+ * @ingroup drv_vive
+ */
+struct vive_hid_reader_stats
+{
+	//! Number of times epoll woke the thread up with ready devices.
+	uint64_t wakeups;
+
+	//! Number of reports handed to the report callbacks.
+	uint64_t reports;
+
+	//! Number of flush callbacks called.
+	uint64_t flushes;
+};
+
+/*!
+ * One thread that services all of the hidraw devices of a HMD and its
+ * controllers with epoll, instead of one thread per device each polling
+ * for every single report. All reports queued on a device are drained on
+ * each wakeup.
+ *
+ * The report and flush callbacks are called with an internal lock held,
+ * so once @ref vive_hid_reader_remove returns no callback for that device
+ * is running or will be called again. The callbacks must not add or remove
+ * devices.
+ *
+ * @ingroup drv_vive
+ */
+struct vive_hid_reader;
+
+/*!
+ * Create a new reader and start its thread.
+ *
+ * @ingroup drv_vive
+ */
+struct vive_hid_reader *
+vive_hid_reader_create(void);
+
+/*!
+ * Get a reference to the reader shared by all devices of the driver,
+ * creating it if needed.
+ *
+ * @ingroup drv_vive
+ */
+struct vive_hid_reader *
+vive_hid_reader_get_shared(void);
+
+/*!
+ * Drop a reference, the reader is destroyed when the last one is gone.
+ *
+ * @ingroup drv_vive
+ */
+void
+vive_hid_reader_unref(struct vive_hid_reader **reader_ptr);
+
+/*!
+ * Start servicing @p hid, any reports already queued on it are discarded.
+ * The device is switched to non-blocking reads.
+ *
+ * @return 0 on success, negative on failure.
+ *
+ * @ingroup drv_vive
+ */
+int
+vive_hid_reader_add(struct vive_hid_reader *reader,
+                    struct os_hid_device *hid,
+                    vive_hid_reader_report_func_t report_func,
+                    vive_hid_reader_flush_func_t flush_func,
+                    void *ptr);
+
+/*!
+ * Stop servicing @p hid, does nothing if it was never added.
+ *
+ * @ingroup drv_vive
+ */
+void
+vive_hid_reader_remove(struct vive_hid_reader *reader, struct os_hid_device *hid);
+
+/*!
+ * Get a copy of the counters.
+ *
+ * @ingroup drv_vive
+ */
+void
+vive_hid_reader_get_stats(struct vive_hid_reader *reader, struct vive_hid_reader_stats *out_stats);
+
+/*!
+ * Gives each of @p count samples, oldest first, its own monotonic timestamp.
+ * Samples read in the same wakeup share its @p received_ns, the newest of
+ * them keeps it and the older ones are moved back by how much older their
+ * @p device_ns are, so they don't all end up on the same timestamp.
+ *
+ * @ingroup drv_vive
+ */
+void
+vive_hid_reader_spread_timestamps(const uint64_t *received_ns,
+                                  const uint64_t *device_ns,
+                                  uint32_t count,
+                                  uint64_t *out_ns);
+
+
+#ifdef __cplusplus
+}
+#endif
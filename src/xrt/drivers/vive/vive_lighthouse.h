@@ -19,6 +19,10 @@
 
 #include "xrt/xrt_defines.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct lighthouse_rotor_calibration
 {
 	float tilt;
@@ -107,3 +111,7 @@ lighthouse_watchman_handle_pulse(struct lighthouse_watchman *watchman,
                                  uint32_t timestamp);
 void
 lighthouse_watchman_init(struct lighthouse_watchman *watchman, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -62,6 +62,16 @@ log_vive_device(enum u_logging_level log_level, struct xrt_prober *xp, struct xr
 	log_vive_string(xp, dev, XRT_PROBER_STRING_SERIAL_NUMBER);
 }
 
+static void
+get_serial(struct xrt_prober *xp, struct xrt_prober_device *dev, char *out, size_t out_size)
+{
+	int len = xrt_prober_get_string_descriptor(xp, dev, XRT_PROBER_STRING_SERIAL_NUMBER, (unsigned char *)out,
+	                                           out_size);
+	if (len <= 0) {
+		out[0] = '\0';
+	}
+}
+
 static void
 init_vive1(struct xrt_prober *xp,
            struct xrt_prober_device *dev,
@@ -81,6 +91,7 @@ init_vive1(struct xrt_prober *xp,
 
 	struct os_hid_device *sensors_dev = NULL;
 	struct os_hid_device *watchman_dev = NULL;
+	char serial[256] = {0};
 
 	for (uint32_t i = 0; i < device_count; i++) {
 		struct xrt_prober_device *d = devices[i];
@@ -90,6 +101,8 @@ init_vive1(struct xrt_prober *xp,
 
 		log_vive_device(log_level, xp, d);
 
+		get_serial(xp, d, serial, sizeof(serial));
+
 		int result = xrt_prober_open_hid_interface(xp, d, 0, &sensors_dev);
 		if (result != 0) {
 			U_LOG_E("Could not open Vive sensors device.");
@@ -124,7 +137,7 @@ init_vive1(struct xrt_prober *xp,
 		return;
 	}
 	struct vive_device *d =
-	    vive_device_create(mainboard_dev, sensors_dev, watchman_dev, VIVE_VARIANT_VIVE, tstatus, vs);
+	    vive_device_create(mainboard_dev, sensors_dev, watchman_dev, VIVE_VARIANT_VIVE, serial, tstatus, vs);
 	if (d == NULL) {
 		free(sensors_dev);
 		free(mainboard_dev);
@@ -158,6 +171,7 @@ init_vive_pro(struct xrt_prober *xp,
 
 	struct os_hid_device *sensors_dev = NULL;
 	struct os_hid_device *watchman_dev = NULL;
+	char serial[256] = {0};
 
 	for (uint32_t i = 0; i < device_count; i++) {
 		struct xrt_prober_device *d = devices[i];
@@ -167,6 +181,8 @@ init_vive_pro(struct xrt_prober *xp,
 
 		log_vive_device(log_level, xp, d);
 
+		get_serial(xp, d, serial, sizeof(serial));
+
 		int result = xrt_prober_open_hid_interface(xp, d, 0, &sensors_dev);
 		if (result != 0) {
 			U_LOG_E("Could not open Vive sensors device.");
@@ -201,7 +217,7 @@ init_vive_pro(struct xrt_prober *xp,
 		return;
 	}
 	struct vive_device *d =
-	    vive_device_create(mainboard_dev, sensors_dev, watchman_dev, VIVE_VARIANT_PRO, tstatus, vs);
+	    vive_device_create(mainboard_dev, sensors_dev, watchman_dev, VIVE_VARIANT_PRO, serial, tstatus, vs);
 	if (d == NULL) {
 		free(sensors_dev);
 		free(mainboard_dev);
@@ -235,6 +251,7 @@ init_vive_pro2(struct xrt_prober *xp,
 
 	struct os_hid_device *sensors_dev = NULL;
 	struct os_hid_device *watchman_dev = NULL;
+	char serial[256] = {0};
 
 	for (uint32_t i = 0; i < device_count; i++) {
 		struct xrt_prober_device *d = devices[i];
@@ -244,6 +261,8 @@ init_vive_pro2(struct xrt_prober *xp,
 
 		log_vive_device(log_level, xp, d);
 
+		get_serial(xp, d, serial, sizeof(serial));
+
 		int result = xrt_prober_open_hid_interface(xp, d, 0, &sensors_dev);
 		if (result != 0) {
 			U_LOG_E("Could not open Vive Pro 2 sensors device.");
@@ -278,7 +297,7 @@ init_vive_pro2(struct xrt_prober *xp,
 		return;
 	}
 	struct vive_device *d =
-	    vive_device_create(mainboard_dev, sensors_dev, watchman_dev, VIVE_VARIANT_PRO, tstatus, vs);
+	    vive_device_create(mainboard_dev, sensors_dev, watchman_dev, VIVE_VARIANT_PRO, serial, tstatus, vs);
 	if (d == NULL) {
 		free(sensors_dev);
 		free(mainboard_dev);
@@ -336,7 +355,11 @@ init_valve_index(struct xrt_prober *xp,
 		return;
 	}
 
-	struct vive_device *d = vive_device_create(NULL, sensors_dev, watchman_dev, VIVE_VARIANT_INDEX, tstatus, vs);
+	char serial[256];
+	get_serial(xp, dev, serial, sizeof(serial));
+
+	struct vive_device *d =
+	    vive_device_create(NULL, sensors_dev, watchman_dev, VIVE_VARIANT_INDEX, serial, tstatus, vs);
 	if (d == NULL) {
 		return;
 	}
@@ -13,7 +13,7 @@
 
 #include "os/os_threading.h"
 
-#include "math/m_clock_offset.h"
+#include "math/m_clock_sync.h"
 
 #include "util/u_deque.h"
 #include "util/u_logging.h"
@@ -49,8 +49,10 @@ struct vive_source
 	timepoint_ns last_frame_ts_ns;                //! Last frame timestamp in device nanoseconds
 
 	// Clock offsets
-	time_duration_ns hw2mono; //!< Estimated offset from IMU to monotonic clock
-	time_duration_ns hw2v4l2; //!< Estimated offset from IMU to V4L2 clock
+	struct m_clock_sync hw2mono_sync; //!< Filtered mapping from IMU to monotonic clock, IMU thread only
+	struct m_clock_sync hw2v4l2_sync; //!< Filtered mapping from IMU to V4L2 clock, frame thread only
+	time_duration_ns hw2mono;         //!< Offset from IMU to monotonic clock at the last IMU sample
+	time_duration_ns hw2v4l2;         //!< Offset from IMU to V4L2 clock at the last frame
 };
 
 /*
@@ -115,7 +117,7 @@ vive_source_try_convert_v4l2_timestamp(struct vive_source *vs, struct xrt_frame
 	vs->waiting_for_first_nonempty_frame = false;
 
 	// Update estimate of hw2v4l2 clock offset, only used for matching timestamps
-	m_clock_offset_a2b(CAMERA_FREQUENCY, vive_timestamp, xf->timestamp, &vs->hw2v4l2);
+	vs->hw2v4l2 = m_clock_sync_update(&vs->hw2v4l2_sync, vive_timestamp, xf->timestamp) - vive_timestamp;
 
 	// Use vive_timestamp and put it in monotonic clock
 	xf->timestamp = vive_timestamp + vs->hw2mono; // Notice that we don't use hw2v4l2
@@ -196,6 +198,9 @@ vive_source_create(struct xrt_frame_context *xfctx)
 	vs->frame_timestamps = u_deque_timepoint_ns_create();
 	os_mutex_init(&vs->frame_timestamps_lock);
 
+	m_clock_sync_init(&vs->hw2mono_sync, 0);
+	m_clock_sync_init(&vs->hw2v4l2_sync, 0);
+
 	// Setup node
 	struct xrt_frame_node *xfn = &vs->node;
 	xfn->break_apart = vive_source_node_break_apart;
@@ -239,7 +244,9 @@ vive_source_push_imu_packet(struct vive_source *vs, uint32_t age, timepoint_ns t
 	timepoint_ns sample_point = now_ns - t2ms_ns - age_diff_ns;
 
 	// Time adjustment.
-	t = m_clock_offset_a2b(IMU_FREQUENCY, t, sample_point, &vs->hw2mono);
+	timepoint_ns hw_t = t;
+	t = m_clock_sync_update(&vs->hw2mono_sync, hw_t, sample_point);
+	vs->hw2mono = t - hw_t;
 
 	// Finished sample.
 	struct xrt_imu_sample sample = {
@@ -17,12 +17,16 @@
 #include <inttypes.h>
 
 #include "math/m_api.h"
+#include "os/os_time.h"
 #include "os/os_threading.h"
 #include "util/u_autoexpgain.h"
 #include "util/u_debug.h"
 #include "util/u_var.h"
 #include "util/u_sink.h"
 #include "util/u_frame.h"
+#include "util/u_misc.h"
+#include "util/u_time.h"
+#include "util/u_format.h"
 #include "util/u_trace_marker.h"
 
 #include "wmr_config.h"
@@ -35,6 +39,12 @@ DEBUG_GET_ONCE_BOOL_OPTION(wmr_autoexposure, "WMR_AUTOEXPOSURE", true)
 //! Specifies whether the user wants to use the same exp/gain values for all cameras
 DEBUG_GET_ONCE_BOOL_OPTION(wmr_unify_expgain, "WMR_UNIFY_EXPGAIN", false)
 
+//! Number of camera bulk transfers kept in flight.
+DEBUG_GET_ONCE_NUM_OPTION(wmr_camera_xfers, "WMR_CAMERA_XFERS", 4)
+
+//! Number of combined frames in the recycled frame pool.
+DEBUG_GET_ONCE_NUM_OPTION(wmr_camera_pool_frames, "WMR_CAMERA_POOL_FRAMES", 8)
+
 static int
 update_expgain(struct wmr_camera *cam, struct xrt_frame **frames);
 
@@ -52,7 +62,11 @@ update_expgain(struct wmr_camera *cam, struct xrt_frame **frames);
 
 #define CAM_ENDPOINT 0x05
 
-#define NUM_XFERS 4
+#define MAX_XFERS 16
+#define MAX_POOL_FRAMES 32
+
+//! Frames are considered late if parsed more than a 90Hz frame period after their transfer completed.
+#define LATE_FRAME_NS (U_TIME_1S_IN_NS / 90)
 
 #define WMR_CAMERA_CMD_GAIN 0x80
 #define WMR_CAMERA_CMD_ON 0x81
@@ -85,6 +99,31 @@ struct wmr_camera_gain_cmd
 	__le16 camera_id2; //!< same as camera_id
 } __attribute__((packed));
 
+struct wmr_camera_frame_pool;
+
+/*!
+ * A combined camera frame that is returned to its pool when released.
+ */
+struct wmr_camera_pool_frame
+{
+	struct xrt_frame base;
+	struct wmr_camera_frame_pool *pool;
+	bool in_use;
+};
+
+/*!
+ * Recycled combined frames, reference counted separately from the camera as
+ * downstream sinks might still hold frames after the camera has been freed.
+ */
+struct wmr_camera_frame_pool
+{
+	struct xrt_reference ref;
+	struct os_mutex mutex;
+
+	struct wmr_camera_pool_frame frames[MAX_POOL_FRAMES];
+	int frame_count;
+};
+
 struct wmr_camera
 {
 	libusb_context *ctx;
@@ -107,7 +146,33 @@ struct wmr_camera
 	/* Unwrapped frame sequence number */
 	uint64_t frame_sequence;
 
-	struct libusb_transfer *xfers[NUM_XFERS];
+	struct libusb_transfer *xfers[MAX_XFERS];
+	int xfer_count;
+
+	/*!
+	 * Completed transfers are parsed on this thread instead of the libusb
+	 * event thread, and resubmitted once their data has been copied out.
+	 */
+	struct os_thread_helper parse_thread;
+	struct
+	{
+		struct libusb_transfer *xfers[MAX_XFERS];
+		uint64_t completed_ns[MAX_XFERS];
+		int head;
+		int count;
+	} parse_queue;
+
+	struct wmr_camera_frame_pool *pool;
+
+	struct
+	{
+		uint64_t frames;       //!< Frames pushed downstream
+		uint64_t dropped_seq;  //!< Frames missing according to sequence numbers
+		uint64_t dropped_xfer; //!< Failed or short transfers
+		uint64_t malformed;    //!< Transfers that could not be unpacked
+		uint64_t dropped_pool; //!< Frames dropped because the pool was empty
+		uint64_t late;         //!< Frames parsed later than a frame period after arriving
+	} stats;
 
 	struct wmr_camera_expgain
 	{
@@ -133,33 +198,6 @@ struct wmr_camera
  *
  */
 
-/* Some WMR headsets use 616538 byte transfers. HP G2 needs 1233018 (4 cameras)
- * As a general formula, it seems we have:
- *   0x6000 byte packets. Each has a 32 byte header.
- *     packet contains frame data for each camera in turn.
- *     Each frame has an extra (first) line with metadata
- *   Then, there's an extra 26 bytes on the end.
- *
- *   F = camera frames X * (Y+1) + 26
- *   n_packets = F/(0x6000-32)
- *   leftover = F - n_packets*(0x6000-32)
- *   size = n_packets * 0x6000 + 32 + leftover,
- *
- *   so for 2 x 640x480 cameras:
- *			F = 2 * 640 * 481 + 26 = 615706
- *      n_packets = 615706 / 24544 = 25
- *      leftover = 615706 - 25 * 24544 = 2106
- *      size = 25 * 0x6000 + 32 + 2106 = 616538
- *
- *  For HP G2 = 4 x 640 * 480 cameras:
- *			F = 4 * 640 * 481 + 26 = 1231386
- *      n_packets = 1231386 / 24544 = 50
- *      leftover = 1231386 - 50 * 24544 = 4186
- *      size = 50 * 0x6000 + 32 + 4186 = 1233018
- *
- *  It would be good to test these calculations on other headsets with
- *  different camera setups.
- */
 static bool
 compute_frame_size(struct wmr_camera *cam)
 {
@@ -168,10 +206,8 @@ compute_frame_size(struct wmr_camera *cam)
 	int width;
 	int height;
 	size_t F;
-	size_t n_packets;
-	size_t leftover;
 
-	F = 26;
+	F = 0;
 
 	for (i = 0; i < cam->tcam_count; i++) {
 		const struct wmr_camera_config *config = &cam->tcam_confs[i];
@@ -202,10 +238,7 @@ compute_frame_size(struct wmr_camera *cam)
 		return false;
 	}
 
-	n_packets = F / (0x6000 - 32);
-	leftover = F - n_packets * (0x6000 - 32);
-
-	cam->xfer_size = n_packets * 0x6000 + 32 + leftover;
+	cam->xfer_size = wmr_camera_xfer_size(F);
 
 	cam->frame_width = width;
 	cam->frame_height = height;
@@ -216,6 +249,112 @@ compute_frame_size(struct wmr_camera *cam)
 	return true;
 }
 
+
+/*
+ *
+ * Frame pool.
+ *
+ */
+
+static void
+pool_unref(struct wmr_camera_frame_pool *pool)
+{
+	if (!xrt_reference_dec_and_is_zero(&pool->ref)) {
+		return;
+	}
+
+	for (int i = 0; i < pool->frame_count; i++) {
+		free(pool->frames[i].base.data);
+	}
+
+	os_mutex_destroy(&pool->mutex);
+	free(pool);
+}
+
+static void
+pool_frame_release(struct xrt_frame *xf)
+{
+	struct wmr_camera_pool_frame *pf = (struct wmr_camera_pool_frame *)xf;
+	struct wmr_camera_frame_pool *pool = pf->pool;
+
+	os_mutex_lock(&pool->mutex);
+	pf->in_use = false;
+	os_mutex_unlock(&pool->mutex);
+
+	// Each frame in use holds a reference to the pool.
+	pool_unref(pool);
+}
+
+static struct wmr_camera_frame_pool *
+pool_create(int frame_count)
+{
+	struct wmr_camera_frame_pool *pool = U_TYPED_CALLOC(struct wmr_camera_frame_pool);
+	if (os_mutex_init(&pool->mutex) != 0) {
+		free(pool);
+		return NULL;
+	}
+
+	pool->frame_count = frame_count;
+	for (int i = 0; i < frame_count; i++) {
+		pool->frames[i].pool = pool;
+		pool->frames[i].base.destroy = pool_frame_release;
+	}
+
+	// Reference held by the camera.
+	xrt_reference_inc(&pool->ref);
+
+	return pool;
+}
+
+/*!
+ * Get a free frame from the pool, (re)allocating its memory if the frame size
+ * changed. Returns false if all frames are in use downstream.
+ */
+static bool
+pool_acquire(struct wmr_camera_frame_pool *pool,
+             enum xrt_format format,
+             uint32_t width,
+             uint32_t height,
+             struct xrt_frame **out_frame)
+{
+	struct wmr_camera_pool_frame *pf = NULL;
+
+	os_mutex_lock(&pool->mutex);
+	for (int i = 0; i < pool->frame_count; i++) {
+		if (!pool->frames[i].in_use) {
+			pf = &pool->frames[i];
+			pf->in_use = true;
+			break;
+		}
+	}
+	os_mutex_unlock(&pool->mutex);
+
+	if (pf == NULL) {
+		return false;
+	}
+
+	struct xrt_frame *xf = &pf->base;
+	if (xf->data == NULL || xf->format != format || xf->width != width || xf->height != height) {
+		xf->format = format;
+		xf->width = width;
+		xf->height = height;
+		u_format_size_for_dimensions(format, width, height, &xf->stride, &xf->size);
+		xf->data = (uint8_t *)realloc(xf->data, xf->size);
+	}
+
+	xrt_reference_inc(&pool->ref);
+	xrt_frame_reference(out_frame, xf);
+
+	return true;
+}
+
+
+/*
+ *
+ * Transfer handling.
+ *
+ */
+
 static void *
 wmr_cam_usb_thread(void *ptr)
 {
@@ -276,92 +415,57 @@ set_active(struct wmr_camera *cam, bool active)
 	return send_buffer_to_device(cam, (uint8_t *)&cmd, sizeof(cmd));
 }
 
-static void LIBUSB_CALL
-img_xfer_cb(struct libusb_transfer *xfer)
+static void
+parse_xfer(struct wmr_camera *cam, struct libusb_transfer *xfer)
 {
 	DRV_TRACE_MARKER();
 
-	struct wmr_camera *cam = xfer->user_data;
-
-	if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
-		WMR_CAM_DEBUG(cam, "Camera transfer completed with status: %s (%u)", libusb_error_name(xfer->status),
-		              xfer->status);
-		goto out;
-	}
-
-	if (xfer->actual_length < xfer->length) {
-		WMR_CAM_DEBUG(cam, "Camera transfer only delivered %d bytes", xfer->actual_length);
-		goto out;
-	}
-
-	WMR_CAM_TRACE(cam, "Camera transfer complete - %d bytes of %d", xfer->actual_length, xfer->length);
-
 	/* Convert the output into frames and send them off to debug / tracking */
 	struct xrt_frame *xf = NULL;
 
 	/* There's always one extra line of pixels with exposure info */
-	u_frame_create_one_off(XRT_FORMAT_L8, cam->frame_width, cam->frame_height + 1, &xf);
-
-	const uint8_t *src = xfer->buffer;
+	if (!pool_acquire(cam->pool, XRT_FORMAT_L8, cam->frame_width, cam->frame_height + 1, &xf)) {
+		WMR_CAM_DEBUG(cam, "No free frame in pool, dropping camera frame");
+		cam->stats.dropped_pool++;
+		return;
+	}
 
-	uint8_t *dst = xf->data;
-	size_t dst_remain = xf->size;
-	const size_t chunk_size = 0x6000 - 32;
+	struct wmr_camera_xfer_footer footer;
 
 	DRV_TRACE_BEGIN(copy_to_frame);
-	while (dst_remain > 0) {
-		const size_t to_copy = dst_remain > chunk_size ? chunk_size : dst_remain;
-
-		/* 32 byte header seems to contain:
-		 *   __be32 magic = "Dlo+"
-		 *   __le32 frame_ctr;
-		 *   __le32 slice_ctr;
-		 *   __u8 unknown[20]; - binary block where all bytes are different each slice,
-		 *                       but repeat every 8 slices. They're different each boot
-		 *                       of the headset. Might just be uninitialised memory?
-		 */
-		src += 0x20;
-
-		memcpy(dst, src, to_copy);
-		src += to_copy;
-		dst += to_copy;
-		dst_remain -= to_copy;
-	}
+	bool unpacked = wmr_camera_xfer_unpack(xfer->buffer, xfer->actual_length, xf->data, xf->size, &footer);
 	DRV_TRACE_END(copy_to_frame);
 
-	/* There should be exactly a 26 byte footer left over */
-	assert(xfer->buffer + xfer->length - src == 26);
+	if (!unpacked) {
+		WMR_CAM_WARN(cam, "Malformed camera transfer of %d bytes", xfer->actual_length);
+		cam->stats.malformed++;
+		xrt_frame_reference(&xf, NULL);
+		return;
+	}
 
-	/* Footer contains:
-	 * __le64 start_ts; - 100ns unit timestamp, from same clock as video_timestamps on the IMU feed
-	 * __le64 end_ts;   - 100ns unit timestamp, always about 111000 * 100ns later than start_ts ~= 90Hz
-	 * __le16 ctr1;     - Counter that increments by 88, but sometimes by 96, and wraps at 16384
-	 * __le16 unknown0  - Unknown value, has only ever been 0
-	 * __be32 magic     - "Dlo+"
-	 * __le16 frametype?- either 0x00 or 0x02. Every 3rd frame is 0x0, others are 0x2. Might be SLAM vs controllers?
-	 */
-	uint64_t frame_start_ts = read64(&src) * WMR_MS_HOLOLENS_NS_PER_TICK;
-	uint64_t frame_end_ts = read64(&src) * WMR_MS_HOLOLENS_NS_PER_TICK;
+	uint64_t frame_start_ts = footer.start_ts_ns;
+	uint64_t frame_end_ts = footer.end_ts_ns;
 	int64_t delta = frame_end_ts - frame_start_ts;
 
-	uint16_t unknown16 = read16(&src);
-	uint16_t unknown16_2 = read16(&src);
-	src += 4; // Skip "Dlo+" magic bytes
-	uint16_t frametype = read16(&src);
 	/* frametype 0 is SLAM, frametype 2 is controller tracking */
-	bool slam_tracking_frame = (frametype == WMR_FRAMETYPE_SLAM);
+	bool slam_tracking_frame = (footer.frametype == WMR_FRAMETYPE_SLAM);
 
 	WMR_CAM_TRACE(cam,
 	              "Frame start TS %" PRIu64 " (%" PRIi64 " since last) end %" PRIu64 " dt %" PRIi64
 	              " unknown %u %u frame type %u",
-	              frame_start_ts, frame_start_ts - cam->last_frame_ts, frame_end_ts, delta, unknown16, unknown16_2,
-	              frametype);
+	              frame_start_ts, frame_start_ts - cam->last_frame_ts, frame_end_ts, delta, footer.ctr,
+	              footer.unknown, footer.frametype);
 
 	/* Read values from the pixel header */
 	uint16_t exposure = xf->data[6] << 8 | xf->data[7];
 	uint8_t seq = xf->data[89];
 	uint8_t seq_delta = seq - cam->last_seq;
 
+	/* Anything but the next sequence number means frames went missing */
+	if (cam->frame_sequence != 0 && seq_delta > 1) {
+		cam->stats.dropped_seq += seq_delta - 1;
+	}
+
 	/* Extend the sequence number to 64-bits */
 	cam->frame_sequence += seq_delta;
 
@@ -402,7 +506,89 @@ img_xfer_cb(struct libusb_transfer *xfer)
 		}
 	}
 
+	cam->stats.frames++;
+
 	xrt_frame_reference(&xf, NULL);
+}
+
+static void *
+wmr_cam_parse_thread(void *ptr)
+{
+	U_TRACE_SET_THREAD_NAME("WMR: Camera parse");
+
+	struct wmr_camera *cam = ptr;
+
+	os_thread_helper_lock(&cam->parse_thread);
+	while (os_thread_helper_is_running_locked(&cam->parse_thread)) {
+		if (cam->parse_queue.count == 0) {
+			os_thread_helper_wait_locked(&cam->parse_thread);
+			continue;
+		}
+
+		struct libusb_transfer *xfer = cam->parse_queue.xfers[cam->parse_queue.head];
+		uint64_t completed_ns = cam->parse_queue.completed_ns[cam->parse_queue.head];
+		cam->parse_queue.head = (cam->parse_queue.head + 1) % MAX_XFERS;
+		cam->parse_queue.count--;
+
+		os_thread_helper_unlock(&cam->parse_thread);
+
+		if (os_monotonic_get_ns() - completed_ns > LATE_FRAME_NS) {
+			cam->stats.late++;
+		}
+
+		parse_xfer(cam, xfer);
+
+		// The data has been copied out, give the buffer back to libusb.
+		libusb_submit_transfer(xfer);
+
+		os_thread_helper_lock(&cam->parse_thread);
+	}
+	os_thread_helper_unlock(&cam->parse_thread);
+
+	return NULL;
+}
+
+static void LIBUSB_CALL
+img_xfer_cb(struct libusb_transfer *xfer)
+{
+	DRV_TRACE_MARKER();
+
+	struct wmr_camera *cam = xfer->user_data;
+
+	if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		WMR_CAM_DEBUG(cam, "Camera transfer completed with status: %s (%u)", libusb_error_name(xfer->status),
+		              xfer->status);
+		if (xfer->status != LIBUSB_TRANSFER_CANCELLED) {
+			cam->stats.dropped_xfer++;
+		}
+		goto out;
+	}
+
+	if (xfer->actual_length < xfer->length) {
+		WMR_CAM_DEBUG(cam, "Camera transfer only delivered %d bytes", xfer->actual_length);
+		cam->stats.dropped_xfer++;
+		goto out;
+	}
+
+	WMR_CAM_TRACE(cam, "Camera transfer complete - %d bytes of %d", xfer->actual_length, xfer->length);
+
+	/*
+	 * Hand the transfer over to the parse thread, it is resubmitted once
+	 * the frame has been copied out so that the libusb event thread never
+	 * waits on parsing or downstream sinks.
+	 */
+	os_thread_helper_lock(&cam->parse_thread);
+	if (os_thread_helper_is_running_locked(&cam->parse_thread)) {
+		// Can't overflow, each transfer is at most once in the queue.
+		int index = (cam->parse_queue.head + cam->parse_queue.count) % MAX_XFERS;
+		cam->parse_queue.xfers[index] = xfer;
+		cam->parse_queue.completed_ns[index] = os_monotonic_get_ns();
+		cam->parse_queue.count++;
+		os_thread_helper_signal_locked(&cam->parse_thread);
+		os_thread_helper_unlock(&cam->parse_thread);
+		return;
+	}
+	os_thread_helper_unlock(&cam->parse_thread);
 
 out:
 	libusb_submit_transfer(xfer);
@@ -433,12 +619,23 @@ wmr_camera_open(struct wmr_camera_open_config *config)
 		cam->cam_sinks[i] = config->tcam_sinks[i];
 	}
 
-	if (os_thread_helper_init(&cam->usb_thread) != 0) {
+	cam->xfer_count = (int)debug_get_num_option_wmr_camera_xfers();
+	cam->xfer_count = CLAMP(cam->xfer_count, 1, MAX_XFERS);
+
+	if (os_thread_helper_init(&cam->usb_thread) != 0 || os_thread_helper_init(&cam->parse_thread) != 0) {
 		WMR_CAM_ERROR(cam, "Failed to initialise threading");
 		wmr_camera_free(cam);
 		return NULL;
 	}
 
+	int pool_frame_count = (int)debug_get_num_option_wmr_camera_pool_frames();
+	cam->pool = pool_create(CLAMP(pool_frame_count, 1, MAX_POOL_FRAMES));
+	if (cam->pool == NULL) {
+		WMR_CAM_ERROR(cam, "Failed to create frame pool");
+		wmr_camera_free(cam);
+		return NULL;
+	}
+
 	res = libusb_init(&cam->ctx);
 	if (res < 0) {
 		goto fail;
@@ -461,7 +658,12 @@ wmr_camera_open(struct wmr_camera_open_config *config)
 		goto fail;
 	}
 
-	for (i = 0; i < NUM_XFERS; i++) {
+	if (os_thread_helper_start(&cam->parse_thread, wmr_cam_parse_thread, cam) != 0) {
+		WMR_CAM_ERROR(cam, "Failed to start camera parse thread");
+		goto fail;
+	}
+
+	for (i = 0; i < cam->xfer_count; i++) {
 		cam->xfers[i] = libusb_alloc_transfer(0);
 		if (cam->xfers[i] == NULL) {
 			res = LIBUSB_ERROR_NO_MEM;
@@ -497,6 +699,15 @@ wmr_camera_open(struct wmr_camera_open_config *config)
 	u_var_add_sink_debug(cam, &cam->debug_sinks[WMR_DEBUG_SINK_CONTROLLER], "Controller Tracking Streams");
 	u_var_add_gui_header_end(cam, NULL, NULL);
 
+	u_var_add_gui_header_begin(cam, NULL, "Transfer statistics");
+	u_var_add_ro_u64(cam, &cam->stats.frames, "Frames");
+	u_var_add_ro_u64(cam, &cam->stats.dropped_seq, "Dropped (sequence gaps)");
+	u_var_add_ro_u64(cam, &cam->stats.dropped_xfer, "Dropped (transfer errors)");
+	u_var_add_ro_u64(cam, &cam->stats.malformed, "Dropped (malformed)");
+	u_var_add_ro_u64(cam, &cam->stats.dropped_pool, "Dropped (pool empty)");
+	u_var_add_ro_u64(cam, &cam->stats.late, "Late");
+	u_var_add_gui_header_end(cam, NULL, NULL);
+
 	u_var_add_gui_header_begin(cam, NULL, "Exposure and gain control");
 	u_var_add_bool(cam, &cam->unify_expgains, "Use same values");
 
@@ -540,20 +751,34 @@ wmr_camera_free(struct wmr_camera *cam)
 	// Stop the camera.
 	wmr_camera_stop(cam);
 
-	if (cam->ctx != NULL) {
-		int i;
+	/*
+	 * The threads are set up before the libusb context, opening can fail
+	 * in between. Stop parsing and resubmitting transfers before closing
+	 * the device.
+	 */
+	if (cam->parse_thread.initialized) {
+		os_thread_helper_destroy(&cam->parse_thread);
+	}
 
+	if (cam->usb_thread.initialized) {
 		os_thread_helper_lock(&cam->usb_thread);
 		cam->usb_complete = 1;
 		os_thread_helper_unlock(&cam->usb_thread);
+	}
 
-		if (cam->dev != NULL) {
-			libusb_close(cam->dev);
-		}
+	if (cam->dev != NULL) {
+		libusb_close(cam->dev);
+		cam->dev = NULL;
+	}
 
+	if (cam->usb_thread.initialized) {
 		os_thread_helper_destroy(&cam->usb_thread);
+	}
 
-		for (i = 0; i < NUM_XFERS; i++) {
+	if (cam->ctx != NULL) {
+		int i;
+
+		for (i = 0; i < MAX_XFERS; i++) {
 			if (cam->xfers[i] == NULL) {
 				continue;
 			}
@@ -566,6 +791,12 @@ wmr_camera_free(struct wmr_camera *cam)
 		cam->ctx = NULL;
 	}
 
+	// Frames still held downstream keep the pool alive.
+	if (cam->pool != NULL) {
+		pool_unref(cam->pool);
+		cam->pool = NULL;
+	}
+
 	// Tidy the variable tracking.
 	u_var_remove_root(cam);
 	u_sink_debug_destroy(&cam->debug_sinks[WMR_DEBUG_SINK_SLAM]);
@@ -601,7 +832,7 @@ wmr_camera_start(struct wmr_camera *cam)
 		goto fail;
 	}
 
-	for (int i = 0; i < NUM_XFERS; i++) {
+	for (int i = 0; i < cam->xfer_count; i++) {
 		uint8_t *recv_buf = malloc(cam->xfer_size);
 
 		libusb_fill_bulk_transfer(cam->xfers[i], cam->dev, LIBUSB_ENDPOINT_IN | 5, recv_buf, cam->xfer_size,
@@ -642,7 +873,7 @@ wmr_camera_stop(struct wmr_camera *cam)
 	}
 	cam->running = false;
 
-	for (i = 0; i < NUM_XFERS; i++) {
+	for (i = 0; i < cam->xfer_count; i++) {
 		if (cam->xfers[i] != NULL) {
 			libusb_cancel_transfer(cam->xfers[i]);
 		}
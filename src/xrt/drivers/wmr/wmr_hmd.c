@@ -33,6 +33,7 @@
 #include "util/u_misc.h"
 #include "util/u_time.h"
 #include "util/u_debug.h"
+#include "util/u_calibration_cache.h"
 #include "util/u_device.h"
 #include "util/u_trace_marker.h"
 #include "util/u_distortion_mesh.h"
@@ -54,6 +55,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <inttypes.h>
 #ifndef XRT_OS_WINDOWS
 #include <unistd.h> // for sleep()
 #endif
@@ -452,14 +454,15 @@ hololens_handle_sensors_all(struct wmr_hmd *wh, const unsigned char *buffer, int
 	}
 
 	// Fusion tracking
-	os_mutex_lock(&wh->fusion.mutex);
+	struct m_imu_3dof_sample samples[IMU_SAMPLES_PER_PACKET];
 	for (int i = 0; i < IMU_SAMPLES_PER_PACKET; i++) {
-		m_imu_3dof_update(                                              //
-		    &wh->fusion.i3dof,                                          //
-		    wh->packet.gyro_timestamp[i] * WMR_MS_HOLOLENS_NS_PER_TICK, //
-		    &calib_accel[i],                                            //
-		    &calib_gyro[i]);                                            //
+		samples[i].timestamp_ns = wh->packet.gyro_timestamp[i] * WMR_MS_HOLOLENS_NS_PER_TICK;
+		samples[i].accel = calib_accel[i];
+		samples[i].gyro = calib_gyro[i];
 	}
+
+	os_mutex_lock(&wh->fusion.mutex);
+	m_imu_3dof_update_batch(&wh->fusion.i3dof, samples, IMU_SAMPLES_PER_PACKET, NULL);
 	wh->fusion.last_imu_timestamp_ns = now_ns;
 	wh->fusion.last_angular_velocity = calib_gyro[3];
 	os_mutex_unlock(&wh->fusion.mutex);
@@ -969,8 +972,23 @@ wmr_read_config_part(struct wmr_hmd *wh, unsigned char type, unsigned char *data
 	return offset;
 }
 
+/*!
+ * The config store has no version we can read up front, so the cache is keyed
+ * on its size and a hash of the metadata block describing it.
+ */
+static void
+wmr_config_cache_version(const unsigned char *meta, size_t meta_size, char *out, size_t out_size)
+{
+	uint64_t hash = u_calibration_cache_hash(meta, meta_size);
+
+	// A short read still gets a key, the hash tells it apart.
+	unsigned store_size = meta_size >= 2 ? (unsigned)(meta[0] | (meta[1] << 8)) : 0;
+
+	snprintf(out, out_size, "store%u-%016" PRIx64, store_size, hash);
+}
+
 XRT_MAYBE_UNUSED static int
-wmr_read_config_raw(struct wmr_hmd *wh, uint8_t **out_data, size_t *out_size)
+wmr_read_config_raw(struct wmr_hmd *wh, const char *serial, uint8_t **out_data, size_t *out_size)
 {
 	DRV_TRACE_MARKER();
 
@@ -986,6 +1004,18 @@ wmr_read_config_raw(struct wmr_hmd *wh, uint8_t **out_data, size_t *out_size)
 		return -1;
 	}
 
+	// Reading the data store takes hundreds of sync commands, use the cache if possible.
+	char version[32];
+	wmr_config_cache_version(meta, (size_t)size, version, sizeof(version));
+
+	size_t cached_size = 0;
+	if (u_calibration_cache_load("wmr", serial, version, &data, &cached_size)) {
+		WMR_INFO(wh, "Using cached config for %s", serial);
+		*out_data = data;
+		*out_size = cached_size;
+		return 0;
+	}
+
 	/*
 	 * No idea what the other 64 bytes of metadata are, but the first two
 	 * seem to be little endian size of the data store.
@@ -1006,6 +1036,8 @@ wmr_read_config_raw(struct wmr_hmd *wh, uint8_t **out_data, size_t *out_size)
 
 	WMR_DEBUG(wh, "Read %d-byte config data", data_size);
 
+	u_calibration_cache_store("wmr", serial, version, data, size);
+
 	*out_data = data;
 	*out_size = size;
 
@@ -1013,7 +1045,7 @@ wmr_read_config_raw(struct wmr_hmd *wh, uint8_t **out_data, size_t *out_size)
 }
 
 static int
-wmr_read_config(struct wmr_hmd *wh)
+wmr_read_config(struct wmr_hmd *wh, const char *serial)
 {
 	DRV_TRACE_MARKER();
 
@@ -1023,7 +1055,7 @@ wmr_read_config(struct wmr_hmd *wh)
 	int ret;
 
 	// Read config
-	ret = wmr_read_config_raw(wh, &data, &data_size);
+	ret = wmr_read_config_raw(wh, serial, &data, &data_size);
 	if (ret < 0)
 		return ret;
 
@@ -1886,15 +1918,31 @@ wmr_hmd_setup_trackers(struct wmr_hmd *wh, struct xrt_slam_sinks *out_sinks, str
 	// Setup sinks depending on tracking configuration
 	struct xrt_slam_sinks entry_sinks = {0};
 	if (slam_enabled && hand_enabled) {
-		struct xrt_frame_sink *entry_cam0_sink = NULL;
-		struct xrt_frame_sink *entry_cam1_sink = NULL;
-
-		u_sink_split_create(&wh->tracking.xfctx, slam_sinks->cams[0], hand_sinks->cams[0], &entry_cam0_sink);
-		u_sink_split_create(&wh->tracking.xfctx, slam_sinks->cams[1], hand_sinks->cams[1], &entry_cam1_sink);
-
 		entry_sinks = *slam_sinks;
-		entry_sinks.cams[0] = entry_cam0_sink;
-		entry_sinks.cams[1] = entry_cam1_sink;
+
+		// SLAM always gets the frame first, the hand tracker has its own async stage.
+		for (int i = 0; i < 2; i++) {
+			struct u_sink_fanout_consumer consumers[2] = {
+			    {
+			        .sink = slam_sinks->cams[i],
+			        .name = "SLAM",
+			        .priority = 100,
+			        .policy = U_SINK_FANOUT_SYNC,
+			    },
+			    {
+			        .sink = hand_sinks->cams[i],
+			        .name = "Hand tracking",
+			        .priority = 0,
+			        .policy = U_SINK_FANOUT_SYNC,
+			    },
+			};
+			char name[32];
+			(void)snprintf(name, sizeof(name), "WMR tracker cam%d routing", i);
+			if (!u_sink_fanout_create(&wh->tracking.xfctx, name, consumers, 2, &entry_sinks.cams[i])) {
+				WMR_WARN(wh, "Unable to setup the camera routing");
+				return false;
+			}
+		}
 	} else if (slam_enabled) {
 		entry_sinks = *slam_sinks;
 	} else if (hand_enabled) {
@@ -1921,6 +1969,7 @@ wmr_hmd_create(enum wmr_headset_type hmd_type,
                struct os_hid_device *hid_holo,
                struct os_hid_device *hid_ctrl,
                struct xrt_prober_device *dev_holo,
+               const char *serial,
                enum u_logging_level log_level,
                struct xrt_device **out_hmd,
                struct xrt_device **out_handtracker,
@@ -2001,7 +2050,7 @@ wmr_hmd_create(enum wmr_headset_type hmd_type,
 	wh->base.inputs[0].name = XRT_INPUT_GENERIC_HEAD_POSE;
 
 	// Read config file from HMD
-	if (wmr_read_config(wh) < 0) {
+	if (wmr_read_config(wh, serial) < 0) {
 		WMR_ERROR(wh, "Failed to load headset configuration!");
 		wmr_hmd_destroy(&wh->base);
 		wh = NULL;
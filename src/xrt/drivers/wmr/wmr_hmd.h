@@ -204,11 +204,18 @@ wmr_hmd(struct xrt_device *p)
 	return (struct wmr_hmd *)p;
 }
 
+/*!
+ * Create a WMR headset.
+ *
+ * @param serial USB serial of the HoloLens sensors device, used to cache the
+ *               config read from it, may be NULL.
+ */
 void
 wmr_hmd_create(enum wmr_headset_type hmd_type,
                struct os_hid_device *hid_holo,
                struct os_hid_device *hid_ctrl,
                struct xrt_prober_device *dev_holo,
+               const char *serial,
                enum u_logging_level log_level,
                struct xrt_device **out_hmd,
                struct xrt_device **out_handtracker,
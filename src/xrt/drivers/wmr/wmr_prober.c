@@ -354,8 +354,14 @@ wmr_create_headset(struct xrt_prober *xp,
 	struct xrt_device *ht = NULL;
 	struct xrt_device *two_hands[2] = {NULL, NULL}; // Must initialize, always returned.
 	struct xrt_device *hmd_left_ctrl = NULL, *hmd_right_ctrl = NULL;
-	wmr_hmd_create(type, hid_holo, hid_companion, xpdev_holo, log_level, &hmd, &ht, &hmd_left_ctrl,
-	               &hmd_right_ctrl);
+	unsigned char serial[256] = {0};
+	if (xrt_prober_get_string_descriptor(xp, xpdev_holo, XRT_PROBER_STRING_SERIAL_NUMBER, serial,
+	                                     sizeof(serial)) <= 0) {
+		serial[0] = '\0';
+	}
+
+	wmr_hmd_create(type, hid_holo, hid_companion, xpdev_holo, (const char *)serial, log_level, &hmd, &ht,
+	               &hmd_left_ctrl, &hmd_right_ctrl);
 
 	if (hmd == NULL) {
 		U_LOG_IFL_E(log_level, "Failed to create WMR HMD device.");
@@ -12,6 +12,8 @@
 
 #include "wmr_protocol.h"
 
+#include <string.h>
+
 
 /*
  *
@@ -58,3 +60,102 @@ vec3_from_hololens_gyro(int16_t sample[3][32], int i, struct xrt_vec3 *out_vec)
 	                     sample[2][8 * i + 7]) *
 	             0.001f * 0.125f;
 }
+
+
+/*
+ *
+ * WMR camera protocol helpers
+ *
+ */
+
+/*
+ * Some WMR headsets use 616538 byte transfers. HP G2 needs 1233018 (4 cameras)
+ * As a general formula, it seems we have:
+ *
+ *   F = camera frames X * (Y+1) + 26
+ *   n_packets = F/(0x6000-32)
+ *   leftover = F - n_packets*(0x6000-32)
+ *   size = n_packets * 0x6000 + 32 + leftover,
+ *
+ *   so for 2 x 640x480 cameras:
+ *      F = 2 * 640 * 481 + 26 = 615706
+ *      n_packets = 615706 / 24544 = 25
+ *      leftover = 615706 - 25 * 24544 = 2106
+ *      size = 25 * 0x6000 + 32 + 2106 = 616538
+ *
+ *  For HP G2 = 4 x 640 * 480 cameras:
+ *      F = 4 * 640 * 481 + 26 = 1231386
+ *      n_packets = 1231386 / 24544 = 50
+ *      leftover = 1231386 - 50 * 24544 = 4186
+ *      size = 50 * 0x6000 + 32 + 4186 = 1233018
+ *
+ *  It would be good to test these calculations on other headsets with
+ *  different camera setups.
+ */
+size_t
+wmr_camera_xfer_size(size_t frame_size)
+{
+	const size_t chunk_size = WMR_CAMERA_XFER_PACKET_SIZE - WMR_CAMERA_XFER_HEADER_SIZE;
+
+	size_t F = frame_size + WMR_CAMERA_XFER_FOOTER_SIZE;
+	size_t n_packets = F / chunk_size;
+	size_t leftover = F - n_packets * chunk_size;
+
+	return n_packets * WMR_CAMERA_XFER_PACKET_SIZE + WMR_CAMERA_XFER_HEADER_SIZE + leftover;
+}
+
+bool
+wmr_camera_xfer_unpack(const uint8_t *buf,
+                       size_t buf_size,
+                       uint8_t *dst,
+                       size_t dst_size,
+                       struct wmr_camera_xfer_footer *out_footer)
+{
+	const size_t chunk_size = WMR_CAMERA_XFER_PACKET_SIZE - WMR_CAMERA_XFER_HEADER_SIZE;
+	const uint8_t *src = buf;
+	const uint8_t *end = buf + buf_size;
+
+	while (dst_size > 0) {
+		const size_t to_copy = dst_size > chunk_size ? chunk_size : dst_size;
+
+		/* 32 byte header seems to contain:
+		 *   __be32 magic = "Dlo+"
+		 *   __le32 frame_ctr;
+		 *   __le32 slice_ctr;
+		 *   __u8 unknown[20]; - binary block where all bytes are different each slice,
+		 *                       but repeat every 8 slices. They're different each boot
+		 *                       of the headset. Might just be uninitialised memory?
+		 */
+		if ((size_t)(end - src) < WMR_CAMERA_XFER_HEADER_SIZE + to_copy) {
+			return false;
+		}
+		src += WMR_CAMERA_XFER_HEADER_SIZE;
+
+		memcpy(dst, src, to_copy);
+		src += to_copy;
+		dst += to_copy;
+		dst_size -= to_copy;
+	}
+
+	/* There should be exactly a 26 byte footer left over */
+	if (end - src != WMR_CAMERA_XFER_FOOTER_SIZE) {
+		return false;
+	}
+
+	/* Footer contains:
+	 * __le64 start_ts; - 100ns unit timestamp, from same clock as video_timestamps on the IMU feed
+	 * __le64 end_ts;   - 100ns unit timestamp, always about 111000 * 100ns later than start_ts ~= 90Hz
+	 * __le16 ctr1;     - Counter that increments by 88, but sometimes by 96, and wraps at 16384
+	 * __le16 unknown0  - Unknown value, has only ever been 0
+	 * __be32 magic     - "Dlo+"
+	 * __le16 frametype?- either 0x00 or 0x02. Every 3rd frame is 0x0, others are 0x2. Might be SLAM vs controllers?
+	 */
+	out_footer->start_ts_ns = read64(&src) * WMR_MS_HOLOLENS_NS_PER_TICK;
+	out_footer->end_ts_ns = read64(&src) * WMR_MS_HOLOLENS_NS_PER_TICK;
+	out_footer->ctr = (uint16_t)read16(&src);
+	out_footer->unknown = (uint16_t)read16(&src);
+	src += 4; // Skip "Dlo+" magic bytes
+	out_footer->frametype = (uint16_t)read16(&src);
+
+	return true;
+}
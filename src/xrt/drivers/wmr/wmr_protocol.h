@@ -74,6 +74,16 @@ enum wmr_bt_control_msg
 
 static const unsigned char hololens_sensors_imu_on[64] = {0x02, 0x07};
 
+/*
+ * Camera bulk transfers are split into 0x6000 byte packets, each starting
+ * with a 32 byte header, holding the frame data for each camera in turn.
+ * Each camera frame has an extra (first) line with metadata, and there is
+ * a 26 byte footer at the end of the transfer.
+ */
+#define WMR_CAMERA_XFER_PACKET_SIZE 0x6000
+#define WMR_CAMERA_XFER_HEADER_SIZE 0x20
+#define WMR_CAMERA_XFER_FOOTER_SIZE 26
+
 
 struct hololens_sensors_packet
 {
@@ -86,6 +96,23 @@ struct hololens_sensors_packet
 	uint64_t video_timestamp[4];
 };
 
+/*!
+ * Decoded footer of a camera bulk transfer.
+ */
+struct wmr_camera_xfer_footer
+{
+	//! Exposure start, same clock as video_timestamps on the IMU feed.
+	uint64_t start_ts_ns;
+	//! Exposure end, always about 11.1ms after @p start_ts_ns.
+	uint64_t end_ts_ns;
+	//! Counter that increments by 88, sometimes by 96, and wraps at 16384.
+	uint16_t ctr;
+	//! Unknown value, has only ever been 0.
+	uint16_t unknown;
+	//! Either 0x00 (SLAM) or 0x02 (controller tracking).
+	uint16_t frametype;
+};
+
 struct wmr_config_header
 {
 	uint32_t json_start;
@@ -119,6 +146,25 @@ void
 vec3_from_hololens_gyro(int16_t sample[3][32], int i, struct xrt_vec3 *out_vec);
 
 
+/*!
+ * Size of a camera bulk transfer carrying @p frame_size bytes of combined
+ * camera frames (including the extra metadata line of each camera).
+ */
+size_t
+wmr_camera_xfer_size(size_t frame_size);
+
+/*!
+ * Strip the packet headers from a camera bulk transfer, copying the combined
+ * camera frames into @p dst and decoding the footer. Returns false if the
+ * transfer does not hold exactly @p dst_size bytes of frame data.
+ */
+bool
+wmr_camera_xfer_unpack(const uint8_t *buf,
+                       size_t buf_size,
+                       uint8_t *dst,
+                       size_t dst_size,
+                       struct wmr_camera_xfer_footer *out_footer);
+
 static inline uint8_t
 read8(const unsigned char **buffer)
 {
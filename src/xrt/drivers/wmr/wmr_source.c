@@ -12,9 +12,10 @@
 #include "wmr_protocol.h"
 
 #include "math/m_api.h"
-#include "math/m_clock_offset.h"
+#include "math/m_clock_sync.h"
 #include "math/m_filter_fifo.h"
 #include "util/u_debug.h"
+#include "util/u_frame.h"
 #include "util/u_sink.h"
 #include "util/u_var.h"
 #include "util/u_trace_marker.h"
@@ -45,6 +46,39 @@
 
 DEBUG_GET_ONCE_LOG_OPTION(wmr_log, "WMR_LOG", U_LOGGING_INFO)
 
+/*!
+ * Frames queued for the debug UI preview sinks before dropping the oldest one.
+ * Queued frames keep their camera pool frame alive, so this stays well below
+ * WMR_CAMERA_POOL_FRAMES to leave the pool to SLAM and the USB transfers.
+ */
+#define WMR_UI_QUEUE_SIZE 2
+
+/*!
+ * Frames queued for the recording sinks before dropping new ones, a few
+ * seconds of frames. They are copies, so they do not hold on to the pool.
+ */
+#define WMR_RECORD_QUEUE_SIZE 128
+
+struct wmr_source;
+
+/*!
+ * Per camera routing, the frame goes to the SLAM sinks first on the camera
+ * thread, then a copy to the recording queue if a recorder is attached, then
+ * to the debug UI preview on its own queue.
+ */
+struct wmr_source_cam_route
+{
+	struct xrt_frame_sink slam_sink;     //!< Forwards to the downstream SLAM sink
+	struct xrt_frame_sink record_sink;   //!< Copies the frame into @ref record_queue
+	struct xrt_frame_sink ui_sink;       //!< Forwards to the debug UI preview sink
+	struct xrt_frame_sink *entry;        //!< Fan-out in front of the three above
+	struct xrt_frame_sink *record_queue; //!< Deep queue in front of @ref record_out
+	struct xrt_frame_sink record_out;    //!< Forwards to the recording sink
+	struct u_sink_queue_stats record_stats;
+	struct wmr_source *ws;
+	int cam_id;
+};
+
 /*!
  * Handles all the data sources from the WMR driver
  *
@@ -68,14 +102,18 @@ struct wmr_source
 	struct xrt_slam_sinks out_sinks;                  //!< Pointers to downstream sinks
 
 	// UI Sinks (head tracking)
-	struct u_sink_debug ui_cam_sinks[WMR_MAX_CAMERAS]; //!< Sink to display camera frames in UI
-	struct m_ff_vec3_f32 *gyro_ff;                     //!< Queue of gyroscope data to display in UI
-	struct m_ff_vec3_f32 *accel_ff;                    //!< Queue of accelerometer data to display in UI
+	struct u_sink_debug ui_cam_sinks[WMR_MAX_CAMERAS];     //!< Sink to display camera frames in UI
+	struct u_sink_debug record_cam_sinks[WMR_MAX_CAMERAS]; //!< Sink to record camera frames without drops
+	struct m_ff_vec3_f32 *gyro_ff;                         //!< Queue of gyroscope data to display in UI
+	struct m_ff_vec3_f32 *accel_ff;                        //!< Queue of accelerometer data to display in UI
+
+	struct wmr_source_cam_route cam_routes[WMR_MAX_CAMERAS]; //!< Camera frame fan-out
 
 	bool is_running;              //!< Whether the device is streaming
 	bool first_imu_received;      //!< Don't send frames until first IMU sample
 	timepoint_ns last_imu_ns;     //!< Last timepoint received.
-	time_duration_ns hw2mono;     //!< Estimated offset from IMU to monotonic clock
+	struct m_clock_sync clock;    //!< Filtered mapping from IMU to monotonic clock, IMU thread only
+	time_duration_ns hw2mono;     //!< Offset from IMU to monotonic clock at the last IMU sample
 	time_duration_ns cam_hw2mono; //!< Caches hw2mono for use in the full frame bundle
 };
 
@@ -95,10 +133,7 @@ struct wmr_source
 		xf->timestamp += ws->cam_hw2mono;                                                                      \
 		WMR_TRACE(ws, "cam" #cam_id " img t=%" PRId64 " source_t=%" PRId64, xf->timestamp,                     \
 		          xf->source_timestamp);                                                                       \
-		u_sink_debug_push_frame(&ws->ui_cam_sinks[cam_id], xf);                                                \
-		if (ws->out_sinks.cams[cam_id] && ws->first_imu_received) {                                            \
-			xrt_sink_push_frame(ws->out_sinks.cams[cam_id], xf);                                           \
-		}                                                                                                      \
+		xrt_sink_push_frame(ws->cam_routes[cam_id].entry, xf);                                                 \
 	}
 
 DEFINE_RECEIVE_CAM(0)
@@ -114,6 +149,47 @@ void (*receive_cam[WMR_MAX_CAMERAS])(struct xrt_frame_sink *, struct xrt_frame *
     receive_cam3, //
 };
 
+static void
+route_cam_to_slam(struct xrt_frame_sink *sink, struct xrt_frame *xf)
+{
+	struct wmr_source_cam_route *route = container_of(sink, struct wmr_source_cam_route, slam_sink);
+	struct wmr_source *ws = route->ws;
+
+	if (ws->out_sinks.cams[route->cam_id] && ws->first_imu_received) {
+		xrt_sink_push_frame(ws->out_sinks.cams[route->cam_id], xf);
+	}
+}
+
+static void
+route_cam_to_record(struct xrt_frame_sink *sink, struct xrt_frame *xf)
+{
+	struct wmr_source_cam_route *route = container_of(sink, struct wmr_source_cam_route, record_sink);
+
+	if (route->record_queue == NULL || !u_sink_debug_is_active(&route->ws->record_cam_sinks[route->cam_id])) {
+		return;
+	}
+
+	// Queue a copy, a deep queue of camera frames would drain the pool.
+	struct xrt_frame *copy = NULL;
+	u_frame_clone(xf, &copy);
+	xrt_sink_push_frame(route->record_queue, copy);
+	xrt_frame_reference(&copy, NULL);
+}
+
+static void
+route_record_out(struct xrt_frame_sink *sink, struct xrt_frame *xf)
+{
+	struct wmr_source_cam_route *route = container_of(sink, struct wmr_source_cam_route, record_out);
+	u_sink_debug_push_frame(&route->ws->record_cam_sinks[route->cam_id], xf);
+}
+
+static void
+route_cam_to_ui(struct xrt_frame_sink *sink, struct xrt_frame *xf)
+{
+	struct wmr_source_cam_route *route = container_of(sink, struct wmr_source_cam_route, ui_sink);
+	u_sink_debug_push_frame(&route->ws->ui_cam_sinks[route->cam_id], xf);
+}
+
 static void
 receive_imu_sample(struct xrt_imu_sink *sink, struct xrt_imu_sample *s)
 {
@@ -121,10 +197,10 @@ receive_imu_sample(struct xrt_imu_sink *sink, struct xrt_imu_sample *s)
 
 	// Convert hardware timestamp into monotonic clock. Update offset estimate hw2mono.
 	// Note this is only done with IMU samples as they have the smallest USB transmission time.
-	const float IMU_FREQ = 250.f; //!< @todo use 1000 if "average_imus" is false
 	timepoint_ns now_hw = s->timestamp_ns;
 	timepoint_ns now_mono = (timepoint_ns)os_monotonic_get_ns();
-	timepoint_ns ts = m_clock_offset_a2b(IMU_FREQ, now_hw, now_mono, &ws->hw2mono);
+	timepoint_ns ts = m_clock_sync_update(&ws->clock, now_hw, now_mono);
+	ws->hw2mono = ts - now_hw;
 
 	/*
 	 * Check if the timepoint does time travel, we get one or two
@@ -276,6 +352,7 @@ wmr_source_node_destroy(struct xrt_frame_node *node)
 	WMR_DEBUG(ws, "Destroying WMR source");
 	for (int i = 0; i < ws->config.tcam_count; i++) {
 		u_sink_debug_destroy(&ws->ui_cam_sinks[i]);
+		u_sink_debug_destroy(&ws->record_cam_sinks[i]);
 	}
 	m_ff_vec3_f32_free(&ws->gyro_ff);
 	m_ff_vec3_f32_free(&ws->accel_ff);
@@ -320,6 +397,50 @@ wmr_source_create(struct xrt_frame_context *xfctx, struct xrt_prober_device *dev
 	for (int i = 0; i < WMR_MAX_CAMERAS; i++) {
 		ws->cam_sinks[i].push_frame = receive_cam[i];
 	}
+
+	for (int i = 0; i < cfg.tcam_count; i++) {
+		struct wmr_source_cam_route *route = &ws->cam_routes[i];
+		route->ws = ws;
+		route->cam_id = i;
+		route->slam_sink.push_frame = route_cam_to_slam;
+		route->record_sink.push_frame = route_cam_to_record;
+		route->record_out.push_frame = route_record_out;
+		route->ui_sink.push_frame = route_cam_to_ui;
+
+		struct u_sink_queue_params record_params = {
+		    .max_size = WMR_RECORD_QUEUE_SIZE,
+		    .drop_oldest = false,
+		    .stats = &route->record_stats,
+		};
+		if (!u_sink_queue_create_with_params(xfctx, &record_params, &route->record_out, &route->record_queue)) {
+			WMR_WARN(ws, "Unable to setup the recording queue for cam%d", i);
+			route->record_queue = NULL;
+		}
+
+		struct u_sink_fanout_consumer consumers[3] = {
+		    {.sink = &route->slam_sink, .name = "SLAM", .priority = 100, .policy = U_SINK_FANOUT_SYNC},
+		    {
+		        .sink = &route->record_sink,
+		        .name = "Recording copy",
+		        .priority = 0,
+		        .policy = U_SINK_FANOUT_SYNC,
+		    },
+		    {
+		        .sink = &route->ui_sink,
+		        .name = "Debug UI",
+		        .priority = 0,
+		        .policy = U_SINK_FANOUT_DROP_OLDEST,
+		        .max_queue = WMR_UI_QUEUE_SIZE,
+		    },
+		};
+
+		char name[] = "WMR source cam NNNNNNNNNNN routing";
+		(void)snprintf(name, sizeof(name), "WMR source cam%d routing", i);
+		if (!u_sink_fanout_create(xfctx, name, consumers, ARRAY_SIZE(consumers), &route->entry)) {
+			WMR_WARN(ws, "Unable to setup the camera routing, using the SLAM sink directly");
+			route->entry = &route->slam_sink;
+		}
+	}
 	ws->imu_sink.push_imu = receive_imu_sample;
 
 	ws->in_sinks.cam_count = cfg.tcam_count;
@@ -328,6 +449,8 @@ wmr_source_create(struct xrt_frame_context *xfctx, struct xrt_prober_device *dev
 	}
 	ws->in_sinks.imu = &ws->imu_sink;
 
+	m_clock_sync_init(&ws->clock, 0);
+
 	struct wmr_camera_open_config options = {
 	    .dev_holo = dev_holo,
 	    .tcam_confs = cfg.tcams,
@@ -343,6 +466,7 @@ wmr_source_create(struct xrt_frame_context *xfctx, struct xrt_prober_device *dev
 	// Setup UI
 	for (int i = 0; i < cfg.tcam_count; i++) {
 		u_sink_debug_init(&ws->ui_cam_sinks[i]);
+		u_sink_debug_init(&ws->record_cam_sinks[i]);
 	}
 	m_ff_vec3_f32_alloc(&ws->gyro_ff, 1000);
 	m_ff_vec3_f32_alloc(&ws->accel_ff, 1000);
@@ -354,6 +478,11 @@ wmr_source_create(struct xrt_frame_context *xfctx, struct xrt_prober_device *dev
 		char label[] = "Camera NNNNNNNNNNN";
 		(void)snprintf(label, sizeof(label), "Camera %d", i);
 		u_var_add_sink_debug(ws, &ws->ui_cam_sinks[i], label);
+
+		char record_label[] = "Camera NNNNNNNNNNN recording";
+		(void)snprintf(record_label, sizeof(record_label), "Camera %d recording", i);
+		u_var_add_sink_debug(ws, &ws->record_cam_sinks[i], record_label);
+		u_var_add_ro_u64(ws, &ws->cam_routes[i].record_stats.dropped, "Recording frames dropped");
 	}
 
 	// Setup node
@@ -16,6 +16,7 @@
 #include "math/m_api.h"
 #include "math/m_imu_3dof.h"
 
+#include "util/u_debug.h"
 #include "util/u_device.h"
 #include "util/u_distortion_mesh.h"
 #include "util/u_trace_marker.h"
@@ -34,6 +35,8 @@
 #define XREAL_AIR_DEBUG(hmd, ...) U_LOG_XDEV_IFL_D(&hmd->base, hmd->log_level, __VA_ARGS__)
 #define XREAL_AIR_ERROR(hmd, ...) U_LOG_XDEV_IFL_E(&hmd->base, hmd->log_level, __VA_ARGS__)
 
+DEBUG_GET_ONCE_OPTION(xreal_air_predict_model, "XREAL_AIR_PREDICT_MODEL", NULL)
+
 #define SENSOR_BUFFER_SIZE 64
 #define CONTROL_BUFFER_SIZE 64
 
@@ -1129,6 +1132,9 @@ xreal_air_hmd_create_device(struct os_hid_device *sensor_device,
 	m_imu_3dof_init(&hmd->fusion, M_IMU_3DOF_USE_GRAVITY_DUR_20MS);
 	m_relation_history_create(&hmd->relation_hist);
 
+	m_relation_history_set_predict_model_from_string(hmd->relation_hist,
+	                                                 debug_get_option_xreal_air_predict_model());
+
 	hmd->static_id = 0;
 	hmd->display_on = false;
 	hmd->imu_stream_state = 0;
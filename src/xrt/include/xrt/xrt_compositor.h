@@ -207,6 +207,24 @@ struct xrt_sub_image
 	struct xrt_normalized_rect norm_rect;
 };
 
+/*!
+ * Describes how a multi-resolution (lens matched) projection view is packed
+ * into its sub image: the @p center region of the view is stored at full
+ * resolution and the periphery on each side is scaled down by
+ * @p periphery_scale along that axis.
+ *
+ * A zeroed struct means the view is stored at uniform resolution.
+ *
+ * @see u_multires
+ */
+struct xrt_multires_layout
+{
+	//! Full resolution region in normalized view coordinates, x right and y down.
+	struct xrt_normalized_rect center;
+	//! Scale of the periphery along x and y, in the range (0, 1].
+	struct xrt_vec2 periphery_scale;
+};
+
 /*!
  * All of the pure data values associated with a single view in a projection
  * layer.
@@ -220,6 +238,9 @@ struct xrt_layer_projection_view_data
 
 	struct xrt_fov fov;
 	struct xrt_pose pose;
+
+	//! How the view is packed into @p sub, zeroed for uniform resolution.
+	struct xrt_multires_layout multires;
 };
 
 /*!
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "xrt/xrt_defines.h"
+#include "xrt/xrt_handles.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -33,6 +34,31 @@ struct xrt_frame
 	size_t size;
 	uint8_t *data;
 
+	/*!
+	 * Optional native buffer that backs @ref data, set by producers that
+	 * can share their memory without a copy, like the V4L2 driver when
+	 * exporting DMABUFs. Lets consumers import the frame into Vulkan or
+	 * send it over IPC instead of copying the pixels.
+	 *
+	 * The handle is owned by the producer and only valid for the lifetime
+	 * of the frame, consumers must duplicate it before handing it to
+	 * anything that takes ownership (like a Vulkan import).
+	 */
+	struct
+	{
+		//! Is @p handle valid, frames without a native buffer leave this false.
+		bool valid;
+
+		//! The native handle, a DMABUF file descriptor on Linux.
+		xrt_graphics_buffer_handle_t handle;
+
+		//! Offset in bytes from the start of the buffer to @ref data.
+		size_t offset;
+
+		//! Total size in bytes of the buffer.
+		size_t size;
+	} native;
+
 	enum xrt_format format;
 	enum xrt_stereo_format stereo_format;
 
@@ -63,4 +63,5 @@ typedef __eglMustCastToProperFunctionPointerType (*PFNEGLGETPROCADDRESSPROC)(con
 
 #include "openxr/XR_MNDX_hydra.h"
 #include "openxr/XR_MNDX_system_buttons.h"
+#include "openxr/XR_MNDX_multires_projection.h"
 #include "openxr/XR_MNDX_ball_on_a_stick_controller.h"
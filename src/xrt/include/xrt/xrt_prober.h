@@ -122,6 +122,40 @@ typedef void (*xrt_prober_list_video_func_t)(struct xrt_prober *xp,
                                              const char *serial,
                                              void *ptr);
 
+/*!
+ * What happened to a device, see @ref xrt_prober_hotplug_func_t.
+ *
+ * @ingroup xrt_iface
+ */
+enum xrt_prober_hotplug_event
+{
+	XRT_PROBER_HOTPLUG_ADDED,
+	XRT_PROBER_HOTPLUG_REMOVED,
+};
+
+/*!
+ * Called when a device shows up or goes away after the initial probe.
+ *
+ * Called from the prober's hotplug thread without the device list locked, it
+ * may lock the list and open interfaces of @p xpdev, but must not probe or
+ * remove listeners. An added @p xpdev stays at the same address while other
+ * devices come and go, until it is removed or the prober probes again, which
+ * waits for listeners to return. For removed devices @p xpdev is only valid
+ * during the call. Added USB devices get their libusb device looked up, so
+ * they can be opened like probed ones.
+ *
+ * @param xp    Prober
+ * @param event Whether @p xpdev was added or removed.
+ * @param xpdev The device.
+ * @param ptr   Your opaque userdata pointer as provided to
+ *              @ref xrt_prober_add_hotplug_listener
+ * @ingroup xrt_iface
+ */
+typedef void (*xrt_prober_hotplug_func_t)(struct xrt_prober *xp,
+                                          enum xrt_prober_hotplug_event event,
+                                          struct xrt_prober_device *xpdev,
+                                          void *ptr);
+
 /*!
  * The main prober that probes and manages found but not opened HMD devices
  * that are connected to the system.
@@ -151,7 +185,8 @@ struct xrt_prober
 
 	/*!
 	 * Locks the prober list of probed devices and returns it.
-	 * While locked, calling @ref xrt_prober::probe is forbidden. Not thread safe.
+	 * While locked, calling @ref xrt_prober::probe is forbidden. The list may
+	 * be locked by several threads at once, builders are estimated in parallel.
 	 *
 	 * See @ref xrt_prober::probe for more detailed expected usage.
 	 *
@@ -162,8 +197,9 @@ struct xrt_prober
 	                          size_t *out_device_count);
 
 	/*!
-	 * Unlocks the list, allowing for @ref xrt_prober::probe to be called.
-	 * Takes a pointer to the list pointer and clears it. Not thread safe.
+	 * Unlocks the list, allowing for @ref xrt_prober::probe to be called
+	 * once every lock has been released. Takes a pointer to the list pointer
+	 * and clears it.
 	 * See @ref xrt_prober::probe for more detailed expected usage.
 	 *
 	 * @see xrt_prober::probe, xrt_prober::lock_list
@@ -308,6 +344,30 @@ struct xrt_prober
 	 */
 	bool (*can_open)(struct xrt_prober *xp, struct xrt_prober_device *xpdev);
 
+	/*!
+	 * Start getting told about devices being plugged in and out, the device
+	 * list is kept up to date incrementally instead of needing a new
+	 * @ref xrt_prober::probe. Changes are only applied while the list is not
+	 * locked. No builder subscribes yet, attaching single devices to a running
+	 * system needs support in @ref xrt_system_devices first.
+	 *
+	 * @param xp   Pointer to self
+	 * @param func Called for every added or removed device.
+	 * @param ptr  Passed to @p func.
+	 */
+	xrt_result_t (*add_hotplug_listener)(struct xrt_prober *xp, xrt_prober_hotplug_func_t func, void *ptr);
+
+	/*!
+	 * Stop calling a listener added with @ref xrt_prober::add_hotplug_listener,
+	 * once this returns @p func is not running and will not be called again.
+	 * Must not be called from a listener.
+	 *
+	 * @param xp   Pointer to self
+	 * @param func Function given when adding.
+	 * @param ptr  Pointer given when adding.
+	 */
+	xrt_result_t (*remove_hotplug_listener)(struct xrt_prober *xp, xrt_prober_hotplug_func_t func, void *ptr);
+
 	/*!
 	 * Destroy the prober and set the pointer to null.
 	 *
@@ -445,6 +505,32 @@ xrt_prober_can_open(struct xrt_prober *xp, struct xrt_prober_device *xpdev)
 	return xp->can_open(xp, xpdev);
 }
 
+/*!
+ * @copydoc xrt_prober::add_hotplug_listener
+ *
+ * Helper function for @ref xrt_prober::add_hotplug_listener.
+ *
+ * @public @memberof xrt_prober
+ */
+static inline xrt_result_t
+xrt_prober_add_hotplug_listener(struct xrt_prober *xp, xrt_prober_hotplug_func_t func, void *ptr)
+{
+	return xp->add_hotplug_listener(xp, func, ptr);
+}
+
+/*!
+ * @copydoc xrt_prober::remove_hotplug_listener
+ *
+ * Helper function for @ref xrt_prober::remove_hotplug_listener.
+ *
+ * @public @memberof xrt_prober
+ */
+static inline xrt_result_t
+xrt_prober_remove_hotplug_listener(struct xrt_prober *xp, xrt_prober_hotplug_func_t func, void *ptr)
+{
+	return xp->remove_hotplug_listener(xp, func, ptr);
+}
+
 
 /*!
  * @copydoc xrt_prober::open_video_device
@@ -187,6 +187,12 @@ render_progress(struct calibration_scene *cs)
 	igText("Overall progress: %i of %i frames captured", cs->status.num_collected, cs->params.num_collect_total);
 	igProgressBar(capture_completion, progress_dims, NULL);
 
+	if (cs->params.incremental.enabled && cs->status.num_collected >= cs->params.incremental.min_samples) {
+		igText("Coverage %.0f%%, reprojection error %.3f px", cs->status.coverage * 100.0f,
+		       cs->status.rp_error);
+		igProgressBar(cs->status.coverage, progress_dims, cs->status.converged ? "Converged" : "Refining");
+	}
+
 #else
 	// Unused
 	(void)cs;
@@ -272,6 +278,11 @@ scene_render_select(struct gui_scene *scene, struct gui_program *p)
 	igInputInt("Wait for # frames (steady)", &cs->params.num_wait_for, 1, 5, 0);
 	igInputInt("Collect # measurements", &cs->params.num_collect_total, 1, 5, 0);
 	igInputInt("Collect in groups of #", &cs->params.num_collect_restart, 1, 5, 0);
+	igCheckbox("Refine while collecting", &cs->params.incremental.enabled);
+	if (cs->params.incremental.enabled) {
+		igInputInt("Refine after # measurements", &cs->params.incremental.min_samples, 1, 5, 0);
+		igInputFloat("Coverage needed", &cs->params.incremental.min_coverage, 0.05f, 0.1f, NULL, 0);
+	}
 
 	igSeparator();
 	igComboStr("Board type", (int *)&cs->params.pattern, "Checkers\0Corners SB\0Circles\0Asymmetric Circles\0\0",
@@ -586,6 +586,17 @@
 #endif
 
 
+/*
+ * XR_MNDX_multires_projection
+ */
+#if defined(XR_MNDX_multires_projection) && defined(XRT_FEATURE_OPENXR_LAYER_MULTIRES)
+#define OXR_HAVE_MNDX_multires_projection
+#define OXR_EXTENSION_SUPPORT_MNDX_multires_projection(_) _(MNDX_multires_projection, MNDX_MULTIRES_PROJECTION)
+#else
+#define OXR_EXTENSION_SUPPORT_MNDX_multires_projection(_)
+#endif
+
+
 /*
  * XR_MNDX_system_buttons
  */
@@ -681,6 +692,7 @@
     OXR_EXTENSION_SUPPORT_MNDX_egl_enable(_) \
     OXR_EXTENSION_SUPPORT_MNDX_force_feedback_curl(_) \
     OXR_EXTENSION_SUPPORT_MNDX_hydra(_) \
+    OXR_EXTENSION_SUPPORT_MNDX_multires_projection(_) \
     OXR_EXTENSION_SUPPORT_MNDX_system_buttons(_) \
     OXR_EXTENSION_SUPPORT_HTC_facial_tracking(_)
 // clang-format on
@@ -27,6 +27,7 @@
 #include "os/os_time.h"
 
 #include "util/u_debug.h"
+#include "util/u_hand_tracking.h"
 #include "util/u_misc.h"
 #include "util/u_time.h"
 #include "util/u_verify.h"
@@ -1227,18 +1228,18 @@ oxr_session_hand_joints(struct oxr_logger *log,
 	// We know we are active.
 	locations->isActive = true;
 
+	// Get all of the joints in the base space at once.
+	struct xrt_hand_joint_set joints_in_base = value;
+	struct xrt_relation_chain chain = {0};
+	m_relation_chain_push_relation(&chain, &T_base_hand);
+	u_hand_joints_resolve_chain(&joints_in_base, &chain);
+
 	for (uint32_t i = 0; i < locations->jointCount; i++) {
 		locations->jointLocations[i].locationFlags =
 		    xrt_to_xr_space_location_flags(value.values.hand_joint_set_default[i].relation.relation_flags);
 		locations->jointLocations[i].radius = value.values.hand_joint_set_default[i].radius;
 
-		struct xrt_space_relation r = value.values.hand_joint_set_default[i].relation;
-
-		struct xrt_space_relation result;
-		struct xrt_relation_chain chain = {0};
-		m_relation_chain_push_relation(&chain, &r);
-		m_relation_chain_push_relation(&chain, &T_base_hand);
-		m_relation_chain_resolve(&chain, &result);
+		struct xrt_space_relation result = joints_in_base.values.hand_joint_set_default[i].relation;
 
 		xrt_to_xr_pose(&result.pose, &locations->jointLocations[i].pose);
 
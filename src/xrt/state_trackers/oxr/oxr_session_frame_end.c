@@ -16,6 +16,7 @@
 
 #include "util/u_debug.h"
 #include "util/u_misc.h"
+#include "util/u_multires.h"
 #include "util/u_time.h"
 #include "util/u_verify.h"
 
@@ -313,6 +314,30 @@ fill_in_depth_test(struct oxr_session *sess, const XrCompositionLayerBaseHeader
 #endif // OXR_HAVE_FB_composition_layer_depth_test
 }
 
+static void
+fill_in_multires(struct oxr_session *sess,
+                 const XrCompositionLayerProjectionView *view,
+                 struct xrt_layer_projection_view_data *xvd)
+{
+#ifdef OXR_HAVE_MNDX_multires_projection
+	// Is the extension enabled?
+	if (!sess->sys->inst->extensions.MNDX_multires_projection) {
+		return;
+	}
+	const XrCompositionLayerProjectionViewMultiresMNDX *multires =
+	    OXR_GET_INPUT_FROM_CHAIN(view, XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW_MULTIRES_MNDX,
+	                             XrCompositionLayerProjectionViewMultiresMNDX);
+	if (multires != NULL) {
+		xvd->multires.center.x = multires->fullResolutionRect.offset.x;
+		xvd->multires.center.y = multires->fullResolutionRect.offset.y;
+		xvd->multires.center.w = multires->fullResolutionRect.extent.width;
+		xvd->multires.center.h = multires->fullResolutionRect.extent.height;
+		xvd->multires.periphery_scale.x = multires->peripheryScale.x;
+		xvd->multires.periphery_scale.y = multires->peripheryScale.y;
+	}
+#endif // OXR_HAVE_MNDX_multires_projection
+}
+
 static void
 fill_in_passthrough(struct oxr_session *sess, const XrCompositionLayerBaseHeader *layer, struct xrt_layer_data *data)
 {
@@ -724,6 +749,31 @@ verify_projection_layer(struct oxr_session *sess,
 			depth_layer_count++;
 		}
 #endif // OXR_HAVE_KHR_composition_layer_depth
+
+#ifdef OXR_HAVE_MNDX_multires_projection
+		const XrCompositionLayerProjectionViewMultiresMNDX *multires = OXR_GET_INPUT_FROM_CHAIN(
+		    view, XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW_MULTIRES_MNDX,
+		    XrCompositionLayerProjectionViewMultiresMNDX);
+
+		if (multires != NULL && sess->sys->inst->extensions.MNDX_multires_projection) {
+			struct xrt_multires_layout layout = {
+			    .center = {multires->fullResolutionRect.offset.x, multires->fullResolutionRect.offset.y,
+			               multires->fullResolutionRect.extent.width,
+			               multires->fullResolutionRect.extent.height},
+			    .periphery_scale = {multires->peripheryScale.x, multires->peripheryScale.y},
+			};
+
+			if (!u_multires_validate(&layout)) {
+				return oxr_error(log, XR_ERROR_VALIDATION_FAILURE,
+				                 "(frameEndInfo->layers[%u]->views[%i]->next<"
+				                 "XrCompositionLayerProjectionViewMultiresMNDX>) fullResolutionRect "
+				                 "{{%f, %f}, {%f, %f}} must be a non-empty rect inside of [0, 1] and "
+				                 "peripheryScale {%f, %f} in the range (0, 1]",
+				                 layer_index, i, layout.center.x, layout.center.y, layout.center.w,
+				                 layout.center.h, layout.periphery_scale.x, layout.periphery_scale.y);
+			}
+		}
+#endif // OXR_HAVE_MNDX_multires_projection
 	}
 
 #ifdef OXR_HAVE_KHR_composition_layer_depth
@@ -1326,6 +1376,7 @@ submit_projection_layer(struct oxr_session *sess,
 		data.proj.v[i].fov = *fov;
 		data.proj.v[i].pose = pose[i];
 		fill_in_sub_image(scs[i], &proj->views[i].subImage, &data.proj.v[i].sub);
+		fill_in_multires(sess, &proj->views[i], &data.proj.v[i]);
 		swapchains[i] = scs[i]->swapchain;
 	}
 	fill_in_color_scale_bias(sess, (XrCompositionLayerBaseHeader *)proj, &data);
@@ -0,0 +1,415 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Keeps the prober device list up to date from hotplug events.
+ * @ingroup st_prober
+ */
+
+#include "os/os_time.h"
+#include "os/os_threading.h"
+#include "util/u_misc.h"
+#include "util/u_time.h"
+#include "util/u_trace_marker.h"
+#include "p_prober.h"
+
+#include <poll.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*!
+ * Wait this long after the last event before applying them, a device shows up
+ * as a burst of events for the usb device and each of its interfaces.
+ */
+#define P_HOTPLUG_SETTLE_NS (100 * U_TIME_1MS_IN_NS)
+
+//! How often to retry applying events while the list is locked.
+#define P_HOTPLUG_RETRY_MS (100)
+
+
+/*
+ *
+ * Structs.
+ *
+ */
+
+/*!
+ * Thread that reads events from a @ref p_hotplug_source and applies them to
+ * the device list of the prober.
+ */
+struct p_hotplug
+{
+	struct prober *p;
+
+	struct p_hotplug_source *source;
+
+	struct os_thread_helper oth;
+
+	//! Events read but not yet applied, only touched by the thread.
+	struct p_hotplug_event *pending;
+	size_t pending_count;
+
+	//! When the last event was read.
+	uint64_t last_event_ns;
+
+	//! Devices to tell the listeners about once the list is unlocked.
+	struct prober_device **added;
+	size_t added_count;
+	struct prober_device **removed;
+	size_t removed_count;
+};
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static bool
+path_equal(const char *a, const char *b)
+{
+	return a != NULL && b != NULL && strcmp(a, b) == 0;
+}
+
+static bool
+remove_interface(struct prober_device *pdev, const struct p_udev_record *r)
+{
+	bool removed = false;
+
+#ifdef XRT_HAVE_V4L2
+	for (size_t i = 0; r->type == P_UDEV_RECORD_V4L && i < pdev->num_v4ls; i++) {
+		if (!path_equal(pdev->v4ls[i].path, r->dev_path)) {
+			continue;
+		}
+
+		free((char *)pdev->v4ls[i].path);
+		pdev->v4ls[i] = pdev->v4ls[--pdev->num_v4ls];
+		removed = true;
+		break;
+	}
+#endif
+
+	for (size_t i = 0; r->type == P_UDEV_RECORD_HIDRAW && i < pdev->num_hidraws; i++) {
+		if (!path_equal(pdev->hidraws[i].path, r->dev_path)) {
+			continue;
+		}
+
+		free((char *)pdev->hidraws[i].path);
+		memmove(&pdev->hidraws[i], &pdev->hidraws[i + 1],
+		        (pdev->num_hidraws - i - 1) * sizeof(struct prober_hidraw));
+		pdev->num_hidraws--;
+		removed = true;
+		break;
+	}
+
+	return removed;
+}
+
+static bool
+has_any_node(struct prober_device *pdev)
+{
+#ifdef XRT_HAVE_V4L2
+	if (pdev->num_v4ls > 0) {
+		return true;
+	}
+#endif
+
+	return pdev->usb.path != NULL || pdev->num_hidraws > 0;
+}
+
+static void
+remove_device(struct p_hotplug *hp, size_t index)
+{
+	struct prober *p = hp->p;
+	struct prober_device *pdev = p->devices[index];
+
+	P_DEBUG(p, "Removed %04x:%04x", pdev->base.vendor_id, pdev->base.product_id);
+
+	// Listeners were never told about it, so no need to tell them it's gone.
+	if (pdev->hotplug_added) {
+		p_dev_remove(p, index);
+		return;
+	}
+
+	// Freed once the listeners have been told.
+	U_ARRAY_REALLOC_OR_FREE(hp->removed, struct prober_device *, (hp->removed_count + 1));
+	hp->removed[hp->removed_count++] = p_dev_detach(p, index);
+}
+
+static void
+apply_add(struct prober *p, const struct p_udev_record *r)
+{
+	size_t old_count = p->device_count;
+
+	// Idempotent, events for nodes that were already probed change nothing.
+	p_udev_apply_record(p, r);
+
+	for (size_t i = old_count; i < p->device_count; i++) {
+		p->devices[i]->hotplug_added = true;
+	}
+}
+
+static void
+apply_remove(struct p_hotplug *hp, const struct p_udev_record *r)
+{
+	struct prober *p = hp->p;
+
+	// Backwards so removing doesn't skip the next device.
+	for (size_t i = p->device_count; i-- > 0;) {
+		struct prober_device *pdev = p->devices[i];
+
+		if (r->type == P_UDEV_RECORD_USB) {
+			if (path_equal(pdev->usb.path, r->dev_path)) {
+				remove_device(hp, i);
+			}
+			continue;
+		}
+
+		if (remove_interface(pdev, r) && !has_any_node(pdev)) {
+			remove_device(hp, i);
+		}
+	}
+}
+
+static void
+collect_added(struct p_hotplug *hp)
+{
+	struct prober *p = hp->p;
+
+	// Tell about new devices once all of their interfaces have been added.
+	for (size_t i = 0; i < p->device_count; i++) {
+		struct prober_device *pdev = p->devices[i];
+		if (!pdev->hotplug_added) {
+			continue;
+		}
+
+		pdev->hotplug_added = false;
+
+#ifdef XRT_HAVE_LIBUSB
+		// Probing fills this in from libusb, hotplug only sees the udev nodes.
+		if (pdev->base.bus == XRT_BUS_TYPE_USB && pdev->usb.dev == NULL && p_libusb_attach(p, pdev) != 0) {
+			P_WARN(p, "No libusb device for %04x:%04x", pdev->base.vendor_id, pdev->base.product_id);
+		}
+#endif
+
+		P_DEBUG(p, "Added %04x:%04x", pdev->base.vendor_id, pdev->base.product_id);
+
+		U_ARRAY_REALLOC_OR_FREE(hp->added, struct prober_device *, (hp->added_count + 1));
+		hp->added[hp->added_count++] = pdev;
+	}
+}
+
+static void
+notify_and_free(struct p_hotplug *hp)
+{
+	struct prober *p = hp->p;
+
+	for (size_t i = 0; i < hp->removed_count; i++) {
+		p_notify_hotplug(p, XRT_PROBER_HOTPLUG_REMOVED, hp->removed[i]);
+		p_dev_free(hp->removed[i]);
+	}
+
+	for (size_t i = 0; i < hp->added_count; i++) {
+		p_notify_hotplug(p, XRT_PROBER_HOTPLUG_ADDED, hp->added[i]);
+	}
+
+	free(hp->removed);
+	hp->removed = NULL;
+	hp->removed_count = 0;
+
+	free(hp->added);
+	hp->added = NULL;
+	hp->added_count = 0;
+}
+
+/*!
+ * Applies all pending events and tells the listeners about them, returns
+ * false if the list is locked and nothing was done.
+ */
+static bool
+apply_pending(struct p_hotplug *hp)
+{
+	struct prober *p = hp->p;
+
+	// Keeps probing from freeing the devices until the listeners are done.
+	os_mutex_lock(&p->hotplug_dispatch_mutex);
+	os_mutex_lock(&p->list_lock_mutex);
+
+	// Builders hold pointers into the device array while it's locked.
+	if (p->list_lock_count > 0) {
+		os_mutex_unlock(&p->list_lock_mutex);
+		os_mutex_unlock(&p->hotplug_dispatch_mutex);
+		return false;
+	}
+
+	for (size_t i = 0; i < hp->pending_count; i++) {
+		struct p_hotplug_event *e = &hp->pending[i];
+
+		switch (e->action) {
+		case P_HOTPLUG_ACTION_ADD: apply_add(p, &e->record); break;
+		case P_HOTPLUG_ACTION_REMOVE: apply_remove(hp, &e->record); break;
+		}
+	}
+
+	collect_added(hp);
+
+	os_mutex_unlock(&p->list_lock_mutex);
+
+	// Listeners may lock the list or open devices.
+	notify_and_free(hp);
+
+	os_mutex_unlock(&p->hotplug_dispatch_mutex);
+
+	return true;
+}
+
+static void
+clear_pending(struct p_hotplug *hp)
+{
+	for (size_t i = 0; i < hp->pending_count; i++) {
+		p_udev_record_clear(&hp->pending[i].record);
+	}
+
+	free(hp->pending);
+	hp->pending = NULL;
+	hp->pending_count = 0;
+}
+
+static int
+read_events(struct p_hotplug *hp)
+{
+	while (true) {
+		struct p_hotplug_event event;
+		int ret = hp->source->read_event(hp->source, &event);
+		if (ret <= 0) {
+			return ret;
+		}
+
+		U_ARRAY_REALLOC_OR_FREE(hp->pending, struct p_hotplug_event, (hp->pending_count + 1));
+		hp->pending[hp->pending_count++] = event;
+		hp->last_event_ns = os_monotonic_get_ns();
+	}
+}
+
+static void *
+run_hotplug(void *ptr)
+{
+	struct p_hotplug *hp = (struct p_hotplug *)ptr;
+	struct prober *p = hp->p;
+
+	U_TRACE_SET_THREAD_NAME("Prober: Hotplug");
+	os_thread_helper_name(&hp->oth, "Prober: Hotplug");
+
+	struct pollfd pfd = {
+	    .fd = hp->source->get_fd(hp->source),
+	    .events = POLLIN,
+	};
+
+	os_thread_helper_lock(&hp->oth);
+	while (os_thread_helper_is_running_locked(&hp->oth)) {
+		os_thread_helper_unlock(&hp->oth);
+
+		int timeout_ms = P_HOTPLUG_RETRY_MS;
+		if (hp->pending_count > 0) {
+			uint64_t since_ns = os_monotonic_get_ns() - hp->last_event_ns;
+			if (since_ns < P_HOTPLUG_SETTLE_NS) {
+				timeout_ms = (int)((P_HOTPLUG_SETTLE_NS - since_ns) / U_TIME_1MS_IN_NS) + 1;
+			} else if (apply_pending(hp)) {
+				clear_pending(hp);
+			}
+		}
+
+		int ret = poll(&pfd, 1, timeout_ms);
+		if (ret < 0 && errno != EINTR) {
+			P_ERROR(p, "poll failed: %i", errno);
+			os_thread_helper_lock(&hp->oth);
+			break;
+		}
+
+		if (ret > 0 && read_events(hp) < 0) {
+			P_ERROR(p, "Failed to read hotplug event");
+			os_thread_helper_lock(&hp->oth);
+			break;
+		}
+
+		os_thread_helper_lock(&hp->oth);
+	}
+	os_thread_helper_unlock(&hp->oth);
+
+	return NULL;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+int
+p_hotplug_start(struct prober *p, struct p_hotplug_source *source)
+{
+	if (source == NULL) {
+		return -1;
+	}
+
+	struct p_hotplug *hp = U_TYPED_CALLOC(struct p_hotplug);
+	hp->p = p;
+	hp->source = source;
+
+	int ret = os_thread_helper_init(&hp->oth);
+	if (ret != 0) {
+		source->destroy(source);
+		free(hp);
+		return ret;
+	}
+
+	os_mutex_lock(&p->list_lock_mutex);
+	bool already = p->hotplug != NULL;
+	if (!already) {
+		p->hotplug = hp;
+	}
+	os_mutex_unlock(&p->list_lock_mutex);
+
+	// Somebody else got there first.
+	if (already) {
+		os_thread_helper_destroy(&hp->oth);
+		source->destroy(source);
+		free(hp);
+		return 0;
+	}
+
+	ret = os_thread_helper_start(&hp->oth, run_hotplug, hp);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to start hotplug thread!");
+		p_hotplug_stop(p);
+		return ret;
+	}
+
+	P_DEBUG(p, "Started hotplug monitoring");
+
+	return 0;
+}
+
+void
+p_hotplug_stop(struct prober *p)
+{
+	os_mutex_lock(&p->list_lock_mutex);
+	struct p_hotplug *hp = p->hotplug;
+	p->hotplug = NULL;
+	os_mutex_unlock(&p->list_lock_mutex);
+
+	if (hp == NULL) {
+		return;
+	}
+
+	// Stops and joins the thread.
+	os_thread_helper_destroy(&hp->oth);
+
+	hp->source->destroy(hp->source);
+	clear_pending(hp);
+	free(hp);
+}
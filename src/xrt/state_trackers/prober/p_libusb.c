@@ -94,6 +94,40 @@ p_libusb_probe(struct prober *p)
 	return 0;
 }
 
+int
+p_libusb_attach(struct prober *p, struct prober_device *pdev)
+{
+	libusb_device **list = NULL;
+	ssize_t count = libusb_get_device_list(p->usb.ctx, &list);
+	if (count < 0) {
+		P_ERROR(p, "Failed to enumerate usb devices");
+		return -1;
+	}
+
+	int ret = -1;
+	for (ssize_t i = 0; i < count; i++) {
+		libusb_device *device = list[i];
+
+		if (libusb_get_bus_number(device) != pdev->usb.bus ||
+		    libusb_get_device_address(device) != pdev->usb.addr) {
+			continue;
+		}
+
+		int num = libusb_get_port_numbers(device, pdev->usb.ports, ARRAY_SIZE(pdev->usb.ports));
+		pdev->usb.num_ports = num > 0 ? num : 0;
+
+		// The list is freed below, so hold a reference of our own.
+		pdev->usb.dev = libusb_ref_device(device);
+		pdev->usb.dev_owned = true;
+		ret = 0;
+		break;
+	}
+
+	libusb_free_device_list(list, 1);
+
+	return ret;
+}
+
 #define ENUM_TO_STR(r)                                                                                                 \
 	case r: return #r
 
@@ -16,10 +16,12 @@
 #include "util/u_misc.h"
 #include "util/u_config_json.h"
 #include "util/u_debug.h"
+#include "util/u_time.h"
 #include "util/u_pretty_print.h"
 #include "util/u_trace_marker.h"
 
 #include "os/os_hid.h"
+#include "os/os_time.h"
 #include "p_prober.h"
 
 #ifdef XRT_HAVE_V4L2
@@ -57,6 +59,8 @@ DEBUG_GET_ONCE_BOOL_OPTION(qwerty_combine, "QWERTY_COMBINE", false)
 DEBUG_GET_ONCE_OPTION(vf_path, "VF_PATH", NULL)
 DEBUG_GET_ONCE_OPTION(euroc_path, "EUROC_PATH", NULL)
 DEBUG_GET_ONCE_NUM_OPTION(rs_source_index, "RS_SOURCE_INDEX", -1)
+DEBUG_GET_ONCE_BOOL_OPTION(prober_parallel, "PROBER_PARALLEL", true)
+DEBUG_GET_ONCE_BOOL_OPTION(prober_hotplug, "PROBER_HOTPLUG", true)
 
 
 /*
@@ -71,6 +75,9 @@ add_device(struct prober *p, struct prober_device **out_dev);
 static int
 initialize(struct prober *p, struct xrt_prober_entry_lists *lists);
 
+static void
+free_device(struct prober_device *pdev);
+
 static void
 teardown_devices(struct prober *p);
 
@@ -131,6 +138,12 @@ p_get_string_descriptor(struct xrt_prober *xp,
 static bool
 p_can_open(struct xrt_prober *xp, struct xrt_prober_device *xpdev);
 
+static xrt_result_t
+p_add_hotplug_listener(struct xrt_prober *xp, xrt_prober_hotplug_func_t func, void *ptr);
+
+static xrt_result_t
+p_remove_hotplug_listener(struct xrt_prober *xp, xrt_prober_hotplug_func_t func, void *ptr);
+
 static void
 p_destroy(struct xrt_prober **xp);
 
@@ -168,7 +181,7 @@ p_dev_get_usb_dev(struct prober *p,
 	struct prober_device *pdev;
 
 	for (size_t i = 0; i < p->device_count; i++) {
-		struct prober_device *pdev = &p->devices[i];
+		struct prober_device *pdev = p->devices[i];
 
 		if (pdev->base.bus != XRT_BUS_TYPE_USB || pdev->usb.bus != bus || pdev->usb.addr != addr) {
 			continue;
@@ -210,7 +223,7 @@ p_dev_get_bluetooth_dev(struct prober *p,
 	struct prober_device *pdev;
 
 	for (size_t i = 0; i < p->device_count; i++) {
-		struct prober_device *pdev = &p->devices[i];
+		struct prober_device *pdev = p->devices[i];
 
 		if (pdev->base.bus != XRT_BUS_TYPE_BLUETOOTH || pdev->bluetooth.id != id) {
 			continue;
@@ -243,6 +256,56 @@ p_dev_get_bluetooth_dev(struct prober *p,
 }
 
 
+struct prober_device *
+p_dev_detach(struct prober *p, size_t index)
+{
+	assert(index < p->device_count);
+
+	struct prober_device *pdev = p->devices[index];
+
+	size_t after = p->device_count - index - 1;
+	memmove(&p->devices[index], &p->devices[index + 1], after * sizeof(struct prober_device *));
+	p->device_count--;
+
+	return pdev;
+}
+
+void
+p_dev_free(struct prober_device *pdev)
+{
+	free_device(pdev);
+	free(pdev);
+}
+
+void
+p_dev_remove(struct prober *p, size_t index)
+{
+	p_dev_free(p_dev_detach(p, index));
+}
+
+void
+p_notify_hotplug(struct prober *p, enum xrt_prober_hotplug_event event, struct prober_device *pdev)
+{
+	// Copy so the listeners are called without the list lock held.
+	os_mutex_lock(&p->list_lock_mutex);
+	uint32_t count = p->hotplug_listener_count;
+	struct
+	{
+		xrt_prober_hotplug_func_t func;
+		void *ptr;
+	} listeners[P_PROBER_MAX_HOTPLUG_LISTENERS];
+	for (uint32_t i = 0; i < count; i++) {
+		listeners[i].func = p->hotplug_listeners[i].func;
+		listeners[i].ptr = p->hotplug_listeners[i].ptr;
+	}
+	os_mutex_unlock(&p->list_lock_mutex);
+
+	for (uint32_t i = 0; i < count; i++) {
+		listeners[i].func(&p->base, event, &pdev->base, listeners[i].ptr);
+	}
+}
+
+
 /*
  *
  * Internal functions.
@@ -275,10 +338,10 @@ fill_out_product(struct prober *p, struct prober_device *pdev)
 static void
 add_device(struct prober *p, struct prober_device **out_dev)
 {
-	U_ARRAY_REALLOC_OR_FREE(p->devices, struct prober_device, (p->device_count + 1));
+	U_ARRAY_REALLOC_OR_FREE(p->devices, struct prober_device *, (p->device_count + 1));
 
-	struct prober_device *dev = &p->devices[p->device_count++];
-	U_ZERO(dev);
+	struct prober_device *dev = U_TYPED_CALLOC(struct prober_device);
+	p->devices[p->device_count++] = dev;
 
 	*out_dev = dev;
 }
@@ -448,9 +511,17 @@ initialize(struct prober *p, struct xrt_prober_entry_lists *lists)
 	p->base.get_builders = p_get_builders;
 	p->base.get_string_descriptor = p_get_string_descriptor;
 	p->base.can_open = p_can_open;
+	p->base.add_hotplug_listener = p_add_hotplug_listener;
+	p->base.remove_hotplug_listener = p_remove_hotplug_listener;
 	p->base.destroy = p_destroy;
 	p->lists = lists;
 	p->log_level = debug_get_log_option_prober_log();
+	p->parallel = debug_get_bool_option_prober_parallel();
+	p->timing.start_ns = os_monotonic_get_ns();
+
+	// Teardown destroys them, so init before anything can fail.
+	os_mutex_init(&p->list_lock_mutex);
+	os_mutex_init(&p->hotplug_dispatch_mutex);
 
 	p->json.file_loaded = false;
 	p->json.root = NULL;
@@ -503,73 +574,81 @@ initialize(struct prober *p, struct xrt_prober_entry_lists *lists)
 }
 
 static void
-teardown_devices(struct prober *p)
+free_device(struct prober_device *pdev)
 {
-	XRT_TRACE_MARKER();
-
-	// Need to free all devices.
-	for (size_t i = 0; i < p->device_count; i++) {
-		struct prober_device *pdev = &p->devices[i];
-
-		if (pdev->usb.product != NULL) {
-			free((char *)pdev->usb.product);
-			pdev->usb.product = NULL;
-		}
+	if (pdev->usb.product != NULL) {
+		free((char *)pdev->usb.product);
+		pdev->usb.product = NULL;
+	}
 
-		if (pdev->usb.manufacturer != NULL) {
-			free((char *)pdev->usb.manufacturer);
-			pdev->usb.manufacturer = NULL;
-		}
+	if (pdev->usb.manufacturer != NULL) {
+		free((char *)pdev->usb.manufacturer);
+		pdev->usb.manufacturer = NULL;
+	}
 
-		if (pdev->usb.serial != NULL) {
-			free((char *)pdev->usb.serial);
-			pdev->usb.serial = NULL;
-		}
+	if (pdev->usb.serial != NULL) {
+		free((char *)pdev->usb.serial);
+		pdev->usb.serial = NULL;
+	}
 
-		if (pdev->usb.path != NULL) {
-			free((char *)pdev->usb.path);
-			pdev->usb.path = NULL;
-		}
+	if (pdev->usb.path != NULL) {
+		free((char *)pdev->usb.path);
+		pdev->usb.path = NULL;
+	}
 
 #ifdef XRT_HAVE_LIBUSB
-		if (pdev->usb.dev != NULL) {
-			//! @todo Free somewhere else
-		}
+	// Probed devices are owned by the libusb device list instead.
+	if (pdev->usb.dev != NULL && pdev->usb.dev_owned) {
+		libusb_unref_device(pdev->usb.dev);
+		pdev->usb.dev = NULL;
+		pdev->usb.dev_owned = false;
+	}
 #endif
 
 #ifdef XRT_HAVE_LIBUVC
-		if (pdev->uvc.dev != NULL) {
-			//! @todo Free somewhere else
-		}
+	if (pdev->uvc.dev != NULL) {
+		//! @todo Free somewhere else
+	}
 #endif
 
 #ifdef XRT_HAVE_V4L2
-		for (size_t j = 0; j < pdev->num_v4ls; j++) {
-			struct prober_v4l *v4l = &pdev->v4ls[j];
-			free((char *)v4l->path);
-			v4l->path = NULL;
-		}
+	for (size_t j = 0; j < pdev->num_v4ls; j++) {
+		struct prober_v4l *v4l = &pdev->v4ls[j];
+		free((char *)v4l->path);
+		v4l->path = NULL;
+	}
 
-		if (pdev->v4ls != NULL) {
-			free(pdev->v4ls);
-			pdev->v4ls = NULL;
-			pdev->num_v4ls = 0;
-		}
+	if (pdev->v4ls != NULL) {
+		free(pdev->v4ls);
+		pdev->v4ls = NULL;
+		pdev->num_v4ls = 0;
+	}
 #endif
 
 #ifdef XRT_OS_LINUX
-		for (size_t j = 0; j < pdev->num_hidraws; j++) {
-			struct prober_hidraw *hidraw = &pdev->hidraws[j];
-			free((char *)hidraw->path);
-			hidraw->path = NULL;
-		}
+	for (size_t j = 0; j < pdev->num_hidraws; j++) {
+		struct prober_hidraw *hidraw = &pdev->hidraws[j];
+		free((char *)hidraw->path);
+		hidraw->path = NULL;
+	}
 
-		if (pdev->hidraws != NULL) {
-			free(pdev->hidraws);
-			pdev->hidraws = NULL;
-			pdev->num_hidraws = 0;
-		}
+	if (pdev->hidraws != NULL) {
+		free(pdev->hidraws);
+		pdev->hidraws = NULL;
+		pdev->num_hidraws = 0;
+	}
 #endif
+}
+
+static void
+teardown_devices(struct prober *p)
+{
+	XRT_TRACE_MARKER();
+
+	// Need to free all devices.
+	for (size_t i = 0; i < p->device_count; i++) {
+		free_device(p->devices[i]);
+		free(p->devices[i]);
 	}
 
 	if (p->devices != NULL) {
@@ -587,6 +666,11 @@ teardown(struct prober *p)
 	// First remove the variable tracking.
 	u_var_remove_root((void *)p);
 
+	// Nothing may touch the device list after this.
+#ifdef XRT_HAVE_LIBUDEV
+	p_hotplug_stop(p);
+#endif
+
 	// Clean up all setter uppers.
 	for (size_t i = 0; i < p->builder_count; i++) {
 		xrt_builder_destroy(&p->builders[i]);
@@ -624,6 +708,9 @@ teardown(struct prober *p)
 	u_config_json_close(&p->json);
 
 	free(p->disabled_drivers);
+
+	os_mutex_destroy(&p->list_lock_mutex);
+	os_mutex_destroy(&p->hotplug_dispatch_mutex);
 }
 
 static void
@@ -672,7 +759,7 @@ add_from_devices(struct prober *p, struct xrt_device **xdevs, size_t xdev_count,
 
 	// Loop over all devices and entries that might match them.
 	for (size_t i = 0; i < p->device_count; i++) {
-		struct prober_device *pdev = &p->devices[i];
+		struct prober_device *pdev = p->devices[i];
 
 		for (size_t k = 0; k < p->num_entries; k++) {
 			struct xrt_prober_entry *entry = p->entries[k];
@@ -838,6 +925,90 @@ find_builder_by_identifier(struct prober *p, const char *ident)
 	return NULL;
 }
 
+/*!
+ * Record a startup phase that began at @p start_ns, returns the current time
+ * so phases can be chained.
+ */
+static uint64_t
+timing_add_phase(struct prober *p, const char *name, uint64_t start_ns)
+{
+	uint64_t now_ns = os_monotonic_get_ns();
+
+	if (p->timing.phase_count < ARRAY_SIZE(p->timing.phases)) {
+		struct prober_timing_phase *phase = &p->timing.phases[p->timing.phase_count++];
+		phase->name = name;
+		phase->duration_ns = now_ns - start_ns;
+	}
+
+	return now_ns;
+}
+
+static void
+print_timing(u_pp_delegate_t dg, struct prober *p)
+{
+	u_pp(dg, "\n\tStartup timing:");
+	for (uint32_t i = 0; i < p->timing.phase_count; i++) {
+		struct prober_timing_phase *phase = &p->timing.phases[i];
+		u_pp(dg, "\n\t\t%-24s %8.2fms", phase->name, (double)phase->duration_ns / (double)U_TIME_1MS_IN_NS);
+	}
+
+	uint64_t total_ns = os_monotonic_get_ns() - p->timing.start_ns;
+	u_pp(dg, "\n\t\t%-24s %8.2fms", "total since prober init", (double)total_ns / (double)U_TIME_1MS_IN_NS);
+}
+
+struct estimate_task
+{
+	struct prober *p;
+	struct xrt_builder *xb;
+
+	struct xrt_builder_estimate estimate;
+	uint64_t duration_ns;
+
+	struct os_thread thread;
+	bool started;
+};
+
+static void *
+run_estimate(void *ptr)
+{
+	struct estimate_task *task = (struct estimate_task *)ptr;
+	struct prober *p = task->p;
+
+	uint64_t start_ns = os_monotonic_get_ns();
+	xrt_builder_estimate_system(task->xb, p->json.root, &p->base, &task->estimate);
+	task->duration_ns = os_monotonic_get_ns() - start_ns;
+
+	return NULL;
+}
+
+/*!
+ * Estimate builders on their own threads when @ref prober::parallel is set.
+ * Most estimates only scan the device list and are cheap, this pays off when
+ * one of them is slow, startup then takes the slowest builder instead of the
+ * sum of all of them. Per builder times are logged at debug level.
+ */
+static void
+estimate_builders(struct prober *p, struct estimate_task *tasks, size_t task_count)
+{
+	for (size_t i = 0; i < task_count; i++) {
+		os_thread_init(&tasks[i].thread);
+		tasks[i].started = p->parallel && os_thread_start(&tasks[i].thread, run_estimate, &tasks[i]) == 0;
+		if (!tasks[i].started) {
+			run_estimate(&tasks[i]);
+		}
+	}
+
+	for (size_t i = 0; i < task_count; i++) {
+		if (tasks[i].started) {
+			os_thread_join(&tasks[i].thread);
+		}
+		os_thread_destroy(&tasks[i].thread);
+
+		P_DEBUG(p, "Estimated %s in %.2fms", tasks[i].xb->identifier,
+		        (double)tasks[i].duration_ns / (double)U_TIME_1MS_IN_NS);
+	}
+}
+
 static void
 print_system_devices(u_pp_delegate_t dg, struct xrt_system_devices *xsysd)
 {
@@ -880,14 +1051,19 @@ print_system_devices(u_pp_delegate_t dg, struct xrt_system_devices *xsysd)
  */
 
 static xrt_result_t
-p_probe(struct xrt_prober *xp)
+probe_devices(struct prober *p)
 {
-	XRT_TRACE_MARKER();
-
-	struct prober *p = (struct prober *)xp;
 	XRT_MAYBE_UNUSED int ret = 0;
+	XRT_MAYBE_UNUSED uint64_t start_ns = os_monotonic_get_ns();
+
+	// Only report the phases since the latest probe, the list would fill up.
+	p->timing.phase_count = 0;
+
+	// Held for the whole probe so hotplug events wait until it's done.
+	os_mutex_lock(&p->list_lock_mutex);
 
-	if (p->list_locked) {
+	if (p->list_lock_count > 0) {
+		os_mutex_unlock(&p->list_lock_mutex);
 		return XRT_ERROR_PROBER_LIST_LOCKED;
 	}
 
@@ -898,51 +1074,75 @@ p_probe(struct xrt_prober *xp)
 	ret = p_udev_probe(p);
 	if (ret != 0) {
 		P_ERROR(p, "Failed to enumerate udev devices\n");
+		os_mutex_unlock(&p->list_lock_mutex);
 		return XRT_ERROR_PROBING_FAILED;
 	}
+	start_ns = timing_add_phase(p, "probe udev", start_ns);
 #endif
 
 #ifdef XRT_HAVE_LIBUSB
 	ret = p_libusb_probe(p);
 	if (ret != 0) {
 		P_ERROR(p, "Failed to enumerate libusb devices\n");
+		os_mutex_unlock(&p->list_lock_mutex);
 		return XRT_ERROR_PROBING_FAILED;
 	}
+	start_ns = timing_add_phase(p, "probe libusb", start_ns);
 #endif
 
 #ifdef XRT_HAVE_LIBUVC
 	ret = p_libuvc_probe(p);
 	if (ret != 0) {
 		P_ERROR(p, "Failed to enumerate libuvc devices\n");
+		os_mutex_unlock(&p->list_lock_mutex);
 		return XRT_ERROR_PROBING_FAILED;
 	}
+	start_ns = timing_add_phase(p, "probe libuvc", start_ns);
 #endif
 
+	os_mutex_unlock(&p->list_lock_mutex);
+
 	return XRT_SUCCESS;
 }
 
 static xrt_result_t
-p_lock_list(struct xrt_prober *xp, struct xrt_prober_device ***out_devices, size_t *out_device_count)
+p_probe(struct xrt_prober *xp)
 {
+	XRT_TRACE_MARKER();
+
 	struct prober *p = (struct prober *)xp;
 
-	if (p->list_locked) {
-		return XRT_ERROR_PROBER_LIST_LOCKED;
-	}
+	// Hotplug listeners may be using devices of the old list.
+	os_mutex_lock(&p->hotplug_dispatch_mutex);
+	xrt_result_t xret = probe_devices(p);
+	os_mutex_unlock(&p->hotplug_dispatch_mutex);
+
+	return xret;
+}
+
+static xrt_result_t
+p_lock_list(struct xrt_prober *xp, struct xrt_prober_device ***out_devices, size_t *out_device_count)
+{
+	struct prober *p = (struct prober *)xp;
 
 	assert(out_devices != NULL);
 	assert(*out_devices == NULL);
 
+	// Several builders can hold the list at the same time while estimating.
+	os_mutex_lock(&p->list_lock_mutex);
+	p->list_lock_count++;
+
 	// Build a list of all current probed devices.
-	struct xrt_prober_device **dev_list = U_TYPED_ARRAY_CALLOC(struct xrt_prober_device *, p->device_count);
-	for (size_t i = 0; i < p->device_count; i++) {
-		dev_list[i] = &p->devices[i].base;
+	size_t device_count = p->device_count;
+	struct xrt_prober_device **dev_list = U_TYPED_ARRAY_CALLOC(struct xrt_prober_device *, device_count);
+	for (size_t i = 0; i < device_count; i++) {
+		dev_list[i] = &p->devices[i]->base;
 	}
 
-	p->list_locked = true;
+	os_mutex_unlock(&p->list_lock_mutex);
 
 	*out_devices = dev_list;
-	*out_device_count = p->device_count;
+	*out_device_count = device_count;
 
 	return XRT_SUCCESS;
 }
@@ -952,13 +1152,19 @@ p_unlock_list(struct xrt_prober *xp, struct xrt_prober_device ***devices)
 {
 	struct prober *p = (struct prober *)xp;
 
-	if (!p->list_locked) {
+	os_mutex_lock(&p->list_lock_mutex);
+	bool locked = p->list_lock_count > 0;
+	if (locked) {
+		p->list_lock_count--;
+	}
+	os_mutex_unlock(&p->list_lock_mutex);
+
+	if (!locked) {
 		return XRT_ERROR_PROBER_LIST_NOT_LOCKED;
 	}
 
 	assert(devices != NULL);
 
-	p->list_locked = false;
 	free(*devices);
 	*devices = NULL;
 
@@ -973,7 +1179,7 @@ p_dump(struct xrt_prober *xp, bool use_stdout)
 	struct prober *p = (struct prober *)xp;
 
 	for (size_t i = 0; i < p->device_count; i++) {
-		struct prober_device *pdev = &p->devices[i];
+		struct prober_device *pdev = p->devices[i];
 		p_dump_device(p, pdev, (int)i, use_stdout);
 	}
 
@@ -1033,19 +1239,26 @@ p_create_system(struct xrt_prober *xp,
 
 	//! @todo Improve estimation selection logic.
 	if (select == NULL) {
-		for (size_t i = 0; i < p->builder_count; i++) {
-			struct xrt_builder *xb = p->builders[i];
+		uint64_t start_ns = os_monotonic_get_ns();
 
-			if (xb->exclude_from_automatic_discovery) {
+		struct estimate_task *tasks = U_TYPED_ARRAY_CALLOC(struct estimate_task, p->builder_count);
+		size_t task_count = 0;
+		for (size_t i = 0; i < p->builder_count; i++) {
+			if (p->builders[i]->exclude_from_automatic_discovery) {
 				continue;
 			}
+			tasks[task_count].p = p;
+			tasks[task_count].xb = p->builders[i];
+			task_count++;
+		}
 
-			struct xrt_builder_estimate estimate = {0};
-			xrt_builder_estimate_system(xb, p->json.root, xp, &estimate);
+		estimate_builders(p, tasks, task_count);
+		timing_add_phase(p, "estimate builders", start_ns);
 
-			if (estimate.certain.head) {
-				select = xb;
-				break;
+		// Same order as before, first builder that is certain wins.
+		for (size_t i = 0; i < task_count && select == NULL; i++) {
+			if (tasks[i].estimate.certain.head) {
+				select = tasks[i].xb;
 			}
 		}
 
@@ -1054,34 +1267,24 @@ p_create_system(struct xrt_prober *xp,
 		} else {
 			u_pp(dg, "\n\tNo builder was certain that it could create a head device");
 		}
-	}
-
-	if (select == NULL) {
-		for (size_t i = 0; i < p->builder_count; i++) {
-			struct xrt_builder *xb = p->builders[i];
 
-			if (xb->exclude_from_automatic_discovery) {
-				continue;
-			}
-
-			struct xrt_builder_estimate estimate = {0};
-			xrt_builder_estimate_system(xb, p->json.root, xp, &estimate);
-
-			if (estimate.maybe.head) {
-				select = xb;
-				break;
+		for (size_t i = 0; i < task_count && select == NULL; i++) {
+			if (tasks[i].estimate.maybe.head) {
+				select = tasks[i].xb;
+				u_pp(dg, "\n\tSelected %s because it maybe could create a head", select->identifier);
 			}
 		}
 
-		if (select != NULL) {
-			u_pp(dg, "\n\tSelected %s because it maybe could create a head", select->identifier);
-		} else {
+		if (select == NULL) {
 			u_pp(dg, "\n\tNo builder could maybe create a head device");
 		}
+
+		free(tasks);
 	}
 
 	if (select != NULL) {
 		u_pp(dg, "\n\tUsing builder %s: %s", select->identifier, select->name);
+		uint64_t start_ns = os_monotonic_get_ns();
 		xret = xrt_builder_open_system( //
 		    select,                     //
 		    p->json.root,               //
@@ -1089,6 +1292,7 @@ p_create_system(struct xrt_prober *xp,
 		    broadcast,                  //
 		    out_xsysd,                  //
 		    out_xso);                   //
+		timing_add_phase(p, "open system", start_ns);
 
 		if (xret == XRT_SUCCESS) {
 			print_system_devices(dg, *out_xsysd);
@@ -1098,6 +1302,8 @@ p_create_system(struct xrt_prober *xp,
 		xret = XRT_ERROR_DEVICE_CREATION_FAILED;
 	}
 
+	print_timing(dg, p);
+
 	u_pp(dg, "\n\tResult: ");
 	u_pp_xrt_result(dg, xret);
 
@@ -1291,7 +1497,7 @@ p_list_video_devices(struct xrt_prober *xp, xrt_prober_list_video_func_t cb, voi
 
 	// Video sources from video devices
 	for (size_t i = 0; i < p->device_count; i++) {
-		struct prober_device *pdev = &p->devices[i];
+		struct prober_device *pdev = p->devices[i];
 
 		bool has = false;
 #ifdef XRT_HAVE_LIBUVC
@@ -1351,6 +1557,25 @@ p_get_string_descriptor(struct xrt_prober *xp,
 	struct prober_device *pdev = (struct prober_device *)xpdev;
 	int ret = 0;
 
+	/*
+	 * Builders match on these strings a lot while estimating, use what was
+	 * read from sysfs when probing instead of opening the device each time.
+	 */
+	if (pdev->base.bus == XRT_BUS_TYPE_USB) {
+		const char *str = NULL;
+		switch (which_string) {
+		case XRT_PROBER_STRING_MANUFACTURER: str = pdev->usb.manufacturer; break;
+		case XRT_PROBER_STRING_PRODUCT: str = pdev->usb.product; break;
+		case XRT_PROBER_STRING_SERIAL_NUMBER: str = pdev->usb.serial; break;
+		default: break;
+		}
+
+		if (str != NULL && max_length > 0) {
+			int len = snprintf((char *)buffer, max_length, "%s", str);
+			return len < (int)max_length ? len : (int)max_length - 1;
+		}
+	}
+
 #ifdef XRT_HAVE_LIBUSB
 	if (pdev->base.bus == XRT_BUS_TYPE_USB && pdev->usb.dev != NULL) {
 		assert(max_length < INT_MAX);
@@ -1415,6 +1640,67 @@ p_can_open(struct xrt_prober *xp, struct xrt_prober_device *xpdev)
 	return false;
 }
 
+static xrt_result_t
+p_add_hotplug_listener(struct xrt_prober *xp, xrt_prober_hotplug_func_t func, void *ptr)
+{
+	struct prober *p = (struct prober *)xp;
+
+	os_mutex_lock(&p->list_lock_mutex);
+
+	if (p->hotplug_listener_count >= ARRAY_SIZE(p->hotplug_listeners)) {
+		os_mutex_unlock(&p->list_lock_mutex);
+		P_ERROR(p, "Too many hotplug listeners!");
+		return XRT_ERROR_ALLOCATION;
+	}
+
+	uint32_t i = p->hotplug_listener_count++;
+	p->hotplug_listeners[i].func = func;
+	p->hotplug_listeners[i].ptr = ptr;
+
+	bool start = p->hotplug == NULL && debug_get_bool_option_prober_hotplug();
+
+	os_mutex_unlock(&p->list_lock_mutex);
+
+	// Only watch for devices once somebody cares about them.
+	if (!start) {
+		return XRT_SUCCESS;
+	}
+
+#ifdef XRT_HAVE_LIBUDEV
+	struct p_hotplug_source *source = p_udev_hotplug_source_create(p);
+	if (source == NULL || p_hotplug_start(p, source) != 0) {
+		P_WARN(p, "Could not start hotplug monitoring, devices will only be found when probing.");
+	}
+#else
+	P_WARN(p, "Hotplug monitoring not supported on this platform.");
+#endif
+
+	return XRT_SUCCESS;
+}
+
+static xrt_result_t
+p_remove_hotplug_listener(struct xrt_prober *xp, xrt_prober_hotplug_func_t func, void *ptr)
+{
+	struct prober *p = (struct prober *)xp;
+
+	os_mutex_lock(&p->list_lock_mutex);
+
+	for (uint32_t i = 0; i < p->hotplug_listener_count; i++) {
+		if (p->hotplug_listeners[i].func == func && p->hotplug_listeners[i].ptr == ptr) {
+			p->hotplug_listeners[i] = p->hotplug_listeners[--p->hotplug_listener_count];
+			break;
+		}
+	}
+
+	os_mutex_unlock(&p->list_lock_mutex);
+
+	// Listeners are called with this held, wait for a running call to finish.
+	os_mutex_lock(&p->hotplug_dispatch_mutex);
+	os_mutex_unlock(&p->hotplug_dispatch_mutex);
+
+	return XRT_SUCCESS;
+}
+
 static void
 p_destroy(struct xrt_prober **xp)
 {
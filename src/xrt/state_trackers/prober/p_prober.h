@@ -18,6 +18,8 @@
 #include "util/u_logging.h"
 #include "util/u_config_json.h"
 
+#include "os/os_threading.h"
+
 #ifdef XRT_HAVE_LIBUSB
 #include <libusb.h>
 #endif
@@ -30,6 +32,10 @@
 #include <sys/types.h>
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /*
  *
  * Struct and defines
@@ -37,6 +43,8 @@
  */
 
 #define P_PROBER_BLUETOOTH_PRODUCT_COUNT 64
+#define P_PROBER_MAX_TIMING_PHASES 32
+#define P_PROBER_MAX_HOTPLUG_LISTENERS 8
 
 #define P_TRACE(d, ...) U_LOG_IFL_T(d->log_level, __VA_ARGS__)
 #define P_DEBUG(d, ...) U_LOG_IFL_D(d->log_level, __VA_ARGS__)
@@ -89,6 +97,9 @@ struct prober_device
 
 #ifdef XRT_HAVE_LIBUSB
 		libusb_device *dev;
+
+		//! Looked up by hotplug, holds a reference of its own to @p dev.
+		bool dev_owned;
 #endif
 	} usb;
 
@@ -115,6 +126,20 @@ struct prober_device
 	size_t num_hidraws;
 	struct prober_hidraw *hidraws;
 #endif
+
+	//! Added by hotplug and listeners not yet told about it.
+	bool hotplug_added;
+};
+
+struct p_hotplug;
+
+/*!
+ * How long one phase of getting the system up took, see @ref prober::timing.
+ */
+struct prober_timing_phase
+{
+	const char *name;
+	uint64_t duration_ns;
 };
 
 /*!
@@ -139,9 +164,47 @@ struct prober
 	size_t builder_count;
 
 	/*!
-	 * Has the list been locked.
+	 * Number of times the list is currently locked, builders may lock it
+	 * from several threads at once while estimating.
+	 */
+	uint32_t list_lock_count;
+
+	//! Protects @ref list_lock_count, held while changing the device list.
+	struct os_mutex list_lock_mutex;
+
+	/*!
+	 * Held while hotplug applies events and calls the listeners, and while
+	 * probing, so devices are not freed while listeners use them. Taken
+	 * before @ref list_lock_mutex.
 	 */
-	bool list_locked;
+	struct os_mutex hotplug_dispatch_mutex;
+
+	//! Probe devices and estimate builders on several threads.
+	bool parallel;
+
+	//! Keeps the device list up to date, created with the first listener.
+	struct p_hotplug *hotplug;
+
+	//! Protected by @ref list_lock_mutex.
+	struct
+	{
+		xrt_prober_hotplug_func_t func;
+		void *ptr;
+	} hotplug_listeners[P_PROBER_MAX_HOTPLUG_LISTENERS];
+	uint32_t hotplug_listener_count;
+
+	/*!
+	 * Time spent in each phase of probing and creating the system, printed
+	 * as part of the create system log.
+	 */
+	struct
+	{
+		//! When the prober was created.
+		uint64_t start_ns;
+
+		struct prober_timing_phase phases[P_PROBER_MAX_TIMING_PHASES];
+		uint32_t phase_count;
+	} timing;
 
 #ifdef XRT_HAVE_LIBUSB
 	struct
@@ -164,8 +227,12 @@ struct prober
 
 	struct xrt_auto_prober *auto_probers[XRT_MAX_AUTO_PROBERS];
 
+	/*!
+	 * Each device is allocated on its own, so pointers to them stay valid
+	 * when hotplug adds or removes other devices.
+	 */
 	size_t device_count;
-	struct prober_device *devices;
+	struct prober_device **devices;
 
 	size_t num_entries;
 	struct xrt_prober_entry **entries;
@@ -218,6 +285,40 @@ p_dev_get_bluetooth_dev(struct prober *p,
                         const char *product_name,
                         struct prober_device **out_pdev);
 
+/*!
+ * Take the device at @p index out of the list without freeing it, moves the
+ * devices after it. Free it with @ref p_dev_free.
+ *
+ * @private @memberof prober
+ */
+struct prober_device *
+p_dev_detach(struct prober *p, size_t index);
+
+/*!
+ * Free a device taken out of the list with @ref p_dev_detach.
+ *
+ * @private @memberof prober
+ */
+void
+p_dev_free(struct prober_device *pdev);
+
+/*!
+ * Remove and free the device at @p index, moves the devices after it.
+ *
+ * @private @memberof prober
+ */
+void
+p_dev_remove(struct prober *p, size_t index);
+
+/*!
+ * Call all hotplug listeners. Must be called with the hotplug dispatch mutex
+ * held and the list lock mutex not held, listeners may lock the list.
+ *
+ * @private @memberof prober
+ */
+void
+p_notify_hotplug(struct prober *p, enum xrt_prober_hotplug_event event, struct prober_device *pdev);
+
 /*!
  * @name Tracking systems
  * @{
@@ -283,6 +384,15 @@ p_libusb_get_string_descriptor(struct prober *p,
 bool
 p_libusb_can_open(struct prober *p, struct prober_device *pdev);
 
+/*!
+ * Find the libusb device of a device added by hotplug after the probe, which
+ * only has its udev nodes, so it can be opened with libusb.
+ *
+ * @private @memberof prober
+ */
+int
+p_libusb_attach(struct prober *p, struct prober_device *pdev);
+
 /*!
  * @}
  */
@@ -321,12 +431,132 @@ p_libuvc_probe(struct prober *p);
  * @name udev
  * @{
  */
+
+enum p_udev_record_type
+{
+	P_UDEV_RECORD_USB,
+	P_UDEV_RECORD_V4L,
+	P_UDEV_RECORD_HIDRAW,
+};
+
+/*!
+ * Everything read from sysfs about one device node, filled in on a scan
+ * thread or from a hotplug event and turned into a @ref prober_device
+ * afterwards. The strings are owned by the record.
+ */
+struct p_udev_record
+{
+	enum p_udev_record_type type;
+
+	uint32_t bus_type;
+	uint16_t vendor_id;
+	uint16_t product_id;
+	uint8_t dev_class;
+	uint16_t usb_bus;
+	uint16_t usb_addr;
+	uint16_t interface;
+	uint32_t v4l_index;
+	uint64_t bluetooth_id;
+	char product_name[P_PROBER_BLUETOOTH_PRODUCT_COUNT];
+
+	char *sysfs_path;
+	char *dev_path;
+	char *serial;
+	char *product;
+	char *manufacturer;
+};
+
 /*!
  * @private @memberof prober
  */
 int
 p_udev_probe(struct prober *p);
+
+/*!
+ * Add the device or interface described by @p r to the device list, does
+ * nothing if it is already there. Must be called with the list lock mutex
+ * held, or from probe.
+ *
+ * @private @memberof prober
+ */
+void
+p_udev_apply_record(struct prober *p, const struct p_udev_record *r);
+
+/*!
+ * Free the strings of @p r and zero it.
+ */
+void
+p_udev_record_clear(struct p_udev_record *r);
+
+/*!
+ * @}
+ */
+
+/*!
+ * @name Hotplug
+ * @{
+ */
+
+enum p_hotplug_action
+{
+	P_HOTPLUG_ACTION_ADD,
+	P_HOTPLUG_ACTION_REMOVE,
+};
+
+/*!
+ * A device node showing up or going away. For removals only the type and
+ * the device path of the record are set, nothing else can be read anymore.
+ */
+struct p_hotplug_event
+{
+	enum p_hotplug_action action;
+	struct p_udev_record record;
+};
+
+/*!
+ * Where hotplug events come from, a udev monitor normally. Lets the tests
+ * feed in events without any devices.
+ */
+struct p_hotplug_source
+{
+	//! Pollable file descriptor, readable when there are events.
+	int (*get_fd)(struct p_hotplug_source *source);
+
+	//! Returns 1 and fills @p out_event if there was one, 0 if not, negative on error.
+	int (*read_event)(struct p_hotplug_source *source, struct p_hotplug_event *out_event);
+
+	void (*destroy)(struct p_hotplug_source *source);
+};
+
+/*!
+ * Create a source backed by a udev monitor.
+ *
+ * @private @memberof prober
+ */
+struct p_hotplug_source *
+p_udev_hotplug_source_create(struct prober *p);
+
+/*!
+ * Start the hotplug thread reading from @p source, takes ownership of it.
+ *
+ * @private @memberof prober
+ */
+int
+p_hotplug_start(struct prober *p, struct p_hotplug_source *source);
+
+/*!
+ * Stop the hotplug thread and drop any pending events.
+ *
+ * @private @memberof prober
+ */
+void
+p_hotplug_stop(struct prober *p);
+
 /*!
  * @}
  */
 #endif
+
+#ifdef __cplusplus
+}
+#endif
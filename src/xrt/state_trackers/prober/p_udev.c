@@ -8,6 +8,7 @@
  */
 
 #include "util/u_misc.h"
+#include "os/os_threading.h"
 #include "p_prober.h"
 
 #include <stdio.h>
@@ -29,14 +30,66 @@
 #define HIDRAW_BUS_I2C_MAYBE_QUESTION_MARK 24
 
 
+/*
+ *
+ * Structs.
+ *
+ */
+
+/*!
+ * One subsystem being enumerated, each has its own udev context so they can
+ * run on separate threads, libudev contexts must not be shared.
+ */
+struct p_udev_scan
+{
+	struct prober *p;
+	enum p_udev_record_type type;
+
+	struct os_thread thread;
+	bool started;
+	int ret;
+
+	struct p_udev_record *records;
+	size_t record_count;
+};
+
+/*!
+ * Hotplug source backed by a udev monitor.
+ */
+struct p_udev_hotplug_source
+{
+	struct p_hotplug_source base;
+
+	struct prober *p;
+
+	struct udev *udev;
+	struct udev_monitor *monitor;
+};
+
+
 /*
  *
  * Pre-declare functions.
  *
  */
 
-static void
-p_udev_enumerate_usb(struct prober *p, struct udev *udev);
+static void *
+p_udev_scan_run(void *ptr);
+
+static int
+p_udev_read_record(struct prober *p,
+                   enum p_udev_record_type type,
+                   struct udev_device *raw_dev,
+                   struct p_udev_record *out_record);
+
+static int
+p_udev_read_usb(struct prober *p, struct udev_device *raw_dev, struct p_udev_record *r);
+
+static int
+p_udev_read_v4l2(struct prober *p, struct udev_device *raw_dev, struct p_udev_record *r);
+
+static int
+p_udev_read_hidraw(struct prober *p, struct udev_device *raw_dev, struct p_udev_record *r);
 
 static void
 p_udev_add_usb(struct prober_device *pdev,
@@ -46,15 +99,9 @@ p_udev_add_usb(struct prober_device *pdev,
                const char *serial,
                const char *path);
 
-static void
-p_udev_enumerate_v4l2(struct prober *p, struct udev *udev);
-
 static void
 p_udev_add_v4l(struct prober_device *pdev, uint32_t v4l_index, uint32_t usb_iface, const char *path);
 
-static void
-p_udev_enumerate_hidraw(struct prober *p, struct udev *udev);
-
 static void
 p_udev_add_hidraw(struct prober_device *pdev, uint32_t interface, const char *path);
 
@@ -121,21 +168,177 @@ p_udev_dump_device(struct udev_device *udev_dev, const char *name);
 int
 p_udev_probe(struct prober *p)
 {
-	struct udev *udev = udev_new();
-	if (!udev) {
-		P_ERROR(p, "Can't create udev");
-		return -1;
+	struct p_udev_scan scans[3] = {
+	    {.p = p, .type = P_UDEV_RECORD_USB},
+	    {.p = p, .type = P_UDEV_RECORD_V4L},
+	    {.p = p, .type = P_UDEV_RECORD_HIDRAW},
+	};
+	int ret = 0;
+
+	/*
+	 * The sysfs reads are the slow part, so the subsystems are scanned in
+	 * parallel. The results are then applied in the same order as before
+	 * so the device list doesn't change order.
+	 */
+	for (uint32_t i = 0; i < ARRAY_SIZE(scans); i++) {
+		os_thread_init(&scans[i].thread);
+		scans[i].started = p->parallel && os_thread_start(&scans[i].thread, p_udev_scan_run, &scans[i]) == 0;
+		if (!scans[i].started) {
+			p_udev_scan_run(&scans[i]);
+		}
+	}
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(scans); i++) {
+		if (scans[i].started) {
+			os_thread_join(&scans[i].thread);
+		}
+		os_thread_destroy(&scans[i].thread);
+
+		if (scans[i].ret != 0) {
+			ret = scans[i].ret;
+		}
 	}
 
-	p_udev_enumerate_usb(p, udev);
+	for (uint32_t i = 0; i < ARRAY_SIZE(scans); i++) {
+		for (size_t k = 0; k < scans[i].record_count; k++) {
+			struct p_udev_record *r = &scans[i].records[k];
+			if (ret == 0) {
+				p_udev_apply_record(p, r);
+			}
+			p_udev_record_clear(r);
+		}
 
-	p_udev_enumerate_v4l2(p, udev);
+		free(scans[i].records);
+	}
 
-	p_udev_enumerate_hidraw(p, udev);
+	return ret;
+}
 
-	udev_unref(udev);
+void
+p_udev_record_clear(struct p_udev_record *r)
+{
+	free(r->sysfs_path);
+	free(r->dev_path);
+	free(r->serial);
+	free(r->product);
+	free(r->manufacturer);
+	U_ZERO(r);
+}
 
-	return 0;
+static int
+p_udev_hotplug_get_fd(struct p_hotplug_source *source)
+{
+	struct p_udev_hotplug_source *uhs = (struct p_udev_hotplug_source *)source;
+
+	return udev_monitor_get_fd(uhs->monitor);
+}
+
+static int
+p_udev_hotplug_read_event(struct p_hotplug_source *source, struct p_hotplug_event *out_event)
+{
+	struct p_udev_hotplug_source *uhs = (struct p_udev_hotplug_source *)source;
+	struct prober *p = uhs->p;
+
+	while (true) {
+		// The monitor socket is non-blocking, returns NULL once empty.
+		struct udev_device *raw_dev = udev_monitor_receive_device(uhs->monitor);
+		if (raw_dev == NULL) {
+			return 0;
+		}
+
+		const char *action = udev_device_get_action(raw_dev);
+		const char *subsystem = udev_device_get_subsystem(raw_dev);
+		const char *dev_path = udev_device_get_devnode(raw_dev);
+
+		enum p_udev_record_type type;
+		if (subsystem == NULL || action == NULL || dev_path == NULL) {
+			udev_device_unref(raw_dev);
+			continue;
+		} else if (strcmp(subsystem, "usb") == 0) {
+			type = P_UDEV_RECORD_USB;
+		} else if (strcmp(subsystem, "video4linux") == 0) {
+			type = P_UDEV_RECORD_V4L;
+		} else if (strcmp(subsystem, "hidraw") == 0) {
+			type = P_UDEV_RECORD_HIDRAW;
+		} else {
+			udev_device_unref(raw_dev);
+			continue;
+		}
+
+		int ret = -1;
+		U_ZERO(out_event);
+		if (strcmp(action, "add") == 0) {
+			out_event->action = P_HOTPLUG_ACTION_ADD;
+			ret = p_udev_read_record(p, type, raw_dev, &out_event->record);
+		} else if (strcmp(action, "remove") == 0) {
+			// Nothing but the path can be read from a removed device.
+			out_event->action = P_HOTPLUG_ACTION_REMOVE;
+			out_event->record.type = type;
+			out_event->record.dev_path = strdup(dev_path);
+			ret = 0;
+		}
+
+		P_DEBUG(p, "udev %s %s '%s' (%i)", action, subsystem, dev_path, ret);
+
+		udev_device_unref(raw_dev);
+
+		if (ret == 0) {
+			return 1;
+		}
+
+		p_udev_record_clear(&out_event->record);
+	}
+}
+
+static void
+p_udev_hotplug_destroy(struct p_hotplug_source *source)
+{
+	struct p_udev_hotplug_source *uhs = (struct p_udev_hotplug_source *)source;
+
+	if (uhs->monitor != NULL) {
+		udev_monitor_unref(uhs->monitor);
+	}
+	if (uhs->udev != NULL) {
+		udev_unref(uhs->udev);
+	}
+
+	free(uhs);
+}
+
+struct p_hotplug_source *
+p_udev_hotplug_source_create(struct prober *p)
+{
+	struct p_udev_hotplug_source *uhs = U_TYPED_CALLOC(struct p_udev_hotplug_source);
+	uhs->base.get_fd = p_udev_hotplug_get_fd;
+	uhs->base.read_event = p_udev_hotplug_read_event;
+	uhs->base.destroy = p_udev_hotplug_destroy;
+	uhs->p = p;
+
+	uhs->udev = udev_new();
+	if (uhs->udev == NULL) {
+		P_ERROR(p, "Can't create udev");
+		p_udev_hotplug_destroy(&uhs->base);
+		return NULL;
+	}
+
+	uhs->monitor = udev_monitor_new_from_netlink(uhs->udev, "udev");
+	if (uhs->monitor == NULL) {
+		P_ERROR(p, "Can't create udev monitor");
+		p_udev_hotplug_destroy(&uhs->base);
+		return NULL;
+	}
+
+	udev_monitor_filter_add_match_subsystem_devtype(uhs->monitor, "usb", "usb_device");
+	udev_monitor_filter_add_match_subsystem_devtype(uhs->monitor, "video4linux", NULL);
+	udev_monitor_filter_add_match_subsystem_devtype(uhs->monitor, "hidraw", NULL);
+
+	if (udev_monitor_enable_receiving(uhs->monitor) < 0) {
+		P_ERROR(p, "Can't enable udev monitor");
+		p_udev_hotplug_destroy(&uhs->base);
+		return NULL;
+	}
+
+	return &uhs->base;
 }
 
 
@@ -145,183 +348,228 @@ p_udev_probe(struct prober *p)
  *
  */
 
-static void
-p_udev_enumerate_usb(struct prober *p, struct udev *udev)
+static char *
+p_udev_strdup_or_null(const char *str)
 {
+	return str != NULL ? strdup(str) : NULL;
+}
+
+static void *
+p_udev_scan_run(void *ptr)
+{
+	struct p_udev_scan *scan = (struct p_udev_scan *)ptr;
+	struct prober *p = scan->p;
 	struct udev_enumerate *enumerate;
 	struct udev_list_entry *devices;
 	struct udev_list_entry *dev_list_entry;
 
+	struct udev *udev = udev_new();
+	if (!udev) {
+		P_ERROR(p, "Can't create udev");
+		scan->ret = -1;
+		return NULL;
+	}
+
 	enumerate = udev_enumerate_new(udev);
-	udev_enumerate_add_match_subsystem(enumerate, "usb");
-	udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
+	switch (scan->type) {
+	case P_UDEV_RECORD_USB:
+		udev_enumerate_add_match_subsystem(enumerate, "usb");
+		udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
+		break;
+	case P_UDEV_RECORD_V4L: udev_enumerate_add_match_subsystem(enumerate, "video4linux"); break;
+	case P_UDEV_RECORD_HIDRAW: udev_enumerate_add_match_subsystem(enumerate, "hidraw"); break;
+	}
 	udev_enumerate_scan_devices(enumerate);
 
 	devices = udev_enumerate_get_list_entry(enumerate);
 	udev_list_entry_foreach(dev_list_entry, devices)
 	{
-		struct prober_device *pdev = NULL;
-		struct udev_device *raw_dev = NULL;
-		const char *sysfs_path = NULL;
-		const char *dev_path = NULL;
-		const char *serial = NULL;
-		const char *product = NULL;
-		const char *manufacturer = NULL;
-		uint8_t dev_class = 0;
-		uint16_t vendor_id = 0;
-		uint16_t product_id = 0;
-		uint16_t usb_bus = 0;
-		uint16_t usb_addr = 0;
-		int ret;
-
 		// Where in the sysfs is.
-		sysfs_path = udev_list_entry_get_name(dev_list_entry);
+		const char *sysfs_path = udev_list_entry_get_name(dev_list_entry);
 		// Raw sysfs node.
-		raw_dev = udev_device_new_from_syspath(udev, sysfs_path);
-		// The thing we will open.
-		dev_path = udev_device_get_devnode(raw_dev);
-		// Serial number.
-		serial = udev_device_get_sysattr_value(raw_dev, "serial");
-		// Product name.
-		product = udev_device_get_sysattr_value(raw_dev, "product");
-		// Manufacturer name.
-		manufacturer = udev_device_get_sysattr_value(raw_dev, "manufacturer");
-
-
-		ret = p_udev_get_usb_device_info(raw_dev, &dev_class, &vendor_id, &product_id, &usb_bus, &usb_addr);
-		if (ret != 0) {
-			P_ERROR(p, "Failed to get usb device info");
-			goto next;
-		}
-
-		ret = p_dev_get_usb_dev(p, usb_bus, usb_addr, vendor_id, product_id, &pdev);
-
-		P_TRACE(p,
-		        "usb\n"
-		        "\t\tptr:          %p (%i)\n"
-		        "\t\tsysfs_path:   '%s'\n"
-		        "\t\tdev_path:     '%s'\n"
-		        "\t\tdev_class:    %02x\n"
-		        "\t\tvendor_id:    %04x\n"
-		        "\t\tproduct_id:   %04x\n"
-		        "\t\tusb_bus:      %i\n"
-		        "\t\tusb_addr:     %i\n"
-		        "\t\tserial:       '%s'\n"
-		        "\t\tproduct:      '%s'\n"
-		        "\t\tmanufacturer: '%s'",
-		        (void *)pdev, ret, sysfs_path, dev_path, dev_class, vendor_id, product_id, usb_bus, usb_addr,
-		        serial, product, manufacturer);
+		struct udev_device *raw_dev = udev_device_new_from_syspath(udev, sysfs_path);
 
-		if (ret != 0) {
-			P_ERROR(p, "p_dev_get_usb_device failed!");
-			goto next;
+		struct p_udev_record record;
+		if (p_udev_read_record(p, scan->type, raw_dev, &record) == 0) {
+			U_ARRAY_REALLOC_OR_FREE(scan->records, struct p_udev_record, (scan->record_count + 1));
+			scan->records[scan->record_count++] = record;
+		} else {
+			p_udev_record_clear(&record);
 		}
 
-		// Add info to usb device.
-		p_udev_add_usb(pdev, dev_class, product, manufacturer, serial, dev_path);
-
-	next:
 		udev_device_unref(raw_dev);
 	}
 
 	udev_enumerate_unref(enumerate);
+	udev_unref(udev);
+
+	return NULL;
 }
 
-static void
-p_udev_add_usb(struct prober_device *pdev,
-               uint8_t dev_class,
-               const char *product,
-               const char *manufacturer,
-               const char *serial,
-               const char *path)
+static int
+p_udev_read_record(struct prober *p,
+                   enum p_udev_record_type type,
+                   struct udev_device *raw_dev,
+                   struct p_udev_record *out_record)
 {
-	pdev->base.usb_dev_class = dev_class;
+	U_ZERO(out_record);
+	out_record->type = type;
+	out_record->sysfs_path = p_udev_strdup_or_null(udev_device_get_syspath(raw_dev));
+
+	switch (type) {
+	case P_UDEV_RECORD_USB: return p_udev_read_usb(p, raw_dev, out_record);
+	case P_UDEV_RECORD_V4L: return p_udev_read_v4l2(p, raw_dev, out_record);
+	case P_UDEV_RECORD_HIDRAW: return p_udev_read_hidraw(p, raw_dev, out_record);
+	default: return -1;
+	}
+}
 
-	if (product != NULL) {
-		pdev->usb.product = strdup(product);
+static int
+p_udev_read_usb(struct prober *p, struct udev_device *raw_dev, struct p_udev_record *r)
+{
+	int ret = p_udev_get_usb_device_info(raw_dev, &r->dev_class, &r->vendor_id, &r->product_id, &r->usb_bus,
+	                                     &r->usb_addr);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to get usb device info");
+		return ret;
 	}
-	if (manufacturer != NULL) {
-		pdev->usb.manufacturer = strdup(manufacturer);
+
+	// The thing we will open.
+	r->dev_path = p_udev_strdup_or_null(udev_device_get_devnode(raw_dev));
+	// Serial number.
+	r->serial = p_udev_strdup_or_null(udev_device_get_sysattr_value(raw_dev, "serial"));
+	// Product name.
+	r->product = p_udev_strdup_or_null(udev_device_get_sysattr_value(raw_dev, "product"));
+	// Manufacturer name.
+	r->manufacturer = p_udev_strdup_or_null(udev_device_get_sysattr_value(raw_dev, "manufacturer"));
+
+	return 0;
+}
+
+static int
+p_udev_read_v4l2(struct prober *p, struct udev_device *raw_dev, struct p_udev_record *r)
+{
+	struct udev_device *usb_device = NULL;
+	int ret;
+
+	// The thing we will open.
+	const char *dev_path = udev_device_get_devnode(raw_dev);
+
+	ret = p_udev_try_usb_relation_get_address(raw_dev, &r->dev_class, &r->vendor_id, &r->product_id, &r->usb_bus,
+	                                          &r->usb_addr, &usb_device);
+	if (ret != 0) {
+		P_DEBUG(p, "skipping non-usb v4l device '%s'", dev_path);
+		return ret;
 	}
-	if (serial != NULL) {
-		pdev->usb.serial = strdup(serial);
+
+	// USB interface.
+	ret = p_udev_get_interface_number(raw_dev, &r->interface);
+	if (ret != 0) {
+		P_ERROR(p,
+		        "In enumerating V4L2 devices: "
+		        "Failed to get interface number for '%s'",
+		        r->sysfs_path);
+		return ret;
 	}
-	if (path != NULL) {
-		pdev->usb.path = strdup(path);
+
+	// USB interface.
+	ret = p_udev_get_sysattr_u32_base10(raw_dev, "index", &r->v4l_index);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to get v4l index.");
+		return ret;
 	}
+
+	r->dev_path = p_udev_strdup_or_null(dev_path);
+	// Serial number.
+	r->serial = p_udev_strdup_or_null(udev_device_get_sysattr_value(usb_device, "serial"));
+	// Product name.
+	r->product = p_udev_strdup_or_null(udev_device_get_sysattr_value(usb_device, "product"));
+	// Manufacturer name.
+	r->manufacturer = p_udev_strdup_or_null(udev_device_get_sysattr_value(usb_device, "manufacturer"));
+
+	return 0;
 }
 
-static void
-p_udev_enumerate_v4l2(struct prober *p, struct udev *udev)
+static int
+p_udev_read_hidraw(struct prober *p, struct udev_device *raw_dev, struct p_udev_record *r)
 {
-	struct udev_enumerate *enumerate;
-	struct udev_list_entry *devices;
-	struct udev_list_entry *dev_list_entry;
+	int ret;
 
-	enumerate = udev_enumerate_new(udev);
-	udev_enumerate_add_match_subsystem(enumerate, "video4linux");
-	udev_enumerate_scan_devices(enumerate);
+	// Bus type, vendor_id and product_id.
+	ret = p_udev_get_and_parse_uevent(raw_dev, &r->bus_type, &r->vendor_id, &r->product_id, &r->product_name,
+	                                  &r->bluetooth_id);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to get uevent info from device");
+		return ret;
+	}
 
-	devices = udev_enumerate_get_list_entry(enumerate);
+	// Get USB bus and address to de-duplicate devices.
+	ret = p_udev_get_usb_hid_address(raw_dev, r->bus_type, &r->dev_class, &r->usb_bus, &r->usb_addr);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to get USB bus and addr.");
+		return ret;
+	}
 
-	udev_list_entry_foreach(dev_list_entry, devices)
-	{
-		struct prober_device *pdev = NULL;
-		struct udev_device *raw_dev = NULL;
-		struct udev_device *usb_device = NULL;
-		const char *sysfs_path = NULL;
-		const char *dev_path = NULL;
-		const char *serial = NULL;
-		const char *product = NULL;
-		const char *manufacturer = NULL;
-		uint8_t dev_class = 0;
-		uint16_t vendor_id = 0;
-		uint16_t product_id = 0;
-		uint16_t usb_bus = 0;
-		uint16_t usb_addr = 0;
-		uint16_t usb_iface = 0;
-		uint32_t v4l_index = 0;
-		int ret;
+	switch (r->bus_type) {
+	case HIDRAW_BUS_BLUETOOTH:
+	case HIDRAW_BUS_USB: break;
+	case HIDRAW_BUS_I2C_MAYBE_QUESTION_MARK: return -1;
+	default: P_ERROR(p, "Unknown hidraw bus_type: '%i', ignoring.", r->bus_type); return -1;
+	}
 
-		// Where in the sysfs is.
-		sysfs_path = udev_list_entry_get_name(dev_list_entry);
-		// Raw sysfs node.
-		raw_dev = udev_device_new_from_syspath(udev, sysfs_path);
-		// The thing we will open.
-		dev_path = udev_device_get_devnode(raw_dev);
+	// HID interface.
+	ret = p_udev_get_interface_number(raw_dev, &r->interface);
+	if (ret != 0) {
+		P_ERROR(p,
+		        "In enumerating hidraw devices: "
+		        "Failed to get interface number for '%s'",
+		        r->sysfs_path);
+		return ret;
+	}
 
-		ret = p_udev_try_usb_relation_get_address(raw_dev, &dev_class, &vendor_id, &product_id, &usb_bus,
-		                                          &usb_addr, &usb_device);
-		if (ret != 0) {
-			P_DEBUG(p, "skipping non-usb v4l device '%s'", dev_path);
-			goto next;
-		}
+	// The thing we will open.
+	r->dev_path = p_udev_strdup_or_null(udev_device_get_devnode(raw_dev));
 
-		// Serial number.
-		serial = udev_device_get_sysattr_value(usb_device, "serial");
-		// Product name.
-		product = udev_device_get_sysattr_value(usb_device, "product");
-		// Manufacturer name.
-		manufacturer = udev_device_get_sysattr_value(usb_device, "manufacturer");
+	return 0;
+}
 
-		// USB interface.
-		ret = p_udev_get_interface_number(raw_dev, &usb_iface);
-		if (ret != 0) {
-			P_ERROR(p,
-			        "In enumerating V4L2 devices: "
-			        "Failed to get interface number for '%s'",
-			        sysfs_path);
-			goto next;
-		}
+void
+p_udev_apply_record(struct prober *p, const struct p_udev_record *r)
+{
+	struct prober_device *pdev = NULL;
+	int ret;
+
+	switch (r->type) {
+	case P_UDEV_RECORD_USB:
+		ret = p_dev_get_usb_dev(p, r->usb_bus, r->usb_addr, r->vendor_id, r->product_id, &pdev);
+
+		P_TRACE(p,
+		        "usb\n"
+		        "\t\tptr:          %p (%i)\n"
+		        "\t\tsysfs_path:   '%s'\n"
+		        "\t\tdev_path:     '%s'\n"
+		        "\t\tdev_class:    %02x\n"
+		        "\t\tvendor_id:    %04x\n"
+		        "\t\tproduct_id:   %04x\n"
+		        "\t\tusb_bus:      %i\n"
+		        "\t\tusb_addr:     %i\n"
+		        "\t\tserial:       '%s'\n"
+		        "\t\tproduct:      '%s'\n"
+		        "\t\tmanufacturer: '%s'",
+		        (void *)pdev, ret, r->sysfs_path, r->dev_path, r->dev_class, r->vendor_id, r->product_id,
+		        r->usb_bus, r->usb_addr, r->serial, r->product, r->manufacturer);
 
-		// USB interface.
-		ret = p_udev_get_sysattr_u32_base10(raw_dev, "index", &v4l_index);
 		if (ret != 0) {
-			P_ERROR(p, "Failed to get v4l index.");
-			goto next;
+			P_ERROR(p, "p_dev_get_usb_device failed!");
+			return;
 		}
 
-		ret = p_dev_get_usb_dev(p, usb_bus, usb_addr, vendor_id, product_id, &pdev);
+		// Add info to usb device.
+		p_udev_add_usb(pdev, r->dev_class, r->product, r->manufacturer, r->serial, r->dev_path);
+		break;
+
+	case P_UDEV_RECORD_V4L:
+		ret = p_dev_get_usb_dev(p, r->usb_bus, r->usb_addr, r->vendor_id, r->product_id, &pdev);
 
 		P_TRACE(p,
 		        "v4l\n"
@@ -337,119 +585,31 @@ p_udev_enumerate_v4l2(struct prober *p, struct udev *udev)
 		        "\t\tserial:       '%s'\n"
 		        "\t\tproduct:      '%s'\n"
 		        "\t\tmanufacturer: '%s'",
-		        (void *)pdev, ret, sysfs_path, dev_path, vendor_id, product_id, v4l_index, usb_iface, usb_bus,
-		        usb_addr, serial, product, manufacturer);
+		        (void *)pdev, ret, r->sysfs_path, r->dev_path, r->vendor_id, r->product_id, r->v4l_index,
+		        r->interface, r->usb_bus, r->usb_addr, r->serial, r->product, r->manufacturer);
 
 		if (ret != 0) {
 			P_ERROR(p, "p_dev_get_usb_device failed!");
-			goto next;
+			return;
 		}
 
 		// Add this interface to the usb device.
-		p_udev_add_v4l(pdev, v4l_index, usb_iface, dev_path);
-
-	next:
-		udev_device_unref(raw_dev);
-	}
-
-	udev_enumerate_unref(enumerate);
-}
-
-static void
-p_udev_add_v4l(struct prober_device *pdev, uint32_t v4l_index, uint32_t usb_iface, const char *path)
-{
-#ifdef XRT_HAVE_V4L2
-	U_ARRAY_REALLOC_OR_FREE(pdev->v4ls, struct prober_v4l, (pdev->num_v4ls + 1));
-
-	struct prober_v4l *v4l = &pdev->v4ls[pdev->num_v4ls++];
-	U_ZERO(v4l);
-
-	v4l->usb_iface = usb_iface;
-	v4l->v4l_index = v4l_index;
-	v4l->path = strdup(path);
-#endif
-}
-
-static void
-p_udev_enumerate_hidraw(struct prober *p, struct udev *udev)
-{
-	struct udev_enumerate *enumerate;
-	struct udev_list_entry *devices;
-	struct udev_list_entry *dev_list_entry;
-
-	enumerate = udev_enumerate_new(udev);
-	udev_enumerate_add_match_subsystem(enumerate, "hidraw");
-	udev_enumerate_scan_devices(enumerate);
-
-	devices = udev_enumerate_get_list_entry(enumerate);
-
-	udev_list_entry_foreach(dev_list_entry, devices)
-	{
-		struct prober_device *pdev = NULL;
-		struct udev_device *raw_dev = NULL;
-		uint16_t vendor_id;
-		uint16_t product_id;
-		uint16_t interface;
-		uint8_t dev_class = 0;
-		uint16_t usb_bus = 0;
-		uint16_t usb_addr = 0;
-		uint32_t bus_type = 0;
-		uint64_t bluetooth_id = 0;
-		char product_name[P_PROBER_BLUETOOTH_PRODUCT_COUNT] = {0};
-		const char *sysfs_path;
-		const char *dev_path;
-		int ret;
-
-		// Where in the sysfs is.
-		sysfs_path = udev_list_entry_get_name(dev_list_entry);
-		// Raw sysfs node.
-		raw_dev = udev_device_new_from_syspath(udev, sysfs_path);
-		// The thing we will open.
-		dev_path = udev_device_get_devnode(raw_dev);
-
-		// Bus type, vendor_id and product_id.
-		ret = p_udev_get_and_parse_uevent(raw_dev, &bus_type, &vendor_id, &product_id, &product_name,
-		                                  &bluetooth_id);
-		if (ret != 0) {
-			P_ERROR(p, "Failed to get uevent info from device");
-			goto next;
-		}
-
-		// Get USB bus and address to de-duplicate devices.
-		ret = p_udev_get_usb_hid_address(raw_dev, bus_type, &dev_class, &usb_bus, &usb_addr);
-		if (ret != 0) {
-			P_ERROR(p, "Failed to get USB bus and addr.");
-			goto next;
-		}
-
-		switch (bus_type) {
-		case HIDRAW_BUS_BLUETOOTH:
-		case HIDRAW_BUS_USB: break;
-		case HIDRAW_BUS_I2C_MAYBE_QUESTION_MARK: goto next;
-		default: P_ERROR(p, "Unknown hidraw bus_type: '%i', ignoring.", bus_type); goto next;
-		}
-
-		// HID interface.
-		ret = p_udev_get_interface_number(raw_dev, &interface);
-		if (ret != 0) {
-			P_ERROR(p,
-			        "In enumerating hidraw devices: "
-			        "Failed to get interface number for '%s'",
-			        sysfs_path);
-			goto next;
-		}
-
-		if (bus_type == HIDRAW_BUS_BLUETOOTH) {
-			ret = p_dev_get_bluetooth_dev(p, bluetooth_id, vendor_id, product_id, product_name, &pdev);
-		} else if (bus_type == HIDRAW_BUS_USB) {
-			ret = p_dev_get_usb_dev(p, usb_bus, usb_addr, vendor_id, product_id, &pdev);
+		p_udev_add_v4l(pdev, r->v4l_index, r->interface, r->dev_path);
+		break;
+
+	case P_UDEV_RECORD_HIDRAW:
+		if (r->bus_type == HIDRAW_BUS_BLUETOOTH) {
+			ret = p_dev_get_bluetooth_dev(p, r->bluetooth_id, r->vendor_id, r->product_id, r->product_name,
+			                              &pdev);
+		} else if (r->bus_type == HIDRAW_BUS_USB) {
+			ret = p_dev_get_usb_dev(p, r->usb_bus, r->usb_addr, r->vendor_id, r->product_id, &pdev);
 		} else {
 			// Right now only support USB & Bluetooth devices.
 			P_ERROR(p,
 			        "Ignoring none USB or Bluetooth hidraw device "
 			        "'%u'.",
-			        bus_type);
-			goto next;
+			        r->bus_type);
+			return;
 		}
 
 		P_TRACE(p,
@@ -465,27 +625,79 @@ p_udev_enumerate_hidraw(struct prober *p, struct udev *udev)
 		        "\t\tusb_bus:      %i\n"
 		        "\t\tusb_addr:     %i\n"
 		        "\t\tbluetooth_id: %012" PRIx64,
-		        (void *)pdev, ret, sysfs_path, dev_path, bus_type, vendor_id, product_id, product_name,
-		        interface, usb_bus, usb_addr, bluetooth_id);
+		        (void *)pdev, ret, r->sysfs_path, r->dev_path, r->bus_type, r->vendor_id, r->product_id,
+		        r->product_name, r->interface, r->usb_bus, r->usb_addr, r->bluetooth_id);
 
 		if (ret != 0) {
 			P_ERROR(p, "p_dev_get_usb_device failed!");
-			goto next;
+			return;
 		}
 
 		// Add this interface to the usb device.
-		p_udev_add_hidraw(pdev, interface, dev_path);
+		p_udev_add_hidraw(pdev, r->interface, r->dev_path);
+		break;
+	}
+}
 
-	next:
-		udev_device_unref(raw_dev);
+static void
+p_udev_add_usb(struct prober_device *pdev,
+               uint8_t dev_class,
+               const char *product,
+               const char *manufacturer,
+               const char *serial,
+               const char *path)
+{
+	// Already added, the first scan or hotplug event wins.
+	if (pdev->usb.path != NULL) {
+		return;
 	}
 
-	udev_enumerate_unref(enumerate);
+	pdev->base.usb_dev_class = dev_class;
+
+	if (product != NULL) {
+		pdev->usb.product = strdup(product);
+	}
+	if (manufacturer != NULL) {
+		pdev->usb.manufacturer = strdup(manufacturer);
+	}
+	if (serial != NULL) {
+		pdev->usb.serial = strdup(serial);
+	}
+	if (path != NULL) {
+		pdev->usb.path = strdup(path);
+	}
+}
+
+static void
+p_udev_add_v4l(struct prober_device *pdev, uint32_t v4l_index, uint32_t usb_iface, const char *path)
+{
+#ifdef XRT_HAVE_V4L2
+	for (size_t i = 0; i < pdev->num_v4ls; i++) {
+		if (strcmp(pdev->v4ls[i].path, path) == 0) {
+			return;
+		}
+	}
+
+	U_ARRAY_REALLOC_OR_FREE(pdev->v4ls, struct prober_v4l, (pdev->num_v4ls + 1));
+
+	struct prober_v4l *v4l = &pdev->v4ls[pdev->num_v4ls++];
+	U_ZERO(v4l);
+
+	v4l->usb_iface = usb_iface;
+	v4l->v4l_index = v4l_index;
+	v4l->path = strdup(path);
+#endif
 }
 
 static void
 p_udev_add_hidraw(struct prober_device *pdev, uint32_t interface, const char *path)
 {
+	for (size_t i = 0; i < pdev->num_hidraws; i++) {
+		if (strcmp(pdev->hidraws[i].path, path) == 0) {
+			return;
+		}
+	}
+
 	U_ARRAY_REALLOC_OR_FREE(pdev->hidraws, struct prober_hidraw, (pdev->num_hidraws + 1));
 
 	struct prober_hidraw *hidraw = &pdev->hidraws[pdev->num_hidraws++];
@@ -0,0 +1,112 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Runs the camera calibration on saved images, for benchmarking.
+ */
+
+#include "xrt/xrt_compiler.h"
+#include "xrt/xrt_config_have.h"
+#include "xrt/xrt_frame.h"
+
+#include "os/os_time.h"
+#include "util/u_frame.h"
+
+#include "cli_common.h"
+
+#ifdef XRT_HAVE_OPENCV
+#include "tracking/t_tracking.h"
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define P(...) fprintf(stderr, __VA_ARGS__)
+
+
+#ifdef XRT_HAVE_OPENCV
+static void
+discard_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
+{
+	// The calibration always wants somewhere to send its gui frames.
+}
+#endif
+
+int
+cli_cmd_calibration_replay(int argc, const char **argv)
+{
+#ifdef XRT_HAVE_OPENCV
+	if (argc < 5) {
+		P("Runs the calibration on images saved by it, from the current directory.\n");
+		P("Usage: %s %s <width> <height> <num_images> [mono] [fisheye] [incremental]\n", argv[0], argv[1]);
+		return 1;
+	}
+
+	struct t_calibration_params params;
+	t_calibration_gui_params_default(&params);
+	params.load.enabled = true;
+	params.load.num_images = atoi(argv[4]);
+	params.num_collect_total = params.load.num_images;
+	params.save_images = false;
+
+	for (int i = 5; i < argc; i++) {
+		if (strcmp(argv[i], "mono") == 0) {
+			params.stereo_sbs = false;
+		} else if (strcmp(argv[i], "fisheye") == 0) {
+			params.use_fisheye = true;
+		} else if (strcmp(argv[i], "incremental") == 0) {
+			params.incremental.enabled = true;
+		} else {
+			P("Unknown option '%s'\n", argv[i]);
+			return 1;
+		}
+	}
+
+	uint32_t width = (uint32_t)atoi(argv[2]);
+	uint32_t height = (uint32_t)atoi(argv[3]);
+	if (width == 0 || height == 0 || params.load.num_images <= 0) {
+		P("Bad size or number of images\n");
+		return 1;
+	}
+
+	struct xrt_frame_context xfctx = {0};
+	struct xrt_frame_sink gui = {discard_frame};
+	struct t_calibration_status status = {0};
+	struct xrt_frame_sink *sink = NULL;
+
+	if (t_calibration_stereo_create(&xfctx, &params, &status, &gui, &sink) != 0) {
+		P("Failed to create calibration!\n");
+		xrt_frame_context_destroy_nodes(&xfctx);
+		return 1;
+	}
+
+	// The first frame triggers the loading, its size selects the images.
+	struct xrt_frame *xf = NULL;
+	u_frame_create_one_off(XRT_FORMAT_L8, width, height, &xf);
+
+	uint64_t start_ns = os_monotonic_get_ns();
+	xrt_sink_push_frame(sink, xf);
+	uint64_t end_ns = os_monotonic_get_ns();
+
+	xrt_frame_reference(&xf, NULL);
+
+	P("Collected %i of %i samples in %.1f ms\n", status.num_collected, params.load.num_images,
+	  time_ns_to_ms_f((time_duration_ns)(end_ns - start_ns)));
+	if (params.incremental.enabled) {
+		P("Incremental: rp_error %f, coverage %.0f%%, %s\n", status.rp_error, status.coverage * 100.0f,
+		  status.converged ? "converged" : "not converged");
+	}
+	P("Calibration %s\n", status.finished ? "finished" : "not finished");
+
+	int ret = status.finished ? 0 : 1;
+
+	xrt_frame_context_destroy_nodes(&xfctx);
+	t_stereo_camera_calibration_reference(&status.stereo_data, NULL);
+
+	return ret;
+#else
+	P("Not compiled with XRT_HAVE_OPENCV, so can't calibrate!\n");
+	return 1;
+#endif
+}
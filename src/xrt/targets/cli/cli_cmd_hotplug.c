@@ -0,0 +1,78 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Probes and then prints devices as they are plugged in and out.
+ */
+
+#include "xrt/xrt_prober.h"
+#include "xrt/xrt_instance.h"
+
+#include "cli_common.h"
+
+#include <stdio.h>
+
+
+static int
+do_exit(struct xrt_instance **xi_ptr, int ret)
+{
+	xrt_instance_destroy(xi_ptr);
+
+	printf(" :: Exiting '%i'\n", ret);
+
+	return ret;
+}
+
+static void
+hotplug_cb(struct xrt_prober *xp, enum xrt_prober_hotplug_event event, struct xrt_prober_device *xpdev, void *ptr)
+{
+	unsigned char product[256] = {0};
+	if (event == XRT_PROBER_HOTPLUG_ADDED) {
+		xrt_prober_get_string_descriptor(xp, xpdev, XRT_PROBER_STRING_PRODUCT, product, sizeof(product) - 1);
+	}
+
+	printf("\t%s %04x:%04x %s\n", event == XRT_PROBER_HOTPLUG_ADDED ? "added  " : "removed", xpdev->vendor_id,
+	       xpdev->product_id, (const char *)product);
+	fflush(stdout);
+}
+
+int
+cli_cmd_hotplug(int argc, const char **argv)
+{
+	struct xrt_instance *xi = NULL;
+	xrt_result_t xret = XRT_SUCCESS;
+
+	printf(" :: Creating instance!\n");
+
+	int ret = xrt_instance_create(NULL, &xi);
+	if (ret != 0) {
+		return do_exit(&xi, 0);
+	}
+
+	struct xrt_prober *xp = NULL;
+	xret = xrt_instance_get_prober(xi, &xp);
+	if (xret != XRT_SUCCESS || xp == NULL) {
+		printf("\tNo xrt_prober could be created!\n");
+		return do_exit(&xi, -1);
+	}
+
+	printf(" :: Probing!\n");
+
+	xret = xrt_prober_probe(xp);
+	if (xret != XRT_SUCCESS) {
+		return do_exit(&xi, -1);
+	}
+
+	xret = xrt_prober_add_hotplug_listener(xp, hotplug_cb, NULL);
+	if (xret != XRT_SUCCESS) {
+		printf("\tCould not start hotplug monitoring! '%i'\n", xret);
+		return do_exit(&xi, -1);
+	}
+
+	printf(" :: Waiting for devices, press enter to stop.\n");
+	getchar();
+
+	xrt_prober_remove_hotplug_listener(xp, hotplug_cb, NULL);
+
+	return do_exit(&xi, 0);
+}
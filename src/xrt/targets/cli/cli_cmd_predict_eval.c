@@ -0,0 +1,226 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Replays a recorded pose stream and reports the prediction error of
+ *         the motion models per horizon.
+ */
+
+#include "xrt/xrt_defines.h"
+
+#include "math/m_api.h"
+#include "math/m_mathinclude.h"
+#include "math/m_predict.h"
+#include "math/m_relation_history.h"
+#include "math/m_vec3.h"
+
+#include "util/u_time.h"
+
+#include "cli_common.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define P(...) fprintf(stderr, __VA_ARGS__)
+
+static const uint32_t horizons_ms[] = {10, 20, 30, 40, 50};
+#define HORIZON_COUNT (sizeof(horizons_ms) / sizeof(horizons_ms[0]))
+
+struct pose_stream
+{
+	uint64_t *timestamps;
+	struct xrt_pose *poses;
+	uint32_t count;
+};
+
+/*!
+ * Reads a EuRoC style ground truth file, as written by the EuRoC recorder:
+ * timestamp in ns, position x, y, z and orientation w, x, y, z per line.
+ */
+static bool
+load_pose_stream(const char *path, struct pose_stream *out_stream)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		P("Could not open '%s'\n", path);
+		return false;
+	}
+
+	uint32_t capacity = 0;
+	char line[1024];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		if (line[0] == '#') {
+			continue;
+		}
+
+		uint64_t ts;
+		struct xrt_pose pose;
+		int ret = sscanf(line, "%" SCNu64 ",%f,%f,%f,%f,%f,%f,%f", &ts, &pose.position.x, &pose.position.y,
+		                 &pose.position.z, &pose.orientation.w, &pose.orientation.x, &pose.orientation.y,
+		                 &pose.orientation.z);
+		if (ret != 8) {
+			continue;
+		}
+
+		if (out_stream->count == capacity) {
+			capacity = capacity == 0 ? 1024 : capacity * 2;
+			out_stream->timestamps = realloc(out_stream->timestamps, capacity * sizeof(uint64_t));
+			out_stream->poses = realloc(out_stream->poses, capacity * sizeof(struct xrt_pose));
+		}
+
+		math_quat_normalize(&pose.orientation);
+		out_stream->timestamps[out_stream->count] = ts;
+		out_stream->poses[out_stream->count] = pose;
+		out_stream->count++;
+	}
+
+	fclose(file);
+	return true;
+}
+
+static float
+angle_between(const struct xrt_quat *a, const struct xrt_quat *b)
+{
+	float dot = fabsf(a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w);
+	return 2.0f * acosf(fminf(dot, 1.0f));
+}
+
+/*!
+ * Pushes the stream through a history the way the drivers do, velocities from
+ * the difference to the previous pose, and predicts from the newest entry.
+ */
+static void
+evaluate_model(const struct pose_stream *stream,
+               const struct m_predict_params *params,
+               struct m_relation_history *truth,
+               double out_position_mm[HORIZON_COUNT],
+               double out_angle_deg[HORIZON_COUNT])
+{
+	struct m_relation_history *rh = NULL;
+	m_relation_history_create_with_capacity(&rh, 256, M_RELATION_HISTORY_ENCODING_FULL);
+	m_relation_history_set_predict_params(rh, params);
+
+	uint32_t counts[HORIZON_COUNT] = {0};
+	for (uint32_t h = 0; h < HORIZON_COUNT; h++) {
+		out_position_mm[h] = 0;
+		out_angle_deg[h] = 0;
+	}
+
+	uint64_t last_ts = stream->timestamps[stream->count - 1];
+
+	for (uint32_t i = 0; i < stream->count; i++) {
+		uint64_t ts = stream->timestamps[i];
+
+		struct xrt_space_relation in = XRT_SPACE_RELATION_ZERO;
+		in.pose = stream->poses[i];
+		in.relation_flags = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_POSITION_VALID_BIT;
+
+		struct xrt_space_relation rel = XRT_SPACE_RELATION_ZERO;
+		if (!m_relation_history_estimate_motion(rh, &in, ts, &rel)) {
+			rel = in;
+		}
+		if (!m_relation_history_push(rh, &rel, ts)) {
+			continue;
+		}
+
+		for (uint32_t h = 0; h < HORIZON_COUNT; h++) {
+			uint64_t when = ts + horizons_ms[h] * (uint64_t)U_TIME_1MS_IN_NS;
+			if (when > last_ts) {
+				continue;
+			}
+
+			struct xrt_space_relation expected;
+			struct xrt_space_relation predicted;
+			m_relation_history_get(truth, when, &expected);
+			if (m_relation_history_get(rh, when, &predicted) != M_RELATION_HISTORY_RESULT_PREDICTED) {
+				continue;
+			}
+
+			struct xrt_vec3 d = m_vec3_sub(predicted.pose.position, expected.pose.position);
+			out_position_mm[h] += m_vec3_len(d) * 1000.0;
+			out_angle_deg[h] += angle_between(&predicted.pose.orientation, &expected.pose.orientation) *
+			                    (180.0 / M_PI);
+			counts[h]++;
+		}
+	}
+
+	for (uint32_t h = 0; h < HORIZON_COUNT; h++) {
+		if (counts[h] > 0) {
+			out_position_mm[h] /= counts[h];
+			out_angle_deg[h] /= counts[h];
+		}
+	}
+
+	m_relation_history_destroy(&rh);
+}
+
+int
+cli_cmd_predict_eval(int argc, const char **argv)
+{
+	if (argc < 3) {
+		P("Replays a pose stream and prints the mean prediction error of the models.\n");
+		P("Usage: %s %s <gt.csv> [model[:value]]...\n", argv[0], argv[1]);
+		P("The file is in the EuRoC ground truth format, models are velocity, acceleration,\n");
+		P("damped and polynomial, all of them if none are given.\n");
+		return 1;
+	}
+
+	struct pose_stream stream = {0};
+	if (!load_pose_stream(argv[2], &stream) || stream.count < 2) {
+		P("No poses in '%s'\n", argv[2]);
+		free(stream.timestamps);
+		free(stream.poses);
+		return 1;
+	}
+
+	const char *default_models[] = {"velocity", "acceleration", "damped", "polynomial"};
+	const char **models = argc > 3 ? &argv[3] : default_models;
+	int model_count = argc > 3 ? argc - 3 : (int)(sizeof(default_models) / sizeof(default_models[0]));
+
+	// The recorded poses, looked up between samples for the ground truth.
+	struct m_relation_history *truth = NULL;
+	m_relation_history_create_with_capacity(&truth, stream.count, M_RELATION_HISTORY_ENCODING_FULL);
+	for (uint32_t i = 0; i < stream.count; i++) {
+		struct xrt_space_relation rel = XRT_SPACE_RELATION_ZERO;
+		rel.pose = stream.poses[i];
+		rel.relation_flags = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_POSITION_VALID_BIT;
+		m_relation_history_push(truth, &rel, stream.timestamps[i]);
+	}
+
+	uint64_t duration_ns = stream.timestamps[stream.count - 1] - stream.timestamps[0];
+	double duration_s = time_ns_to_s((time_duration_ns)duration_ns);
+	printf("%u poses over %.1f s, mean error in mm / degrees\n", stream.count, duration_s);
+	printf("%-16s", "model");
+	for (uint32_t h = 0; h < HORIZON_COUNT; h++) {
+		printf("  %11u ms", horizons_ms[h]);
+	}
+	printf("\n");
+
+	int ret = 0;
+	for (int m = 0; m < model_count; m++) {
+		struct m_predict_params params;
+		m_predict_params_default(&params);
+		if (!m_predict_params_from_string(models[m], &params)) {
+			P("Unknown model '%s'\n", models[m]);
+			ret = 1;
+			continue;
+		}
+
+		double position_mm[HORIZON_COUNT];
+		double angle_deg[HORIZON_COUNT];
+		evaluate_model(&stream, &params, truth, position_mm, angle_deg);
+
+		printf("%-16s", models[m]);
+		for (uint32_t h = 0; h < HORIZON_COUNT; h++) {
+			printf("  %6.2f / %5.2f", position_mm[h], angle_deg[h]);
+		}
+		printf("\n");
+	}
+
+	m_relation_history_destroy(&truth);
+	free(stream.timestamps);
+	free(stream.poses);
+
+	return ret;
+}
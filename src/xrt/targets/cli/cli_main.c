@@ -30,10 +30,13 @@ cli_print_help(int argc, const char **argv)
 	P("  info       - Print information about Monado and the system, for bug reporting.\n");
 	P("  test       - List found devices, for prober testing.\n");
 	P("  probe      - Just probe and then exit.\n");
+	P("  hotplug    - Probe and then print devices as they are plugged in and out.\n");
 	P("  lighthouse - Control the power of lighthouses [on|off].\n");
 	P("  calibrate  - Calibrate a camera and save config (not implemented yet).\n");
 	P("  calib-dumb - Load and dump a calibration to stdout.\n");
+	P("  calib-replay - Run the calibration on saved images and time it.\n");
 	P("  slambatch  - Runs a sequence of EuRoC datasets with the SLAM tracker.\n");
+	P("  predict-eval - Replay a recorded pose stream and report prediction errors.\n");
 
 	return 1;
 }
@@ -54,6 +57,9 @@ main(int argc, const char **argv)
 	if (strcmp(argv[1], "probe") == 0) {
 		return cli_cmd_probe(argc, argv);
 	}
+	if (strcmp(argv[1], "hotplug") == 0) {
+		return cli_cmd_hotplug(argc, argv);
+	}
 #ifndef XRT_OS_WINDOWS
 	if (strcmp(argv[1], "calibrate") == 0) {
 		return cli_cmd_calibrate(argc, argv);
@@ -62,11 +68,17 @@ main(int argc, const char **argv)
 	if (strcmp(argv[1], "calib-dump") == 0) {
 		return cli_cmd_calibration_dump(argc, argv);
 	}
+	if (strcmp(argv[1], "calib-replay") == 0) {
+		return cli_cmd_calibration_replay(argc, argv);
+	}
 	if (strcmp(argv[1], "lighthouse") == 0) {
 		return cli_cmd_lighthouse(argc, argv);
 	}
 	if (strcmp(argv[1], "slambatch") == 0) {
 		return cli_cmd_slambatch(argc, argv);
 	}
+	if (strcmp(argv[1], "predict-eval") == 0) {
+		return cli_cmd_predict_eval(argc, argv);
+	}
 	return cli_print_help(argc, argv);
 }
@@ -43,6 +43,10 @@
 #define T_BUILDER_RGB_TRACKING
 #endif
 
+#if defined(XRT_BUILD_DRIVER_REPLAY) || defined(XRT_DOXYGEN)
+#define T_BUILDER_REPLAY
+#endif
+
 #if defined(XRT_BUILD_DRIVER_SIMULATED) || defined(XRT_DOXYGEN)
 #define T_BUILDER_SIMULATED
 #endif
@@ -118,6 +122,14 @@ struct xrt_builder *
 t_builder_rgb_tracking_create(void);
 #endif
 
+#ifdef T_BUILDER_REPLAY
+/*!
+ * Builder for @ref drv_replay devices, selected by XRT_DEVICE_REPLAY_FILE.
+ */
+struct xrt_builder *
+t_builder_replay_create(void);
+#endif
+
 #ifdef T_BUILDER_SIMULATED
 /*!
  * Builder for @ref drv_simulated devices.
@@ -0,0 +1,158 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Builder for replaying recorded device streams.
+ * @ingroup xrt_iface
+ */
+
+#include "xrt/xrt_config_drivers.h"
+#include "xrt/xrt_prober.h"
+
+#include "os/os_time.h"
+
+#include "util/u_misc.h"
+#include "util/u_debug.h"
+#include "util/u_builders.h"
+#include "util/u_system_helpers.h"
+
+#include "target_builder_interface.h"
+
+#include "replay/replay_interface.h"
+
+#include <assert.h>
+
+
+#ifndef XRT_BUILD_DRIVER_REPLAY
+#error "Must only be built with XRT_BUILD_DRIVER_REPLAY set"
+#endif
+
+DEBUG_GET_ONCE_OPTION(device_replay_file, "XRT_DEVICE_REPLAY_FILE", NULL)
+
+
+/*
+ *
+ * Helper functions.
+ *
+ */
+
+static const char *driver_list[] = {
+    "replay",
+};
+
+static struct xrt_device *
+role_device(struct xrt_system_devices *xsysd, int32_t index)
+{
+	if (index < 0 || (uint32_t)index >= xsysd->xdev_count) {
+		return NULL;
+	}
+
+	return xsysd->xdevs[index];
+}
+
+
+/*
+ *
+ * Member functions.
+ *
+ */
+
+static xrt_result_t
+replay_estimate_system(struct xrt_builder *xb,
+                       cJSON *config,
+                       struct xrt_prober *xp,
+                       struct xrt_builder_estimate *estimate)
+{
+	bool have_file = debug_get_option_device_replay_file() != NULL;
+
+	estimate->certain.head = have_file;
+	estimate->certain.left = have_file;
+	estimate->certain.right = have_file;
+	estimate->priority = -50;
+
+	return XRT_SUCCESS;
+}
+
+static xrt_result_t
+replay_open_system_impl(struct xrt_builder *xb,
+                        cJSON *config,
+                        struct xrt_prober *xp,
+                        struct xrt_tracking_origin *origin,
+                        struct xrt_system_devices *xsysd,
+                        struct xrt_frame_context *xfctx,
+                        struct u_builder_roles_helper *ubrh)
+{
+	const char *path = debug_get_option_device_replay_file();
+	if (path == NULL) {
+		U_LOG_E("XRT_DEVICE_REPLAY_FILE not set");
+		return XRT_ERROR_DEVICE_CREATION_FAILED;
+	}
+
+	struct u_device_recorder_roles roles;
+	uint32_t xdev_count = 0;
+
+	xrt_result_t xret = replay_create_devices( //
+	    path,                                  // path
+	    (int64_t)os_monotonic_get_ns(),        // start_ns
+	    origin,                                // origin
+	    xsysd->xdevs,                          // out_xdevs
+	    ARRAY_SIZE(xsysd->xdevs),              // max_xdev_count
+	    &xdev_count,                           // out_xdev_count
+	    &roles);                               // out_roles
+	if (xret != XRT_SUCCESS) {
+		return xret;
+	}
+
+	xsysd->xdev_count = xdev_count;
+
+	// Any other then none, the recorded poses are already in place.
+	origin->type = XRT_TRACKING_TYPE_OTHER;
+
+	// Assign to role(s).
+	ubrh->head = role_device(xsysd, roles.head);
+	ubrh->left = role_device(xsysd, roles.left);
+	ubrh->right = role_device(xsysd, roles.right);
+	ubrh->hand_tracking.left = role_device(xsysd, roles.hand_tracking_left);
+	ubrh->hand_tracking.right = role_device(xsysd, roles.hand_tracking_right);
+
+	if (ubrh->head == NULL) {
+		U_LOG_E("Recording '%s' has no head device", path);
+		return XRT_ERROR_DEVICE_CREATION_FAILED;
+	}
+
+	return XRT_SUCCESS;
+}
+
+static void
+replay_destroy(struct xrt_builder *xb)
+{
+	free(xb);
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+struct xrt_builder *
+t_builder_replay_create(void)
+{
+	struct u_builder *ub = U_TYPED_CALLOC(struct u_builder);
+
+	// xrt_builder fields.
+	ub->base.estimate_system = replay_estimate_system;
+	ub->base.open_system = u_builder_open_system_static_roles;
+	ub->base.destroy = replay_destroy;
+	ub->base.identifier = "replay";
+	ub->base.name = "Recorded devices replay builder";
+	ub->base.driver_identifiers = driver_list;
+	ub->base.driver_identifier_count = ARRAY_SIZE(driver_list);
+	ub->base.exclude_from_automatic_discovery = debug_get_option_device_replay_file() == NULL;
+
+	// u_builder fields.
+	ub->open_system_static_roles = replay_open_system_impl;
+
+	return &ub->base;
+}
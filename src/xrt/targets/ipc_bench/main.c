@@ -0,0 +1,562 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Headless synthetic load generator for the IPC service.
+ * @ingroup ipc
+ *
+ * Launches monado-service with the simulated driver and the null compositor
+ * in a private runtime directory, then forks a number of synthetic clients
+ * that each run a scripted frame loop over IPC. Every IPC call is timed and
+ * reported as percentiles, together with the frame rate of each client and
+ * the CPU time the service used.
+ */
+
+#include "xrt/xrt_instance.h"
+#include "xrt/xrt_system.h"
+#include "xrt/xrt_session.h"
+#include "xrt/xrt_compositor.h"
+#include "xrt/xrt_space.h"
+#include "xrt/xrt_device.h"
+
+#include "os/os_time.h"
+
+#include "util/u_misc.h"
+#include "util/u_time.h"
+#include "util/u_logging.h"
+
+#include "client/ipc_client_interface.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+
+#define P(...) fprintf(stdout, __VA_ARGS__)
+#define PE(...) fprintf(stderr, __VA_ARGS__)
+
+#define MAX_CLIENTS (64)
+#define MAX_LAYERS (16)
+
+enum bench_call
+{
+	BENCH_CALL_POLL_EVENTS,
+	BENCH_CALL_WAIT_FRAME,
+	BENCH_CALL_BEGIN_FRAME,
+	BENCH_CALL_SWAPCHAIN,
+	BENCH_CALL_LAYER_COMMIT,
+	BENCH_CALL_UPDATE_INPUTS,
+	BENCH_CALL_LOCATE,
+	BENCH_CALL_COUNT,
+};
+
+static const char *call_names[BENCH_CALL_COUNT] = {
+    "poll_events", "wait_frame", "begin_frame", "swapchain", "layer_commit", "update_inputs", "locate",
+};
+
+struct bench_config
+{
+	uint32_t client_count;
+	uint32_t frame_count;
+	uint32_t layer_count;
+	uint32_t action_count;
+	uint32_t locate_count;
+	const char *service;
+};
+
+struct bench_percentiles
+{
+	uint64_t count;
+	uint64_t p50_ns;
+	uint64_t p90_ns;
+	uint64_t p99_ns;
+	uint64_t max_ns;
+};
+
+//! Sent from each client process to the parent over a pipe.
+struct bench_result
+{
+	int32_t error;
+	uint32_t frames;
+	uint64_t elapsed_ns;
+	struct bench_percentiles calls[BENCH_CALL_COUNT];
+};
+
+struct bench_samples
+{
+	uint64_t *values;
+	size_t count;
+	size_t capacity;
+};
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static void
+samples_push(struct bench_samples *s, uint64_t value)
+{
+	if (s->count >= s->capacity) {
+		s->capacity = s->capacity == 0 ? 1024 : s->capacity * 2;
+		U_ARRAY_REALLOC_OR_FREE(s->values, uint64_t, s->capacity);
+		if (s->values == NULL) {
+			s->count = s->capacity = 0;
+			return;
+		}
+	}
+
+	s->values[s->count++] = value;
+}
+
+static int
+compare_u64(const void *a, const void *b)
+{
+	uint64_t va = *(const uint64_t *)a;
+	uint64_t vb = *(const uint64_t *)b;
+	return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+static void
+samples_to_percentiles(struct bench_samples *s, struct bench_percentiles *out)
+{
+	U_ZERO(out);
+	if (s->count == 0) {
+		return;
+	}
+
+	qsort(s->values, s->count, sizeof(*s->values), compare_u64);
+
+	out->count = s->count;
+	out->p50_ns = s->values[(s->count * 50) / 100];
+	out->p90_ns = s->values[(s->count * 90) / 100];
+	out->p99_ns = s->values[(s->count * 99) / 100];
+	out->max_ns = s->values[s->count - 1];
+}
+
+#define TIMED(SAMPLES, XRET, CALL)                                                                                     \
+	do {                                                                                                           \
+		uint64_t start_ns_ = os_monotonic_get_ns();                                                            \
+		XRET = CALL;                                                                                           \
+		samples_push(SAMPLES, os_monotonic_get_ns() - start_ns_);                                              \
+	} while (false)
+
+#define CHECK_XRET(XRET, WHAT)                                                                                         \
+	do {                                                                                                           \
+		if ((XRET) != XRT_SUCCESS) {                                                                           \
+			PE("Client %u: %s failed: %d\n", index, WHAT, (int)(XRET));                                    \
+			ret = -1;                                                                                      \
+			goto out;                                                                                      \
+		}                                                                                                      \
+	} while (false)
+
+
+/*
+ *
+ * Client.
+ *
+ */
+
+static xrt_result_t
+connect_with_retry(uint32_t index, struct xrt_instance **out_xinst)
+{
+	struct xrt_instance_info info = {0};
+	snprintf(info.application_name, sizeof(info.application_name), "monado-ipc-bench-%u", index);
+
+	// The service needs a moment to create its socket.
+	xrt_result_t xret = XRT_ERROR_IPC_FAILURE;
+	for (int i = 0; i < 100 && xret != XRT_SUCCESS; i++) {
+		xret = ipc_instance_create(&info, out_xinst);
+		if (xret != XRT_SUCCESS) {
+			os_nanosleep(50 * U_TIME_1MS_IN_NS);
+		}
+	}
+
+	return xret;
+}
+
+static void
+drain_events(struct xrt_session *xs, struct bench_samples *samples)
+{
+	union xrt_session_event xse;
+	xrt_result_t xret;
+	do {
+		U_ZERO(&xse);
+		TIMED(samples, xret, xrt_session_poll_events(xs, &xse));
+		if (xret != XRT_SUCCESS) {
+			return;
+		}
+	} while (xse.type != XRT_SESSION_EVENT_NONE);
+}
+
+static int
+run_client(const struct bench_config *cfg, uint32_t index, struct bench_result *out_result)
+{
+	struct bench_samples samples[BENCH_CALL_COUNT] = {0};
+	struct xrt_instance *xinst = NULL;
+	struct xrt_system *xsys = NULL;
+	struct xrt_system_devices *xsysd = NULL;
+	struct xrt_space_overseer *xso = NULL;
+	struct xrt_system_compositor *xsysc = NULL;
+	struct xrt_session *xs = NULL;
+	struct xrt_compositor_native *xcn = NULL;
+	struct xrt_swapchain *xscs[MAX_LAYERS] = {0};
+	uint32_t layer_count = cfg->layer_count;
+	xrt_result_t xret;
+	int ret = 0;
+
+	xret = connect_with_retry(index, &xinst);
+	CHECK_XRET(xret, "ipc_instance_create");
+
+	xret = xrt_instance_create_system(xinst, &xsys, &xsysd, &xso, &xsysc);
+	CHECK_XRET(xret, "xrt_instance_create_system");
+
+	struct xrt_device *head = xsysd->static_roles.head;
+	if (head == NULL || xsysd->xdev_count == 0) {
+		PE("Client %u: No head device\n", index);
+		ret = -1;
+		goto out;
+	}
+
+	struct xrt_session_info xsi = {0};
+	xret = xrt_system_create_session(xsys, &xsi, &xs, &xcn);
+	CHECK_XRET(xret, "xrt_system_create_session");
+
+	struct xrt_compositor *xc = &xcn->base;
+
+	/*
+	 * One stereo swapchain shared by both views of the projection layer,
+	 * each of the other layers gets its own quad swapchain.
+	 */
+	for (uint32_t i = 0; i < layer_count; i++) {
+		struct xrt_swapchain_create_info info = {
+		    .bits = XRT_SWAPCHAIN_USAGE_COLOR | XRT_SWAPCHAIN_USAGE_SAMPLED,
+		    .format = (uint32_t)xc->info.formats[0],
+		    .sample_count = 1,
+		    .width = i == 0 ? 1024 : 256,
+		    .height = i == 0 ? 1024 : 256,
+		    .face_count = 1,
+		    .array_size = i == 0 ? 2 : 1,
+		    .mip_count = 1,
+		};
+		xret = xrt_comp_create_swapchain(xc, &info, &xscs[i]);
+		CHECK_XRET(xret, "xrt_comp_create_swapchain");
+	}
+
+	struct xrt_begin_session_info begin_info = {.view_type = XRT_VIEW_TYPE_STEREO};
+	xret = xrt_comp_begin_session(xc, &begin_info);
+	CHECK_XRET(xret, "xrt_comp_begin_session");
+
+	uint64_t start_ns = os_monotonic_get_ns();
+	uint32_t frames = 0;
+
+	for (; frames < cfg->frame_count; frames++) {
+		drain_events(xs, &samples[BENCH_CALL_POLL_EVENTS]);
+
+		int64_t frame_id = -1;
+		uint64_t display_time_ns = 0;
+		uint64_t period_ns = 0;
+		TIMED(&samples[BENCH_CALL_WAIT_FRAME], xret,
+		      xrt_comp_wait_frame(xc, &frame_id, &display_time_ns, &period_ns));
+		CHECK_XRET(xret, "xrt_comp_wait_frame");
+
+		// What xrSyncActions does, one update per action set.
+		for (uint32_t i = 0; i < cfg->action_count; i++) {
+			struct xrt_device *xdev = xsysd->xdevs[i % xsysd->xdev_count];
+			uint64_t update_start_ns = os_monotonic_get_ns();
+			xrt_device_update_inputs(xdev);
+			samples_push(&samples[BENCH_CALL_UPDATE_INPUTS], os_monotonic_get_ns() - update_start_ns);
+		}
+
+		for (uint32_t i = 0; i < cfg->locate_count; i++) {
+			struct xrt_device *xdev = xsysd->xdevs[i % xsysd->xdev_count];
+			struct xrt_pose identity = XRT_POSE_IDENTITY;
+			struct xrt_space_relation rel;
+			TIMED(&samples[BENCH_CALL_LOCATE], xret,
+			      xrt_space_overseer_locate_device(xso, xso->semantic.root, &identity, display_time_ns, xdev,
+			                                       &rel));
+			CHECK_XRET(xret, "xrt_space_overseer_locate_device");
+		}
+
+		TIMED(&samples[BENCH_CALL_BEGIN_FRAME], xret, xrt_comp_begin_frame(xc, frame_id));
+		CHECK_XRET(xret, "xrt_comp_begin_frame");
+
+		uint32_t image_index[MAX_LAYERS] = {0};
+		for (uint32_t i = 0; i < layer_count; i++) {
+			TIMED(&samples[BENCH_CALL_SWAPCHAIN], xret, xrt_swapchain_acquire_image(xscs[i], &image_index[i]));
+			CHECK_XRET(xret, "xrt_swapchain_acquire_image");
+			TIMED(&samples[BENCH_CALL_SWAPCHAIN], xret,
+			      xrt_swapchain_wait_image(xscs[i], U_TIME_1S_IN_NS, image_index[i]));
+			CHECK_XRET(xret, "xrt_swapchain_wait_image");
+			TIMED(&samples[BENCH_CALL_SWAPCHAIN], xret, xrt_swapchain_release_image(xscs[i], image_index[i]));
+			CHECK_XRET(xret, "xrt_swapchain_release_image");
+		}
+
+		struct xrt_layer_frame_data frame_data = {
+		    .frame_id = frame_id,
+		    .display_time_ns = display_time_ns,
+		    .env_blend_mode = XRT_BLEND_MODE_OPAQUE,
+		};
+		xret = xrt_comp_layer_begin(xc, &frame_data);
+		CHECK_XRET(xret, "xrt_comp_layer_begin");
+
+		for (uint32_t i = 0; i < layer_count; i++) {
+			struct xrt_layer_data data = {
+			    .name = XRT_INPUT_GENERIC_HEAD_POSE,
+			    .timestamp = display_time_ns,
+			    .color_scale = {1.0f, 1.0f, 1.0f, 1.0f},
+			};
+
+			if (i == 0) {
+				struct xrt_swapchain *stereo[XRT_MAX_VIEWS] = {xscs[0], xscs[0]};
+				data.type = XRT_LAYER_PROJECTION;
+				data.view_count = 2;
+				for (uint32_t v = 0; v < 2; v++) {
+					data.proj.v[v].sub.image_index = image_index[0];
+					data.proj.v[v].sub.array_index = v;
+					data.proj.v[v].sub.rect.extent.w = 1024;
+					data.proj.v[v].sub.rect.extent.h = 1024;
+					data.proj.v[v].fov = (struct xrt_fov){-0.8f, 0.8f, 0.8f, -0.8f};
+					data.proj.v[v].pose = (struct xrt_pose)XRT_POSE_IDENTITY;
+				}
+				xret = xrt_comp_layer_projection(xc, head, stereo, &data);
+			} else {
+				data.type = XRT_LAYER_QUAD;
+				data.quad.visibility = XRT_LAYER_EYE_VISIBILITY_BOTH;
+				data.quad.sub.image_index = image_index[i];
+				data.quad.sub.rect.extent.w = 256;
+				data.quad.sub.rect.extent.h = 256;
+				data.quad.pose = (struct xrt_pose)XRT_POSE_IDENTITY;
+				data.quad.pose.position.z = -1.0f - 0.1f * (float)i;
+				data.quad.size = (struct xrt_vec2){0.2f, 0.2f};
+				xret = xrt_comp_layer_quad(xc, head, xscs[i], &data);
+			}
+			CHECK_XRET(xret, "xrt_comp_layer_*");
+		}
+
+		TIMED(&samples[BENCH_CALL_LAYER_COMMIT], xret, xrt_comp_layer_commit(xc, XRT_GRAPHICS_SYNC_HANDLE_INVALID));
+		CHECK_XRET(xret, "xrt_comp_layer_commit");
+	}
+
+	out_result->frames = frames;
+	out_result->elapsed_ns = os_monotonic_get_ns() - start_ns;
+
+	xrt_comp_end_session(xc);
+
+out:
+	for (uint32_t i = 0; i < BENCH_CALL_COUNT; i++) {
+		samples_to_percentiles(&samples[i], &out_result->calls[i]);
+		free(samples[i].values);
+	}
+
+	for (uint32_t i = 0; i < MAX_LAYERS; i++) {
+		xrt_swapchain_reference(&xscs[i], NULL);
+	}
+	xrt_comp_native_destroy(&xcn);
+	xrt_session_destroy(&xs);
+	xrt_syscomp_destroy(&xsysc);
+	xrt_space_overseer_destroy(&xso);
+	xrt_system_devices_destroy(&xsysd);
+	xrt_system_destroy(&xsys);
+	xrt_instance_destroy(&xinst);
+
+	out_result->error = ret;
+
+	return ret;
+}
+
+
+/*
+ *
+ * Parent.
+ *
+ */
+
+static pid_t
+launch_service(const struct bench_config *cfg)
+{
+	pid_t pid = fork();
+	if (pid != 0) {
+		return pid;
+	}
+
+	// Simulated devices and the null compositor, nothing that needs hardware.
+	setenv("SIMULATED_ENABLE", "1", 1);
+	setenv("XRT_COMPOSITOR_NULL", "1", 1);
+
+	execlp(cfg->service, cfg->service, (char *)NULL);
+
+	PE("Failed to launch '%s': %s\n", cfg->service, strerror(errno));
+	_exit(127);
+}
+
+static pid_t
+launch_client(const struct bench_config *cfg, uint32_t index, int *out_fd)
+{
+	int fds[2];
+	if (pipe(fds) != 0) {
+		return -1;
+	}
+
+	pid_t pid = fork();
+	if (pid != 0) {
+		close(fds[1]);
+		*out_fd = fds[0];
+		return pid;
+	}
+
+	close(fds[0]);
+
+	struct bench_result result = {0};
+	int ret = run_client(cfg, index, &result);
+
+	ssize_t written = write(fds[1], &result, sizeof(result));
+	close(fds[1]);
+
+	_exit(ret == 0 && written == (ssize_t)sizeof(result) ? 0 : 1);
+}
+
+static void
+print_result(uint32_t index, const struct bench_result *r)
+{
+	if (r->error != 0 || r->elapsed_ns == 0) {
+		P("client %u: failed\n", index);
+		return;
+	}
+
+	double seconds = (double)r->elapsed_ns / (double)U_TIME_1S_IN_NS;
+	P("client %u: %u frames in %.2fs, %.1f fps\n", index, r->frames, seconds, (double)r->frames / seconds);
+	P("\t%-14s %10s %10s %10s %10s %10s\n", "call (us)", "count", "p50", "p90", "p99", "max");
+
+	for (uint32_t i = 0; i < BENCH_CALL_COUNT; i++) {
+		const struct bench_percentiles *p = &r->calls[i];
+		if (p->count == 0) {
+			continue;
+		}
+		P("\t%-14s %10" PRIu64 " %10.1f %10.1f %10.1f %10.1f\n", call_names[i], p->count,
+		  (double)p->p50_ns / 1000.0, (double)p->p90_ns / 1000.0, (double)p->p99_ns / 1000.0,
+		  (double)p->max_ns / 1000.0);
+	}
+}
+
+static void
+print_usage(void)
+{
+	PE("Usage: monado-ipc-bench [options]\n");
+	PE("    -c, --clients <n>   Number of client processes (default 1, max %u)\n", MAX_CLIENTS);
+	PE("    -f, --frames <n>    Frames each client submits (default 600)\n");
+	PE("    -k, --layers <n>    Layers per frame, one projection then quads (default 1, max %u)\n", MAX_LAYERS);
+	PE("    -m, --actions <n>   Input updates per frame (default 4)\n");
+	PE("    -l, --locates <n>   Space locates per frame (default 4)\n");
+	PE("    -s, --service <cmd> Service to launch, needs the null compositor (default monado-service)\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench_config cfg = {
+	    .client_count = 1,
+	    .frame_count = 600,
+	    .layer_count = 1,
+	    .action_count = 4,
+	    .locate_count = 4,
+	    .service = "monado-service",
+	};
+
+	static const struct option options[] = {
+	    {"clients", required_argument, NULL, 'c'}, {"frames", required_argument, NULL, 'f'},
+	    {"layers", required_argument, NULL, 'k'},  {"actions", required_argument, NULL, 'm'},
+	    {"locates", required_argument, NULL, 'l'}, {"service", required_argument, NULL, 's'},
+	    {"help", no_argument, NULL, 'h'},          {0, 0, 0, 0},
+	};
+
+	int c;
+	while ((c = getopt_long(argc, argv, "c:f:k:m:l:s:h", options, NULL)) != -1) {
+		switch (c) {
+		case 'c': cfg.client_count = (uint32_t)atoi(optarg); break;
+		case 'f': cfg.frame_count = (uint32_t)atoi(optarg); break;
+		case 'k': cfg.layer_count = (uint32_t)atoi(optarg); break;
+		case 'm': cfg.action_count = (uint32_t)atoi(optarg); break;
+		case 'l': cfg.locate_count = (uint32_t)atoi(optarg); break;
+		case 's': cfg.service = optarg; break;
+		default: print_usage(); return c == 'h' ? 0 : 1;
+		}
+	}
+
+	if (cfg.client_count == 0 || cfg.client_count > MAX_CLIENTS || cfg.layer_count > MAX_LAYERS) {
+		print_usage();
+		return 1;
+	}
+
+	// Private runtime dir so we never talk to, or fight with, a running service.
+	char runtime_dir[] = "/tmp/monado-ipc-bench-XXXXXX";
+	if (mkdtemp(runtime_dir) == NULL) {
+		PE("mkdtemp failed: %s\n", strerror(errno));
+		return 1;
+	}
+	setenv("XDG_RUNTIME_DIR", runtime_dir, 1);
+
+	pid_t service = launch_service(&cfg);
+	if (service < 0) {
+		PE("fork failed: %s\n", strerror(errno));
+		return 1;
+	}
+
+	pid_t clients[MAX_CLIENTS];
+	int fds[MAX_CLIENTS];
+	uint32_t launched = 0;
+	for (; launched < cfg.client_count; launched++) {
+		clients[launched] = launch_client(&cfg, launched, &fds[launched]);
+		if (clients[launched] < 0) {
+			PE("Failed to launch client %u\n", launched);
+			break;
+		}
+	}
+
+	P("monado-ipc-bench: %u clients, %u frames, %u layers, %u actions, %u locates\n", launched, cfg.frame_count,
+	  cfg.layer_count, cfg.action_count, cfg.locate_count);
+
+	uint64_t start_ns = os_monotonic_get_ns();
+	int failed = 0;
+
+	for (uint32_t i = 0; i < launched; i++) {
+		struct bench_result result = {.error = -1};
+		ssize_t got = read(fds[i], &result, sizeof(result));
+		close(fds[i]);
+		waitpid(clients[i], NULL, 0);
+
+		if (got != (ssize_t)sizeof(result)) {
+			result.error = -1;
+		}
+		failed |= result.error != 0;
+
+		print_result(i, &result);
+	}
+
+	uint64_t wall_ns = os_monotonic_get_ns() - start_ns;
+
+	// Stop the service and collect how much CPU it used.
+	kill(service, SIGTERM);
+
+	int status = 0;
+	struct rusage usage = {0};
+	wait4(service, &status, 0, &usage);
+
+	double cpu_s = (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6 + //
+	               (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+	double wall_s = (double)wall_ns / (double)U_TIME_1S_IN_NS;
+	P("service: %.2fs CPU over %.2fs, %.1f%% of one core\n", cpu_s, wall_s, 100.0 * cpu_s / wall_s);
+
+	rmdir(runtime_dir);
+
+	return failed ? 1 : 0;
+}
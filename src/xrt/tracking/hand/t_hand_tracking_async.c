@@ -9,13 +9,13 @@
 
 #include "os/os_threading.h"
 
-#include "math/m_space.h"
-#include "math/m_relation_history.h"
+#include "math/m_hand_joint_history.h"
 
 #include "util/u_var.h"
 #include "util/u_misc.h"
 #include "util/u_debug.h"
 #include "util/u_logging.h"
+#include "util/u_time.h"
 #include "util/u_trace_marker.h"
 
 #include "tracking/t_hand_tracking.h"
@@ -51,7 +51,7 @@ struct ht_async_impl
 	{
 		struct os_mutex mutex;
 		struct xrt_hand_joint_set hands[2];
-		struct m_relation_history *relation_hist[2];
+		struct m_hand_joint_history *joint_hist[2];
 		uint64_t timestamp;
 	} present;
 
@@ -134,19 +134,10 @@ ht_async_mainloop(void *ptr)
 		os_mutex_unlock(&hta->present.mutex);
 
 		for (int i = 0; i < 2; i++) {
-			struct xrt_space_relation wrist_rel =
-			    hta->working.hands[i].values.hand_joint_set_default[XRT_HAND_JOINT_WRIST].relation;
-
-			m_relation_history_estimate_motion( //
-			    hta->present.relation_hist[i],  //
-			    &wrist_rel,                     //
-			    hta->working.timestamp,         //
-			    &wrist_rel);                    //
-
-			m_relation_history_push(           //
-			    hta->present.relation_hist[i], //
-			    &wrist_rel,                    //
-			    hta->working.timestamp);       //
+			m_hand_joint_history_push(      //
+			    hta->present.joint_hist[i], //
+			    &hta->working.hands[i],     //
+			    hta->working.timestamp);    //
 		}
 
 		hta->hand_tracking_work_active = false;
@@ -243,7 +234,7 @@ ht_async_destroy(struct xrt_frame_node *node)
 	t_ht_sync_destroy(&hta->provider);
 
 	for (int i = 0; i < 2; i++) {
-		m_relation_history_destroy(&hta->present.relation_hist[i]);
+		m_hand_joint_history_destroy(&hta->present.joint_hist[i]);
 	}
 
 	free(hta);
@@ -271,42 +262,20 @@ ht_async_get_hand(struct t_hand_tracking_async *ht_async,
 		idx = 1;
 	}
 
-	os_mutex_lock(&hta->present.mutex);
-
-	struct xrt_hand_joint_set latest_hand = hta->present.hands[idx];
-
 	if (!hta->use_prediction) {
-		*out_value = latest_hand;
+		os_mutex_lock(&hta->present.mutex);
+		*out_value = hta->present.hands[idx];
 		*out_timestamp_ns = hta->present.timestamp;
 		os_mutex_unlock(&hta->present.mutex);
 		return;
 	}
 
-	os_mutex_unlock(&hta->present.mutex);
-
 	double prediction_offset_ns = (double)hta->prediction_offset_ms.val * (double)U_TIME_1MS_IN_NS;
 
 	desired_timestamp_ns += (uint64_t)prediction_offset_ns;
 
-	struct xrt_space_relation predicted_wrist;
-	m_relation_history_get(hta->present.relation_hist[idx], desired_timestamp_ns, &predicted_wrist);
-
-	struct xrt_space_relation latest_wrist =
-	    latest_hand.values.hand_joint_set_default[XRT_HAND_JOINT_WRIST].relation;
-
-	*out_value = latest_hand;
-
-	// apply the pose change from the latest wrist to the predicted wrist
-	// to all the joints on the hand.
-
-	//! @todo We could slightly reduce the total number of transforms by putting some of this in ht_async_mainloop
-	for (int i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
-		struct xrt_relation_chain xrc = {0};
-		m_relation_chain_push_relation(&xrc, &latest_hand.values.hand_joint_set_default[i].relation);
-		m_relation_chain_push_inverted_relation(&xrc, &latest_wrist);
-		m_relation_chain_push_relation(&xrc, &predicted_wrist);
-		m_relation_chain_resolve(&xrc, &out_value->values.hand_joint_set_default[i].relation);
-	}
+	// Every joint interpolated between the two sets around the time, or moved on from the newest.
+	m_hand_joint_history_get(hta->present.joint_hist[idx], desired_timestamp_ns, out_value);
 
 	*out_timestamp_ns = desired_timestamp_ns;
 }
@@ -333,7 +302,7 @@ t_hand_tracking_async_default_create(struct xrt_frame_context *xfctx, struct t_h
 	hta->provider = sync;
 
 	for (int i = 0; i < 2; i++) {
-		m_relation_history_create(&hta->present.relation_hist[i]);
+		m_hand_joint_history_create(&hta->present.joint_hist[i]);
 	}
 
 	/*!
@@ -367,7 +336,7 @@ t_hand_tracking_async_default_create(struct xrt_frame_context *xfctx, struct t_h
 
 	// Now that everything initialised add to u_var.
 	u_var_add_root(hta, "Hand-tracking async shim!", 0);
-	u_var_add_bool(hta, &hta->use_prediction, "Predict wrist movement");
+	u_var_add_bool(hta, &hta->use_prediction, "Predict joint movement");
 	u_var_add_draggable_f32(hta, &hta->prediction_offset_ms, "Amount to time-travel (ms)");
 
 	return &hta->base;
@@ -0,0 +1,111 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Calibration cache tests.
+ */
+
+#include "util/u_calibration_cache.h"
+
+#include "catch/catch.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+//! Points the cache at a fresh directory for each test.
+std::string
+use_temp_cache_dir()
+{
+	char tmpl[] = "/tmp/monado-calibration-cache-XXXXXX";
+	REQUIRE(mkdtemp(tmpl) != nullptr);
+	setenv("XDG_CACHE_HOME", tmpl, 1);
+	return tmpl;
+}
+
+std::vector<uint8_t>
+make_blob(size_t size)
+{
+	std::vector<uint8_t> blob(size);
+	for (size_t i = 0; i < size; i++) {
+		blob[i] = (uint8_t)(i * 31 + 7);
+	}
+	return blob;
+}
+
+} // namespace
+
+
+TEST_CASE("calibration_cache")
+{
+	std::string dir = use_temp_cache_dir();
+	std::vector<uint8_t> blob = make_blob(5000);
+
+	uint8_t *data = nullptr;
+	size_t size = 0;
+
+	SECTION("Round trip")
+	{
+		CHECK_FALSE(u_calibration_cache_load("test", "SN-1", "fw1", &data, &size));
+		REQUIRE(u_calibration_cache_store("test", "SN-1", "fw1", blob.data(), blob.size()));
+		REQUIRE(u_calibration_cache_load("test", "SN-1", "fw1", &data, &size));
+
+		CHECK(size == blob.size());
+		CHECK(memcmp(data, blob.data(), size) == 0);
+		CHECK(data[size] == 0);
+		free(data);
+	}
+
+	SECTION("Keyed on serial and version")
+	{
+		REQUIRE(u_calibration_cache_store("test", "SN-1", "fw1", blob.data(), blob.size()));
+
+		CHECK_FALSE(u_calibration_cache_load("test", "SN-2", "fw1", &data, &size));
+		CHECK_FALSE(u_calibration_cache_load("test", "SN-1", "fw2", &data, &size));
+		CHECK_FALSE(u_calibration_cache_load("other", "SN-1", "fw1", &data, &size));
+
+		// Sanitizes to the same file name, but is a different key.
+		CHECK_FALSE(u_calibration_cache_load("test", "SN/1", "fw1", &data, &size));
+	}
+
+	SECTION("No serial, no cache")
+	{
+		CHECK_FALSE(u_calibration_cache_store("test", "", "fw1", blob.data(), blob.size()));
+		CHECK_FALSE(u_calibration_cache_store("test", nullptr, "fw1", blob.data(), blob.size()));
+		CHECK_FALSE(u_calibration_cache_load("test", nullptr, "fw1", &data, &size));
+	}
+
+	SECTION("Corrupt entries are ignored")
+	{
+		REQUIRE(u_calibration_cache_store("test", "SN-1", "fw1", blob.data(), blob.size()));
+
+		std::string path = dir + "/monado/calibration/test-SN_1-fw1.bin";
+		FILE *file = fopen(path.c_str(), "r+b");
+		REQUIRE(file != nullptr);
+		fseek(file, 100, SEEK_SET);
+		fputc(0xff, file);
+		fclose(file);
+
+		CHECK_FALSE(u_calibration_cache_load("test", "SN-1", "fw1", &data, &size));
+
+		// A fresh store replaces it.
+		REQUIRE(u_calibration_cache_store("test", "SN-1", "fw1", blob.data(), blob.size()));
+		REQUIRE(u_calibration_cache_load("test", "SN-1", "fw1", &data, &size));
+		free(data);
+	}
+
+	SECTION("Hash is FNV-1a")
+	{
+		CHECK(u_calibration_cache_hash("", 0) == UINT64_C(0xcbf29ce484222325));
+		CHECK(u_calibration_cache_hash("a", 1) == UINT64_C(0xaf63dc4c8601ec8c));
+		CHECK(u_calibration_cache_hash("foobar", 6) == UINT64_C(0x85944171f73967e8));
+	}
+
+	std::string cmd = "rm -rf '" + dir + "'";
+	CHECK(system(cmd.c_str()) == 0);
+}
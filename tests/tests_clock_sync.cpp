@@ -0,0 +1,177 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Hardware to monotonic clock mapping tests.
+ */
+
+#include "math/m_clock_sync.h"
+
+#include "catch/catch.hpp"
+
+#include <random>
+#include <cstdlib>
+
+
+namespace {
+
+constexpr timepoint_ns kHwStart = 123 * (timepoint_ns)U_TIME_1S_IN_NS;
+constexpr time_duration_ns kOffset = 98765 * (time_duration_ns)U_TIME_1S_IN_NS + 4321;
+constexpr time_duration_ns kBaseDelay = 150 * 1000;
+constexpr time_duration_ns kPeriod = 2 * U_TIME_1MS_IN_NS;
+
+/*!
+ * Simulated device, hardware clock with skew relative to the host and a
+ * transport delay made of a fixed part and an exponential jitter.
+ */
+struct SimClock
+{
+	time_duration_ns offset = kOffset;
+	double skew = 0.0;
+	double jitter_mean_ns = 300.0 * 1000.0;
+	double late_outlier_rate = 0.0;
+	double early_outlier_rate = 0.0;
+
+	std::mt19937 rng{42};
+	timepoint_ns hw = kHwStart;
+
+	timepoint_ns
+	truth(timepoint_ns at_hw) const
+	{
+		return at_hw + offset + (time_duration_ns)(skew * (double)(at_hw - kHwStart));
+	}
+
+	timepoint_ns
+	observe()
+	{
+		std::exponential_distribution<double> jitter(1.0 / jitter_mean_ns);
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+		time_duration_ns delay = kBaseDelay + (time_duration_ns)jitter(rng);
+
+		double r = uniform(rng);
+		if (r < late_outlier_rate) {
+			delay += (time_duration_ns)(5e6 + uniform(rng) * 25e6);
+		} else if (r < late_outlier_rate + early_outlier_rate) {
+			delay -= 2 * U_TIME_1MS_IN_NS;
+		}
+
+		return truth(hw) + delay;
+	}
+};
+
+//! Run @p seconds of samples and return the worst mapping error of the last second.
+time_duration_ns
+run(m_clock_sync &cs, SimClock &sim, int seconds)
+{
+	const int per_second = (int)(U_TIME_1S_IN_NS / kPeriod);
+	time_duration_ns worst = 0;
+
+	for (int i = 0; i < seconds * per_second; i++) {
+		sim.hw += kPeriod;
+		m_clock_sync_update(&cs, sim.hw, sim.observe());
+
+		if (i >= (seconds - 1) * per_second) {
+			// The fixed part of the delay can not be observed, compare against it.
+			time_duration_ns err = m_clock_sync_hw2mono(&cs, sim.hw) - (sim.truth(sim.hw) + kBaseDelay);
+			worst = std::max(worst, (time_duration_ns)std::llabs(err));
+		}
+	}
+
+	return worst;
+}
+
+} // namespace
+
+
+TEST_CASE("m_clock_sync")
+{
+	m_clock_sync cs;
+	m_clock_sync_init(&cs, 0);
+	SimClock sim;
+
+	CHECK_FALSE(m_clock_sync_is_ready(&cs));
+	CHECK(m_clock_sync_get_error(&cs, kHwStart) < 0);
+	CHECK(m_clock_sync_hw2mono(&cs, kHwStart) == kHwStart);
+
+	SECTION("First observation is usable straight away")
+	{
+		sim.hw += kPeriod;
+		timepoint_ns mono = sim.observe();
+		CHECK(m_clock_sync_update(&cs, sim.hw, mono) == mono);
+		CHECK_FALSE(m_clock_sync_is_ready(&cs));
+	}
+
+	SECTION("Constant offset with jitter")
+	{
+		time_duration_ns worst = run(cs, sim, 4);
+		CHECK(m_clock_sync_is_ready(&cs));
+		CHECK(worst < 100 * 1000);
+		CHECK(std::abs(cs.skew) < 20e-6);
+
+		double error = m_clock_sync_get_error(&cs, sim.hw);
+		CHECK(error >= 0);
+		CHECK(error < 50 * 1000);
+	}
+
+	SECTION("Skewed clock")
+	{
+		sim.skew = 200e-6;
+		time_duration_ns worst = run(cs, sim, 4);
+		CHECK(worst < 100 * 1000);
+		CHECK(cs.skew == Approx(200e-6).margin(20e-6));
+	}
+
+	SECTION("Outliers are rejected")
+	{
+		sim.skew = -80e-6;
+		sim.late_outlier_rate = 0.05;
+		sim.early_outlier_rate = 0.005;
+		time_duration_ns worst = run(cs, sim, 4);
+		CHECK(worst < 100 * 1000);
+		CHECK(cs.outliers > 0);
+	}
+
+	SECTION("Device clock reset")
+	{
+		run(cs, sim, 2);
+		REQUIRE(m_clock_sync_is_ready(&cs));
+
+		// Device restarts its clock, the host side keeps going.
+		sim.offset += sim.hw - kHwStart;
+		sim.hw = kHwStart;
+		time_duration_ns worst = run(cs, sim, 2);
+		CHECK(cs.resets == 1);
+		CHECK(m_clock_sync_is_ready(&cs));
+		CHECK(worst < 100 * 1000);
+	}
+
+	SECTION("Single observations far off do not reset")
+	{
+		run(cs, sim, 2);
+		REQUIRE(m_clock_sync_is_ready(&cs));
+
+		// A packet stuck for a while, then one with a bogus timestamp.
+		sim.hw += kPeriod;
+		m_clock_sync_update(&cs, sim.hw, sim.observe() + 300 * U_TIME_1MS_IN_NS);
+		sim.hw += kPeriod;
+		m_clock_sync_update(&cs, sim.hw, sim.observe() - 300 * U_TIME_1MS_IN_NS);
+
+		time_duration_ns worst = run(cs, sim, 1);
+		CHECK(cs.resets == 0);
+		CHECK(worst < 100 * 1000);
+	}
+
+	SECTION("Offset jump without the clock going back")
+	{
+		run(cs, sim, 2);
+		REQUIRE(m_clock_sync_is_ready(&cs));
+
+		// Device clock stalls for a second, it never goes backwards.
+		sim.offset += U_TIME_1S_IN_NS;
+		time_duration_ns worst = run(cs, sim, 2);
+		CHECK(cs.resets == 1);
+		CHECK(m_clock_sync_is_ready(&cs));
+		CHECK(worst < 100 * 1000);
+	}
+}
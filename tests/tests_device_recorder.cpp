@@ -0,0 +1,225 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Device recorder and replay driver round trip tests.
+ */
+
+#include "xrt/xrt_device.h"
+#include "os/os_time.h"
+#include "util/u_misc.h"
+#include "util/u_device.h"
+#include "util/u_device_recorder.h"
+
+#include "replay/replay_interface.h"
+
+#include "catch/catch.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+
+namespace {
+
+struct FakeDevice
+{
+	xrt_device base;
+	uint64_t t0;
+	int updates;
+};
+
+//! Position moves linearly with the requested time, makes interpolation exact.
+void
+fake_get_tracked_pose(xrt_device *xdev, xrt_input_name name, uint64_t at_timestamp_ns, xrt_space_relation *out)
+{
+	FakeDevice *d = reinterpret_cast<FakeDevice *>(xdev);
+	*out = XRT_SPACE_RELATION_ZERO;
+	out->pose.orientation.w = 1.0f;
+	out->pose.position.x = (float)((double)(int64_t)(at_timestamp_ns - d->t0) / 1e9);
+	out->pose.position.y = name == XRT_INPUT_GENERIC_HEAD_POSE ? 1.6f : 1.0f;
+	out->relation_flags = (xrt_space_relation_flags)(XRT_SPACE_RELATION_POSITION_VALID_BIT |
+	                                                 XRT_SPACE_RELATION_ORIENTATION_VALID_BIT);
+}
+
+void
+fake_update_inputs(xrt_device *xdev)
+{
+	FakeDevice *d = reinterpret_cast<FakeDevice *>(xdev);
+	d->updates++;
+	d->base.inputs[0].value.boolean = (d->updates % 2) == 1;
+	d->base.inputs[0].timestamp = (int64_t)os_monotonic_get_ns();
+}
+
+void
+fake_destroy(xrt_device *xdev)
+{
+	u_device_free(xdev);
+}
+
+FakeDevice *
+make_hmd(uint64_t t0)
+{
+	auto flags = (u_device_alloc_flags)(U_DEVICE_ALLOC_HMD | U_DEVICE_ALLOC_TRACKING_NONE);
+	FakeDevice *d = U_DEVICE_ALLOCATE(FakeDevice, flags, 1, 0);
+	d->t0 = t0;
+	d->base.name = XRT_DEVICE_GENERIC_HMD;
+	d->base.device_type = XRT_DEVICE_TYPE_HMD;
+	snprintf(d->base.str, XRT_DEVICE_NAME_LEN, "Fake HMD");
+	d->base.inputs[0].name = XRT_INPUT_GENERIC_HEAD_POSE;
+	d->base.hmd->screens[0].w_pixels = 2880;
+	d->base.hmd->screens[0].h_pixels = 1600;
+	d->base.hmd->blend_modes[0] = XRT_BLEND_MODE_OPAQUE;
+	d->base.hmd->blend_mode_count = 1;
+	for (uint32_t i = 0; i < 2; i++) {
+		d->base.hmd->distortion.fov[i] = {-0.8f, 0.8f, 0.9f, -0.9f};
+	}
+	d->base.orientation_tracking_supported = true;
+	d->base.position_tracking_supported = true;
+	d->base.update_inputs = u_device_noop_update_inputs;
+	d->base.get_tracked_pose = fake_get_tracked_pose;
+	d->base.get_view_poses = u_device_get_view_poses;
+	d->base.destroy = fake_destroy;
+	return d;
+}
+
+FakeDevice *
+make_controller(uint64_t t0)
+{
+	auto flags = (u_device_alloc_flags)(U_DEVICE_ALLOC_TRACKING_NONE);
+	FakeDevice *d = U_DEVICE_ALLOCATE(FakeDevice, flags, 2, 1);
+	d->t0 = t0;
+	d->base.name = XRT_DEVICE_SIMPLE_CONTROLLER;
+	d->base.device_type = XRT_DEVICE_TYPE_LEFT_HAND_CONTROLLER;
+	snprintf(d->base.str, XRT_DEVICE_NAME_LEN, "Fake controller");
+	snprintf(d->base.serial, XRT_DEVICE_NAME_LEN, "1234");
+	d->base.inputs[0].name = XRT_INPUT_SIMPLE_SELECT_CLICK;
+	d->base.inputs[1].name = XRT_INPUT_SIMPLE_GRIP_POSE;
+	d->base.outputs[0].name = XRT_OUTPUT_NAME_SIMPLE_VIBRATION;
+	d->base.orientation_tracking_supported = true;
+	d->base.update_inputs = fake_update_inputs;
+	d->base.get_tracked_pose = fake_get_tracked_pose;
+	d->base.destroy = fake_destroy;
+	return d;
+}
+
+} // namespace
+
+
+TEST_CASE("u_device_recorder")
+{
+	std::string path = "tests_device_recorder_" + std::to_string(os_monotonic_get_ns()) + ".bin";
+	uint64_t t0 = os_monotonic_get_ns();
+
+	u_device_recorder *udr = u_device_recorder_open(path.c_str());
+	REQUIRE(udr != nullptr);
+
+	xrt_device *head = u_device_recorder_wrap(udr, &make_hmd(t0)->base);
+	xrt_device *left = u_device_recorder_wrap(udr, &make_controller(t0)->base);
+	u_device_recorder_roles roles = {0, 1, -1, -1, -1};
+	u_device_recorder_write_roles(udr, &roles);
+	u_device_recorder_unref(&udr);
+
+	// Record poses at the time of the calls, a little apart.
+	uint64_t at[10];
+	for (int i = 0; i < 10; i++) {
+		at[i] = os_monotonic_get_ns();
+		xrt_space_relation rel;
+		xrt_device_get_tracked_pose(head, XRT_INPUT_GENERIC_HEAD_POSE, at[i], &rel);
+		xrt_device_get_tracked_pose(left, XRT_INPUT_SIMPLE_GRIP_POSE, at[i], &rel);
+		CHECK(rel.pose.position.y == 1.0f);
+		os_nanosleep(U_TIME_1MS_IN_NS);
+	}
+
+	xrt_vec3 eye_relation = {0.063f, 0.0f, 0.0f};
+	xrt_space_relation head_rel;
+	xrt_fov fovs[2];
+	xrt_pose poses[2];
+	xrt_device_get_view_poses(head, &eye_relation, at[5], 2, &head_rel, fovs, poses);
+
+	for (int i = 0; i < 3; i++) {
+		xrt_device_update_inputs(left);
+	}
+	int64_t last_input_ts = left->inputs[0].timestamp;
+	int64_t after_inputs_ns = (int64_t)os_monotonic_get_ns();
+
+	// Push the end of the recording well past the inputs.
+	os_nanosleep(200 * U_TIME_1MS_IN_NS);
+	xrt_space_relation rel;
+	xrt_device_get_tracked_pose(head, XRT_INPUT_GENERIC_HEAD_POSE, os_monotonic_get_ns(), &rel);
+
+	xrt_device_destroy(&head);
+	xrt_device_destroy(&left);
+
+	u_device_recorder_file_header file_header;
+	FILE *file = fopen(path.c_str(), "rb");
+	REQUIRE(file != nullptr);
+	REQUIRE(fread(&file_header, sizeof(file_header), 1, file) == 1);
+	fclose(file);
+	CHECK(memcmp(file_header.magic, U_DEVICE_RECORDER_MAGIC, 8) == 0);
+
+	xrt_tracking_origin origin = {};
+	xrt_device *xdevs[4] = {};
+	uint32_t xdev_count = 0;
+	u_device_recorder_roles out_roles;
+
+	SECTION("Devices and poses")
+	{
+		// Start the replay where the recording started, keeps the times unchanged.
+		REQUIRE(replay_create_devices(path.c_str(), file_header.start_ns, &origin, xdevs, 4, &xdev_count,
+		                              &out_roles) == XRT_SUCCESS);
+		REQUIRE(xdev_count == 2);
+		CHECK(out_roles.head == 0);
+		CHECK(out_roles.left == 1);
+		CHECK(out_roles.right == -1);
+
+		xrt_device *rhead = xdevs[0];
+		xrt_device *rleft = xdevs[1];
+		CHECK(std::string(rhead->str) == "Fake HMD");
+		REQUIRE(rhead->hmd != nullptr);
+		CHECK(rhead->hmd->screens[0].w_pixels == 2880);
+		CHECK(rhead->hmd->blend_mode_count == 1);
+		CHECK(rleft->hmd == nullptr);
+		CHECK(std::string(rleft->serial) == "1234");
+		REQUIRE(rleft->input_count == 2);
+		CHECK(rleft->inputs[1].name == XRT_INPUT_SIMPLE_GRIP_POSE);
+		REQUIRE(rleft->output_count == 1);
+		CHECK(rleft->outputs[0].name == XRT_OUTPUT_NAME_SIMPLE_VIBRATION);
+		CHECK(rleft->tracking_origin == &origin);
+
+		// Between two samples, the fake moves linearly so this is exact.
+		uint64_t mid = (at[3] + at[4]) / 2;
+		xrt_device_get_tracked_pose(rleft, XRT_INPUT_SIMPLE_GRIP_POSE, mid, &rel);
+		CHECK(rel.pose.position.x == Approx((double)(mid - t0) / 1e9).margin(1e-6));
+		CHECK(rel.pose.position.y == 1.0f);
+
+		xrt_fov rfovs[2];
+		xrt_pose rposes[2];
+		xrt_device_get_view_poses(rhead, &eye_relation, at[5], 2, &head_rel, rfovs, rposes);
+		CHECK(rfovs[1].angle_left == fovs[1].angle_left);
+		CHECK(rposes[0].position.x == poses[0].position.x);
+		CHECK(head_rel.pose.position.y == 1.6f);
+
+		xrt_device_destroy(&rleft);
+		xrt_device_destroy(&rhead);
+	}
+
+	SECTION("Inputs")
+	{
+		// Line up now with just after the inputs were recorded.
+		int64_t start_ns = (int64_t)os_monotonic_get_ns() - (after_inputs_ns - file_header.start_ns);
+		REQUIRE(replay_create_devices(path.c_str(), start_ns, &origin, xdevs, 4, &xdev_count, &out_roles) ==
+		        XRT_SUCCESS);
+
+		xrt_device *rleft = xdevs[1];
+		xrt_device_update_inputs(rleft);
+		CHECK(rleft->inputs[0].value.boolean == true);
+		CHECK(rleft->inputs[0].timestamp == last_input_ts + (start_ns - file_header.start_ns));
+
+		for (uint32_t i = 0; i < xdev_count; i++) {
+			xrt_device_destroy(&xdevs[i]);
+		}
+	}
+
+	std::remove(path.c_str());
+}
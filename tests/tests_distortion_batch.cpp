@@ -0,0 +1,288 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Batch distortion evaluation tests and benchmark.
+ */
+
+#include "os/os_time.h"
+#include "util/u_device.h"
+#include "util/u_distortion_mesh.h"
+
+#include "catch/catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+using Single = std::function<void(float u, float v, xrt_uv_triplet *result)>;
+using Batch = std::function<void(const float *u, const float *v, uint32_t count, u_uv_triplet_batch *out)>;
+
+struct Samples
+{
+	std::vector<float> u;
+	std::vector<float> v;
+	std::vector<float> out[6];
+
+	explicit Samples(uint32_t count) : u(count), v(count)
+	{
+		std::mt19937 rng(count);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		for (uint32_t i = 0; i < count; i++) {
+			u[i] = dist(rng);
+			v[i] = dist(rng);
+		}
+		for (std::vector<float> &o : out) {
+			o.resize(count);
+		}
+	}
+
+	u_uv_triplet_batch
+	batch()
+	{
+		return {out[0].data(), out[1].data(), out[2].data(), out[3].data(), out[4].data(), out[5].data()};
+	}
+};
+
+//! Largest difference between the single sample and the batch results.
+float
+max_difference(const Single &single, const Batch &batch, uint32_t count)
+{
+	Samples s(count);
+	u_uv_triplet_batch out = s.batch();
+	batch(s.u.data(), s.v.data(), count, &out);
+
+	float diff = 0.0f;
+	for (uint32_t i = 0; i < count; i++) {
+		xrt_uv_triplet expected;
+		single(s.u[i], s.v[i], &expected);
+
+		const float *e = &expected.r.x;
+		for (int k = 0; k < 6; k++) {
+			diff = std::max(diff, std::fabs(e[k] - s.out[k][i]));
+		}
+	}
+
+	return diff;
+}
+
+void
+check_model(const Single &single, const Batch &batch)
+{
+	// Full groups of lanes, tails and both.
+	for (uint32_t count : {1u, 3u, 4u, 7u, 8u, 13u, 65u, 1000u}) {
+		CAPTURE(count);
+		CHECK(max_difference(single, batch, count) <= 1e-6f);
+	}
+}
+
+u_vive_values
+vive_values()
+{
+	u_vive_values val = {};
+	val.aspect_x_over_y = 0.9f;
+	val.grow_for_undistort = 0.6f;
+	for (int i = 0; i < 3; i++) {
+		val.center[i] = {0.05f, 0.01f * i};
+		val.coefficients[i][0] = 0.3f + 0.01f * i;
+		val.coefficients[i][1] = 0.2f;
+		val.coefficients[i][2] = 0.05f;
+		val.coefficients[i][3] = 0.01f;
+	}
+	return val;
+}
+
+u_panotools_values
+panotools_values()
+{
+	u_panotools_values val = {};
+	val.distortion_k[0] = 1.0f;
+	val.distortion_k[1] = 0.05f;
+	val.distortion_k[2] = 0.2f;
+	val.distortion_k[3] = 0.02f;
+	val.distortion_k[4] = 0.01f;
+	val.aberration_k[0] = 0.99f;
+	val.aberration_k[1] = 1.0f;
+	val.aberration_k[2] = 1.01f;
+	val.scale = 0.05f;
+	val.lens_center = {0.06f, 0.035f};
+	val.viewport_size = {0.126f, 0.071f};
+	return val;
+}
+
+u_cardboard_distortion_values
+cardboard_values()
+{
+	u_cardboard_distortion_values val = {};
+	val.distortion_k[0] = 0.34f;
+	val.distortion_k[1] = 0.55f;
+	val.screen.size = {1.8f, 2.0f};
+	val.screen.offset = {0.9f, 1.0f};
+	val.texture.size = {2.2f, 2.4f};
+	val.texture.offset = {1.1f, 1.2f};
+	return val;
+}
+
+u_ns_p2d_values
+ns_p2d_values()
+{
+	u_ns_p2d_values val = {};
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(-0.2f, 0.2f);
+	for (int i = 0; i < 16; i++) {
+		val.x_coefficients_left[i] = dist(rng);
+		val.x_coefficients_right[i] = dist(rng);
+		val.y_coefficients_left[i] = dist(rng);
+		val.y_coefficients_right[i] = dist(rng);
+	}
+	for (int view = 0; view < 2; view++) {
+		val.fov[view] = {-0.8f, 0.7f, 0.75f, -0.75f};
+	}
+	return val;
+}
+
+struct VivePanel
+{
+	xrt_device base;
+	u_vive_values values[2];
+};
+
+bool
+vive_single(xrt_device *xdev, uint32_t view, float u, float v, xrt_uv_triplet *result)
+{
+	return u_compute_distortion_vive(&reinterpret_cast<VivePanel *>(xdev)->values[view], u, v, result);
+}
+
+bool
+vive_batch(xrt_device *xdev, uint32_t view, const float *u, const float *v, uint32_t count, u_uv_triplet_batch *out)
+{
+	return u_compute_distortion_vive_batch(&reinterpret_cast<VivePanel *>(xdev)->values[view], u, v, count, out);
+}
+
+VivePanel *
+make_vive()
+{
+	VivePanel *hmd = U_DEVICE_ALLOCATE(VivePanel, U_DEVICE_ALLOC_HMD, 1, 0);
+	hmd->base.hmd->view_count = 2;
+	hmd->base.compute_distortion = vive_single;
+	hmd->values[0] = vive_values();
+	hmd->values[1] = vive_values();
+	hmd->values[1].center[0].x = -0.05f;
+	return hmd;
+}
+
+} // namespace
+
+
+TEST_CASE("distortion_batch")
+{
+	SECTION("Vive")
+	{
+		u_vive_values val = vive_values();
+		check_model([&](float u, float v, xrt_uv_triplet *r) { u_compute_distortion_vive(&val, u, v, r); },
+		            [&](const float *u, const float *v, uint32_t count, u_uv_triplet_batch *out) {
+			            u_compute_distortion_vive_batch(&val, u, v, count, out);
+		            });
+	}
+
+	SECTION("Panotools")
+	{
+		u_panotools_values val = panotools_values();
+		check_model([&](float u, float v, xrt_uv_triplet *r) { u_compute_distortion_panotools(&val, u, v, r); },
+		            [&](const float *u, const float *v, uint32_t count, u_uv_triplet_batch *out) {
+			            u_compute_distortion_panotools_batch(&val, u, v, count, out);
+		            });
+	}
+
+	SECTION("Cardboard")
+	{
+		u_cardboard_distortion_values val = cardboard_values();
+		check_model([&](float u, float v, xrt_uv_triplet *r) { u_compute_distortion_cardboard(&val, u, v, r); },
+		            [&](const float *u, const float *v, uint32_t count, u_uv_triplet_batch *out) {
+			            u_compute_distortion_cardboard_batch(&val, u, v, count, out);
+		            });
+	}
+
+	SECTION("North Star 2D polynomial")
+	{
+		u_ns_p2d_values val = ns_p2d_values();
+		for (int view = 0; view < 2; view++) {
+			CAPTURE(view);
+			check_model(
+			    [&](float u, float v, xrt_uv_triplet *r) {
+				    u_compute_distortion_ns_p2d(&val, view, u, v, r);
+			    },
+			    [&](const float *u, const float *v, uint32_t count, u_uv_triplet_batch *out) {
+				    u_compute_distortion_ns_p2d_batch(&val, view, u, v, count, out);
+			    });
+		}
+	}
+}
+
+TEST_CASE("distortion_mesh_batch")
+{
+	// Both meshes have to be computed.
+	setenv("XRT_DISTORTION_CACHE", "false", 1);
+
+	VivePanel *single = make_vive();
+	VivePanel *batch = make_vive();
+
+	u_distortion_mesh_fill_in_compute(&single->base);
+	u_distortion_mesh_fill_in_batch(&batch->base, vive_batch);
+
+	const xrt_hmd_parts *s = single->base.hmd;
+	const xrt_hmd_parts *b = batch->base.hmd;
+	REQUIRE(b->distortion.mesh.vertices != nullptr);
+	REQUIRE(b->distortion.mesh.vertex_count == s->distortion.mesh.vertex_count);
+	CHECK(b->distortion.mesh.index_count_total == s->distortion.mesh.index_count_total);
+	CHECK((b->distortion.models & XRT_DISTORTION_MODEL_MESHUV) != 0);
+
+	size_t float_count = s->distortion.mesh.vertex_count * s->distortion.mesh.stride / sizeof(float);
+	float diff = 0.0f;
+	for (size_t i = 0; i < float_count; i++) {
+		diff = std::max(diff, std::fabs(s->distortion.mesh.vertices[i] - b->distortion.mesh.vertices[i]));
+	}
+	CHECK(diff <= 1e-6f);
+
+	u_device_free(&single->base);
+	u_device_free(&batch->base);
+}
+
+TEST_CASE("distortion_batch_benchmark", "[.benchmark]")
+{
+	// Two views of a default sized mesh.
+	constexpr uint32_t kCount = 65 * 65 * 2;
+	constexpr int kRuns = 20;
+
+	u_vive_values val = vive_values();
+	Samples s(kCount);
+	u_uv_triplet_batch out = s.batch();
+	std::vector<xrt_uv_triplet> single_out(kCount);
+
+	uint64_t single_ns = UINT64_MAX;
+	uint64_t batch_ns = UINT64_MAX;
+	for (int run = 0; run < kRuns; run++) {
+		uint64_t start_ns = os_monotonic_get_ns();
+		for (uint32_t i = 0; i < kCount; i++) {
+			u_compute_distortion_vive(&val, s.u[i], s.v[i], &single_out[i]);
+		}
+		single_ns = std::min(single_ns, os_monotonic_get_ns() - start_ns);
+
+		start_ns = os_monotonic_get_ns();
+		u_compute_distortion_vive_batch(&val, s.u.data(), s.v.data(), kCount, &out);
+		batch_ns = std::min(batch_ns, os_monotonic_get_ns() - start_ns);
+	}
+
+	printf("vive distortion, %u samples: single %.1f us, batch %.1f us (%.1fx)\n", kCount,
+	       (double)single_ns / 1e3, (double)batch_ns / 1e3, (double)single_ns / (double)batch_ns);
+
+	// Keep the results alive.
+	CHECK(std::fabs(single_out[kCount - 1].g.x - out.g_x[kCount - 1]) <= 1e-6f);
+}
@@ -0,0 +1,208 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Distortion mesh cache and parallel evaluation tests.
+ */
+
+#include "os/os_time.h"
+#include "util/u_device.h"
+#include "util/u_distortion_cache.h"
+#include "util/u_distortion_mesh.h"
+
+#include "catch/catch.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+struct TestHmd
+{
+	xrt_device base;
+	u_vive_values values[2];
+	std::atomic<int> calls;
+};
+
+bool
+compute_distortion(xrt_device *xdev, uint32_t view, float u, float v, xrt_uv_triplet *result)
+{
+	TestHmd *hmd = reinterpret_cast<TestHmd *>(xdev);
+	hmd->calls++;
+	return u_compute_distortion_vive(&hmd->values[view], u, v, result);
+}
+
+TestHmd *
+make_hmd(float k1)
+{
+	TestHmd *hmd = U_DEVICE_ALLOCATE(TestHmd, U_DEVICE_ALLOC_HMD, 1, 0);
+	hmd->base.hmd->view_count = 2;
+	hmd->base.compute_distortion = compute_distortion;
+
+	for (int view = 0; view < 2; view++) {
+		u_vive_values &val = hmd->values[view];
+		val.aspect_x_over_y = 0.9f;
+		val.grow_for_undistort = 0.6f;
+		for (int i = 0; i < 3; i++) {
+			val.center[i] = {0.05f * (view ? -1 : 1), 0.01f * i};
+			val.coefficients[i][0] = k1 + 0.01f * i;
+			val.coefficients[i][1] = 0.2f;
+			val.coefficients[i][2] = 0.05f;
+		}
+	}
+
+	return hmd;
+}
+
+size_t
+vertex_float_count(xrt_device *xdev)
+{
+	return xdev->hmd->distortion.mesh.vertex_count * xdev->hmd->distortion.mesh.stride / sizeof(float);
+}
+
+std::vector<float>
+vertices(xrt_device *xdev)
+{
+	const float *verts = xdev->hmd->distortion.mesh.vertices;
+	return std::vector<float>(verts, verts + vertex_float_count(xdev));
+}
+
+struct RowCounter
+{
+	std::vector<std::atomic<int>> rows;
+	uint32_t fail_row;
+
+	RowCounter(uint32_t count, uint32_t fail) : rows(count), fail_row(fail) {}
+};
+
+bool
+count_row(void *ptr, uint32_t row)
+{
+	RowCounter *rc = static_cast<RowCounter *>(ptr);
+	rc->rows[row]++;
+	return row != rc->fail_row;
+}
+
+} // namespace
+
+
+TEST_CASE("distortion_run_rows")
+{
+	constexpr uint32_t kRows = 1000;
+
+	RowCounter all(kRows, UINT32_MAX);
+	CHECK(u_distortion_run_rows(kRows, count_row, &all));
+
+	bool each_once = true;
+	for (const std::atomic<int> &r : all.rows) {
+		each_once &= r.load() == 1;
+	}
+	CHECK(each_once);
+
+	RowCounter failing(kRows, 517);
+	CHECK_FALSE(u_distortion_run_rows(kRows, count_row, &failing));
+	CHECK(failing.rows[kRows - 1] == 1);
+}
+
+TEST_CASE("distortion_cache")
+{
+	char tmpl[] = "/tmp/monado-distortion-cache-XXXXXX";
+	REQUIRE(mkdtemp(tmpl) != nullptr);
+	setenv("XDG_CACHE_HOME", tmpl, 1);
+
+	TestHmd *cold = make_hmd(0.3f);
+	TestHmd *warm = make_hmd(0.3f);
+	TestHmd *other = make_hmd(0.31f);
+
+	uint64_t start_ns = os_monotonic_get_ns();
+	u_distortion_mesh_fill_in_compute(&cold->base);
+	uint64_t cold_ns = os_monotonic_get_ns() - start_ns;
+
+	start_ns = os_monotonic_get_ns();
+	u_distortion_mesh_fill_in_compute(&warm->base);
+	uint64_t warm_ns = os_monotonic_get_ns() - start_ns;
+
+	u_distortion_mesh_fill_in_compute(&other->base);
+
+	SECTION("Computed in parallel matches evaluating each vertex")
+	{
+		xrt_hmd_parts *parts = cold->base.hmd;
+		REQUIRE(parts->distortion.mesh.vertices != nullptr);
+		CHECK((parts->distortion.models & XRT_DISTORTION_MODEL_MESHUV) != 0);
+
+		const float *verts = parts->distortion.mesh.vertices;
+		uint32_t stride = parts->distortion.mesh.stride / sizeof(float);
+		uint32_t per_view = parts->distortion.mesh.vertex_count / 2;
+
+		bool all_equal = true;
+		for (uint32_t i = 0; i < parts->distortion.mesh.vertex_count; i++) {
+			const float *vert = &verts[i * stride];
+			float u = (vert[0] + 1.0f) / 2.0f;
+			float v = (vert[1] + 1.0f) / 2.0f;
+
+			xrt_uv_triplet expected;
+			u_compute_distortion_vive(&cold->values[i / per_view], u, v, &expected);
+			all_equal &= memcmp(&expected, &vert[2], sizeof(expected)) == 0;
+		}
+		CHECK(all_equal);
+	}
+
+	SECTION("Warm start maps the same mesh without evaluating it")
+	{
+		bool same_vertices = vertices(&warm->base) == vertices(&cold->base);
+		CHECK(same_vertices);
+		CHECK(warm->base.hmd->distortion.mesh.index_count_total ==
+		      cold->base.hmd->distortion.mesh.index_count_total);
+		CHECK(memcmp(warm->base.hmd->distortion.mesh.indices, cold->base.hmd->distortion.mesh.indices,
+		             cold->base.hmd->distortion.mesh.index_count_total * sizeof(int)) == 0);
+
+		// Only the samples for the key.
+		CHECK(warm->calls < cold->calls / 10);
+
+		printf("distortion mesh: cold %.2f ms (%d evaluations), warm %.2f ms (%d evaluations)\n",
+		       (double)cold_ns / 1e6, cold->calls.load(), (double)warm_ns / 1e6, warm->calls.load());
+	}
+
+	SECTION("Keyed on the distortion")
+	{
+		bool same_vertices = vertices(&other->base) == vertices(&cold->base);
+		CHECK_FALSE(same_vertices);
+
+		uint32_t num = 64;
+		uint64_t cold_key = u_distortion_cache_key(&cold->base, "mesh", &num, sizeof(num));
+		uint64_t other_key = u_distortion_cache_key(&other->base, "mesh", &num, sizeof(num));
+		num = 32;
+		uint64_t smaller_key = u_distortion_cache_key(&cold->base, "mesh", &num, sizeof(num));
+
+		CHECK(cold_key != other_key);
+		CHECK(cold_key != smaller_key);
+	}
+
+	SECTION("Broken entries are ignored")
+	{
+		uint64_t key = 1234;
+		std::vector<float> data(256, 1.0f);
+		REQUIRE(u_distortion_cache_store("test", key, data.data(), data.size() * sizeof(float)));
+
+		u_distortion_cache_blob blob;
+		REQUIRE(u_distortion_cache_map("test", key, data.size() * sizeof(float), &blob));
+		CHECK(memcmp(blob.data, data.data(), blob.size) == 0);
+		u_distortion_cache_unmap(&blob);
+		CHECK(blob.data == nullptr);
+
+		CHECK_FALSE(u_distortion_cache_map("test", key, data.size() * sizeof(float) - 4, &blob));
+		CHECK_FALSE(u_distortion_cache_map("test", key + 1, data.size() * sizeof(float), &blob));
+	}
+
+	u_device_free(&cold->base);
+	u_device_free(&warm->base);
+	u_device_free(&other->base);
+
+	std::string cmd = std::string("rm -rf '") + tmpl + "'";
+	CHECK(system(cmd.c_str()) == 0);
+}
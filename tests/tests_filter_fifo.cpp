@@ -0,0 +1,285 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Filter fifo tests.
+ */
+
+#include "math/m_filter_fifo.h"
+
+#include "os/os_time.h"
+#include "util/u_time.h"
+
+#include "catch/catch.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+constexpr uint64_t kStepNs = U_TIME_1MS_IN_NS;
+
+struct Reference
+{
+	std::vector<xrt_vec3> samples;
+	std::vector<uint64_t> timestamps;
+
+	//! Same as the fifo used to, walking back from the newest sample.
+	size_t
+	filter(size_t num, uint64_t start_ns, uint64_t stop_ns, xrt_vec3 *out_average) const
+	{
+		double x = 0;
+		double y = 0;
+		double z = 0;
+		size_t count = 0;
+		size_t visible = std::min(num, samples.size());
+		for (size_t i = samples.size() - visible; i < samples.size(); i++) {
+			if (timestamps[i] < start_ns || timestamps[i] > stop_ns) {
+				continue;
+			}
+			x += samples[i].x;
+			y += samples[i].y;
+			z += samples[i].z;
+			count++;
+		}
+		if (count > 0) {
+			x /= count;
+			y /= count;
+			z /= count;
+		}
+		*out_average = {(float)x, (float)y, (float)z};
+		return count;
+	}
+};
+
+} // namespace
+
+
+TEST_CASE("m_ff_vec3_f32")
+{
+	constexpr size_t kNum = 100;
+	m_ff_vec3_f32 *ff = nullptr;
+	m_ff_vec3_f32_alloc(&ff, kNum);
+	REQUIRE(m_ff_vec3_f32_get_num(ff) == kNum);
+
+	SECTION("Starts out with zero samples at timepoint zero")
+	{
+		xrt_vec3 sample{1, 1, 1};
+		uint64_t ts = 1;
+		CHECK(m_ff_vec3_f32_get(ff, kNum - 1, &sample, &ts));
+		CHECK(ts == 0);
+		CHECK(sample.x == 0.0f);
+		CHECK_FALSE(m_ff_vec3_f32_get(ff, kNum, &sample, &ts));
+
+		xrt_vec3 avg{};
+		CHECK(m_ff_vec3_f32_filter(ff, 1, 1000, &avg) == 0);
+		CHECK(m_ff_vec3_f32_filter(ff, 0, 1000, &avg) == kNum);
+	}
+
+	SECTION("Filtering matches walking the samples")
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+		std::uniform_int_distribution<uint64_t> gap(0, 3 * kStepNs);
+
+		Reference ref;
+		uint64_t ts = kStepNs;
+		for (int i = 0; i < 350; i++) {
+			xrt_vec3 v{value(rng), value(rng), value(rng)};
+			m_ff_vec3_f32_push(ff, &v, ts);
+			ref.samples.push_back(v);
+			ref.timestamps.push_back(ts);
+			ts += gap(rng);
+		}
+
+		std::uniform_int_distribution<uint64_t> when(ref.timestamps.front(), ts + kStepNs);
+		for (int i = 0; i < 2000; i++) {
+			uint64_t a = when(rng);
+			uint64_t b = when(rng);
+
+			xrt_vec3 got{};
+			xrt_vec3 expected{};
+			size_t got_count = m_ff_vec3_f32_filter(ff, a, b, &got);
+			size_t expected_count = a > b ? 0 : ref.filter(kNum, a, b, &expected);
+
+			REQUIRE(got_count == expected_count);
+			CHECK(got.x == Approx(expected.x).margin(1e-4));
+			CHECK(got.y == Approx(expected.y).margin(1e-4));
+			CHECK(got.z == Approx(expected.z).margin(1e-4));
+		}
+	}
+
+	SECTION("First sample after a timepoint")
+	{
+		for (uint64_t i = 1; i <= 10; i++) {
+			xrt_vec3 v{(float)i, 0, 0};
+			m_ff_vec3_f32_push(ff, &v, i * kStepNs);
+		}
+
+		size_t num = 0;
+		xrt_vec3 sample{};
+		uint64_t ts = 0;
+
+		CHECK(m_ff_vec3_f32_get_first_after(ff, 4 * kStepNs, &num));
+		CHECK(num == 5);
+		CHECK(m_ff_vec3_f32_get(ff, num, &sample, &ts));
+		CHECK(ts == 5 * kStepNs);
+
+		CHECK(m_ff_vec3_f32_get_first_after(ff, 4 * kStepNs + 1, &num));
+		CHECK(m_ff_vec3_f32_get(ff, num, &sample, &ts));
+		CHECK(ts == 5 * kStepNs);
+
+		CHECK_FALSE(m_ff_vec3_f32_get_first_after(ff, 10 * kStepNs, &num));
+	}
+
+	m_ff_vec3_f32_free(&ff);
+	CHECK(ff == nullptr);
+}
+
+TEST_CASE("m_ff_f64")
+{
+	m_ff_f64 *ff = nullptr;
+	m_ff_f64_alloc(&ff, 10);
+
+	for (uint64_t i = 1; i <= 20; i++) {
+		double v = (double)i;
+		m_ff_f64_push(ff, &v, i * kStepNs);
+	}
+
+	// Only the last ten are kept.
+	double avg = 0;
+	CHECK(m_ff_f64_filter(ff, 0, 100 * kStepNs, &avg) == 10);
+	CHECK(avg == Approx(15.5));
+	CHECK(m_ff_f64_filter(ff, 12 * kStepNs, 14 * kStepNs, &avg) == 3);
+	CHECK(avg == Approx(13.0));
+	CHECK(m_ff_f64_filter(ff, 14 * kStepNs, 12 * kStepNs, &avg) == 0);
+	CHECK(avg == 0.0);
+
+	size_t num = 0;
+	CHECK(m_ff_f64_get_first_after(ff, 0, &num));
+	CHECK(num == 9);
+
+	m_ff_f64_free(&ff);
+}
+
+TEST_CASE("m_ff_f64_out_of_order")
+{
+	m_ff_f64 *ff = nullptr;
+	m_ff_f64_alloc(&ff, 10);
+
+	double v = 1.0;
+	CHECK(m_ff_f64_push(ff, &v, 5 * kStepNs));
+	v = 2.0;
+	CHECK_FALSE(m_ff_f64_push(ff, &v, 3 * kStepNs));
+
+	// Same timestamp is still in order.
+	v = 3.0;
+	CHECK(m_ff_f64_push(ff, &v, 5 * kStepNs));
+	v = 4.0;
+	CHECK(m_ff_f64_push(ff, &v, 7 * kStepNs));
+
+	double avg = 0;
+	CHECK(m_ff_f64_filter(ff, 1, 100 * kStepNs, &avg) == 3);
+	CHECK(avg == Approx(8.0 / 3.0));
+
+	uint64_t ts = 0;
+	CHECK(m_ff_f64_get(ff, 2, &v, &ts));
+	CHECK(v == 1.0);
+	CHECK(ts == 5 * kStepNs);
+	CHECK(m_ff_f64_get(ff, 3, &v, &ts));
+	CHECK(ts == 0);
+
+	m_ff_f64_free(&ff);
+}
+
+TEST_CASE("m_ff_vec3_f32_concurrent")
+{
+	/*
+	 * One thread pushes samples with a value equal to their timestamp in
+	 * milliseconds, another filters windows in the recent past which then
+	 * have a known average.
+	 */
+	constexpr size_t kNum = 1000;
+	constexpr uint64_t kChecks = 20000;
+
+	// Keeps the values exact as floats.
+	constexpr uint64_t kMaxPushes = 1 << 23;
+
+	m_ff_vec3_f32 *ff = nullptr;
+	m_ff_vec3_f32_alloc(&ff, kNum);
+
+	std::atomic<bool> stop_pushing{false};
+	std::atomic<bool> done{false};
+	std::thread producer([&] {
+		for (uint64_t i = 1; i <= kMaxPushes && !stop_pushing; i++) {
+			xrt_vec3 v{(float)i, (float)i, 0};
+			m_ff_vec3_f32_push(ff, &v, i * kStepNs);
+		}
+		done = true;
+	});
+
+	bool ok = true;
+	uint64_t checks = 0;
+	while (!done && checks < kChecks) {
+		xrt_vec3 newest{};
+		uint64_t newest_ts = 0;
+		m_ff_vec3_f32_get(ff, 0, &newest, &newest_ts);
+		if (newest_ts < 600 * kStepNs) {
+			continue;
+		}
+
+		// Well within the fifo even with the producer moving on.
+		uint64_t start = newest_ts - 500 * kStepNs;
+		uint64_t stop = start + 9 * kStepNs;
+
+		xrt_vec3 avg{};
+		size_t count = m_ff_vec3_f32_filter(ff, start, stop, &avg);
+		float expected = (float)(start / kStepNs) + 4.5f;
+		ok &= count == 10 && avg.x == expected && avg.y == expected;
+		checks++;
+	}
+	stop_pushing = true;
+	producer.join();
+
+	CHECK(ok);
+	CHECK(checks > 0);
+
+	m_ff_vec3_f32_free(&ff);
+}
+
+TEST_CASE("m_ff_vec3_f32_benchmark", "[.benchmark]")
+{
+	// A 1 kHz IMU fifo filtered like m_imu_3dof and the SLAM prediction do.
+	constexpr size_t kNum = 1000;
+	constexpr int kIterations = 200000;
+
+	m_ff_vec3_f32 *ff = nullptr;
+	m_ff_vec3_f32_alloc(&ff, kNum);
+	for (uint64_t i = 1; i <= 2 * kNum; i++) {
+		xrt_vec3 v{(float)i, 0, 0};
+		m_ff_vec3_f32_push(ff, &v, i * kStepNs);
+	}
+
+	uint64_t newest = 2 * kNum * kStepNs;
+	for (uint64_t window_ms : {20, 200, 900}) {
+		xrt_vec3 avg{};
+		float sum = 0;
+		uint64_t t0 = os_monotonic_get_ns();
+		for (int i = 0; i < kIterations; i++) {
+			uint64_t stop = newest - (uint64_t)(i % 50) * kStepNs;
+			m_ff_vec3_f32_filter(ff, stop - window_ms * kStepNs, stop, &avg);
+			sum += avg.x;
+		}
+		uint64_t t1 = os_monotonic_get_ns();
+
+		printf("m_ff_vec3_f32: %4u ms window, %.1f ns per filter (%f)\n", (unsigned)window_ms,
+		       (double)(t1 - t0) / kIterations, sum);
+		CHECK(sum > 0);
+	}
+
+	m_ff_vec3_f32_free(&ff);
+}
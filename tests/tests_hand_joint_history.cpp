@@ -0,0 +1,314 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Hand joint history tests.
+ */
+
+#include "math/m_api.h"
+#include "math/m_hand_joint_history.h"
+#include "math/m_space.h"
+#include "math/m_vec3.h"
+
+#include "os/os_time.h"
+#include "util/u_time.h"
+
+#include "catch/catch.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+
+namespace {
+
+constexpr uint64_t kSecondNs = U_TIME_1S_IN_NS;
+constexpr uint64_t kStartNs = 1000 * kSecondNs;
+
+// Cameras running at 60 fps.
+constexpr uint64_t kStepNs = kSecondNs / 60;
+
+constexpr xrt_space_relation_flags kPoseFlags = (xrt_space_relation_flags)( //
+    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |                            //
+    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT |                          //
+    XRT_SPACE_RELATION_POSITION_VALID_BIT |                               //
+    XRT_SPACE_RELATION_POSITION_TRACKED_BIT);
+
+//! Each joint moving in a straight line and spinning about its own axis, @p t seconds from the start.
+xrt_space_relation
+moving_joint(uint32_t joint, double t)
+{
+	float ft = (float)t;
+	float fj = (float)joint;
+
+	xrt_space_relation rel{};
+	rel.relation_flags = kPoseFlags;
+	rel.pose.position = {0.01f * fj + 0.3f * ft, 1.0f - 0.2f * ft, -0.5f + 0.02f * fj * ft};
+
+	xrt_vec3 axis = m_vec3_normalize({1.0f, (float)(joint % 3), 1.0f});
+	math_quat_from_angle_vector(0.1f * fj + 2.0f * ft, &axis, &rel.pose.orientation);
+	return rel;
+}
+
+xrt_hand_joint_set
+moving_hand(double t)
+{
+	xrt_hand_joint_set set{};
+	for (uint32_t j = 0; j < XRT_HAND_JOINT_COUNT; j++) {
+		set.values.hand_joint_set_default[j].relation = moving_joint(j, t);
+		set.values.hand_joint_set_default[j].radius = 0.01f;
+	}
+	set.hand_pose = moving_joint(XRT_HAND_JOINT_COUNT, t);
+	set.is_active = true;
+	return set;
+}
+
+double
+seconds_at(uint64_t timestamp_ns)
+{
+	return (double)(timestamp_ns - kStartNs) / (double)kSecondNs;
+}
+
+//! From the chord between the quaternions, acos of the dot is too coarse near one.
+float
+angle_between(const xrt_quat &a, const xrt_quat &b)
+{
+	float sign = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0.0f ? -1.0f : 1.0f;
+	float dx = a.x - sign * b.x;
+	float dy = a.y - sign * b.y;
+	float dz = a.z - sign * b.z;
+	float dw = a.w - sign * b.w;
+	float chord = std::sqrt(dx * dx + dy * dy + dz * dz + dw * dw);
+	return 4.0f * std::asin(std::fmin(chord * 0.5f, 1.0f));
+}
+
+struct Error
+{
+	float position = 0.0f;
+	float angle = 0.0f;
+};
+
+//! Largest error of any joint and the hand pose against the moving hand.
+Error
+error_against(const xrt_hand_joint_set &set, double t)
+{
+	xrt_hand_joint_set truth = moving_hand(t);
+
+	Error e;
+	auto add = [&](const xrt_space_relation &got, const xrt_space_relation &expected) {
+		e.position = std::fmax(e.position, m_vec3_len(got.pose.position - expected.pose.position));
+		e.angle = std::fmax(e.angle, angle_between(got.pose.orientation, expected.pose.orientation));
+	};
+
+	for (uint32_t j = 0; j < XRT_HAND_JOINT_COUNT; j++) {
+		add(set.values.hand_joint_set_default[j].relation, truth.values.hand_joint_set_default[j].relation);
+	}
+	add(set.hand_pose, truth.hand_pose);
+	return e;
+}
+
+void
+push_hands(m_hand_joint_history *hjh, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		uint64_t ts = kStartNs + i * kStepNs;
+		xrt_hand_joint_set set = moving_hand(seconds_at(ts));
+		REQUIRE(m_hand_joint_history_push(hjh, &set, ts));
+	}
+}
+
+} // namespace
+
+
+TEST_CASE("m_hand_joint_history")
+{
+	m_hand_joint_history *hjh = nullptr;
+	m_hand_joint_history_create(&hjh);
+
+	xrt_hand_joint_set out{};
+
+	SECTION("Empty history")
+	{
+		out.is_active = true;
+		CHECK(m_hand_joint_history_get(hjh, kStartNs, &out) == M_RELATION_HISTORY_RESULT_INVALID);
+		CHECK_FALSE(out.is_active);
+		CHECK(out.values.hand_joint_set_default[0].relation.relation_flags == 0);
+
+		uint64_t ts = 0;
+		CHECK_FALSE(m_hand_joint_history_get_latest(hjh, &ts, &out));
+	}
+
+	SECTION("Timestamps must increase")
+	{
+		push_hands(hjh, 2);
+		xrt_hand_joint_set set = moving_hand(0.0);
+		CHECK_FALSE(m_hand_joint_history_push(hjh, &set, kStartNs + kStepNs));
+		CHECK_FALSE(m_hand_joint_history_push(hjh, &set, kStartNs));
+		CHECK(m_hand_joint_history_get_size(hjh) == 2);
+	}
+
+	SECTION("Exact and interpolated")
+	{
+		push_hands(hjh, 10);
+
+		uint64_t ts = kStartNs + 4 * kStepNs;
+		CHECK(m_hand_joint_history_get(hjh, ts, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+		Error exact = error_against(out, seconds_at(ts));
+		CHECK(exact.position == 0.0f);
+		CHECK(exact.angle < 1e-6f);
+		CHECK(out.is_active);
+		CHECK(out.values.hand_joint_set_default[3].radius == 0.01f);
+
+		for (uint64_t offset : {kStepNs / 4, kStepNs / 2, kStepNs - 1}) {
+			CAPTURE(offset);
+			ts = kStartNs + 4 * kStepNs + offset;
+			CHECK(m_hand_joint_history_get(hjh, ts, &out) == M_RELATION_HISTORY_RESULT_INTERPOLATED);
+			Error e = error_against(out, seconds_at(ts));
+			CHECK(e.position < 1e-5f);
+			CHECK(e.angle < 1e-4f);
+			CHECK(out.hand_pose.relation_flags == kPoseFlags);
+		}
+
+		// Matches the single relation interpolation, which slerps.
+		ts = kStartNs + 4 * kStepNs + kStepNs / 3;
+		m_hand_joint_history_get(hjh, ts, &out);
+		xrt_space_relation a = moving_joint(7, seconds_at(kStartNs + 4 * kStepNs));
+		xrt_space_relation b = moving_joint(7, seconds_at(kStartNs + 5 * kStepNs));
+		xrt_space_relation expected{};
+		m_space_relation_interpolate(&a, &b, 1.0f / 3.0f, kPoseFlags, &expected);
+		const xrt_space_relation &got = out.values.hand_joint_set_default[7].relation;
+		CHECK(m_vec3_len(got.pose.position - expected.pose.position) < 1e-5f);
+		CHECK(angle_between(got.pose.orientation, expected.pose.orientation) < 1e-4f);
+
+		// Before the oldest.
+		CHECK(m_hand_joint_history_get(hjh, kStartNs - 1, &out) == M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED);
+		CHECK(error_against(out, 0.0).position == 0.0f);
+	}
+
+	SECTION("Predicted")
+	{
+		push_hands(hjh, 10);
+
+		uint64_t newest_ts = 0;
+		xrt_hand_joint_set newest{};
+		REQUIRE(m_hand_joint_history_get_latest(hjh, &newest_ts, &newest));
+		CHECK(newest_ts == kStartNs + 9 * kStepNs);
+
+		uint64_t ts = newest_ts + 20 * U_TIME_1MS_IN_NS;
+		CHECK(m_hand_joint_history_get(hjh, ts, &out) == M_RELATION_HISTORY_RESULT_PREDICTED);
+
+		// Much closer than handing out the newest joints.
+		Error predicted = error_against(out, seconds_at(ts));
+		Error stale = error_against(newest, seconds_at(ts));
+		CHECK(predicted.position < 1e-5f);
+		CHECK(predicted.angle < stale.angle / 10.0f);
+
+		// Held at the maximum prediction.
+		uint64_t limit_ts = newest_ts + M_HAND_JOINT_HISTORY_DEFAULT_MAX_PREDICTION_NS;
+		xrt_hand_joint_set at_limit{};
+		m_hand_joint_history_get(hjh, limit_ts, &at_limit);
+		m_hand_joint_history_get(hjh, limit_ts + kSecondNs, &out);
+		Error held = error_against(out, seconds_at(limit_ts));
+		CHECK(held.position == error_against(at_limit, seconds_at(limit_ts)).position);
+		CHECK(held.position < 1e-5f);
+	}
+
+	SECTION("Orientations of opposite sign")
+	{
+		// The same orientations, the second set written the other way round.
+		xrt_hand_joint_set first = moving_hand(0.0);
+		xrt_hand_joint_set second = moving_hand(kStepNs / (double)kSecondNs);
+		for (auto &value : second.values.hand_joint_set_default) {
+			xrt_quat &q = value.relation.pose.orientation;
+			q = {-q.x, -q.y, -q.z, -q.w};
+		}
+		m_hand_joint_history_push(hjh, &first, kStartNs);
+		m_hand_joint_history_push(hjh, &second, kStartNs + kStepNs);
+
+		uint64_t ts = kStartNs + kStepNs / 2;
+		m_hand_joint_history_get(hjh, ts, &out);
+		CHECK(error_against(out, seconds_at(ts)).angle < 1e-4f);
+	}
+
+	SECTION("Hand lost")
+	{
+		push_hands(hjh, 2);
+		xrt_hand_joint_set lost{};
+		m_hand_joint_history_push(hjh, &lost, kStartNs + 2 * kStepNs);
+
+		// The nearest set, never half a hand.
+		m_hand_joint_history_get(hjh, kStartNs + kStepNs + kStepNs / 4, &out);
+		CHECK(out.is_active);
+		CHECK(error_against(out, seconds_at(kStartNs + kStepNs)).position == 0.0f);
+
+		m_hand_joint_history_get(hjh, kStartNs + 2 * kStepNs - kStepNs / 4, &out);
+		CHECK_FALSE(out.is_active);
+
+		// Not predicted from a hand that isn't there.
+		uint64_t ts = kStartNs + 3 * kStepNs;
+		CHECK(m_hand_joint_history_get(hjh, ts, &out) == M_RELATION_HISTORY_RESULT_PREDICTED);
+		CHECK_FALSE(out.is_active);
+	}
+
+	SECTION("Full history")
+	{
+		push_hands(hjh, M_HAND_JOINT_HISTORY_DEFAULT_CAPACITY + 5);
+		CHECK(m_hand_joint_history_get_size(hjh) == M_HAND_JOINT_HISTORY_DEFAULT_CAPACITY);
+
+		uint64_t oldest_ts = kStartNs + 5 * kStepNs;
+		CHECK(m_hand_joint_history_get(hjh, oldest_ts, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+		CHECK(m_hand_joint_history_get(hjh, oldest_ts - 1, &out) ==
+		      M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED);
+
+		uint64_t ts = oldest_ts + 7 * kStepNs + kStepNs / 2;
+		CHECK(m_hand_joint_history_get(hjh, ts, &out) == M_RELATION_HISTORY_RESULT_INTERPOLATED);
+		CHECK(error_against(out, seconds_at(ts)).position < 1e-5f);
+
+		m_hand_joint_history_clear(hjh);
+		CHECK(m_hand_joint_history_get_size(hjh) == 0);
+	}
+
+	m_hand_joint_history_destroy(&hjh);
+	CHECK(hjh == nullptr);
+}
+
+TEST_CASE("m_hand_joint_history_benchmark", "[.benchmark]")
+{
+	// Interpolating a whole hand, against doing each joint on its own.
+	constexpr int kIterations = 100000;
+
+	m_hand_joint_history *hjh = nullptr;
+	m_hand_joint_history_create(&hjh);
+	push_hands(hjh, M_HAND_JOINT_HISTORY_DEFAULT_CAPACITY);
+
+	xrt_hand_joint_set a = moving_hand(0.0);
+	xrt_hand_joint_set b = moving_hand(kStepNs / (double)kSecondNs);
+	xrt_hand_joint_set out{};
+	float sum = 0;
+
+	uint64_t t0 = os_monotonic_get_ns();
+	for (int i = 0; i < kIterations; i++) {
+		float t = (float)(i % 100) / 100.0f;
+		for (uint32_t j = 0; j < XRT_HAND_JOINT_COUNT; j++) {
+			m_space_relation_interpolate(&a.values.hand_joint_set_default[j].relation,
+			                             &b.values.hand_joint_set_default[j].relation, t, kPoseFlags,
+			                             &out.values.hand_joint_set_default[j].relation);
+		}
+		m_space_relation_interpolate(&a.hand_pose, &b.hand_pose, t, kPoseFlags, &out.hand_pose);
+		sum += out.values.hand_joint_set_default[XRT_HAND_JOINT_INDEX_TIP].relation.pose.position.x;
+	}
+	uint64_t t1 = os_monotonic_get_ns();
+
+	uint64_t newest_ts = kStartNs + (M_HAND_JOINT_HISTORY_DEFAULT_CAPACITY - 1) * kStepNs;
+	for (int i = 0; i < kIterations; i++) {
+		uint64_t ts = newest_ts - (uint64_t)(i % 100) * (kStepNs / 10);
+		m_hand_joint_history_get(hjh, ts, &out);
+		sum += out.values.hand_joint_set_default[XRT_HAND_JOINT_INDEX_TIP].relation.pose.position.x;
+	}
+	uint64_t t2 = os_monotonic_get_ns();
+
+	printf("m_hand_joint_history: per joint %.1f ns, history get %.1f ns per hand (%f)\n",
+	       (double)(t1 - t0) / kIterations, (double)(t2 - t1) / kIterations, sum);
+	CHECK(std::isfinite(sum));
+
+	m_hand_joint_history_destroy(&hjh);
+}
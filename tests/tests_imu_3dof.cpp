@@ -0,0 +1,200 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief 3dof IMU fusion batch update tests.
+ */
+
+#include "math/m_api.h"
+#include "math/m_imu_3dof.h"
+#include "math/m_vec3.h"
+
+#include "os/os_time.h"
+#include "util/u_time.h"
+
+#include "catch/catch.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+constexpr uint64_t kSecondNs = U_TIME_1S_IN_NS;
+constexpr uint64_t kStartNs = 1000 * kSecondNs;
+
+/*!
+ * A head turning about with some noise on the sensors, with a still second
+ * every few seconds so that the gravity correction kicks in.
+ */
+std::vector<m_imu_3dof_sample>
+make_stream(uint32_t rate_hz, double duration_s)
+{
+	std::mt19937 rng(3);
+	std::normal_distribution<float> noise(0.0f, 0.01f);
+
+	uint64_t step_ns = kSecondNs / rate_hz;
+	uint32_t count = (uint32_t)(duration_s * rate_hz);
+
+	std::vector<m_imu_3dof_sample> samples(count);
+	for (uint32_t i = 0; i < count; i++) {
+		double t = (double)i / rate_hz;
+		bool still = std::fmod(t, 4.0) > 3.0;
+
+		m_imu_3dof_sample &s = samples[i];
+		s.timestamp_ns = kStartNs + i * step_ns;
+		s.accel = {noise(rng), 9.81f + noise(rng), noise(rng)};
+		s.gyro = {noise(rng), noise(rng), noise(rng)};
+		if (!still) {
+			s.gyro.x += 0.4f * (float)std::sin(1.3 * t);
+			s.gyro.y += 1.5f * (float)std::sin(0.7 * t);
+			s.gyro.z += 0.3f * (float)std::cos(2.1 * t);
+		}
+	}
+	return samples;
+}
+
+//! From the chord between the quaternions, acos of the dot is too coarse near one.
+float
+angle_between(const xrt_quat &a, const xrt_quat &b)
+{
+	float sign = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0.0f ? -1.0f : 1.0f;
+	float dx = a.x - sign * b.x;
+	float dy = a.y - sign * b.y;
+	float dz = a.z - sign * b.z;
+	float dw = a.w - sign * b.w;
+	float chord = std::sqrt(dx * dx + dy * dy + dz * dz + dw * dw);
+	return 4.0f * std::asin(std::fmin(chord * 0.5f, 1.0f));
+}
+
+void
+run_scalar(m_imu_3dof &f, const std::vector<m_imu_3dof_sample> &samples, std::vector<xrt_quat> &out_rots)
+{
+	for (size_t i = 0; i < samples.size(); i++) {
+		m_imu_3dof_update(&f, samples[i].timestamp_ns, &samples[i].accel, &samples[i].gyro);
+		out_rots[i] = f.rot;
+	}
+}
+
+void
+run_batch(m_imu_3dof &f,
+          const std::vector<m_imu_3dof_sample> &samples,
+          uint32_t batch_size,
+          std::vector<xrt_quat> &out_rots)
+{
+	for (size_t i = 0; i < samples.size(); i += batch_size) {
+		uint32_t count = (uint32_t)std::min<size_t>(batch_size, samples.size() - i);
+		m_imu_3dof_update_batch(&f, &samples[i], count, &out_rots[i]);
+	}
+}
+
+} // namespace
+
+
+TEST_CASE("m_imu_3dof_update_batch")
+{
+	std::vector<m_imu_3dof_sample> samples = make_stream(1000, 10.0);
+	std::vector<xrt_quat> scalar_rots(samples.size());
+	std::vector<xrt_quat> batch_rots(samples.size());
+
+	m_imu_3dof scalar;
+	m_imu_3dof_init(&scalar, M_IMU_3DOF_USE_GRAVITY_DUR_300MS);
+	run_scalar(scalar, samples, scalar_rots);
+
+	// A report's worth, a whole chunk with a tail and more than one chunk.
+	for (uint32_t batch_size : {1, 3, 35, 100}) {
+		CAPTURE(batch_size);
+
+		m_imu_3dof batch;
+		m_imu_3dof_init(&batch, M_IMU_3DOF_USE_GRAVITY_DUR_300MS);
+		run_batch(batch, samples, batch_size, batch_rots);
+
+		float max_error = 0.0f;
+		for (size_t i = 0; i < samples.size(); i++) {
+			max_error = std::fmax(max_error, angle_between(scalar_rots[i], batch_rots[i]));
+		}
+		CHECK(max_error < 1e-4f);
+
+		CHECK(batch.last.timestamp_ns == scalar.last.timestamp_ns);
+		CHECK(batch.last.delta_ms == Approx(scalar.last.delta_ms));
+		CHECK(batch.last.gyro_biased_length == Approx(scalar.last.gyro_biased_length));
+		CHECK(batch.grav.level_timestamp_ns == scalar.grav.level_timestamp_ns);
+
+		float norm = m_vec3_len({batch.rot.x, batch.rot.y, batch.rot.z});
+		CHECK(std::sqrt(norm * norm + batch.rot.w * batch.rot.w) == Approx(1.0f).margin(1e-6));
+
+		m_imu_3dof_close(&batch);
+	}
+
+	m_imu_3dof_close(&scalar);
+}
+
+TEST_CASE("m_imu_3dof_update_batch_gap")
+{
+	// Fast turning with a gap, past where the series hold up.
+	m_imu_3dof_sample samples[3] = {};
+	samples[0].timestamp_ns = kStartNs;
+	samples[1].timestamp_ns = kStartNs + kSecondNs / 2;
+	samples[2].timestamp_ns = kStartNs + kSecondNs / 2 + U_TIME_1MS_IN_NS;
+	for (m_imu_3dof_sample &s : samples) {
+		s.accel = {0.0f, 9.81f, 0.0f};
+		s.gyro = {0.0f, 3.0f, 0.0f};
+	}
+
+	m_imu_3dof scalar;
+	m_imu_3dof batch;
+	m_imu_3dof_init(&scalar, 0);
+	m_imu_3dof_init(&batch, 0);
+
+	xrt_quat rots[3];
+	m_imu_3dof_update_batch(&batch, samples, 3, rots);
+	for (const m_imu_3dof_sample &s : samples) {
+		m_imu_3dof_update(&scalar, s.timestamp_ns, &s.accel, &s.gyro);
+	}
+
+	// The first sample only starts the fusion.
+	CHECK(rots[0].w == 1.0f);
+	CHECK(angle_between(rots[2], scalar.rot) < 1e-5f);
+	CHECK(angle_between(rots[1], rots[0]) == Approx(1.5f).margin(1e-4));
+
+	m_imu_3dof_close(&scalar);
+	m_imu_3dof_close(&batch);
+}
+
+TEST_CASE("m_imu_3dof_benchmark", "[.benchmark]")
+{
+	// Best of a few runs, the machine running the tests is likely busy.
+	constexpr int kRuns = 5;
+
+	for (uint32_t rate_hz : {1000, 2000}) {
+		std::vector<m_imu_3dof_sample> samples = make_stream(rate_hz, 20.0);
+		std::vector<xrt_quat> rots(samples.size());
+
+		// Zero is scalar.
+		for (uint32_t batch_size : {0, 3, 16}) {
+			uint64_t best_ns = UINT64_MAX;
+			for (int run = 0; run < kRuns; run++) {
+				m_imu_3dof f;
+				m_imu_3dof_init(&f, M_IMU_3DOF_USE_GRAVITY_DUR_300MS);
+
+				uint64_t t0 = os_monotonic_get_ns();
+				if (batch_size == 0) {
+					run_scalar(f, samples, rots);
+				} else {
+					run_batch(f, samples, batch_size, rots);
+				}
+				uint64_t t1 = os_monotonic_get_ns();
+
+				best_ns = std::min(best_ns, t1 - t0);
+				m_imu_3dof_close(&f);
+			}
+
+			printf("m_imu_3dof: %u Hz, batch of %2u, %.1f ns per sample\n", rate_hz, batch_size,
+			       (double)best_ns / samples.size());
+		}
+
+		CHECK(std::isfinite(rots.back().w));
+	}
+}
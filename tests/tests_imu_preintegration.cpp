@@ -0,0 +1,302 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief IMU preintegration tests.
+ */
+
+#include "math/m_api.h"
+#include "math/m_filter_fifo.h"
+#include "math/m_imu_preintegration.h"
+#include "math/m_vec3.h"
+
+#include "os/os_time.h"
+
+#include "catch/catch.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+
+namespace {
+
+constexpr timepoint_ns kImuPeriodNs = U_TIME_1MS_IN_NS;
+constexpr xrt_vec3 kGravity{0, 0, -MATH_GRAVITY_M_S2};
+
+xrt_vec3
+gyro_at(timepoint_ns ts)
+{
+	float t = (float)time_ns_to_s(ts);
+	return {0.8f * std::sin(t * 3), 0.5f * std::cos(t * 2), 1.2f * std::sin(t)};
+}
+
+xrt_vec3
+accel_at(timepoint_ns ts)
+{
+	float t = (float)time_ns_to_s(ts);
+	return {std::sin(t * 5), 0.3f * std::cos(t * 7), (float)MATH_GRAVITY_M_S2 + 0.2f * std::sin(t * 11)};
+}
+
+xrt_space_relation
+base_relation()
+{
+	xrt_space_relation rel{};
+	rel.pose.orientation = {0.1f, 0.2f, -0.3f, 0.9f};
+	math_quat_normalize(&rel.pose.orientation);
+	rel.pose.position = {0.5f, 1.6f, -0.2f};
+	rel.linear_velocity = {0.3f, -0.1f, 0.05f};
+	rel.angular_velocity = {0.1f, 0.0f, 0.2f};
+	return rel;
+}
+
+/*!
+ * Walks the gyroscope and accelerometer fifos like the SLAM tracker did
+ * before it kept the samples preintegrated.
+ */
+xrt_space_relation
+integrate_fifo(m_ff_vec3_f32 *gyro_ff,
+               m_ff_vec3_f32 *accel_ff,
+               xrt_space_relation base_rel,
+               timepoint_ns base_ts,
+               timepoint_ns when_ns,
+               timepoint_ns *out_ts)
+{
+	// Oldest sample that is not older than base_ts, or -1.
+	int i = -1;
+	uint64_t ts = 0;
+	xrt_vec3 _;
+	while (m_ff_vec3_f32_get(gyro_ff, i + 1, &_, &ts) && (timepoint_ns)ts >= base_ts) {
+		i++;
+	}
+
+	xrt_space_relation rel = base_rel;
+	timepoint_ns rel_ts = base_ts;
+	xrt_quat &o = rel.pose.orientation;
+
+	for (; i >= 0; i--) {
+		xrt_vec3 g{};
+		xrt_vec3 a{};
+		m_ff_vec3_f32_get(gyro_ff, i, &g, &ts);
+		m_ff_vec3_f32_get(accel_ff, i, &a, &ts);
+
+		bool clamped = (timepoint_ns)ts > when_ns;
+		timepoint_ns sample_ts = clamped ? when_ns : (timepoint_ns)ts;
+
+		float dt = (float)time_ns_to_s(sample_ts - rel_ts);
+		rel_ts = sample_ts;
+
+		xrt_quat angvel_delta{};
+		xrt_vec3 scaled_half_g = g * dt * 0.5f;
+		math_quat_exp(&scaled_half_g, &angvel_delta);
+		math_quat_rotate(&o, &angvel_delta, &o);
+		math_quat_rotate_derivative(&o, &g, &rel.angular_velocity);
+
+		xrt_vec3 world_accel{};
+		math_quat_rotate_vec3(&o, &a, &world_accel);
+		world_accel += kGravity;
+		rel.linear_velocity += world_accel * dt;
+		rel.pose.position += rel.linear_velocity * dt + world_accel * (dt * dt * 0.5f);
+
+		if (clamped) {
+			break;
+		}
+	}
+
+	*out_ts = rel_ts;
+	return rel;
+}
+
+bool
+relations_close(const xrt_space_relation &a, const xrt_space_relation &b, float eps)
+{
+	auto close = [eps](const xrt_vec3 &x, const xrt_vec3 &y) { return m_vec3_len(x - y) < eps; };
+
+	const xrt_quat &qa = a.pose.orientation;
+	const xrt_quat &qb = b.pose.orientation;
+	float dot = std::fabs(qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w);
+
+	return dot > 1.0f - eps && close(a.pose.position, b.pose.position) &&
+	       close(a.linear_velocity, b.linear_velocity) && close(a.angular_velocity, b.angular_velocity);
+}
+
+struct Fixture
+{
+	m_ff_vec3_f32 *gyro_ff = nullptr;
+	m_ff_vec3_f32 *accel_ff = nullptr;
+	m_imu_preint preint;
+
+	Fixture()
+	{
+		m_ff_vec3_f32_alloc(&gyro_ff, 1000);
+		m_ff_vec3_f32_alloc(&accel_ff, 1000);
+		m_imu_preint_init(&preint);
+	}
+
+	~Fixture()
+	{
+		m_ff_vec3_f32_free(&gyro_ff);
+		m_ff_vec3_f32_free(&accel_ff);
+	}
+
+	void
+	push(timepoint_ns ts)
+	{
+		xrt_vec3 g = gyro_at(ts);
+		xrt_vec3 a = accel_at(ts);
+		m_ff_vec3_f32_push(gyro_ff, &g, ts);
+		m_ff_vec3_f32_push(accel_ff, &a, ts);
+		m_imu_preint_push(&preint, ts, &g, &a);
+	}
+
+	xrt_space_relation
+	preintegrated(xrt_space_relation base_rel, timepoint_ns base_ts, timepoint_ns when_ns, timepoint_ns *out_ts)
+	{
+		m_imu_preint_delta delta{};
+		m_imu_preint_set_base(&preint, base_ts);
+		m_imu_preint_get(&preint, when_ns, &delta, out_ts);
+
+		xrt_space_relation rel{};
+		m_imu_preint_apply(&delta, &base_rel, &kGravity, &rel);
+		return rel;
+	}
+};
+
+} // namespace
+
+
+TEST_CASE("imu_preintegration")
+{
+	Fixture f;
+	xrt_space_relation base_rel = base_relation();
+
+	SECTION("No samples leaves the base untouched")
+	{
+		timepoint_ns ts = 0;
+		m_imu_preint_delta delta{};
+		m_imu_preint_set_base(&f.preint, 10 * kImuPeriodNs);
+		CHECK_FALSE(m_imu_preint_get(&f.preint, 20 * kImuPeriodNs, &delta, &ts));
+		CHECK(ts == 10 * kImuPeriodNs);
+		CHECK(delta.sample_count == 0);
+
+		xrt_space_relation rel{};
+		m_imu_preint_apply(&delta, &base_rel, &kGravity, &rel);
+		CHECK(relations_close(rel, base_rel, 1e-6f));
+	}
+
+	SECTION("Matches integrating the fifo")
+	{
+		timepoint_ns start = U_TIME_1S_IN_NS;
+		for (int i = 0; i < 200; i++) {
+			f.push(start + i * kImuPeriodNs);
+		}
+
+		bool all_close = true;
+		bool same_ts = true;
+
+		// Bases on, between and before samples, queries straddling samples and past the last one.
+		for (timepoint_ns base_offset : {30 * kImuPeriodNs, 100 * kImuPeriodNs + 300000, 150 * kImuPeriodNs}) {
+			timepoint_ns base_ts = start + base_offset;
+			for (timepoint_ns when_ns = base_ts; when_ns < start + 210 * kImuPeriodNs; when_ns += 700000) {
+				timepoint_ns ref_ts = 0;
+				timepoint_ns ts = 0;
+				xrt_space_relation ref =
+				    integrate_fifo(f.gyro_ff, f.accel_ff, base_rel, base_ts, when_ns, &ref_ts);
+				xrt_space_relation rel = f.preintegrated(base_rel, base_ts, when_ns, &ts);
+
+				all_close &= relations_close(ref, rel, 1e-3f);
+				same_ts &= ref_ts == ts;
+			}
+		}
+
+		CHECK(all_close);
+		CHECK(same_ts);
+	}
+
+	SECTION("Samples pushed after the base are integrated incrementally")
+	{
+		timepoint_ns start = U_TIME_1S_IN_NS;
+		timepoint_ns base_ts = start + 5 * kImuPeriodNs;
+		for (int i = 0; i < 10; i++) {
+			f.push(start + i * kImuPeriodNs);
+		}
+		m_imu_preint_set_base(&f.preint, base_ts);
+		CHECK(f.preint.count == 5);
+
+		bool all_close = true;
+		for (int i = 10; i < 100; i++) {
+			f.push(start + i * kImuPeriodNs);
+
+			timepoint_ns when_ns = start + i * kImuPeriodNs;
+			timepoint_ns ref_ts = 0;
+			timepoint_ns ts = 0;
+			xrt_space_relation ref =
+			    integrate_fifo(f.gyro_ff, f.accel_ff, base_rel, base_ts, when_ns, &ref_ts);
+			xrt_space_relation rel = f.preintegrated(base_rel, base_ts, when_ns, &ts);
+			all_close &= relations_close(ref, rel, 1e-3f);
+		}
+		CHECK(all_close);
+
+		// Old and repeated samples are ignored.
+		uint32_t count = f.preint.count;
+		xrt_vec3 zero{};
+		m_imu_preint_push(&f.preint, start, &zero, &zero);
+		m_imu_preint_push(&f.preint, start + 99 * kImuPeriodNs, &zero, &zero);
+		CHECK(f.preint.count == count);
+	}
+}
+
+TEST_CASE("imu_preintegration_benchmark", "[.benchmark]")
+{
+	/*
+	 * A 1000 Hz IMU and a SLAM pose 50 ms old, queried for a pose 20 ms in
+	 * the future several times per IMU sample like an application would.
+	 */
+	constexpr int kSamples = 5000;
+	constexpr int kQueriesPerSample = 4;
+	constexpr timepoint_ns kBaseAgeNs = 50 * U_TIME_1MS_IN_NS;
+	constexpr timepoint_ns kPredictNs = 20 * U_TIME_1MS_IN_NS;
+
+	Fixture f;
+	xrt_space_relation base_rel = base_relation();
+	timepoint_ns start = U_TIME_1S_IN_NS;
+
+	// Keeps the optimizer from dropping the work.
+	float sink_fifo = 0.0f;
+	float sink_preint = 0.0f;
+	uint64_t fifo_ns = 0;
+	uint64_t preint_ns = 0;
+
+	for (int i = 0; i < kSamples; i++) {
+		timepoint_ns now = start + i * kImuPeriodNs;
+		f.push(now);
+
+		if (i * kImuPeriodNs < kBaseAgeNs) {
+			continue;
+		}
+
+		// A new SLAM pose every 33 samples.
+		timepoint_ns base_ts = now - kBaseAgeNs - (i % 33) * kImuPeriodNs;
+
+		for (int q = 0; q < kQueriesPerSample; q++) {
+			timepoint_ns when_ns = now + kPredictNs;
+			timepoint_ns ts = 0;
+
+			uint64_t t0 = os_monotonic_get_ns();
+			xrt_space_relation ref = integrate_fifo(f.gyro_ff, f.accel_ff, base_rel, base_ts, when_ns, &ts);
+			uint64_t t1 = os_monotonic_get_ns();
+			xrt_space_relation rel = f.preintegrated(base_rel, base_ts, when_ns, &ts);
+			uint64_t t2 = os_monotonic_get_ns();
+
+			fifo_ns += t1 - t0;
+			preint_ns += t2 - t1;
+			sink_fifo += ref.pose.position.x;
+			sink_preint += rel.pose.position.x;
+		}
+	}
+
+	int queries = (kSamples - (int)(kBaseAgeNs / kImuPeriodNs)) * kQueriesPerSample;
+	printf("imu_preintegration: %d queries, fifo walk %.3f us/query, preintegrated %.3f us/query\n", queries,
+	       (double)fifo_ns / queries / 1000.0, (double)preint_ns / queries / 1000.0);
+
+	CHECK(std::fabs(sink_fifo - sink_preint) < std::fabs(sink_fifo) * 1e-3f + 1e-3f);
+}
@@ -0,0 +1,414 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Batch math function tests.
+ */
+
+#include "math/m_api.h"
+#include "math/m_batch.h"
+#include "math/m_space.h"
+#include "math/m_vec3.h"
+
+#include "os/os_time.h"
+#include "util/u_hand_tracking.h"
+
+#include "catch/catch.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+constexpr float kEpsilon = 1e-5f;
+
+struct Quats
+{
+	std::vector<float> x, y, z, w;
+
+	explicit Quats(size_t n) : x(n), y(n), z(n), w(n) {}
+
+	m_quat_soa
+	soa()
+	{
+		return {x.data(), y.data(), z.data(), w.data()};
+	}
+
+	xrt_quat
+	get(size_t i) const
+	{
+		return {x[i], y[i], z[i], w[i]};
+	}
+
+	void
+	set(size_t i, const xrt_quat &q)
+	{
+		x[i] = q.x;
+		y[i] = q.y;
+		z[i] = q.z;
+		w[i] = q.w;
+	}
+};
+
+struct Vecs
+{
+	std::vector<float> x, y, z;
+
+	explicit Vecs(size_t n) : x(n), y(n), z(n) {}
+
+	m_vec3_soa
+	soa()
+	{
+		return {x.data(), y.data(), z.data()};
+	}
+
+	xrt_vec3
+	get(size_t i) const
+	{
+		return {x[i], y[i], z[i]};
+	}
+
+	void
+	set(size_t i, const xrt_vec3 &v)
+	{
+		x[i] = v.x;
+		y[i] = v.y;
+		z[i] = v.z;
+	}
+};
+
+struct Random
+{
+	std::mt19937 gen{1234};
+	std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+
+	float
+	next()
+	{
+		return dist(gen);
+	}
+
+	xrt_vec3
+	vec3()
+	{
+		return {next(), next(), next()};
+	}
+
+	xrt_quat
+	quat()
+	{
+		xrt_quat q = {next(), next(), next(), next()};
+		math_quat_normalize(&q);
+		return q;
+	}
+
+	xrt_space_relation
+	relation(int flags)
+	{
+		xrt_space_relation r = {};
+		r.relation_flags = (xrt_space_relation_flags)flags;
+		r.pose.orientation = quat();
+		r.pose.position = vec3();
+		r.linear_velocity = vec3();
+		r.angular_velocity = vec3();
+		return r;
+	}
+};
+
+bool
+close(const xrt_vec3 &a, const xrt_vec3 &b)
+{
+	return m_vec3_len(a - b) < kEpsilon;
+}
+
+bool
+close(const xrt_quat &a, const xrt_quat &b)
+{
+	return std::fabs(a.x - b.x) < kEpsilon && std::fabs(a.y - b.y) < kEpsilon && std::fabs(a.z - b.z) < kEpsilon &&
+	       std::fabs(a.w - b.w) < kEpsilon;
+}
+
+//! Compares the flags and the components they mark as valid.
+bool
+close(const xrt_space_relation &a, const xrt_space_relation &b)
+{
+	int f = a.relation_flags;
+	bool ok = a.relation_flags == b.relation_flags;
+
+	if (f & XRT_SPACE_RELATION_ORIENTATION_VALID_BIT) {
+		ok &= close(a.pose.orientation, b.pose.orientation);
+	}
+	if (f & XRT_SPACE_RELATION_POSITION_VALID_BIT) {
+		ok &= close(a.pose.position, b.pose.position);
+	}
+	if (f & XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT) {
+		ok &= close(a.linear_velocity, b.linear_velocity);
+	}
+	if (f & XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT) {
+		ok &= close(a.angular_velocity, b.angular_velocity);
+	}
+
+	return ok;
+}
+
+void
+resolve_scalar(const xrt_relation_chain &xrc, const xrt_space_relation &r, xrt_space_relation &out)
+{
+	xrt_relation_chain chain = {};
+	m_relation_chain_push_relation(&chain, &r);
+	for (uint32_t i = 0; i < xrc.step_count; i++) {
+		m_relation_chain_push_relation(&chain, &xrc.steps[i]);
+	}
+	m_relation_chain_resolve(&chain, &out);
+}
+
+constexpr int kPoseFlags = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT | XRT_SPACE_RELATION_POSITION_VALID_BIT;
+constexpr int kTrackedFlags =
+    kPoseFlags | XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT | XRT_SPACE_RELATION_POSITION_TRACKED_BIT;
+constexpr int kAllFlags = XRT_SPACE_RELATION_BITMASK_ALL;
+
+} // namespace
+
+
+TEST_CASE("math_batch_functions")
+{
+	Random rnd;
+
+	// Covers tails shorter than the vector width for every width.
+	for (uint32_t count : {0u, 1u, 3u, 4u, 7u, 8u, 9u, 26u, 37u}) {
+		Quats qa(count), qb(count), q_out(count);
+		Vecs va(count), vb(count), v_out(count);
+
+		for (uint32_t i = 0; i < count; i++) {
+			qa.set(i, rnd.quat());
+			qb.set(i, rnd.quat());
+			va.set(i, rnd.vec3());
+			vb.set(i, rnd.vec3());
+		}
+
+		m_quat_soa qa_soa = qa.soa();
+		m_quat_soa qb_soa = qb.soa();
+		m_quat_soa q_out_soa = q_out.soa();
+		m_vec3_soa va_soa = va.soa();
+		m_vec3_soa vb_soa = vb.soa();
+		m_vec3_soa v_out_soa = v_out.soa();
+
+		bool rotate_ok = true;
+		m_batch_quat_rotate(&qa_soa, &qb_soa, &q_out_soa, count);
+		for (uint32_t i = 0; i < count; i++) {
+			xrt_quat l = qa.get(i);
+			xrt_quat r = qb.get(i);
+			xrt_quat expected;
+			math_quat_rotate(&l, &r, &expected);
+			rotate_ok &= close(q_out.get(i), expected);
+		}
+		CHECK(rotate_ok);
+
+		bool rotate_vec3_ok = true;
+		m_batch_quat_rotate_vec3(&qa_soa, &va_soa, &v_out_soa, count);
+		for (uint32_t i = 0; i < count; i++) {
+			xrt_quat q = qa.get(i);
+			xrt_vec3 v = va.get(i);
+			xrt_vec3 expected;
+			math_quat_rotate_vec3(&q, &v, &expected);
+			rotate_vec3_ok &= close(v_out.get(i), expected);
+		}
+		CHECK(rotate_vec3_ok);
+
+		bool transform_ok = true;
+		bool transform_single_ok = true;
+		m_pose_soa pa = {qa_soa, va_soa};
+		m_pose_soa pb = {qb_soa, vb_soa};
+		m_pose_soa p_out = {q_out_soa, v_out_soa};
+		xrt_pose single = {rnd.quat(), rnd.vec3()};
+
+		m_batch_pose_transform(&pa, &pb, &p_out, count);
+		for (uint32_t i = 0; i < count; i++) {
+			xrt_pose t = {qa.get(i), va.get(i)};
+			xrt_pose p = {qb.get(i), vb.get(i)};
+			xrt_pose expected;
+			math_pose_transform(&t, &p, &expected);
+			transform_ok &= close(q_out.get(i), expected.orientation);
+			transform_ok &= close(v_out.get(i), expected.position);
+		}
+
+		m_batch_pose_transform_single(&single, &pb, &p_out, count);
+		for (uint32_t i = 0; i < count; i++) {
+			xrt_pose p = {qb.get(i), vb.get(i)};
+			xrt_pose expected;
+			math_pose_transform(&single, &p, &expected);
+			transform_single_ok &= close(q_out.get(i), expected.orientation);
+			transform_single_ok &= close(v_out.get(i), expected.position);
+		}
+		CHECK(transform_ok);
+		CHECK(transform_single_ok);
+
+		// In place, with unnormalized and zero quaternions.
+		bool normalize_ok = true;
+		for (uint32_t i = 0; i < count; i++) {
+			xrt_quat q = qa.get(i);
+			float s = i == 0 ? 0.0f : 0.5f + (float)i;
+			qa.set(i, {q.x * s, q.y * s, q.z * s, q.w * s});
+		}
+		Quats expected = qa;
+		m_batch_quat_normalize(&qa_soa, count);
+		for (uint32_t i = 0; i < count; i++) {
+			xrt_quat e = expected.get(i);
+			math_quat_normalize(&e);
+			normalize_ok &= close(qa.get(i), e);
+		}
+		CHECK(normalize_ok);
+	}
+}
+
+TEST_CASE("math_batch_relation_chain")
+{
+	Random rnd;
+	constexpr uint32_t kCount = 40;
+
+	auto check_chain = [&](const xrt_relation_chain &xrc, const std::vector<xrt_space_relation> &in) {
+		std::vector<xrt_space_relation> out(in.size());
+		m_relation_chain_resolve_batch(&xrc, in.data(), out.data(), (uint32_t)in.size());
+
+		bool ok = true;
+		for (size_t i = 0; i < in.size(); i++) {
+			xrt_space_relation expected;
+			resolve_scalar(xrc, in[i], expected);
+			ok &= close(out[i], expected);
+		}
+		return ok;
+	};
+
+	SECTION("Same flags")
+	{
+		const int orientation_only = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT;
+		const int no_position = kAllFlags & ~XRT_SPACE_RELATION_POSITION_VALID_BIT;
+
+		for (int in_flags : {kAllFlags, kTrackedFlags, kPoseFlags, orientation_only}) {
+			for (int step_flags : {kAllFlags, kTrackedFlags, no_position}) {
+				std::vector<xrt_space_relation> in;
+				for (uint32_t i = 0; i < kCount; i++) {
+					in.push_back(rnd.relation(in_flags));
+				}
+
+				xrt_relation_chain xrc = {};
+				xrt_space_relation a = rnd.relation(kAllFlags);
+				xrt_space_relation b = rnd.relation(step_flags);
+				m_relation_chain_push_relation(&xrc, &a);
+				m_relation_chain_push_inverted_relation(&xrc, &b);
+				m_relation_chain_push_relation(&xrc, &a);
+
+				CAPTURE(in_flags, step_flags);
+				CHECK(check_chain(xrc, in));
+			}
+		}
+	}
+
+	SECTION("Mixed flags")
+	{
+		std::vector<xrt_space_relation> in;
+		for (uint32_t i = 0; i < kCount; i++) {
+			int flags = i % 3 == 0 ? kAllFlags : i % 3 == 1 ? kPoseFlags : 0;
+			in.push_back(rnd.relation(flags));
+		}
+
+		xrt_relation_chain xrc = {};
+		xrt_space_relation a = rnd.relation(kAllFlags);
+		m_relation_chain_push_relation(&xrc, &a);
+		CHECK(check_chain(xrc, in));
+	}
+
+	SECTION("Empty chain and steps without a pose")
+	{
+		std::vector<xrt_space_relation> in;
+		for (uint32_t i = 0; i < kCount; i++) {
+			in.push_back(rnd.relation(kAllFlags));
+		}
+
+		xrt_relation_chain empty = {};
+		CHECK(check_chain(empty, in));
+
+		xrt_relation_chain xrc = {};
+		xrt_space_relation a = rnd.relation(kAllFlags);
+		xrt_space_relation none = rnd.relation(0);
+		m_relation_chain_push_relation(&xrc, &a);
+		m_relation_chain_push_relation(&xrc, &none);
+		CHECK(check_chain(xrc, in));
+	}
+
+	SECTION("Hand joints")
+	{
+		xrt_hand_joint_set set = {};
+		for (int i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+			set.values.hand_joint_set_default[i].relation = rnd.relation(kTrackedFlags);
+		}
+
+		xrt_relation_chain xrc = {};
+		xrt_space_relation a = rnd.relation(kAllFlags);
+		m_relation_chain_push_relation(&xrc, &a);
+
+		xrt_hand_joint_set out = set;
+		u_hand_joints_resolve_chain(&out, &xrc);
+
+		bool ok = true;
+		for (int i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+			xrt_space_relation expected;
+			resolve_scalar(xrc, set.values.hand_joint_set_default[i].relation, expected);
+			ok &= close(out.values.hand_joint_set_default[i].relation, expected);
+		}
+		CHECK(ok);
+	}
+}
+
+TEST_CASE("math_batch_benchmark", "[.benchmark]")
+{
+	/*
+	 * Both hands, each joint put through a chain of two relations like
+	 * the hand tracking prediction and xrLocateHandJointsEXT do.
+	 */
+	constexpr int kIterations = 20000;
+	constexpr uint32_t kJoints = XRT_HAND_JOINT_COUNT * 2;
+
+	Random rnd;
+	std::vector<xrt_space_relation> in;
+	for (uint32_t i = 0; i < kJoints; i++) {
+		in.push_back(rnd.relation(kAllFlags));
+	}
+
+	xrt_relation_chain xrc = {};
+	xrt_space_relation a = rnd.relation(kAllFlags);
+	xrt_space_relation b = rnd.relation(kAllFlags);
+	m_relation_chain_push_inverted_relation(&xrc, &a);
+	m_relation_chain_push_relation(&xrc, &b);
+
+	std::vector<xrt_space_relation> out_scalar(kJoints);
+	std::vector<xrt_space_relation> out_batch(kJoints);
+
+	uint64_t t0 = os_monotonic_get_ns();
+	for (int k = 0; k < kIterations; k++) {
+		for (uint32_t i = 0; i < kJoints; i++) {
+			resolve_scalar(xrc, in[i], out_scalar[i]);
+		}
+	}
+	uint64_t t1 = os_monotonic_get_ns();
+	for (int k = 0; k < kIterations; k++) {
+		// Two hands, one call each.
+		for (uint32_t hand = 0; hand < 2; hand++) {
+			uint32_t first = hand * XRT_HAND_JOINT_COUNT;
+			m_relation_chain_resolve_batch(&xrc, &in[first], &out_batch[first], XRT_HAND_JOINT_COUNT);
+		}
+	}
+	uint64_t t2 = os_monotonic_get_ns();
+
+	printf("math_batch: %u joints through 2 steps, scalar %.3f us, batch %.3f us\n", kJoints,
+	       (double)(t1 - t0) / kIterations / 1000.0, (double)(t2 - t1) / kIterations / 1000.0);
+
+	bool ok = true;
+	for (uint32_t i = 0; i < kJoints; i++) {
+		ok &= close(out_scalar[i], out_batch[i]);
+	}
+	CHECK(ok);
+}
@@ -0,0 +1,249 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Multi-resolution projection view tests.
+ */
+
+#include "util/u_multires.h"
+
+#include "catch/catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace {
+
+struct Image
+{
+	uint32_t width;
+	uint32_t height;
+	std::vector<float> pixels;
+
+	Image(uint32_t w, uint32_t h) : width(w), height(h), pixels(w * h) {}
+
+	float &
+	at(uint32_t x, uint32_t y)
+	{
+		return pixels[y * width + x];
+	}
+
+	//! Bilinear sample with clamp to edge, like the compositor samplers.
+	float
+	sample(xrt_vec2 uv) const
+	{
+		float fx = uv.x * (float)width - 0.5f;
+		float fy = uv.y * (float)height - 0.5f;
+		float x0 = std::floor(fx);
+		float y0 = std::floor(fy);
+		float tx = fx - x0;
+		float ty = fy - y0;
+
+		auto get = [&](float x, float y) {
+			int ix = std::clamp((int)x, 0, (int)width - 1);
+			int iy = std::clamp((int)y, 0, (int)height - 1);
+			return pixels[iy * width + ix];
+		};
+
+		float top = get(x0, y0) * (1 - tx) + get(x0 + 1, y0) * tx;
+		float bottom = get(x0, y0 + 1) * (1 - tx) + get(x0 + 1, y0 + 1) * tx;
+		return top * (1 - ty) + bottom * ty;
+	}
+};
+
+xrt_vec2
+pixel_center(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	return {((float)x + 0.5f) / (float)width, ((float)y + 0.5f) / (float)height};
+}
+
+//! Same calculation as the compositor shaders, from the shader parameters.
+xrt_vec2
+shader_to_packed(const u_multires_shader_params &p, xrt_vec2 uv)
+{
+	auto axis = [](float x, float lo, float hi, float s, float inv_size) {
+		return (s * std::min(x, lo) + (std::clamp(x, lo, hi) - lo) + s * std::max(x - hi, 0.0f)) * inv_size;
+	};
+
+	return {axis(uv.x, p.bounds[0], p.bounds[1], p.scale[0], p.scale[2]),
+	        axis(uv.y, p.bounds[2], p.bounds[3], p.scale[1], p.scale[3])};
+}
+
+xrt_multires_layout
+lens_matched()
+{
+	xrt_multires_layout layout = {};
+	layout.center = {0.25f, 0.25f, 0.5f, 0.5f};
+	layout.periphery_scale = {0.5f, 0.5f};
+	return layout;
+}
+
+} // namespace
+
+
+TEST_CASE("multires_layout")
+{
+	SECTION("Zeroed layout is the identity")
+	{
+		xrt_multires_layout uniform = {};
+		CHECK(u_multires_is_uniform(&uniform));
+		CHECK(u_multires_validate(&uniform));
+
+		for (float v : {0.0f, 0.1f, 0.5f, 0.93f, 1.0f}) {
+			xrt_vec2 p = u_multires_view_to_packed(&uniform, {v, 1.0f - v});
+			CHECK(p.x == v);
+			CHECK(p.y == 1.0f - v);
+		}
+
+		u_multires_shader_params params;
+		u_multires_get_shader_params(&uniform, &params);
+		CHECK(params.bounds[0] == 0.0f);
+		CHECK(params.bounds[1] == 1.0f);
+		CHECK(params.scale[0] == 1.0f);
+		CHECK(params.scale[2] == 1.0f);
+
+		uint32_t w = 0;
+		uint32_t h = 0;
+		u_multires_packed_extent(&uniform, 1920, 1080, &w, &h);
+		CHECK(w == 1920);
+		CHECK(h == 1080);
+	}
+
+	SECTION("Validation")
+	{
+		xrt_multires_layout layout = lens_matched();
+		CHECK_FALSE(u_multires_is_uniform(&layout));
+		CHECK(u_multires_validate(&layout));
+
+		xrt_multires_layout outside = layout;
+		outside.center.x = 0.6f;
+		CHECK_FALSE(u_multires_validate(&outside));
+
+		xrt_multires_layout empty = layout;
+		empty.center.h = 0.0f;
+		CHECK_FALSE(u_multires_validate(&empty));
+
+		xrt_multires_layout upscaled = layout;
+		upscaled.periphery_scale.y = 1.5f;
+		CHECK_FALSE(u_multires_validate(&upscaled));
+
+		xrt_multires_layout nan = layout;
+		nan.periphery_scale.x = NAN;
+		CHECK_FALSE(u_multires_validate(&nan));
+	}
+
+	SECTION("Packed size")
+	{
+		xrt_multires_layout layout = lens_matched();
+
+		uint32_t w = 0;
+		uint32_t h = 0;
+		u_multires_packed_extent(&layout, 2048, 2048, &w, &h);
+		CHECK(w == 1536);
+		CHECK(h == 1536);
+
+		// The fill-rate saving.
+		float fraction = (float)(w * h) / (2048.0f * 2048.0f);
+		CHECK(fraction == Approx(0.5625f));
+	}
+
+	SECTION("Mapping is continuous, monotonic and invertible")
+	{
+		xrt_multires_layout layout = {};
+		layout.center = {0.2f, 0.3f, 0.45f, 0.4f};
+		layout.periphery_scale = {0.4f, 0.7f};
+		REQUIRE(u_multires_validate(&layout));
+
+		u_multires_shader_params params;
+		u_multires_get_shader_params(&layout, &params);
+
+		CHECK(u_multires_view_to_packed(&layout, {0, 0}).x == Approx(0.0f).margin(1e-6f));
+		CHECK(u_multires_view_to_packed(&layout, {1, 1}).x == Approx(1.0f));
+		CHECK(u_multires_view_to_packed(&layout, {1, 1}).y == Approx(1.0f));
+
+		bool monotonic = true;
+		bool round_trip = true;
+		bool matches_shader = true;
+		xrt_vec2 last = u_multires_view_to_packed(&layout, {0, 0});
+		for (int i = 1; i <= 1000; i++) {
+			float v = (float)i / 1000.0f;
+			xrt_vec2 packed = u_multires_view_to_packed(&layout, {v, v});
+			xrt_vec2 view = u_multires_packed_to_view(&layout, packed);
+			xrt_vec2 shader = shader_to_packed(params, {v, v});
+
+			// No jumps, the largest slope is that of the center.
+			monotonic &= packed.x > last.x && packed.x - last.x < 0.003f;
+			monotonic &= packed.y > last.y && packed.y - last.y < 0.003f;
+			round_trip &= std::fabs(view.x - v) < 1e-5f && std::fabs(view.y - v) < 1e-5f;
+			matches_shader &= std::fabs(shader.x - packed.x) < 1e-6f;
+			matches_shader &= std::fabs(shader.y - packed.y) < 1e-6f;
+			last = packed;
+		}
+		CHECK(monotonic);
+		CHECK(round_trip);
+		CHECK(matches_shader);
+	}
+}
+
+TEST_CASE("multires_image")
+{
+	/*
+	 * Pack a view the way an application renders it and sample it back the
+	 * way the compositor does, then compare against the full resolution view.
+	 */
+	constexpr uint32_t kSize = 256;
+	xrt_multires_layout layout = lens_matched();
+
+	// Sharp detail in the center, smooth falloff towards the edges.
+	Image full(kSize, kSize);
+	for (uint32_t y = 0; y < kSize; y++) {
+		for (uint32_t x = 0; x < kSize; x++) {
+			xrt_vec2 uv = pixel_center(x, y, kSize, kSize);
+			bool checker = ((x / 4) + (y / 4)) % 2 == 0;
+			bool center = uv.x > 0.25f && uv.x < 0.75f && uv.y > 0.25f && uv.y < 0.75f;
+			float smooth = 0.5f + 0.25f * std::sin(uv.x * 6) * std::cos(uv.y * 5);
+			full.at(x, y) = center ? (checker ? 1.0f : 0.0f) : smooth;
+		}
+	}
+
+	uint32_t packed_w = 0;
+	uint32_t packed_h = 0;
+	u_multires_packed_extent(&layout, kSize, kSize, &packed_w, &packed_h);
+
+	Image packed(packed_w, packed_h);
+	for (uint32_t y = 0; y < packed_h; y++) {
+		for (uint32_t x = 0; x < packed_w; x++) {
+			xrt_vec2 view = u_multires_packed_to_view(&layout, pixel_center(x, y, packed_w, packed_h));
+			packed.at(x, y) = full.sample(view);
+		}
+	}
+
+	// Is the pixel inside of the center region shrunk by margin pixels.
+	auto inside = [&](uint32_t x, uint32_t y, int margin) {
+		int lo = (int)kSize / 4 + margin;
+		int hi = (int)kSize * 3 / 4 - margin;
+		return (int)x >= lo && (int)x < hi && (int)y >= lo && (int)y < hi;
+	};
+
+	float center_error = 0.0f;
+	float periphery_error = 0.0f;
+	for (uint32_t y = 0; y < kSize; y++) {
+		for (uint32_t x = 0; x < kSize; x++) {
+			xrt_vec2 uv = pixel_center(x, y, kSize, kSize);
+			float error = std::fabs(packed.sample(u_multires_view_to_packed(&layout, uv)) - full.at(x, y));
+
+			// Filtering blends the two regions within a few pixels of the border.
+			if (inside(x, y, 1)) {
+				center_error = std::max(center_error, error);
+			} else if (!inside(x, y, -4)) {
+				periphery_error = std::max(periphery_error, error);
+			}
+		}
+	}
+
+	CHECK(packed_w * packed_h < kSize * kSize * 6 / 10);
+	CHECK(center_error < 1e-5f);
+	CHECK(periphery_error < 0.01f);
+}
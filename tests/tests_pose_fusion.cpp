@@ -0,0 +1,325 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief IMU and optical pose fusion tests.
+ */
+
+#include "math/m_api.h"
+#include "math/m_relation_history.h"
+#include "math/m_vec3.h"
+
+#include "os/os_time.h"
+
+#include "tracking/t_pose_fusion.hpp"
+
+#include "catch/catch.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+using xrt::auxiliary::tracking::PoseCovariance;
+using xrt::auxiliary::tracking::PoseFusion;
+
+namespace {
+
+constexpr timepoint_ns kStartNs = U_TIME_1S_IN_NS;
+constexpr timepoint_ns kImuPeriodNs = U_TIME_1MS_IN_NS;
+constexpr timepoint_ns kFramePeriodNs = 16666667;
+constexpr timepoint_ns kFrameDelayNs = 30 * U_TIME_1MS_IN_NS;
+constexpr float kOpticalStdDev = 0.005f;
+
+/*
+ * Ground truth, a head moving around a bit and turning mostly around Y.
+ */
+
+xrt_vec3
+true_position(timepoint_ns ts)
+{
+	float t = (float)time_ns_to_s(ts - kStartNs);
+	return {0.3f * std::sin(1.3f * t), 1.2f + 0.1f * std::sin(2.1f * t), -0.5f + 0.2f * std::cos(0.9f * t)};
+}
+
+xrt_vec3
+true_acceleration(timepoint_ns ts)
+{
+	float t = (float)time_ns_to_s(ts - kStartNs);
+	return {-0.3f * 1.3f * 1.3f * std::sin(1.3f * t), -0.1f * 2.1f * 2.1f * std::sin(2.1f * t),
+	        -0.2f * 0.9f * 0.9f * std::cos(0.9f * t)};
+}
+
+xrt_quat
+true_orientation(timepoint_ns ts)
+{
+	float t = (float)time_ns_to_s(ts - kStartNs);
+	xrt_vec3 rot = {0.1f * std::sin(1.7f * t), 0.8f * std::sin(0.7f * t), 0.1f * std::sin(1.1f * t)};
+	xrt_quat q{};
+	math_quat_exp(&rot, &q);
+	return q;
+}
+
+void
+imu_sample(timepoint_ns ts, xrt_vec3 *out_accel, xrt_vec3 *out_gyro)
+{
+	xrt_quat q = true_orientation(ts);
+	xrt_quat q_next = true_orientation(ts + U_TIME_1MS_IN_NS / 10);
+
+	// Body space angular velocity.
+	xrt_quat q_inv{};
+	xrt_quat delta{};
+	math_quat_invert(&q, &q_inv);
+	math_quat_rotate(&q_inv, &q_next, &delta);
+	xrt_vec3 half_rot{};
+	math_quat_ln(&delta, &half_rot);
+	*out_gyro = half_rot * (2.0f / (float)time_ns_to_s(U_TIME_1MS_IN_NS / 10));
+
+	// The accelerometer reads gravity as up.
+	xrt_vec3 world_accel = true_acceleration(ts) + xrt_vec3{0, (float)MATH_GRAVITY_M_S2, 0};
+	math_quat_rotate_vec3(&q_inv, &world_accel, out_accel);
+}
+
+float
+angle_between(const xrt_quat &a, const xrt_quat &b)
+{
+	float dot = std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+	return 2.0f * std::acos(std::fmin(dot, 1.0f));
+}
+
+struct Frame
+{
+	timepoint_ns capture_ns;
+	xrt_vec3 position;
+};
+
+/*!
+ * Runs the IMU at 1 kHz and a camera at 60 Hz whose frames arrive
+ * @ref kFrameDelayNs late, calling @p query after every IMU sample.
+ */
+template <typename Query>
+void
+simulate(PoseFusion &fusion, bool use_capture_time, int imu_samples, Query &&query)
+{
+	std::mt19937 rng(1234);
+	std::normal_distribution<float> noise(0.0f, kOpticalStdDev);
+	xrt_vec3 variance = {kOpticalStdDev * kOpticalStdDev, kOpticalStdDev * kOpticalStdDev,
+	                     kOpticalStdDev * kOpticalStdDev};
+
+	std::vector<Frame> in_flight;
+	timepoint_ns next_frame_ns = kStartNs;
+
+	for (int i = 0; i < imu_samples; i++) {
+		timepoint_ns now = kStartNs + i * kImuPeriodNs;
+
+		xrt_vec3 accel{};
+		xrt_vec3 gyro{};
+		imu_sample(now, &accel, &gyro);
+		fusion.process_imu(now, &accel, &gyro, nullptr);
+
+		if (now >= next_frame_ns) {
+			xrt_vec3 p = true_position(next_frame_ns);
+			in_flight.push_back({next_frame_ns, p + xrt_vec3{noise(rng), noise(rng), noise(rng)}});
+			next_frame_ns += kFramePeriodNs;
+		}
+
+		while (!in_flight.empty() && in_flight.front().capture_ns + kFrameDelayNs <= now) {
+			const Frame &f = in_flight.front();
+			timepoint_ns ts = use_capture_time ? f.capture_ns : 0;
+			fusion.process_position(ts, &f.position, &variance, nullptr, 1.0f);
+			in_flight.erase(in_flight.begin());
+		}
+
+		query(now);
+	}
+}
+
+} // namespace
+
+
+TEST_CASE("pose_fusion")
+{
+	auto fusion = PoseFusion::create();
+
+	SECTION("Nothing known without samples")
+	{
+		xrt_space_relation rel{};
+		fusion->get_relation(kStartNs, &rel);
+		CHECK(rel.relation_flags == 0);
+	}
+
+	SECTION("Tracks the ground truth")
+	{
+		double pos_err_sum = 0.0;
+		float max_angle = 0.0f;
+		int count = 0;
+
+		simulate(*fusion, true, 3000, [&](timepoint_ns now) {
+			if (now < kStartNs + 500 * kImuPeriodNs) {
+				return;
+			}
+			xrt_space_relation rel{};
+			fusion->get_relation(now, &rel);
+			xrt_quat q = true_orientation(now);
+
+			pos_err_sum += m_vec3_len(rel.pose.position - true_position(now));
+			max_angle = std::fmax(max_angle, angle_between(rel.pose.orientation, q));
+			count++;
+		});
+
+		xrt_space_relation rel{};
+		fusion->get_relation(kStartNs + 2999 * kImuPeriodNs, &rel);
+		CHECK((rel.relation_flags & XRT_SPACE_RELATION_POSITION_TRACKED_BIT) != 0);
+		CHECK((rel.relation_flags & XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT) != 0);
+
+		CHECK(pos_err_sum / count < 0.02);
+		CHECK(max_angle < 0.05f);
+
+		// The past comes from the history.
+		xrt_space_relation past{};
+		timepoint_ns past_ns = kStartNs + 2950 * kImuPeriodNs;
+		CHECK(m_relation_history_get(fusion->get_relation_history(), past_ns, &past) ==
+		      M_RELATION_HISTORY_RESULT_EXACT);
+		CHECK(m_vec3_len(past.pose.position - true_position(past_ns)) < 0.03f);
+
+		// Measurements older than the history are dropped.
+		xrt_vec3 p = true_position(kStartNs);
+		xrt_vec3 variance = {1.e-4f, 1.e-4f, 1.e-4f};
+		CHECK_FALSE(fusion->process_position(kStartNs, &p, &variance, nullptr, 1.0f));
+
+		// Losing sight of it clears the tracked flag but keeps the estimate.
+		fusion->clear_position_tracked_flag();
+		fusion->get_relation(kStartNs + 2999 * kImuPeriodNs, &rel);
+		CHECK((rel.relation_flags & XRT_SPACE_RELATION_POSITION_VALID_BIT) != 0);
+		CHECK((rel.relation_flags & XRT_SPACE_RELATION_POSITION_TRACKED_BIT) == 0);
+	}
+
+	SECTION("Late measurements give the same result as timely ones")
+	{
+		auto timely = PoseFusion::create();
+		xrt_vec3 variance = {1.e-4f, 1.e-4f, 1.e-4f};
+
+		for (int i = 0; i < 200; i++) {
+			timepoint_ns now = kStartNs + i * kImuPeriodNs;
+			xrt_vec3 accel{};
+			xrt_vec3 gyro{};
+			imu_sample(now, &accel, &gyro);
+			fusion->process_imu(now, &accel, &gyro, nullptr);
+			timely->process_imu(now, &accel, &gyro, nullptr);
+
+			// Measure at 50 and 120, the late one gets the first one at 180.
+			if (i == 50 || i == 120) {
+				xrt_vec3 p = true_position(now);
+				timely->process_position(now, &p, &variance, nullptr, 1.0f);
+			}
+			if (i == 180) {
+				for (int m : {120, 50}) {
+					timepoint_ns ts = kStartNs + m * kImuPeriodNs;
+					xrt_vec3 p = true_position(ts);
+					CHECK(fusion->process_position(ts, &p, &variance, nullptr, 1.0f));
+				}
+			}
+		}
+
+		timepoint_ns when = kStartNs + 210 * kImuPeriodNs;
+		xrt_space_relation a{};
+		xrt_space_relation b{};
+		fusion->get_relation(when, &a);
+		timely->get_relation(when, &b);
+		CHECK(m_vec3_len(a.pose.position - b.pose.position) < 1e-5f);
+		CHECK(angle_between(a.pose.orientation, b.pose.orientation) < 1e-4f);
+		CHECK(a.relation_flags == b.relation_flags);
+
+		PoseCovariance ca{};
+		PoseCovariance cb{};
+		fusion->get_covariance(when, &ca);
+		timely->get_covariance(when, &cb);
+		bool same = true;
+		for (int r = 0; r < 6; r++) {
+			for (int c = 0; c < 6; c++) {
+				same &= std::fabs(ca.values[r][c] - cb.values[r][c]) < 1e-9;
+			}
+		}
+		CHECK(same);
+
+		// The replayed part of the history matches as well.
+		for (int m : {50, 97, 120, 179, 199}) {
+			timepoint_ns past = kStartNs + m * kImuPeriodNs;
+			fusion->get_relation(past, &a);
+			timely->get_relation(past, &b);
+			CHECK(m_vec3_len(a.pose.position - b.pose.position) < 1e-5f);
+			CHECK(a.relation_flags == b.relation_flags);
+		}
+
+		// Measurements make us more certain of the position.
+		auto unmeasured = PoseFusion::create();
+		xrt_vec3 accel{};
+		xrt_vec3 gyro{};
+		imu_sample(kStartNs, &accel, &gyro);
+		unmeasured->process_imu(kStartNs, &accel, &gyro, nullptr);
+		PoseCovariance cu{};
+		unmeasured->get_covariance(when, &cu);
+		CHECK(ca.values[0][0] < cu.values[0][0]);
+	}
+}
+
+TEST_CASE("pose_fusion_replay_benchmark", "[.benchmark]")
+{
+	/*
+	 * Replays the same session twice: once applying the late frames when
+	 * they arrive, like the trackers did before, and once at the time
+	 * they were captured.
+	 */
+	constexpr int kSamples = 10000;
+
+	struct Result
+	{
+		double pos_err_sum = 0.0;
+		double vel_err_sum = 0.0;
+		int count = 0;
+		uint64_t process_ns = 0;
+	};
+
+	auto run = [&](bool use_capture_time) {
+		Result r;
+		auto fusion = PoseFusion::create();
+		uint64_t t0 = os_monotonic_get_ns();
+		timepoint_ns prev = 0;
+		xrt_vec3 prev_pos{};
+
+		simulate(*fusion, use_capture_time, kSamples, [&](timepoint_ns now) {
+			if (now < kStartNs + 1000 * kImuPeriodNs) {
+				return;
+			}
+			xrt_space_relation rel{};
+			fusion->get_relation(now, &rel);
+
+			xrt_vec3 pos = true_position(now);
+			r.pos_err_sum += m_vec3_len(rel.pose.position - pos);
+			if (prev != 0) {
+				xrt_vec3 vel = (pos - prev_pos) * (float)(1.0 / time_ns_to_s(now - prev));
+				r.vel_err_sum += m_vec3_len(rel.linear_velocity - vel);
+			}
+			prev = now;
+			prev_pos = pos;
+			r.count++;
+		});
+
+		r.process_ns = os_monotonic_get_ns() - t0;
+		return r;
+	};
+
+	Result on_arrival = run(false);
+	Result replayed = run(true);
+
+	printf("pose_fusion: frames %.0f ms late, position error %.2f mm on arrival, %.2f mm replayed\n",
+	       time_ns_to_ms_f(kFrameDelayNs), on_arrival.pos_err_sum / on_arrival.count * 1000.0,
+	       replayed.pos_err_sum / replayed.count * 1000.0);
+	printf("pose_fusion: velocity error %.3f m/s on arrival, %.3f m/s replayed\n",
+	       on_arrival.vel_err_sum / on_arrival.count, replayed.vel_err_sum / replayed.count);
+	printf("pose_fusion: %.2f us per IMU sample on arrival, %.2f us replayed\n",
+	       (double)on_arrival.process_ns / kSamples / 1000.0, (double)replayed.process_ns / kSamples / 1000.0);
+
+	CHECK(replayed.pos_err_sum < on_arrival.pos_err_sum);
+}
@@ -0,0 +1,222 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Pose prediction model tests.
+ */
+
+#include "math/m_api.h"
+#include "math/m_predict.h"
+#include "math/m_relation_history.h"
+#include "math/m_vec3.h"
+
+#include "util/u_time.h"
+
+#include "catch/catch.hpp"
+
+#include <cmath>
+#include <vector>
+
+
+using xrt::auxiliary::math::RelationHistory;
+
+namespace {
+
+constexpr uint64_t kStartNs = 1000 * (uint64_t)U_TIME_1S_IN_NS;
+constexpr uint64_t kStepNs = U_TIME_1MS_IN_NS;
+constexpr double kHorizonS = 0.04;
+
+constexpr xrt_space_relation_flags kAllFlags = (xrt_space_relation_flags)( //
+    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |                           //
+    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT |                         //
+    XRT_SPACE_RELATION_POSITION_VALID_BIT |                              //
+    XRT_SPACE_RELATION_POSITION_TRACKED_BIT |                            //
+    XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT |                       //
+    XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT);
+
+const xrt_vec3 kAcceleration{2.0f, -1.0f, 0.5f};
+const xrt_vec3 kStartVelocity{0.2f, 0.0f, -0.1f};
+constexpr float kAngularAcceleration = 8.0f; // About +Y, rad/s^2.
+constexpr float kStartAngularVelocity = 0.5f;
+
+//! Constantly accelerating and spinning up, @p t seconds from the start.
+xrt_space_relation
+accelerating(double t)
+{
+	float ft = (float)t;
+
+	xrt_space_relation rel{};
+	rel.relation_flags = kAllFlags;
+	rel.pose.position = kStartVelocity * ft + kAcceleration * (0.5f * ft * ft);
+	rel.linear_velocity = kStartVelocity + kAcceleration * ft;
+
+	xrt_vec3 axis{0.0f, 1.0f, 0.0f};
+	float angle = kStartAngularVelocity * ft + 0.5f * kAngularAcceleration * ft * ft;
+	math_quat_from_angle_vector(angle, &axis, &rel.pose.orientation);
+	rel.angular_velocity = axis * (kStartAngularVelocity + kAngularAcceleration * ft);
+	return rel;
+}
+
+float
+angle_between(const xrt_quat &a, const xrt_quat &b)
+{
+	float dot = std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+	return 2.0f * std::acos(std::fmin(dot, 1.0f));
+}
+
+struct Samples
+{
+	std::vector<xrt_space_relation> relations;
+	std::vector<uint64_t> timestamps;
+	double newest_s = 0;
+};
+
+Samples
+make_samples(uint32_t count)
+{
+	Samples s;
+	for (uint32_t i = 0; i < count; i++) {
+		s.newest_s = i * 0.001;
+		s.relations.push_back(accelerating(s.newest_s));
+		s.timestamps.push_back(kStartNs + i * kStepNs);
+	}
+	return s;
+}
+
+xrt_space_relation
+predict(const Samples &s, m_predict_model model)
+{
+	m_predict_params params;
+	m_predict_params_default(&params);
+	params.model = model;
+
+	xrt_space_relation out{};
+	m_predict_relation_from_samples(&params, s.relations.data(), s.timestamps.data(),
+	                                (uint32_t)s.relations.size(), kHorizonS, &out);
+	return out;
+}
+
+} // namespace
+
+
+TEST_CASE("m_predict_params")
+{
+	m_predict_params params;
+	m_predict_params_default(&params);
+	CHECK(params.model == M_PREDICT_MODEL_CONSTANT_VELOCITY);
+
+	CHECK(m_predict_params_from_string("polynomial", &params));
+	CHECK(params.model == M_PREDICT_MODEL_POLYNOMIAL);
+
+	CHECK(m_predict_params_from_string("damped:60", &params));
+	CHECK(params.model == M_PREDICT_MODEL_DAMPED);
+	CHECK(params.damping_time_s == Approx(0.06f));
+
+	CHECK(m_predict_params_from_string("acceleration:8", &params));
+	CHECK(params.model == M_PREDICT_MODEL_CONSTANT_ACCELERATION);
+	CHECK(params.sample_count == 8);
+
+	CHECK_FALSE(m_predict_params_from_string(nullptr, &params));
+	CHECK_FALSE(m_predict_params_from_string("kalman", &params));
+	CHECK_FALSE(m_predict_params_from_string("damped:", &params));
+	CHECK_FALSE(m_predict_params_from_string("velocityx", &params));
+	CHECK(params.model == M_PREDICT_MODEL_CONSTANT_ACCELERATION);
+
+	for (auto model : {M_PREDICT_MODEL_CONSTANT_VELOCITY, M_PREDICT_MODEL_CONSTANT_ACCELERATION,
+	                   M_PREDICT_MODEL_DAMPED, M_PREDICT_MODEL_POLYNOMIAL}) {
+		CHECK(m_predict_params_from_string(m_predict_model_to_string(model), &params));
+		CHECK(params.model == model);
+	}
+}
+
+TEST_CASE("m_predict_models")
+{
+	Samples s = make_samples(20);
+	xrt_space_relation truth = accelerating(s.newest_s + kHorizonS);
+
+	SECTION("Constant velocity matches m_predict_relation")
+	{
+		xrt_space_relation expected{};
+		m_predict_relation(&s.relations.back(), kHorizonS, &expected);
+
+		xrt_space_relation out = predict(s, M_PREDICT_MODEL_CONSTANT_VELOCITY);
+		CHECK(m_vec3_len(out.pose.position - expected.pose.position) == 0.0f);
+		CHECK(angle_between(out.pose.orientation, expected.pose.orientation) < 1e-4f);
+
+		// And overshoots, or rather lags here.
+		CHECK(m_vec3_len(out.pose.position - truth.pose.position) > 1e-3f);
+	}
+
+	SECTION("Fitted models follow acceleration")
+	{
+		for (auto model : {M_PREDICT_MODEL_CONSTANT_ACCELERATION, M_PREDICT_MODEL_POLYNOMIAL}) {
+			CAPTURE(m_predict_model_to_string(model));
+			xrt_space_relation out = predict(s, model);
+			CHECK(out.relation_flags == kAllFlags);
+			CHECK(m_vec3_len(out.pose.position - truth.pose.position) < 1e-4f);
+			CHECK(m_vec3_len(out.linear_velocity - truth.linear_velocity) < 1e-3f);
+			CHECK(angle_between(out.pose.orientation, truth.pose.orientation) < 1e-3f);
+			CHECK(m_vec3_len(out.angular_velocity - truth.angular_velocity) < 1e-2f);
+		}
+	}
+
+	SECTION("Damped model decays the velocities")
+	{
+		m_predict_params params;
+		m_predict_params_default(&params);
+		params.model = M_PREDICT_MODEL_DAMPED;
+
+		const xrt_space_relation &newest = s.relations.back();
+		xrt_space_relation out{};
+		m_predict_relation_from_samples(&params, &newest, &s.timestamps.back(), 1, kHorizonS, &out);
+
+		double tau = params.damping_time_s;
+		float travelled = (float)(tau * (1.0 - std::exp(-kHorizonS / tau)));
+		xrt_vec3 expected = newest.pose.position + newest.linear_velocity * travelled;
+		CHECK(m_vec3_len(out.pose.position - expected) < 1e-5f);
+
+		float decay = (float)std::exp(-kHorizonS / tau);
+		CHECK(m_vec3_len(out.linear_velocity - newest.linear_velocity * decay) < 1e-5f);
+	}
+
+	SECTION("Too few samples fall back to constant velocity")
+	{
+		Samples one = make_samples(1);
+		xrt_space_relation expected{};
+		m_predict_relation(&one.relations.back(), kHorizonS, &expected);
+
+		xrt_space_relation out = predict(one, M_PREDICT_MODEL_POLYNOMIAL);
+		CHECK(m_vec3_len(out.pose.position - expected.pose.position) == 0.0f);
+	}
+}
+
+TEST_CASE("m_relation_history_predict_model")
+{
+	Samples s = make_samples(40);
+	RelationHistory rh;
+	for (size_t i = 0; i < s.relations.size(); i++) {
+		rh.push(s.relations[i], s.timestamps[i]);
+	}
+
+	uint64_t when = s.timestamps.back() + (uint64_t)(kHorizonS * U_TIME_1S_IN_NS);
+	xrt_space_relation truth = accelerating(s.newest_s + kHorizonS);
+
+	xrt_space_relation velocity{};
+	CHECK(rh.get(when, &velocity) == M_RELATION_HISTORY_RESULT_PREDICTED);
+
+	m_predict_params params;
+	m_predict_params_default(&params);
+	params.model = M_PREDICT_MODEL_CONSTANT_ACCELERATION;
+	rh.set_predict_params(params);
+
+	xrt_space_relation acceleration{};
+	CHECK(rh.get(when, &acceleration) == M_RELATION_HISTORY_RESULT_PREDICTED);
+	CHECK(m_vec3_len(acceleration.pose.position - truth.pose.position) <
+	      m_vec3_len(velocity.pose.position - truth.pose.position));
+	CHECK(m_vec3_len(acceleration.pose.position - truth.pose.position) < 1e-4f);
+
+	// Lookups inside the history are not affected.
+	xrt_space_relation exact{};
+	CHECK(rh.get(s.timestamps[10], &exact) == M_RELATION_HISTORY_RESULT_EXACT);
+	CHECK(m_vec3_len(exact.pose.position - s.relations[10].pose.position) == 0.0f);
+}
@@ -0,0 +1,295 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Prober hotplug tests, feeds udev style events from a mocked source.
+ */
+
+#include "os/os_time.h"
+#include "util/u_time.h"
+
+#include "p_prober.h"
+
+#include "catch/catch.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace {
+
+// Same as the kernel's BUS_USB.
+constexpr uint32_t kBusUsb = 3;
+
+constexpr uint16_t kVendor = 0x28de;
+constexpr uint16_t kProduct = 0x2300;
+
+//! Pipe backed event source, one byte in the pipe per queued event.
+struct MockSource
+{
+	p_hotplug_source base;
+	int fds[2];
+
+	std::mutex mutex;
+	std::deque<p_hotplug_event> events;
+};
+
+int
+mock_get_fd(p_hotplug_source *source)
+{
+	return reinterpret_cast<MockSource *>(source)->fds[0];
+}
+
+int
+mock_read_event(p_hotplug_source *source, p_hotplug_event *out_event)
+{
+	MockSource *ms = reinterpret_cast<MockSource *>(source);
+
+	char c;
+	if (read(ms->fds[0], &c, 1) != 1) {
+		return errno == EAGAIN ? 0 : -1;
+	}
+
+	std::unique_lock<std::mutex> lock(ms->mutex);
+	*out_event = ms->events.front();
+	ms->events.pop_front();
+	return 1;
+}
+
+void
+mock_destroy(p_hotplug_source *source)
+{
+	MockSource *ms = reinterpret_cast<MockSource *>(source);
+	for (p_hotplug_event &e : ms->events) {
+		p_udev_record_clear(&e.record);
+	}
+	close(ms->fds[0]);
+	close(ms->fds[1]);
+	delete ms;
+}
+
+MockSource *
+make_mock_source()
+{
+	MockSource *ms = new MockSource();
+	ms->base.get_fd = mock_get_fd;
+	ms->base.read_event = mock_read_event;
+	ms->base.destroy = mock_destroy;
+	REQUIRE(pipe(ms->fds) == 0);
+	fcntl(ms->fds[0], F_SETFL, O_NONBLOCK);
+	return ms;
+}
+
+void
+push(MockSource *ms, p_hotplug_action action, const p_udev_record &record)
+{
+	{
+		std::unique_lock<std::mutex> lock(ms->mutex);
+		ms->events.push_back({action, record});
+	}
+	REQUIRE(write(ms->fds[1], "e", 1) == 1);
+}
+
+p_udev_record
+usb_record(uint16_t addr)
+{
+	p_udev_record r = {};
+	r.type = P_UDEV_RECORD_USB;
+	r.vendor_id = kVendor;
+	r.product_id = kProduct;
+	r.usb_bus = 1;
+	r.usb_addr = addr;
+	r.dev_path = strdup(("/dev/bus/usb/001/" + std::to_string(addr)).c_str());
+	r.serial = strdup("LHR-0000");
+	r.product = strdup("Test HMD");
+	return r;
+}
+
+p_udev_record
+hidraw_record(uint16_t addr, uint16_t interface, int node)
+{
+	p_udev_record r = {};
+	r.type = P_UDEV_RECORD_HIDRAW;
+	r.bus_type = kBusUsb;
+	r.vendor_id = kVendor;
+	r.product_id = kProduct;
+	r.usb_bus = 1;
+	r.usb_addr = addr;
+	r.interface = interface;
+	r.dev_path = strdup(("/dev/hidraw" + std::to_string(node)).c_str());
+	return r;
+}
+
+//! What a remove event carries, nothing but the node.
+p_udev_record
+removed_record(p_udev_record_type type, const char *dev_path)
+{
+	p_udev_record r = {};
+	r.type = type;
+	r.dev_path = strdup(dev_path);
+	return r;
+}
+
+struct Listener
+{
+	std::atomic<int> added{0};
+	std::atomic<int> removed{0};
+	std::atomic<int> hidraws{0};
+	//! Devices in the list as seen by locking it from the listener.
+	std::atomic<int> listed{-1};
+};
+
+void
+on_hotplug(xrt_prober *xp, xrt_prober_hotplug_event event, xrt_prober_device *xpdev, void *ptr)
+{
+	Listener *l = static_cast<Listener *>(ptr);
+	prober_device *pdev = reinterpret_cast<prober_device *>(xpdev);
+
+	if (event == XRT_PROBER_HOTPLUG_ADDED) {
+		// Listeners are called with the list unlocked.
+		xrt_prober_device **devices = nullptr;
+		size_t count = 0;
+		if (xrt_prober_lock_list(xp, &devices, &count) == XRT_SUCCESS) {
+			l->listed = (int)count;
+			xrt_prober_unlock_list(xp, &devices);
+		}
+
+		l->hidraws = (int)pdev->num_hidraws;
+		l->added++;
+	} else {
+		l->removed++;
+	}
+}
+
+bool
+wait_for(const std::atomic<int> &value, int target)
+{
+	uint64_t end_ns = os_monotonic_get_ns() + 2 * U_TIME_1S_IN_NS;
+	while (value.load() < target && os_monotonic_get_ns() < end_ns) {
+		os_nanosleep(U_TIME_1MS_IN_NS);
+	}
+	return value.load() >= target;
+}
+
+size_t
+device_count(xrt_prober *xp)
+{
+	xrt_prober_device **devices = nullptr;
+	size_t count = 0;
+	REQUIRE(xrt_prober_lock_list(xp, &devices, &count) == XRT_SUCCESS);
+	REQUIRE(xrt_prober_unlock_list(xp, &devices) == XRT_SUCCESS);
+	return count;
+}
+
+} // namespace
+
+
+TEST_CASE("prober_hotplug")
+{
+	char tmpl[] = "/tmp/monado-prober-hotplug-XXXXXX";
+	REQUIRE(mkdtemp(tmpl) != nullptr);
+	setenv("XDG_CONFIG_HOME", tmpl, 1);
+
+	// Only the mocked source, no udev monitor.
+	setenv("PROBER_HOTPLUG", "false", 1);
+
+	xrt_builder_create_func_t builders[] = {nullptr};
+	xrt_prober_entry *entries[] = {nullptr};
+	xrt_auto_prober_create_func_t auto_probers[] = {nullptr};
+	xrt_prober_entry_lists lists = {builders, entries, auto_probers, nullptr};
+
+	xrt_prober *xp = nullptr;
+	REQUIRE(xrt_prober_create_with_lists(&xp, &lists) == 0);
+	prober *p = reinterpret_cast<prober *>(xp);
+
+	Listener l;
+	REQUIRE(xrt_prober_add_hotplug_listener(xp, on_hotplug, &l) == XRT_SUCCESS);
+
+	MockSource *ms = make_mock_source();
+	REQUIRE(p_hotplug_start(p, &ms->base) == 0);
+
+	// A device and its interfaces, reported as one device once settled.
+	push(ms, P_HOTPLUG_ACTION_ADD, usb_record(5));
+	push(ms, P_HOTPLUG_ACTION_ADD, hidraw_record(5, 0, 3));
+	push(ms, P_HOTPLUG_ACTION_ADD, hidraw_record(5, 1, 4));
+	REQUIRE(wait_for(l.added, 1));
+	CHECK(l.hidraws == 2);
+	CHECK(l.listed == 1);
+	CHECK(device_count(xp) == 1);
+
+	SECTION("Adds are idempotent")
+	{
+		push(ms, P_HOTPLUG_ACTION_ADD, usb_record(5));
+		push(ms, P_HOTPLUG_ACTION_ADD, hidraw_record(5, 1, 4));
+		push(ms, P_HOTPLUG_ACTION_ADD, hidraw_record(6, 0, 7));
+		REQUIRE(wait_for(l.added, 2));
+
+		CHECK(l.added == 2);
+		CHECK(device_count(xp) == 2);
+		CHECK(p->devices[0]->num_hidraws == 2);
+	}
+
+	SECTION("Removing interfaces and the device")
+	{
+		push(ms, P_HOTPLUG_ACTION_REMOVE, removed_record(P_UDEV_RECORD_HIDRAW, "/dev/hidraw3"));
+		push(ms, P_HOTPLUG_ACTION_REMOVE, removed_record(P_UDEV_RECORD_HIDRAW, "/dev/hidraw4"));
+		os_nanosleep(300 * U_TIME_1MS_IN_NS);
+		CHECK(l.removed == 0);
+		CHECK(device_count(xp) == 1);
+
+		push(ms, P_HOTPLUG_ACTION_REMOVE, removed_record(P_UDEV_RECORD_USB, "/dev/bus/usb/001/5"));
+		REQUIRE(wait_for(l.removed, 1));
+		CHECK(device_count(xp) == 0);
+	}
+
+	SECTION("Nothing changes while the list is locked")
+	{
+		xrt_prober_device **devices = nullptr;
+		size_t count = 0;
+		REQUIRE(xrt_prober_lock_list(xp, &devices, &count) == XRT_SUCCESS);
+
+		push(ms, P_HOTPLUG_ACTION_ADD, usb_record(8));
+		push(ms, P_HOTPLUG_ACTION_REMOVE, removed_record(P_UDEV_RECORD_USB, "/dev/bus/usb/001/5"));
+		os_nanosleep(300 * U_TIME_1MS_IN_NS);
+		CHECK(l.added == 1);
+		CHECK(l.removed == 0);
+		CHECK(p->device_count == count);
+
+		REQUIRE(xrt_prober_unlock_list(xp, &devices) == XRT_SUCCESS);
+		REQUIRE(wait_for(l.added, 2));
+		REQUIRE(wait_for(l.removed, 1));
+		CHECK(device_count(xp) == 1);
+	}
+
+	SECTION("Added and removed before settling is never reported")
+	{
+		push(ms, P_HOTPLUG_ACTION_ADD, usb_record(9));
+		push(ms, P_HOTPLUG_ACTION_REMOVE, removed_record(P_UDEV_RECORD_USB, "/dev/bus/usb/001/9"));
+		os_nanosleep(300 * U_TIME_1MS_IN_NS);
+		CHECK(l.added == 1);
+		CHECK(l.removed == 0);
+		CHECK(device_count(xp) == 1);
+	}
+
+	// No calls after removing.
+	REQUIRE(xrt_prober_remove_hotplug_listener(xp, on_hotplug, &l) == XRT_SUCCESS);
+	int added = l.added;
+	push(ms, P_HOTPLUG_ACTION_ADD, usb_record(10));
+	os_nanosleep(300 * U_TIME_1MS_IN_NS);
+	CHECK(l.added == added);
+
+	// Stops the hotplug thread.
+	xrt_prober_destroy(&xp);
+	CHECK(xp == nullptr);
+
+	std::string cmd = std::string("rm -rf '") + tmpl + "'";
+	CHECK(system(cmd.c_str()) == 0);
+}
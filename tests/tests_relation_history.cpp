@@ -0,0 +1,289 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Relation history capacity and encoding tests.
+ */
+
+#include "math/m_api.h"
+#include "math/m_relation_history.h"
+#include "math/m_vec3.h"
+
+#include "os/os_time.h"
+#include "util/u_time.h"
+
+#include "catch/catch.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+using xrt::auxiliary::math::RelationHistory;
+
+namespace {
+
+constexpr uint64_t kSecondNs = U_TIME_1S_IN_NS;
+constexpr uint64_t kStartNs = 1000 * kSecondNs;
+constexpr uint64_t kStepNs = U_TIME_1MS_IN_NS;
+
+constexpr xrt_space_relation_flags kAllFlags = (xrt_space_relation_flags)( //
+    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |                           //
+    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT |                         //
+    XRT_SPACE_RELATION_POSITION_VALID_BIT |                              //
+    XRT_SPACE_RELATION_POSITION_TRACKED_BIT |                            //
+    XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT |                       //
+    XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT);
+
+//! A head moving and turning about, sampled at entry @p i.
+xrt_space_relation
+head_relation(uint32_t i)
+{
+	float t = (float)i * 0.001f;
+
+	xrt_space_relation rel{};
+	rel.relation_flags = kAllFlags;
+	rel.pose.position = {0.3f * std::sin(t), 1.6f + 0.05f * std::sin(3.0f * t), -0.2f * std::cos(t)};
+	rel.linear_velocity = {0.3f * std::cos(t), 0.15f * std::cos(3.0f * t), 0.2f * std::sin(t)};
+	rel.angular_velocity = {0.1f, 0.8f * std::cos(t), 0.0f};
+
+	xrt_vec3 axis{0.1f, 1.0f, 0.2f};
+	math_quat_from_angle_vector(0.8f * std::sin(t), &axis, &rel.pose.orientation);
+	math_quat_normalize(&rel.pose.orientation);
+	return rel;
+}
+
+bool
+relations_close(const xrt_space_relation &a, const xrt_space_relation &b)
+{
+	const xrt_quat &qa = a.pose.orientation;
+	const xrt_quat &qb = b.pose.orientation;
+	float dot = std::fabs(qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w);
+
+	return a.relation_flags == b.relation_flags && dot > 1.0f - 1e-6f &&
+	       m_vec3_len(a.pose.position - b.pose.position) < 1e-4f &&
+	       m_vec3_len(a.linear_velocity - b.linear_velocity) < 2e-3f &&
+	       m_vec3_len(a.angular_velocity - b.angular_velocity) < 4e-3f;
+}
+
+void
+fill(RelationHistory &rh, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		xrt_space_relation rel = head_relation(i);
+		rh.push(rel, kStartNs + i * kStepNs);
+	}
+}
+
+} // namespace
+
+
+TEST_CASE("m_relation_history_capacity")
+{
+	constexpr uint32_t kCapacity = 64;
+	constexpr uint32_t kPushed = 200;
+
+	RelationHistory full(kCapacity, M_RELATION_HISTORY_ENCODING_FULL);
+	RelationHistory compact(kCapacity, M_RELATION_HISTORY_ENCODING_COMPACT);
+	fill(full, kPushed);
+	fill(compact, kPushed);
+
+	SECTION("Oldest entries are evicted")
+	{
+		CHECK(full.size() == kCapacity);
+
+		// A keyframe can take a group of old entries with it.
+		CHECK(compact.size() <= kCapacity);
+		CHECK(compact.size() > kCapacity - 16);
+
+		xrt_space_relation out{};
+		uint64_t evicted = kStartNs + (kPushed - kCapacity - 1) * kStepNs;
+		CHECK(full.get(evicted, &out) == M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED);
+		CHECK(compact.get(evicted, &out) == M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED);
+	}
+
+	SECTION("Compact lookups match full ones")
+	{
+		uint32_t first = kPushed - compact.size();
+		for (uint32_t i = first; i < kPushed; i++) {
+			uint64_t t = kStartNs + i * kStepNs;
+
+			xrt_space_relation expected{};
+			xrt_space_relation out{};
+			CHECK(compact.get(t, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+			CHECK(relations_close(out, head_relation(i)));
+
+			// Half way to the next one.
+			t += kStepNs / 2;
+			m_relation_history_result expected_result = full.get(t, &expected);
+			CHECK(compact.get(t, &out) == expected_result);
+			CHECK(relations_close(out, expected));
+		}
+
+		uint64_t latest_ns = 0;
+		xrt_space_relation latest{};
+		CHECK(compact.get_latest(&latest_ns, &latest));
+		CHECK(latest_ns == kStartNs + (kPushed - 1) * kStepNs);
+		CHECK(relations_close(latest, head_relation(kPushed - 1)));
+	}
+
+	SECTION("Compact entries are less than half the size")
+	{
+		// At a size where the entries outweigh the bookkeeping.
+		RelationHistory full_1k(1024, M_RELATION_HISTORY_ENCODING_FULL);
+		RelationHistory compact_1k(1024, M_RELATION_HISTORY_ENCODING_COMPACT);
+		CHECK(compact_1k.memory_size() * 2 < full_1k.memory_size());
+	}
+
+	SECTION("Clearing keeps the capacity")
+	{
+		compact.clear();
+		CHECK(compact.size() == 0);
+		fill(compact, kCapacity);
+		CHECK(compact.size() == kCapacity);
+	}
+
+	SECTION("Truncating allows pushing newer relations again")
+	{
+		uint64_t cut_ns = kStartNs + (kPushed - 10) * kStepNs;
+		full.truncate(cut_ns);
+		compact.truncate(cut_ns);
+		CHECK(full.size() == kCapacity - 10);
+
+		// Replace the dropped ones with the relations of other entries.
+		for (uint32_t i = 0; i < 10; i++) {
+			uint64_t t = cut_ns + i * kStepNs;
+			xrt_space_relation rel = head_relation(i);
+			CHECK(full.push(rel, t));
+			CHECK(compact.push(rel, t));
+		}
+
+		xrt_space_relation out{};
+		CHECK(full.get(cut_ns, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+		CHECK(relations_close(out, head_relation(0)));
+		CHECK(compact.get(cut_ns, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+		CHECK(relations_close(out, head_relation(0)));
+
+		// The entry before the cut is untouched.
+		CHECK(compact.get(cut_ns - kStepNs, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+		CHECK(relations_close(out, head_relation(kPushed - 11)));
+	}
+}
+
+TEST_CASE("m_relation_history_compact_time_range")
+{
+	RelationHistory rh(16, M_RELATION_HISTORY_ENCODING_COMPACT);
+
+	xrt_space_relation rel = head_relation(0);
+	CHECK(rh.push(rel, kStartNs));
+	CHECK(rh.push(rel, kStartNs + 1 * kSecondNs));
+	CHECK(rh.push(rel, kStartNs + 2 * kSecondNs));
+	CHECK(rh.size() == 3);
+
+	// Offsets are 32-bit nanoseconds, too old entries are dropped.
+	CHECK(rh.push(rel, kStartNs + 6 * kSecondNs));
+	CHECK(rh.size() == 2);
+
+	xrt_space_relation out{};
+	CHECK(rh.get(kStartNs + 2 * kSecondNs, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+	CHECK(rh.get(kStartNs + 6 * kSecondNs, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+	CHECK(rh.get(kStartNs + 4 * kSecondNs, &out) == M_RELATION_HISTORY_RESULT_INTERPOLATED);
+	CHECK(rh.get(kStartNs + 1 * kSecondNs, &out) == M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED);
+	CHECK(rh.get(kStartNs + 7 * kSecondNs, &out) == M_RELATION_HISTORY_RESULT_PREDICTED);
+
+	// A gap longer than the range leaves only the new entry.
+	CHECK(rh.push(rel, kStartNs + 20 * kSecondNs));
+	CHECK(rh.size() == 1);
+	CHECK(rh.get(kStartNs + 20 * kSecondNs, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+}
+
+TEST_CASE("m_relation_history_compact_position_jump")
+{
+	/*
+	 * Recentering or a tracking reset teleports the pose by more than the
+	 * ~3.2 m a 0.1 mm offset from the keyframe reaches, in the middle of a
+	 * group and both ways, including through the ring wrapping around.
+	 */
+	constexpr uint32_t kCapacity = 40;
+	constexpr uint32_t kPushed = 100;
+
+	RelationHistory full(kCapacity, M_RELATION_HISTORY_ENCODING_FULL);
+	RelationHistory compact(kCapacity, M_RELATION_HISTORY_ENCODING_COMPACT);
+	for (uint32_t i = 0; i < kPushed; i++) {
+		xrt_space_relation rel = head_relation(i);
+		rel.pose.position.x += (i / 7) % 2 == 1 ? 10.0f : 0.0f;
+		rel.pose.position.z -= i >= 60 ? 50.0f : 0.0f;
+		full.push(rel, kStartNs + i * kStepNs);
+		compact.push(rel, kStartNs + i * kStepNs);
+	}
+
+	// Entries before a jump in the same group only lose some precision.
+	uint32_t first = kPushed - compact.size();
+	for (uint32_t i = first; i < kPushed; i++) {
+		xrt_space_relation expected{};
+		xrt_space_relation out{};
+		uint64_t t = kStartNs + i * kStepNs;
+		CHECK(full.get(t, &expected) == M_RELATION_HISTORY_RESULT_EXACT);
+		CHECK(compact.get(t, &out) == M_RELATION_HISTORY_RESULT_EXACT);
+		CHECK(m_vec3_len(out.pose.position - expected.pose.position) < 3e-3f);
+	}
+
+	// The newest entry is at full precision.
+	xrt_space_relation expected{};
+	xrt_space_relation out{};
+	uint64_t latest_ns = 0;
+	CHECK(full.get_latest(&latest_ns, &expected));
+	CHECK(compact.get_latest(&latest_ns, &out));
+	CHECK(relations_close(out, expected));
+}
+
+TEST_CASE("m_relation_history_benchmark", "[.benchmark]")
+{
+	/*
+	 * A 1 kHz IMU driven history, looked up at random points in the last
+	 * 100 ms like late camera frames and the compositor do.
+	 */
+	constexpr int kLookups = 200000;
+	constexpr uint32_t kWindow = 100;
+
+	struct Config
+	{
+		const char *name;
+		uint32_t capacity;
+		m_relation_history_encoding encoding;
+	};
+	const Config configs[] = {
+	    {"full 4096", M_RELATION_HISTORY_DEFAULT_CAPACITY, M_RELATION_HISTORY_ENCODING_FULL},
+	    {"compact 4096", M_RELATION_HISTORY_DEFAULT_CAPACITY, M_RELATION_HISTORY_ENCODING_COMPACT},
+	    {"full 256", 256, M_RELATION_HISTORY_ENCODING_FULL},
+	    {"compact 256", 256, M_RELATION_HISTORY_ENCODING_COMPACT},
+	};
+
+	for (const Config &config : configs) {
+		RelationHistory rh(config.capacity, config.encoding);
+		fill(rh, config.capacity * 2);
+
+		uint64_t newest = kStartNs + (config.capacity * 2 - 1) * kStepNs;
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<uint64_t> dist(0, kWindow * kStepNs);
+
+		std::vector<uint64_t> times(kLookups);
+		for (uint64_t &t : times) {
+			t = newest - dist(rng);
+		}
+
+		float sum = 0.0f;
+		uint64_t t0 = os_monotonic_get_ns();
+		for (uint64_t t : times) {
+			xrt_space_relation out{};
+			rh.get(t, &out);
+			sum += out.pose.position.x;
+		}
+		uint64_t t1 = os_monotonic_get_ns();
+
+		printf("m_relation_history: %-12s %8zu bytes, %.1f ns per lookup (%f)\n", config.name,
+		       rh.memory_size(), (double)(t1 - t0) / kLookups, sum);
+		CHECK(std::isfinite(sum));
+	}
+}
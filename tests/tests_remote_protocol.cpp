@@ -0,0 +1,284 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Remote driver wire protocol and loopback tests.
+ */
+
+// Must come first, see the header.
+#include "remote/r_interface.h"
+#include "remote/r_internal.h"
+
+#include "math/m_api.h"
+#include "os/os_time.h"
+#include "xrt/xrt_device.h"
+#include "xrt/xrt_space.h"
+
+#include "catch/catch.hpp"
+
+#include <vector>
+#include <cstdio>
+#include <cinttypes>
+#include <cstring>
+
+#ifndef XRT_OS_WINDOWS
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+r_remote_data
+make_data()
+{
+	r_remote_data d = {};
+	d.head.center.orientation = XRT_QUAT_IDENTITY;
+	d.head.center.position = {0.1f, 1.6f, -0.2f};
+	d.left.active = true;
+	d.left.pose.orientation = {0.3f, -0.5f, 0.1f, 0.8f};
+	d.left.pose.position = {-0.2f, 1.3f, -0.5f};
+	d.left.angular_velocity = {-16.9f, 0.0f, 2.0f};
+	d.left.trigger_value.x = 0.25f;
+	d.left.thumbstick = {-1.0f, 0.5f};
+	d.left.hand_curl[3] = 0.75f;
+	d.left.a_click = true;
+	d.right.pose.orientation = {0.0f, 0.0f, -0.7071068f, -0.7071068f};
+	d.right.trackpad_touch = true;
+	return d;
+}
+
+struct Decoded
+{
+	std::vector<r_remote_data> samples;
+	std::vector<int64_t> timestamps;
+};
+
+void
+record_sample(void *ptr, const r_remote_data *data, int64_t timestamp_ns)
+{
+	Decoded *d = static_cast<Decoded *>(ptr);
+	d->samples.push_back(*data);
+	d->timestamps.push_back(timestamp_ns);
+}
+
+size_t
+finish(r_protocol_writer &w, std::vector<uint8_t> &out)
+{
+	const uint8_t *data = nullptr;
+	size_t size = r_protocol_writer_finish(&w, &data);
+	out.assign(data, data + size);
+	return size;
+}
+
+void
+close_socket(r_socket_t fd)
+{
+#ifdef XRT_OS_WINDOWS
+	closesocket(fd);
+#else
+	close(fd);
+#endif
+}
+
+} // namespace
+
+
+TEST_CASE("r_protocol")
+{
+	r_protocol_writer w;
+	r_protocol_reader r;
+	r_protocol_writer_init(&w);
+	r_protocol_reader_init(&r);
+
+	r_remote_data in = make_data();
+	std::vector<uint8_t> packet;
+	Decoded out;
+
+	SECTION("Keyframe round trip")
+	{
+		REQUIRE(r_protocol_writer_add(&w, &in, 1234));
+		finish(w, packet);
+		REQUIRE(r_protocol_reader_decode(&r, packet.data(), packet.size(), record_sample, &out) == 1);
+
+		const r_remote_data &d = out.samples[0];
+		CHECK(out.timestamps[0] == 1234);
+		CHECK(d.head.center.position.y == Approx(1.6f).margin(1e-6));
+		CHECK(d.left.pose.position.x == Approx(-0.2f).margin(1e-6));
+
+		// Sign of the quaternion may flip, compare the rotation.
+		xrt_quat q = in.left.pose.orientation;
+		math_quat_normalize(&q);
+		const xrt_quat &o = d.left.pose.orientation;
+		float dot = q.x * o.x + q.y * o.y + q.z * o.z + q.w * o.w;
+		CHECK(std::abs(dot) == Approx(1.0f).margin(1e-6));
+		float rdot = d.right.pose.orientation.z * -0.7071068f + d.right.pose.orientation.w * -0.7071068f;
+		CHECK(std::abs(rdot) == Approx(1.0f).margin(1e-6));
+
+		CHECK(d.left.angular_velocity.x == -16.9f);
+		CHECK(d.left.trigger_value.x == Approx(0.25f).margin(1e-4));
+		CHECK(d.left.thumbstick.x == Approx(-1.0f).margin(1e-4));
+		CHECK(d.left.hand_curl[3] == Approx(0.75f).margin(1e-4));
+		CHECK(d.left.active);
+		CHECK(d.left.a_click);
+		CHECK_FALSE(d.left.b_click);
+		CHECK_FALSE(d.right.active);
+		CHECK(d.right.trackpad_touch);
+	}
+
+	SECTION("Deltas only carry what changed")
+	{
+		REQUIRE(r_protocol_writer_add(&w, &in, 1));
+		size_t keyframe = finish(w, packet);
+
+		// Nothing changed, only the sample header.
+		REQUIRE(r_protocol_writer_add(&w, &in, 2));
+		size_t unchanged = finish(w, packet);
+		CHECK(unchanged == R_PROTOCOL_HEADER_SIZE + 10);
+
+		// Below the quantization step, still nothing to send.
+		in.left.pose.position.x += 1e-8f;
+		REQUIRE(r_protocol_writer_add(&w, &in, 3));
+		CHECK(finish(w, packet) == unchanged);
+
+		in.left.trigger_value.x = 0.5f;
+		REQUIRE(r_protocol_writer_add(&w, &in, 4));
+		size_t trigger = finish(w, packet);
+		CHECK(trigger == unchanged + 13 * 2);
+		CHECK(trigger * 4 < keyframe);
+	}
+
+	SECTION("Batching and recovery after a lost packet")
+	{
+		std::vector<std::vector<uint8_t>> packets;
+		for (int p = 0; p < 4; p++) {
+			for (int s = 0; s < 4; s++) {
+				in.head.center.position.x = (float)(p * 4 + s);
+				REQUIRE(r_protocol_writer_add(&w, &in, p * 4 + s));
+			}
+			// Third packet starts with a keyframe.
+			if (p == 1) {
+				r_protocol_writer_force_keyframe(&w);
+			}
+			packets.emplace_back();
+			finish(w, packets.back());
+		}
+
+		CHECK(r_protocol_reader_decode(&r, packets[0].data(), packets[0].size(), record_sample, &out) == 4);
+		// Packet 1 is lost.
+		CHECK(r_protocol_reader_decode(&r, packets[2].data(), packets[2].size(), record_sample, &out) == 4);
+		CHECK(r_protocol_reader_decode(&r, packets[3].data(), packets[3].size(), record_sample, &out) == 4);
+		// Late arrival of the lost one is dropped.
+		CHECK(r_protocol_reader_decode(&r, packets[1].data(), packets[1].size(), record_sample, &out) == 0);
+
+		CHECK(r.lost_packets == 1);
+		REQUIRE(out.samples.size() == 12);
+		CHECK(out.samples[4].head.center.position.x == 8.0f);
+		CHECK(out.samples[11].head.center.position.x == 15.0f);
+	}
+
+	SECTION("Deltas after a lost packet wait for a keyframe")
+	{
+		std::vector<uint8_t> lost;
+		REQUIRE(r_protocol_writer_add(&w, &in, 1));
+		finish(w, packet);
+		REQUIRE(r_protocol_writer_add(&w, &in, 2));
+		finish(w, lost);
+		REQUIRE(r_protocol_writer_add(&w, &in, 3));
+		std::vector<uint8_t> delta;
+		finish(w, delta);
+
+		CHECK(r_protocol_reader_decode(&r, packet.data(), packet.size(), record_sample, &out) == 1);
+		CHECK(r_protocol_reader_decode(&r, delta.data(), delta.size(), record_sample, &out) == 0);
+		CHECK(r.skipped_samples == 1);
+	}
+
+	SECTION("Bad header")
+	{
+		REQUIRE(r_protocol_writer_add(&w, &in, 1));
+		finish(w, packet);
+
+		std::vector<uint8_t> bad = packet;
+		bad[4] = R_PROTOCOL_VERSION + 1;
+		CHECK(r_protocol_reader_decode(&r, bad.data(), bad.size(), record_sample, &out) < 0);
+
+		bad = packet;
+		bad.resize(bad.size() - 1);
+		CHECK(r_protocol_reader_decode(&r, bad.data(), bad.size(), record_sample, &out) < 0);
+		CHECK(out.samples.empty());
+	}
+}
+
+TEST_CASE("r_remote_loopback")
+{
+	const uint16_t port = (uint16_t)(42000 + os_monotonic_get_ns() % 1000);
+
+	xrt_system_devices *xsysd = nullptr;
+	xrt_space_overseer *xso = nullptr;
+	REQUIRE(r_create_devices(port, 2, nullptr, &xsysd, &xso) == XRT_SUCCESS);
+	r_hub *hub = reinterpret_cast<r_hub *>(xsysd);
+
+	// The hub thread needs a moment to start listening.
+	r_remote_connection rc = {};
+	rc.fd = -1;
+	for (int i = 0; i < 200 && rc.fd < 0; i++) {
+		if (r_remote_connection_init(&rc, "127.0.0.1", port) != 0) {
+			os_nanosleep(10 * U_TIME_1MS_IN_NS);
+		}
+	}
+	REQUIRE(rc.fd >= 0);
+
+	r_remote_data reset;
+	r_remote_data latest;
+	REQUIRE(r_remote_connection_read_one(&rc, &reset) == 0);
+	REQUIRE(r_remote_connection_read_one(&rc, &latest) == 0);
+	CHECK(reset.head.center.position.y == Approx(1.6f).margin(1e-6));
+
+	auto wait_for_samples = [&](uint64_t count) {
+		for (int i = 0; i < 5000 && hub->stats.samples < count; i++) {
+			os_nanosleep(U_TIME_1MS_IN_NS);
+		}
+		return hub->stats.samples;
+	};
+
+	// Push as many updates as we can, batched, and time how long until the hub has them all.
+	const uint64_t count = 20000;
+	r_remote_data data = reset;
+	uint64_t start_ns = os_monotonic_get_ns();
+	int ret = 0;
+	for (uint64_t i = 0; i < count && ret == 0; i++) {
+		data.left.pose.position.x = -0.2f + (float)i * 1e-5f;
+		data.left.trigger_value.x = (float)(i % 100) / 100.0f;
+		ret = r_remote_connection_write_sample(&rc, &data, (int64_t)os_monotonic_get_ns());
+	}
+	REQUIRE(ret == 0);
+	REQUIRE(r_remote_connection_flush(&rc) == 0);
+	uint64_t received = wait_for_samples(count);
+	double seconds = (double)(os_monotonic_get_ns() - start_ns) / (double)U_TIME_1S_IN_NS;
+
+	std::printf("Loopback: %.0f samples/s, %.1f bytes/sample, %" PRIu64 " packets\n", (double)received / seconds,
+	            (double)hub->stats.bytes / (double)received, hub->stats.packets);
+	CHECK(received == count);
+	CHECK(hub->stats.lost_packets == 0);
+	CHECK(hub->latest.left.pose.position.x == Approx(data.left.pose.position.x).margin(1e-5));
+
+	// Two samples far enough apart to interpolate between.
+	int64_t t0 = (int64_t)os_monotonic_get_ns();
+	data.head.center.position.x = 0.0f;
+	REQUIRE(r_remote_connection_write_sample(&rc, &data, t0) == 0);
+	REQUIRE(r_remote_connection_flush(&rc) == 0);
+	os_nanosleep(20 * U_TIME_1MS_IN_NS);
+	int64_t t1 = (int64_t)os_monotonic_get_ns();
+	data.head.center.position.x = 0.1f;
+	REQUIRE(r_remote_connection_write_sample(&rc, &data, t1) == 0);
+	REQUIRE(r_remote_connection_flush(&rc) == 0);
+	REQUIRE(wait_for_samples(count + 2) == count + 2);
+
+	timepoint_ns mid = m_clock_sync_hw2mono(&hub->clock, (t0 + t1) / 2);
+	xrt_space_relation rel = {};
+	xrt_device_get_tracked_pose(xsysd->xdevs[0], XRT_INPUT_GENERIC_HEAD_POSE, (uint64_t)mid, &rel);
+	CHECK(rel.pose.position.x == Approx(0.05f).margin(0.005f));
+
+	close_socket(rc.fd);
+	xrt_system_devices_destroy(&xsysd);
+	xrt_space_overseer_destroy(&xso);
+}
@@ -0,0 +1,456 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Packed HSV mask, run-length encoding and blob extraction tests.
+ */
+
+#include "tracking/t_tracking.h"
+
+#include "catch/catch.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+
+namespace {
+
+std::unique_ptr<t_hsv_filter_optimized_table>
+make_table()
+{
+	auto t = std::make_unique<t_hsv_filter_optimized_table>();
+	for (int y = 0; y < T_HSV_SIZE; y++) {
+		for (int u = 0; u < T_HSV_SIZE; u++) {
+			for (int v = 0; v < T_HSV_SIZE; v++) {
+				// Any pattern that uses all three indices and all four bits.
+				t->v[y][u][v] = (uint8_t)((y * 7 + u * 3 + v * 5) & 0xf);
+			}
+		}
+	}
+	return t;
+}
+
+std::vector<uint8_t>
+random_bytes(size_t count, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> out(count);
+	for (auto &b : out) {
+		b = (uint8_t)rng();
+	}
+	return out;
+}
+
+std::vector<t_rle_span>
+encode_image(const std::vector<uint8_t> &img, uint32_t width, uint32_t height, uint8_t threshold)
+{
+	std::vector<t_rle_span> spans(width * height / 2 + height);
+	uint32_t count = 0;
+	for (uint32_t y = 0; y < height; y++) {
+		count += t_rle_encode_l8_row(&img[y * width], width, threshold, (uint16_t)y, spans.data() + count,
+		                             (uint32_t)(spans.size() - count));
+	}
+	spans.resize(count);
+	return spans;
+}
+
+std::vector<t_rle_blob>
+find_blobs(const std::vector<t_rle_span> &spans, uint32_t min_area = 1, uint32_t max_area = UINT32_MAX)
+{
+	t_rle_blob_finder finder = {};
+	std::vector<t_rle_blob> blobs(spans.size() + 1);
+	uint32_t count = t_rle_find_blobs(&finder, spans.data(), (uint32_t)spans.size(), min_area, max_area,
+	                                  blobs.data(), (uint32_t)blobs.size());
+	t_rle_blob_finder_destroy(&finder);
+	blobs.resize(count);
+	return blobs;
+}
+
+} // namespace
+
+
+TEST_CASE("t_hsv_classify_row")
+{
+	auto table = make_table();
+
+	// Not a multiple of 64 to hit the partial last word.
+	const uint32_t width = 202;
+
+	SECTION("YUV888")
+	{
+		auto src = random_bytes(width * 3, 1);
+		std::vector<uint64_t> m[4];
+		uint64_t *masks[4];
+		for (int c = 0; c < 4; c++) {
+			m[c].assign(T_HSV_MASK_WORDS(width), 0);
+			masks[c] = m[c].data();
+		}
+
+		t_hsv_classify_row_yuv888(table.get(), src.data(), width, masks);
+
+		uint32_t mismatches = 0;
+		for (uint32_t x = 0; x < width; x++) {
+			uint8_t bits = t_hsv_filter_sample(table.get(), src[x * 3], src[x * 3 + 1], src[x * 3 + 2]);
+			for (int c = 0; c < 4; c++) {
+				bool got = (m[c][x / 64] >> (x % 64)) & 1;
+				mismatches += got != (((bits >> c) & 1) != 0);
+			}
+		}
+		CHECK(mismatches == 0);
+	}
+
+	SECTION("YUYV422 with skipped channels")
+	{
+		auto src = random_bytes(width * 2, 2);
+		std::vector<uint64_t> m(T_HSV_MASK_WORDS(width), 0);
+		uint64_t *masks[4] = {nullptr, nullptr, m.data(), nullptr};
+
+		t_hsv_classify_row_yuyv(table.get(), src.data(), width, masks);
+
+		std::vector<uint8_t> expanded(width);
+		t_hsv_mask_expand_row(m.data(), width, expanded.data());
+
+		uint32_t mismatches = 0;
+		for (uint32_t x = 0; x < width; x++) {
+			const uint8_t *p = &src[(x / 2) * 4];
+			uint8_t bits = t_hsv_filter_sample(table.get(), p[(x % 2) * 2], p[1], p[3]);
+			uint8_t expected = (bits & (1 << 2)) ? 0xff : 0x00;
+			mismatches += expanded[x] != expected;
+		}
+		CHECK(mismatches == 0);
+	}
+}
+
+TEST_CASE("t_rle_encode")
+{
+	SECTION("Runs across words and up to the end")
+	{
+		// 130 pixels, three words with the last one partial.
+		std::vector<uint8_t> row(130, 0);
+		for (uint32_t x : {0, 1, 2}) {
+			row[x] = 255;
+		}
+		for (uint32_t x = 63; x < 130; x++) {
+			row[x] = 255;
+		}
+
+		t_rle_span spans[8];
+		uint32_t count = t_rle_encode_l8_row(row.data(), 130, 32, 7, spans, 8);
+		REQUIRE(count == 2);
+		CHECK(spans[0].y == 7);
+		CHECK(spans[0].x_start == 0);
+		CHECK(spans[0].x_end == 3);
+		CHECK(spans[1].x_start == 63);
+		CHECK(spans[1].x_end == 130);
+	}
+
+	SECTION("Span limit")
+	{
+		std::vector<uint8_t> row(64, 0);
+		for (uint32_t x = 0; x < 16; x += 2) {
+			row[x] = 255;
+		}
+
+		t_rle_span spans[3];
+		CHECK(t_rle_encode_l8_row(row.data(), 64, 32, 0, spans, 3) == 3);
+		CHECK(spans[2].x_start == 4);
+	}
+
+	SECTION("L8 rows at every threshold")
+	{
+		// Every value once then a few bright pixels past the last full group of eight.
+		const uint32_t width = 259;
+		std::vector<uint8_t> row(width, 255);
+		for (uint32_t x = 0; x < 256; x++) {
+			row[x] = (uint8_t)x;
+		}
+
+		for (uint32_t threshold = 0; threshold < 256; threshold++) {
+			t_rle_span spans[4];
+			uint32_t count = t_rle_encode_l8_row(row.data(), width, (uint8_t)threshold, 0, spans, 4);
+			if (threshold == 255) {
+				CHECK(count == 0);
+				continue;
+			}
+			REQUIRE(count == 1);
+			CHECK(spans[0].x_start == threshold + 1);
+			CHECK(spans[0].x_end == width);
+		}
+	}
+
+	SECTION("L8 rows longer than one chunk")
+	{
+		const uint32_t width = 5000;
+		std::vector<uint8_t> row(width, 0);
+		for (uint32_t x = 4000; x < 4200; x++) {
+			row[x] = 200;
+		}
+		row[width - 1] = 33;
+		row[0] = 32; // Not above the threshold.
+
+		t_rle_span spans[8];
+		uint32_t count = t_rle_encode_l8_row(row.data(), width, 32, 0, spans, 8);
+		REQUIRE(count == 2);
+		CHECK(spans[0].x_start == 4000);
+		CHECK(spans[0].x_end == 4200);
+		CHECK(spans[1].x_start == width - 1);
+		CHECK(spans[1].x_end == width);
+	}
+}
+
+TEST_CASE("t_rle_find_blobs")
+{
+	const uint32_t width = 16;
+	const uint32_t height = 8;
+	std::vector<uint8_t> img(width * height, 0);
+	auto set = [&](uint32_t x, uint32_t y) { img[y * width + x] = 255; };
+
+	// A 3x3 square at (1, 1).
+	for (uint32_t y = 1; y < 4; y++) {
+		for (uint32_t x = 1; x < 4; x++) {
+			set(x, y);
+		}
+	}
+
+	// A diagonal line, only 8-connected.
+	set(8, 1);
+	set(9, 2);
+	set(10, 3);
+	set(11, 4);
+
+	// A U shape, the arms only join at the bottom row.
+	set(1, 6);
+	set(3, 6);
+	set(1, 7);
+	set(2, 7);
+	set(3, 7);
+
+	// A lone pixel in the corner.
+	set(15, 7);
+
+	auto blobs = find_blobs(encode_image(img, width, height, 128));
+	REQUIRE(blobs.size() == 4);
+
+	// Scan order of the first span of each blob.
+	CHECK(blobs[0].area == 9);
+	CHECK(blobs[0].x == Approx(2.0f));
+	CHECK(blobs[0].y == Approx(2.0f));
+	CHECK(blobs[0].min_x == 1);
+	CHECK(blobs[0].max_x == 3);
+	CHECK(blobs[0].min_y == 1);
+	CHECK(blobs[0].max_y == 3);
+
+	CHECK(blobs[1].area == 4);
+	CHECK(blobs[1].x == Approx(9.5f));
+	CHECK(blobs[1].y == Approx(2.5f));
+
+	CHECK(blobs[2].area == 5);
+	CHECK(blobs[2].x == Approx(2.0f));
+	CHECK(blobs[2].y == Approx(6.6f));
+
+	CHECK(blobs[3].area == 1);
+	CHECK(blobs[3].x == Approx(15.0f));
+	CHECK(blobs[3].y == Approx(7.0f));
+
+	SECTION("Area filter")
+	{
+		auto filtered = find_blobs(encode_image(img, width, height, 128), 2, 8);
+		REQUIRE(filtered.size() == 2);
+		CHECK(filtered[0].area == 4);
+		CHECK(filtered[1].area == 5);
+	}
+
+	SECTION("Merge close blobs")
+	{
+		// Only the square and the U are closer than five pixels.
+		uint32_t count = t_rle_merge_blobs(blobs.data(), (uint32_t)blobs.size(), 5.0f);
+		REQUIRE(count == 3);
+
+		CHECK(blobs[0].area == 14);
+		CHECK(blobs[0].x == Approx(2.0f));
+		CHECK(blobs[0].y == Approx((2.0f * 9 + 6.6f * 5) / 14));
+		CHECK(blobs[0].min_x == 1);
+		CHECK(blobs[0].max_x == 3);
+		CHECK(blobs[0].min_y == 1);
+		CHECK(blobs[0].max_y == 7);
+
+		// The rest keep their order.
+		CHECK(blobs[1].area == 4);
+		CHECK(blobs[2].area == 1);
+	}
+
+	SECTION("No merging at zero distance")
+	{
+		CHECK(t_rle_merge_blobs(blobs.data(), (uint32_t)blobs.size(), 0.0f) == 4);
+	}
+}
+
+
+/*
+ *
+ * Benchmark, run with: tests_rle_blobs "[.benchmark]"
+ *
+ * Set T_RLE_BENCH_FRAME to a raw 640x480 YUYV frame to use a recording
+ * instead of the synthetic one.
+ *
+ */
+
+namespace {
+
+constexpr uint32_t kBenchWidth = 640;
+constexpr uint32_t kBenchHeight = 480;
+
+std::vector<uint8_t>
+make_bench_frame()
+{
+	std::vector<uint8_t> frame(kBenchWidth * kBenchHeight * 2);
+
+	const char *path = std::getenv("T_RLE_BENCH_FRAME");
+	if (path != nullptr) {
+		std::ifstream file(path, std::ios::binary);
+		if (file.read((char *)frame.data(), (std::streamsize)frame.size())) {
+			return frame;
+		}
+		std::printf("Could not read %s, using a synthetic frame\n", path);
+	}
+
+	// Dark noisy background with a few bright balls, like a PS Eye frame.
+	std::mt19937 rng(3);
+	std::uniform_int_distribution<int> noise(0, 24);
+	const int balls[3][3] = {{120, 200, 18}, {400, 100, 25}, {520, 380, 10}};
+
+	for (uint32_t y = 0; y < kBenchHeight; y++) {
+		for (uint32_t x = 0; x < kBenchWidth; x++) {
+			uint8_t luma = (uint8_t)(16 + noise(rng));
+			for (const auto &b : balls) {
+				int dx = (int)x - b[0];
+				int dy = (int)y - b[1];
+				if (dx * dx + dy * dy <= b[2] * b[2]) {
+					luma = 220;
+				}
+			}
+			uint8_t *p = &frame[(y * kBenchWidth + x) * 2];
+			p[0] = luma;
+			p[1] = (x % 2) == 0 ? 90 : 200; // Cb on even, Cr on odd.
+		}
+	}
+
+	return frame;
+}
+
+//! Per byte plane flood fill, stands in for the old blob detection.
+uint32_t
+flood_fill_count(std::vector<uint8_t> &plane, std::vector<uint32_t> &stack)
+{
+	uint32_t blobs = 0;
+	for (uint32_t start = 0; start < plane.size(); start++) {
+		if (plane[start] == 0) {
+			continue;
+		}
+		blobs++;
+		plane[start] = 0;
+		stack.assign(1, start);
+		while (!stack.empty()) {
+			uint32_t i = stack.back();
+			stack.pop_back();
+			int x = (int)(i % kBenchWidth);
+			int y = (int)(i / kBenchWidth);
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					int nx = x + dx, ny = y + dy;
+					if (nx < 0 || ny < 0 || nx >= (int)kBenchWidth || ny >= (int)kBenchHeight) {
+						continue;
+					}
+					uint32_t n = ny * kBenchWidth + nx;
+					if (plane[n] != 0) {
+						plane[n] = 0;
+						stack.push_back(n);
+					}
+				}
+			}
+		}
+	}
+	return blobs;
+}
+
+} // namespace
+
+TEST_CASE("t_rle_blobs_benchmark", "[.benchmark]")
+{
+	using clock = std::chrono::steady_clock;
+
+	auto table = make_table();
+	// Bright pixels go to channel 0 only, regardless of chroma.
+	for (int y = 0; y < T_HSV_SIZE; y++) {
+		for (int u = 0; u < T_HSV_SIZE; u++) {
+			for (int v = 0; v < T_HSV_SIZE; v++) {
+				table->v[y][u][v] = y * T_HSV_STEP > 128 ? 0x1 : 0x0;
+			}
+		}
+	}
+
+	auto frame = make_bench_frame();
+	const int iterations = 200;
+
+	// Old path, four expanded planes then a flood fill on one of them.
+	std::vector<uint8_t> planes[4];
+	for (auto &p : planes) {
+		p.resize(kBenchWidth * kBenchHeight);
+	}
+	std::vector<uint32_t> stack;
+	uint32_t old_blobs = 0;
+
+	auto old_start = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		for (uint32_t y = 0; y < kBenchHeight; y++) {
+			const uint8_t *src = &frame[y * kBenchWidth * 2];
+			for (uint32_t x = 0; x < kBenchWidth; x += 2) {
+				const uint8_t *p = src + x * 2;
+				uint8_t b0 = t_hsv_filter_sample(table.get(), p[0], p[1], p[3]);
+				uint8_t b1 = t_hsv_filter_sample(table.get(), p[2], p[1], p[3]);
+				for (int c = 0; c < 4; c++) {
+					planes[c][y * kBenchWidth + x] = (b0 & (1 << c)) ? 0xff : 0x00;
+					planes[c][y * kBenchWidth + x + 1] = (b1 & (1 << c)) ? 0xff : 0x00;
+				}
+			}
+		}
+		old_blobs = flood_fill_count(planes[0], stack);
+	}
+	auto old_time = clock::now() - old_start;
+
+	// New path, packed masks expanded into the L8 frame the trackers get, then run-length encoded.
+	std::vector<uint64_t> mask(T_HSV_MASK_WORDS(kBenchWidth));
+	std::vector<uint8_t> plane(kBenchWidth * kBenchHeight);
+	std::vector<t_rle_span> spans(kBenchWidth * kBenchHeight / 2);
+	std::vector<t_rle_blob> blobs(spans.size());
+	t_rle_blob_finder finder = {};
+	uint32_t new_blobs = 0;
+
+	auto new_start = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		uint64_t *masks[4] = {mask.data(), nullptr, nullptr, nullptr};
+		uint32_t count = 0;
+		for (uint32_t y = 0; y < kBenchHeight; y++) {
+			uint8_t *row = &plane[y * kBenchWidth];
+			t_hsv_classify_row_yuyv(table.get(), &frame[y * kBenchWidth * 2], kBenchWidth, masks);
+			t_hsv_mask_expand_row(mask.data(), kBenchWidth, row);
+			count += t_rle_encode_l8_row(row, kBenchWidth, 128, (uint16_t)y, spans.data() + count,
+			                             (uint32_t)(spans.size() - count));
+		}
+		new_blobs = t_rle_find_blobs(&finder, spans.data(), count, 1, UINT32_MAX, blobs.data(),
+		                             (uint32_t)blobs.size());
+	}
+	auto new_time = clock::now() - new_start;
+	t_rle_blob_finder_destroy(&finder);
+
+	double old_ms = std::chrono::duration<double, std::milli>(old_time).count() / iterations;
+	double new_ms = std::chrono::duration<double, std::milli>(new_time).count() / iterations;
+	std::printf("Per frame: old %.3f ms, new %.3f ms, speedup %.2fx\n", old_ms, new_ms, old_ms / new_ms);
+
+	CHECK(old_blobs == new_blobs);
+}
@@ -0,0 +1,151 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Frame fan-out sink tests.
+ */
+
+#include "util/u_sink.h"
+#include "os/os_time.h"
+
+#include "catch/catch.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+namespace {
+
+struct RecordingSink
+{
+	xrt_frame_sink base = {};
+	int id = 0;
+	std::vector<int> *order = nullptr;
+	std::mutex *mutex = nullptr;
+	std::atomic<int> received{0};
+};
+
+void
+record_frame(xrt_frame_sink *xfs, xrt_frame *xf)
+{
+	RecordingSink *s = reinterpret_cast<RecordingSink *>(xfs);
+	{
+		std::lock_guard<std::mutex> lock(*s->mutex);
+		s->order->push_back(s->id);
+	}
+	s->received++;
+}
+
+void
+destroy_frame(xrt_frame *xf)
+{
+	delete xf;
+}
+
+xrt_frame *
+make_frame()
+{
+	xrt_frame *xf = new xrt_frame();
+	xf->reference.count = 1;
+	xf->destroy = destroy_frame;
+	return xf;
+}
+
+} // namespace
+
+
+TEST_CASE("u_sink_fanout")
+{
+	std::vector<int> order;
+	std::mutex mutex;
+
+	RecordingSink sinks[3];
+	for (int i = 0; i < 3; i++) {
+		sinks[i].base.push_frame = record_frame;
+		sinks[i].id = i;
+		sinks[i].order = &order;
+		sinks[i].mutex = &mutex;
+	}
+
+	xrt_frame_context xfctx = {};
+	xrt_frame_sink *fanout = nullptr;
+
+	// Given in the "wrong" order, queued consumer first and low priority sync before high.
+	u_sink_fanout_consumer consumers[4] = {};
+	consumers[0].sink = &sinks[2].base;
+	consumers[0].policy = U_SINK_FANOUT_DROP_NEWEST;
+	consumers[0].priority = 1000;
+	consumers[0].max_queue = 16;
+	consumers[1].sink = &sinks[1].base;
+	consumers[1].policy = U_SINK_FANOUT_SYNC;
+	consumers[1].priority = 1;
+	consumers[2].sink = nullptr; // Skipped.
+	consumers[3].sink = &sinks[0].base;
+	consumers[3].policy = U_SINK_FANOUT_SYNC;
+	consumers[3].priority = 10;
+
+	REQUIRE(u_sink_fanout_create(&xfctx, "test", consumers, 4, &fanout));
+	REQUIRE(fanout != nullptr);
+
+	xrt_frame *xf = make_frame();
+	xrt_sink_push_frame(fanout, xf);
+
+	// Sync consumers are done when the push returns, in priority order.
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		REQUIRE(order.size() >= 2);
+		CHECK(order[0] == 0);
+		CHECK(order[1] == 1);
+	}
+
+	for (int i = 0; i < 1000 && sinks[2].received == 0; i++) {
+		os_nanosleep(U_TIME_1MS_IN_NS);
+	}
+	CHECK(sinks[2].received == 1);
+
+	xrt_frame_reference(&xf, NULL);
+	xrt_frame_context_destroy_nodes(&xfctx);
+}
+
+TEST_CASE("u_sink_queue_drop_policy")
+{
+	std::vector<int> order;
+	std::mutex mutex;
+
+	RecordingSink sink;
+	sink.base.push_frame = record_frame;
+	sink.order = &order;
+	sink.mutex = &mutex;
+
+	xrt_frame_context xfctx = {};
+	u_sink_queue_stats stats = {};
+	xrt_frame_sink *queue = nullptr;
+
+	u_sink_queue_params params = {};
+	params.max_size = 2;
+	params.drop_oldest = true;
+	params.stats = &stats;
+
+	// Hold the consumer so frames pile up in the queue.
+	mutex.lock();
+	REQUIRE(u_sink_queue_create_with_params(&xfctx, &params, &sink.base, &queue));
+
+	xrt_frame *xf = make_frame();
+	for (int i = 0; i < 10; i++) {
+		xrt_sink_push_frame(queue, xf);
+	}
+	mutex.unlock();
+
+	for (int i = 0; i < 1000 && stats.delivered + stats.dropped < 10; i++) {
+		os_nanosleep(U_TIME_1MS_IN_NS);
+	}
+
+	// Nothing is lost without being counted, and at most 1 + max_size frames got through.
+	CHECK(stats.delivered + stats.dropped == 10);
+	CHECK(stats.delivered <= 3);
+	CHECK(stats.max_latency_ns >= stats.latency_ns);
+
+	xrt_frame_reference(&xf, NULL);
+	xrt_frame_context_destroy_nodes(&xfctx);
+}
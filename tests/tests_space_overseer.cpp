@@ -0,0 +1,235 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Space overseer tests.
+ */
+
+#include "math/m_api.h"
+#include "math/m_space.h"
+#include "math/m_vec3.h"
+
+#include "util/u_space_overseer.h"
+
+#include "xrt/xrt_device.h"
+#include "xrt/xrt_session.h"
+#include "xrt/xrt_tracking.h"
+
+#include "catch/catch.hpp"
+
+#include <cmath>
+
+
+namespace {
+
+struct FakeDevice
+{
+	xrt_device base{};
+	xrt_tracking_origin origin{};
+	xrt_space_relation relation{};
+};
+
+void
+fake_get_tracked_pose(xrt_device *xdev, xrt_input_name name, uint64_t at_timestamp_ns, xrt_space_relation *out_relation)
+{
+	*out_relation = reinterpret_cast<FakeDevice *>(xdev)->relation;
+}
+
+xrt_result_t
+fake_push_event(xrt_session_event_sink *xses, const xrt_session_event *xse)
+{
+	return XRT_SUCCESS;
+}
+
+void
+fake_device_init(FakeDevice &dev, const xrt_pose &pose, xrt_space_relation_flags flags)
+{
+	dev.base.tracking_origin = &dev.origin;
+	dev.base.get_tracked_pose = fake_get_tracked_pose;
+	dev.origin.type = XRT_TRACKING_TYPE_OTHER;
+	dev.origin.offset = XRT_POSE_IDENTITY;
+	dev.relation.pose = pose;
+	dev.relation.linear_velocity = {0.1f, 0.2f, 0.3f};
+	dev.relation.angular_velocity = {0.3f, -0.1f, 0.2f};
+	dev.relation.relation_flags = flags;
+}
+
+xrt_pose
+make_pose(float yaw, float x, float y, float z)
+{
+	xrt_pose pose = XRT_POSE_IDENTITY;
+	xrt_vec3 axis{0.2f, 1.0f, 0.1f};
+	math_quat_from_angle_vector(yaw, &axis, &pose.orientation);
+	math_quat_normalize(&pose.orientation);
+	pose.position = {x, y, z};
+	return pose;
+}
+
+bool
+relations_close(const xrt_space_relation &a, const xrt_space_relation &b)
+{
+	auto close = [](const xrt_vec3 &x, const xrt_vec3 &y) { return m_vec3_len(x - y) < 1e-4f; };
+
+	const xrt_quat &qa = a.pose.orientation;
+	const xrt_quat &qb = b.pose.orientation;
+	float dot = std::fabs(qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w);
+
+	return a.relation_flags == b.relation_flags && dot > 1.0f - 1e-5f &&
+	       close(a.pose.position, b.pose.position) && close(a.linear_velocity, b.linear_velocity) &&
+	       close(a.angular_velocity, b.angular_velocity);
+}
+
+constexpr xrt_space_relation_flags kAllFlags = (xrt_space_relation_flags)( //
+    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |                           //
+    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT |                         //
+    XRT_SPACE_RELATION_POSITION_VALID_BIT |                              //
+    XRT_SPACE_RELATION_POSITION_TRACKED_BIT |                            //
+    XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT |                       //
+    XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT);
+
+/*!
+ * Locates spaces in a small graph and checks against stepping through it by
+ * hand, the flags of the device pose are passed in.
+ */
+void
+check_graph(u_space_overseer *uso, xrt_space_relation_flags flags)
+{
+	xrt_space_overseer *xso = (xrt_space_overseer *)uso;
+
+	FakeDevice dev;
+	xrt_pose dev_pose = make_pose(0.7f, 0.3f, 1.5f, -0.4f);
+	fake_device_init(dev, dev_pose, flags);
+
+	/*
+	 * root -> a -> b -> pose of dev -> c
+	 *           -> d
+	 */
+	xrt_pose pa = make_pose(0.4f, 1.0f, 0.0f, 2.0f);
+	xrt_pose pb = make_pose(-0.3f, 0.0f, 0.5f, 0.0f);
+	xrt_pose pc = make_pose(0.1f, 0.0f, 0.0f, -0.1f);
+	xrt_pose pd = make_pose(1.2f, -1.0f, 0.0f, 0.3f);
+
+	xrt_space *a = nullptr;
+	xrt_space *b = nullptr;
+	xrt_space *c = nullptr;
+	xrt_space *d = nullptr;
+	xrt_space *pose = nullptr;
+	u_space_overseer_create_offset_space(uso, xso->semantic.root, &pa, &a);
+	u_space_overseer_create_offset_space(uso, a, &pb, &b);
+	u_space_overseer_link_space_to_device(uso, b, &dev.base);
+	u_space_overseer_create_pose_space(uso, &dev.base, XRT_INPUT_GENERIC_HEAD_POSE, &pose);
+	u_space_overseer_create_offset_space(uso, pose, &pc, &c);
+	u_space_overseer_create_offset_space(uso, a, &pd, &d);
+
+	xrt_pose offset = make_pose(0.2f, 0.0f, 0.1f, 0.0f);
+	xrt_pose base_offset = make_pose(-0.5f, 0.2f, 0.0f, 0.0f);
+
+	xrt_relation_chain xrc{};
+	m_relation_chain_push_pose(&xrc, &offset);
+	m_relation_chain_push_pose(&xrc, &pc);
+	m_relation_chain_push_relation(&xrc, &dev.relation);
+	m_relation_chain_push_pose(&xrc, &pb);
+	m_relation_chain_push_pose(&xrc, &pa);
+	m_relation_chain_push_inverted_pose_if_not_identity(&xrc, &pa);
+	m_relation_chain_push_inverted_pose_if_not_identity(&xrc, &pd);
+	m_relation_chain_push_inverted_pose_if_not_identity(&xrc, &base_offset);
+	xrt_space_relation expected{};
+	m_relation_chain_resolve(&xrc, &expected);
+
+	// Twice, the second time hits the compiled chain.
+	for (int i = 0; i < 2; i++) {
+		xrt_space_relation rel{};
+		xrt_space_overseer_locate_space(xso, d, &base_offset, 0, c, &offset, &rel);
+		CHECK(relations_close(rel, expected));
+	}
+
+	// And the other way around.
+	xrt_relation_chain inv{};
+	m_relation_chain_push_pose(&inv, &pd);
+	m_relation_chain_push_inverted_pose_if_not_identity(&inv, &pb);
+	m_relation_chain_push_inverted_relation(&inv, &dev.relation);
+	m_relation_chain_push_inverted_pose_if_not_identity(&inv, &pc);
+	m_relation_chain_resolve(&inv, &expected);
+
+	xrt_space_relation rel{};
+	xrt_space_overseer_locate_space(xso, c, nullptr, 0, d, nullptr, &rel);
+	CHECK(relations_close(rel, expected));
+
+	// The device pose changing is picked up.
+	dev.relation.pose = make_pose(-0.2f, 0.0f, 1.7f, 0.0f);
+	xrc.step_count = 0;
+	m_relation_chain_push_pose(&xrc, &pc);
+	m_relation_chain_push_relation(&xrc, &dev.relation);
+	m_relation_chain_push_pose(&xrc, &pb);
+	m_relation_chain_push_inverted_pose_if_not_identity(&xrc, &pd);
+	m_relation_chain_resolve(&xrc, &expected);
+
+	xrt_space_overseer_locate_space(xso, d, nullptr, 0, c, nullptr, &rel);
+	CHECK(relations_close(rel, expected));
+
+	xrt_space_reference(&a, nullptr);
+	xrt_space_reference(&b, nullptr);
+	xrt_space_reference(&c, nullptr);
+	xrt_space_reference(&d, nullptr);
+	xrt_space_reference(&pose, nullptr);
+}
+
+} // namespace
+
+
+TEST_CASE("space_overseer")
+{
+	xrt_session_event_sink broadcast{fake_push_event};
+	u_space_overseer *uso = u_space_overseer_create(&broadcast);
+	xrt_space_overseer *xso = (xrt_space_overseer *)uso;
+	REQUIRE(uso != nullptr);
+
+	SECTION("Located spaces match stepping through the graph")
+	{
+		check_graph(uso, kAllFlags);
+	}
+
+	SECTION("Device without tracked or velocity flags")
+	{
+		check_graph(uso, (xrt_space_relation_flags)(XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |
+		                                             XRT_SPACE_RELATION_POSITION_VALID_BIT));
+	}
+
+	SECTION("Recentering updates located spaces")
+	{
+		FakeDevice head;
+		xrt_pose head_pose = make_pose(0.9f, 1.0f, 1.6f, -2.0f);
+		fake_device_init(head, head_pose, kAllFlags);
+
+		xrt_device *xdev = &head.base;
+		xrt_pose local_offset = XRT_POSE_IDENTITY;
+		u_space_overseer_legacy_setup(uso, &xdev, 1, xdev, &local_offset, false);
+
+		xrt_space_relation before{};
+		xrt_space_overseer_locate_space(xso, xso->semantic.local, nullptr, 0, xso->semantic.view, nullptr,
+		                                &before);
+		CHECK(relations_close(before, head.relation));
+
+		REQUIRE(xrt_space_overseer_recenter_local_spaces(xso) == XRT_SUCCESS);
+
+		// The view is now straight above local, at the same height.
+		xrt_space_relation after{};
+		xrt_space_overseer_locate_space(xso, xso->semantic.local, nullptr, 0, xso->semantic.view, nullptr,
+		                                &after);
+		CHECK(after.pose.position.x == Approx(0.0f).margin(1e-4f));
+		CHECK(after.pose.position.y == Approx(head_pose.position.y).margin(1e-4f));
+		CHECK(after.pose.position.z == Approx(0.0f).margin(1e-4f));
+
+		// Same through locate_device, the head is in the root space.
+		xrt_space_relation root_in_local{};
+		xrt_space_overseer_locate_device(xso, xso->semantic.local, nullptr, 0, xdev, &root_in_local);
+		xrt_space_relation view_in_local{};
+		xrt_relation_chain xrc{};
+		m_relation_chain_push_relation(&xrc, &head.relation);
+		m_relation_chain_push_relation(&xrc, &root_in_local);
+		m_relation_chain_resolve(&xrc, &view_in_local);
+		CHECK(relations_close(view_in_local, after));
+	}
+
+	xrt_space_overseer_destroy(&xso);
+}
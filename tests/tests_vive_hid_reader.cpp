@@ -0,0 +1,308 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Vive epoll HID reader tests, replays IMU reports over socket pairs.
+ */
+
+#include "os/os_hid.h"
+#include "os/os_time.h"
+#include "util/u_time.h"
+
+#include "vive/vive_hid_reader.h"
+
+#include "catch/catch.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <condition_variable>
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+
+namespace {
+
+constexpr int kReportSize = 52;
+constexpr int kReportsPerDevice = 200;
+constexpr int kDeviceCount = 3;
+
+//! Socket pair backed hid device, keeps report boundaries like hidraw does.
+struct FakeHid
+{
+	os_hid_device base;
+	int fd;
+	int writer_fd;
+};
+
+int
+fake_read(os_hid_device *hid_dev, uint8_t *data, size_t size, int milliseconds)
+{
+	FakeHid *h = reinterpret_cast<FakeHid *>(hid_dev);
+	if (milliseconds >= 0) {
+		pollfd fds = {h->fd, POLLIN, 0};
+		int ret = poll(&fds, 1, milliseconds);
+		if (ret <= 0) {
+			return ret;
+		}
+	}
+
+	int ret = (int)read(h->fd, data, size);
+	if (ret < 0 && errno == EAGAIN) {
+		return 0;
+	}
+	return ret;
+}
+
+int
+fake_get_fd(os_hid_device *hid_dev)
+{
+	return reinterpret_cast<FakeHid *>(hid_dev)->fd;
+}
+
+void
+fake_destroy(os_hid_device *hid_dev)
+{
+	FakeHid *h = reinterpret_cast<FakeHid *>(hid_dev);
+	close(h->fd);
+	close(h->writer_fd);
+	delete h;
+}
+
+FakeHid *
+make_fake_hid()
+{
+	int fds[2];
+	REQUIRE(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == 0);
+
+	FakeHid *h = new FakeHid();
+	h->base.read = fake_read;
+	h->base.get_fd = fake_get_fd;
+	h->base.destroy = fake_destroy;
+	h->fd = fds[0];
+	h->writer_fd = fds[1];
+	return h;
+}
+
+//! Stands in for a captured IMU report, only id and sequence number are set.
+void
+write_report(FakeHid *h, uint8_t seq)
+{
+	uint8_t report[kReportSize] = {0x20};
+	report[1] = seq;
+	if (write(h->writer_fd, report, sizeof(report)) != (ssize_t)sizeof(report)) {
+		FAIL("Failed to write report");
+	}
+}
+
+struct Counter
+{
+	std::mutex mutex;
+	std::condition_variable cond;
+
+	//! The first report blocks until this is set, so the rest queue up.
+	bool release = true;
+	bool blocked = false;
+
+	std::atomic<int> reports{0};
+	std::atomic<int> flushes{0};
+	std::atomic<int> bad{0};
+	uint8_t next_seq = 0;
+};
+
+void
+count_report(void *ptr, const uint8_t *buffer, int size, uint64_t now_ns)
+{
+	Counter *c = static_cast<Counter *>(ptr);
+
+	{
+		std::unique_lock<std::mutex> lock(c->mutex);
+		c->blocked = true;
+		c->cond.notify_all();
+		c->cond.wait(lock, [c] { return c->release; });
+	}
+
+	if (size != kReportSize || buffer[0] != 0x20 || buffer[1] != c->next_seq) {
+		c->bad++;
+	}
+	c->next_seq = buffer[1] + 1;
+	c->reports++;
+}
+
+void
+count_flush(void *ptr)
+{
+	static_cast<Counter *>(ptr)->flushes++;
+}
+
+bool
+wait_for(const std::atomic<int> &value, int target)
+{
+	uint64_t end_ns = os_monotonic_get_ns() + 2 * U_TIME_1S_IN_NS;
+	while (value.load() < target && os_monotonic_get_ns() < end_ns) {
+		os_nanosleep(50 * 1000);
+	}
+	return value.load() >= target;
+}
+
+} // namespace
+
+
+TEST_CASE("vive_hid_reader")
+{
+	vive_hid_reader *reader = vive_hid_reader_create();
+	REQUIRE(reader != nullptr);
+
+	FakeHid *hids[kDeviceCount];
+	Counter counters[kDeviceCount];
+	for (int i = 0; i < kDeviceCount; i++) {
+		hids[i] = make_fake_hid();
+	}
+
+	SECTION("Queued reports are discarded when added")
+	{
+		write_report(hids[0], 100);
+		REQUIRE(vive_hid_reader_add(reader, &hids[0]->base, count_report, count_flush, &counters[0]) == 0);
+		CHECK(vive_hid_reader_add(reader, &hids[0]->base, count_report, count_flush, &counters[0]) != 0);
+
+		write_report(hids[0], 0);
+		REQUIRE(wait_for(counters[0].reports, 1));
+		CHECK(counters[0].bad == 0);
+		CHECK(counters[0].flushes == 1);
+	}
+
+	SECTION("All devices drained per wakeup, in order")
+	{
+		for (int i = 0; i < kDeviceCount; i++) {
+			REQUIRE(vive_hid_reader_add(reader, &hids[i]->base, count_report, count_flush, &counters[i]) ==
+			        0);
+		}
+
+		// Hold the reader in the first report so the replay queues up behind it.
+		counters[0].release = false;
+		write_report(hids[0], 0);
+		{
+			std::unique_lock<std::mutex> lock(counters[0].mutex);
+			counters[0].cond.wait(lock, [&] { return counters[0].blocked; });
+		}
+
+		for (int r = 0; r < kReportsPerDevice; r++) {
+			for (int i = 0; i < kDeviceCount; i++) {
+				if (i != 0 || r != 0) {
+					write_report(hids[i], (uint8_t)r);
+				}
+			}
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(counters[0].mutex);
+			counters[0].release = true;
+			counters[0].cond.notify_all();
+		}
+
+		for (int i = 0; i < kDeviceCount; i++) {
+			REQUIRE(wait_for(counters[i].reports, kReportsPerDevice));
+			CHECK(counters[i].bad == 0);
+			CHECK(counters[i].flushes > 0);
+			CHECK(counters[i].flushes < kReportsPerDevice / 8);
+		}
+
+		vive_hid_reader_stats stats;
+		vive_hid_reader_get_stats(reader, &stats);
+		CHECK(stats.reports == kReportsPerDevice * kDeviceCount);
+		CHECK(stats.wakeups * 8 < stats.reports);
+		printf("vive_hid_reader: %d reports over %d devices in %d wakeups, %d flushes\n", (int)stats.reports,
+		       kDeviceCount, (int)stats.wakeups, (int)stats.flushes);
+	}
+
+	SECTION("No callbacks after remove")
+	{
+		REQUIRE(vive_hid_reader_add(reader, &hids[1]->base, count_report, nullptr, &counters[1]) == 0);
+		write_report(hids[1], 0);
+		REQUIRE(wait_for(counters[1].reports, 1));
+		CHECK(counters[1].flushes == 0);
+
+		vive_hid_reader_remove(reader, &hids[1]->base);
+		write_report(hids[1], 1);
+		os_nanosleep(20 * U_TIME_1MS_IN_NS);
+		CHECK(counters[1].reports == 1);
+	}
+
+	SECTION("Per report cost against a poll per report")
+	{
+		constexpr int kCount = 150;
+
+		// Old style, one poll and one read for every report.
+		for (int r = 0; r < kCount; r++) {
+			write_report(hids[2], (uint8_t)r);
+		}
+		uint8_t buffer[64];
+		uint64_t start_ns = os_monotonic_get_ns();
+		int polled = 0;
+		while (os_hid_read(&hids[2]->base, buffer, sizeof(buffer), 0) > 0) {
+			polled++;
+		}
+		uint64_t poll_ns = os_monotonic_get_ns() - start_ns;
+		CHECK(polled == kCount);
+
+		// Reader, queue everything up behind a blocked first report.
+		REQUIRE(vive_hid_reader_add(reader, &hids[2]->base, count_report, count_flush, &counters[2]) == 0);
+		vive_hid_reader_stats before;
+		vive_hid_reader_get_stats(reader, &before);
+		counters[2].release = false;
+		write_report(hids[2], 0);
+		{
+			std::unique_lock<std::mutex> lock(counters[2].mutex);
+			counters[2].cond.wait(lock, [&] { return counters[2].blocked; });
+		}
+		for (int r = 1; r < kCount; r++) {
+			write_report(hids[2], (uint8_t)r);
+		}
+
+		start_ns = os_monotonic_get_ns();
+		{
+			std::unique_lock<std::mutex> lock(counters[2].mutex);
+			counters[2].release = true;
+			counters[2].cond.notify_all();
+		}
+		REQUIRE(wait_for(counters[2].reports, kCount));
+		uint64_t reader_ns = os_monotonic_get_ns() - start_ns;
+
+		vive_hid_reader_stats after;
+		vive_hid_reader_get_stats(reader, &after);
+		CHECK(after.wakeups - before.wakeups < (uint64_t)kCount / 8);
+
+		printf("vive_hid_reader: poll per report %.2f us/report, reader %.2f us/report, %d wakeups\n",
+		       (double)poll_ns / 1000.0 / kCount, (double)reader_ns / 1000.0 / kCount,
+		       (int)(after.wakeups - before.wakeups));
+	}
+
+	// Stops the thread, then nothing references the devices.
+	vive_hid_reader_unref(&reader);
+	CHECK(reader == nullptr);
+
+	for (int i = 0; i < kDeviceCount; i++) {
+		os_hid_destroy(&hids[i]->base);
+	}
+}
+
+TEST_CASE("vive_hid_reader_spread_timestamps")
+{
+	// Two wakeups, three samples 1 ms apart in the first and two in the second.
+	constexpr uint64_t kMs = U_TIME_1MS_IN_NS;
+	const uint64_t received_ns[] = {100 * kMs, 100 * kMs, 100 * kMs, 104 * kMs, 104 * kMs};
+	const uint64_t device_ns[] = {10 * kMs, 11 * kMs, 12 * kMs, 13 * kMs, 14 * kMs};
+	uint64_t out_ns[5] = {};
+
+	vive_hid_reader_spread_timestamps(received_ns, device_ns, 5, out_ns);
+
+	CHECK(out_ns[0] == 98 * kMs);
+	CHECK(out_ns[1] == 99 * kMs);
+	CHECK(out_ns[2] == 100 * kMs);
+	CHECK(out_ns[3] == 103 * kMs);
+	CHECK(out_ns[4] == 104 * kMs);
+}
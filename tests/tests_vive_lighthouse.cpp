@@ -0,0 +1,132 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Lighthouse pulse decoding tests and replay benchmark.
+ */
+
+#include "os/os_time.h"
+
+#include "vive/vive_lighthouse.h"
+
+#include "catch/catch.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+constexpr uint32_t kSyncSensors = 8;
+constexpr uint32_t kSweepSensors = 16;
+constexpr uint32_t kPulsesPerReport = 9;
+
+using Report = std::vector<lighthouse_pulse>;
+
+uint32_t
+sweep_offset(uint32_t sensor, uint32_t rotor)
+{
+	return 100000 + sensor * 10000 + rotor * 1000;
+}
+
+/*!
+ * Stands in for a capture of a single base station in mode A: a sync flood
+ * every 400000 ticks alternating the rotor, followed by a sweep hitting
+ * @ref kSweepSensors sensors. Pulses are grouped into reports of nine like
+ * the headset sends them.
+ */
+std::vector<Report>
+make_capture(uint32_t frames)
+{
+	std::vector<lighthouse_pulse> pulses;
+	uint32_t t = 1000000;
+
+	for (uint32_t f = 0; f < frames; f++, t += 400000) {
+		uint32_t rotor = f % 2;
+		uint16_t sync_duration = (uint16_t)(3000 + 500 * rotor);
+
+		for (uint32_t k = 0; k < kSyncSensors; k++) {
+			pulses.push_back({t + k * 5, sync_duration, (uint8_t)(16 + k)});
+		}
+		// Nothing can be decoded before the second sync, keep the log quiet.
+		for (uint32_t s = 0; f >= 2 && s < kSweepSensors; s++) {
+			pulses.push_back({t + sweep_offset(s, rotor), 200, (uint8_t)s});
+		}
+	}
+
+	std::vector<Report> reports;
+	for (size_t i = 0; i < pulses.size(); i += kPulsesPerReport) {
+		reports.emplace_back(pulses.begin() + i, pulses.begin() + std::min(pulses.size(), i + kPulsesPerReport));
+	}
+
+	return reports;
+}
+
+void
+init_watchman(lighthouse_watchman &w)
+{
+	// Don't print the sync lock message on every replay.
+	setenv("VIVE_LOG", "error", 0);
+
+	memset(&w, 0, sizeof(w));
+	lighthouse_watchman_init(&w, "test");
+}
+
+void
+replay_single(lighthouse_watchman &w, const std::vector<Report> &reports)
+{
+	for (const Report &r : reports) {
+		for (const lighthouse_pulse &p : r) {
+			lighthouse_watchman_handle_pulse(&w, p.id, p.duration, p.timestamp);
+		}
+	}
+}
+
+} // namespace
+
+
+TEST_CASE("lighthouse_pulses")
+{
+	constexpr uint32_t kFrames = 64;
+
+	static lighthouse_watchman w;
+	init_watchman(w);
+	replay_single(w, make_capture(kFrames));
+
+	CHECK(w.sync_lock);
+	CHECK(w.base[0].channel == 'A');
+
+	// Only the last frame of each rotor is kept.
+	const lighthouse_frame &frame = w.base[0].frame[1];
+	CHECK(frame.sweep_ids == (1u << kSweepSensors) - 1);
+	CHECK(frame.sweep_offset[3] == sweep_offset(3, 1));
+}
+
+TEST_CASE("lighthouse_pulses_replay_benchmark", "[.benchmark]")
+{
+	constexpr uint32_t kFrames = 2000;
+	constexpr int kRuns = 5;
+
+	std::vector<Report> reports = make_capture(kFrames);
+	uint64_t pulse_count = 0;
+	for (const Report &r : reports) {
+		pulse_count += r.size();
+	}
+
+	static lighthouse_watchman w;
+
+	uint64_t best_ns = UINT64_MAX;
+	for (int run = 0; run < kRuns; run++) {
+		init_watchman(w);
+		uint64_t start_ns = os_monotonic_get_ns();
+		replay_single(w, reports);
+		best_ns = std::min(best_ns, os_monotonic_get_ns() - start_ns);
+	}
+
+	CHECK(w.sync_lock);
+	printf("lighthouse replay: %u pulses, %.1f ns/pulse\n", (unsigned)pulse_count,
+	       (double)best_ns / (double)pulse_count);
+}
@@ -0,0 +1,139 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Test for WMR camera bulk transfer parsing.
+ */
+
+#include "wmr/wmr_protocol.h"
+
+#include "catch/catch.hpp"
+
+#include <vector>
+#include <cstring>
+
+
+/*!
+ * Pack @p frame into a transfer the same way the headset does it, so that
+ * the payload can be replayed into the parser.
+ */
+static std::vector<uint8_t>
+pack_xfer(const std::vector<uint8_t> &frame, uint64_t start_ticks, uint64_t end_ticks, uint16_t frametype)
+{
+	const size_t chunk_size = WMR_CAMERA_XFER_PACKET_SIZE - WMR_CAMERA_XFER_HEADER_SIZE;
+
+	std::vector<uint8_t> xfer;
+	size_t offset = 0;
+	uint32_t slice = 0;
+	while (offset < frame.size()) {
+		size_t to_copy = std::min(chunk_size, frame.size() - offset);
+
+		// Header, magic and slice counter, the rest is junk.
+		uint8_t header[WMR_CAMERA_XFER_HEADER_SIZE];
+		memset(header, 0xa5, sizeof(header));
+		memcpy(header, "Dlo+", 4);
+		memcpy(header + 8, &slice, sizeof(slice));
+		xfer.insert(xfer.end(), header, header + sizeof(header));
+
+		xfer.insert(xfer.end(), frame.begin() + offset, frame.begin() + offset + to_copy);
+		offset += to_copy;
+		slice++;
+	}
+
+	auto push = [&](uint64_t v, int bytes) {
+		for (int i = 0; i < bytes; i++) {
+			xfer.push_back((uint8_t)(v >> (8 * i)));
+		}
+	};
+	push(start_ticks, 8);
+	push(end_ticks, 8);
+	push(88, 2);
+	push(0, 2);
+	xfer.insert(xfer.end(), {'D', 'l', 'o', '+'});
+	push(frametype, 2);
+
+	return xfer;
+}
+
+static std::vector<uint8_t>
+make_frame(size_t size)
+{
+	std::vector<uint8_t> frame(size);
+	for (size_t i = 0; i < size; i++) {
+		frame[i] = (uint8_t)(i * 31 + (i >> 8));
+	}
+	return frame;
+}
+
+TEST_CASE("WmrCameraXferSize")
+{
+	// Documented sizes for 2 x 640x480 and 4 x 640x480 cameras.
+	CHECK(wmr_camera_xfer_size(2 * 640 * 481) == 616538);
+	CHECK(wmr_camera_xfer_size(4 * 640 * 481) == 1233018);
+}
+
+TEST_CASE("WmrCameraXferUnpack")
+{
+	const size_t cam_count = GENERATE(2, 4);
+	const size_t frame_size = cam_count * 640 * 481;
+
+	std::vector<uint8_t> frame = make_frame(frame_size);
+	std::vector<uint8_t> xfer = pack_xfer(frame, 1000, 112000, 2);
+	REQUIRE(xfer.size() == wmr_camera_xfer_size(frame_size));
+
+	SECTION("roundtrip")
+	{
+		std::vector<uint8_t> out(frame_size);
+		struct wmr_camera_xfer_footer footer = {};
+
+		REQUIRE(wmr_camera_xfer_unpack(xfer.data(), xfer.size(), out.data(), out.size(), &footer));
+		// Don't let Catch stringify the whole frame.
+		bool same = out == frame;
+		CHECK(same);
+		CHECK(footer.start_ts_ns == 1000 * WMR_MS_HOLOLENS_NS_PER_TICK);
+		CHECK(footer.end_ts_ns == 112000 * WMR_MS_HOLOLENS_NS_PER_TICK);
+		CHECK(footer.ctr == 88);
+		CHECK(footer.unknown == 0);
+		CHECK(footer.frametype == 2);
+	}
+
+	SECTION("truncated")
+	{
+		std::vector<uint8_t> out(frame_size);
+		struct wmr_camera_xfer_footer footer = {};
+
+		CHECK_FALSE(wmr_camera_xfer_unpack(xfer.data(), xfer.size() - 1, out.data(), out.size(), &footer));
+		CHECK_FALSE(wmr_camera_xfer_unpack(xfer.data(), xfer.size() / 2, out.data(), out.size(), &footer));
+	}
+
+	SECTION("wrong frame size")
+	{
+		std::vector<uint8_t> out(frame_size - 640);
+		struct wmr_camera_xfer_footer footer = {};
+
+		CHECK_FALSE(wmr_camera_xfer_unpack(xfer.data(), xfer.size(), out.data(), out.size(), &footer));
+	}
+}
+
+TEST_CASE("WmrCameraXferReplay")
+{
+	// Replay a stream of transfers back to back through the same buffer.
+	const size_t frame_size = 2 * 640 * 481;
+	std::vector<uint8_t> out(frame_size);
+
+	uint64_t last_start_ns = 0;
+	for (uint16_t i = 0; i < 9; i++) {
+		std::vector<uint8_t> frame = make_frame(frame_size);
+		frame[89] = (uint8_t)i; // Sequence number in the metadata line.
+
+		uint64_t start_ticks = 10000 + i * 111111;
+		std::vector<uint8_t> xfer = pack_xfer(frame, start_ticks, start_ticks + 111000, i % 3 == 0 ? 0 : 2);
+
+		struct wmr_camera_xfer_footer footer = {};
+		REQUIRE(wmr_camera_xfer_unpack(xfer.data(), xfer.size(), out.data(), out.size(), &footer));
+		CHECK(out[89] == i);
+		CHECK(footer.frametype == (i % 3 == 0 ? 0 : 2));
+		CHECK(footer.start_ts_ns > last_start_ns);
+		last_start_ns = footer.start_ts_ns;
+	}
+}